@@ -0,0 +1,87 @@
+#pragma once
+
+#include <vector>
+#include <chrono>
+#include <utility>
+#include <cstdint>
+
+/*
+* Minimal benchmark harness
+* BENCHMARK(name) registers a function which runs its loop while state.keepRunning() is true,
+* the runner grows the iteration count until a run is long enough to time
+*/
+namespace Bench
+{
+    class State
+    {
+    public:
+        explicit State(uint64_t iterations) noexcept : m_iterations(iterations) {}
+
+        bool keepRunning() noexcept
+        {
+            if (m_index == 0)
+                m_begin = std::chrono::steady_clock::now();
+            if (m_index++ < m_iterations)
+                return true;
+            m_end = std::chrono::steady_clock::now();
+            return false;
+        }
+
+        uint64_t getIterations() const noexcept { return m_iterations; }
+        double   getSeconds()    const noexcept { return std::chrono::duration<double>(m_end - m_begin).count(); }
+
+        // Items processed by all iterations, e.g. objects culled, reported as items per second
+        void     setItemsProcessed(uint64_t items) noexcept { m_items = items; }
+        uint64_t getItemsProcessed() const noexcept { return m_items; }
+
+        // Extra metric of the run, e.g. wasted bytes ratio of an allocator
+        void setCounter(const char* name, double value) { m_counters.emplace_back(name, value); }
+        const std::vector<std::pair<const char*, double>>& getCounters() const noexcept { return m_counters; }
+
+    private:
+        uint64_t m_iterations;
+        uint64_t m_index = 0;
+        uint64_t m_items = 0;
+
+        std::vector<std::pair<const char*, double>> m_counters;
+
+        std::chrono::steady_clock::time_point m_begin;
+        std::chrono::steady_clock::time_point m_end;
+    };
+
+    using Function = void (*)(State&);
+
+    struct Registration
+    {
+        const char* name;
+        Function    function;
+    };
+
+    inline std::vector<Registration>& registry()
+    {
+        static std::vector<Registration> s_registry;
+        return s_registry;
+    }
+
+    struct Registrar
+    {
+        Registrar(const char* name, Function function) { registry().push_back({ name, function }); }
+    };
+
+    // Keep the compiler from optimizing a value away
+    template <typename T>
+    inline void doNotOptimize(const T& value) noexcept
+    {
+#if defined(__GNUC__) || defined(__clang__)
+        asm volatile("" : : "r,m"(value) : "memory");
+#else
+        static volatile const T* s_sink;
+        s_sink = &value;
+#endif
+    }
+}
+
+#define BENCHMARK(name)                                                  \
+    static void name(Bench::State& state);                              \
+    static Bench::Registrar name##Registrar(#name, name);               \
+    static void name(Bench::State& state)
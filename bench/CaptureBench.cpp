@@ -0,0 +1,80 @@
+#include "Bench.hpp"
+#include "Renderer.hpp"
+#include "NullDevice.hpp"
+#include "CaptureDevice.hpp"
+#include "CaptureReplayer.hpp"
+
+#include <string>
+#include <filesystem>
+
+using namespace GalgameEngine;
+
+namespace
+{
+    constexpr uint32_t CaptureFrames = 120;
+
+    std::string getCapturePath(const char* name)
+    {
+        return (std::filesystem::temp_directory_path() / name).string();
+    }
+
+    // Frames of the default renderer, through a capture when path is set
+    void runFrames(Bench::State& state, const char* path)
+    {
+        NullDevice device;
+        std::unique_ptr<CaptureDevice> capture;
+        if (path != nullptr)
+            capture = std::make_unique<CaptureDevice>(device, getCapturePath(path));
+        Device& renderDevice = capture ? static_cast<Device&>(*capture) : device;
+
+        {
+            Renderer::Config config;
+            config.width  = 1280;
+            config.height = 720;
+            Renderer renderer(renderDevice, config);
+            while (state.keepRunning())
+                renderer.render();
+            renderer.flush();
+        }
+
+        if (capture)
+        {
+            capture->finish();
+            state.setCounter("bytes/frame", static_cast<double>(capture->getStats().bytes) / state.getIterations());
+            std::filesystem::remove(getCapturePath(path));
+        }
+    }
+}
+
+// Baseline for the capture below
+BENCHMARK(CaptureFrameOff) { runFrames(state, nullptr); }
+BENCHMARK(CaptureFrameOn)  { runFrames(state, "dx12_bench_frames.gcap"); }
+
+// Whole capture of 120 frames replayed on the null backend per iteration
+BENCHMARK(CaptureReplay120)
+{
+    auto path = getCapturePath("dx12_bench_replay.gcap");
+    {
+        NullDevice    device;
+        CaptureDevice capture(device, path);
+        Renderer::Config config;
+        config.width  = 1280;
+        config.height = 720;
+        Renderer renderer(capture, config);
+        for (uint32_t i = 0; i < CaptureFrames; ++i)
+            renderer.render();
+        renderer.flush();
+    }
+
+    NullDevice      device;
+    CaptureReplayer replayer(device);
+    bool            valid = replayer.open(path);
+    while (state.keepRunning())
+        valid = valid && replayer.replay();
+    replayer.close();
+    std::filesystem::remove(path);
+
+    state.setItemsProcessed(state.getIterations() * CaptureFrames);
+    state.setCounter("commands", static_cast<double>(replayer.getStats().commands));
+    state.setCounter("errors", static_cast<double>(device.getErrorCount() + (valid ? 0 : 1)));
+}
@@ -0,0 +1,181 @@
+#include "Bench.hpp"
+#include "Culling.hpp"
+#include "JobSystem.hpp"
+
+#include <cmath>
+#include <random>
+#include <vector>
+#include <algorithm>
+
+using namespace GalgameEngine;
+
+namespace
+{
+    constexpr uint32_t SmallScene    = 100000;
+    constexpr uint32_t LargeScene    = 1000000;
+    constexpr uint32_t OccluderCount = 16;
+
+    /*
+    * Small boxes scattered over a 2 km square, and a row of walls in front of the camera
+    * The camera stands in the middle, so about a fifth of the objects are in the frustum
+    * and the walls hide part of those. Walls are the last objects
+    */
+    struct Scene
+    {
+        std::vector<float>    center[3];
+        std::vector<float>    extent[3];
+        std::vector<uint32_t> occluders;
+        Mat4                  viewProjection;
+
+        explicit Scene(uint32_t count)
+        {
+            std::mt19937                          random(11);
+            std::uniform_real_distribution<float> ground(-1000.f, 1000.f);
+            std::uniform_real_distribution<float> size(0.5f, 3.f);
+            for (uint32_t i = 0; i < count; ++i)
+            {
+                float e[3] = { size(random), size(random), size(random) };
+                float c[3] = { ground(random), e[1] + size(random) * 4.f, ground(random) };
+                for (int k = 0; k < 3; ++k)
+                {
+                    center[k].push_back(c[k]);
+                    extent[k].push_back(e[k]);
+                }
+            }
+            for (uint32_t i = 0; i < OccluderCount; ++i)
+            {
+                float c[3] = { -240.f + 32.f * static_cast<float>(i), 15.f, 150.f };
+                float e[3] = { 10.f, 15.f, 1.f };
+                occluders.push_back(static_cast<uint32_t>(center[0].size()));
+                for (int k = 0; k < 3; ++k)
+                {
+                    center[k].push_back(c[k]);
+                    extent[k].push_back(e[k]);
+                }
+            }
+
+            auto view       = Mat4::lookAt({ 0.f, 10.f, 0.f }, { 0.f, 10.f, 1000.f }, { 0.f, 1.f, 0.f });
+            auto projection = Mat4::perspectiveFov(Pi / 4.f, 16.f / 9.f, 0.5f, 2000.f);
+            viewProjection  = view * projection;
+        }
+
+        uint32_t size() const { return static_cast<uint32_t>(center[0].size()); }
+
+        BoundsStreams bounds()
+        {
+            return { { center[0].data(), center[1].data(), center[2].data() }, { extent[0].data(), extent[1].data(), extent[2].data() } };
+        }
+    };
+
+    // Every object against the six planes, what the BVH saves
+    void cullBruteForce(const Scene& scene, const Frustum& frustum, std::vector<uint32_t>& visible)
+    {
+        visible.clear();
+        for (uint32_t i = 0; i < scene.size(); ++i)
+        {
+            bool inside = true;
+            for (auto& plane : frustum.planes)
+            {
+                float distance = plane.x * scene.center[0][i] + plane.y * scene.center[1][i] + plane.z * scene.center[2][i] + plane.w;
+                float radius   = std::fabs(plane.x) * scene.extent[0][i] + std::fabs(plane.y) * scene.extent[1][i] + std::fabs(plane.z) * scene.extent[2][i];
+                if (distance + radius < 0.f)
+                {
+                    inside = false;
+                    break;
+                }
+            }
+            if (inside)
+                visible.push_back(i);
+        }
+    }
+
+    void runCulling(Bench::State& state, uint32_t objectCount, uint32_t threadCount, bool occlusion)
+    {
+        Scene scene(objectCount);
+        Bvh   bvh;
+        bvh.build(scene.bounds(), scene.size());
+
+        Culler::Config config;
+        config.occlusion = occlusion;
+        Culler                culler(config);
+        JobSystem             jobs(threadCount);
+        std::vector<uint32_t> visible;
+        while (state.keepRunning())
+        {
+            culler.cull(bvh, scene.viewProjection, scene.occluders.data(), OccluderCount, threadCount > 1 ? &jobs : nullptr, visible);
+            Bench::doNotOptimize(visible.data());
+        }
+
+        auto& stats = culler.getStats();
+
+        // Same objects in the same order as on one thread
+        Culler                single(config);
+        std::vector<uint32_t> singleVisible;
+        single.cull(bvh, scene.viewProjection, scene.occluders.data(), OccluderCount, nullptr, singleVisible);
+
+        // Frustum results must be the objects testing every object finds, brute force lists them by index
+        std::vector<uint32_t> expected;
+        cullBruteForce(scene, Frustum::fromViewProjection(scene.viewProjection), expected);
+        double mismatch = std::fabs(static_cast<double>(stats.frustumVisible) - static_cast<double>(expected.size()));
+        if (!occlusion)
+        {
+            auto sorted = visible;
+            std::sort(sorted.begin(), sorted.end());
+            mismatch += sorted != expected;
+        }
+
+        state.setItemsProcessed(state.getIterations() * scene.size());
+        state.setCounter("frustum", stats.frustumVisible);
+        state.setCounter("visible", stats.visible);
+        state.setCounter("nodes", stats.nodesVisited);
+        state.setCounter("mismatch", mismatch);
+        state.setCounter("mismatchThreads", visible != singleVisible ? 1.0 : 0.0);
+    }
+}
+
+BENCHMARK(CullBvhBuild)
+{
+    Scene scene(SmallScene);
+    Bvh   bvh;
+    while (state.keepRunning())
+        bvh.build(scene.bounds(), scene.size());
+    state.setItemsProcessed(state.getIterations() * scene.size());
+    state.setCounter("nodes", static_cast<double>(bvh.getNodes().size()));
+}
+
+// Every object moves a little, the topology stays
+BENCHMARK(CullBvhRefit)
+{
+    Scene scene(LargeScene);
+    Bvh   bvh;
+    bvh.build(scene.bounds(), scene.size());
+    float offset = 0.1f;
+    while (state.keepRunning())
+    {
+        for (auto& y : scene.center[1])
+            y += offset;
+        bvh.refit(scene.bounds());
+        offset = -offset;
+    }
+    state.setItemsProcessed(state.getIterations() * scene.size());
+}
+
+BENCHMARK(CullBruteForce)
+{
+    Scene                 scene(LargeScene);
+    auto                  frustum = Frustum::fromViewProjection(scene.viewProjection);
+    std::vector<uint32_t> visible;
+    while (state.keepRunning())
+    {
+        cullBruteForce(scene, frustum, visible);
+        Bench::doNotOptimize(visible.data());
+    }
+    state.setItemsProcessed(state.getIterations() * scene.size());
+    state.setCounter("frustum", static_cast<double>(visible.size()));
+}
+
+BENCHMARK(CullFrustum100k01) { runCulling(state, SmallScene, 1, false); }
+BENCHMARK(CullFrustum1M01)   { runCulling(state, LargeScene, 1, false); }
+BENCHMARK(CullFrustum1M04)   { runCulling(state, LargeScene, 4, false); }
+BENCHMARK(CullOcclusion1M01) { runCulling(state, LargeScene, 1, true); }
+BENCHMARK(CullOcclusion1M04) { runCulling(state, LargeScene, 4, true); }
@@ -0,0 +1,67 @@
+#include "Bench.hpp"
+#include "DescriptorAllocator.hpp"
+
+#include <vector>
+
+using namespace GalgameEngine;
+
+namespace
+{
+    // GPU is this many frames behind CPU
+    constexpr uint64_t FrameLatency = 2;
+
+    // Streaming-like churn, 100k live descriptors with 1000 replaced every frame
+    constexpr uint32_t LiveDescriptors = 100000;
+    constexpr uint32_t ChurnPerFrame   = 1000;
+}
+
+// Persistent allocate and deferred free, one allocate plus one free per item
+BENCHMARK(DescriptorPersistentChurn)
+{
+    DescriptorAllocator   allocator(262144, 0);
+    std::vector<uint32_t> live(LiveDescriptors);
+    for (auto& index : live)
+        index = allocator.allocate();
+
+    uint64_t frame = 0, churn = 0;
+    uint32_t cursor = 0;
+    while (state.keepRunning())
+    {
+        allocator.free(live[cursor]);
+        live[cursor] = allocator.allocate();
+        Bench::doNotOptimize(live[cursor]);
+        cursor = (cursor + 7919) % LiveDescriptors;
+
+        if (++churn % ChurnPerFrame == 0)
+        {
+            allocator.finishFrame(++frame);
+            allocator.reclaim(frame > FrameLatency ? frame - FrameLatency : 0);
+        }
+    }
+
+    auto stats = allocator.getStats();
+    state.setItemsProcessed(state.getIterations());
+    state.setCounter("peak", stats.persistentPeak);
+    state.setCounter("failures", static_cast<double>(stats.failures));
+}
+
+// Per draw descriptor tables of 8 from the transient region
+BENCHMARK(DescriptorTransientTables)
+{
+    constexpr uint32_t TablesPerFrame = 2048;
+
+    DescriptorAllocator allocator(1024, 65536);
+    uint64_t            frame = 0, table = 0;
+    while (state.keepRunning())
+    {
+        Bench::doNotOptimize(allocator.allocateTransient(8));
+        if (++table % TablesPerFrame == 0)
+        {
+            allocator.finishFrame(++frame);
+            allocator.reclaim(frame > FrameLatency ? frame - FrameLatency : 0);
+        }
+    }
+
+    state.setItemsProcessed(state.getIterations());
+    state.setCounter("failures", static_cast<double>(allocator.getStats().failures));
+}
@@ -0,0 +1,203 @@
+#include "Bench.hpp"
+#include "Renderer.hpp"
+#include "DrawQueue.hpp"
+#include "JobSystem.hpp"
+#include "NullDevice.hpp"
+#include "RadixSort.hpp"
+#include "TransformSystem.hpp"
+
+#include <vector>
+#include <random>
+#include <algorithm>
+
+using namespace GalgameEngine;
+
+namespace
+{
+    constexpr uint32_t SortItems     = 1000000;
+    constexpr uint32_t SceneEntities = 100000;
+    constexpr uint32_t SceneMeshes   = 16;
+    constexpr uint32_t Materials     = 8;
+
+    // Keys of a scene with 8 pipelines, 64 materials and 256 meshes at random depths
+    std::vector<SortItem> makeItems(uint32_t count)
+    {
+        std::mt19937          random(42);
+        std::vector<SortItem> items(count);
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            auto bits = random();
+            items[i]  = { DrawKey::make(0, bits % 8, (bits >> 3) % 64, (bits >> 9) % 256, static_cast<uint16_t>(random())), i };
+        }
+        return items;
+    }
+
+    void runRadixSort(Bench::State& state, uint32_t threadCount)
+    {
+        auto                  items = makeItems(SortItems);
+        std::vector<SortItem> sorted(items.size());
+        JobSystem             jobs(threadCount);
+        RadixSorter           sorter;
+        while (state.keepRunning())
+        {
+            sorted = items;
+            sorter.sort(sorted.data(), SortItems, threadCount > 1 ? &jobs : nullptr);
+            Bench::doNotOptimize(sorted.data());
+        }
+        state.setItemsProcessed(state.getIterations() * SortItems);
+        state.setCounter("passes", sorter.getStats().passes);
+    }
+
+    // Boxes one after another in one buffer, materials in another, two pipelines drawn by the scene pass
+    struct DrawScene
+    {
+        static constexpr uint32_t BoxVertices  = 24;
+        static constexpr uint32_t BoxIndices   = 36;
+        static constexpr uint32_t VertexStride = 20;
+
+        std::unique_ptr<Buffer> geometry;
+        std::unique_ptr<Buffer> materials;
+        PipelineId              pipelines[2] = { InvalidPipeline, InvalidPipeline };
+
+        DrawScene(Device& device, DrawQueue& queue, PipelineCache& pipelineCache, RootSignature& rootSignature)
+        {
+            uint32_t   vertexBytes = SceneMeshes * BoxVertices * VertexStride;
+            uint32_t   indexBytes  = SceneMeshes * BoxIndices * sizeof(uint16_t);
+            BufferDesc geometryDesc;
+            geometryDesc.size     = vertexBytes + indexBytes;
+            geometryDesc.heapType = HeapType::Upload;
+            geometry = device.createBuffer(geometryDesc, ResourceState::GenericRead);
+            for (uint32_t mesh = 0; mesh < SceneMeshes; ++mesh)
+            {
+                DrawMesh drawMesh;
+                drawMesh.vertices   = { geometry.get(), 0, vertexBytes, VertexStride };
+                drawMesh.indices    = { geometry.get(), vertexBytes, indexBytes, Format::R16_UINT };
+                drawMesh.indexCount = BoxIndices;
+                drawMesh.startIndex = mesh * BoxIndices;
+                drawMesh.baseVertex = static_cast<int32_t>(mesh * BoxVertices);
+                queue.addMesh(drawMesh);
+            }
+
+            BufferDesc materialDesc;
+            materialDesc.size     = Materials * UploadRing::ConstantAlignment;
+            materialDesc.heapType = HeapType::Upload;
+            materials = device.createBuffer(materialDesc, ResourceState::GenericRead);
+            for (uint32_t material = 0; material < Materials; ++material)
+                queue.addMaterial(materials->getGpuAddress() + material * UploadRing::ConstantAlignment);
+
+            GraphicsPipelineDesc pipelineDesc;
+            pipelineDesc.rootSignature = &rootSignature;
+            pipelineDesc.inputLayout   = { { "POSITION", 0, Format::R32G32B32_FLOAT, 0, 0 }, { "TEXCOORD", 0, Format::R32G32_FLOAT, 0, 12 },
+                                           DrawQueue::getInstanceElement() };
+            for (uint32_t variant = 0; variant < 2; ++variant)
+            {
+                pipelineDesc.vertexShader.assign(256, static_cast<uint8_t>(0xD0 + variant));
+                pipelineDesc.pixelShader.assign(512, static_cast<uint8_t>(0xD0 + variant));
+                pipelines[variant] = pipelineCache.requestPipeline(pipelineDesc);
+            }
+        }
+
+        uint64_t makeKey(uint32_t index, uint16_t depth) const noexcept
+        {
+            auto material = index % Materials;
+            return DrawKey::make(Renderer::ScenePass, pipelines[material % 2], material, index % SceneMeshes, depth);
+        }
+    };
+
+    // Every entity of a static scene submitted and drawn each frame on the null backend
+    void runSceneFrame(Bench::State& state, bool indirect)
+    {
+        NullDevice      device;
+        EntityStore     store;
+        TransformSystem transforms;
+        std::vector<Entity> entities(SceneEntities);
+        store.create(makeComponentMask<Position, Rotation, Scale, LocalToWorld>(), SceneEntities, entities.data());
+        for (uint32_t i = 0; i < SceneEntities; ++i)
+        {
+            store.get<Position>(entities[i])->value = { static_cast<float>(i % 1000), 0.f, static_cast<float>(i / 1000) };
+            store.get<Rotation>(entities[i])->value = Quat::fromAxisAngle({ 0.f, 1.f, 0.f }, static_cast<float>(i));
+            store.get<Scale>(entities[i])->value    = { 1.f, 1.f, 1.f };
+        }
+        transforms.update(store);
+
+        Renderer::Config config;
+        config.width              = 1280;
+        config.height             = 720;
+        config.drawQueue.indirect = indirect;
+        Renderer  renderer(device, config);
+        auto&     queue = renderer.getDrawQueue();
+        DrawScene scene(device, queue, renderer.getPipelineCache(), renderer.getSceneRootSignature());
+        renderer.setScene(&store);
+
+        EntityStore::Query query;
+        query.all = makeComponentMask<Position>();
+        auto submit = [&queue, &scene](EntityStore::ChunkView& chunk)
+        {
+            auto ids      = chunk.getEntities();
+            auto position = chunk.read<Position>();
+            for (uint32_t e = 0; e < chunk.getCount(); ++e)
+                queue.submit(0, scene.makeKey(ids[e].index, DrawKey::quantizeDepth(position[e].value.z / 1000.f)), ids[e].index);
+        };
+
+        uint64_t batches = 0;
+        uint64_t draws   = 0;
+        while (state.keepRunning())
+        {
+            store.forEachChunk(query, submit);
+            renderer.render();
+            batches += queue.getStats().batches;
+            draws   += renderer.getDrawStats().draws;
+        }
+        renderer.flush();
+
+        state.setItemsProcessed(state.getIterations() * SceneEntities);
+        state.setCounter("batches/frame", static_cast<double>(batches) / state.getIterations());
+        state.setCounter("draws/frame", static_cast<double>(draws) / state.getIterations());
+        state.setCounter("errors", static_cast<double>(device.getErrorCount()));
+    }
+}
+
+// Baseline for the radix sorts below, comparison sort of the same keys
+BENCHMARK(DrawSortStd1M)
+{
+    auto                  items = makeItems(SortItems);
+    std::vector<SortItem> sorted(items.size());
+    while (state.keepRunning())
+    {
+        sorted = items;
+        std::stable_sort(sorted.begin(), sorted.end(), [](const SortItem& a, const SortItem& b) { return a.key < b.key; });
+        Bench::doNotOptimize(sorted.data());
+    }
+    state.setItemsProcessed(state.getIterations() * SortItems);
+}
+
+BENCHMARK(DrawSortRadix1M01) { runRadixSort(state, 1); }
+BENCHMARK(DrawSortRadix1M04) { runRadixSort(state, 4); }
+
+// Submit, sort, batch and upload a million draws per frame, without recording
+BENCHMARK(DrawQueuePrepare1M)
+{
+    NullDevice    device;
+    auto&         queue = device.getQueue();
+    UploadRing    ring(device, 16 << 20);
+    PipelineCache pipelineCache(device, {});
+    DrawQueue     drawQueue(device, ring, pipelineCache, {});
+
+    auto items = makeItems(SortItems);
+    while (state.keepRunning())
+    {
+        for (auto& item : items)
+            drawQueue.submit(0, item.key, item.value);
+        drawQueue.prepare();
+
+        auto fenceValue = queue.signal();
+        ring.finishFrame(fenceValue);
+        queue.waitForValue(fenceValue);
+    }
+    state.setItemsProcessed(state.getIterations() * SortItems);
+    state.setCounter("batches", drawQueue.getStats().batches);
+    state.setCounter("passes", drawQueue.getStats().sortPasses);
+}
+
+BENCHMARK(DrawSceneFrameDirect)   { runSceneFrame(state, false); }
+BENCHMARK(DrawSceneFrameIndirect) { runSceneFrame(state, true); }
@@ -0,0 +1,186 @@
+#include "Bench.hpp"
+#include "Renderer.hpp"
+#include "JobSystem.hpp"
+#include "NullDevice.hpp"
+#include "TransformSystem.hpp"
+
+#include <vector>
+
+using namespace GalgameEngine;
+
+namespace
+{
+    constexpr uint32_t SceneEntities = 1000000;
+
+    // Entities with a full transform, matrices composed once
+    void createScene(EntityStore& store, TransformSystem& transforms, uint32_t count)
+    {
+        std::vector<Entity> entities(count);
+        store.create(makeComponentMask<Position, Rotation, Scale, LocalToWorld>(), count, entities.data());
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            store.get<Position>(entities[i])->value = { static_cast<float>(i % 1000), 0.f, static_cast<float>(i / 1000) };
+            store.get<Rotation>(entities[i])->value = Quat::fromAxisAngle({ 0.f, 1.f, 0.f }, static_cast<float>(i));
+            store.get<Scale>(entities[i])->value    = { 1.f, 1.f, 1.f };
+        }
+        transforms.update(store);
+    }
+
+    // Move every chunk whose first entity index is below moving
+    void moveEntities(EntityStore& store, uint32_t moving, float offset)
+    {
+        EntityStore::Query query;
+        query.all = makeComponentMask<Position>();
+        store.forEachChunk(query, [moving, offset](EntityStore::ChunkView& chunk)
+        {
+            if (chunk.getEntities()[0].index >= moving)
+                return;
+            auto position = chunk.write<Position>();
+            for (uint32_t i = 0; i < chunk.getCount(); ++i)
+                position[i].value.y += offset;
+        });
+    }
+
+    // One iteration reads every position of the scene, items/s is entities per second
+    void runIteration(Bench::State& state, uint32_t threadCount)
+    {
+        EntityStore     store;
+        TransformSystem transforms;
+        createScene(store, transforms, SceneEntities);
+
+        JobSystem jobs(threadCount);
+        EntityStore::Query query;
+        query.all = makeComponentMask<Position>();
+        std::vector<float> sums(store.getStats().chunks);
+        while (state.keepRunning())
+        {
+            auto sum = [&sums](EntityStore::ChunkView& chunk)
+            {
+                auto  position = chunk.read<Position>();
+                float total    = 0.f;
+                for (uint32_t i = 0; i < chunk.getCount(); ++i)
+                    total += position[i].value.y;
+                sums[chunk.getEntities()[0].index % sums.size()] = total;
+            };
+            if (threadCount > 1)
+                store.parallelForEachChunk(jobs, query, sum);
+            else
+                store.forEachChunk(query, sum);
+            Bench::doNotOptimize(sums.data());
+        }
+        state.setItemsProcessed(state.getIterations() * SceneEntities);
+        state.setCounter("chunks", store.getStats().chunks);
+    }
+
+    // A tenth of the scene moves, transforms are recomposed for the changed chunks only
+    void runTransformUpdate(Bench::State& state, uint32_t threadCount)
+    {
+        EntityStore     store;
+        TransformSystem transforms;
+        createScene(store, transforms, SceneEntities);
+
+        JobSystem jobs(threadCount);
+        uint64_t  updated = 0;
+        float     offset  = 1.f;
+        while (state.keepRunning())
+        {
+            moveEntities(store, SceneEntities / 10, offset);
+            transforms.update(store, threadCount > 1 ? &jobs : nullptr);
+            updated += transforms.getStats().entities;
+            offset   = -offset;
+        }
+        state.setItemsProcessed(updated);
+        state.setCounter("entities/frame", static_cast<double>(updated) / state.getIterations());
+    }
+}
+
+BENCHMARK(EcsCreateEntities)
+{
+    while (state.keepRunning())
+    {
+        EntityStore         store;
+        std::vector<Entity> entities(SceneEntities);
+        store.create(makeComponentMask<Position, Rotation, Scale, LocalToWorld>(), SceneEntities, entities.data());
+        Bench::doNotOptimize(entities.data());
+    }
+    state.setItemsProcessed(state.getIterations() * SceneEntities);
+}
+
+BENCHMARK(EcsIterate01) { runIteration(state, 1); }
+BENCHMARK(EcsIterate04) { runIteration(state, 4); }
+
+BENCHMARK(EcsTransformUpdate01) { runTransformUpdate(state, 1); }
+BENCHMARK(EcsTransformUpdate04) { runTransformUpdate(state, 4); }
+
+// Nothing moves, the update only checks chunk versions
+BENCHMARK(EcsTransformStatic)
+{
+    EntityStore     store;
+    TransformSystem transforms;
+    createScene(store, transforms, SceneEntities);
+    while (state.keepRunning())
+        transforms.update(store);
+    state.setItemsProcessed(state.getIterations() * SceneEntities);
+    state.setCounter("entities/frame", static_cast<double>(transforms.getStats().entities));
+}
+
+// Add and remove a component on a thousand entities, each moves between archetypes twice
+BENCHMARK(EcsStructuralChurn)
+{
+    constexpr uint32_t Churn = 1000;
+
+    struct Selected
+    {
+        uint32_t tag;
+    };
+
+    EntityStore         store;
+    std::vector<Entity> entities(100000);
+    store.create(makeComponentMask<Position, Rotation, Scale, LocalToWorld>(), 100000, entities.data());
+    uint32_t next = 0;
+    while (state.keepRunning())
+    {
+        for (uint32_t i = 0; i < Churn; ++i)
+            store.add(entities[(next + i * 97) % entities.size()], Selected{ i });
+        for (uint32_t i = 0; i < Churn; ++i)
+            store.remove<Selected>(entities[(next + i * 97) % entities.size()]);
+        next += 13;
+    }
+    state.setItemsProcessed(state.getIterations() * Churn * 2);
+    state.setCounter("archetypes", store.getStats().archetypes);
+}
+
+// Frames on the null backend with a tenth of the scene moving, matrices uploaded as instance data
+BENCHMARK(EcsSceneFrame)
+{
+    NullDevice      device;
+    EntityStore     store;
+    TransformSystem transforms;
+    createScene(store, transforms, SceneEntities);
+
+    Renderer::Config config;
+    config.width  = 1280;
+    config.height = 720;
+    Renderer renderer(device, config);
+    renderer.setScene(&store);
+    renderer.render();
+
+    uint64_t uploaded = 0;
+    uint64_t copies   = 0;
+    float    offset   = 1.f;
+    while (state.keepRunning())
+    {
+        moveEntities(store, SceneEntities / 10, offset);
+        transforms.update(store);
+        renderer.render();
+        uploaded += renderer.getInstanceUploader().getStats().instances;
+        copies   += renderer.getInstanceUploader().getStats().copies;
+        offset    = -offset;
+    }
+    renderer.flush();
+
+    state.setItemsProcessed(state.getIterations());
+    state.setCounter("instances/frame", static_cast<double>(uploaded) / state.getIterations());
+    state.setCounter("copies/frame", static_cast<double>(copies) / state.getIterations());
+    state.setCounter("errors", static_cast<double>(device.getErrorCount()));
+}
@@ -0,0 +1,107 @@
+#include "Bench.hpp"
+#include "Renderer.hpp"
+#include "NullDevice.hpp"
+
+#include <memory>
+
+using namespace GalgameEngine;
+
+namespace
+{
+    constexpr uint32_t RecordDraws = 1000;
+
+    // Vertex and index buffer, one pipeline and its root signature, what a draw needs bound on the null backend
+    struct DrawState
+    {
+        std::unique_ptr<Buffer>           buffer;
+        std::unique_ptr<RootSignature>    rootSignature;
+        std::unique_ptr<PipelineState>    pipeline;
+        std::unique_ptr<CommandAllocator> allocator;
+        std::unique_ptr<CommandList>      list;
+
+        explicit DrawState(Device& device)
+        {
+            BufferDesc bufferDesc;
+            bufferDesc.size     = 64 << 10;
+            bufferDesc.heapType = HeapType::Upload;
+            buffer = device.createBuffer(bufferDesc, ResourceState::GenericRead);
+
+            RootSignatureDesc rootDesc;
+            rootDesc.parameters.push_back({ RootParameterType::ConstantBuffer });
+            rootSignature = device.createRootSignature(rootDesc);
+
+            GraphicsPipelineDesc pipelineDesc;
+            pipelineDesc.rootSignature     = rootSignature.get();
+            pipelineDesc.inputLayout       = { { "POSITION", 0, Format::R32G32B32_FLOAT, 0, 0 } };
+            pipelineDesc.renderTargetCount = 0;
+            pipelineDesc.depthTest         = false;
+            pipelineDesc.depthWrite        = false;
+            pipelineDesc.vertexShader.assign(256, 0xF0);
+            pipelineDesc.pixelShader.assign(512, 0xF0);
+            pipeline = device.createGraphicsPipeline(pipelineDesc, nullptr);
+
+            allocator = device.createCommandAllocator();
+            list      = device.createCommandList();
+        }
+    };
+}
+
+// Whole frame of the default renderer on the main thread, the loop every other frame bench adds work to
+BENCHMARK(FrameLoopNull)
+{
+    NullDevice device;
+    {
+        Renderer::Config config;
+        config.width  = 1280;
+        config.height = 720;
+        Renderer renderer(device, config);
+        while (state.keepRunning())
+            renderer.render();
+        renderer.flush();
+    }
+    state.setItemsProcessed(state.getIterations());
+    state.setCounter("errors", static_cast<double>(device.getErrorCount()));
+}
+
+// Backend cost per draw, a list of draws with their bindings recorded, executed and waited for
+BENCHMARK(CommandRecordDraws1k)
+{
+    NullDevice device;
+    auto&      queue = device.getQueue();
+    DrawState  draw(device);
+
+    VertexBufferView vertices = { draw.buffer.get(), 0, 32 << 10, 12 };
+    IndexBufferView  indices  = { draw.buffer.get(), 32 << 10, 32 << 10, Format::R16_UINT };
+    while (state.keepRunning())
+    {
+        draw.allocator->reset();
+        auto& list = *draw.list;
+        list.reset(*draw.allocator);
+        list.setGraphicsRootSignature(*draw.rootSignature);
+        list.setPipelineState(*draw.pipeline);
+        for (uint32_t i = 0; i < RecordDraws; ++i)
+        {
+            list.setGraphicsRootConstantBufferView(0, draw.buffer->getGpuAddress() + (i % 64) * 256);
+            list.setVertexBuffers(0, &vertices, 1);
+            list.setIndexBuffer(indices);
+            list.drawIndexedInstanced(36, 1, 0, 0, 0);
+        }
+        list.close();
+
+        CommandList* lists[] = { &list };
+        queue.executeCommandLists(lists, 1);
+        queue.flush();
+    }
+    state.setItemsProcessed(state.getIterations() * RecordDraws);
+    state.setCounter("errors", static_cast<double>(device.getErrorCount()));
+}
+
+// Fence round trip of an empty submission, the floor of every CPU wait on GPU
+BENCHMARK(QueueSignalWait)
+{
+    NullDevice device;
+    auto&      queue = device.getQueue();
+    while (state.keepRunning())
+        queue.waitForValue(queue.signal());
+    state.setItemsProcessed(state.getIterations());
+}
@@ -0,0 +1,61 @@
+#include "Bench.hpp"
+#include "FramePacer.hpp"
+
+#include <random>
+
+using namespace GalgameEngine;
+
+namespace
+{
+    void reportPacing(Bench::State& state, const FramePacer& pacer, double elapsedSeconds)
+    {
+        auto& stats = pacer.getStats();
+        state.setItemsProcessed(state.getIterations());
+        state.setCounter("meanErrorUs", stats.totalError * 1e6 / stats.frames);
+        state.setCounter("maxErrorUs", stats.maxError * 1e6);
+        state.setCounter("late", static_cast<double>(stats.lateFrames));
+        state.setCounter("spin%", 100.0 * stats.spinSeconds / elapsedSeconds);
+        state.setCounter("sleepEstimateUs", stats.sleepEstimate * 1e6);
+    }
+
+    // 60 fps with 2 ~ 12ms of work per frame on a simulated OS timer
+    void runSimulated(Bench::State& state, double timerPeriod)
+    {
+        SimulatedFrameClock::Config clockConfig;
+        clockConfig.timerPeriod = timerPeriod;
+        SimulatedFrameClock clock(clockConfig);
+
+        FramePacer::Config config;
+        config.targetFps = 60.0;
+        FramePacer pacer(clock, config);
+
+        std::mt19937 random(11);
+        std::uniform_real_distribution<double> work(0.002, 0.012);
+        while (state.keepRunning())
+        {
+            pacer.waitForNextFrame();
+            clock.advance(work(random));
+        }
+        reportPacing(state, pacer, clock.now() * clock.getSecondsPerCount());
+    }
+}
+
+// Linux-like 1ms timer, almost all of the wait is slept
+BENCHMARK(FramePacerSimulated1msTimer)    { runSimulated(state, 0.001); }
+// Default Windows timer, the estimator learns to spin the last tick
+BENCHMARK(FramePacerSimulated15msTimer)   { runSimulated(state, 0.0156); }
+
+// Real clock of this machine at 1000 fps, no work between frames
+BENCHMARK(FramePacerSystem1kHz)
+{
+    SystemFrameClock clock;
+
+    FramePacer::Config config;
+    config.targetFps = 1000.0;
+    FramePacer pacer(clock, config);
+
+    auto begin = clock.now();
+    while (state.keepRunning())
+        pacer.waitForNextFrame();
+    reportPacing(state, pacer, (clock.now() - begin) * clock.getSecondsPerCount());
+}
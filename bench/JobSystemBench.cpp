@@ -0,0 +1,86 @@
+#include "Bench.hpp"
+#include "Renderer.hpp"
+#include "JobSystem.hpp"
+#include "NullDevice.hpp"
+
+#include <cmath>
+
+using namespace GalgameEngine;
+
+namespace
+{
+    // Batch of independent jobs, each a few microseconds of arithmetic like recording a chunk of draws
+    constexpr uint32_t BatchJobs  = 256;
+    constexpr uint32_t WorkPerJob = 2000;
+
+    float work(uint32_t seed) noexcept
+    {
+        float value = static_cast<float>(seed);
+        for (uint32_t i = 0; i < WorkPerJob; ++i)
+            value = std::sqrt(value * 1.0001f + 1.f);
+        return value;
+    }
+
+    // One iteration is one batch, items/s is jobs per second across all threads
+    void runScaling(Bench::State& state, uint32_t threadCount)
+    {
+        JobSystem jobs(threadCount);
+        float     results[BatchJobs];
+        auto      body = [&results](uint32_t begin, uint32_t) { results[begin] = work(begin); };
+        while (state.keepRunning())
+        {
+            JobCounter counter;
+            jobs.parallelFor(counter, BatchJobs, 1, body);
+            jobs.wait(counter);
+            Bench::doNotOptimize(results);
+        }
+
+        auto stats = jobs.getStats();
+        state.setItemsProcessed(state.getIterations() * BatchJobs);
+        state.setCounter("stolen%", 100.0 * stats.stolen / (stats.executed + 1));
+    }
+
+    // Frame recording on the null backend, one command list per thread
+    void runRecording(Bench::State& state, uint32_t threadCount)
+    {
+        NullDevice device;
+        JobSystem  jobs(threadCount);
+
+        Renderer::Config config;
+        config.width     = 1280;
+        config.height    = 720;
+        config.jobSystem = &jobs;
+        Renderer renderer(device, config);
+        while (state.keepRunning())
+            renderer.render();
+        renderer.flush();
+
+        state.setItemsProcessed(state.getIterations());
+        state.setCounter("errors", static_cast<double>(device.getErrorCount()));
+    }
+}
+
+// Scheduling cost alone, empty jobs scheduled and run on one thread
+BENCHMARK(JobScheduleEmpty)
+{
+    JobSystem jobs(1);
+    while (state.keepRunning())
+    {
+        JobCounter counter;
+        jobs.schedule(counter, []() {});
+        jobs.wait(counter);
+    }
+    state.setItemsProcessed(state.getIterations());
+}
+
+// Scaling from 1 to 32 threads, threads beyond hardware threads only show oversubscription cost
+BENCHMARK(JobScaling01) { runScaling(state, 1); }
+BENCHMARK(JobScaling02) { runScaling(state, 2); }
+BENCHMARK(JobScaling04) { runScaling(state, 4); }
+BENCHMARK(JobScaling08) { runScaling(state, 8); }
+BENCHMARK(JobScaling16) { runScaling(state, 16); }
+BENCHMARK(JobScaling32) { runScaling(state, 32); }
+
+BENCHMARK(JobRecordFrame01) { runRecording(state, 1); }
+BENCHMARK(JobRecordFrame04) { runRecording(state, 4); }
+BENCHMARK(JobRecordFrame16) { runRecording(state, 16); }
@@ -0,0 +1,321 @@
+#include "Bench.hpp"
+#include "MathBatch.hpp"
+
+#include <cmath>
+#include <vector>
+#include <random>
+#include <cstring>
+#include <algorithm>
+
+using namespace GalgameEngine;
+
+namespace
+{
+    constexpr size_t ObjectCount = 4096;
+    constexpr size_t PointCount  = 65536;
+
+    // Random transforms and boxes, streams and the same data as plain structs for the scalar baselines
+    struct Scene
+    {
+        std::vector<float> position[3];
+        std::vector<float> rotation[4];
+        std::vector<float> scale[3];
+        std::vector<float> center[3];
+        std::vector<float> extent[3];
+        std::vector<float> outCenter[3];
+        std::vector<float> outExtent[3];
+        std::vector<Mat4>  locals;
+        std::vector<Mat4>  parents;
+        std::vector<Mat4>  out;
+
+        explicit Scene(size_t count)
+        {
+            std::mt19937                          random(7);
+            std::uniform_real_distribution<float> unit(-1.f, 1.f);
+            for (size_t i = 0; i < count; ++i)
+            {
+                auto q = normalize(Quat{ unit(random), unit(random), unit(random), unit(random) });
+                float r[4] = { q.x, q.y, q.z, q.w };
+                for (int c = 0; c < 3; ++c)
+                {
+                    position[c].push_back(unit(random) * 100.f);
+                    scale[c].push_back(1.5f + unit(random));
+                    center[c].push_back(unit(random));
+                    extent[c].push_back(1.f + unit(random) * 0.5f);
+                }
+                for (int c = 0; c < 4; ++c)
+                    rotation[c].push_back(r[c]);
+                locals.push_back(Mat4::fromTransform({ position[0][i], position[1][i], position[2][i] }, q, { scale[0][i], scale[1][i], scale[2][i] }));
+                parents.push_back(Mat4::fromTransform({ unit(random), unit(random), unit(random) }, q, { 1.f, 1.f, 1.f }));
+            }
+            for (int c = 0; c < 3; ++c)
+            {
+                outCenter[c].resize(count);
+                outExtent[c].resize(count);
+            }
+            out.resize(count);
+        }
+
+        TransformStreams transforms() const
+        {
+            return { { position[0].data(), position[1].data(), position[2].data() },
+                     { rotation[0].data(), rotation[1].data(), rotation[2].data(), rotation[3].data() },
+                     { scale[0].data(), scale[1].data(), scale[2].data() } };
+        }
+
+        BoundsStreams localBounds()
+        {
+            return { { center[0].data(), center[1].data(), center[2].data() }, { extent[0].data(), extent[1].data(), extent[2].data() } };
+        }
+
+        BoundsStreams worldBounds()
+        {
+            return { { outCenter[0].data(), outCenter[1].data(), outCenter[2].data() }, { outExtent[0].data(), outExtent[1].data(), outExtent[2].data() } };
+        }
+    };
+
+    // Plain scalar code, what the kernels replace
+    struct ScalarTransform
+    {
+        float position[3];
+        float rotation[4];
+        float scale[3];
+    };
+
+    struct ScalarMatrix
+    {
+        float m[4][4];
+    };
+
+    void composeScalar(const ScalarTransform& t, ScalarMatrix& out)
+    {
+        float x = t.rotation[0], y = t.rotation[1], z = t.rotation[2], w = t.rotation[3];
+        float rows[3][3] = { { 1 - 2 * (y * y + z * z), 2 * (x * y + w * z), 2 * (x * z - w * y) },
+                             { 2 * (x * y - w * z), 1 - 2 * (x * x + z * z), 2 * (y * z + w * x) },
+                             { 2 * (x * z + w * y), 2 * (y * z - w * x), 1 - 2 * (x * x + y * y) } };
+        for (int r = 0; r < 3; ++r)
+        {
+            for (int c = 0; c < 3; ++c)
+                out.m[r][c] = rows[r][c] * t.scale[r];
+            out.m[r][3] = 0.f;
+        }
+        for (int c = 0; c < 3; ++c)
+            out.m[3][c] = t.position[c];
+        out.m[3][3] = 1.f;
+    }
+
+    void multiplyScalar(const ScalarMatrix& a, const ScalarMatrix& b, ScalarMatrix& out)
+    {
+        for (int r = 0; r < 4; ++r)
+        {
+            for (int c = 0; c < 4; ++c)
+            {
+                float sum = 0.f;
+                for (int k = 0; k < 4; ++k)
+                    sum += a.m[r][k] * b.m[k][c];
+                out.m[r][c] = sum;
+            }
+        }
+    }
+
+    // Eight corners through the matrix, then min / max
+    void transformBoundsScalar(const ScalarMatrix& m, const float center[3], const float extent[3], float outMin[3], float outMax[3])
+    {
+        for (int c = 0; c < 3; ++c)
+        {
+            outMin[c] = INFINITY;
+            outMax[c] = -INFINITY;
+        }
+        for (int corner = 0; corner < 8; ++corner)
+        {
+            float p[3];
+            for (int c = 0; c < 3; ++c)
+                p[c] = center[c] + (corner & (1 << c) ? extent[c] : -extent[c]);
+            for (int c = 0; c < 3; ++c)
+            {
+                float v = p[0] * m.m[0][c] + p[1] * m.m[1][c] + p[2] * m.m[2][c] + m.m[3][c];
+                outMin[c] = v < outMin[c] ? v : outMin[c];
+                outMax[c] = v > outMax[c] ? v : outMax[c];
+            }
+        }
+    }
+
+    std::vector<ScalarTransform> toScalarTransforms(const Scene& scene)
+    {
+        std::vector<ScalarTransform> transforms(scene.locals.size());
+        for (size_t i = 0; i < transforms.size(); ++i)
+        {
+            for (int c = 0; c < 3; ++c)
+            {
+                transforms[i].position[c] = scene.position[c][i];
+                transforms[i].scale[c]    = scene.scale[c][i];
+            }
+            for (int c = 0; c < 4; ++c)
+                transforms[i].rotation[c] = scene.rotation[c][i];
+        }
+        return transforms;
+    }
+
+    std::vector<ScalarMatrix> toScalarMatrices(const std::vector<Mat4>& matrices)
+    {
+        std::vector<ScalarMatrix> result(matrices.size());
+        for (size_t i = 0; i < matrices.size(); ++i)
+            std::memcpy(result[i].m, &matrices[i], sizeof(Mat4));
+        return result;
+    }
+
+    void setCommonCounters(Bench::State& state, size_t count)
+    {
+        state.setItemsProcessed(state.getIterations() * count);
+        state.setCounter("width", Simd::Width);
+    }
+}
+
+BENCHMARK(ComposeTransformsScalar)
+{
+    Scene scene(ObjectCount);
+    auto  transforms = toScalarTransforms(scene);
+    std::vector<ScalarMatrix> out(ObjectCount);
+    while (state.keepRunning())
+    {
+        for (size_t i = 0; i < ObjectCount; ++i)
+            composeScalar(transforms[i], out[i]);
+        Bench::doNotOptimize(out.data());
+    }
+    setCommonCounters(state, ObjectCount);
+}
+
+BENCHMARK(ComposeTransformsSimd)
+{
+    Scene scene(ObjectCount);
+    auto  streams = scene.transforms();
+    while (state.keepRunning())
+    {
+        MathBatch::composeTransforms(streams, scene.out.data(), ObjectCount);
+        Bench::doNotOptimize(scene.out.data());
+    }
+    setCommonCounters(state, ObjectCount);
+
+    // Against the scalar composition of the same transforms
+    auto  transforms = toScalarTransforms(scene);
+    float maxError   = 0.f;
+    for (size_t i = 0; i < ObjectCount; ++i)
+    {
+        ScalarMatrix expected;
+        composeScalar(transforms[i], expected);
+        auto actual = &scene.out[i].rows[0].x;
+        for (int e = 0; e < 16; ++e)
+            maxError = std::max(maxError, std::fabs(actual[e] - (&expected.m[0][0])[e]));
+    }
+    state.setCounter("maxError", maxError);
+}
+
+BENCHMARK(MultiplyMatricesScalar)
+{
+    Scene scene(ObjectCount);
+    auto  locals  = toScalarMatrices(scene.locals);
+    auto  parents = toScalarMatrices(scene.parents);
+    std::vector<ScalarMatrix> out(ObjectCount);
+    while (state.keepRunning())
+    {
+        for (size_t i = 0; i < ObjectCount; ++i)
+            multiplyScalar(locals[i], parents[i], out[i]);
+        Bench::doNotOptimize(out.data());
+    }
+    setCommonCounters(state, ObjectCount);
+}
+
+BENCHMARK(MultiplyMatricesSimd)
+{
+    Scene scene(ObjectCount);
+    while (state.keepRunning())
+    {
+        MathBatch::multiplyMatrices(scene.locals.data(), scene.parents.data(), scene.out.data(), ObjectCount);
+        Bench::doNotOptimize(scene.out.data());
+    }
+    setCommonCounters(state, ObjectCount);
+}
+
+BENCHMARK(TransformBoundsScalar)
+{
+    Scene scene(ObjectCount);
+    auto  matrices = toScalarMatrices(scene.locals);
+    std::vector<float> outMin(ObjectCount * 3);
+    std::vector<float> outMax(ObjectCount * 3);
+    while (state.keepRunning())
+    {
+        for (size_t i = 0; i < ObjectCount; ++i)
+        {
+            float center[3] = { scene.center[0][i], scene.center[1][i], scene.center[2][i] };
+            float extent[3] = { scene.extent[0][i], scene.extent[1][i], scene.extent[2][i] };
+            transformBoundsScalar(matrices[i], center, extent, &outMin[i * 3], &outMax[i * 3]);
+        }
+        Bench::doNotOptimize(outMin.data());
+    }
+    setCommonCounters(state, ObjectCount);
+}
+
+BENCHMARK(TransformBoundsSimd)
+{
+    Scene scene(ObjectCount);
+    auto  local = scene.localBounds();
+    auto  world = scene.worldBounds();
+    while (state.keepRunning())
+    {
+        MathBatch::transformBounds(scene.locals.data(), local, world, ObjectCount);
+        Bench::doNotOptimize(scene.outCenter[0].data());
+    }
+    setCommonCounters(state, ObjectCount);
+
+    // Center and extent give the same box as the eight corners
+    auto  matrices = toScalarMatrices(scene.locals);
+    float maxError = 0.f;
+    for (size_t i = 0; i < ObjectCount; ++i)
+    {
+        float center[3] = { scene.center[0][i], scene.center[1][i], scene.center[2][i] };
+        float extent[3] = { scene.extent[0][i], scene.extent[1][i], scene.extent[2][i] };
+        float boxMin[3], boxMax[3];
+        transformBoundsScalar(matrices[i], center, extent, boxMin, boxMax);
+        for (int c = 0; c < 3; ++c)
+        {
+            maxError = std::max(maxError, std::fabs(scene.outCenter[c][i] - scene.outExtent[c][i] - boxMin[c]));
+            maxError = std::max(maxError, std::fabs(scene.outCenter[c][i] + scene.outExtent[c][i] - boxMax[c]));
+        }
+    }
+    state.setCounter("maxError", maxError);
+}
+
+BENCHMARK(TransformPointsScalar)
+{
+    Scene scene(PointCount);
+    auto  m = toScalarMatrices({ scene.locals[0] })[0];
+    std::vector<float> points(PointCount * 3);
+    for (size_t i = 0; i < PointCount; ++i)
+        for (int c = 0; c < 3; ++c)
+            points[i * 3 + c] = scene.position[c][i];
+    std::vector<float> out(PointCount * 3);
+    while (state.keepRunning())
+    {
+        for (size_t i = 0; i < PointCount; ++i)
+        {
+            auto p = &points[i * 3];
+            for (int c = 0; c < 3; ++c)
+                out[i * 3 + c] = p[0] * m.m[0][c] + p[1] * m.m[1][c] + p[2] * m.m[2][c] + m.m[3][c];
+        }
+        Bench::doNotOptimize(out.data());
+    }
+    setCommonCounters(state, PointCount);
+}
+
+BENCHMARK(TransformPointsSimd)
+{
+    Scene        scene(PointCount);
+    PointStreams in  = { { scene.position[0].data(), scene.position[1].data(), scene.position[2].data() } };
+    PointStreams out = { { scene.outCenter[0].data(), scene.outCenter[1].data(), scene.outCenter[2].data() } };
+    while (state.keepRunning())
+    {
+        MathBatch::transformPoints(scene.locals[0], in, out, PointCount);
+        Bench::doNotOptimize(scene.outCenter[0].data());
+    }
+    setCommonCounters(state, PointCount);
+}
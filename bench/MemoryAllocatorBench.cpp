@@ -0,0 +1,139 @@
+#include "Bench.hpp"
+#include "NullDevice.hpp"
+#include "TlsfAllocator.hpp"
+#include "MemoryAllocator.hpp"
+
+#include <random>
+#include <vector>
+
+using namespace GalgameEngine;
+
+namespace
+{
+    // Mix of texture-like sizes, mostly small with a tail of large ones, in 64KB pages
+    uint64_t randomSize(std::mt19937& random)
+    {
+        constexpr uint64_t Page = 64 * 1024;
+        auto roll = random() % 100;
+        if (roll < 70)
+            return Page * (1 + random() % 4);
+        if (roll < 95)
+            return Page * (4 + random() % 60);
+        return Page * (64 + random() % 192);
+    }
+
+    // Steady state churn, a random live allocation is freed for every new one
+    void runTlsfChurn(Bench::State& state, bool validate)
+    {
+        constexpr uint32_t LiveCount = 512;
+
+        TlsfAllocator                          allocator(1ull << 30, 64 * 1024);
+        std::vector<TlsfAllocator::Allocation> live;
+        std::mt19937                           random(42);
+        for (uint32_t i = 0; i < LiveCount; ++i)
+            live.push_back(allocator.allocate(randomSize(random), 64 * 1024));
+
+        uint64_t failures = 0, errors = 0;
+        while (state.keepRunning())
+        {
+            auto& slot = live[random() % LiveCount];
+            if (slot.isValid())
+                allocator.free(slot);
+            slot = allocator.allocate(randomSize(random), random() % 8 == 0 ? 4ull << 20 : 64 * 1024);
+            if (!slot.isValid())
+                ++failures;
+
+            // Fuzzing mode walks every block after each operation
+            if (validate && !allocator.validate())
+                ++errors;
+        }
+
+        auto stats = allocator.getStats();
+        state.setItemsProcessed(state.getIterations());
+        state.setCounter("used%", 100.0 * stats.usedBytes / stats.capacity);
+        state.setCounter("freeBlocks", stats.freeBlocks);
+        state.setCounter("fragmentation", allocator.getFragmentation());
+        state.setCounter("failures", static_cast<double>(failures));
+        if (validate)
+            state.setCounter("errors", static_cast<double>(errors));
+    }
+
+    // Textures created and destroyed through the device, every one placed by the memory allocator
+    void runTextureChurn(Bench::State& state, bool mixedHeaps)
+    {
+        constexpr uint32_t LiveCount = 256;
+
+        NullDevice::Config config;
+        config.mixedHeaps = mixedHeaps;
+        NullDevice device(config);
+
+        std::vector<std::unique_ptr<Texture>> live(LiveCount);
+        std::mt19937                          random(7);
+        while (state.keepRunning())
+        {
+            TextureDesc desc = {};
+            desc.width  = 64u << (random() % 5);
+            desc.height = 64u << (random() % 5);
+            desc.format = Format::R8G8B8A8_UNORM;
+            desc.usage  = random() % 4 == 0 ? TextureUsage::RenderTarget : TextureUsage::ShaderResource;
+            live[random() % LiveCount] = device.createTexture(desc, ResourceState::Common);
+        }
+
+        auto stats = device.getMemoryAllocator().getStats();
+        state.setItemsProcessed(state.getIterations());
+        state.setCounter("heaps", stats.blocks + stats.dedicatedHeaps);
+        state.setCounter("createdHeaps", static_cast<double>(stats.createdHeaps));
+        state.setCounter("used%", 100.0 * stats.usedBytes / stats.heapBytes);
+        state.setCounter("errors", static_cast<double>(device.getErrorCount()));
+        live.clear();
+    }
+}
+
+BENCHMARK(TlsfChurn)         { runTlsfChurn(state, false); }
+BENCHMARK(TlsfChurnValidate) { runTlsfChurn(state, true); }
+
+// Heap tier 1 splits render targets and other textures into separate pools, tier 2 shares them
+BENCHMARK(MemoryAllocatorTexturesTier1) { runTextureChurn(state, false); }
+BENCHMARK(MemoryAllocatorTexturesTier2) { runTextureChurn(state, true); }
+
+// Free most of several blocks at random, then plan moves emptying the sparsest one
+BENCHMARK(MemoryAllocatorDefragmentPlan)
+{
+    NullDevice      device;
+    MemoryAllocator allocator(device, {});
+    std::mt19937    random(3);
+
+    std::vector<MemoryAllocation>      live;
+    std::vector<MemoryAllocator::Move> moves;
+    uint64_t movedBytes = 0, plans = 0;
+    while (state.keepRunning())
+    {
+        for (uint32_t i = 0; i < 2048; ++i)
+            live.push_back(allocator.allocate(HeapType::Default, HeapUsage::Textures, { randomSize(random), 64 * 1024 }));
+        for (auto& allocation : live)
+        {
+            if (random() % 4 != 0)
+            {
+                allocator.free(allocation);
+                allocation = {};
+            }
+        }
+
+        moves.clear();
+        allocator.planDefragmentation(moves, 64ull << 20);
+        ++plans;
+        for (auto& move : moves)
+        {
+            movedBytes += move.source.size;
+            allocator.free(move.destination);
+        }
+
+        for (auto& allocation : live)
+            allocator.free(allocation);
+        live.clear();
+    }
+
+    state.setItemsProcessed(state.getIterations());
+    state.setCounter("movedMB/plan", movedBytes / 1048576.0 / plans);
+    state.setCounter("errors", static_cast<double>(device.getErrorCount()));
+}
@@ -0,0 +1,179 @@
+#include "Bench.hpp"
+#include "MeshFile.hpp"
+#include "MeshWriter.hpp"
+#include "NullDevice.hpp"
+
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <algorithm>
+#include <filesystem>
+
+#ifdef __linux__
+    #include <unistd.h>
+#endif
+
+using namespace GalgameEngine;
+
+namespace
+{
+    constexpr uint32_t MeshCount    = 32;
+    constexpr uint32_t VertexCount  = 1 << 18;      // 32 byte vertices, 8MB + 6MB of indices per mesh
+    constexpr uint32_t VertexStride = 32;
+
+    /*
+    * 448MB file of 32 meshes, written once and removed at exit
+    * All meshes reference the same source data, so writing it does not need the whole file in memory
+    * Loads run on a warm page cache, they measure mapping and copying and not the disk
+    */
+    struct TestFile
+    {
+        std::string path;
+        uint64_t    size = 0;
+
+        TestFile()
+        {
+            path = (std::filesystem::temp_directory_path() / "dx12_bench.gmesh").string();
+
+            std::vector<float>    vertices(static_cast<size_t>(VertexCount) * VertexStride / sizeof(float), 1.0f);
+            std::vector<uint32_t> indices(VertexCount * 6);
+            for (size_t i = 0; i < indices.size(); ++i)
+                indices[i] = static_cast<uint32_t>(i % VertexCount);
+
+            MeshWriter writer;
+            for (uint32_t i = 0; i < MeshCount; ++i)
+            {
+                MeshWriter::Mesh mesh;
+                mesh.name         = "mesh" + std::to_string(i);
+                mesh.attributes   = { { MeshFormat::Semantic::Position, Format::R32G32B32_FLOAT, 0 },
+                                      { MeshFormat::Semantic::Normal,   Format::R32G32B32_FLOAT, 12 },
+                                      { MeshFormat::Semantic::Texcoord, Format::R32G32_FLOAT,    24 } };
+                mesh.vertexStride = VertexStride;
+                mesh.vertexCount  = VertexCount;
+                mesh.vertices     = vertices.data();
+                mesh.indexCount   = static_cast<uint32_t>(indices.size());
+                mesh.indices      = indices.data();
+
+                MeshWriter::Node node;
+                node.mesh = writer.addMesh(mesh);
+                writer.addNode(node);
+            }
+            writer.write(path);
+            size = writer.getFileSize();
+        }
+
+        ~TestFile() { std::filesystem::remove(path); }
+    };
+
+    const TestFile& getTestFile()
+    {
+        static TestFile s_file;
+        return s_file;
+    }
+
+    // Resident memory of the process, 0 where it is not known
+    double getResidentMB()
+    {
+#ifdef __linux__
+        long pages = 0;
+        if (auto file = std::fopen("/proc/self/statm", "r"))
+        {
+            if (std::fscanf(file, "%*s %ld", &pages) != 1)
+                pages = 0;
+            std::fclose(file);
+        }
+        return pages * static_cast<double>(sysconf(_SC_PAGESIZE)) / 1048576.0;
+#else
+        return 0.0;
+#endif
+    }
+
+    void reportLoad(Bench::State& state, uint64_t bytes, double residentMB)
+    {
+        state.setItemsProcessed(state.getIterations());
+        state.setCounter("msPerGB", state.getSeconds() * 1000.0 / (state.getIterations() * (bytes / 1073741824.0)));
+        state.setCounter("fileMB", bytes / 1048576.0);
+        state.setCounter("peakRssDeltaMB", residentMB);
+    }
+}
+
+// Map and validate only, cost does not depend on the geometry size
+BENCHMARK(MeshFileOpen)
+{
+    auto& file = getTestFile();
+    while (state.keepRunning())
+    {
+        MeshFile mesh;
+        mesh.open(file.path);
+        Bench::doNotOptimize(mesh.getMeshCount());
+    }
+    state.setItemsProcessed(state.getIterations());
+}
+
+// Read every geometry page from the mapping once
+BENCHMARK(MeshFileTouchPages)
+{
+    auto&  file       = getTestFile();
+    double residentMB = 0.0;
+    while (state.keepRunning())
+    {
+        double   before = getResidentMB();
+        MeshFile mesh;
+        mesh.open(file.path);
+
+        uint64_t sum = 0;
+        for (uint64_t offset = 0; offset < mesh.getVertexBlobSize(); offset += 4096)
+            sum += mesh.getVertexBlob()[offset];
+        for (uint64_t offset = 0; offset < mesh.getIndexBlobSize(); offset += 4096)
+            sum += mesh.getIndexBlob()[offset];
+        Bench::doNotOptimize(sum);
+        residentMB = std::max(residentMB, getResidentMB() - before);
+    }
+    reportLoad(state, file.size, residentMB);
+}
+
+// Mapped blobs copied straight into one upload buffer, the whole load path
+BENCHMARK(MeshFileUpload)
+{
+    auto&      file = getTestFile();
+    NullDevice device;
+
+    double residentMB = 0.0;
+    while (state.keepRunning())
+    {
+        double   before = getResidentMB();
+        MeshFile mesh;
+        mesh.open(file.path);
+        auto geometry = mesh.upload(device);
+        residentMB = std::max(residentMB, getResidentMB() - before);
+    }
+    reportLoad(state, file.size, residentMB);
+}
+
+// Reference: read the file into a heap buffer first, then copy into the upload buffer
+BENCHMARK(MeshFileStreamUpload)
+{
+    auto&      file = getTestFile();
+    NullDevice device;
+
+    double residentMB = 0.0;
+    while (state.keepRunning())
+    {
+        double before = getResidentMB();
+        std::vector<uint8_t> data(file.size);
+        if (auto stream = std::fopen(file.path.c_str(), "rb"))
+        {
+            Bench::doNotOptimize(std::fread(data.data(), 1, data.size(), stream));
+            std::fclose(stream);
+        }
+
+        BufferDesc desc;
+        desc.size     = file.size;
+        desc.heapType = HeapType::Upload;
+        auto buffer = device.createBuffer(desc, ResourceState::GenericRead);
+        std::memcpy(buffer->getMappedData(), data.data(), data.size());
+        residentMB = std::max(residentMB, getResidentMB() - before);
+    }
+    reportLoad(state, file.size, residentMB);
+}
@@ -0,0 +1,186 @@
+#include "Bench.hpp"
+#include "NullDevice.hpp"
+#include "PipelineCache.hpp"
+
+#include <chrono>
+#include <memory>
+#include <vector>
+#include <cstring>
+
+using namespace GalgameEngine;
+
+namespace
+{
+    RootSignatureDesc makeRootSignatureDesc()
+    {
+        RootSignatureDesc desc;
+        desc.parameters.push_back({ RootParameterType::Constants, ShaderVisibility::Vertex, DescriptorRangeType::ShaderResource, 0, 0, 16 });
+        desc.parameters.push_back({ RootParameterType::ConstantBuffer, ShaderVisibility::All, DescriptorRangeType::ShaderResource, 1 });
+        desc.parameters.push_back({ RootParameterType::DescriptorTable, ShaderVisibility::Pixel, DescriptorRangeType::ShaderResource, 0, 0, 8 });
+        return desc;
+    }
+
+    // Shader sizes of a typical material, variants differ in a few bytes like permutations do
+    GraphicsPipelineDesc makePipelineDesc(RootSignature* rootSignature, uint32_t variant)
+    {
+        GraphicsPipelineDesc desc;
+        desc.rootSignature = rootSignature;
+        desc.vertexShader.assign(4 << 10, 0x11);
+        desc.pixelShader.assign(8 << 10, 0x22);
+        std::memcpy(desc.vertexShader.data(), &variant, sizeof(variant));
+        std::memcpy(desc.pixelShader.data(), &variant, sizeof(variant));
+        desc.inputLayout = {
+            { "POSITION", 0, Format::R32G32B32_FLOAT,    0, 0  },
+            { "NORMAL",   0, Format::R32G32B32_FLOAT,    0, 12 },
+            { "TEXCOORD", 0, Format::R32G32_FLOAT,       0, 24 },
+            { "COLOR",    0, Format::R32G32B32A32_FLOAT, 0, 32 },
+        };
+        return desc;
+    }
+
+    // Request pipelines and wait all, return seconds until every one is ready
+    double startCache(PipelineCache& cache, uint32_t count)
+    {
+        auto  begin         = std::chrono::steady_clock::now();
+        auto& rootSignature = cache.getRootSignature(makeRootSignatureDesc());
+        for (uint32_t i = 0; i < count; ++i)
+            cache.requestPipeline(makePipelineDesc(&rootSignature, i));
+        cache.waitIdle();
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    }
+
+    constexpr uint32_t StartPipelines = 64;
+
+    // 64 pipelines of 200us each on two compile threads, warm start with the library of a cold one
+    void runStart(Bench::State& state, bool warm)
+    {
+        NullDevice::Config deviceConfig;
+        deviceConfig.pipelineCompileCost = std::chrono::microseconds(200);
+        NullDevice device(deviceConfig);
+
+        std::vector<uint8_t> library;
+        {
+            PipelineCache cache(device, {});
+            startCache(cache, StartPipelines);
+            cache.serializeLibrary(library);
+        }
+
+        double   seconds     = 0.0;
+        uint64_t libraryHits = 0;
+        while (state.keepRunning())
+        {
+            PipelineCache cache(device, {});
+            if (warm)
+                cache.deserializeLibrary(library.data(), library.size());
+            seconds     += startCache(cache, StartPipelines);
+            libraryHits += cache.getStats().libraryHits;
+        }
+        state.setItemsProcessed(state.getIterations() * StartPipelines);
+        state.setCounter("startMs", seconds * 1000.0 / state.getIterations());
+        state.setCounter("libraryHits%", 100.0 * libraryHits / (state.getIterations() * StartPipelines));
+    }
+}
+
+// Whole description of a 12KB shader pipeline, what every request costs before the lookup
+BENCHMARK(PipelineHashDesc)
+{
+    NullDevice    device;
+    PipelineCache cache(device, { 0 });
+    auto& rootSignature = cache.getRootSignature(makeRootSignatureDesc());
+    auto  desc          = makePipelineDesc(&rootSignature, 1);
+
+    uint64_t sum = 0;
+    while (state.keepRunning())
+    {
+        desc.vertexShader[4] = static_cast<uint8_t>(sum);
+        sum += PipelineCache::hashPipeline(desc, 1);
+    }
+    state.setItemsProcessed(state.getIterations());
+    state.setCounter("checksum", static_cast<double>(sum & 0xFF));
+}
+
+// Requests of pipelines known already, the per-frame cost of a material system asking again
+BENCHMARK(PipelineRequestHit)
+{
+    NullDevice    device;
+    PipelineCache cache(device, { 0 });
+    auto& rootSignature = cache.getRootSignature(makeRootSignatureDesc());
+
+    std::vector<GraphicsPipelineDesc> descs;
+    for (uint32_t i = 0; i < 64; ++i)
+    {
+        descs.push_back(makePipelineDesc(&rootSignature, i));
+        cache.requestPipeline(descs.back());
+    }
+
+    uint32_t index = 0;
+    while (state.keepRunning())
+        cache.getPipeline(cache.requestPipeline(descs[index++ % descs.size()]));
+    state.setItemsProcessed(state.getIterations());
+    state.setCounter("hits%", 100.0 * cache.getStats().hits / cache.getStats().requests);
+}
+
+// Library of 1024 pipelines to bytes and back, every round trip must restore every entry and reject a damaged copy
+BENCHMARK(PipelineLibraryRoundTrip)
+{
+    NullDevice    device;
+    PipelineCache source(device, { 0 });
+    startCache(source, 1024);
+
+    std::vector<uint8_t> data;
+    uint64_t             errors = 0;
+    while (state.keepRunning())
+    {
+        source.serializeLibrary(data);
+
+        PipelineCache target(device, { 0 });
+        if (!target.deserializeLibrary(data.data(), data.size()) || target.getStats().libraryEntries != 1024)
+            ++errors;
+
+        // A flipped bit anywhere drops the whole file
+        data[data.size() / 2] ^= 1;
+        if (target.deserializeLibrary(data.data(), data.size()) || target.getStats().libraryEntries != 0)
+            ++errors;
+    }
+    state.setItemsProcessed(state.getIterations() * 1024);
+    state.setCounter("bytes", static_cast<double>(data.size()));
+    state.setCounter("errors", static_cast<double>(errors));
+}
+
+// New pipelines keep arriving into a library with room for 256 blobs, the oldest ones are dropped
+// Every 64 pipelines the run restarts from the saved library, the pipeline used by every run must keep its blob
+BENCHMARK(PipelineLibraryEviction)
+{
+    constexpr PipelineCache::Config Config = { 0, 256 * 16 };
+
+    NullDevice device;
+    auto       cache = std::make_unique<PipelineCache>(device, Config);
+    startCache(*cache, 1);
+
+    std::vector<uint8_t> library;
+    uint32_t             variant   = 1;
+    uint64_t             errors    = 0;
+    uint64_t             evictions = 0;
+    while (state.keepRunning())
+    {
+        cache->requestPipeline(makePipelineDesc(&cache->getRootSignature(makeRootSignatureDesc()), variant++));
+        if (variant % 64 == 0)
+        {
+            cache->serializeLibrary(library);
+            evictions += cache->getStats().evictions;
+
+            cache = std::make_unique<PipelineCache>(device, Config);
+            cache->deserializeLibrary(library.data(), library.size());
+            startCache(*cache, 1);
+            errors += cache->getStats().libraryHits != 1;
+        }
+    }
+    evictions += cache->getStats().evictions;
+    state.setItemsProcessed(state.getIterations());
+    state.setCounter("evictions", static_cast<double>(evictions));
+    state.setCounter("entries", static_cast<double>(cache->getStats().libraryEntries));
+    state.setCounter("errors", static_cast<double>(errors));
+}
+
+BENCHMARK(PipelineColdStart64) { runStart(state, false); }
+BENCHMARK(PipelineWarmStart64) { runStart(state, true); }
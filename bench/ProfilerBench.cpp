@@ -0,0 +1,110 @@
+#include "Bench.hpp"
+#include "Timer.hpp"
+#include "Profiler.hpp"
+#include "NullDevice.hpp"
+#include "GpuProfiler.hpp"
+
+#include <memory>
+#include <vector>
+
+using namespace GalgameEngine;
+
+BENCHMARK(TimerNow)
+{
+    while (state.keepRunning())
+        Bench::doNotOptimize(Timer::now());
+}
+
+BENCHMARK(ProfileScopeDisabled)
+{
+    Profiler::setEnabled(false);
+    while (state.keepRunning())
+    {
+        PROFILE_SCOPE("Disabled");
+    }
+}
+
+BENCHMARK(ProfileScopeEnabled)
+{
+    Profiler::setEnabled(true);
+    while (state.keepRunning())
+    {
+        PROFILE_SCOPE("Enabled");
+    }
+    Profiler::setEnabled(false);
+    Profiler::clear();
+}
+
+BENCHMARK(ProfileScopeNested)
+{
+    Profiler::setEnabled(true);
+    while (state.keepRunning())
+    {
+        PROFILE_SCOPE("Outer");
+        {
+            PROFILE_SCOPE("Inner");
+        }
+    }
+    Profiler::setEnabled(false);
+    Profiler::clear();
+}
+
+// Frame of 64 markers on the null device, 3 frames in flight. GPU lag is from the submit on CPU to the first
+// marker begin on GPU mapped to Timer ticks, a negative value would mean the calibration is off
+BENCHMARK(GpuProfilerFrame)
+{
+    constexpr uint32_t FrameCount = 3;
+
+    NullDevice          device;
+    auto&               queue = device.getQueue();
+    GpuProfiler::Config config;
+    config.frameCount = FrameCount;
+    GpuProfiler profiler(device, queue, config);
+
+    std::vector<std::unique_ptr<CommandAllocator>> allocators;
+    for (uint32_t i = 0; i < FrameCount; ++i)
+        allocators.push_back(device.createCommandAllocator());
+    auto list = device.createCommandList();
+
+    uint64_t fenceValues[FrameCount] = {};
+    int64_t  submitTicks[FrameCount] = {};
+    uint64_t frame    = 0;
+    uint64_t resolved = 0;
+    double   lag      = 0.0;
+    double   minLag   = 1e9;
+    while (state.keepRunning())
+    {
+        auto slot = frame % FrameCount;
+        queue.waitForValue(fenceValues[slot]);
+        auto before = profiler.getStats().resolvedFrames;
+        profiler.beginFrame();
+        if (profiler.getStats().resolvedFrames != before)
+        {
+            double us = (profiler.getMarkers().front().begin - submitTicks[slot]) * Timer::getSecondsPerCount() * 1e6;
+            lag   += us;
+            minLag = us < minLag ? us : minLag;
+            ++resolved;
+        }
+
+        allocators[slot]->reset();
+        list->reset(*allocators[slot]);
+        for (uint32_t i = 0; i < 64; ++i)
+            profiler.endMarker(*list, profiler.beginMarker(*list, "Marker"));
+        profiler.endFrame(*list);
+        list->close();
+
+        CommandList* lists[] = { list.get() };
+        submitTicks[slot] = Timer::now();
+        queue.executeCommandLists(lists, 1);
+        fenceValues[slot] = queue.signal();
+        profiler.finishFrame(fenceValues[slot]);
+        ++frame;
+    }
+    queue.flush();
+
+    state.setItemsProcessed(state.getIterations() * 64);
+    state.setCounter("gpuLagUs", resolved > 0 ? lag / resolved : 0.0);
+    state.setCounter("minGpuLagUs", resolved > 0 ? minLag : 0.0);
+    state.setCounter("lostFrames", static_cast<double>(profiler.getStats().lostFrames));
+    state.setCounter("errors", static_cast<double>(device.getErrorCount()));
+}
@@ -0,0 +1,133 @@
+#include "Bench.hpp"
+#include "Hash.hpp"
+#include "JobSystem.hpp"
+#include "SoftwareRasterizer.hpp"
+
+#include <cmath>
+#include <vector>
+#include <cstring>
+
+using namespace GalgameEngine;
+
+namespace
+{
+    constexpr uint32_t Width     = 1280;
+    constexpr uint32_t Height    = 720;
+    constexpr uint32_t GridSide  = 100;
+    constexpr uint32_t BoxCount  = GridSide * GridSide;
+    constexpr uint32_t BoxGroups = 100;
+
+    /*
+    * Grid of 100 x 100 rotated boxes seen at an angle, near ones cover many pixels and far ones a few,
+    * with a color and depth target of 720p
+    */
+    struct Scene
+    {
+        std::vector<float>    positions;
+        std::vector<uint16_t> indices;
+        std::vector<Mat4>     worlds;
+        std::vector<uint32_t> color;
+        std::vector<float>    depth;
+        Mat4                  viewProjection;
+
+        Scene()
+        {
+            for (uint32_t face = 0; face < 6; ++face)
+            {
+                // Corners clockwise seen from outside
+                float sign    = face % 2 == 0 ? 1.f : -1.f;
+                Vec3  normal  = face / 2 == 0 ? Vec3{ sign, 0.f, 0.f } : face / 2 == 1 ? Vec3{ 0.f, sign, 0.f } : Vec3{ 0.f, 0.f, sign };
+                Vec3  tangent = face / 2 == 0 ? Vec3{ 0.f, 0.f, 1.f } : Vec3{ 1.f, 0.f, 0.f };
+                Vec3  bitangent = cross(-normal, tangent);
+                Vec3  corners[4] = { normal - tangent - bitangent, normal - tangent + bitangent, normal + tangent + bitangent, normal + tangent - bitangent };
+                for (auto& corner : corners)
+                    positions.insert(positions.end(), { corner.x * 0.4f, corner.y * 0.4f, corner.z * 0.4f });
+                auto first = static_cast<uint16_t>(face * 4);
+                indices.insert(indices.end(), { first, static_cast<uint16_t>(first + 1), static_cast<uint16_t>(first + 2),
+                                                first, static_cast<uint16_t>(first + 2), static_cast<uint16_t>(first + 3) });
+            }
+            for (uint32_t i = 0; i < BoxCount; ++i)
+            {
+                Vec3 position = { static_cast<float>(i % GridSide), 0.f, static_cast<float>(i / GridSide) };
+                worlds.push_back(Mat4::fromTransform(position, Quat::fromAxisAngle({ 0.f, 1.f, 0.f }, static_cast<float>(i)), { 1.f, 1.f, 1.f }));
+            }
+
+            color.resize(Width * Height);
+            depth.resize(Width * Height);
+            auto view       = Mat4::lookAt({ -5.f, 20.f, -10.f }, { 50.f, 0.f, 50.f }, { 0.f, 1.f, 0.f });
+            auto projection = Mat4::perspectiveFov(Pi / 3.f, static_cast<float>(Width) / Height, 0.5f, 500.f);
+            viewProjection  = view * projection;
+        }
+
+        SoftwareRasterizer::DrawDesc draw(uint32_t firstBox, uint32_t boxCount, uint32_t colorIndex) const
+        {
+            SoftwareRasterizer::DrawDesc desc;
+            desc.positions      = reinterpret_cast<const uint8_t*>(positions.data());
+            desc.stride         = 3 * sizeof(float);
+            desc.vertexCount    = static_cast<uint32_t>(positions.size() / 3);
+            desc.indices        = reinterpret_cast<const uint8_t*>(indices.data());
+            desc.indexCount     = static_cast<uint32_t>(indices.size());
+            desc.instanceCount  = boxCount;
+            desc.worlds         = reinterpret_cast<const uint8_t*>(worlds.data() + firstBox);
+            desc.worldCount     = boxCount;
+            desc.viewProjection = viewProjection;
+            desc.viewport       = { 0.f, 0.f, static_cast<float>(Width), static_cast<float>(Height), 0.f, 1.f };
+            desc.scissor        = { 0, 0, static_cast<int32_t>(Width), static_cast<int32_t>(Height) };
+            float rgba[4]       = { 0.3f + 0.1f * (colorIndex % 8), 0.9f - 0.1f * (colorIndex % 8), 0.6f, 1.f };
+            desc.color          = SoftwareRasterizer::packColor(rgba);
+            return desc;
+        }
+
+        uint64_t hashImage() const
+        {
+            Hasher hasher;
+            hasher.add(color.data(), color.size() * sizeof(uint32_t));
+            return hasher.finish();
+        }
+    };
+
+    // One frame is a clear of both targets and the whole grid, in one draw or in groups of 100 boxes
+    void runRaster(Bench::State& state, uint32_t threadCount, uint32_t groups)
+    {
+        Scene     scene;
+        JobSystem jobs(threadCount);
+        SoftwareRasterizer::Config config;
+        config.jobSystem = threadCount > 1 ? &jobs : nullptr;
+        SoftwareRasterizer rasterizer(config);
+        SoftwareRasterizer::Surface color = { scene.color.data(), Width, Height, Width };
+        SoftwareRasterizer::Surface depth = { scene.depth.data(), Width, Height, Width };
+
+        auto frame = [&](SoftwareRasterizer& target)
+        {
+            target.clearColor(color, 0xFF342C28);
+            target.clearDepth(depth, 1.f);
+            target.setTargets(color, depth);
+            for (uint32_t group = 0; group < groups; ++group)
+                target.draw(scene.draw(BoxCount / groups * group, BoxCount / groups, group));
+            target.flush();
+        };
+        while (state.keepRunning())
+        {
+            frame(rasterizer);
+            Bench::doNotOptimize(scene.color.data());
+        }
+        auto stats = rasterizer.getStats();
+        auto hash  = scene.hashImage();
+
+        // Image may not depend on the thread count
+        SoftwareRasterizer reference({});
+        frame(reference);
+
+        auto frames = static_cast<double>(state.getIterations());
+        state.setItemsProcessed(state.getIterations() * BoxCount * 12);
+        state.setCounter("pixels", static_cast<double>(stats.pixels) / frames);
+        state.setCounter("binned", static_cast<double>(stats.binned) / frames);
+        state.setCounter("culled", static_cast<double>(stats.culled) / frames);
+        state.setCounter("mismatch", hash != scene.hashImage() ? 1.0 : 0.0);
+    }
+}
+
+BENCHMARK(RasterBoxes10k01)       { runRaster(state, 1, 1); }
+BENCHMARK(RasterBoxes10k04)       { runRaster(state, 4, 1); }
+BENCHMARK(RasterBoxGroups10k01)   { runRaster(state, 1, BoxGroups); }
+BENCHMARK(RasterBoxGroups10k04)   { runRaster(state, 4, BoxGroups); }
@@ -0,0 +1,151 @@
+#include "Bench.hpp"
+#include "NullDevice.hpp"
+#include "RenderGraph.hpp"
+
+#include <vector>
+
+using namespace GalgameEngine;
+
+namespace
+{
+    // Post processing chain, every pass creates a target and reads the two before it
+    // Every 8th pass also writes a debug target nothing reads, its pass is culled
+    constexpr uint32_t ChainPasses = 48;
+
+    struct Workload
+    {
+        NullDevice                        device;
+        RenderGraph                       graph{ device };
+        std::unique_ptr<CommandAllocator> allocator;
+        std::unique_ptr<CommandList>      list;
+        std::unique_ptr<Texture>          outputTexture;
+        ResourceStateTracker              tracker;
+
+        std::vector<RenderGraphTexture> targets = std::vector<RenderGraphTexture>(ChainPasses);
+        RenderGraphTexture              output;
+
+        Workload()
+        {
+            allocator = device.createCommandAllocator();
+            list      = device.createCommandList();
+
+            TextureDesc desc = {};
+            desc.width  = 1280;
+            desc.height = 720;
+            desc.format = Format::R8G8B8A8_UNORM;
+            desc.usage  = TextureUsage::RenderTarget;
+            outputTexture = device.createTexture(desc, ResourceState::RenderTarget);
+        }
+    };
+
+    void buildChain(Workload& workload)
+    {
+        static constexpr float color[] = { 0.f, 0.f, 0.f, 0.f };
+
+        auto& graph = workload.graph;
+
+        TextureDesc desc = {};
+        desc.format = Format::R16G16B16A16_FLOAT;
+        desc.usage  = TextureUsage::RenderTarget | TextureUsage::ShaderResource;
+
+        RenderGraphTexture previous[2];
+        for (uint32_t pass = 0; pass < ChainPasses; ++pass)
+        {
+            // Half and quarter resolution targets in the middle of the chain, like bloom
+            uint32_t scale = pass % 3 == 0 ? 1 : (pass % 3 == 1 ? 2 : 4);
+            desc.width  = 1280 / scale;
+            desc.height = 720 / scale;
+
+            // Handles are filled in by setup, execute runs later and reads them from the workload
+            auto& target = workload.targets[pass];
+            graph.addPass("Post",
+                [&](RenderGraph::PassBuilder& builder)
+                {
+                    for (auto& input : previous)
+                    {
+                        if (input.isValid())
+                            builder.read(input);
+                    }
+                    target = builder.create("PostTarget", desc);
+                    builder.write(target);
+                },
+                [&target](RenderGraph::PassContext& context)
+                {
+                    context.getCommandList().clearRenderTarget(context.getTexture(target), color);
+                });
+
+            if (pass % 8 == 7)
+            {
+                graph.addPass("Debug",
+                    [&](RenderGraph::PassBuilder& builder)
+                    {
+                        builder.read(target);
+                        builder.write(builder.create("DebugTarget", desc));
+                    },
+                    [](RenderGraph::PassContext&) {});
+            }
+
+            previous[1] = previous[0];
+            previous[0] = target;
+        }
+
+        workload.output = graph.importTexture("Output", *workload.outputTexture);
+        graph.addPass("Composite",
+            [&](RenderGraph::PassBuilder& builder)
+            {
+                builder.read(previous[0]);
+                builder.read(previous[1]);
+                builder.write(workload.output);
+            },
+            [&workload](RenderGraph::PassContext& context)
+            {
+                context.getCommandList().clearRenderTarget(context.getTexture(workload.output), color);
+            });
+
+        graph.compile();
+    }
+
+    void runGraph(Bench::State& state, bool execute)
+    {
+        Workload workload;
+        auto&    queue = workload.device.getQueue();
+
+        std::vector<ResourceBarrier> fixups;
+        std::vector<CommandList*>    lists;
+        while (state.keepRunning())
+        {
+            buildChain(workload);
+            if (execute)
+            {
+                workload.list->reset(*workload.allocator);
+                workload.tracker.reset(true);
+                workload.graph.execute(*workload.list, workload.tracker);
+                workload.tracker.finish(*workload.list);
+                workload.list->close();
+
+                fixups.clear();
+                workload.tracker.resolve(fixups);
+                lists.clear();
+                lists.push_back(workload.list.get());
+                queue.executeCommandLists(lists.data(), static_cast<uint32_t>(lists.size()));
+            }
+            workload.graph.finishFrame(queue.signal());
+            queue.flush();
+        }
+
+        // Aliasing shares memory between targets whose lifetimes do not overlap
+        auto& stats = workload.graph.getStats();
+        state.setItemsProcessed(state.getIterations() * stats.passes);
+        state.setCounter("culled", stats.culledPasses);
+        state.setCounter("unaliasedMB", stats.transientBytes / 1048576.0);
+        state.setCounter("heapUsedMB", stats.heapUsedBytes / 1048576.0);
+        state.setCounter("createdTextures", static_cast<double>(stats.createdTextures));
+        state.setCounter("errors", static_cast<double>(workload.device.getErrorCount()));
+    }
+}
+
+// Declaring, culling, placing and binding a frame, placed textures come from the cache after the first frame
+BENCHMARK(RenderGraphCompile) { runGraph(state, false); }
+
+// Same frame recorded and validated by the null backend
+BENCHMARK(RenderGraphExecute) { runGraph(state, true); }
@@ -0,0 +1,82 @@
+#include "Bench.hpp"
+#include "NullDevice.hpp"
+#include "ResidencyManager.hpp"
+
+#include <memory>
+#include <vector>
+
+using namespace GalgameEngine;
+
+namespace
+{
+    constexpr uint32_t BufferCount = 1024;
+    constexpr uint64_t BufferSize  = 4ull << 20;   // 16 per heap block
+
+    struct Scene
+    {
+        NullDevice                           device;
+        std::vector<std::unique_ptr<Buffer>> buffers;
+
+        explicit Scene(uint64_t budget) : device(makeConfig(budget))
+        {
+            BufferDesc desc;
+            desc.size = BufferSize;
+            for (uint32_t i = 0; i < BufferCount; ++i)
+                buffers.push_back(device.createBuffer(desc, ResourceState::Common));
+        }
+
+        static NullDevice::Config makeConfig(uint64_t budget)
+        {
+            NullDevice::Config config;
+            config.memoryBudget = budget;
+            return config;
+        }
+    };
+
+    /*
+    * 4GB of buffers in 64 heaps, each frame uses a window of 256 buffers which moves on by 16 every frame
+    * Frames count as finished by GPU at once, so every heap out of the window can be evicted.
+    * With 768MB the window alone is over budget, every frame runs over it instead of failing
+    */
+    void runFrames(Bench::State& state, uint64_t budget)
+    {
+        Scene            scene(budget);
+        ResidencyManager residency(scene.device, {});
+
+        uint64_t frame = 0;
+        while (state.keepRunning())
+        {
+            for (uint32_t i = 0; i < 256; ++i)
+                residency.use(*scene.buffers[(frame * 16 + i) % BufferCount]);
+            residency.update();
+            residency.finishFrame(0);
+            ++frame;
+        }
+
+        auto stats = residency.getStats();
+        state.setItemsProcessed(state.getIterations() * 256);
+        state.setCounter("evictionsPerFrame", static_cast<double>(stats.evictions) / state.getIterations());
+        state.setCounter("restoresPerFrame", static_cast<double>(stats.restores) / state.getIterations());
+        state.setCounter("overBudget%", 100.0 * stats.overBudgetFrames / state.getIterations());
+        state.setCounter("errors", static_cast<double>(scene.device.getErrorCount()));
+    }
+}
+
+// Every frame uses the same resources, the cost of marking them when nothing has to move
+BENCHMARK(ResidencyUseResident)
+{
+    Scene            scene(0);
+    ResidencyManager residency(scene.device, {});
+
+    while (state.keepRunning())
+    {
+        for (uint32_t i = 0; i < 256; ++i)
+            residency.use(*scene.buffers[i]);
+        residency.update();
+        residency.finishFrame(0);
+    }
+    state.setItemsProcessed(state.getIterations() * 256);
+}
+
+BENCHMARK(ResidencyChurn2GB)   { runFrames(state, 2ull << 30); }
+BENCHMARK(ResidencyChurn768MB) { runFrames(state, 768ull << 20); }
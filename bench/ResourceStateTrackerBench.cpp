@@ -0,0 +1,135 @@
+#include "Bench.hpp"
+#include "NullDevice.hpp"
+#include "ResourceStateTracker.hpp"
+
+#include <vector>
+
+using namespace GalgameEngine;
+
+namespace
+{
+    // Synthetic frame of passes, each writes one target and reads two written a few passes before,
+    // like a post processing chain over a pool of render targets
+    constexpr uint32_t TargetCount   = 64;
+    constexpr uint32_t PassesPerList = 32;
+
+    struct Workload
+    {
+        NullDevice                            device;
+        std::unique_ptr<CommandAllocator>     allocator;
+        std::unique_ptr<CommandList>          list;
+        std::unique_ptr<CommandList>          fixupList;
+        std::vector<std::unique_ptr<Texture>> targets;
+
+        Workload()
+        {
+            allocator = device.createCommandAllocator();
+            list      = device.createCommandList();
+            fixupList = device.createCommandList();
+
+            TextureDesc desc = {};
+            desc.width  = 256;
+            desc.height = 256;
+            desc.format = Format::R16G16B16A16_FLOAT;
+            desc.usage  = TextureUsage::RenderTarget | TextureUsage::ShaderResource;
+            for (uint32_t i = 0; i < TargetCount; ++i)
+                targets.push_back(device.createTexture(desc, ResourceState::ShaderResource));
+        }
+    };
+
+    // One list of passes, split barriers start the read transition right after a target is written
+    void recordPasses(Workload& workload, ResourceStateTracker& tracker, uint32_t frame, bool split)
+    {
+        static constexpr float color[] = { 0.f, 0.f, 0.f, 0.f };
+
+        auto& list = *workload.list;
+        list.reset(*workload.allocator);
+        tracker.reset();
+        for (uint32_t pass = 0; pass < PassesPerList; ++pass)
+        {
+            auto& output = *workload.targets[(frame * 7 + pass) % TargetCount];
+            tracker.transition(*workload.targets[(frame * 7 + pass + TargetCount - 2) % TargetCount], ResourceState::ShaderResource);
+            tracker.transition(*workload.targets[(frame * 7 + pass + TargetCount - 3) % TargetCount], ResourceState::ShaderResource);
+            tracker.transition(output, ResourceState::RenderTarget);
+            tracker.flush(list);
+            list.clearRenderTarget(output, color);
+
+            if (split)
+                tracker.beginTransition(output, ResourceState::ShaderResource);
+        }
+        tracker.finish(list);
+        list.close();
+    }
+
+    void runTracker(Bench::State& state, bool split)
+    {
+        Workload             workload;
+        ResourceStateTracker tracker;
+        auto&                queue = workload.device.getNullQueue();
+
+        std::vector<ResourceBarrier> fixups;
+        std::vector<CommandList*>    lists;
+        uint32_t                     frame = 0;
+        while (state.keepRunning())
+        {
+            recordPasses(workload, tracker, frame++, split);
+
+            fixups.clear();
+            tracker.resolve(fixups);
+            lists.clear();
+            if (!fixups.empty())
+            {
+                workload.fixupList->reset(*workload.allocator);
+                workload.fixupList->resourceBarrier(fixups.data(), static_cast<uint32_t>(fixups.size()));
+                workload.fixupList->close();
+                lists.push_back(workload.fixupList.get());
+            }
+            lists.push_back(workload.list.get());
+            queue.executeCommandLists(lists.data(), static_cast<uint32_t>(lists.size()));
+            queue.flush();
+        }
+
+        // Naive code writes one barrier before every use, emitted shows what batching, merging and resolving leave
+        auto& stats       = tracker.getStats();
+        auto  deviceStats = workload.device.getStats();
+        state.setItemsProcessed(state.getIterations() * PassesPerList);
+        state.setCounter("requested/list", static_cast<double>(stats.requested) / state.getIterations());
+        state.setCounter("emitted/list", static_cast<double>(deviceStats.barriers) / state.getIterations());
+        state.setCounter("split/list", static_cast<double>(deviceStats.splitBarriers) / state.getIterations());
+        state.setCounter("errors", static_cast<double>(workload.device.getErrorCount()));
+    }
+}
+
+BENCHMARK(StateTrackerPasses)      { runTracker(state, false); }
+BENCHMARK(StateTrackerSplitPasses) { runTracker(state, true); }
+
+// Requests which cancel or fold inside one batch, only the net transition reaches the list
+BENCHMARK(StateTrackerMerge)
+{
+    Workload             workload;
+    ResourceStateTracker tracker;
+    auto&                list = *workload.list;
+
+    std::vector<ResourceBarrier> fixups;
+    while (state.keepRunning())
+    {
+        list.reset(*workload.allocator);
+        tracker.reset(true);
+        for (auto& target : workload.targets)
+        {
+            tracker.transition(*target, ResourceState::RenderTarget);
+            tracker.transition(*target, ResourceState::CopySource);
+            tracker.transition(*target, ResourceState::ShaderResource);
+        }
+        tracker.finish(list);
+        list.close();
+
+        fixups.clear();
+        tracker.resolve(fixups);
+    }
+
+    auto& stats = tracker.getStats();
+    state.setItemsProcessed(state.getIterations() * TargetCount * 3);
+    state.setCounter("emitted", static_cast<double>(stats.emitted));
+    state.setCounter("merged/list", static_cast<double>(stats.merged) / state.getIterations());
+}
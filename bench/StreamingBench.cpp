@@ -0,0 +1,171 @@
+#include "Bench.hpp"
+#include "IoQueue.hpp"
+#include "NullDevice.hpp"
+#include "StreamQueue.hpp"
+#include "AssetStreamer.hpp"
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <algorithm>
+#include <filesystem>
+
+using namespace GalgameEngine;
+
+namespace
+{
+    constexpr uint64_t BlockSize  = 256 << 10;
+    constexpr uint32_t BlockCount = 256;            // 64MB file
+
+    // File of 256KB blocks, written once and removed at exit. Reads run on a warm page cache
+    struct TestFile
+    {
+        std::string path;
+
+        TestFile()
+        {
+            path = (std::filesystem::temp_directory_path() / "dx12_bench_stream.bin").string();
+
+            std::vector<char> block(BlockSize);
+            std::ofstream     file(path, std::ios::binary | std::ios::trunc);
+            for (uint32_t i = 0; i < BlockCount; ++i)
+            {
+                std::fill(block.begin(), block.end(), static_cast<char>(i));
+                file.write(block.data(), static_cast<std::streamsize>(block.size()));
+            }
+        }
+
+        ~TestFile() { std::filesystem::remove(path); }
+    };
+
+    const TestFile& getTestFile()
+    {
+        static TestFile s_file;
+        return s_file;
+    }
+
+    // Whole file in 256KB reads, depth 64
+    void runRead(Bench::State& state, bool forceThreads)
+    {
+        IoQueue::Config config;
+        config.forceThreads = forceThreads;
+        IoQueue io(config);
+        auto    file = io.openFile(getTestFile().path);
+
+        std::vector<uint8_t>             data(BlockSize * BlockCount);
+        std::vector<IoQueue::Completion> completions(config.depth);
+        uint64_t                         errors = 0;
+        while (state.keepRunning())
+        {
+            uint32_t started = 0;
+            uint32_t done    = 0;
+            while (done < BlockCount)
+            {
+                while (started < BlockCount && io.read(file, started * BlockSize, BlockSize, data.data() + started * BlockSize, started))
+                    ++started;
+                auto count = io.poll(completions.data(), config.depth, true);
+                for (uint32_t i = 0; i < count; ++i)
+                    errors += completions[i].result != static_cast<int64_t>(BlockSize);
+                done += count;
+            }
+        }
+        io.closeFile(file);
+
+        state.setItemsProcessed(state.getIterations() * BlockCount);
+        state.setCounter("MBps", state.getIterations() * (BlockSize * BlockCount / 1048576.0) / state.getSeconds());
+        state.setCounter("syscallsPerRead", static_cast<double>(io.getStats().submitCalls) / io.getStats().reads);
+        state.setCounter("uring", io.getBackend() == IoQueue::Backend::Uring ? 1.0 : 0.0);
+        state.setCounter("errors", static_cast<double>(errors));
+    }
+
+    /*
+    * Whole file streamed into 256 default heap buffers one frame at a time, 4GB/s simulated copy queue
+    * Frames do nothing else, so the counters show what update() costs the render thread and how fast data arrives
+    */
+    void runStreamer(Bench::State& state, bool forceThreads)
+    {
+        NullDevice::Config deviceConfig;
+        deviceConfig.copyBandwidth = 4ull << 30;
+        NullDevice device(deviceConfig);
+
+        std::vector<std::unique_ptr<Buffer>> buffers;
+        BufferDesc                           bufferDesc;
+        bufferDesc.size = BlockSize;
+        for (uint32_t i = 0; i < BlockCount; ++i)
+            buffers.push_back(device.createBuffer(bufferDesc, ResourceState::Common));
+
+        AssetStreamer::Config config;
+        config.io.forceThreads = forceThreads;
+
+        double   maxUpdate = 0.0;
+        double   updates   = 0.0;
+        uint64_t frames    = 0;
+        uint64_t failed    = 0;
+        while (state.keepRunning())
+        {
+            AssetStreamer streamer(device, config);
+            auto          file = streamer.openFile(getTestFile().path);
+            for (uint32_t i = 0; i < BlockCount; ++i)
+            {
+                StreamRequest request;
+                request.file     = file;
+                request.offset   = i * BlockSize;
+                request.size     = BlockSize;
+                request.buffer   = buffers[i].get();
+                request.priority = static_cast<float>(i % 13);
+                streamer.request(std::move(request));
+            }
+
+            while (streamer.getStats().completed + streamer.getStats().failed < BlockCount)
+            {
+                auto begin = std::chrono::steady_clock::now();
+                streamer.update();
+                double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+                maxUpdate = std::max(maxUpdate, seconds);
+                updates  += seconds;
+                ++frames;
+            }
+            failed += streamer.getStats().failed;
+        }
+
+        state.setItemsProcessed(state.getIterations() * BlockCount);
+        state.setCounter("MBps", state.getIterations() * (BlockSize * BlockCount / 1048576.0) / state.getSeconds());
+        state.setCounter("updateUs", updates * 1e6 / frames);
+        state.setCounter("maxUpdateMs", maxUpdate * 1000.0);
+        state.setCounter("failed", static_cast<double>(failed));
+    }
+}
+
+// 4096 queued requests, every iteration re-prioritizes 16 as the camera moves, replaces a cancelled one and pops one for a new one
+BENCHMARK(StreamQueueChurn)
+{
+    StreamQueue queue;
+    uint64_t    nextId = 0;
+    for (; nextId < 4096; ++nextId)
+        queue.push(nextId, static_cast<float>(nextId % 97), BlockSize);
+
+    uint64_t          step = 0;
+    StreamQueue::Item item = {};
+    while (state.keepRunning())
+    {
+        for (uint64_t i = 0; i < 16; ++i)
+            queue.setPriority(nextId - 1 - (step * 16 + i) % 4096, static_cast<float>((step + i) % 89));
+        if (queue.remove(nextId - 1 - (step * 7) % 4096))
+            queue.push(nextId++, static_cast<float>(step % 61), BlockSize);
+        if (queue.top(item))
+            queue.pop();
+        queue.push(nextId++, static_cast<float>(step % 97), BlockSize);
+        ++step;
+    }
+    Bench::doNotOptimize(item.id);
+    state.setItemsProcessed(state.getIterations());
+    state.setCounter("queued", queue.getCount());
+    state.setCounter("rebuilds", static_cast<double>(queue.getStats().rebuilds));
+}
+
+BENCHMARK(IoQueueReadOs)        { runRead(state, false); }
+BENCHMARK(IoQueueReadThreads)   { runRead(state, true); }
+BENCHMARK(AssetStreamerOs)      { runStreamer(state, false); }
+BENCHMARK(AssetStreamerThreads) { runStreamer(state, true); }
@@ -0,0 +1,96 @@
+#include "Bench.hpp"
+#include "NullDevice.hpp"
+#include "TimelineSync.hpp"
+
+#include <memory>
+#include <random>
+#include <vector>
+
+using namespace GalgameEngine;
+
+// Wait handle created and closed around every wait, what waitForValue() used to do
+BENCHMARK(SyncEventCreatePerWait)
+{
+    while (state.keepRunning())
+    {
+        SyncEvent event;
+        event.set();
+        event.wait();
+    }
+    state.setItemsProcessed(state.getIterations());
+}
+
+// Same wait through a pooled handle
+BENCHMARK(SyncEventPooledWait)
+{
+    SyncEventPool pool;
+    while (state.keepRunning())
+    {
+        auto event = pool.acquire();
+        event->set();
+        event->wait();
+        pool.release(event);
+    }
+    state.setItemsProcessed(state.getIterations());
+    state.setCounter("created", static_cast<double>(pool.getStats().created));
+}
+
+// Four simulated queues with uneven work, CPU waits for the first one done and then for all
+BENCHMARK(TimelineWaitAnyAll4Queues)
+{
+    constexpr uint32_t QueueCount = 4;
+
+    NullDevice device;
+    std::vector<std::unique_ptr<NullCommandQueue>> queues;
+    for (uint32_t i = 0; i < QueueCount; ++i)
+        queues.push_back(std::make_unique<NullCommandQueue>(device, QueueType::Direct));
+
+    TimelineSync sync;
+    std::mt19937 random(5);
+    FencePoint   points[QueueCount];
+    uint64_t     firstCounts[QueueCount] = {};
+    while (state.keepRunning())
+    {
+        for (uint32_t i = 0; i < QueueCount; ++i)
+        {
+            queues[i]->submit(std::chrono::microseconds(5 + random() % 50));
+            points[i] = { queues[i].get(), queues[i]->signal() };
+        }
+
+        auto first = sync.waitAny(points, QueueCount);
+        if (first != TimelineSync::TimedOut)
+            ++firstCounts[first];
+        sync.waitAll(points, QueueCount);
+    }
+
+    auto stats = sync.getStats();
+    state.setItemsProcessed(state.getIterations());
+    state.setCounter("waits", static_cast<double>(stats.waits));
+    state.setCounter("createdEvents", static_cast<double>(stats.createdEvents));
+    state.setCounter("armedEvents", stats.armedEvents);
+    state.setCounter("timeouts", static_cast<double>(stats.timeouts));
+}
+
+// Deferred destruction pattern, a batch of callbacks per fence value dispatched once per simulated frame
+BENCHMARK(TimelineCallbacks)
+{
+    constexpr uint32_t CallbacksPerFrame = 64;
+
+    NullDevice       device;
+    NullCommandQueue queue(device, QueueType::Direct);
+    TimelineSync     sync;
+
+    uint64_t ran = 0;
+    while (state.keepRunning())
+    {
+        uint64_t value = queue.signal();
+        for (uint32_t i = 0; i < CallbacksPerFrame; ++i)
+            sync.onCompleted({ &queue, value }, [&ran]() { ++ran; });
+        sync.wait({ &queue, value });
+        sync.dispatch();
+    }
+
+    state.setItemsProcessed(state.getIterations() * CallbacksPerFrame);
+    state.setCounter("pending", sync.getPendingCallbackCount());
+    state.setCounter("missed", static_cast<double>(state.getIterations() * CallbacksPerFrame - ran));
+}
@@ -0,0 +1,86 @@
+#include "Bench.hpp"
+#include "NullDevice.hpp"
+#include "UploadRing.hpp"
+#include "RingAllocator.hpp"
+
+using namespace GalgameEngine;
+
+namespace
+{
+    // GPU is this many frames behind CPU
+    constexpr uint64_t FrameLatency = 2;
+}
+
+// Pure bookkeeping, 1000 constant blocks per frame with GPU lagging behind
+BENCHMARK(RingAllocatorConstants)
+{
+    constexpr uint32_t AllocationsPerFrame = 1000;
+
+    RingAllocator ring(4 << 20);
+    uint64_t      frame = 0, allocation = 0;
+    while (state.keepRunning())
+    {
+        Bench::doNotOptimize(ring.allocate(256, 256));
+        if (++allocation % AllocationsPerFrame == 0)
+        {
+            ring.finishFrame(++frame);
+            ring.reclaim(frame > FrameLatency ? frame - FrameLatency : 0);
+        }
+    }
+    state.setItemsProcessed(state.getIterations());
+}
+
+// Mixed sizes and alignments, reports how many bytes alignment and wrapping waste
+BENCHMARK(RingAllocatorMixed)
+{
+    constexpr uint32_t AllocationsPerFrame = 512;
+    constexpr uint64_t Sizes[]      = { 64, 256, 1000, 4096, 24, 65536 };
+    constexpr uint64_t Alignments[] = { 16, 256, 256, 512, 4, 256 };
+
+    RingAllocator ring(32 << 20);
+    uint64_t      frame = 0, allocation = 0;
+    while (state.keepRunning())
+    {
+        auto i = allocation % 6;
+        Bench::doNotOptimize(ring.allocate(Sizes[i], Alignments[i]));
+        if (++allocation % AllocationsPerFrame == 0)
+        {
+            ring.finishFrame(++frame);
+            ring.reclaim(frame > FrameLatency ? frame - FrameLatency : 0);
+        }
+    }
+
+    auto& stats = ring.getStats();
+    state.setItemsProcessed(state.getIterations());
+    state.setCounter("waste%", 100.0 * (stats.paddingWaste + stats.wrapWaste) / (stats.allocated + 1));
+    state.setCounter("failures", static_cast<double>(stats.failures));
+    state.setCounter("peakMB", stats.peakUsed / 1048576.0);
+}
+
+// Full path with mapped memory on the null backend, including a copy of the constant block
+BENCHMARK(UploadRingPush)
+{
+    struct Constants { float world[16]; float color[4]; };
+
+    NullDevice device;
+    auto&      queue = device.getQueue();
+    UploadRing ring(device, 4 << 20);
+    Constants  constants = {};
+    uint64_t   count     = 0;
+    while (state.keepRunning())
+    {
+        Bench::doNotOptimize(ring.push(constants));
+        if (++count % 1000 == 0)
+        {
+            // Wait like the frame ring does, GPU is at most FrameLatency frames behind
+            auto fenceValue = queue.signal();
+            ring.finishFrame(fenceValue);
+            if (fenceValue > FrameLatency)
+                queue.waitForValue(fenceValue - FrameLatency);
+        }
+    }
+    device.getQueue().flush();
+
+    state.setItemsProcessed(state.getIterations());
+    state.setCounter("overflows", static_cast<double>(ring.getStats().overflowCount));
+}
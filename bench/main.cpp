@@ -0,0 +1,227 @@
+#include "Bench.hpp"
+
+#include <map>
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+
+/*
+* Usage: dx12_bench [filter] [--json results.json] [--compare baseline.json] [--threshold percent] [--repetitions N]
+* Only runs benchmarks whose name contains filter
+*
+* --json writes the results as JSON, a file written by it is what --compare reads as baseline
+* --compare fails when ns/op of a benchmark is more than --threshold percent (10 by default) above its baseline,
+*           benchmarks missing from the baseline are reported and never fail
+* --repetitions runs each benchmark N times at the calibrated iteration count and keeps the fastest run,
+*               which is far less noisy to compare than a single run
+*
+* Fails in every mode when a benchmark reports a non zero errors* or mismatch* counter, they check correctness
+*/
+namespace
+{
+    struct Result
+    {
+        std::string name;
+        uint64_t    iterations  = 0;
+        double      nsPerOp     = 0.0;
+        double      itemsPerSec = 0.0;
+
+        std::vector<std::pair<std::string, double>> counters;
+    };
+
+    // Grow iterations until a run takes at least this long
+    constexpr double MinSeconds = 0.2;
+
+    Result run(const Bench::Registration& bench, uint32_t repetitions)
+    {
+        uint64_t     iterations = 1;
+        Bench::State state(iterations);
+        while (true)
+        {
+            state = Bench::State(iterations);
+            bench.function(state);
+            if (state.getSeconds() >= MinSeconds || iterations >= (1ull << 40))
+                break;
+            iterations *= state.getSeconds() < MinSeconds / 10 ? 10 : 2;
+        }
+
+        // Calibration run counts as the first repetition
+        for (uint32_t i = 1; i < repetitions; ++i)
+        {
+            Bench::State repetition(iterations);
+            bench.function(repetition);
+            if (repetition.getSeconds() < state.getSeconds())
+                state = std::move(repetition);
+        }
+
+        Result result;
+        result.name        = bench.name;
+        result.iterations  = iterations;
+        result.nsPerOp     = state.getSeconds() * 1e9 / iterations;
+        result.itemsPerSec = state.getItemsProcessed() / state.getSeconds();
+        for (auto& [name, value] : state.getCounters())
+            result.counters.emplace_back(name, value);
+        return result;
+    }
+
+    // Names are C++ identifiers and counter names string literals of the benches, neither needs escaping
+    bool writeJson(const char* path, const std::vector<Result>& results)
+    {
+        std::string json = "{\n  \"benchmarks\": [\n";
+        char number[64];
+        for (size_t i = 0; i < results.size(); ++i)
+        {
+            auto& result = results[i];
+            json += "    {\"name\": \"" + result.name + "\"";
+            std::snprintf(number, sizeof(number), ", \"iterations\": %llu", static_cast<unsigned long long>(result.iterations));
+            json += number;
+            std::snprintf(number, sizeof(number), ", \"ns_per_op\": %.17g", result.nsPerOp);
+            json += number;
+            std::snprintf(number, sizeof(number), ", \"items_per_second\": %.17g", result.itemsPerSec);
+            json += number;
+            json += ", \"counters\": {";
+            for (size_t c = 0; c < result.counters.size(); ++c)
+            {
+                // JSON has no infinity and NaN
+                auto value = std::isfinite(result.counters[c].second) ? result.counters[c].second : 0.0;
+                json += (c > 0 ? ", \"" : "\"") + result.counters[c].first;
+                std::snprintf(number, sizeof(number), "\": %.17g", value);
+                json += number;
+            }
+            json += i + 1 < results.size() ? "}},\n" : "}}\n";
+        }
+        json += "  ]\n}\n";
+
+        FILE* file = std::fopen(path, "wb");
+        if (file == nullptr)
+            return false;
+        bool ok = std::fwrite(json.data(), 1, json.size(), file) == json.size();
+        return std::fclose(file) == 0 && ok;
+    }
+
+    // ns/op by name from a file written by writeJson(), tolerant of reformatting but not a general JSON parser
+    bool readBaseline(const char* path, std::map<std::string, double>& baseline)
+    {
+        std::ifstream file(path, std::ios::binary);
+        if (!file)
+            return false;
+        std::stringstream buffer;
+        buffer << file.rdbuf();
+        auto json = buffer.str();
+
+        constexpr const char NameKey[]    = "\"name\"";
+        constexpr const char NsPerOpKey[] = "\"ns_per_op\"";
+        size_t position = 0;
+        while ((position = json.find(NameKey, position)) != std::string::npos)
+        {
+            auto begin = json.find('"', json.find(':', position + sizeof(NameKey) - 1));
+            auto end   = begin != std::string::npos ? json.find('"', begin + 1) : std::string::npos;
+            auto key   = end != std::string::npos ? json.find(NsPerOpKey, end) : std::string::npos;
+            auto colon = key != std::string::npos ? json.find(':', key + sizeof(NsPerOpKey) - 1) : std::string::npos;
+            if (colon == std::string::npos)
+                return false;
+
+            char* numberEnd = nullptr;
+            auto  nsPerOp   = std::strtod(json.c_str() + colon + 1, &numberEnd);
+            if (numberEnd == json.c_str() + colon + 1)
+                return false;
+            baseline[json.substr(begin + 1, end - begin - 1)] = nsPerOp;
+            position = colon;
+        }
+        // Every benchmark would be new and nothing compared
+        return !baseline.empty();
+    }
+
+    bool isCorrectnessCounter(const std::string& name) noexcept
+    {
+        return name.rfind("errors", 0) == 0 || name.rfind("mismatch", 0) == 0;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const char* filter       = nullptr;
+    const char* jsonPath     = nullptr;
+    const char* baselinePath = nullptr;
+    double      threshold    = 10.0;
+    uint32_t    repetitions  = 1;
+    for (int i = 1; i < argc; ++i)
+    {
+        bool hasValue = i + 1 < argc;
+        if      (std::strcmp(argv[i], "--json") == 0 && hasValue)        jsonPath     = argv[++i];
+        else if (std::strcmp(argv[i], "--compare") == 0 && hasValue)     baselinePath = argv[++i];
+        else if (std::strcmp(argv[i], "--threshold") == 0 && hasValue)   threshold    = std::strtod(argv[++i], nullptr);
+        else if (std::strcmp(argv[i], "--repetitions") == 0 && hasValue) repetitions  = std::max(1u, static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10)));
+        else if (std::strncmp(argv[i], "--", 2) != 0 && filter == nullptr) filter = argv[i];
+        else
+        {
+            std::fprintf(stderr, "unknown option %s\n", argv[i]);
+            return 2;
+        }
+    }
+
+    // Read first, a missing baseline should not cost a whole run
+    std::map<std::string, double> baseline;
+    if (baselinePath != nullptr && !readBaseline(baselinePath, baseline))
+    {
+        std::fprintf(stderr, "cannot read baseline %s or it has no benchmarks\n", baselinePath);
+        return 2;
+    }
+
+    std::vector<Result> results;
+    uint32_t            failures = 0;
+    std::printf("%-40s %14s %14s %16s\n", "benchmark", "iterations", "ns/op", "items/s");
+    for (auto& bench : Bench::registry())
+    {
+        if (filter != nullptr && std::strstr(bench.name, filter) == nullptr)
+            continue;
+
+        auto result = run(bench, repetitions);
+        std::printf("%-40s %14llu %14.2f %16.0f", result.name.c_str(), static_cast<unsigned long long>(result.iterations), result.nsPerOp, result.itemsPerSec);
+        bool failed = false;
+        for (auto& [name, value] : result.counters)
+        {
+            std::printf("  %s=%g", name.c_str(), value);
+            failed |= isCorrectnessCounter(name) && value != 0.0;
+        }
+        std::printf(failed ? "  FAILED\n" : "\n");
+        failures += failed;
+        results.push_back(std::move(result));
+    }
+
+    if (jsonPath != nullptr && !writeJson(jsonPath, results))
+    {
+        std::fprintf(stderr, "cannot write %s\n", jsonPath);
+        return 2;
+    }
+
+    if (failures > 0)
+        std::printf("%u of %zu benchmarks failed their errors or mismatch counters\n", failures, results.size());
+    if (baselinePath == nullptr)
+        return failures == 0 ? 0 : 1;
+
+    uint32_t regressions = 0;
+    std::printf("\n%-40s %14s %14s %9s\n", "benchmark", "baseline ns", "ns/op", "change");
+    for (auto& result : results)
+    {
+        auto it = baseline.find(result.name);
+        if (it == baseline.end())
+        {
+            std::printf("%-40s %14s %14.2f %9s\n", result.name.c_str(), "-", result.nsPerOp, "new");
+            continue;
+        }
+
+        auto change    = it->second > 0.0 ? (result.nsPerOp / it->second - 1.0) * 100.0 : 0.0;
+        bool regressed = change > threshold;
+        regressions   += regressed;
+        std::printf("%-40s %14.2f %14.2f %+8.1f%%%s\n", result.name.c_str(), it->second, result.nsPerOp, change, regressed ? "  REGRESSED" : "");
+    }
+    std::printf("%u of %zu benchmarks regressed by more than %.1f%%\n", regressions, results.size(), threshold);
+    return regressions == 0 && failures == 0 ? 0 : 1;
+}
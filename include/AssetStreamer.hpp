@@ -0,0 +1,199 @@
+#pragma once
+
+#include "Device.hpp"
+#include "IoQueue.hpp"
+#include "StreamQueue.hpp"
+#include "TlsfAllocator.hpp"
+#include "ResidencyManager.hpp"
+
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+
+namespace GalgameEngine
+{
+    using StreamFile = uint32_t;
+    using StreamId   = uint64_t;
+    constexpr StreamFile InvalidStreamFile = UINT32_MAX;
+    constexpr StreamId   InvalidStream     = 0;
+
+    enum class StreamStatus : uint8_t
+    {
+        None,       // Unknown id, or the request has finished
+        Queued,
+        Reading,
+        Copying,
+        Ready,
+        Failed,
+    };
+
+    // File range streamed into a default heap buffer or a whole texture
+    struct StreamRequest
+    {
+        StreamFile file   = InvalidStreamFile;
+        uint64_t   offset = 0;
+        uint64_t   size   = 0;
+
+        // Destination in common state, it must stay alive until the request finishes or is cancelled
+        Buffer*    buffer       = nullptr;
+        uint64_t   bufferOffset = 0;
+        Texture*   texture      = nullptr;  // File holds rows of rowPitch bytes, like copyBufferToTexture() takes them
+        uint32_t   rowPitch     = 0;
+
+        float      priority = 0.0f;         // Higher streams first
+
+        // Runs in update() with Ready or Failed, a Ready resource can be used by the frame recorded after that update
+        std::function<void(StreamId, StreamStatus)> onComplete;
+    };
+
+    /*
+    * Streams file data into GPU resources without ever blocking the frame
+    *
+    *   queued    requests wait in a priority queue, they can be re-prioritized or cancelled for free
+    *   reading   once per frame the most important ones are read into upload memory by IoQueue,
+    *             as long as the bytes started this frame fit the bandwidth budget and the staging memory has room
+    *   copying   finished reads are copied to their destination by one command list on the copy queue,
+    *             the list signals the copy queue fence
+    *   ready     when the copy fence has passed, the direct queue is told to wait on it, so its next work
+    *             sees the data, and the request calls back. Staging memory is reused at the same time
+    *
+    * update() runs once per frame on the render thread before the frame is recorded, it only polls and
+    * never waits on I/O or GPU. The scheduling runs on any Device, the null device stands in for the copy
+    * queue without GPU and simulates its bandwidth.
+    *
+    * Resources stay in common state the whole time: copy queue copies promote common to copy dest
+    * and the resource decays back to common when the copy list finishes.
+    * With a residency manager destinations are pinned from request until they finish or are cancelled
+    */
+    class AssetStreamer
+    {
+    public:
+        struct Config
+        {
+            uint64_t        stagingSize    = 32ull << 20;   // Upload memory reads land in, the largest request it can take
+            uint64_t        bytesPerFrame  = 8ull << 20;    // Bytes of reads started per update, 0 is no limit
+            uint32_t        copiesPerBatch = 256;           // Copies recorded in one copy list at most
+            IoQueue::Config io;
+        };
+
+        struct Stats
+        {
+            uint64_t requests      = 0;
+            uint64_t completed     = 0;
+            uint64_t failed        = 0;
+            uint64_t cancelled     = 0;
+            uint64_t bytesRead     = 0;
+            uint64_t copyBatches   = 0;
+            uint64_t budgetStalls  = 0;     // Updates which left requests queued for the bandwidth budget
+            uint64_t stagingStalls = 0;     // Updates which left requests queued for staging memory or read depth
+            uint64_t peakStaging   = 0;
+            uint32_t queued        = 0;
+            uint32_t inFlight      = 0;     // Reading or copying
+        };
+
+        AssetStreamer(Device& device, const Config& config, ResidencyManager* residency = nullptr);
+        ~AssetStreamer();
+
+        AssetStreamer(const AssetStreamer&)            = delete;
+        AssetStreamer(AssetStreamer&&)                 = delete;
+        AssetStreamer& operator=(const AssetStreamer&) = delete;
+        AssetStreamer& operator=(AssetStreamer&&)      = delete;
+
+        // InvalidStreamFile when it cannot be opened, files stay open until closed or the streamer is destroyed
+        StreamFile openFile(const std::string& path);
+        // No request of the file may be queued or reading
+        void       closeFile(StreamFile file);
+
+        // InvalidStream when the request is invalid: range out of the file, larger than staging memory,
+        // not exactly one destination, or texture rows which do not fit the size
+        StreamId request(StreamRequest desc);
+        // Return false when the request is not queued
+        bool     setPriority(StreamId id, float priority);
+        // Drop a queued or reading request, it does not call back and its destination is not touched anymore
+        // Return false when it is copying already or unknown
+        bool     cancel(StreamId id);
+
+        StreamStatus getStatus(StreamId id) const;
+
+        // Once per frame: finish copies GPU is done with, record copies of finished reads, start new reads
+        void update();
+        // Block until every request has finished, e.g. behind a loading screen
+        void waitIdle();
+
+        Stats getStats() const noexcept;
+
+        IoQueue::Backend getIoBackend() const noexcept { return m_io.getBackend(); }
+
+    private:
+        struct Pending
+        {
+            StreamRequest             desc;
+            StreamStatus              status    = StreamStatus::Queued;
+            bool                      cancelled = false;    // Cancelled while reading, dropped when the read lands
+            TlsfAllocator::Allocation staging;
+        };
+
+        struct File
+        {
+            IoQueue::FileHandle handle = IoQueue::InvalidFile;
+            uint64_t            size   = 0;
+        };
+
+        struct CopyContext
+        {
+            std::unique_ptr<CommandAllocator> allocator;
+            std::unique_ptr<CommandList>      list;
+        };
+
+        struct Batch
+        {
+            uint64_t              fenceValue;
+            CopyContext           context;
+            std::vector<StreamId> requests;
+        };
+
+        // Hand requests whose copies GPU has finished to the direct queue and call them back
+        void finishBatches();
+        // Take finished reads, with wait block until at least one lands
+        void pollReads(bool wait);
+        // Copy finished reads to their destinations in lists on the copy queue
+        void recordCopies();
+        // Start the most important queued reads the budget, staging memory and read depth allow
+        void startReads();
+
+        void finish(StreamId id, StreamStatus status);
+
+        static const Resource& getDestination(const StreamRequest& desc) noexcept
+        {
+            return desc.buffer != nullptr ? static_cast<const Resource&>(*desc.buffer) : *desc.texture;
+        }
+
+    private:
+        Device&           m_device;
+        CommandQueue&     m_copyQueue;
+        Config            m_config;
+        ResidencyManager* m_residency;
+
+        IoQueue                          m_io;
+        std::vector<File>                m_files;
+        std::vector<StreamFile>          m_freeFiles;
+        std::vector<IoQueue::Completion> m_completions;
+
+        StreamQueue             m_queue;
+        TlsfAllocator           m_stagingAllocator;
+        std::unique_ptr<Buffer> m_staging;      // Persistently mapped upload buffer
+
+        std::unordered_map<StreamId, Pending> m_pending;
+        StreamId                              m_nextId = 1;
+        std::vector<StreamId>                 m_readsDone;  // Read into staging memory, waiting for a copy list
+
+        std::deque<Batch>        m_batches;     // Submitted copy lists in fence order
+        std::vector<CopyContext> m_freeContexts;
+
+        Stats m_stats;
+    };
+}
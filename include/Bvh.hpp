@@ -0,0 +1,82 @@
+#pragma once
+
+#include "MathBatch.hpp"
+
+#include <vector>
+#include <cstdint>
+
+namespace GalgameEngine
+{
+    /*
+    * Bounding volume hierarchy over object boxes, Simd::Width children per node
+    * Child boxes of a node are stored as structure of arrays, one FloatN load per component
+    * tests all children at once. Objects are reordered so every subtree covers a contiguous
+    * range of slots, a subtree entirely inside the frustum is emitted without visiting it.
+    *
+    * build() splits at the median of the largest centroid axis until a node has Width children,
+    * refit() only recomputes the boxes for moved objects and keeps the topology.
+    * Boxes grow looser as objects move away from where they were built, rebuild when that matters
+    */
+    class Bvh
+    {
+    public:
+        static constexpr uint32_t Width     = Simd::Width;
+        static constexpr uint32_t LeafSize  = Width;          // Objects per leaf child, tested with one register
+        static constexpr uint32_t LeafChild = UINT32_MAX;     // child[] of a leaf
+
+        // Extent of unused children, every plane test fails on it
+        static constexpr float EmptyExtent = -1e30f;
+
+        struct alignas(32) Node
+        {
+            float    center[3][Width];
+            float    extent[3][Width];
+            uint32_t first[Width];      // First slot of the child's subtree
+            uint32_t count[Width];      // Objects in the child's subtree, 0 for unused children
+            uint32_t child[Width];      // Node index or LeafChild
+            uint32_t parent     = UINT32_MAX;
+            uint32_t parentSlot = 0;
+        };
+
+        Bvh() = default;
+
+        Bvh(const Bvh&)            = delete;
+        Bvh(Bvh&&)                 = delete;
+        Bvh& operator=(const Bvh&) = delete;
+        Bvh& operator=(Bvh&&)      = delete;
+
+        // World boxes of count objects, object i is bounds.*[c][i]
+        void build(const BoundsStreams& bounds, uint32_t count);
+        // Same objects, new boxes
+        void refit(const BoundsStreams& bounds);
+
+        uint32_t getObjectCount() const noexcept { return static_cast<uint32_t>(m_order.size()); }
+
+        // Root is node 0, empty when there are no objects
+        const std::vector<Node>& getNodes() const noexcept { return m_nodes; }
+
+        // Boxes in slot order, padded with Width empty boxes so a leaf can always be loaded whole
+        const float* getCenters(uint32_t component) const noexcept { return m_center[component].data(); }
+        const float* getExtents(uint32_t component) const noexcept { return m_extent[component].data(); }
+
+        uint32_t getObject(uint32_t slot) const noexcept { return m_order[slot]; }
+        uint32_t getSlot(uint32_t object) const noexcept { return m_slots[object]; }
+
+    private:
+        struct Range
+        {
+            uint32_t begin;
+            uint32_t end;
+        };
+
+        uint32_t createNode(const BoundsStreams& bounds, Range range, uint32_t parent, uint32_t parentSlot);
+        void     splitRange(const BoundsStreams& bounds, Range range, Range& left, Range& right);
+
+    private:
+        std::vector<Node>     m_nodes;
+        std::vector<uint32_t> m_order;          // Object of every slot
+        std::vector<uint32_t> m_slots;          // Slot of every object
+        std::vector<float>    m_center[3];
+        std::vector<float>    m_extent[3];
+    };
+}
@@ -0,0 +1,467 @@
+#pragma once
+
+#include "Hash.hpp"
+#include "Device.hpp"
+
+#include <map>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <cstdint>
+#include <shared_mutex>
+
+namespace GalgameEngine
+{
+    /*
+    * Command stream capture (.gcap), little endian
+    *
+    *   header
+    *   stream  events one after another, an Op byte, the uint32 byte size of its fields and the fields
+    *
+    * Every object the captured device creates gets an id, events refer to objects by it and GPU addresses
+    * become a buffer id and an offset. Command lists are recorded into a stream of their own and written
+    * as a whole when executed, so the stream is in submission order whichever threads recorded.
+    * Upload memory is not captured except indirect arguments, which are copied when their list is executed
+    */
+    namespace CaptureFormat
+    {
+        constexpr uint32_t Magic    = 0x50414347;  // "GCAP"
+        constexpr uint32_t Version  = 1;
+        constexpr uint32_t NoObject = 0;
+
+        enum class Op : uint8_t
+        {
+            // Device, in the order the calls returned
+            CreateTexture,          // id, TextureDesc, state
+            CreateBuffer,           // id, BufferDesc, state
+            CreateHeap,             // id, HeapDesc
+            CreatePlacedTexture,    // id, heap, offset, TextureDesc, state
+            CreatePlacedBuffer,     // id, heap, offset, BufferDesc, state
+            CreateRootSignature,    // id, RootSignatureDesc
+            CreatePipeline,         // id, GraphicsPipelineDesc
+            CreateCommandSignature, // id, byte stride
+            CreateQueryHeap,        // id, count
+            CreateCommandAllocator, // id, queue type
+            CreateCommandList,      // id, queue type
+            CreateSwapChain,        // id, SwapChainDesc, back buffer ids
+            Destroy,                // id
+            ResetAllocator,         // id
+            ExecuteLists,           // queue, count, per list: id, argument copies, command bytes
+            Signal,                 // queue, value
+            WaitForValue,           // queue, value, CPU wait
+            QueueWait,              // queue, other queue, value, GPU wait
+            Present,                // swap chain, sync interval, Timer::now() ticks
+            ResizeSwapChain,        // swap chain, width, height, back buffer ids
+            SetSourceSize,          // swap chain, width, height
+            WaitForFrameLatency,    // swap chain
+
+            // Command list, inside the command bytes of ExecuteLists, an Op byte and the fields
+            ResetList,              // allocator
+            CloseList,
+            SetViewport,
+            SetScissorRect,
+            ResourceBarrier,        // count, per barrier: resource, before, after, flags
+            AliasingBarrier,        // before, after
+            ClearRenderTarget,      // texture, color
+            ClearDepthStencil,      // texture, depth, stencil
+            SetRenderTargets,       // count, targets, depth stencil
+            SetRootSignature,
+            SetPipelineState,
+            SetRootConstantBuffer,  // parameter, buffer, offset
+            SetRootShaderResource,  // parameter, buffer, offset
+            SetVertexBuffers,       // start slot, count, per view: buffer, offset, size, stride
+            SetIndexBuffer,         // buffer, offset, size, format
+            DrawIndexedInstanced,
+            ExecuteIndirect,        // signature, max count, arguments, offset, count buffer, offset
+            CopyBufferRegion,
+            CopyBufferToTexture,
+            WriteTimestamp,
+            ResolveTimestamps,
+
+            Count,
+        };
+
+        struct Header
+        {
+            uint32_t magic;
+            uint32_t version;
+            uint32_t frameCount;        // Presents
+            uint32_t objectCount;       // Ids are 1 to objectCount
+            uint64_t eventCount;
+            uint64_t streamSize;
+            double   secondsPerTick;    // Timer clock of the capturing machine, presents are stamped with it
+            uint64_t checksum;          // Hasher of stream then header, computed with this field zero
+        };
+
+        static_assert(sizeof(Header) == 48);
+    }
+
+    class CaptureDevice;
+    class CaptureBuffer;
+
+    // Object of the captured device, writes its destruction to the stream
+    class CaptureObject
+    {
+    public:
+        virtual ~CaptureObject();
+
+        uint32_t getCaptureId() const noexcept { return m_captureId; }
+
+    protected:
+        CaptureObject(CaptureDevice& device, uint32_t id) noexcept : m_captureDevice(device), m_captureId(id) {}
+
+        CaptureDevice& m_captureDevice;
+
+    private:
+        uint32_t m_captureId;
+    };
+
+    class CaptureTexture : public Texture, public CaptureObject
+    {
+    public:
+        CaptureTexture(CaptureDevice& device, uint32_t id, std::unique_ptr<Texture> texture, ResourceState initialState);
+        // Swap chain buffers belong to the swap chain
+        CaptureTexture(CaptureDevice& device, uint32_t id, Texture& texture);
+
+        const TextureDesc& getDesc() const noexcept override { return m_texture->getDesc(); }
+
+        Heap* getHeap() const noexcept override { return m_texture->getHeap(); }
+
+        Texture& get() const noexcept { return *m_texture; }
+
+    private:
+        std::unique_ptr<Texture> m_owned;
+        Texture*                 m_texture;
+    };
+
+    class CaptureBuffer : public Buffer, public CaptureObject
+    {
+    public:
+        CaptureBuffer(CaptureDevice& device, uint32_t id, std::unique_ptr<Buffer> buffer, ResourceState initialState);
+        ~CaptureBuffer() override;
+
+        const BufferDesc& getDesc() const noexcept override { return m_buffer->getDesc(); }
+
+        Heap* getHeap() const noexcept override { return m_buffer->getHeap(); }
+
+        uint8_t* getMappedData() const noexcept override { return m_buffer->getMappedData(); }
+        uint64_t getGpuAddress() const noexcept override { return m_buffer->getGpuAddress(); }
+
+        Buffer& get() const noexcept { return *m_buffer; }
+
+    private:
+        std::unique_ptr<Buffer> m_buffer;
+    };
+
+    class CaptureHeap : public Heap, public CaptureObject
+    {
+    public:
+        CaptureHeap(CaptureDevice& device, uint32_t id, std::unique_ptr<Heap> heap) : CaptureObject(device, id), m_heap(std::move(heap)) {}
+
+        const HeapDesc& getDesc() const noexcept override { return m_heap->getDesc(); }
+
+        Heap& get() const noexcept { return *m_heap; }
+
+    private:
+        std::unique_ptr<Heap> m_heap;
+    };
+
+    class CaptureRootSignature : public RootSignature, public CaptureObject
+    {
+    public:
+        CaptureRootSignature(CaptureDevice& device, uint32_t id, std::unique_ptr<RootSignature> rootSignature)
+            : CaptureObject(device, id), m_rootSignature(std::move(rootSignature)) {}
+
+        RootSignature& get() const noexcept { return *m_rootSignature; }
+
+    private:
+        std::unique_ptr<RootSignature> m_rootSignature;
+    };
+
+    class CapturePipelineState : public PipelineState, public CaptureObject
+    {
+    public:
+        CapturePipelineState(CaptureDevice& device, uint32_t id, std::unique_ptr<PipelineState> pipeline)
+            : CaptureObject(device, id), m_pipeline(std::move(pipeline)) {}
+
+        std::vector<uint8_t> getCachedBlob() const override { return m_pipeline->getCachedBlob(); }
+
+        PipelineState& get() const noexcept { return *m_pipeline; }
+
+    private:
+        std::unique_ptr<PipelineState> m_pipeline;
+    };
+
+    class CaptureCommandSignature : public CommandSignature, public CaptureObject
+    {
+    public:
+        CaptureCommandSignature(CaptureDevice& device, uint32_t id, std::unique_ptr<CommandSignature> signature)
+            : CaptureObject(device, id), m_signature(std::move(signature)) {}
+
+        uint32_t getByteStride() const noexcept override { return m_signature->getByteStride(); }
+
+        CommandSignature& get() const noexcept { return *m_signature; }
+
+    private:
+        std::unique_ptr<CommandSignature> m_signature;
+    };
+
+    class CaptureTimestampQueryHeap : public TimestampQueryHeap, public CaptureObject
+    {
+    public:
+        CaptureTimestampQueryHeap(CaptureDevice& device, uint32_t id, std::unique_ptr<TimestampQueryHeap> heap)
+            : CaptureObject(device, id), m_heap(std::move(heap)) {}
+
+        uint32_t getCount() const noexcept override { return m_heap->getCount(); }
+
+        TimestampQueryHeap& get() const noexcept { return *m_heap; }
+
+    private:
+        std::unique_ptr<TimestampQueryHeap> m_heap;
+    };
+
+    class CaptureCommandAllocator : public CommandAllocator, public CaptureObject
+    {
+    public:
+        CaptureCommandAllocator(CaptureDevice& device, uint32_t id, std::unique_ptr<CommandAllocator> allocator)
+            : CaptureObject(device, id), m_allocator(std::move(allocator)) {}
+
+        void reset() override;
+
+        CommandAllocator& get() const noexcept { return *m_allocator; }
+
+    private:
+        std::unique_ptr<CommandAllocator> m_allocator;
+    };
+
+    // Records into a stream of its own, no lock is taken while recording
+    class CaptureCommandList : public CommandList, public CaptureObject
+    {
+    public:
+        CaptureCommandList(CaptureDevice& device, uint32_t id, std::unique_ptr<CommandList> list)
+            : CaptureObject(device, id), m_list(std::move(list)) {}
+
+        void reset(CommandAllocator& allocator) override;
+        void close() override;
+
+        void setViewport(const Viewport& viewport) override;
+        void setScissorRect(const Rect& rect) override;
+        void resourceBarrier(const ResourceBarrier* barriers, uint32_t count) override;
+        void aliasingBarrier(Resource* before, Resource* after) override;
+
+        void clearRenderTarget(Texture& target, const float color[4]) override;
+        void clearDepthStencil(Texture& target, float depth, uint8_t stencil) override;
+        void setRenderTargets(Texture* const* targets, uint32_t count, Texture* depthStencil) override;
+
+        void setGraphicsRootSignature(RootSignature& rootSignature) override;
+        void setPipelineState(PipelineState& pipeline) override;
+        void setGraphicsRootConstantBufferView(uint32_t parameter, uint64_t gpuAddress) override;
+        void setGraphicsRootShaderResourceView(uint32_t parameter, uint64_t gpuAddress) override;
+
+        void setVertexBuffers(uint32_t startSlot, const VertexBufferView* views, uint32_t count) override;
+        void setIndexBuffer(const IndexBufferView& view) override;
+        void drawIndexedInstanced(uint32_t indexCount, uint32_t instanceCount, uint32_t startIndex, int32_t baseVertex, uint32_t startInstance) override;
+        void executeIndirect(CommandSignature& signature, uint32_t maxCount, Buffer& arguments, uint64_t argumentOffset,
+                             Buffer* countBuffer, uint64_t countOffset) override;
+
+        void copyBufferRegion(Buffer& dest, uint64_t destOffset, Buffer& source, uint64_t sourceOffset, uint64_t size) override;
+        void copyBufferToTexture(Texture& dest, Buffer& source, uint64_t sourceOffset, uint32_t rowPitch) override;
+
+        void writeTimestamp(TimestampQueryHeap& heap, uint32_t index) override;
+        void resolveTimestamps(TimestampQueryHeap& heap, uint32_t first, uint32_t count, Buffer& dest, uint64_t destOffset) override;
+
+        CommandList& get() const noexcept { return *m_list; }
+
+    private:
+        friend class CaptureCommandQueue;
+
+        // Mapped memory read by the GPU through the list, copied into the stream when the list is executed
+        struct ArgumentRange
+        {
+            CaptureBuffer* buffer;
+            uint64_t       offset;
+            uint64_t       size;
+        };
+
+        void writeAddress(uint64_t gpuAddress);
+
+    private:
+        std::unique_ptr<CommandList> m_list;
+        std::vector<uint8_t>         m_commands;
+        std::vector<ArgumentRange>   m_arguments;
+
+        // Unwrapped arguments of the command being recorded
+        std::vector<ResourceBarrier>  m_barriers;
+        std::vector<VertexBufferView> m_views;
+    };
+
+    class CaptureCommandQueue : public CommandQueue
+    {
+    public:
+        CaptureCommandQueue(CaptureDevice& device, CommandQueue& queue, QueueType type) : m_device(device), m_queue(queue), m_type(type) {}
+
+        void executeCommandLists(CommandList* const* lists, uint32_t count) override;
+
+        uint64_t signal() override;
+        uint64_t getCompletedValue() const override { return m_queue.getCompletedValue(); }
+        void     waitForValue(uint64_t value) override;
+        void     setEventOnCompletion(uint64_t value, SyncEvent& event) override { m_queue.setEventOnCompletion(value, event); }
+        void     wait(CommandQueue& other, uint64_t value) override;
+
+        uint64_t         getTimestampFrequency() const override { return m_queue.getTimestampFrequency(); }
+        ClockCalibration getClockCalibration() const override { return m_queue.getClockCalibration(); }
+
+        CommandQueue& get() const noexcept { return m_queue; }
+
+    private:
+        CaptureDevice& m_device;
+        CommandQueue&  m_queue;
+        QueueType      m_type;
+
+        // Submissions and signals of a queue reach the stream in the order they reached the queue
+        std::mutex                m_mutex;
+        std::vector<CommandList*> m_lists;    // Unwrapped lists of a submission
+    };
+
+    class CaptureSwapChain : public SwapChain, public CaptureObject
+    {
+    public:
+        CaptureSwapChain(CaptureDevice& device, uint32_t id, std::unique_ptr<SwapChain> swapChain);
+
+        uint32_t getBufferCount() const noexcept override { return m_swapChain->getBufferCount(); }
+        uint32_t getCurrentBackBufferIndex() const override { return m_swapChain->getCurrentBackBufferIndex(); }
+        Texture& getBackBuffer(uint32_t index) override { return *m_buffers[index]; }
+
+        void present(uint32_t syncInterval) override;
+        void resize(uint32_t width, uint32_t height) override;
+        void setSourceSize(uint32_t width, uint32_t height) override;
+        void waitForFrameLatency() override;
+
+    private:
+        friend class CaptureDevice;
+
+        // Back buffers of the wrapped swap chain are new after every resize, so are their ids
+        void wrapBuffers();
+
+    private:
+        std::unique_ptr<SwapChain>                   m_swapChain;
+        std::vector<std::unique_ptr<CaptureTexture>> m_buffers;
+    };
+
+    /*
+    * Device which forwards everything to another device and captures it into a .gcap file
+    * Resource creation, submissions, fences, presents and resizes go into the stream,
+    * queries, descriptor allocation and residency changes are not captured, a replay keeps every heap resident.
+    * The stream is written to the file as it grows, finish() completes the file, the destructor does too.
+    * Objects created through it must be destroyed before it
+    *
+    * Thread safe like the device it wraps
+    */
+    class CaptureDevice : public Device
+    {
+    public:
+        struct Config
+        {
+            uint64_t flushBytes = 4 << 20;  // Stream is written to the file in pieces of about this size
+        };
+
+        struct Stats
+        {
+            uint32_t frames  = 0;
+            uint32_t objects = 0;
+            uint64_t events  = 0;
+            uint64_t bytes   = 0;   // Stream so far
+        };
+
+        // Throws std::runtime_error when the file cannot be created
+        CaptureDevice(Device& device, const std::string& path) : CaptureDevice(device, path, Config()) {}
+        CaptureDevice(Device& device, const std::string& path, const Config& config);
+        ~CaptureDevice() override;
+
+        CaptureDevice(const CaptureDevice&)            = delete;
+        CaptureDevice(CaptureDevice&&)                 = delete;
+        CaptureDevice& operator=(const CaptureDevice&) = delete;
+        CaptureDevice& operator=(CaptureDevice&&)      = delete;
+
+        CommandQueue& getQueue() override { return *m_queue; }
+        CommandQueue& getCopyQueue() override { return *m_copyQueue; }
+
+        std::unique_ptr<CommandAllocator> createCommandAllocator(QueueType type = QueueType::Direct) override;
+        std::unique_ptr<CommandList>      createCommandList(QueueType type = QueueType::Direct) override;
+        std::unique_ptr<SwapChain>        createSwapChain(const SwapChainDesc& desc) override;
+        std::unique_ptr<Texture>          createTexture(const TextureDesc& desc, ResourceState initialState) override;
+        std::unique_ptr<Buffer>           createBuffer(const BufferDesc& desc, ResourceState initialState) override;
+        std::unique_ptr<Heap>             createHeap(const HeapDesc& desc) override;
+
+        std::unique_ptr<TimestampQueryHeap> createTimestampQueryHeap(uint32_t count) override;
+        std::unique_ptr<CommandSignature>   createCommandSignature(uint32_t byteStride) override;
+
+        std::unique_ptr<Texture> createPlacedTexture(Heap& heap, uint64_t offset, const TextureDesc& desc, ResourceState initialState) override;
+        AllocationInfo           getTextureAllocationInfo(const TextureDesc& desc) override { return m_device.getTextureAllocationInfo(desc); }
+
+        std::unique_ptr<Buffer> createPlacedBuffer(Heap& heap, uint64_t offset, const BufferDesc& desc, ResourceState initialState) override;
+
+        std::unique_ptr<RootSignature> createRootSignature(const RootSignatureDesc& desc) override;
+        std::unique_ptr<PipelineState> createGraphicsPipeline(const GraphicsPipelineDesc& desc, const std::vector<uint8_t>* cachedBlob) override;
+
+        MemoryAllocator& getMemoryAllocator() override { return m_device.getMemoryAllocator(); }
+
+        MemoryBudget queryMemoryBudget() override { return m_device.queryMemoryBudget(); }
+        void         evict(Heap* const* heaps, uint32_t count) override { m_device.evict(heaps, count); }
+        void         makeResident(Heap* const* heaps, uint32_t count) override { m_device.makeResident(heaps, count); }
+
+        DescriptorAllocator& getDescriptorAllocator(DescriptorHeapType type) override { return m_device.getDescriptorAllocator(type); }
+
+        // Write what is left of the stream and the header, false when writing the file failed
+        // Nothing is captured afterwards
+        bool finish();
+
+        Stats getStats() const;
+
+    private:
+        friend class CaptureObject;
+        friend class CaptureBuffer;
+        friend class CaptureCommandAllocator;
+        friend class CaptureCommandList;
+        friend class CaptureCommandQueue;
+        friend class CaptureSwapChain;
+
+        uint32_t allocateId() noexcept { return m_nextId.fetch_add(1, std::memory_order_relaxed); }
+
+        // Append one event under the stream lock, fields(stream) writes what follows the op
+        template <typename Fields>
+        void record(CaptureFormat::Op op, const Fields& fields);
+        // Caller holds the stream lock
+        void flush(bool all);
+
+        // Buffer holding a GPU address, NoObject and the address itself when no captured buffer does
+        void resolveAddress(uint64_t gpuAddress, uint32_t& buffer, uint64_t& offset) const;
+        void addBuffer(CaptureBuffer& buffer);
+        void removeBuffer(CaptureBuffer& buffer);
+
+    private:
+        Device& m_device;
+        Config  m_config;
+
+        std::unique_ptr<CaptureCommandQueue> m_queue;
+        std::unique_ptr<CaptureCommandQueue> m_copyQueue;
+
+        std::atomic<uint32_t> m_nextId = 1;
+
+        mutable std::mutex   m_mutex;   // Stream and file
+        std::ofstream        m_file;
+        std::vector<uint8_t> m_stream;
+        Hasher               m_hasher;              // Of the stream written so far
+        uint64_t             m_written    = 0;
+        uint64_t             m_eventCount = 0;
+        uint32_t             m_frameCount = 0;
+        bool                 m_finished   = false;
+        bool                 m_failed     = false;
+
+        mutable std::shared_mutex         m_addressMutex;
+        std::map<uint64_t, CaptureBuffer*> m_addresses;     // By GPU address of the buffer
+    };
+}
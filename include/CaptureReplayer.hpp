@@ -0,0 +1,160 @@
+#pragma once
+
+#include "Device.hpp"
+#include "MappedFile.hpp"
+#include "CaptureDevice.hpp"
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+namespace GalgameEngine
+{
+    class CaptureReader;
+
+    /*
+    * Runs a .gcap capture against a device, the null backend or a real one
+    * Objects are created under the ids of the capture, GPU addresses are rebased onto the replayed buffers
+    * and fence values are mapped onto what the replayed queues signal. Waits of the capture are replayed
+    * where they happened, but the replayed GPU runs on its own timeline, so before an allocator is reset
+    * or an object is released the replay also waits for the GPU work which may still use it
+    *
+    * Frames end at presents, each is timed from the previous present, like the capture stamped them
+    */
+    class CaptureReplayer
+    {
+    public:
+        struct Config
+        {
+            void* window = nullptr;                 // Swap chains are created for it, headless backends ignore it
+            bool  createPipelinesFirst = true;      // Root signatures and pipelines before the first event, compiles stay out of frames
+        };
+
+        struct Stats
+        {
+            uint32_t frames      = 0;
+            uint64_t events      = 0;
+            uint64_t lists       = 0;   // Executed command lists
+            uint64_t commands    = 0;
+            uint64_t objects     = 0;   // Created
+            uint64_t safetyWaits = 0;   // Blocking waits the capture did not have
+            double   seconds     = 0.0; // First to last event
+        };
+
+        explicit CaptureReplayer(Device& device) : CaptureReplayer(device, Config()) {}
+        CaptureReplayer(Device& device, const Config& config);
+        ~CaptureReplayer();
+
+        CaptureReplayer(const CaptureReplayer&)            = delete;
+        CaptureReplayer(CaptureReplayer&&)                 = delete;
+        CaptureReplayer& operator=(const CaptureReplayer&) = delete;
+        CaptureReplayer& operator=(CaptureReplayer&&)      = delete;
+
+        // Return false when the file is missing or header and checksum are invalid
+        bool open(const std::string& path);
+        void close() noexcept;
+
+        // Run the whole capture once, the queues are flushed and everything it created is released at the end,
+        // so it can run again. Return false at the first malformed event, the replay stops there
+        bool replay();
+
+        const CaptureFormat::Header& getHeader() const noexcept { return *m_header; }
+        const Stats&                 getStats() const noexcept { return m_stats; }
+
+        // Seconds between presents of the last replay and between the same presents in the capture
+        const std::vector<double>& getFrameTimes() const noexcept { return m_frameTimes; }
+        const std::vector<double>& getCapturedFrameTimes() const noexcept { return m_capturedFrameTimes; }
+
+        bool isOpen() const noexcept { return m_header != nullptr; }
+
+    private:
+        enum class ObjectType : uint8_t
+        {
+            None,
+            Texture,
+            Buffer,
+            Heap,
+            RootSignature,
+            Pipeline,
+            CommandSignature,
+            QueryHeap,
+            CommandAllocator,
+            CommandList,
+            SwapChain,
+        };
+
+        static constexpr size_t NoSignal = SIZE_MAX;
+
+        struct Object
+        {
+            ObjectType            type    = ObjectType::None;
+            void*                 pointer = nullptr;    // Of the type
+            std::shared_ptr<void> owner;                // Null for back buffers, they belong to their swap chain
+
+            // Allocators, signal of the queue covering the last execution of commands from it
+            uint32_t queue  = 0;
+            size_t   signal = NoSignal;
+        };
+
+        // Released once the signals following the last executions on both queues have completed
+        struct Retired
+        {
+            std::shared_ptr<void> owner;
+            size_t                signals[2];
+        };
+
+        // Captured fence value and the value the replayed queue signaled in its place
+        struct Signal
+        {
+            uint64_t captured;
+            uint64_t replayed;
+        };
+
+        bool replayEvent(CaptureFormat::Op op, CaptureReader& reader);
+        bool replayLists(CaptureReader& reader);
+        bool replayCommand(CaptureFormat::Op op, CaptureReader& reader, CommandList& list, uint32_t queue);
+        bool createPipelines();
+
+        template <typename T>
+        T*        get(uint32_t id, ObjectType type) const noexcept;
+        Resource* getResource(uint32_t id) const noexcept;
+        // Address in a replayed buffer, addresses outside every captured buffer stay as they were
+        uint64_t  getAddress(uint32_t buffer, uint64_t offset) const noexcept;
+
+        // False for ids outside the capture, a backend failing to create an object leaves it missing
+        template <typename T>
+        bool add(uint32_t id, ObjectType type, std::unique_ptr<T> object);
+        bool addBackBuffers(uint32_t swapChain, CaptureReader& reader);
+        void release(uint32_t id);
+        void releaseCompleted(bool all);
+
+        CommandQueue& getQueue(uint32_t queue) noexcept;
+        uint64_t      mapFence(uint32_t queue, uint64_t captured) const noexcept;
+        bool          isSignalCompleted(uint32_t queue, size_t signal) noexcept;
+        void          waitForSignal(uint32_t queue, size_t signal);
+
+    private:
+        Device& m_device;
+        Config  m_config;
+
+        MappedFile                   m_file;
+        const CaptureFormat::Header* m_header = nullptr;
+
+        std::vector<Object>  m_objects;         // By id
+        std::vector<Retired> m_retired;
+        std::vector<Signal>  m_signals[2];      // By queue type, in signal order
+        size_t               m_pending[2] = { NoSignal, NoSignal };    // Signal covering the last execution on each queue
+
+        // Arguments of the command being replayed
+        std::vector<CommandList*>     m_lists;
+        std::vector<ResourceBarrier>  m_barriers;
+        std::vector<VertexBufferView> m_views;
+
+        Stats               m_stats;
+        std::vector<double> m_frameTimes;
+        std::vector<double> m_capturedFrameTimes;
+        int64_t             m_lastPresent         = 0;
+        int64_t             m_lastCapturedPresent = 0;
+    };
+}
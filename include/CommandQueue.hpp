@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+
+namespace GalgameEngine
+{
+    class SyncEvent;
+    class CommandList;
+
+    enum class QueueType : uint8_t
+    {
+        Direct,     // All kinds of commands
+        Copy,       // Only copies, runs beside the direct queue on the copy engine
+    };
+
+    // GPU timestamp and CPU time sampled at the same moment, maps GPU timestamps onto the Timer clock
+    struct ClockCalibration
+    {
+        uint64_t gpuTimestamp = 0;
+        int64_t  cpuTicks     = 0;  // Timer::now() ticks
+    };
+
+    /*
+    * Abstract GPU queue with its own timeline fence
+    * Frame logic only talks to this interface, so it can run on D3D12 or on a mock backend without GPU
+    * Fence values are monotonically increasing, every signal() returns a bigger value
+    */
+    class CommandQueue
+    {
+    public:
+        virtual ~CommandQueue() = default;
+
+        // Submit closed command lists, they execute in order
+        virtual void executeCommandLists(CommandList* const* lists, uint32_t count) = 0;
+
+        // Signal fence after all submitted work, return the signaled value
+        virtual uint64_t signal() = 0;
+        // The last fence value GPU has reached
+        virtual uint64_t getCompletedValue() const = 0;
+        // Block CPU until GPU has reached the fence value
+        virtual void waitForValue(uint64_t value) = 0;
+        // Signal the event once GPU has reached the fence value, at once if it already has
+        virtual void setEventOnCompletion(uint64_t value, SyncEvent& event) = 0;
+        // Make GPU hold work submitted after this call until the other queue has reached the fence value
+        // CPU does not block, this is how results of one queue are handed to another
+        virtual void wait(CommandQueue& other, uint64_t value) = 0;
+
+        // Ticks per second of timestamps written by command lists executed on the queue
+        virtual uint64_t         getTimestampFrequency() const = 0;
+        // GPU and CPU clocks drift apart slowly, calibrate again every now and then
+        virtual ClockCalibration getClockCalibration() const = 0;
+
+        bool isCompleted(uint64_t value) const { return getCompletedValue() >= value; }
+
+        // Wait GPU finish all submitted work
+        void flush() { waitForValue(signal()); }
+    };
+}
@@ -0,0 +1,168 @@
+#pragma once
+
+#include "Bvh.hpp"
+#include "Math.hpp"
+
+#include <vector>
+#include <cstdint>
+
+namespace GalgameEngine
+{
+    class JobSystem;
+
+    // Six planes pointing inside, (x, y, z) normal and w distance, not normalized
+    struct Frustum
+    {
+        Vec4 planes[6];
+
+        // Planes of the clip volume of a view projection (row vectors, depth 0 to 1)
+        static Frustum fromViewProjection(const Mat4& viewProjection) noexcept;
+    };
+
+    /*
+    * Small CPU depth buffer for occlusion culling
+    * A few large occluders are rasterized as their boxes at the depth of their farthest corner, which only
+    * ever claims less occlusion than the real geometry has. An object is occluded when the depth under
+    * every pixel its screen rectangle touches is nearer than its nearest corner.
+    * Rows can be rasterized in bands on several threads, rows are 8 floats wide multiples for the SIMD loops
+    */
+    class OcclusionBuffer
+    {
+    public:
+        struct Config
+        {
+            uint32_t width  = 256;      // Rounded up to a multiple of 8
+            uint32_t height = 128;
+        };
+
+        explicit OcclusionBuffer(const Config& config);
+
+        OcclusionBuffer(const OcclusionBuffer&)            = delete;
+        OcclusionBuffer(OcclusionBuffer&&)                 = delete;
+        OcclusionBuffer& operator=(const OcclusionBuffer&) = delete;
+        OcclusionBuffer& operator=(OcclusionBuffer&&)      = delete;
+
+        // Drop occluders and start a new view
+        void begin(const Mat4& viewProjection);
+
+        // Queue the box for rasterization, boxes crossing the near plane are skipped
+        bool addOccluder(Vec3 center, Vec3 extent);
+
+        // Clear and rasterize queued occluders into rows [rowBegin, rowEnd), bands may run in parallel
+        void rasterize(uint32_t rowBegin, uint32_t rowEnd);
+
+        // After all rows are rasterized
+        bool isVisible(Vec3 center, Vec3 extent) const noexcept;
+
+        uint32_t getWidth()  const noexcept { return m_width; }
+        uint32_t getHeight() const noexcept { return m_height; }
+        uint32_t getTriangleCount() const noexcept { return static_cast<uint32_t>(m_triangles.size()); }
+
+        // Depth in [0, 1], 1 where no occluder was rasterized
+        const float* getDepth() const noexcept { return m_depth.data(); }
+
+    private:
+        // Screen space, edge functions are a * x + b * y + c >= 0 inside
+        struct Triangle
+        {
+            float    a[3];
+            float    b[3];
+            float    c[3];
+            float    depth;
+            int32_t  minX, minY, maxX, maxY;
+        };
+
+        struct ScreenBox
+        {
+            float x[8];
+            float y[8];
+            float z[8];
+        };
+
+        // False when a corner is behind the near plane
+        bool project(Vec3 center, Vec3 extent, ScreenBox& box) const noexcept;
+
+    private:
+        uint32_t           m_width;
+        uint32_t           m_height;
+        std::vector<float> m_depth;
+        Mat4               m_viewProjection;
+
+        std::vector<Triangle> m_triangles;
+    };
+
+    /*
+    * Visible objects of a BVH for one view
+    * Frustum tests cover a BVH node's Width children or a leaf's objects per register. Subtrees below the first
+    * levels are traversed as jobs, then the objects inside the frustum are tested against the occlusion buffer
+    * in ranges. Every job writes its own list and the lists are joined in job order
+    */
+    class Culler
+    {
+    public:
+        struct Config
+        {
+            bool                    occlusion = true;
+            OcclusionBuffer::Config occlusionBuffer;
+            uint32_t                occlusionGrain = 2048;  // Objects per occlusion test job
+        };
+
+        struct Stats
+        {
+            uint32_t objects        = 0;
+            uint32_t nodesVisited   = 0;
+            uint32_t frustumVisible = 0;
+            uint32_t occluded       = 0;
+            uint32_t visible        = 0;
+            uint32_t occluders      = 0;    // Rasterized, occluders crossing the near plane are not
+        };
+
+        explicit Culler(const Config& config);
+
+        Culler(const Culler&)            = delete;
+        Culler(Culler&&)                 = delete;
+        Culler& operator=(const Culler&) = delete;
+        Culler& operator=(Culler&&)      = delete;
+
+        /*
+        * Fill visible with the indices of the objects to draw, in an order independent of the thread count
+        * occluders are object indices, usually a few large objects near the camera
+        * Work is spread over the job system when set, call it from a thread of the system then
+        */
+        void cull(const Bvh& bvh, const Mat4& viewProjection, const uint32_t* occluders, uint32_t occluderCount,
+                  JobSystem* jobSystem, std::vector<uint32_t>& visible);
+
+        const Stats&           getStats() const noexcept { return m_stats; }
+        const OcclusionBuffer& getOcclusionBuffer() const noexcept { return m_occlusionBuffer; }
+
+    private:
+        struct Planes
+        {
+            Simd::FloatN x[6], y[6], z[6], w[6];
+            Simd::FloatN absX[6], absY[6], absZ[6];
+        };
+
+        struct Task
+        {
+            std::vector<uint32_t> slots;        // BVH slots inside the frustum
+            std::vector<uint32_t> splits;       // Size of slots when each queued subtree was reached
+            uint32_t              nodesVisited = 0;
+        };
+
+        // Frustum test of one node, subtrees at splitDepth are queued as tasks instead of visited
+        void traverse(const Bvh& bvh, uint32_t node, uint32_t depth, uint32_t splitDepth, Task& task);
+
+    private:
+        Config          m_config;
+        OcclusionBuffer m_occlusionBuffer;
+        Planes          m_planes;
+
+        Task                               m_rootTask;      // Levels above the split depth
+        std::vector<uint32_t>              m_taskNodes;
+        std::vector<Task>                  m_tasks;
+        std::vector<uint32_t>              m_frustumSlots;
+        std::vector<std::vector<uint32_t>> m_occlusionOutputs;
+
+        Stats m_stats;
+    };
+}
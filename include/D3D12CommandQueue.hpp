@@ -0,0 +1,42 @@
+#pragma once
+
+#include "SyncEvent.hpp"
+#include "CommandQueue.hpp"
+
+#include <wrl.h>
+#include <d3d12.h>
+
+namespace GalgameEngine
+{
+    // D3D12 command queue together with the fence used to track its timeline
+    class D3D12CommandQueue : public CommandQueue
+    {
+    public:
+        D3D12CommandQueue(ID3D12Device* device, D3D12_COMMAND_LIST_TYPE type = D3D12_COMMAND_LIST_TYPE_DIRECT);
+        ~D3D12CommandQueue() override = default;
+
+        D3D12CommandQueue(const D3D12CommandQueue&)            = delete;
+        D3D12CommandQueue(D3D12CommandQueue&&)                 = delete;
+        D3D12CommandQueue& operator=(const D3D12CommandQueue&) = delete;
+        D3D12CommandQueue& operator=(D3D12CommandQueue&&)      = delete;
+
+        void executeCommandLists(CommandList* const* lists, uint32_t count) override;
+
+        uint64_t signal() override;
+        uint64_t getCompletedValue() const override;
+        void     waitForValue(uint64_t value) override;
+        void     setEventOnCompletion(uint64_t value, SyncEvent& event) override;
+        void     wait(CommandQueue& other, uint64_t value) override;
+
+        uint64_t         getTimestampFrequency() const override;
+        ClockCalibration getClockCalibration() const override;
+
+        ID3D12CommandQueue* get() const noexcept { return m_queue.Get(); }
+
+    private:
+        Microsoft::WRL::ComPtr<ID3D12CommandQueue> m_queue;
+        Microsoft::WRL::ComPtr<ID3D12Fence>        m_fence;      // Use for CPU GPU synchronization
+        uint64_t                                   m_fenceValue = 0;
+        SyncEventPool                              m_waitEvents; // Reused by waitForValue(), one per waiting thread
+    };
+}
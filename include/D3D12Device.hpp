@@ -0,0 +1,340 @@
+#pragma once
+
+#include "Device.hpp"
+#include "D3D12CommandQueue.hpp"
+#include "MemoryAllocator.hpp"
+
+#include <vector>
+
+#include <wrl.h>
+#include <d3d12.h>
+#include <dxgi1_4.h>
+
+namespace GalgameEngine
+{
+    class D3D12Device;
+
+    DXGI_FORMAT           toDXGIFormat(Format format) noexcept;
+    D3D12_RESOURCE_STATES toD3D12State(ResourceState state) noexcept;
+    D3D12_RESOURCE_BARRIER_FLAGS toD3D12BarrierFlags(BarrierFlags flags) noexcept;
+
+    /*
+    * Descriptor is a structure that stores resource information
+    * Descriptor Heap is an array of descriptors
+    * Descriptor Handle is a pointer to a descriptor in Descriptor Heap
+    * Descriptor Size is used to offset descriptor in its heap
+    *
+    * Every heap type is one heap created with full capacity, indices come from its DescriptorAllocator
+    */
+    class D3D12DescriptorHeap
+    {
+    public:
+        D3D12DescriptorHeap(ID3D12Device* device, D3D12_DESCRIPTOR_HEAP_TYPE type, DescriptorHeapCapacity capacity, bool shaderVisible);
+
+        DescriptorAllocator& getAllocator() noexcept { return m_allocator; }
+
+        D3D12_CPU_DESCRIPTOR_HANDLE getCpuHandle(uint32_t index) const noexcept
+        {
+            return { m_cpuStart.ptr + static_cast<SIZE_T>(index) * m_descriptorSize };
+        }
+        D3D12_GPU_DESCRIPTOR_HANDLE getGpuHandle(uint32_t index) const noexcept
+        {
+            return { m_gpuStart.ptr + static_cast<UINT64>(index) * m_descriptorSize };
+        }
+
+        ID3D12DescriptorHeap* get() const noexcept { return m_heap.Get(); }
+
+    private:
+        Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> m_heap;
+        UINT                                         m_descriptorSize;
+        D3D12_CPU_DESCRIPTOR_HANDLE                  m_cpuStart = {};
+        D3D12_GPU_DESCRIPTOR_HANDLE                  m_gpuStart = {};   // Only valid for shader visible heap
+        DescriptorAllocator                          m_allocator;
+    };
+
+    /*
+    * Resource is actual resource memory for GPU
+    * CPU need to use descriptor bulid relationship with resource to access them
+    */
+    class D3D12Resource
+    {
+    public:
+        virtual ~D3D12Resource();
+
+        ID3D12Resource* get() const noexcept { return m_resource.Get(); }
+
+        // Heap memory the resource is placed in, given back to the allocator when the resource is destroyed
+        void setAllocation(MemoryAllocator& allocator, const MemoryAllocation& allocation) noexcept
+        {
+            m_allocator  = &allocator;
+            m_allocation = allocation;
+        }
+
+    protected:
+        explicit D3D12Resource(Microsoft::WRL::ComPtr<ID3D12Resource> resource) : m_resource(std::move(resource)) {}
+
+        Heap* getAllocationHeap() const noexcept { return m_allocation.heap; }
+
+        Microsoft::WRL::ComPtr<ID3D12Resource> m_resource;
+
+    private:
+        MemoryAllocator* m_allocator = nullptr;
+        MemoryAllocation m_allocation;
+    };
+
+    // Get the D3D12 resource behind a backend-neutral resource
+    ID3D12Resource* toD3D12Resource(Resource* resource) noexcept;
+
+    class D3D12Texture : public Texture, public D3D12Resource
+    {
+    public:
+        D3D12Texture(D3D12Device& device, Microsoft::WRL::ComPtr<ID3D12Resource> resource, const TextureDesc& desc, ResourceState initialState);
+        ~D3D12Texture() override;
+
+        const TextureDesc& getDesc() const noexcept override { return m_desc; }
+
+        Heap* getHeap() const noexcept override { return getAllocationHeap(); }
+
+        D3D12_CPU_DESCRIPTOR_HANDLE getRtv() const noexcept { return m_rtv; }
+        D3D12_CPU_DESCRIPTOR_HANDLE getDsv() const noexcept { return m_dsv; }
+
+    private:
+        D3D12Device&                m_device;
+        TextureDesc                 m_desc;
+        uint32_t                    m_rtvIndex = DescriptorAllocator::InvalidIndex;
+        uint32_t                    m_dsvIndex = DescriptorAllocator::InvalidIndex;
+        D3D12_CPU_DESCRIPTOR_HANDLE m_rtv      = {};
+        D3D12_CPU_DESCRIPTOR_HANDLE m_dsv      = {};
+    };
+
+    class D3D12Buffer : public Buffer, public D3D12Resource
+    {
+    public:
+        D3D12Buffer(Microsoft::WRL::ComPtr<ID3D12Resource> resource, const BufferDesc& desc, ResourceState initialState);
+        ~D3D12Buffer() override;
+
+        const BufferDesc& getDesc() const noexcept override { return m_desc; }
+
+        Heap* getHeap() const noexcept override { return getAllocationHeap(); }
+
+        uint8_t* getMappedData() const noexcept override { return m_mappedData; }
+        uint64_t getGpuAddress() const noexcept override { return m_resource->GetGPUVirtualAddress(); }
+
+    private:
+        BufferDesc m_desc;
+        uint8_t*   m_mappedData = nullptr;
+    };
+
+    class D3D12Heap : public Heap
+    {
+    public:
+        D3D12Heap(Microsoft::WRL::ComPtr<ID3D12Heap> heap, const HeapDesc& desc) : m_heap(std::move(heap)), m_desc(desc) {}
+
+        const HeapDesc& getDesc() const noexcept override { return m_desc; }
+
+        ID3D12Heap* get() const noexcept { return m_heap.Get(); }
+
+    private:
+        Microsoft::WRL::ComPtr<ID3D12Heap> m_heap;
+        HeapDesc                           m_desc;
+    };
+
+    class D3D12TimestampQueryHeap : public TimestampQueryHeap
+    {
+    public:
+        D3D12TimestampQueryHeap(Microsoft::WRL::ComPtr<ID3D12QueryHeap> heap, uint32_t count) : m_heap(std::move(heap)), m_count(count) {}
+
+        uint32_t getCount() const noexcept override { return m_count; }
+
+        ID3D12QueryHeap* get() const noexcept { return m_heap.Get(); }
+
+    private:
+        Microsoft::WRL::ComPtr<ID3D12QueryHeap> m_heap;
+        uint32_t                                m_count;
+    };
+
+    class D3D12CommandAllocator : public CommandAllocator
+    {
+    public:
+        D3D12CommandAllocator(ID3D12Device* device, QueueType type);
+
+        void reset() override;
+
+        ID3D12CommandAllocator* get() const noexcept { return m_allocator.Get(); }
+
+    private:
+        Microsoft::WRL::ComPtr<ID3D12CommandAllocator> m_allocator;     // Allocate memory for commands
+    };
+
+    class D3D12CommandList : public CommandList
+    {
+    public:
+        D3D12CommandList(D3D12Device& device, QueueType type);
+
+        void reset(CommandAllocator& allocator) override;
+        void close() override;
+
+        void setViewport(const Viewport& viewport) override;
+        void setScissorRect(const Rect& rect) override;
+        void resourceBarrier(const ResourceBarrier* barriers, uint32_t count) override;
+        void aliasingBarrier(Resource* before, Resource* after) override;
+
+        void clearRenderTarget(Texture& target, const float color[4]) override;
+        void clearDepthStencil(Texture& target, float depth, uint8_t stencil) override;
+        void setRenderTargets(Texture* const* targets, uint32_t count, Texture* depthStencil) override;
+
+        void setGraphicsRootSignature(RootSignature& rootSignature) override;
+        void setPipelineState(PipelineState& pipeline) override;
+        void setGraphicsRootConstantBufferView(uint32_t parameter, uint64_t gpuAddress) override;
+        void setGraphicsRootShaderResourceView(uint32_t parameter, uint64_t gpuAddress) override;
+
+        void setVertexBuffers(uint32_t startSlot, const VertexBufferView* views, uint32_t count) override;
+        void setIndexBuffer(const IndexBufferView& view) override;
+        void drawIndexedInstanced(uint32_t indexCount, uint32_t instanceCount, uint32_t startIndex, int32_t baseVertex, uint32_t startInstance) override;
+        void executeIndirect(CommandSignature& signature, uint32_t maxCount, Buffer& arguments, uint64_t argumentOffset,
+                             Buffer* countBuffer, uint64_t countOffset) override;
+
+        void copyBufferRegion(Buffer& dest, uint64_t destOffset, Buffer& source, uint64_t sourceOffset, uint64_t size) override;
+        void copyBufferToTexture(Texture& dest, Buffer& source, uint64_t sourceOffset, uint32_t rowPitch) override;
+
+        void writeTimestamp(TimestampQueryHeap& heap, uint32_t index) override;
+        void resolveTimestamps(TimestampQueryHeap& heap, uint32_t first, uint32_t count, Buffer& dest, uint64_t destOffset) override;
+
+        ID3D12GraphicsCommandList* get() const noexcept { return m_list.Get(); }
+
+    private:
+        D3D12Device&                                      m_device;
+        QueueType                                         m_type;
+        Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList> m_list;      // Records commands
+    };
+
+    class D3D12RootSignature : public RootSignature
+    {
+    public:
+        explicit D3D12RootSignature(Microsoft::WRL::ComPtr<ID3D12RootSignature> rootSignature) : m_rootSignature(std::move(rootSignature)) {}
+
+        ID3D12RootSignature* get() const noexcept { return m_rootSignature.Get(); }
+
+    private:
+        Microsoft::WRL::ComPtr<ID3D12RootSignature> m_rootSignature;
+    };
+
+    class D3D12PipelineState : public PipelineState
+    {
+    public:
+        // Topology is input assembler state in D3D12, it is set with the pipeline
+        D3D12PipelineState(Microsoft::WRL::ComPtr<ID3D12PipelineState> pipeline, D3D12_PRIMITIVE_TOPOLOGY topology)
+            : m_pipeline(std::move(pipeline)), m_topology(topology) {}
+
+        std::vector<uint8_t> getCachedBlob() const override;
+
+        ID3D12PipelineState*     get() const noexcept { return m_pipeline.Get(); }
+        D3D12_PRIMITIVE_TOPOLOGY getTopology() const noexcept { return m_topology; }
+
+    private:
+        Microsoft::WRL::ComPtr<ID3D12PipelineState> m_pipeline;
+        D3D12_PRIMITIVE_TOPOLOGY                    m_topology;
+    };
+
+    class D3D12CommandSignature : public CommandSignature
+    {
+    public:
+        D3D12CommandSignature(Microsoft::WRL::ComPtr<ID3D12CommandSignature> signature, uint32_t byteStride)
+            : m_signature(std::move(signature)), m_byteStride(byteStride) {}
+
+        uint32_t getByteStride() const noexcept override { return m_byteStride; }
+
+        ID3D12CommandSignature* get() const noexcept { return m_signature.Get(); }
+
+    private:
+        Microsoft::WRL::ComPtr<ID3D12CommandSignature> m_signature;
+        uint32_t                                       m_byteStride;
+    };
+
+    class D3D12SwapChain : public SwapChain
+    {
+    public:
+        D3D12SwapChain(D3D12Device& device, const SwapChainDesc& desc);
+        ~D3D12SwapChain() override;
+
+        uint32_t getBufferCount() const noexcept override { return static_cast<uint32_t>(m_buffers.size()); }
+        uint32_t getCurrentBackBufferIndex() const override { return m_swapChain->GetCurrentBackBufferIndex(); }
+        Texture& getBackBuffer(uint32_t index) override { return *m_buffers[index]; }
+
+        void present(uint32_t syncInterval) override;
+        void resize(uint32_t width, uint32_t height) override;
+        void setSourceSize(uint32_t width, uint32_t height) override;
+        void waitForFrameLatency() override;
+
+    private:
+        void createBuffers();
+
+    private:
+        D3D12Device&                               m_device;
+        SwapChainDesc                              m_desc;
+        UINT                                       m_flags = 0;
+        Microsoft::WRL::ComPtr<IDXGISwapChain3>    m_swapChain;
+        std::vector<std::unique_ptr<D3D12Texture>> m_buffers;
+        HANDLE                                     m_frameLatencyWaitable = nullptr;
+    };
+
+    class D3D12Device : public Device
+    {
+    public:
+        D3D12Device();
+        ~D3D12Device() override;
+
+        D3D12Device(const D3D12Device&)            = delete;
+        D3D12Device(D3D12Device&&)                 = delete;
+        D3D12Device& operator=(const D3D12Device&) = delete;
+        D3D12Device& operator=(D3D12Device&&)      = delete;
+
+        CommandQueue& getQueue() override { return *m_commandQueue; }
+        CommandQueue& getCopyQueue() override { return *m_copyQueue; }
+
+        std::unique_ptr<CommandAllocator> createCommandAllocator(QueueType type = QueueType::Direct) override;
+        std::unique_ptr<CommandList>      createCommandList(QueueType type = QueueType::Direct) override;
+        std::unique_ptr<SwapChain>        createSwapChain(const SwapChainDesc& desc) override;
+        std::unique_ptr<Texture>          createTexture(const TextureDesc& desc, ResourceState initialState) override;
+        std::unique_ptr<Buffer>           createBuffer(const BufferDesc& desc, ResourceState initialState) override;
+        std::unique_ptr<Heap>             createHeap(const HeapDesc& desc) override;
+
+        std::unique_ptr<TimestampQueryHeap> createTimestampQueryHeap(uint32_t count) override;
+        std::unique_ptr<CommandSignature>   createCommandSignature(uint32_t byteStride) override;
+
+        std::unique_ptr<Texture> createPlacedTexture(Heap& heap, uint64_t offset, const TextureDesc& desc, ResourceState initialState) override;
+        AllocationInfo           getTextureAllocationInfo(const TextureDesc& desc) override;
+
+        std::unique_ptr<Buffer> createPlacedBuffer(Heap& heap, uint64_t offset, const BufferDesc& desc, ResourceState initialState) override;
+
+        std::unique_ptr<RootSignature> createRootSignature(const RootSignatureDesc& desc) override;
+        std::unique_ptr<PipelineState> createGraphicsPipeline(const GraphicsPipelineDesc& desc, const std::vector<uint8_t>* cachedBlob) override;
+
+        MemoryAllocator& getMemoryAllocator() override { return *m_memoryAllocator; }
+
+        MemoryBudget queryMemoryBudget() override;
+        void         evict(Heap* const* heaps, uint32_t count) override;
+        void         makeResident(Heap* const* heaps, uint32_t count) override;
+
+        DescriptorAllocator& getDescriptorAllocator(DescriptorHeapType type) override { return getDescriptorHeap(type).getAllocator(); }
+
+        ID3D12Device*        get() const noexcept { return m_device.Get(); }
+        IDXGIFactory4*       getFactory() const noexcept { return m_factory.Get(); }
+        D3D12CommandQueue&   getD3D12Queue() noexcept { return *m_commandQueue; }
+        D3D12DescriptorHeap& getDescriptorHeap(DescriptorHeapType type) noexcept { return *m_descriptorHeaps[static_cast<uint32_t>(type)]; }
+
+    private:
+        Microsoft::WRL::ComPtr<IDXGIFactory4> m_factory;    // Use for hardware and display management
+                                                            // such as enumerating available GPUs, creating swap chains, managing display-related events
+        Microsoft::WRL::ComPtr<ID3D12Device>  m_device;     // Use for interacts with GPU
+                                                            // such as resource creation, rendering, and command execution
+        Microsoft::WRL::ComPtr<IDXGIAdapter3> m_adapter;    // Adapter of the device, reports the video memory budget
+
+        UINT m_4xMSAAQualityLevels;
+
+        std::unique_ptr<D3D12CommandQueue>   m_commandQueue;     // Submit command lists to GPU to execute
+        std::unique_ptr<D3D12CommandQueue>   m_copyQueue;        // Uploads on the copy engine beside rendering
+        std::unique_ptr<D3D12DescriptorHeap> m_descriptorHeaps[static_cast<uint32_t>(DescriptorHeapType::Count)];
+        std::unique_ptr<MemoryAllocator>     m_memoryAllocator;  // Heaps of textures and buffers
+    };
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include "RingAllocator.hpp"
+
+#include <mutex>
+#include <deque>
+#include <vector>
+#include <cstdint>
+
+namespace GalgameEngine
+{
+    /*
+    * Index allocator of one descriptor heap, pure CPU bookkeeping shared by all backends
+    *
+    * [0, persistentCapacity)                        persistent descriptors, free list with O(1) allocate/free
+    * [persistentCapacity, + transientCapacity)      transient contiguous tables of the frame being recorded
+    *
+    * GPU may still read a freed descriptor in frames in flight, so free() only queues the index,
+    * it goes back to the free list when the fence of the frame which freed it completes.
+    * Transient tables are carved linearly from a ring and come back per frame the same way.
+    * Heap is created once with full capacity, allocating never creates heaps.
+    *
+    * Thread safe, recording threads may allocate at the same time
+    */
+    class DescriptorAllocator
+    {
+    public:
+        static constexpr uint32_t InvalidIndex = UINT32_MAX;
+
+        struct Stats
+        {
+            uint32_t persistentUsed = 0;    // Not available for allocation, including pending frees
+            uint32_t persistentPeak = 0;
+            uint32_t pendingFrees   = 0;    // Freed but waiting for GPU
+            uint32_t transientUsed  = 0;
+            uint64_t failures       = 0;    // Allocations which did not fit
+        };
+
+        DescriptorAllocator(uint32_t persistentCapacity, uint32_t transientCapacity);
+
+        DescriptorAllocator(const DescriptorAllocator&)            = delete;
+        DescriptorAllocator(DescriptorAllocator&&)                 = delete;
+        DescriptorAllocator& operator=(const DescriptorAllocator&) = delete;
+        DescriptorAllocator& operator=(DescriptorAllocator&&)      = delete;
+
+        // Persistent descriptor, InvalidIndex when the heap is full
+        uint32_t allocate();
+        // Reused after the fence of the current frame completes
+        void     free(uint32_t index);
+        // Reused at once, only for descriptors GPU never reads (RTV and DSV are consumed at record time)
+        void     freeImmediately(uint32_t index);
+
+        // First index of count contiguous descriptors valid for the current frame, InvalidIndex when full
+        uint32_t allocateTransient(uint32_t count);
+
+        // Close the current frame, its frees and transient tables come back after GPU reaches fenceValue
+        void finishFrame(uint64_t fenceValue);
+        void reclaim(uint64_t completedValue);
+
+        uint32_t getPersistentCapacity() const noexcept { return m_persistentCapacity; }
+        uint32_t getTransientCapacity()  const noexcept { return m_transientCapacity; }
+        uint32_t getCapacity()           const noexcept { return m_persistentCapacity + m_transientCapacity; }
+
+        bool  isAllocated(uint32_t index) const;
+        Stats getStats() const;
+
+    private:
+        void release(uint32_t index);
+
+    private:
+        struct RetiredFrees
+        {
+            uint64_t              fenceValue;
+            std::vector<uint32_t> indices;
+        };
+
+        uint32_t m_persistentCapacity;
+        uint32_t m_transientCapacity;
+
+        mutable std::mutex       m_mutex;
+        uint32_t                 m_nextUnused = 0;      // Indices from here were never allocated
+        std::vector<uint32_t>    m_freeList;
+        std::vector<uint64_t>    m_allocatedBits;       // Catch double free and use of freed index
+        std::vector<uint32_t>    m_pendingFrees;        // Freed in current frame
+        std::deque<RetiredFrees> m_retiredFrees;
+        RingAllocator            m_transient;
+        Stats                    m_stats;
+    };
+}
@@ -0,0 +1,594 @@
+#pragma once
+
+#include "CommandQueue.hpp"
+#include "DescriptorAllocator.hpp"
+
+#include <string>
+#include <memory>
+#include <vector>
+#include <cstdint>
+
+namespace GalgameEngine
+{
+    /*
+    * Backend-neutral device layer
+    * Frame logic records commands through these interfaces, D3D12 is one implementation of them,
+    * the null backend records and validates commands without GPU so the frame loop also runs headlessly
+    */
+
+    enum class Format : uint32_t
+    {
+        Unknown,
+        R8G8B8A8_UNORM,     // 32-bit color format, unsigned format (0.0 ~ 1.0 <=> 0 ~ 255)
+        R16G16B16A16_FLOAT,
+        R32_FLOAT,
+        R32G32_FLOAT,       // Vertex attribute formats
+        R32G32B32_FLOAT,
+        R32G32B32A32_FLOAT,
+        D24_UNORM_S8_UINT,
+        D32_FLOAT,
+        R16_UINT,           // Index and instance index formats
+        R32_UINT,
+    };
+
+    enum class ResourceState : uint32_t
+    {
+        Common,
+        Present,
+        RenderTarget,
+        DepthWrite,
+        DepthRead,
+        ShaderResource,
+        UnorderedAccess,
+        CopySource,
+        CopyDest,
+        GenericRead,
+    };
+
+    enum class TextureUsage : uint32_t
+    {
+        None            = 0,
+        RenderTarget    = 1 << 0,
+        DepthStencil    = 1 << 1,
+        ShaderResource  = 1 << 2,
+        UnorderedAccess = 1 << 3,
+    };
+
+    constexpr TextureUsage operator|(TextureUsage a, TextureUsage b) noexcept
+    {
+        return static_cast<TextureUsage>(static_cast<uint32_t>(a) | static_cast<uint32_t>(b));
+    }
+
+    constexpr bool hasFlag(TextureUsage usage, TextureUsage flag) noexcept
+    {
+        return (static_cast<uint32_t>(usage) & static_cast<uint32_t>(flag)) != 0;
+    }
+
+    constexpr bool isDepthFormat(Format format) noexcept
+    {
+        return format == Format::D24_UNORM_S8_UINT || format == Format::D32_FLOAT;
+    }
+
+    // Bytes of one texel
+    constexpr uint32_t getFormatSize(Format format) noexcept
+    {
+        switch (format)
+        {
+        case Format::R32G32B32A32_FLOAT: return 16;
+        case Format::R32G32B32_FLOAT:    return 12;
+        case Format::R32G32_FLOAT:
+        case Format::R16G16B16A16_FLOAT: return 8;
+        case Format::R8G8B8A8_UNORM:
+        case Format::R32_FLOAT:
+        case Format::R32_UINT:
+        case Format::D24_UNORM_S8_UINT:
+        case Format::D32_FLOAT:          return 4;
+        case Format::R16_UINT:           return 2;
+        default:                         return 0;
+        }
+    }
+
+    enum class HeapType : uint32_t
+    {
+        Default,    // GPU only memory
+        Upload,     // CPU write, GPU read
+        Readback,   // GPU write, CPU read
+    };
+
+    // Resource heap tier 1 hardware keeps these kinds of resources in different heaps
+    enum class HeapUsage : uint32_t
+    {
+        Buffers,
+        Textures,       // Textures without render target and depth stencil usage
+        RenderTargets,  // Render target and depth stencil textures
+        All,            // Any resource, resource heap tier 2 only
+    };
+
+    enum class DescriptorHeapType : uint32_t
+    {
+        CbvSrvUav,  // Shader visible, constant buffer / shader resource / unordered access views
+        Sampler,    // Shader visible
+        Rtv,        // CPU only, render target views
+        Dsv,        // CPU only, depth stencil views
+        Count,
+    };
+
+    struct DescriptorHeapCapacity
+    {
+        uint32_t persistent;
+        uint32_t transient;     // Only shader visible heaps need per-frame tables
+    };
+
+    // Descriptor heap sizes shared by all backends, so capacity problems also show up headlessly
+    constexpr DescriptorHeapCapacity getDescriptorHeapCapacity(DescriptorHeapType type) noexcept
+    {
+        switch (type)
+        {
+        case DescriptorHeapType::CbvSrvUav: return { 262144, 65536 };
+        case DescriptorHeapType::Sampler:   return { 1024, 1024 };      // Shader visible sampler heap holds at most 2048
+        case DescriptorHeapType::Rtv:       return { 1024, 0 };
+        case DescriptorHeapType::Dsv:       return { 256, 0 };
+        default:                            return { 0, 0 };
+        }
+    }
+
+    struct ClearValue
+    {
+        float   color[4] = {};
+        float   depth    = 1.f;
+        uint8_t stencil  = 0;
+    };
+
+    struct TextureDesc
+    {
+        uint32_t     width  = 0;
+        uint32_t     height = 0;
+        Format       format = Format::Unknown;
+        TextureUsage usage  = TextureUsage::None;
+        ClearValue   clearValue;                // Optimized clear value for render target and depth stencil
+    };
+
+    struct BufferDesc
+    {
+        uint64_t size     = 0;
+        HeapType heapType = HeapType::Default;
+    };
+
+    struct HeapDesc
+    {
+        uint64_t  size  = 0;
+        HeapType  type  = HeapType::Default;
+        HeapUsage usage = HeapUsage::RenderTargets;
+    };
+
+    // Memory a placed resource takes in a heap
+    struct AllocationInfo
+    {
+        uint64_t size      = 0;
+        uint64_t alignment = 0;
+    };
+
+    struct Viewport
+    {
+        float x        = 0.f;
+        float y        = 0.f;
+        float width    = 0.f;
+        float height   = 0.f;
+        float minDepth = 0.f;
+        float maxDepth = 1.f;
+    };
+
+    struct Rect
+    {
+        int32_t left   = 0;
+        int32_t top    = 0;
+        int32_t right  = 0;
+        int32_t bottom = 0;
+    };
+
+    enum class ShaderVisibility : uint8_t
+    {
+        All,
+        Vertex,
+        Pixel,
+    };
+
+    enum class RootParameterType : uint8_t
+    {
+        Constants,          // 32-bit values inline in the root signature, count is the number of values
+        ConstantBuffer,     // Root descriptors, a GPU address
+        ShaderResource,
+        UnorderedAccess,
+        DescriptorTable,    // count descriptors of rangeType from a shader visible heap
+    };
+
+    enum class DescriptorRangeType : uint8_t
+    {
+        ConstantBuffer,
+        ShaderResource,
+        UnorderedAccess,
+        Sampler,
+    };
+
+    struct RootParameter
+    {
+        RootParameterType   type           = RootParameterType::ConstantBuffer;
+        ShaderVisibility    visibility     = ShaderVisibility::All;
+        DescriptorRangeType rangeType      = DescriptorRangeType::ShaderResource;  // Descriptor table only
+        uint32_t            shaderRegister = 0;
+        uint32_t            registerSpace  = 0;
+        uint32_t            count          = 1;
+    };
+
+    struct RootSignatureDesc
+    {
+        std::vector<RootParameter> parameters;
+        bool                       allowInputLayout = true;
+    };
+
+    struct InputElement
+    {
+        std::string semantic;
+        uint32_t    semanticIndex = 0;
+        Format      format        = Format::Unknown;
+        uint32_t    slot          = 0;
+        uint32_t    offset        = 0;
+        bool        perInstance   = false;  // Advances once per instance, starting at the start instance of the draw
+    };
+
+    enum class PrimitiveTopology : uint8_t
+    {
+        Triangle,
+        Line,
+        Point,
+    };
+
+    enum class CullMode : uint8_t
+    {
+        None,
+        Front,
+        Back,
+    };
+
+    enum class BlendMode : uint8_t
+    {
+        Opaque,
+        AlphaBlend,
+        Additive,
+    };
+
+    enum class CompareFunc : uint8_t
+    {
+        Never,
+        Less,
+        LessEqual,
+        Equal,
+        GreaterEqual,
+        Greater,
+        Always,
+    };
+
+    class RootSignature;
+
+    // Everything a graphics pipeline state is compiled from, shaders are compiled bytecode (DXIL)
+    struct GraphicsPipelineDesc
+    {
+        static constexpr uint32_t MaxRenderTargets = 8;
+
+        RootSignature*            rootSignature = nullptr;
+        std::vector<uint8_t>      vertexShader;
+        std::vector<uint8_t>      pixelShader;
+        std::vector<InputElement> inputLayout;
+
+        PrimitiveTopology topology   = PrimitiveTopology::Triangle;
+        CullMode          cullMode   = CullMode::Back;
+        bool              wireframe  = false;
+        BlendMode         blendMode  = BlendMode::Opaque;
+        bool              depthTest  = true;
+        bool              depthWrite = true;
+        CompareFunc       depthFunc  = CompareFunc::Less;
+
+        uint32_t renderTargetCount = 1;
+        Format   renderTargetFormats[MaxRenderTargets] = { Format::R8G8B8A8_UNORM };
+        Format   depthStencilFormat = Format::D24_UNORM_S8_UINT;
+    };
+
+    class RootSignature
+    {
+    public:
+        virtual ~RootSignature() = default;
+    };
+
+    class PipelineState
+    {
+    public:
+        virtual ~PipelineState() = default;
+
+        // Driver compiled form, passing it to createGraphicsPipeline() in a later run skips most of the compile
+        virtual std::vector<uint8_t> getCachedBlob() const = 0;
+    };
+
+    class Heap;
+
+    // Any GPU memory object which can be transitioned between states
+    class Resource
+    {
+    public:
+        virtual ~Resource() = default;
+
+        // State the resource is left in by all command lists submitted so far, kept by ResourceStateTracker
+        ResourceState getSubmittedState() const noexcept { return m_submittedState; }
+
+        // Memory allocator heap the device placed the resource in, null for resources placed by the caller
+        // and swap chain buffers. Residency is managed per heap
+        virtual Heap* getHeap() const noexcept = 0;
+
+    protected:
+        explicit Resource(ResourceState initialState) noexcept : m_submittedState(initialState) {}
+
+    private:
+        friend class ResourceStateTracker;
+
+        ResourceState m_submittedState;
+    };
+
+    class Texture : public Resource
+    {
+    public:
+        virtual const TextureDesc& getDesc() const noexcept = 0;
+
+    protected:
+        using Resource::Resource;
+    };
+
+    class Buffer : public Resource
+    {
+    public:
+        virtual const BufferDesc& getDesc() const noexcept = 0;
+
+        // Upload and readback buffers stay mapped for their whole lifetime, null for default heap
+        virtual uint8_t* getMappedData() const noexcept = 0;
+        virtual uint64_t getGpuAddress() const noexcept = 0;
+
+    protected:
+        using Resource::Resource;
+    };
+
+    // Block of GPU memory which placed resources are created in
+    class Heap
+    {
+    public:
+        virtual ~Heap() = default;
+
+        virtual const HeapDesc& getDesc() const noexcept = 0;
+    };
+
+    // GPU timestamps written by command lists, resolved into a readback buffer as 64-bit ticks of the queue clock
+    class TimestampQueryHeap
+    {
+    public:
+        virtual ~TimestampQueryHeap() = default;
+
+        virtual uint32_t getCount() const noexcept = 0;
+    };
+
+    // Split barrier lets GPU run the transition between BeginOnly and EndOnly instead of stalling at one point
+    enum class BarrierFlags : uint8_t
+    {
+        None,
+        BeginOnly,
+        EndOnly,
+    };
+
+    struct ResourceBarrier
+    {
+        Resource*     resource = nullptr;
+        ResourceState before   = ResourceState::Common;
+        ResourceState after    = ResourceState::Common;
+        BarrierFlags  flags    = BarrierFlags::None;
+    };
+
+    // Memory pool of recorded commands, only reset it after GPU finished the commands allocated from it
+    class CommandAllocator
+    {
+    public:
+        virtual ~CommandAllocator() = default;
+
+        virtual void reset() = 0;
+    };
+
+    // Vertex, index and indirect argument buffers are read in GenericRead state
+    struct VertexBufferView
+    {
+        Buffer*  buffer = nullptr;
+        uint64_t offset = 0;
+        uint32_t size   = 0;
+        uint32_t stride = 0;
+    };
+
+    struct IndexBufferView
+    {
+        Buffer*  buffer = nullptr;
+        uint64_t offset = 0;
+        uint32_t size   = 0;
+        Format   format = Format::R32_UINT;     // R16_UINT or R32_UINT
+    };
+
+    // One draw of an indirect argument buffer, laid out like D3D12_DRAW_INDEXED_ARGUMENTS
+    struct DrawIndexedArguments
+    {
+        uint32_t indexCount    = 0;
+        uint32_t instanceCount = 0;
+        uint32_t startIndex    = 0;
+        int32_t  baseVertex    = 0;
+        uint32_t startInstance = 0;
+    };
+    static_assert(sizeof(DrawIndexedArguments) == 20);
+
+    // Layout of indirect argument buffers, only indexed draws so it needs no root signature
+    class CommandSignature
+    {
+    public:
+        virtual ~CommandSignature() = default;
+
+        virtual uint32_t getByteStride() const noexcept = 0;
+    };
+
+    // Buffer layout of texture data copied by copyBufferToTexture()
+    constexpr uint64_t TextureCopyPlacementAlignment = 512;
+    constexpr uint32_t TextureCopyPitchAlignment     = 256;
+
+    // Records commands, command list is created closed and need reset before recording
+    class CommandList
+    {
+    public:
+        virtual ~CommandList() = default;
+
+        virtual void reset(CommandAllocator& allocator) = 0;
+        virtual void close() = 0;
+
+        virtual void setViewport(const Viewport& viewport) = 0;
+        virtual void setScissorRect(const Rect& rect) = 0;
+        virtual void resourceBarrier(const ResourceBarrier* barriers, uint32_t count) = 0;
+        // Following commands use after instead of the placed resources sharing its memory, null before means any of them
+        virtual void aliasingBarrier(Resource* before, Resource* after) = 0;
+
+        virtual void clearRenderTarget(Texture& target, const float color[4]) = 0;
+        virtual void clearDepthStencil(Texture& target, float depth, uint8_t stencil) = 0;
+        virtual void setRenderTargets(Texture* const* targets, uint32_t count, Texture* depthStencil) = 0;
+
+        virtual void setGraphicsRootSignature(RootSignature& rootSignature) = 0;
+        virtual void setPipelineState(PipelineState& pipeline) = 0;
+        // Root descriptors of the bound root signature, by parameter index
+        virtual void setGraphicsRootConstantBufferView(uint32_t parameter, uint64_t gpuAddress) = 0;
+        virtual void setGraphicsRootShaderResourceView(uint32_t parameter, uint64_t gpuAddress) = 0;
+
+        virtual void setVertexBuffers(uint32_t startSlot, const VertexBufferView* views, uint32_t count) = 0;
+        virtual void setIndexBuffer(const IndexBufferView& view) = 0;
+        // Needs root signature, pipeline and index buffer bound
+        virtual void drawIndexedInstanced(uint32_t indexCount, uint32_t instanceCount, uint32_t startIndex, int32_t baseVertex, uint32_t startInstance) = 0;
+        // Up to maxCount draws of the argument buffer, fewer when count buffer is set and holds a smaller uint32 count
+        virtual void executeIndirect(CommandSignature& signature, uint32_t maxCount, Buffer& arguments, uint64_t argumentOffset,
+                                     Buffer* countBuffer, uint64_t countOffset) = 0;
+
+        // Copies, the only commands a copy queue list may record
+        // Destination must be in copy dest or common state, common is promoted to copy dest on first use
+        virtual void copyBufferRegion(Buffer& dest, uint64_t destOffset, Buffer& source, uint64_t sourceOffset, uint64_t size) = 0;
+        // Whole texture from rows of rowPitch bytes, offset aligned to TextureCopyPlacementAlignment and pitch to TextureCopyPitchAlignment
+        virtual void copyBufferToTexture(Texture& dest, Buffer& source, uint64_t sourceOffset, uint32_t rowPitch) = 0;
+
+        // Direct lists only. Timestamp of when GPU reaches this point of the list
+        virtual void writeTimestamp(TimestampQueryHeap& heap, uint32_t index) = 0;
+        // Copy count written timestamps to a readback buffer in copy dest state, 8 bytes each
+        virtual void resolveTimestamps(TimestampQueryHeap& heap, uint32_t first, uint32_t count, Buffer& dest, uint64_t destOffset) = 0;
+    };
+
+    struct SwapChainDesc
+    {
+        void*    window      = nullptr;     // Native window handle, ignored by headless backends
+        uint32_t width       = 0;
+        uint32_t height      = 0;
+        Format   format      = Format::R8G8B8A8_UNORM;
+        uint32_t bufferCount = 2;
+
+        // Frames which may be queued for presentation before waitForFrameLatency() blocks, 0 never blocks
+        uint32_t maxFrameLatency = 0;
+    };
+
+    class SwapChain
+    {
+    public:
+        virtual ~SwapChain() = default;
+
+        virtual uint32_t getBufferCount() const noexcept = 0;
+        virtual uint32_t getCurrentBackBufferIndex() const = 0;
+        virtual Texture& getBackBuffer(uint32_t index) = 0;
+
+        virtual void present(uint32_t syncInterval) = 0;
+        // All back buffers must not be used by GPU when resizing, the presented region becomes the whole buffers
+        virtual void resize(uint32_t width, uint32_t height) = 0;
+        // Present only the top left region of the back buffers, stretched to the window. Does not touch buffers
+        virtual void setSourceSize(uint32_t width, uint32_t height) = 0;
+        // Block until fewer than maxFrameLatency presented frames are queued, call before reading input of a frame
+        virtual void waitForFrameLatency() = 0;
+    };
+
+    // Local video memory the OS grants the process right now and how much of it the process uses
+    struct MemoryBudget
+    {
+        uint64_t budget = 0;
+        uint64_t usage  = 0;
+    };
+
+    class MemoryAllocator;
+
+    class Device
+    {
+    public:
+        virtual ~Device() = default;
+
+        // Direct queue, executes all kinds of commands
+        virtual CommandQueue& getQueue() = 0;
+        // Copy queue, uploads run on it without waiting for or holding up rendering
+        virtual CommandQueue& getCopyQueue() = 0;
+
+        // Lists only run on queues of their type, so do their allocators
+        virtual std::unique_ptr<CommandAllocator> createCommandAllocator(QueueType type = QueueType::Direct) = 0;
+        virtual std::unique_ptr<CommandList>      createCommandList(QueueType type = QueueType::Direct) = 0;
+        virtual std::unique_ptr<SwapChain>        createSwapChain(const SwapChainDesc& desc) = 0;
+        // Textures and buffers are placed in heaps of the memory allocator and give their memory back when destroyed
+        // Render target and depth stencil textures start undefined, like placed ones they need a clear before other use
+        virtual std::unique_ptr<Texture>          createTexture(const TextureDesc& desc, ResourceState initialState) = 0;
+        virtual std::unique_ptr<Buffer>           createBuffer(const BufferDesc& desc, ResourceState initialState) = 0;
+        virtual std::unique_ptr<Heap>             createHeap(const HeapDesc& desc) = 0;
+
+        virtual std::unique_ptr<TimestampQueryHeap> createTimestampQueryHeap(uint32_t count) = 0;
+        // Arguments of byteStride bytes, at least sizeof(DrawIndexedArguments) and a multiple of 4
+        virtual std::unique_ptr<CommandSignature>   createCommandSignature(uint32_t byteStride) = 0;
+
+        // Texture in heap memory starting at offset, it must not outlive the heap
+        // Textures sharing memory need an aliasing barrier before the first use of each and a clear after it
+        virtual std::unique_ptr<Texture> createPlacedTexture(Heap& heap, uint64_t offset, const TextureDesc& desc, ResourceState initialState) = 0;
+        virtual AllocationInfo           getTextureAllocationInfo(const TextureDesc& desc) = 0;
+
+        // Buffer in heap memory starting at offset, the heap type must match the buffer heap type
+        virtual std::unique_ptr<Buffer> createPlacedBuffer(Heap& heap, uint64_t offset, const BufferDesc& desc, ResourceState initialState) = 0;
+
+        // Buffers take whole 64KB pages on every backend
+        static AllocationInfo getBufferAllocationInfo(const BufferDesc& desc) noexcept
+        {
+            constexpr uint64_t Alignment = 64 * 1024;
+            return { (desc.size + Alignment - 1) / Alignment * Alignment, Alignment };
+        }
+
+        virtual std::unique_ptr<RootSignature> createRootSignature(const RootSignatureDesc& desc) = 0;
+        // Thread safe, compiling takes long so it is meant to run off the render thread. Throws on failure
+        // A cached blob made by another driver or for another description is ignored and the pipeline is compiled in full
+        virtual std::unique_ptr<PipelineState> createGraphicsPipeline(const GraphicsPipelineDesc& desc, const std::vector<uint8_t>* cachedBlob) = 0;
+
+        // Heaps behind createTexture() and createBuffer()
+        virtual MemoryAllocator& getMemoryAllocator() = 0;
+
+        // Budget shrinks and grows while running as other applications take and give back memory
+        virtual MemoryBudget queryMemoryBudget() = 0;
+        // Evicted heaps give their video memory up, contents are kept. GPU must have finished every use of them,
+        // and they must be made resident again before a command list using any resource in them is executed
+        virtual void evict(Heap* const* heaps, uint32_t count) = 0;
+        virtual void makeResident(Heap* const* heaps, uint32_t count) = 0;
+
+        // Index allocator of the descriptor heap of the type, heaps are created once by the device
+        virtual DescriptorAllocator& getDescriptorAllocator(DescriptorHeapType type) = 0;
+
+        // Close the frame on every descriptor heap and reclaim what GPU has finished
+        void finishFrame(uint64_t fenceValue)
+        {
+            auto completedValue = getQueue().getCompletedValue();
+            for (uint32_t i = 0; i < static_cast<uint32_t>(DescriptorHeapType::Count); ++i)
+            {
+                auto& allocator = getDescriptorAllocator(static_cast<DescriptorHeapType>(i));
+                allocator.finishFrame(fenceValue);
+                allocator.reclaim(completedValue);
+            }
+        }
+    };
+}
@@ -0,0 +1,211 @@
+#pragma once
+
+#include "Device.hpp"
+#include "RadixSort.hpp"
+#include "UploadRing.hpp"
+#include "PipelineCache.hpp"
+
+#include <memory>
+#include <vector>
+#include <cstdint>
+
+namespace GalgameEngine
+{
+    class JobSystem;
+
+    /*
+    * 64-bit draw sort key, most significant fields first
+    *   opaque   pass 4 | 0 | pipeline 11 | material 16 | mesh 16 | depth 16
+    *   blended  pass 4 | 1 | inverted depth 16 | pipeline 11 | material 16 | mesh 16
+    * Opaque draws group by state and go front to back inside it, blended draws go back to front
+    * and only group when neighbours in depth share the state. Fields are masked to their width
+    */
+    namespace DrawKey
+    {
+        constexpr uint32_t PassBits     = 4;
+        constexpr uint32_t PipelineBits = 11;
+        constexpr uint32_t MaterialBits = 16;
+        constexpr uint32_t MeshBits     = 16;
+        constexpr uint32_t DepthBits    = 16;
+        constexpr uint32_t StateBits    = PipelineBits + MaterialBits + MeshBits;
+
+        constexpr uint32_t MaxPasses    = 1u << PassBits;
+        constexpr uint32_t MaxPipelines = 1u << PipelineBits;
+        constexpr uint32_t MaxMaterials = 1u << MaterialBits;
+        constexpr uint32_t MaxMeshes    = 1u << MeshBits;
+
+        constexpr uint64_t BlendedBit = 1ull << 59;
+
+        // Pipeline, material and mesh in StateBits
+        constexpr uint64_t packState(uint32_t pipeline, uint32_t material, uint32_t mesh) noexcept
+        {
+            return static_cast<uint64_t>(pipeline & (MaxPipelines - 1)) << (MaterialBits + MeshBits) |
+                   static_cast<uint64_t>(material & (MaxMaterials - 1)) << MeshBits |
+                   (mesh & (MaxMeshes - 1));
+        }
+
+        constexpr uint64_t make(uint32_t pass, uint32_t pipeline, uint32_t material, uint32_t mesh, uint16_t depth) noexcept
+        {
+            return static_cast<uint64_t>(pass & (MaxPasses - 1)) << 60 | packState(pipeline, material, mesh) << DepthBits | depth;
+        }
+
+        constexpr uint64_t makeBlended(uint32_t pass, uint32_t pipeline, uint32_t material, uint32_t mesh, uint16_t depth) noexcept
+        {
+            return static_cast<uint64_t>(pass & (MaxPasses - 1)) << 60 | BlendedBit |
+                   static_cast<uint64_t>(0xFFFF - depth) << StateBits | packState(pipeline, material, mesh);
+        }
+
+        // Depth in [0, 1], e.g. view depth over the far plane
+        constexpr uint16_t quantizeDepth(float depth) noexcept
+        {
+            return depth <= 0.f ? 0 : depth >= 1.f ? 0xFFFF : static_cast<uint16_t>(depth * 65535.f);
+        }
+
+        constexpr uint32_t getPass(uint64_t key) noexcept { return static_cast<uint32_t>(key >> 60); }
+
+        // Key without depth, draws of equal states are drawn with the same bindings
+        constexpr uint64_t getState(uint64_t key) noexcept
+        {
+            constexpr uint64_t Fields = (1ull << StateBits) - 1;
+            auto fields = (key & BlendedBit) != 0 ? key & Fields : (key >> DepthBits) & Fields;
+            return (key & (0x1Full << 59)) | fields;
+        }
+
+        constexpr uint32_t getPipeline(uint64_t state) noexcept { return static_cast<uint32_t>(state >> (MaterialBits + MeshBits)) & (MaxPipelines - 1); }
+        constexpr uint32_t getMaterial(uint64_t state) noexcept { return static_cast<uint32_t>(state >> MeshBits) & (MaxMaterials - 1); }
+        constexpr uint32_t getMesh(uint64_t state)     noexcept { return static_cast<uint32_t>(state) & (MaxMeshes - 1); }
+    }
+
+    // Geometry a mesh field of a key refers to, meshes sharing buffers only differ in the index range
+    struct DrawMesh
+    {
+        VertexBufferView vertices;
+        IndexBufferView  indices;
+        uint32_t         indexCount = 0;
+        uint32_t         startIndex = 0;    // In the index buffer view
+        int32_t          baseVertex = 0;
+    };
+
+    /*
+    * Draw submission of a frame, sorted by key and merged into instanced draws
+    * Threads submit {key, instance} into lanes of their own. prepare() joins the lanes, radix sorts them
+    * and merges neighbours of the same state into one batch. The sorted instances are uploaded as an
+    * R32_UINT per-instance vertex stream, a batch draws its run of it through the start instance,
+    * so a shader reads its instance index from the stream and its data from the instance buffer.
+    *
+    * Recording binds pipeline, material and geometry only when they change. In indirect mode
+    * neighbouring batches which only differ in the index range of shared buffers become one executeIndirect
+    *
+    * Pipelines of draws use getRootSignatureDesc() and add getInstanceElement() to their input layout
+    */
+    class DrawQueue
+    {
+    public:
+        static constexpr uint32_t MaterialParameter = 0;    // Root constant buffer view of the material constants
+        static constexpr uint32_t InstanceParameter = 1;    // Root shader resource view of the instance data
+        static constexpr uint32_t InstanceSlot      = 1;    // Vertex slot of the instance stream
+
+        struct Config
+        {
+            uint32_t laneCount = 1;     // Threads submitting at once
+            bool     indirect  = false;
+
+            RadixSorter::Config sort;
+        };
+
+        struct Batch
+        {
+            uint64_t state;         // DrawKey::getState() of its draws
+            uint32_t first;         // First sorted instance
+            uint32_t count;
+        };
+
+        struct Stats
+        {
+            uint32_t items      = 0;    // Submitted in the prepared frame
+            uint32_t batches    = 0;
+            uint32_t sortPasses = 0;
+        };
+
+        // Commands of one record() call
+        struct RecordStats
+        {
+            uint32_t draws           = 0;   // Draw and executeIndirect calls
+            uint32_t pipelineChanges = 0;
+            uint32_t materialChanges = 0;
+            uint32_t meshChanges     = 0;   // Vertex or index buffer rebinds
+            uint32_t skipped         = 0;   // Instances of batches without a ready pipeline or fallback
+
+            RecordStats& operator+=(const RecordStats& other) noexcept
+            {
+                draws           += other.draws;
+                pipelineChanges += other.pipelineChanges;
+                materialChanges += other.materialChanges;
+                meshChanges     += other.meshChanges;
+                skipped         += other.skipped;
+                return *this;
+            }
+        };
+
+        DrawQueue(Device& device, UploadRing& uploadRing, PipelineCache& pipelineCache, const Config& config);
+        ~DrawQueue() = default;
+
+        DrawQueue(const DrawQueue&)            = delete;
+        DrawQueue(DrawQueue&&)                 = delete;
+        DrawQueue& operator=(const DrawQueue&) = delete;
+        DrawQueue& operator=(DrawQueue&&)      = delete;
+
+        // Index for the mesh and material fields of keys, materials are constant buffer addresses
+        uint32_t addMesh(const DrawMesh& mesh);
+        uint32_t addMaterial(uint64_t constants);
+
+        // One thread per lane at a time
+        void submit(uint32_t lane, uint64_t key, uint32_t instance) { m_lanes[lane].items.push_back({ key, instance }); }
+
+        // Sort and batch everything submitted since the last prepare() and upload it for this frame
+        // Sorting runs on the job system when set, call it from a thread of the system then
+        void prepare(JobSystem* jobSystem = nullptr);
+
+        // Batches of a pass in [begin, end)
+        void getPassBatches(uint32_t pass, uint32_t& begin, uint32_t& end) const noexcept;
+
+        /*
+        * Record batches [begin, end) into a list with render targets set, binds the root signature and the instance data
+        * Nothing is assumed about the list before, ranges of one pass can be recorded into several lists at once
+        */
+        RecordStats record(CommandList& commandList, RootSignature& rootSignature, uint64_t instanceData,
+                           uint32_t begin, uint32_t end) const;
+
+        const std::vector<Batch>& getBatches() const noexcept { return m_batches; }
+        const Stats&              getStats() const noexcept { return m_stats; }
+
+        // Root signature and instance stream input element of pipelines drawn by the queue
+        static RootSignatureDesc getRootSignatureDesc();
+        static InputElement      getInstanceElement();
+
+    private:
+        struct alignas(64) Lane
+        {
+            std::vector<SortItem> items;
+        };
+
+    private:
+        UploadRing&    m_uploadRing;
+        PipelineCache& m_pipelineCache;
+        Config         m_config;
+
+        std::unique_ptr<Lane[]>           m_lanes;
+        std::vector<DrawMesh>             m_meshes;
+        std::vector<uint64_t>             m_materials;
+        std::unique_ptr<CommandSignature> m_signature;     // Indirect mode only
+
+        std::vector<SortItem> m_items;
+        RadixSorter           m_sorter;
+        std::vector<Batch>    m_batches;
+
+        UploadRing::Allocation m_instances;     // Sorted instance indices of the frame
+        UploadRing::Allocation m_arguments;     // One DrawIndexedArguments per batch, indirect mode only
+
+        Stats m_stats;
+    };
+}
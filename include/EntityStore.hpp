@@ -0,0 +1,324 @@
+#pragma once
+
+#include "JobSystem.hpp"
+
+#include <memory>
+#include <vector>
+#include <cstdint>
+#include <type_traits>
+#include <unordered_map>
+
+namespace GalgameEngine
+{
+    // Stable handle, the generation tells a destroyed entity from the one reusing its index
+    struct Entity
+    {
+        uint32_t index      = UINT32_MAX;
+        uint32_t generation = 0;
+
+        bool isValid() const noexcept { return index != UINT32_MAX; }
+        bool operator==(const Entity&) const noexcept = default;
+    };
+
+    inline constexpr Entity InvalidEntity = {};
+
+    // One bit per component type
+    using ComponentMask = uint64_t;
+
+    // Component type ids, assigned on first use. Components are plain data which is moved with memcpy
+    class ComponentTypes
+    {
+    public:
+        static constexpr uint32_t MaxTypes = 64;
+
+        struct Info
+        {
+            uint32_t size;
+            uint32_t alignment;
+        };
+
+        template <typename T>
+        static uint32_t getId()
+        {
+            static_assert(std::is_trivially_copyable_v<T>, "Components are moved between chunks with memcpy");
+            static const uint32_t s_id = registerType({ sizeof(T), alignof(T) });
+            return s_id;
+        }
+
+        static Info getInfo(uint32_t id) noexcept;
+
+    private:
+        static uint32_t registerType(const Info& info);
+    };
+
+    template <typename... Components>
+    ComponentMask makeComponentMask()
+    {
+        return (ComponentMask(0) | ... | (ComponentMask(1) << ComponentTypes::getId<Components>()));
+    }
+
+    /*
+    * Archetype based entity component store
+    * Entities with the same set of components share an archetype, which keeps them in 16KB chunks.
+    * A chunk holds one array per component (structure of arrays), rows are packed: removing an entity
+    * moves the archetype's last entity into the hole, so only the last chunk is partly filled
+    *
+    * Change tracking is per chunk and component: every write access stamps the chunk's component with the
+    * current version. A consumer keeps the version nextVersion() returned after its last pass and visits
+    * only chunks changed after it, e.g. transforms to recompute or instance constants to upload again
+    *
+    * Queries visit chunks, on one thread or spread over a job system. Structural changes (create, destroy,
+    * add, remove) may not happen during iteration, chunk writes of different chunks may run in parallel
+    */
+    class EntityStore
+    {
+    public:
+        static constexpr uint32_t ChunkSize = 16 << 10;
+
+        struct Query
+        {
+            ComponentMask all          = 0;     // Components the archetype must have
+            ComponentMask none         = 0;     // Components it must not have
+            ComponentMask changed      = 0;     // When set, only chunks where one of them changed after changedAfter
+            uint64_t      changedAfter = 0;
+        };
+
+        struct Stats
+        {
+            uint32_t entities   = 0;
+            uint32_t archetypes = 0;
+            uint32_t chunks     = 0;
+            uint64_t moves      = 0;            // Rows moved by destroy, add and remove
+        };
+
+    private:
+        struct alignas(64) ChunkStorage
+        {
+            uint8_t bytes[ChunkSize];
+        };
+
+        struct Chunk
+        {
+            std::unique_ptr<ChunkStorage> storage;
+            uint32_t                      count = 0;
+            std::vector<uint64_t>         versions;     // Per component of the archetype
+        };
+
+        struct Archetype
+        {
+            ComponentMask                       mask = 0;
+            std::vector<uint32_t>               types;          // Component ids, ascending
+            std::vector<uint32_t>               offsets;        // Of every component array in a chunk
+            std::vector<uint32_t>               sizes;
+            uint8_t                             slots[ComponentTypes::MaxTypes];  // Index in types by id, 0xFF when missing
+            uint32_t                            capacity = 0;   // Rows per chunk
+            std::vector<std::unique_ptr<Chunk>> chunks;
+        };
+
+    public:
+        // A chunk of one archetype during iteration
+        class ChunkView
+        {
+        public:
+            uint32_t      getCount() const noexcept { return m_chunk->count; }
+            const Entity* getEntities() const noexcept { return reinterpret_cast<const Entity*>(m_chunk->storage->bytes); }
+
+            template <typename T>
+            bool has() const { return m_archetype->slots[ComponentTypes::getId<T>()] != 0xFF; }
+
+            // Null when the archetype does not have the component
+            template <typename T>
+            const T* read() const { return static_cast<const T*>(getArray(ComponentTypes::getId<T>(), false)); }
+
+            // Marks the component of the whole chunk changed
+            template <typename T>
+            T* write() { return static_cast<T*>(getArray(ComponentTypes::getId<T>(), true)); }
+
+            template <typename T>
+            bool hasChangedAfter(uint64_t version) const
+            {
+                auto slot = m_archetype->slots[ComponentTypes::getId<T>()];
+                return slot != 0xFF && m_chunk->versions[slot] > version;
+            }
+
+        private:
+            friend class EntityStore;
+
+            ChunkView(Archetype& archetype, Chunk& chunk, uint64_t version) noexcept
+                : m_archetype(&archetype), m_chunk(&chunk), m_version(version) {}
+
+            void* getArray(uint32_t type, bool write) const noexcept
+            {
+                auto slot = m_archetype->slots[type];
+                if (slot == 0xFF)
+                    return nullptr;
+                if (write)
+                    m_chunk->versions[slot] = m_version;
+                return m_chunk->storage->bytes + m_archetype->offsets[slot];
+            }
+
+        private:
+            Archetype* m_archetype;
+            Chunk*     m_chunk;
+            uint64_t   m_version;
+        };
+
+        EntityStore() = default;
+        ~EntityStore() = default;
+
+        EntityStore(const EntityStore&)            = delete;
+        EntityStore(EntityStore&&)                 = delete;
+        EntityStore& operator=(const EntityStore&) = delete;
+        EntityStore& operator=(EntityStore&&)      = delete;
+
+        // Components start zeroed
+        Entity create(ComponentMask mask);
+        // Fills entities with count new entities of the same archetype, much cheaper than count create() calls
+        void   create(ComponentMask mask, uint32_t count, Entity* entities);
+        void   destroy(Entity entity);
+        bool   isAlive(Entity entity) const noexcept;
+
+        template <typename... Components>
+        Entity create(const Components&... components)
+        {
+            auto entity = create(makeComponentMask<Components...>());
+            ((*get<Components>(entity) = components), ...);
+            return entity;
+        }
+
+        // Null when the entity is dead or does not have the component. get() marks the component changed
+        template <typename T>
+        T* get(Entity entity) { return static_cast<T*>(getComponent(entity, ComponentTypes::getId<T>(), true)); }
+
+        template <typename T>
+        const T* read(Entity entity) const { return static_cast<const T*>(const_cast<EntityStore*>(this)->getComponent(entity, ComponentTypes::getId<T>(), false)); }
+
+        template <typename T>
+        bool has(Entity entity) const { return read<T>(entity) != nullptr; }
+
+        // Move the entity to the archetype with the component added, or just set it when it has it
+        template <typename T>
+        void add(Entity entity, const T& value)
+        {
+            auto type = ComponentTypes::getId<T>();
+            changeArchetype(entity, type, true);
+            if (auto component = get<T>(entity))
+                *component = value;
+        }
+
+        template <typename T>
+        void remove(Entity entity) { changeArchetype(entity, ComponentTypes::getId<T>(), false); }
+
+        // Writes are stamped with the current version. Return it and start a new one,
+        // a consumer which keeps the returned version sees every later write as changed after it
+        uint64_t nextVersion() noexcept { return m_version++; }
+        uint64_t getVersion() const noexcept { return m_version; }
+
+        // Entity indices are below it, e.g. the size of a GPU array indexed by entity
+        uint32_t getIndexCount() const noexcept { return static_cast<uint32_t>(m_slots.size()); }
+
+        // function(ChunkView&) for every matching chunk
+        template <typename Function>
+        void forEachChunk(const Query& query, Function&& function)
+        {
+            for (auto archetype : m_archetypeList)
+            {
+                if (!matches(*archetype, query))
+                    continue;
+                for (auto& chunk : archetype->chunks)
+                {
+                    if (!isChanged(*archetype, *chunk, query))
+                        continue;
+                    ChunkView view(*archetype, *chunk, m_version);
+                    function(view);
+                }
+            }
+        }
+
+        // Same on the threads of the job system, a few jobs per thread. Call from a thread of the system
+        template <typename Function>
+        void parallelForEachChunk(JobSystem& jobs, const Query& query, Function&& function)
+        {
+            m_matchedChunks.clear();
+            for (auto archetype : m_archetypeList)
+            {
+                if (!matches(*archetype, query))
+                    continue;
+                for (auto& chunk : archetype->chunks)
+                {
+                    if (isChanged(*archetype, *chunk, query))
+                        m_matchedChunks.push_back({ archetype, chunk.get() });
+                }
+            }
+
+            auto       count = static_cast<uint32_t>(m_matchedChunks.size());
+            auto       grain = count / (jobs.getThreadCount() * 4) + 1;
+            auto       body  = [this, &function](uint32_t begin, uint32_t end)
+            {
+                for (uint32_t i = begin; i < end; ++i)
+                {
+                    ChunkView view(*m_matchedChunks[i].archetype, *m_matchedChunks[i].chunk, m_version);
+                    function(view);
+                }
+            };
+            JobCounter counter;
+            jobs.parallelFor(counter, count, grain, body);
+            jobs.wait(counter);
+        }
+
+        Stats getStats() const noexcept;
+
+    private:
+        struct Slot
+        {
+            Archetype* archetype  = nullptr;    // Null when the index is free
+            uint32_t   chunk      = 0;
+            uint32_t   row        = 0;
+            uint32_t   generation = 0;
+        };
+
+        struct MatchedChunk
+        {
+            Archetype* archetype;
+            Chunk*     chunk;
+        };
+
+        static bool matches(const Archetype& archetype, const Query& query) noexcept
+        {
+            return (archetype.mask & query.all) == query.all && (archetype.mask & query.none) == 0;
+        }
+
+        static bool isChanged(const Archetype& archetype, const Chunk& chunk, const Query& query) noexcept
+        {
+            if (query.changed == 0)
+                return true;
+            for (size_t i = 0; i < archetype.types.size(); ++i)
+            {
+                if ((query.changed >> archetype.types[i]) & 1 && chunk.versions[i] > query.changedAfter)
+                    return true;
+            }
+            return false;
+        }
+
+        Archetype& getArchetype(ComponentMask mask);
+        Entity     allocateEntity();
+        // Append a zeroed row for the entity, return where it went
+        void       addRow(Archetype& archetype, Entity entity, Slot& slot);
+        // Fill the hole with the archetype's last row
+        void       removeRow(Archetype& archetype, uint32_t chunk, uint32_t row);
+        void       changeArchetype(Entity entity, uint32_t type, bool add);
+        void*      getComponent(Entity entity, uint32_t type, bool write) noexcept;
+
+    private:
+        std::unordered_map<ComponentMask, std::unique_ptr<Archetype>> m_archetypes;
+        std::vector<Archetype*>                                        m_archetypeList;
+
+        std::vector<Slot>     m_slots;
+        std::vector<uint32_t> m_freeSlots;
+        uint32_t              m_entityCount = 0;
+        uint64_t              m_version     = 1;
+        uint64_t              m_moves       = 0;
+
+        std::vector<MatchedChunk> m_matchedChunks;
+    };
+}
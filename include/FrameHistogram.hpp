@@ -0,0 +1,70 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <cstdint>
+
+namespace GalgameEngine
+{
+    /*
+    * Frame duration histogram over a sliding window of the last frames
+    * Averages hide hitches, percentiles and max show them
+    *
+    * Durations are kept in microseconds in log-linear buckets (32 sub-buckets per power of two, < 3.2% error),
+    * the window keeps raw samples so the oldest one can be removed from its bucket when a new one comes in
+    *
+    * Lock-free: one thread records (the frame thread), any thread can read at the same time.
+    * A reader racing with record() may see one sample twice or miss one, which is fine for statistics
+    */
+    class FrameHistogram
+    {
+    public:
+        struct Summary
+        {
+            uint32_t count        = 0;      // Samples in window
+            float    p50          = 0.f;    // Milliseconds
+            float    p95          = 0.f;
+            float    p99          = 0.f;
+            float    max          = 0.f;
+            uint32_t stutterCount = 0;      // Frames longer than stutterFactor * p50
+        };
+
+        explicit FrameHistogram(uint32_t windowSize = 1024);
+
+        FrameHistogram(const FrameHistogram&)            = delete;
+        FrameHistogram(FrameHistogram&&)                 = delete;
+        FrameHistogram& operator=(const FrameHistogram&) = delete;
+        FrameHistogram& operator=(FrameHistogram&&)      = delete;
+
+        // Only one thread may record
+        void record(double seconds) noexcept;
+        void clear() noexcept;
+
+        uint32_t getCount() const noexcept { return m_count.load(std::memory_order_acquire); }
+        uint32_t getWindowSize() const noexcept { return m_windowSize; }
+
+        // Duration in milliseconds below which the given fraction (0 ~ 1) of frames are
+        float getPercentile(float fraction) const noexcept;
+        // Exact longest frame in window, in milliseconds
+        float getMax() const noexcept;
+
+        Summary getSummary(float stutterFactor = 2.f) const noexcept;
+
+    private:
+        static constexpr uint32_t SubBucketBits = 5;
+        static constexpr uint32_t SubBuckets    = 1 << SubBucketBits;
+        static constexpr uint32_t BucketCount   = (32 - SubBucketBits + 1) * SubBuckets;
+
+        static uint32_t bucketIndex(uint32_t us) noexcept;
+        static uint32_t bucketUpperBound(uint32_t index) noexcept;
+
+        uint32_t percentileOf(float fraction, uint32_t total) const noexcept;
+
+    private:
+        uint32_t                                m_windowSize;
+        std::unique_ptr<std::atomic<uint32_t>[]> m_samples;  // Ring of durations in microseconds
+        std::unique_ptr<std::atomic<uint32_t>[]> m_buckets;
+        std::atomic<uint32_t>                   m_count = 0;
+        uint32_t                                m_next  = 0;  // Only touched by the recording thread
+    };
+}
@@ -0,0 +1,154 @@
+#pragma once
+
+#include <random>
+#include <cstdint>
+
+namespace GalgameEngine
+{
+    class SwapChain;
+
+    /*
+    * Time source of the frame pacer
+    * The system one runs the real loop, a simulated one makes pacing deterministic and measurable without a display
+    */
+    class FrameClock
+    {
+    public:
+        virtual ~FrameClock() = default;
+
+        virtual int64_t now() = 0;
+        virtual double  getSecondsPerCount() const = 0;
+
+        // OS sleep, may wake late by the timer granularity of the OS
+        virtual void sleep(double seconds) = 0;
+        // One iteration of a busy wait
+        virtual void spin() = 0;
+    };
+
+    // Timer ticks, high resolution waitable timer on Windows, sleep_for elsewhere
+    class SystemFrameClock final : public FrameClock
+    {
+    public:
+        SystemFrameClock();
+        ~SystemFrameClock() override;
+
+        SystemFrameClock(const SystemFrameClock&)            = delete;
+        SystemFrameClock(SystemFrameClock&&)                 = delete;
+        SystemFrameClock& operator=(const SystemFrameClock&) = delete;
+        SystemFrameClock& operator=(SystemFrameClock&&)      = delete;
+
+        int64_t now() override;
+        double  getSecondsPerCount() const override;
+        void    sleep(double seconds) override;
+        void    spin() override;
+
+    private:
+        void* m_timer = nullptr;    // Waitable timer HANDLE on Windows
+    };
+
+    /*
+    * Clock which only moves when told to, counted in nanoseconds
+    * Sleeps wake on the next tick of a simulated OS timer plus random scheduling delay, spins cost a fixed time
+    */
+    class SimulatedFrameClock final : public FrameClock
+    {
+    public:
+        struct Config
+        {
+            double   timerPeriod = 0.001;   // OS timer granularity, a sleep ends on a multiple of it
+            double   wakeJitter  = 0.0005;  // Largest extra scheduling delay after the timer fires
+            double   spinCost    = 1e-7;    // Time one spin() takes
+            uint32_t seed        = 1;
+        };
+
+        explicit SimulatedFrameClock(const Config& config) : m_config(config), m_random(config.seed) {}
+
+        int64_t now() override { return m_now; }
+        double  getSecondsPerCount() const override { return 1e-9; }
+        void    sleep(double seconds) override;
+        void    spin() override { advance(m_config.spinCost); }
+
+        // Time spent by the frame itself, e.g. measured CPU time of rendering
+        void advance(double seconds) noexcept { m_now += static_cast<int64_t>(seconds * 1e9); }
+
+    private:
+        Config       m_config;
+        std::mt19937 m_random;
+        int64_t      m_now = 0;
+    };
+
+    /*
+    * Decides when the next frame starts
+    * TargetFps starts frames on a fixed cadence. Deadlines advance by whole periods so the rate does not drift,
+    * a frame late by more than a period starts a new cadence instead of rushing to catch up.
+    * LatencyTarget first waits until the swap chain can queue another frame (frame latency waitable object),
+    * so input is read as late as possible, and caps the rate like TargetFps when targetFps is set.
+    *
+    * Waiting sleeps while the time left is larger than the predicted oversleep of the OS and spins the rest.
+    * The prediction is the mean plus two standard deviations of observed 1ms sleeps, so it follows
+    * the timer resolution of the machine
+    */
+    class FramePacer
+    {
+    public:
+        enum class Mode : uint8_t
+        {
+            Unlimited,
+            TargetFps,
+            LatencyTarget,
+        };
+
+        struct Config
+        {
+            Mode   mode      = Mode::TargetFps;
+            double targetFps = 60.0;        // 0 means no cap in LatencyTarget mode
+        };
+
+        struct Stats
+        {
+            uint64_t frames        = 0;
+            uint64_t lateFrames    = 0;     // Started more than 1ms after their deadline, or resynchronized
+            uint64_t sleeps        = 0;
+            double   sleepSeconds  = 0.0;
+            double   spinSeconds   = 0.0;   // Busy waiting, what a too pessimistic prediction costs
+            double   totalError    = 0.0;   // Sum of |start - deadline| in seconds, mean error is the jitter
+            double   maxError      = 0.0;
+            double   sleepEstimate = 0.0;   // Current predicted duration of a 1ms sleep
+        };
+
+        FramePacer(FrameClock& clock, const Config& config);
+
+        FramePacer(const FramePacer&)            = delete;
+        FramePacer(FramePacer&&)                 = delete;
+        FramePacer& operator=(const FramePacer&) = delete;
+        FramePacer& operator=(FramePacer&&)      = delete;
+
+        // Block until the next frame should start, call right before reading input of the frame
+        // Swap chain is only used in LatencyTarget mode
+        void waitForNextFrame(SwapChain* swapChain = nullptr);
+
+        // Start a new cadence from now, e.g. after the loop was paused
+        void reset() noexcept;
+
+        void setConfig(const Config& config) noexcept;
+
+        const Config& getConfig() const noexcept { return m_config; }
+        const Stats&  getStats()  const noexcept { return m_stats; }
+
+    private:
+        void waitUntil(int64_t deadline);
+        void recordSleep(double seconds) noexcept;
+
+    private:
+        FrameClock& m_clock;
+        Config      m_config;
+        int64_t     m_period   = 0;     // Ticks, 0 without a cap
+        int64_t     m_deadline = 0;     // Start of the next frame, 0 before the first frame
+
+        // Running statistics of observed 1ms sleeps in seconds
+        double m_sleepMean     = 0.002;
+        double m_sleepVariance = 0.0;
+
+        Stats m_stats;
+    };
+}
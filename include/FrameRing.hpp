@@ -0,0 +1,85 @@
+#pragma once
+
+#include "CommandQueue.hpp"
+
+#include <vector>
+#include <cstdint>
+
+#include <assert.h>
+
+namespace GalgameEngine
+{
+    /*
+    * Ring of per-frame resources (command allocators, upload memory...) for frames in flight
+    * CPU records frame N while GPU still executes frame N - 1 ... N - frameCount + 1,
+    * it only waits when the slot it is about to reuse has not been finished by GPU
+    */
+    template <typename FrameResource>
+    class FrameRing
+    {
+    public:
+        FrameRing(CommandQueue& queue, uint32_t frameCount)
+            : m_queue(queue), m_slots(frameCount)
+        {
+            assert(frameCount > 0);
+        }
+
+        FrameRing(const FrameRing&)            = delete;
+        FrameRing(FrameRing&&)                 = delete;
+        FrameRing& operator=(const FrameRing&) = delete;
+        FrameRing& operator=(FrameRing&&)      = delete;
+
+        // Wait until GPU finished the last frame which used current slot, then return the slot resource
+        FrameResource& beginFrame()
+        {
+            auto& slot = m_slots[m_index];
+            if (!m_queue.isCompleted(slot.fenceValue))
+            {
+                ++m_stallCount;
+                m_queue.waitForValue(slot.fenceValue);
+            }
+            return slot.resource;
+        }
+
+        // Mark current slot with a fence value after frame commands are submitted and move to next slot
+        // Return the fence value, GPU reaches it when the frame is finished
+        uint64_t endFrame()
+        {
+            auto fenceValue = m_queue.signal();
+            m_slots[m_index].fenceValue = fenceValue;
+            m_index = (m_index + 1) % getFrameCount();
+            ++m_frameNumber;
+            return fenceValue;
+        }
+
+        // Wait GPU finish all frames in flight
+        void waitIdle()
+        {
+            for (auto& slot : m_slots)
+                m_queue.waitForValue(slot.fenceValue);
+        }
+
+        FrameResource&       current()       noexcept { return m_slots[m_index].resource; }
+        FrameResource&       operator[](uint32_t i)       noexcept { return m_slots[i].resource; }
+        const FrameResource& operator[](uint32_t i) const noexcept { return m_slots[i].resource; }
+
+        uint32_t getFrameCount()  const noexcept { return static_cast<uint32_t>(m_slots.size()); }
+        uint32_t getFrameIndex()  const noexcept { return m_index; }
+        uint64_t getFrameNumber() const noexcept { return m_frameNumber; }
+        // How many times beginFrame() had to block on GPU
+        uint64_t getStallCount()  const noexcept { return m_stallCount; }
+
+    private:
+        struct Slot
+        {
+            FrameResource resource   = {};
+            uint64_t      fenceValue = 0;
+        };
+
+        CommandQueue&     m_queue;
+        std::vector<Slot> m_slots;
+        uint32_t          m_index       = 0;
+        uint64_t          m_frameNumber = 0;
+        uint64_t          m_stallCount  = 0;
+    };
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include "Device.hpp"
+#include "Profiler.hpp"
+#include "CommandQueue.hpp"
+
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <cstdint>
+
+namespace GalgameEngine
+{
+    /*
+    * GPU timings of scoped markers, measured with timestamp queries
+    * Every frame in flight has its own query heap and readback buffer. A marker writes a timestamp at its begin
+    * and end, endFrame() resolves them into the readback buffer at the end of the frame and beginFrame() reads
+    * them back once the frame's fence has passed, frameCount frames later, so CPU never waits on GPU for them.
+    * A slot whose frame has not finished when it comes around again is dropped instead of waited for.
+    *
+    * GPU ticks are mapped onto the Timer clock through a calibration taken every calibrationInterval frames.
+    * With the profiler enabled, markers go to a profiler track and show up in the same trace as CPU scopes
+    *
+    * beginMarker() and endMarker() from any recording thread, the rest on the frame thread
+    */
+    class GpuProfiler
+    {
+    public:
+        static constexpr uint32_t InvalidMarker = UINT32_MAX;
+
+        struct Config
+        {
+            uint32_t frameCount          = 3;       // Frames in flight, results come back this many frames later
+            uint32_t maxMarkers          = 256;     // Per frame, markers over it are dropped
+            uint32_t calibrationInterval = 60;      // Frames between clock calibrations
+        };
+
+        struct Marker
+        {
+            const char* name;
+            int64_t     begin;                      // Timer ticks
+            int64_t     end;
+        };
+
+        struct Stats
+        {
+            uint64_t resolvedFrames = 0;
+            uint64_t lostFrames     = 0;            // Slots reused before GPU finished their frame
+            uint64_t droppedMarkers = 0;            // Over maxMarkers
+            uint64_t calibrations   = 0;
+            double   frameGpuTime   = 0.0;          // Seconds from the first begin to the last end of the latest resolved frame
+        };
+
+        // Names must outlive the profiler like profiler scope names
+        GpuProfiler(Device& device, CommandQueue& queue, const Config& config, const char* trackName = "GPU");
+        ~GpuProfiler() = default;
+
+        GpuProfiler(const GpuProfiler&)            = delete;
+        GpuProfiler(GpuProfiler&&)                 = delete;
+        GpuProfiler& operator=(const GpuProfiler&) = delete;
+        GpuProfiler& operator=(GpuProfiler&&)      = delete;
+
+        // After the frame slot is waited for, before any marker of the frame
+        void beginFrame();
+
+        // Return InvalidMarker when the frame is out of markers, endMarker() ignores it
+        uint32_t beginMarker(CommandList& list, const char* name);
+        void     endMarker(CommandList& list, uint32_t marker);
+
+        // Resolve the frame's markers, the list must run after every list with markers
+        void endFrame(CommandList& list);
+        // With the fence value which finishes the frame
+        void finishFrame(uint64_t fenceValue);
+
+        // Markers of the latest resolved frame
+        const std::vector<Marker>& getMarkers() const noexcept { return m_markers; }
+        const Stats&               getStats() const noexcept { return m_stats; }
+
+    private:
+        struct Slot
+        {
+            std::unique_ptr<TimestampQueryHeap> queryHeap;
+            std::unique_ptr<Buffer>             readback;
+            std::vector<const char*>            names;
+            std::vector<uint8_t>                ended;          // Markers without an end are not read back
+            uint32_t                            markerCount = 0;
+            uint64_t                            fenceValue  = 0;
+            bool                                pending     = false;
+        };
+
+        void    calibrate();
+        void    readBack(Slot& slot);
+        int64_t toTicks(uint64_t timestamp) const noexcept;
+
+    private:
+        Device&       m_device;
+        CommandQueue& m_queue;
+        Config        m_config;
+        uint32_t      m_track;
+
+        std::vector<Slot>     m_slots;
+        uint64_t              m_frame      = 0;
+        Slot*                 m_slot       = nullptr;   // Of the frame being recorded
+        std::atomic<uint32_t> m_nextMarker = 0;
+
+        ClockCalibration m_calibration;
+        double           m_ticksPerTimestamp = 0.0; // Timer ticks per GPU tick
+
+        std::vector<Marker>          m_markers;
+        std::vector<Profiler::Event> m_events;      // Reused to publish markers to the track
+        Stats                        m_stats;
+    };
+}
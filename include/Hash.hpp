@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <type_traits>
+
+namespace GalgameEngine
+{
+    /*
+    * Streaming 64-bit hash for cache keys and file checksums, not cryptographic
+    * Input is consumed eight bytes at a time, every word goes through the murmur3 finalizer.
+    * The value only depends on the bytes and how they are split into add() calls, so it is stable
+    * across runs and machines of the same byte order and can be stored on disk
+    */
+    class Hasher
+    {
+    public:
+        explicit Hasher(uint64_t seed = 0) noexcept : m_state(seed ^ 0x9E3779B97F4A7C15ull) {}
+
+        void add(const void* data, size_t size) noexcept
+        {
+            auto bytes = static_cast<const uint8_t*>(data);
+            m_length += size;
+            for (; size >= 8; bytes += 8, size -= 8)
+            {
+                uint64_t word;
+                std::memcpy(&word, bytes, 8);
+                mixWord(word);
+            }
+            if (size > 0)
+            {
+                // Tail is padded with zeros, the length mixed in by finish() tells it apart from real zeros
+                uint64_t word = 0;
+                std::memcpy(&word, bytes, size);
+                mixWord(word);
+            }
+        }
+
+        // Only for types without padding, padding bytes are indeterminate
+        template <typename T>
+        void addValue(const T& value) noexcept
+        {
+            static_assert(std::is_trivially_copyable_v<T>);
+            add(&value, sizeof(value));
+        }
+
+        // Length first, so ("ab", "c") and ("a", "bc") differ
+        void addString(std::string_view string) noexcept
+        {
+            addValue(static_cast<uint64_t>(string.size()));
+            add(string.data(), string.size());
+        }
+
+        uint64_t finish() const noexcept { return mix(m_state ^ m_length); }
+
+    private:
+        static uint64_t mix(uint64_t value) noexcept
+        {
+            value ^= value >> 33;
+            value *= 0xFF51AFD7ED558CCDull;
+            value ^= value >> 33;
+            value *= 0xC4CEB9FE1A85EC53ull;
+            value ^= value >> 33;
+            return value;
+        }
+
+        void mixWord(uint64_t word) noexcept
+        {
+            m_state = (m_state ^ mix(word)) * 0x9E3779B97F4A7C15ull + 0x632BE59BD9B4E019ull;
+        }
+
+    private:
+        uint64_t m_state;
+        uint64_t m_length = 0;
+    };
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "Device.hpp"
+#include "UploadRing.hpp"
+#include "EntityStore.hpp"
+#include "ResourceStateTracker.hpp"
+
+#include <deque>
+#include <memory>
+#include <vector>
+#include <cstdint>
+
+namespace GalgameEngine
+{
+    /*
+    * Keeps the LocalToWorld matrices of a scene in one default heap buffer, indexed by entity index
+    * Every frame only chunks whose LocalToWorld changed since the last upload are copied: matrices go
+    * through the upload ring, consecutive entity indices become one copy. Moving entities between chunks
+    * does not move them in the buffer, so a static scene uploads nothing.
+    *
+    * The buffer grows by creating a bigger one and uploading everything again,
+    * the old one is released when GPU passes the frame fence
+    */
+    class InstanceUploader
+    {
+    public:
+        static constexpr uint64_t InstanceSize = 64;    // One Mat4
+
+        struct Stats
+        {
+            uint64_t instances = 0;     // Uploaded in the last frame
+            uint64_t bytes     = 0;
+            uint64_t copies    = 0;
+            uint64_t capacity  = 0;     // Instances the buffer holds
+            uint64_t grows     = 0;     // Since creation
+        };
+
+        InstanceUploader(Device& device, UploadRing& uploadRing);
+        ~InstanceUploader() = default;
+
+        InstanceUploader(const InstanceUploader&)            = delete;
+        InstanceUploader(InstanceUploader&&)                 = delete;
+        InstanceUploader& operator=(const InstanceUploader&) = delete;
+        InstanceUploader& operator=(InstanceUploader&&)      = delete;
+
+        // Grow the buffer for the store ahead of record(), getBuffer() then stays the same while the frame is recorded
+        void reserve(const EntityStore& store);
+
+        // Record the copies of this frame, the buffer is left in ShaderResource state
+        // The store may not change while the frame is recorded
+        void record(EntityStore& store, CommandList& commandList, ResourceStateTracker& tracker);
+
+        // Buffers replaced in the frame are released after GPU reaches fenceValue
+        void finishFrame(uint64_t fenceValue);
+
+        // Null before the first upload
+        Buffer* getBuffer() const noexcept { return m_buffer.get(); }
+
+        const Stats& getStats() const noexcept { return m_stats; }
+
+    private:
+        void grow(uint32_t indexCount);
+
+    private:
+        struct RetiredBuffer
+        {
+            std::unique_ptr<Buffer> buffer;
+            uint64_t                fenceValue;
+        };
+
+        Device&     m_device;
+        UploadRing& m_uploadRing;
+
+        std::unique_ptr<Buffer>              m_buffer;
+        uint64_t                             m_capacity    = 0;
+        uint64_t                             m_lastVersion = 0;
+        std::vector<std::unique_ptr<Buffer>> m_replaced;     // Retired by the current frame
+        std::deque<RetiredBuffer>            m_retired;
+
+        std::vector<EntityStore::ChunkView> m_chunks;
+        Stats                               m_stats;
+    };
+}
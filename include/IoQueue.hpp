@@ -0,0 +1,123 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+namespace GalgameEngine
+{
+    /*
+    * Asynchronous file reads, started without blocking and reaped by polling
+    * io_uring on Linux and overlapped reads on an I/O completion port on Windows, so the OS runs the reads
+    * and no thread of ours blocks on the disk. Where io_uring is missing or disabled (old kernel, sandbox)
+    * a pool of threads does blocking reads instead, with the same interface.
+    *
+    * A read completes once all its bytes are there, short reads are continued inside the queue.
+    * Reads of more than MaxReadSize go to the OS in pieces.
+    *
+    * Not thread safe, one thread starts reads and polls
+    */
+    class IoQueue
+    {
+    public:
+#ifdef _WIN32
+        using FileHandle = void*;   // HANDLE opened for overlapped reads
+#else
+        using FileHandle = int;
+#endif
+        static const FileHandle InvalidFile;
+
+        static constexpr uint64_t MaxReadSize = 1ull << 30;
+
+        enum class Backend : uint8_t
+        {
+            Uring,
+            Overlapped,
+            Threads,
+        };
+
+        struct Config
+        {
+            uint32_t depth        = 64;     // Reads in flight at most
+            uint32_t threadCount  = 2;      // Threads of the fallback backend
+            bool     forceThreads = false;  // Use the fallback even where the OS queue works, for comparison
+        };
+
+        struct Completion
+        {
+            uint64_t userData;
+            int64_t  result;    // Bytes read, fewer than asked only at the end of the file, or negative OS error code
+        };
+
+        struct Stats
+        {
+            uint64_t reads       = 0;
+            uint64_t bytesRead   = 0;
+            uint64_t osRequests  = 0;   // Reads handed to the OS, more than reads when split or short
+            uint64_t submitCalls = 0;   // System calls which started reads
+            uint64_t errors      = 0;
+        };
+
+        explicit IoQueue(const Config& config);
+        ~IoQueue();
+
+        IoQueue(const IoQueue&)            = delete;
+        IoQueue(IoQueue&&)                 = delete;
+        IoQueue& operator=(const IoQueue&) = delete;
+        IoQueue& operator=(IoQueue&&)      = delete;
+
+        // Opened for the reads of this queue, InvalidFile when it cannot be opened
+        FileHandle openFile(const std::string& path);
+        // No read of the file may be in flight
+        void       closeFile(FileHandle file);
+        uint64_t   getFileSize(FileHandle file) const;
+
+        // Read size bytes at offset into dest, which must stay valid until the read completes
+        // Return false when depth reads are in flight already. The read may only start at the next submit() or poll()
+        bool read(FileHandle file, uint64_t offset, uint64_t size, void* dest, uint64_t userData);
+        // Hand reads started since the last call to the OS
+        void submit();
+        // Submit, then take up to maxCount completed reads. With wait, block until at least one completes unless none is in flight
+        uint32_t poll(Completion* completions, uint32_t maxCount, bool wait = false);
+
+        uint32_t getInFlight() const noexcept { return m_inFlight; }
+        uint32_t getDepth()    const noexcept { return m_depth; }
+        Backend  getBackend()  const noexcept { return m_backend; }
+
+        const Stats& getStats() const noexcept { return m_stats; }
+
+    private:
+        struct Request;
+        struct Uring;
+        struct Workers;
+
+        // Hand the next piece of a request to the OS, return false when it failed at once
+        bool startRequest(uint32_t index);
+        // Account bytes or an error of a finished piece, return true when the request is done
+        bool finishPiece(uint32_t index, int64_t result);
+        void complete(uint32_t index, Completion* completions, uint32_t& count);
+
+        uint32_t pollUring(Completion* completions, uint32_t maxCount, bool wait);
+        uint32_t pollWorkers(Completion* completions, uint32_t maxCount, bool wait);
+        uint32_t pollOverlapped(Completion* completions, uint32_t maxCount, bool wait);
+
+        void workerThread();
+
+    private:
+        uint32_t m_depth;
+        Backend  m_backend;
+
+        std::unique_ptr<Request[]> m_requests;
+        std::vector<uint32_t>      m_freeRequests;
+        std::vector<uint32_t>      m_finished;      // Requests which ended when started, reported by the next poll
+        uint32_t                   m_inFlight = 0;
+        Stats                      m_stats;
+
+        std::unique_ptr<Uring>   m_uring;
+        std::unique_ptr<Workers> m_workers;
+#ifdef _WIN32
+        void* m_port = nullptr;     // I/O completion port HANDLE
+#endif
+    };
+}
@@ -0,0 +1,166 @@
+#pragma once
+
+#include "WorkStealingQueue.hpp"
+
+#include <new>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <utility>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <condition_variable>
+
+namespace GalgameEngine
+{
+    // Number of jobs not finished yet, JobSystem::wait() returns when it drops to 0
+    class JobCounter
+    {
+    public:
+        JobCounter() = default;
+
+        JobCounter(const JobCounter&)            = delete;
+        JobCounter(JobCounter&&)                 = delete;
+        JobCounter& operator=(const JobCounter&) = delete;
+        JobCounter& operator=(JobCounter&&)      = delete;
+
+        bool isDone() const noexcept { return m_value.load(std::memory_order_acquire) == 0; }
+
+    private:
+        friend class JobSystem;
+
+        std::atomic<uint32_t> m_value = 0;
+    };
+
+    /*
+    * Work stealing job scheduler
+    * Every thread owns a Chase-Lev deque and a pool of job slots, so scheduling never locks or allocates.
+    * Idle threads steal from random victims and sleep only after a spin, waking is skipped when nobody sleeps.
+    *
+    * Thread 0 is the thread which created the system, it runs jobs while it waits on a counter.
+    * Only threads of the system may schedule and wait.
+    * getThreadIndex() is stable during a job, use it to pick per-thread resources such as command allocators
+    */
+    class JobSystem
+    {
+    public:
+        // Bytes a job function may capture
+        static constexpr uint32_t JobStorageSize = 48;
+        // Jobs in flight per scheduling thread
+        static constexpr uint32_t JobPoolCapacity = 4096;
+
+        struct Stats
+        {
+            uint64_t executed = 0;  // Jobs run, including those run inline by a full queue
+            uint64_t stolen   = 0;  // Jobs taken from another thread's deque
+            uint64_t sleeps   = 0;  // Times a worker went to sleep on an empty system
+        };
+
+        // 0 means one thread per hardware thread, the creating thread counts as one
+        explicit JobSystem(uint32_t threadCount = 0);
+        ~JobSystem();
+
+        JobSystem(const JobSystem&)            = delete;
+        JobSystem(JobSystem&&)                 = delete;
+        JobSystem& operator=(const JobSystem&) = delete;
+        JobSystem& operator=(JobSystem&&)      = delete;
+
+        // Run function() on any thread, counter is decremented when it returns
+        template <typename Function>
+        void schedule(JobCounter& counter, Function&& function);
+
+        // Split [0, count) into ranges of at most grain and run function(begin, end) on them
+        // function is referenced by the jobs, it must live until the counter is waited, so temporaries are not taken
+        template <typename Function>
+        void parallelFor(JobCounter& counter, uint32_t count, uint32_t grain, Function& function);
+
+        // Run other jobs until counter drops to 0
+        void wait(JobCounter& counter);
+
+        uint32_t getThreadCount() const noexcept { return static_cast<uint32_t>(m_threads.size()); }
+
+        // Index of the calling thread in [0, getThreadCount())
+        uint32_t getThreadIndex() const noexcept;
+
+        Stats getStats() const noexcept;
+
+    private:
+        struct Job
+        {
+            void (*invoke)(void* storage) = nullptr;
+            JobCounter*       counter     = nullptr;
+            std::atomic<bool> busy        = false;    // Slot is queued or running, cannot be reused
+            alignas(std::max_align_t) unsigned char storage[JobStorageSize];
+        };
+
+        struct alignas(64) ThreadContext
+        {
+            ThreadContext() : queue(JobPoolCapacity), jobs(std::make_unique<Job[]>(JobPoolCapacity)) {}
+
+            WorkStealingQueue<Job*> queue;
+            std::unique_ptr<Job[]>  jobs;
+            uint32_t                nextJob = 0;
+            uint32_t                random;         // Victim selection state
+
+            std::atomic<uint64_t> executed = 0;
+            std::atomic<uint64_t> stolen   = 0;
+            std::atomic<uint64_t> sleeps   = 0;
+        };
+
+        ThreadContext& getContext() noexcept;
+
+        Job* allocateJob();
+        void submit(Job* job);
+
+        bool tryRunJob(ThreadContext& context);
+        void runJob(ThreadContext& context, Job* job);
+
+        void workerMain(uint32_t index);
+
+    private:
+        std::vector<std::unique_ptr<ThreadContext>> m_threads;
+        std::vector<std::thread>                    m_workers;
+
+        // Sleeping workers wait on m_wakeup, m_queued counts jobs pushed but not taken yet
+        std::mutex              m_mutex;
+        std::condition_variable m_wakeup;
+        std::atomic<uint32_t>   m_queued   = 0;
+        std::atomic<uint32_t>   m_sleeping = 0;
+        std::atomic<bool>       m_stop     = false;
+    };
+
+    template <typename Function>
+    void JobSystem::schedule(JobCounter& counter, Function&& function)
+    {
+        using Stored = std::decay_t<Function>;
+        static_assert(sizeof(Stored) <= JobStorageSize, "Job captures too much, capture a pointer to the data");
+        static_assert(alignof(Stored) <= alignof(std::max_align_t));
+
+        auto job = allocateJob();
+        new (job->storage) Stored(std::forward<Function>(function));
+        job->invoke = [](void* storage)
+        {
+            auto& stored = *std::launder(reinterpret_cast<Stored*>(storage));
+            stored();
+            stored.~Stored();
+        };
+        job->counter = &counter;
+        counter.m_value.fetch_add(1, std::memory_order_relaxed);
+        submit(job);
+    }
+
+    template <typename Function>
+    void JobSystem::parallelFor(JobCounter& counter, uint32_t count, uint32_t grain, Function& function)
+    {
+        if (grain == 0)
+            grain = 1;
+        for (uint32_t begin = 0; begin < count; begin += grain)
+        {
+            uint32_t end = count - begin < grain ? count : begin + grain;
+            schedule(counter, [&function, begin, end]() { function(begin, end); });
+        }
+    }
+}
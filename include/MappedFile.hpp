@@ -0,0 +1,43 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+
+namespace GalgameEngine
+{
+    /*
+    * Read-only memory mapping of a whole file
+    * Pages are read by the OS on first touch and shared with the page cache, so loading copies nothing
+    * and a file larger than what is touched costs only address space
+    */
+    class MappedFile
+    {
+    public:
+        MappedFile() = default;
+        ~MappedFile() { close(); }
+
+        MappedFile(const MappedFile&)            = delete;
+        MappedFile(MappedFile&&)                 = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+        MappedFile& operator=(MappedFile&&)      = delete;
+
+        // Return false when the file is missing, empty or cannot be mapped
+        bool open(const std::string& path);
+        void close() noexcept;
+
+        // Ask the OS to read a range ahead, e.g. blobs about to be copied in full
+        void prefetch(uint64_t offset, uint64_t size) const noexcept;
+
+        const uint8_t* getData() const noexcept { return m_data; }
+        uint64_t       getSize() const noexcept { return m_size; }
+        bool           isOpen()  const noexcept { return m_data != nullptr; }
+
+    private:
+        const uint8_t* m_data = nullptr;
+        uint64_t       m_size = 0;
+#ifdef _WIN32
+        void* m_file    = nullptr;  // File and mapping HANDLEs
+        void* m_mapping = nullptr;
+#endif
+    };
+}
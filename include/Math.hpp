@@ -0,0 +1,259 @@
+#pragma once
+
+#include "Simd.hpp"
+
+#include <cmath>
+#include <cstdint>
+
+namespace GalgameEngine
+{
+    /*
+    * Vectors, quaternions and matrices, header-only like DirectXMath but without Windows headers
+    * Conventions follow DirectXMath: row vectors multiplied on the left (v * M), row-major storage,
+    * translation in the last row, left-handed view space. A matrix product A * B applies A first
+    *
+    * Vec3 is plain scalar code, three lanes are not worth a register. Mat4 and Quat math runs on Simd::Float4
+    */
+
+    constexpr float Pi = 3.14159265358979323846f;
+
+    struct Vec3
+    {
+        float x = 0.f;
+        float y = 0.f;
+        float z = 0.f;
+    };
+
+    inline Vec3  operator+(Vec3 a, Vec3 b) noexcept  { return { a.x + b.x, a.y + b.y, a.z + b.z }; }
+    inline Vec3  operator-(Vec3 a, Vec3 b) noexcept  { return { a.x - b.x, a.y - b.y, a.z - b.z }; }
+    inline Vec3  operator*(Vec3 a, Vec3 b) noexcept  { return { a.x * b.x, a.y * b.y, a.z * b.z }; }
+    inline Vec3  operator*(Vec3 a, float s) noexcept { return { a.x * s, a.y * s, a.z * s }; }
+    inline Vec3  operator-(Vec3 a) noexcept          { return { -a.x, -a.y, -a.z }; }
+    inline float dot(Vec3 a, Vec3 b) noexcept        { return a.x * b.x + a.y * b.y + a.z * b.z; }
+    inline Vec3  cross(Vec3 a, Vec3 b) noexcept      { return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x }; }
+    inline float length(Vec3 a) noexcept             { return std::sqrt(dot(a, a)); }
+    inline Vec3  min(Vec3 a, Vec3 b) noexcept        { return { a.x < b.x ? a.x : b.x, a.y < b.y ? a.y : b.y, a.z < b.z ? a.z : b.z }; }
+    inline Vec3  max(Vec3 a, Vec3 b) noexcept        { return { a.x > b.x ? a.x : b.x, a.y > b.y ? a.y : b.y, a.z > b.z ? a.z : b.z }; }
+
+    // Zero vector stays zero
+    inline Vec3 normalize(Vec3 a) noexcept
+    {
+        float len = length(a);
+        return len > 0.f ? a * (1.f / len) : a;
+    }
+
+    struct alignas(16) Vec4
+    {
+        float x = 0.f;
+        float y = 0.f;
+        float z = 0.f;
+        float w = 0.f;
+
+        Simd::Float4 load() const noexcept          { return Simd::Float4::load(&x); }
+        void         store(Simd::Float4 v) noexcept { Simd::store(&x, v); }
+    };
+
+    // Rotation, (x, y, z) is the axis scaled by sin(angle / 2), w is cos(angle / 2)
+    struct alignas(16) Quat
+    {
+        float x = 0.f;
+        float y = 0.f;
+        float z = 0.f;
+        float w = 1.f;
+
+        static Quat fromAxisAngle(Vec3 axis, float angle) noexcept
+        {
+            auto  n = normalize(axis);
+            float s = std::sin(angle * 0.5f);
+            return { n.x * s, n.y * s, n.z * s, std::cos(angle * 0.5f) };
+        }
+
+        Simd::Float4 load() const noexcept          { return Simd::Float4::load(&x); }
+        void         store(Simd::Float4 v) noexcept { Simd::store(&x, v); }
+    };
+
+    // Rotation by a, then by b
+    inline Quat operator*(Quat a, Quat b) noexcept
+    {
+        return { b.w * a.x + b.x * a.w + b.y * a.z - b.z * a.y,
+                 b.w * a.y - b.x * a.z + b.y * a.w + b.z * a.x,
+                 b.w * a.z + b.x * a.y - b.y * a.x + b.z * a.w,
+                 b.w * a.w - b.x * a.x - b.y * a.y - b.z * a.z };
+    }
+
+    inline Quat normalize(Quat q) noexcept
+    {
+        auto  v   = q.load();
+        float len = std::sqrt(Simd::dot4(v, v));
+        Quat  result;
+        result.store(len > 0.f ? v * Simd::Float4::splat(1.f / len) : v);
+        return result;
+    }
+
+    inline Quat conjugate(Quat q) noexcept { return { -q.x, -q.y, -q.z, q.w }; }
+
+    inline Vec3 rotate(Vec3 v, Quat q) noexcept
+    {
+        // v + 2w(u x v) + 2u x (u x v), u is the vector part
+        Vec3 u = { q.x, q.y, q.z };
+        Vec3 t = cross(u, v) * 2.f;
+        return v + t * q.w + cross(u, t);
+    }
+
+    // Normalized lerp along the shorter arc, close to slerp for the small steps of animation
+    inline Quat nlerp(Quat a, Quat b, float t) noexcept
+    {
+        auto va = a.load();
+        auto vb = b.load();
+        float sign = Simd::dot4(va, vb) < 0.f ? -1.f : 1.f;
+        Quat result;
+        result.store(Simd::madd(vb * Simd::Float4::splat(sign) - va, Simd::Float4::splat(t), va));
+        return normalize(result);
+    }
+
+    struct alignas(16) Mat4
+    {
+        Vec4 rows[4] = { { 1.f, 0.f, 0.f, 0.f }, { 0.f, 1.f, 0.f, 0.f }, { 0.f, 0.f, 1.f, 0.f }, { 0.f, 0.f, 0.f, 1.f } };
+
+        static Mat4 identity() noexcept { return {}; }
+
+        static Mat4 translation(Vec3 t) noexcept
+        {
+            Mat4 m;
+            m.rows[3] = { t.x, t.y, t.z, 1.f };
+            return m;
+        }
+
+        static Mat4 scaling(Vec3 s) noexcept
+        {
+            Mat4 m;
+            m.rows[0].x = s.x;
+            m.rows[1].y = s.y;
+            m.rows[2].z = s.z;
+            return m;
+        }
+
+        static Mat4 rotation(Quat q) noexcept { return fromTransform({}, q, { 1.f, 1.f, 1.f }); }
+
+        // Scale, then rotate, then translate
+        static Mat4 fromTransform(Vec3 t, Quat q, Vec3 s) noexcept
+        {
+            float xx = q.x * q.x, yy = q.y * q.y, zz = q.z * q.z;
+            float xy = q.x * q.y, xz = q.x * q.z, yz = q.y * q.z;
+            float wx = q.w * q.x, wy = q.w * q.y, wz = q.w * q.z;
+
+            Mat4 m;
+            m.rows[0] = { (1.f - 2.f * (yy + zz)) * s.x, 2.f * (xy + wz) * s.x, 2.f * (xz - wy) * s.x, 0.f };
+            m.rows[1] = { 2.f * (xy - wz) * s.y, (1.f - 2.f * (xx + zz)) * s.y, 2.f * (yz + wx) * s.y, 0.f };
+            m.rows[2] = { 2.f * (xz + wy) * s.z, 2.f * (yz - wx) * s.z, (1.f - 2.f * (xx + yy)) * s.z, 0.f };
+            m.rows[3] = { t.x, t.y, t.z, 1.f };
+            return m;
+        }
+
+        // Left-handed, depth 0 at the near plane and 1 at the far plane
+        static Mat4 perspectiveFov(float fovY, float aspect, float nearZ, float farZ) noexcept
+        {
+            float yScale = 1.f / std::tan(fovY * 0.5f);
+            float range  = farZ / (farZ - nearZ);
+
+            Mat4 m;
+            m.rows[0] = { yScale / aspect, 0.f, 0.f, 0.f };
+            m.rows[1] = { 0.f, yScale, 0.f, 0.f };
+            m.rows[2] = { 0.f, 0.f, range, 1.f };
+            m.rows[3] = { 0.f, 0.f, -range * nearZ, 0.f };
+            return m;
+        }
+
+        static Mat4 lookAt(Vec3 eye, Vec3 target, Vec3 up) noexcept
+        {
+            auto z = normalize(target - eye);
+            auto x = normalize(cross(up, z));
+            auto y = cross(z, x);
+
+            Mat4 m;
+            m.rows[0] = { x.x, y.x, z.x, 0.f };
+            m.rows[1] = { x.y, y.y, z.y, 0.f };
+            m.rows[2] = { x.z, y.z, z.z, 0.f };
+            m.rows[3] = { -dot(x, eye), -dot(y, eye), -dot(z, eye), 1.f };
+            return m;
+        }
+    };
+
+    // Row i of a * b is row i of a combined with the rows of b, four broadcast multiply-adds per row
+    inline Mat4 operator*(const Mat4& a, const Mat4& b) noexcept
+    {
+        auto b0 = b.rows[0].load();
+        auto b1 = b.rows[1].load();
+        auto b2 = b.rows[2].load();
+        auto b3 = b.rows[3].load();
+
+        Mat4 result;
+        for (int i = 0; i < 4; ++i)
+        {
+            auto row = a.rows[i].load();
+            auto r   = Simd::splatLane<0>(row) * b0;
+            r = Simd::madd(Simd::splatLane<1>(row), b1, r);
+            r = Simd::madd(Simd::splatLane<2>(row), b2, r);
+            r = Simd::madd(Simd::splatLane<3>(row), b3, r);
+            result.rows[i].store(r);
+        }
+        return result;
+    }
+
+    inline Vec4 transform(Vec4 v, const Mat4& m) noexcept
+    {
+        auto r = Simd::Float4::splat(v.x) * m.rows[0].load();
+        r = Simd::madd(Simd::Float4::splat(v.y), m.rows[1].load(), r);
+        r = Simd::madd(Simd::Float4::splat(v.z), m.rows[2].load(), r);
+        r = Simd::madd(Simd::Float4::splat(v.w), m.rows[3].load(), r);
+        Vec4 result;
+        result.store(r);
+        return result;
+    }
+
+    // w = 1, no perspective divide
+    inline Vec3 transformPoint(Vec3 p, const Mat4& m) noexcept
+    {
+        auto r = transform({ p.x, p.y, p.z, 1.f }, m);
+        return { r.x, r.y, r.z };
+    }
+
+    // w = 0, translation does not apply
+    inline Vec3 transformVector(Vec3 v, const Mat4& m) noexcept
+    {
+        auto r = transform({ v.x, v.y, v.z, 0.f }, m);
+        return { r.x, r.y, r.z };
+    }
+
+    inline Mat4 transpose(const Mat4& m) noexcept
+    {
+        Mat4 result;
+        auto src = &m.rows[0].x;
+        auto dst = &result.rows[0].x;
+        for (int i = 0; i < 4; ++i)
+            for (int j = 0; j < 4; ++j)
+                dst[i * 4 + j] = src[j * 4 + i];
+        return result;
+    }
+
+    // Only for matrices without projection, the last column must be (0, 0, 0, 1)
+    inline Mat4 inverseAffine(const Mat4& m) noexcept
+    {
+        // Inverse of the upper 3x3 from the cofactors of its rows, then the translation through it
+        Vec3 r0 = { m.rows[0].x, m.rows[0].y, m.rows[0].z };
+        Vec3 r1 = { m.rows[1].x, m.rows[1].y, m.rows[1].z };
+        Vec3 r2 = { m.rows[2].x, m.rows[2].y, m.rows[2].z };
+        Vec3 c0 = cross(r1, r2);
+        Vec3 c1 = cross(r2, r0);
+        Vec3 c2 = cross(r0, r1);
+        float invDet = 1.f / dot(r0, c0);
+
+        Mat4 result;
+        result.rows[0] = { c0.x * invDet, c1.x * invDet, c2.x * invDet, 0.f };
+        result.rows[1] = { c0.y * invDet, c1.y * invDet, c2.y * invDet, 0.f };
+        result.rows[2] = { c0.z * invDet, c1.z * invDet, c2.z * invDet, 0.f };
+        auto t = transformVector({ m.rows[3].x, m.rows[3].y, m.rows[3].z }, result);
+        result.rows[3] = { -t.x, -t.y, -t.z, 1.f };
+        return result;
+    }
+}
@@ -0,0 +1,177 @@
+#pragma once
+
+#include "Math.hpp"
+
+#include <cstddef>
+
+namespace GalgameEngine
+{
+    /*
+    * Batched kernels over thousands of objects per call
+    * Streams are structure-of-arrays, one float array per component, so the wide kernels load Simd::Width
+    * objects with one instruction per component. Matrices stay Mat4 arrays, that is what constant buffers take.
+    * Elements past the last full register go through the same math one at a time
+    *
+    * Input and output streams may not overlap unless they are the same arrays
+    */
+    struct TransformStreams
+    {
+        const float* position[3];
+        const float* rotation[4];   // Normalized quaternions
+        const float* scale[3];
+    };
+
+    struct PointStreams
+    {
+        float* position[3];
+    };
+
+    // Axis aligned boxes as center and half size, which transform without touching the eight corners
+    struct BoundsStreams
+    {
+        float* center[3];
+        float* extent[3];
+    };
+
+    namespace MathBatch
+    {
+        // out[i] = Mat4::fromTransform(position[i], rotation[i], scale[i])
+        inline void composeTransforms(const TransformStreams& in, Mat4* out, size_t count) noexcept
+        {
+            using Simd::FloatN;
+            constexpr uint32_t Width = Simd::Width;
+
+            size_t wideCount = count - count % Width;
+            size_t i         = 0;
+            for (; i < wideCount; i += Width)
+            {
+                auto qx = FloatN::load(in.rotation[0] + i);
+                auto qy = FloatN::load(in.rotation[1] + i);
+                auto qz = FloatN::load(in.rotation[2] + i);
+                auto qw = FloatN::load(in.rotation[3] + i);
+                auto sx = FloatN::load(in.scale[0] + i);
+                auto sy = FloatN::load(in.scale[1] + i);
+                auto sz = FloatN::load(in.scale[2] + i);
+
+                auto one = FloatN::splat(1.f);
+                auto two = FloatN::splat(2.f);
+                auto xx = qx * qx, yy = qy * qy, zz = qz * qz;
+                auto xy = qx * qy, xz = qx * qz, yz = qy * qz;
+                auto wx = qw * qx, wy = qw * qy, wz = qw * qz;
+
+                // Twelve elements of every matrix, one register each, then written out lane by lane
+                alignas(32) float lanes[12][Width];
+                store(lanes[0],  (one - two * (yy + zz)) * sx);
+                store(lanes[1],  two * (xy + wz) * sx);
+                store(lanes[2],  two * (xz - wy) * sx);
+                store(lanes[3],  two * (xy - wz) * sy);
+                store(lanes[4],  (one - two * (xx + zz)) * sy);
+                store(lanes[5],  two * (yz + wx) * sy);
+                store(lanes[6],  two * (xz + wy) * sz);
+                store(lanes[7],  two * (yz - wx) * sz);
+                store(lanes[8],  (one - two * (xx + yy)) * sz);
+                store(lanes[9],  FloatN::load(in.position[0] + i));
+                store(lanes[10], FloatN::load(in.position[1] + i));
+                store(lanes[11], FloatN::load(in.position[2] + i));
+
+                for (uint32_t lane = 0; lane < Width; ++lane)
+                {
+                    auto& m = out[i + lane];
+                    m.rows[0] = { lanes[0][lane], lanes[1][lane], lanes[2][lane], 0.f };
+                    m.rows[1] = { lanes[3][lane], lanes[4][lane], lanes[5][lane], 0.f };
+                    m.rows[2] = { lanes[6][lane], lanes[7][lane], lanes[8][lane], 0.f };
+                    m.rows[3] = { lanes[9][lane], lanes[10][lane], lanes[11][lane], 1.f };
+                }
+            }
+
+            for (; i < count; ++i)
+            {
+                out[i] = Mat4::fromTransform({ in.position[0][i], in.position[1][i], in.position[2][i] },
+                                             { in.rotation[0][i], in.rotation[1][i], in.rotation[2][i], in.rotation[3][i] },
+                                             { in.scale[0][i], in.scale[1][i], in.scale[2][i] });
+            }
+        }
+
+        // out[i] = a[i] * b[i], e.g. local matrices by their parents' world matrices
+        inline void multiplyMatrices(const Mat4* a, const Mat4* b, Mat4* out, size_t count) noexcept
+        {
+            for (size_t i = 0; i < count; ++i)
+                out[i] = a[i] * b[i];
+        }
+
+        // out[i] = a[i] * b, e.g. world matrices by the view projection
+        inline void multiplyMatrices(const Mat4* a, const Mat4& b, Mat4* out, size_t count) noexcept
+        {
+            for (size_t i = 0; i < count; ++i)
+                out[i] = a[i] * b;
+        }
+
+        // Every point by the same matrix, w = 1. In and out may be the same streams
+        inline void transformPoints(const Mat4& m, const PointStreams& in, const PointStreams& out, size_t count) noexcept
+        {
+            using Simd::FloatN;
+            constexpr uint32_t Width = Simd::Width;
+
+            auto m00 = FloatN::splat(m.rows[0].x), m01 = FloatN::splat(m.rows[0].y), m02 = FloatN::splat(m.rows[0].z);
+            auto m10 = FloatN::splat(m.rows[1].x), m11 = FloatN::splat(m.rows[1].y), m12 = FloatN::splat(m.rows[1].z);
+            auto m20 = FloatN::splat(m.rows[2].x), m21 = FloatN::splat(m.rows[2].y), m22 = FloatN::splat(m.rows[2].z);
+            auto m30 = FloatN::splat(m.rows[3].x), m31 = FloatN::splat(m.rows[3].y), m32 = FloatN::splat(m.rows[3].z);
+
+            size_t wideCount = count - count % Width;
+            size_t i         = 0;
+            for (; i < wideCount; i += Width)
+            {
+                auto x = FloatN::load(in.position[0] + i);
+                auto y = FloatN::load(in.position[1] + i);
+                auto z = FloatN::load(in.position[2] + i);
+                store(out.position[0] + i, madd(x, m00, madd(y, m10, madd(z, m20, m30))));
+                store(out.position[1] + i, madd(x, m01, madd(y, m11, madd(z, m21, m31))));
+                store(out.position[2] + i, madd(x, m02, madd(y, m12, madd(z, m22, m32))));
+            }
+
+            for (; i < count; ++i)
+            {
+                auto p = transformPoint({ in.position[0][i], in.position[1][i], in.position[2][i] }, m);
+                out.position[0][i] = p.x;
+                out.position[1][i] = p.y;
+                out.position[2][i] = p.z;
+            }
+        }
+
+        /*
+        * Local boxes to world boxes, box i by matrices[i]
+        * Center goes through the matrix, the extent through its absolute upper 3x3 (Arvo), which gives the
+        * tightest box around the transformed one. One object per Float4, matrices are rows already
+        */
+        inline void transformBounds(const Mat4* matrices, const BoundsStreams& local, const BoundsStreams& world, size_t count) noexcept
+        {
+            using Simd::Float4;
+
+            alignas(16) float center[4];
+            alignas(16) float extent[4];
+            for (size_t i = 0; i < count; ++i)
+            {
+                auto& m  = matrices[i];
+                auto  r0 = m.rows[0].load();
+                auto  r1 = m.rows[1].load();
+                auto  r2 = m.rows[2].load();
+
+                auto c = madd(Float4::splat(local.center[0][i]), r0,
+                         madd(Float4::splat(local.center[1][i]), r1,
+                         madd(Float4::splat(local.center[2][i]), r2, m.rows[3].load())));
+                auto e = madd(Float4::splat(local.extent[0][i]), abs(r0),
+                         madd(Float4::splat(local.extent[1][i]), abs(r1),
+                              Float4::splat(local.extent[2][i]) * abs(r2)));
+                store(center, c);
+                store(extent, e);
+
+                world.center[0][i] = center[0];
+                world.center[1][i] = center[1];
+                world.center[2][i] = center[2];
+                world.extent[0][i] = extent[0];
+                world.extent[1][i] = extent[1];
+                world.extent[2][i] = extent[2];
+            }
+        }
+    }
+}
@@ -0,0 +1,137 @@
+#pragma once
+
+#include "Device.hpp"
+#include "TlsfAllocator.hpp"
+
+#include <mutex>
+#include <memory>
+#include <vector>
+#include <cstdint>
+
+namespace GalgameEngine
+{
+    // Memory range of a resource placed by MemoryAllocator
+    struct MemoryAllocation
+    {
+        Heap*    heap   = nullptr;
+        uint64_t offset = 0;
+        uint64_t size   = 0;
+
+        // Owner bookkeeping
+        uint32_t pool  = 0;
+        uint32_t block = 0;
+        uint32_t node  = TlsfAllocator::InvalidNode;    // InvalidNode for a dedicated heap
+
+        bool isValid() const noexcept { return heap != nullptr; }
+    };
+
+    /*
+    * GPU memory sub-allocator, places resources in large heaps instead of one implicit heap per resource
+    * Every heap type and heap usage is a pool of blocks, each block is a heap and a TlsfAllocator over it.
+    * With resource heap tier 2 all usages of a heap type share one pool.
+    * Resources larger than half a block get a heap of their own.
+    *
+    * Allocation is O(1) in the block, blocks of a pool are tried in order and a new block is created
+    * when none fits. Empty blocks beyond one per pool are destroyed at once.
+    *
+    * Freeing takes effect at once, owners destroy resources only after GPU is done with them like committed ones.
+    *
+    * Defragmentation is driven by the owner of the resources: planDefragmentation() reserves a new place
+    * for allocations of the sparsest blocks, the owner creates the resource again there, copies it on GPU,
+    * and frees the old allocation after the copy completes.
+    *
+    * Thread safe
+    */
+    class MemoryAllocator
+    {
+    public:
+        struct Config
+        {
+            uint64_t blockSize  = 64ull << 20;
+            bool     mixedHeaps = false;    // Resource heap tier 2, buffers and all textures share heaps
+        };
+
+        struct Stats
+        {
+            uint32_t blocks          = 0;
+            uint32_t dedicatedHeaps  = 0;
+            uint32_t allocations     = 0;
+            uint64_t heapBytes       = 0;   // Memory of all heaps
+            uint64_t usedBytes       = 0;   // Memory taken by allocations, including alignment
+            uint64_t freeBlocks      = 0;   // Free ranges in all blocks
+            double   fragmentation   = 0.0; // Worst of all blocks, see TlsfAllocator::getFragmentation()
+            uint64_t createdHeaps    = 0;   // Since the allocator was created
+        };
+
+        struct Move
+        {
+            MemoryAllocation source;
+            MemoryAllocation destination;
+        };
+
+        // Told about every heap the allocator creates and right before it destroys one, e.g. to track residency
+        // Called under the allocator lock on whichever thread allocates or frees
+        class Observer
+        {
+        public:
+            virtual ~Observer() = default;
+
+            virtual void onHeapCreated(Heap& heap) = 0;
+            virtual void onHeapDestroyed(Heap& heap) = 0;
+        };
+
+        MemoryAllocator(Device& device, const Config& config);
+        ~MemoryAllocator();
+
+        MemoryAllocator(const MemoryAllocator&)            = delete;
+        MemoryAllocator(MemoryAllocator&&)                 = delete;
+        MemoryAllocator& operator=(const MemoryAllocator&) = delete;
+        MemoryAllocator& operator=(MemoryAllocator&&)      = delete;
+
+        // Alignment must be a power of two, a new block is created when no block of the pool fits
+        MemoryAllocation allocate(HeapType type, HeapUsage usage, const AllocationInfo& info);
+        void             free(const MemoryAllocation& allocation);
+
+        // Append moves which empty the least used blocks into the free space of other blocks of their pool,
+        // up to maxBytes. Destinations are allocated, sources stay allocated until the owner frees them
+        void planDefragmentation(std::vector<Move>& moves, uint64_t maxBytes);
+
+        // One observer at most, heaps which exist already are reported as created. Null removes it
+        void setObserver(Observer* observer);
+
+        Stats getStats() const;
+
+    private:
+        struct Block
+        {
+            std::unique_ptr<Heap>          heap;
+            std::unique_ptr<TlsfAllocator> allocator;   // Null for dedicated heap and unused slot
+            std::vector<uint64_t>          alignments;  // Alignment of each allocation by node, for moving it
+        };
+
+        struct Pool
+        {
+            HeapType           type;
+            HeapUsage          usage;
+            std::vector<Block> blocks;                  // Slots are reused, indices stay valid while allocated
+        };
+
+        uint32_t getPoolIndex(HeapType type, HeapUsage usage) const noexcept;
+        uint32_t createBlock(Pool& pool, uint64_t size, bool dedicated);
+        void     destroyBlock(Block& block);
+
+        // Allocation in an existing block of the pool, skipping one block
+        MemoryAllocation allocateInBlocks(uint32_t poolIndex, const AllocationInfo& info, uint32_t skipBlock);
+
+    private:
+        Device& m_device;
+        Config  m_config;
+
+        mutable std::mutex m_mutex;
+        std::vector<Pool>  m_pools;
+        uint64_t           m_createdHeaps = 0;
+        Observer*          m_observer     = nullptr;
+
+        std::vector<TlsfAllocator::Allocation> m_scratch;
+    };
+}
@@ -0,0 +1,179 @@
+#pragma once
+
+#include "Device.hpp"
+#include "MappedFile.hpp"
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+namespace GalgameEngine
+{
+    /*
+    * Binary mesh and scene container (.gmesh), little endian, every record is read in place from the mapping
+    *
+    *   header
+    *   mesh table      MeshRecord    x meshCount
+    *   submesh table   SubmeshRecord x submeshCount
+    *   node table      NodeRecord    x nodeCount
+    *   vertex blob     page aligned, every mesh's vertices start on UploadAlignment
+    *   index blob      page aligned, every mesh's indices start on UploadAlignment
+    *
+    * Blobs are laid out like the upload buffer they are copied to, so a whole blob is one memcpy
+    * and a mesh is bound at blob base + its offset. The checksum covers header and tables,
+    * blobs are only bounds checked so opening a file never touches its geometry
+    */
+    namespace MeshFormat
+    {
+        constexpr uint32_t Magic           = 0x48534D47;  // "GMSH"
+        constexpr uint32_t Version         = 1;
+        constexpr uint64_t BlobAlignment   = 4096;        // Page, blobs can be mapped and prefetched on their own
+        constexpr uint64_t UploadAlignment = 256;         // Buffer view offsets, like constant buffers need
+        constexpr uint32_t MaxAttributes   = 6;
+        constexpr uint32_t InvalidIndex    = UINT32_MAX;
+
+        enum class Semantic : uint32_t
+        {
+            Position,
+            Normal,
+            Tangent,
+            Texcoord,
+            Color,
+        };
+
+        struct Attribute
+        {
+            Semantic semantic;
+            Format   format;
+            uint32_t offset;    // In the vertex
+        };
+
+        struct Header
+        {
+            uint32_t magic;
+            uint32_t version;
+            uint32_t meshCount;
+            uint32_t submeshCount;
+            uint32_t nodeCount;
+            uint32_t reserved;
+            uint64_t fileSize;
+            uint64_t meshTableOffset;
+            uint64_t submeshTableOffset;
+            uint64_t nodeTableOffset;
+            uint64_t vertexBlobOffset;
+            uint64_t vertexBlobSize;
+            uint64_t indexBlobOffset;
+            uint64_t indexBlobSize;
+            uint64_t checksum;      // Hasher of header and tables, computed with this field zero
+        };
+
+        struct MeshRecord
+        {
+            uint64_t  nameHash;     // Hasher::addString of the source name
+            uint64_t  vertexOffset; // In the vertex blob
+            uint64_t  indexOffset;  // In the index blob
+            uint32_t  vertexCount;
+            uint32_t  vertexStride;
+            uint32_t  indexCount;
+            uint32_t  indexSize;    // 2 or 4 bytes
+            uint32_t  firstSubmesh;
+            uint32_t  submeshCount;
+            uint32_t  attributeCount;
+            Attribute attributes[MaxAttributes];
+            float     boundsMin[3];
+            float     boundsMax[3];
+            uint32_t  reserved;
+        };
+
+        // Index range drawn with one material
+        struct SubmeshRecord
+        {
+            uint32_t firstIndex;    // Relative to the indices of its mesh
+            uint32_t indexCount;
+            uint32_t material;
+            uint32_t reserved;
+        };
+
+        // Scene node, parents come before their children
+        struct NodeRecord
+        {
+            float    transform[12]; // Row major 3x4, relative to the parent
+            uint32_t mesh;          // InvalidIndex for a node without a mesh
+            uint32_t parent;        // InvalidIndex for a root
+        };
+
+        static_assert(sizeof(Header)        == 96);
+        static_assert(sizeof(MeshRecord)    == 152);
+        static_assert(sizeof(SubmeshRecord) == 16);
+        static_assert(sizeof(NodeRecord)    == 56);
+
+        // Hash of header and tables as stored in Header::checksum
+        uint64_t computeChecksum(const uint8_t* file, const Header& header) noexcept;
+    }
+
+    /*
+    * Geometry of a mesh file in one upload heap buffer, vertex blob first
+    * Meshes are drawn straight from it or copied to default heap buffers by the GPU
+    */
+    struct MeshGeometry
+    {
+        std::unique_ptr<Buffer> buffer;
+        uint64_t                vertexBase = 0;     // Offsets of the blobs in the buffer
+        uint64_t                indexBase  = 0;
+    };
+
+    /*
+    * Mapped .gmesh file
+    * Opening validates header, tables and every range against the file size, afterwards records are used
+    * without checks. Nothing is parsed or allocated per vertex, geometry pages are read by the OS when copied
+    */
+    class MeshFile
+    {
+    public:
+        MeshFile() = default;
+
+        MeshFile(const MeshFile&)            = delete;
+        MeshFile(MeshFile&&)                 = delete;
+        MeshFile& operator=(const MeshFile&) = delete;
+        MeshFile& operator=(MeshFile&&)      = delete;
+
+        // Return false when the file is missing or invalid, nothing stays open then
+        bool open(const std::string& path);
+        void close() noexcept;
+
+        uint32_t getMeshCount()    const noexcept { return m_header->meshCount; }
+        uint32_t getSubmeshCount() const noexcept { return m_header->submeshCount; }
+        uint32_t getNodeCount()    const noexcept { return m_header->nodeCount; }
+
+        const MeshFormat::MeshRecord&    getMesh(uint32_t index)    const noexcept { return m_meshes[index]; }
+        const MeshFormat::SubmeshRecord& getSubmesh(uint32_t index) const noexcept { return m_submeshes[index]; }
+        const MeshFormat::NodeRecord&    getNode(uint32_t index)    const noexcept { return m_nodes[index]; }
+
+        // Mesh with the name hash, InvalidIndex when there is none
+        uint32_t findMesh(uint64_t nameHash) const noexcept;
+
+        const uint8_t* getVertexBlob()     const noexcept { return m_file.getData() + m_header->vertexBlobOffset; }
+        uint64_t       getVertexBlobSize() const noexcept { return m_header->vertexBlobSize; }
+        const uint8_t* getIndexBlob()      const noexcept { return m_file.getData() + m_header->indexBlobOffset; }
+        uint64_t       getIndexBlobSize()  const noexcept { return m_header->indexBlobSize; }
+
+        // Copy both blobs into a new upload buffer, straight from the mapping
+        MeshGeometry upload(Device& device) const;
+
+        // Vertex layout of a mesh for a pipeline description
+        std::vector<InputElement> getInputLayout(uint32_t mesh) const;
+
+        bool isOpen() const noexcept { return m_header != nullptr; }
+
+    private:
+        bool validate() const noexcept;
+
+    private:
+        MappedFile                       m_file;
+        const MeshFormat::Header*        m_header    = nullptr;
+        const MeshFormat::MeshRecord*    m_meshes    = nullptr;
+        const MeshFormat::SubmeshRecord* m_submeshes = nullptr;
+        const MeshFormat::NodeRecord*    m_nodes     = nullptr;
+    };
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "MeshFile.hpp"
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+namespace GalgameEngine
+{
+    /*
+    * Builds a .gmesh file, used by the offline converter
+    * Vertex and index data are referenced, not copied, and must stay alive until write() returns,
+    * so converting a large scene does not hold its geometry twice
+    */
+    class MeshWriter
+    {
+    public:
+        struct Submesh
+        {
+            uint32_t firstIndex = 0;
+            uint32_t indexCount = 0;
+            uint32_t material   = 0;
+        };
+
+        struct Mesh
+        {
+            std::string                        name;
+            std::vector<MeshFormat::Attribute> attributes;
+            uint32_t                           vertexStride = 0;
+            uint32_t                           vertexCount  = 0;
+            const void*                        vertices     = nullptr;
+            uint32_t                           indexSize    = 4;        // 2 or 4 bytes
+            uint32_t                           indexCount   = 0;
+            const void*                        indices      = nullptr;
+            std::vector<Submesh>               submeshes;               // One submesh of all indices when empty
+        };
+
+        struct Node
+        {
+            float    transform[12] = { 1, 0, 0, 0,  0, 1, 0, 0,  0, 0, 1, 0 };
+            uint32_t mesh          = MeshFormat::InvalidIndex;
+            uint32_t parent        = MeshFormat::InvalidIndex;
+        };
+
+        // Bounds are computed from the position attribute, return the mesh index
+        uint32_t addMesh(const Mesh& mesh);
+        // Parent must be added first, return the node index
+        uint32_t addNode(const Node& node);
+
+        // Return false when the file cannot be written
+        bool write(const std::string& path) const;
+
+        uint64_t getFileSize() const noexcept;
+
+    private:
+        struct Blob
+        {
+            const void* data;
+            uint64_t    offset;     // In its blob
+            uint64_t    size;
+        };
+
+        std::vector<MeshFormat::MeshRecord>    m_meshes;
+        std::vector<MeshFormat::SubmeshRecord> m_submeshes;
+        std::vector<MeshFormat::NodeRecord>    m_nodes;
+        std::vector<Blob>                      m_vertexBlobs;
+        std::vector<Blob>                      m_indexBlobs;
+        uint64_t                               m_vertexBlobSize = 0;
+        uint64_t                               m_indexBlobSize  = 0;
+    };
+}
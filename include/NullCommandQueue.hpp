@@ -0,0 +1,135 @@
+#pragma once
+
+#include "SyncEvent.hpp"
+#include "CommandQueue.hpp"
+
+#include <chrono>
+#include <deque>
+#include <vector>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+
+namespace GalgameEngine
+{
+    class NullDevice;
+    class NullTimestampQueryHeap;
+    struct NullRasterCommand;
+
+    /*
+    * Command queue of the null backend, backed by a simulated GPU thread
+    * Executed command lists are validated by the device and turned into work with a simulated cost,
+    * GPU thread executes work and signals in submission order
+    * It records how long GPU was busy and how long CPU waited, so CPU/GPU overlap can be measured
+    * Queues of a device run on their own threads, a wait() on another queue blocks only this queue's thread
+    * Timestamps are written by GPU thread when the work runs, from a GPU clock which is steady clock with an offset
+    * When the device rasterizes, GPU thread of the direct queue owns the software rasterizer and its job system
+    */
+    class NullCommandQueue : public CommandQueue
+    {
+    public:
+        using Duration = std::chrono::nanoseconds;
+
+        static constexpr uint64_t TimestampFrequency = 1000000000;
+
+        struct Stats
+        {
+            Duration gpuBusyTime = {};  // Time GPU thread spent on executing work
+            Duration cpuWaitTime = {};  // Time CPU spent in waitForValue()
+            uint64_t submitCount = 0;
+            uint64_t waitCount   = 0;   // Number of waitForValue() which really blocked
+            Duration gpuWaitTime = {};  // Time GPU thread spent in wait() on another queue
+        };
+
+        NullCommandQueue(NullDevice& device, QueueType type);
+        ~NullCommandQueue() override;
+
+        NullCommandQueue(const NullCommandQueue&)            = delete;
+        NullCommandQueue(NullCommandQueue&&)                 = delete;
+        NullCommandQueue& operator=(const NullCommandQueue&) = delete;
+        NullCommandQueue& operator=(NullCommandQueue&&)      = delete;
+
+        void executeCommandLists(CommandList* const* lists, uint32_t count) override;
+
+        // Submit work which takes GPU the given time to execute
+        void submit(Duration gpuCost);
+
+        uint64_t signal() override;
+        uint64_t getCompletedValue() const override;
+        void     waitForValue(uint64_t value) override;
+        void     setEventOnCompletion(uint64_t value, SyncEvent& event) override;
+        void     wait(CommandQueue& other, uint64_t value) override;
+
+        uint64_t         getTimestampFrequency() const override { return TimestampFrequency; }
+        ClockCalibration getClockCalibration() const override;
+
+        QueueType getType() const noexcept { return m_type; }
+
+        // The fence value which will be signaled next, work submitted now completes with it
+        uint64_t getNextValue() const;
+        // Whether GPU has finished all executed work
+        bool     isIdle() const;
+
+        Stats getStats() const;
+        void  resetStats();
+
+    private:
+        friend class NullDevice;
+
+        void gpuThread();
+        // Quit and join GPU thread, the device stops all its queues before destroying any
+        // so a queue blocked in wait() on another one is released while both still exist
+        void stop();
+
+    private:
+        // Timestamp write or resolve of an executed command list, applied by GPU thread
+        struct TimestampOp
+        {
+            NullTimestampQueryHeap* heap;
+            uint32_t                index;
+            uint32_t                count;      // Zero writes the timestamp at index, otherwise count timestamps are resolved
+            Duration                offset;     // From the beginning of the work, where the command runs
+            uint8_t*                dest;       // Readback memory of a resolve
+        };
+
+        struct Work
+        {
+            Duration                       cost       = {};
+            uint64_t                       fenceValue = 0;         // Not zero means a signal
+            NullCommandQueue*              waitQueue  = nullptr;   // Not null means a wait until it reaches fenceValue
+            std::vector<TimestampOp>       timestamps;
+            std::vector<NullRasterCommand> raster;                 // Of the executed lists, when the device rasterizes
+        };
+
+        struct CompletionEvent
+        {
+            uint64_t   value;
+            SyncEvent* event;
+        };
+
+        // Signal events of reached values, called with the lock held
+        void signalEvents();
+        void applyTimestamps(const Work& work, std::chrono::steady_clock::time_point begin);
+
+        static uint64_t getGpuTimestamp(std::chrono::steady_clock::time_point time);
+
+        NullDevice& m_device;
+        QueueType   m_type;
+
+        mutable std::mutex      m_mutex;
+        std::condition_variable m_workCond;
+        std::condition_variable m_fenceCond;
+        std::deque<Work>        m_works;
+        bool                    m_quit = false;
+
+        std::vector<CompletionEvent> m_completionEvents;
+
+        uint64_t m_fenceValue     = 0;
+        uint64_t m_completedValue = 0;
+        uint64_t m_executedValue  = 0;  // Fence value which covers the last executed command list
+        Stats    m_stats;
+
+        SyncEvent   m_waitEvent;    // Set by the queue GPU thread waits on
+        std::thread m_thread;
+    };
+}
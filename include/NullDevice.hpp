@@ -0,0 +1,540 @@
+#pragma once
+
+#include "Device.hpp"
+#include "NullCommandQueue.hpp"
+#include "MemoryAllocator.hpp"
+#include "SoftwareRasterizer.hpp"
+
+#include <map>
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <string>
+#include <vector>
+
+namespace GalgameEngine
+{
+    /*
+    * Null backend, records and validates commands without GPU
+    * Recording errors (command on a closed list, clear a texture without usage...) are reported when recorded,
+    * state errors (wrong barrier before state, present a back buffer not in present state...)
+    * are reported when command lists are executed, in submission order like the debug layer does
+    * With Config::rasterize draws also run on the software rasterizer of the direct queue, see NullRasterCommand
+    */
+
+    class NullDevice;
+    class NullHeap;
+    class NullBuffer;
+    class NullCommandList;
+    class NullRootSignature;
+
+    // State of a null backend resource after all executed command lists
+    class NullResource
+    {
+    public:
+        virtual ~NullResource();
+
+        ResourceState getState() const noexcept { return m_state; }
+
+    protected:
+        explicit NullResource(ResourceState state) : m_state(state) {}
+
+        Heap* getAllocationHeap() const noexcept { return m_allocation.heap; }
+
+    private:
+        friend class NullDevice;
+        friend class NullHeap;
+
+        ResourceState m_state;
+        ResourceState m_splitTarget = ResourceState::Common;
+        bool          m_splitting   = false;     // Between begin and end of a split barrier
+
+        // Placed resources own their memory range only after an aliasing barrier activated them
+        NullHeap* m_heap        = nullptr;
+        uint64_t  m_heapOffset  = 0;
+        uint64_t  m_heapSize    = 0;
+        bool      m_aliasActive = true;
+
+        // Memory of resources created by the device, given back when the resource is destroyed
+        MemoryAllocator* m_allocator = nullptr;
+        MemoryAllocation m_allocation;
+    };
+
+    class NullHeap : public Heap
+    {
+    public:
+        // Created resident, default heaps count against the simulated budget while resident
+        NullHeap(NullDevice& device, const HeapDesc& desc);
+        ~NullHeap() override;
+
+        const HeapDesc& getDesc() const noexcept override { return m_desc; }
+
+        bool isResident() const noexcept { return m_resident; }
+
+    private:
+        friend class NullDevice;
+        friend class NullResource;
+
+        NullDevice&                m_device;
+        HeapDesc                   m_desc;
+        std::vector<NullResource*> m_placed;    // Resources created in the heap and not destroyed yet
+        bool                       m_resident  = true;
+        uint64_t                   m_lastUse[2] = {};   // Fence value of the last executed list using it, by queue type
+    };
+
+    // Values live in host memory, written by GPU thread of the queue which executes the write
+    class NullTimestampQueryHeap : public TimestampQueryHeap
+    {
+    public:
+        explicit NullTimestampQueryHeap(uint32_t count) : m_values(count) {}
+
+        uint32_t getCount() const noexcept override { return static_cast<uint32_t>(m_values.size()); }
+
+    private:
+        friend class NullCommandQueue;
+
+        std::vector<uint64_t> m_values;
+    };
+
+    class NullCommandSignature : public CommandSignature
+    {
+    public:
+        explicit NullCommandSignature(uint32_t byteStride) : m_byteStride(byteStride) {}
+
+        uint32_t getByteStride() const noexcept override { return m_byteStride; }
+
+    private:
+        uint32_t m_byteStride;
+    };
+
+    class NullTexture : public Texture, public NullResource
+    {
+    public:
+        // Take render target and depth stencil views from the device heaps like D3D12 does
+        NullTexture(NullDevice& device, const TextureDesc& desc, ResourceState state);
+        ~NullTexture() override;
+
+        const TextureDesc& getDesc() const noexcept override { return m_desc; }
+
+        Heap* getHeap() const noexcept override { return getAllocationHeap(); }
+
+        // Pixels of RGBA8 render targets and of depth stencils, stored as float, when the device rasterizes
+        void*    getPixels() const noexcept { return m_pixels.get(); }
+        uint32_t getRowPitch() const noexcept { return m_rowPitch; }   // In pixels
+
+    private:
+        NullDevice&                m_device;
+        TextureDesc                m_desc;
+        uint32_t                   m_rtv = DescriptorAllocator::InvalidIndex;
+        uint32_t                   m_dsv = DescriptorAllocator::InvalidIndex;
+        std::unique_ptr<uint8_t[]> m_pixels;
+        uint32_t                   m_rowPitch = 0;
+    };
+
+    class NullBuffer : public Buffer, public NullResource
+    {
+    public:
+        NullBuffer(NullDevice& device, const BufferDesc& desc, ResourceState state, uint64_t gpuAddress);
+        ~NullBuffer() override;
+
+        const BufferDesc& getDesc() const noexcept override { return m_desc; }
+
+        Heap* getHeap() const noexcept override { return getAllocationHeap(); }
+
+        uint8_t* getMappedData() const noexcept override { return m_desc.heapType != HeapType::Default ? m_data.get() : nullptr; }
+        uint64_t getGpuAddress() const noexcept override { return m_gpuAddress; }
+
+        // What GPU reads, default buffers have it only when the device rasterizes
+        uint8_t* getData() const noexcept { return m_data.get(); }
+
+    private:
+        NullDevice&                m_device;
+        BufferDesc                 m_desc;
+        std::unique_ptr<uint8_t[]> m_data;          // Host memory of upload and readback buffers
+        uint64_t                   m_gpuAddress;
+    };
+
+    class NullCommandAllocator : public CommandAllocator
+    {
+    public:
+        NullCommandAllocator(NullDevice& device, QueueType type) : m_device(device), m_type(type) {}
+
+        void reset() override;
+
+    private:
+        friend class NullDevice;
+        friend class NullCommandList;
+
+        NullDevice&      m_device;
+        QueueType        m_type;
+        NullCommandList* m_recordingList = nullptr;
+        uint64_t         m_pendingValue  = 0;       // Fence value covers the last execution of commands from it
+    };
+
+    enum class NullCommandType : uint8_t
+    {
+        SetViewport,
+        SetScissorRect,
+        ResourceBarrier,
+        ClearRenderTarget,
+        ClearDepthStencil,
+        SetRenderTargets,
+        AliasingBarrier,
+        SetRootSignature,
+        SetPipelineState,
+        CopyBufferRegion,
+        CopyBufferToTexture,
+        WriteTimestamp,
+        ResolveTimestamps,
+        SetRootView,
+        SetVertexBuffers,
+        SetIndexBuffer,
+        DrawIndexedInstanced,
+        ExecuteIndirect,
+    };
+
+    struct NullCommand
+    {
+        static constexpr uint32_t MaxRenderTargets = 8;
+        static constexpr uint32_t MaxReads         = 8;
+
+        NullCommandType     type;
+        ResourceBarrier     barrier = {};
+        Resource*           aliasBefore = nullptr;
+        Texture*            targets[MaxRenderTargets] = {};
+        uint32_t            targetCount  = 0;
+        Texture*            depthStencil = nullptr;
+        Resource*           copyDest     = nullptr;
+        Resource*           copySource   = nullptr;
+        uint64_t            copySize     = 0;
+        uint64_t            copyOffset   = 0;       // Of the destination
+        TimestampQueryHeap* queryHeap    = nullptr;
+        uint32_t            queryIndex   = 0;
+        uint32_t            queryCount   = 0;
+        Resource*           reads[MaxReads] = {};   // Vertex, index, argument and count buffers, read in GenericRead state
+        uint32_t            readCount    = 0;
+        uint32_t            drawCount    = 0;       // Max count of indirect draws
+        uint32_t            stride       = 0;       // Of indirect arguments
+        uint64_t            readOffsets[2] = {};    // Of indirect arguments and count
+        uint64_t            instances    = 0;
+    };
+
+    class NullPipelineState;
+
+    enum class NullRasterCommandType : uint8_t
+    {
+        ClearRenderTarget,
+        ClearDepthStencil,
+        Draw,
+        DrawIndirect,
+        CopyBuffer,
+    };
+
+    /*
+    * Command the software rasterizer executes, lists record them next to NullCommand only when the device rasterizes
+    * A draw carries every binding it uses, root views are resolved to their buffers when recorded.
+    * Buffer contents are read when GPU thread executes the command, like GPU would
+    */
+    struct NullRasterCommand
+    {
+        static constexpr uint32_t MaxVertexBuffers = 4;
+
+        NullRasterCommandType    type = NullRasterCommandType::Draw;
+        NullTexture*             colorTarget = nullptr;     // Cleared texture of clears
+        NullTexture*             depthTarget = nullptr;
+        float                    clearValue[4] = {};        // Depth of depth clears in the first
+        const NullPipelineState* pipeline = nullptr;
+        Viewport                 viewport;
+        Rect                     scissor;
+        NullBuffer*              constants = nullptr;       // First root constant buffer, its first float4 is the color
+        uint64_t                 constantsOffset = 0;
+        NullBuffer*              worlds = nullptr;          // First root shader resource, world matrices by instance
+        uint64_t                 worldsOffset = 0;
+        VertexBufferView         vertexBuffers[MaxVertexBuffers];
+        IndexBufferView          indexBuffer;
+        DrawIndexedArguments     arguments;
+        NullBuffer*              buffers[2] = {};           // Indirect arguments and count, or copy destination and source
+        uint64_t                 offsets[2] = {};
+        uint64_t                 size     = 0;              // Of copies
+        uint32_t                 maxCount = 0;              // Of indirect draws
+        uint32_t                 stride   = 0;
+    };
+
+    class NullCommandList : public CommandList
+    {
+    public:
+        NullCommandList(NullDevice& device, QueueType type) : m_device(device), m_type(type) {}
+
+        void reset(CommandAllocator& allocator) override;
+        void close() override;
+
+        void setViewport(const Viewport& viewport) override;
+        void setScissorRect(const Rect& rect) override;
+        void resourceBarrier(const ResourceBarrier* barriers, uint32_t count) override;
+        void aliasingBarrier(Resource* before, Resource* after) override;
+
+        void clearRenderTarget(Texture& target, const float color[4]) override;
+        void clearDepthStencil(Texture& target, float depth, uint8_t stencil) override;
+        void setRenderTargets(Texture* const* targets, uint32_t count, Texture* depthStencil) override;
+
+        void setGraphicsRootSignature(RootSignature& rootSignature) override;
+        void setPipelineState(PipelineState& pipeline) override;
+        void setGraphicsRootConstantBufferView(uint32_t parameter, uint64_t gpuAddress) override;
+        void setGraphicsRootShaderResourceView(uint32_t parameter, uint64_t gpuAddress) override;
+
+        void setVertexBuffers(uint32_t startSlot, const VertexBufferView* views, uint32_t count) override;
+        void setIndexBuffer(const IndexBufferView& view) override;
+        void drawIndexedInstanced(uint32_t indexCount, uint32_t instanceCount, uint32_t startIndex, int32_t baseVertex, uint32_t startInstance) override;
+        void executeIndirect(CommandSignature& signature, uint32_t maxCount, Buffer& arguments, uint64_t argumentOffset,
+                             Buffer* countBuffer, uint64_t countOffset) override;
+
+        void copyBufferRegion(Buffer& dest, uint64_t destOffset, Buffer& source, uint64_t sourceOffset, uint64_t size) override;
+        void copyBufferToTexture(Texture& dest, Buffer& source, uint64_t sourceOffset, uint32_t rowPitch) override;
+
+        void writeTimestamp(TimestampQueryHeap& heap, uint32_t index) override;
+        void resolveTimestamps(TimestampQueryHeap& heap, uint32_t first, uint32_t count, Buffer& dest, uint64_t destOffset) override;
+
+        const std::vector<NullCommand>&       getCommands() const noexcept { return m_commands; }
+        const std::vector<NullRasterCommand>& getRasterCommands() const noexcept { return m_rasterCommands; }
+        bool isRecording() const noexcept { return m_allocator != nullptr; }
+
+    private:
+        // Copy lists take only copy commands
+        bool checkRecording(const char* command, bool allowedOnCopy = false);
+        // Root signature, pipeline and index buffer must be bound before a draw
+        bool checkDrawState(const char* command);
+        void checkRootParameter(const char* command, uint32_t parameter, RootParameterType type);
+        // The first root parameter of the type is the one the software rasterizer reads
+        bool isFirstRootParameter(uint32_t parameter, RootParameterType type) const noexcept;
+
+    private:
+        friend class NullDevice;
+
+        NullDevice&              m_device;
+        QueueType                m_type;
+        NullCommandAllocator*    m_allocator     = nullptr; // Not null while recording
+        NullCommandAllocator*    m_lastAllocator = nullptr;
+        std::vector<NullCommand> m_commands;
+
+        // Bindings since reset, draws are validated against them when recorded
+        const NullRootSignature* m_rootSignature = nullptr;
+        bool                     m_hasPipeline   = false;
+        uint32_t                 m_indexCount    = 0;       // Indices in the bound index buffer view
+        bool                     m_hasIndices    = false;
+
+        // Bindings the next rasterized draw copies, and the commands recorded for the rasterizer
+        NullRasterCommand              m_raster;
+        std::vector<NullRasterCommand> m_rasterCommands;
+    };
+
+    class NullRootSignature : public RootSignature
+    {
+    public:
+        explicit NullRootSignature(const RootSignatureDesc& desc) : m_desc(desc) {}
+
+        const RootSignatureDesc& getDesc() const noexcept { return m_desc; }
+
+    private:
+        RootSignatureDesc m_desc;
+    };
+
+    // Blob stands in for the driver compiled pipeline, it is only valid for the same description and driver version
+    class NullPipelineState : public PipelineState
+    {
+    public:
+        // What the software rasterizer takes from the description, shaders are opaque to it
+        struct RasterState
+        {
+            InputElement position;          // POSITION, format Unknown when the layout has none
+            InputElement instance;          // Per instance R32_UINT INSTANCE, format Unknown when the layout has none
+            CullMode     cullMode   = CullMode::Back;
+            bool         depthTest  = true;
+            bool         depthWrite = true;
+            CompareFunc  depthFunc  = CompareFunc::Less;
+            bool         hasColor   = false;    // First render target is R8G8B8A8_UNORM
+            bool         hasDepth   = false;
+        };
+
+        NullPipelineState(std::vector<uint8_t> blob, RasterState raster) : m_blob(std::move(blob)), m_raster(std::move(raster)) {}
+
+        std::vector<uint8_t> getCachedBlob() const override { return m_blob; }
+
+        const RasterState& getRasterState() const noexcept { return m_raster; }
+
+    private:
+        std::vector<uint8_t> m_blob;
+        RasterState          m_raster;
+    };
+
+    class NullSwapChain : public SwapChain
+    {
+    public:
+        NullSwapChain(NullDevice& device, const SwapChainDesc& desc);
+
+        uint32_t getBufferCount() const noexcept override { return static_cast<uint32_t>(m_buffers.size()); }
+        uint32_t getCurrentBackBufferIndex() const override { return m_index; }
+        Texture& getBackBuffer(uint32_t index) override { return *m_buffers[index]; }
+
+        void present(uint32_t syncInterval) override;
+        void resize(uint32_t width, uint32_t height) override;
+        void setSourceSize(uint32_t width, uint32_t height) override;
+        void waitForFrameLatency() override;
+
+        uint32_t getSourceWidth()  const noexcept { return m_sourceWidth; }
+        uint32_t getSourceHeight() const noexcept { return m_sourceHeight; }
+
+    private:
+        void createBuffers();
+
+    private:
+        NullDevice&                               m_device;
+        SwapChainDesc                             m_desc;
+        uint32_t                                  m_sourceWidth  = 0;
+        uint32_t                                  m_sourceHeight = 0;
+        std::vector<std::unique_ptr<NullTexture>> m_buffers;
+        uint32_t                                  m_index = 0;
+        std::deque<uint64_t>                      m_queuedFrames;   // Fence value finishing each queued present
+    };
+
+    class NullDevice : public Device
+    {
+    public:
+        struct Config
+        {
+            NullCommandQueue::Duration commandCost  = {};    // Simulated GPU time of every executed command
+            bool                       throwOnError = false; // Throw std::logic_error on validation error
+            bool                       mixedHeaps   = false; // Act as resource heap tier 2 hardware
+            uint64_t                   heapBlockSize = 64ull << 20;
+            NullCommandQueue::Duration pipelineCompileCost = {};  // Time createGraphicsPipeline() sleeps without a valid cached blob
+            uint32_t                   driverVersion = 1;         // Cached blobs of another version are rejected
+            uint64_t                   copyBandwidth = 0;         // Bytes per second of simulated copies, 0 makes them free
+            uint64_t                   memoryBudget  = 0;         // Simulated local video memory budget, 0 is no limit
+
+            // Draws also run on a software rasterizer, render targets and depth stencils get pixels to read back.
+            // The rasterizer runs on GPU thread of the direct queue and a job system of rasterThreads it creates,
+            // Config::jobSystem of rasterizer is ignored
+            bool                       rasterize     = false;
+            uint32_t                   rasterThreads = 0;         // 0 is one per hardware thread
+            SoftwareRasterizer::Config rasterizer;
+            Mat4                       viewProjection;            // Camera of rasterized draws, shaders are not run
+        };
+
+        struct Stats
+        {
+            uint64_t executedLists    = 0;
+            uint64_t commands         = 0;
+            uint64_t barriers         = 0;     // Each half of a split barrier counts as one
+            uint64_t splitBarriers    = 0;
+            uint64_t aliasBarriers    = 0;
+            uint64_t clears           = 0;
+            uint64_t presents         = 0;
+            uint64_t swapChainResizes = 0;
+            uint64_t pipelinesCreated  = 0;
+            uint64_t pipelineCacheHits = 0;    // Pipelines created from a valid cached blob
+            uint64_t copies            = 0;
+            uint64_t copiedBytes       = 0;
+            uint64_t evictedHeaps      = 0;
+            uint64_t residentHeaps     = 0;    // Heaps made resident again
+            uint64_t draws             = 0;    // Draw commands, an indirect execute counts once
+            uint64_t indirectDraws     = 0;    // Draws read from argument buffers
+            uint64_t instances         = 0;
+            uint64_t rasterTriangles   = 0;    // Input triangles of rasterized draws over all instances
+            uint64_t rasterPixels      = 0;    // Pixels they covered which passed the depth test
+        };
+
+        NullDevice() : NullDevice(Config()) {}
+        explicit NullDevice(const Config& config);
+        ~NullDevice() override;
+
+        NullDevice(const NullDevice&)            = delete;
+        NullDevice(NullDevice&&)                 = delete;
+        NullDevice& operator=(const NullDevice&) = delete;
+        NullDevice& operator=(NullDevice&&)      = delete;
+
+        CommandQueue& getQueue() override { return *m_queue; }
+        CommandQueue& getCopyQueue() override { return *m_copyQueue; }
+        NullCommandQueue& getNullQueue(QueueType type = QueueType::Direct) noexcept { return type == QueueType::Copy ? *m_copyQueue : *m_queue; }
+
+        std::unique_ptr<CommandAllocator> createCommandAllocator(QueueType type = QueueType::Direct) override;
+        std::unique_ptr<CommandList>      createCommandList(QueueType type = QueueType::Direct) override;
+        std::unique_ptr<SwapChain>        createSwapChain(const SwapChainDesc& desc) override;
+        std::unique_ptr<Texture>          createTexture(const TextureDesc& desc, ResourceState initialState) override;
+        std::unique_ptr<Buffer>           createBuffer(const BufferDesc& desc, ResourceState initialState) override;
+        std::unique_ptr<Heap>             createHeap(const HeapDesc& desc) override;
+
+        std::unique_ptr<TimestampQueryHeap> createTimestampQueryHeap(uint32_t count) override;
+        std::unique_ptr<CommandSignature>   createCommandSignature(uint32_t byteStride) override;
+
+        std::unique_ptr<Texture> createPlacedTexture(Heap& heap, uint64_t offset, const TextureDesc& desc, ResourceState initialState) override;
+        AllocationInfo           getTextureAllocationInfo(const TextureDesc& desc) override;
+
+        std::unique_ptr<Buffer> createPlacedBuffer(Heap& heap, uint64_t offset, const BufferDesc& desc, ResourceState initialState) override;
+
+        std::unique_ptr<RootSignature> createRootSignature(const RootSignatureDesc& desc) override;
+        std::unique_ptr<PipelineState> createGraphicsPipeline(const GraphicsPipelineDesc& desc, const std::vector<uint8_t>* cachedBlob) override;
+
+        MemoryAllocator& getMemoryAllocator() override { return *m_memoryAllocator; }
+
+        // Usage is the size of resident default heaps, upload and readback heaps live in system memory
+        MemoryBudget queryMemoryBudget() override;
+        void         evict(Heap* const* heaps, uint32_t count) override;
+        void         makeResident(Heap* const* heaps, uint32_t count) override;
+        // Change the simulated budget, like another application taking or giving back video memory
+        void         setMemoryBudget(uint64_t budget) noexcept { m_memoryBudget = budget; }
+
+        DescriptorAllocator& getDescriptorAllocator(DescriptorHeapType type) override { return *m_descriptorAllocators[static_cast<uint32_t>(type)]; }
+
+        bool isRasterizing() const noexcept { return m_config.rasterize; }
+        // Buffer the address points into, and the offset of the address in it. Only tracked when the device rasterizes
+        NullBuffer* findBuffer(uint64_t gpuAddress, uint64_t& offset) const;
+
+        void reportError(std::string message);
+
+        std::vector<std::string> getErrors() const;
+        uint64_t                 getErrorCount() const;
+        Stats                    getStats() const;
+        void                     resetStats();
+
+    private:
+        friend class NullCommandQueue;
+        friend class NullSwapChain;
+        friend class NullHeap;
+        friend class NullBuffer;
+
+        // Validate a closed command list and apply its state changes, return simulated GPU time
+        // Timestamp commands are added to timestamps for GPU thread, offset by start of the list in the work
+        NullCommandQueue::Duration execute(NullCommandList& list, QueueType queueType, uint64_t fenceValue,
+                                           NullCommandQueue::Duration start, std::vector<NullCommandQueue::TimestampOp>& timestamps);
+
+        void checkState(Resource* resource, ResourceState expected, const char* command);
+        // Every resource a command uses must be in a resident heap, remember the use for evict()
+        void checkResident(const NullCommand& command, QueueType queueType, uint64_t fenceValue);
+
+        // Validate a placed resource and link it to its heap, it starts inactive like an aliased resource
+        void place(NullResource& resource, NullHeap& heap, uint64_t offset, uint64_t size);
+
+        // Run raster commands of executed lists on GPU thread, queues without a rasterizer only copy buffers
+        void rasterize(SoftwareRasterizer* rasterizer, const std::vector<NullRasterCommand>& commands);
+
+    private:
+        Config m_config;
+
+        mutable std::mutex       m_mutex;
+        std::vector<std::string> m_errors;
+        uint64_t                 m_errorCount = 0;
+        Stats                    m_stats;
+
+        std::unique_ptr<DescriptorAllocator> m_descriptorAllocators[static_cast<uint32_t>(DescriptorHeapType::Count)];
+        std::unique_ptr<MemoryAllocator>     m_memoryAllocator;
+
+        std::atomic<uint64_t> m_nextGpuAddress = 1ull << 32;  // Fake virtual address space of buffers
+        std::atomic<uint64_t> m_memoryBudget;
+        std::atomic<uint64_t> m_residentBytes  = 0;           // Heaps are created by the memory allocator on any thread
+
+        mutable std::mutex                m_bufferMutex;
+        std::map<uint64_t, NullBuffer*>   m_buffers;          // By GPU address, when rasterizing
+
+        std::unique_ptr<NullCommandQueue> m_queue;
+        std::unique_ptr<NullCommandQueue> m_copyQueue;
+    };
+}
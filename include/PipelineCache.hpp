@@ -0,0 +1,163 @@
+#pragma once
+
+#include "Device.hpp"
+
+#include <mutex>
+#include <deque>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstdint>
+#include <unordered_map>
+#include <condition_variable>
+
+namespace GalgameEngine
+{
+    using PipelineId = uint32_t;
+    constexpr PipelineId InvalidPipeline = UINT32_MAX;
+
+    /*
+    * Content-hashed cache of root signatures and graphics pipelines
+    * A description is hashed by value (shader bytes, states, formats, the root signature it refers to),
+    * requesting the same one twice gives the same pipeline and compiles once.
+    *
+    * Pipelines compile on threads of the cache, apart from the job system so a long compile never delays
+    * frame recording. Until a pipeline is ready getPipeline() returns its fallback, e.g. a simple shader
+    * of the same layout, or null to skip the draw.
+    *
+    * The library keeps the driver compiled blob of every pipeline by hash and is saved to disk,
+    * the next run passes the blobs to the device and skips most of the compiling.
+    * It is kept under a byte budget by dropping the least recently used blobs, use counts are saved with them
+    * so blobs unused for many runs go first.
+    *
+    * Library file, little endian:
+    *   header   magic, version, library id, entry count
+    *   entries  hash, last use, blob size, blob bytes
+    *   checksum Hasher of everything above
+    * A file with another version or id, or a bad checksum, is dropped as a whole
+    *
+    * Requests come from one thread at a time, getPipeline() may run on many threads at once but not during a request
+    */
+    class PipelineCache
+    {
+    public:
+        static constexpr uint32_t LibraryMagic   = 0x434C5047;  // "GPLC"
+        static constexpr uint32_t LibraryVersion = 1;
+
+        struct Config
+        {
+            uint32_t compileThreads  = 2;           // 0 compiles inside requestPipeline()
+            uint64_t maxLibraryBytes = 64ull << 20;
+            uint64_t libraryId       = 0;           // Adapter and driver identity, a library of another one is dropped
+        };
+
+        struct Stats
+        {
+            uint64_t requests       = 0;
+            uint64_t hits           = 0;    // Requests of a description which was already requested
+            uint64_t compiles       = 0;    // Finished compiles, including failed ones
+            uint64_t libraryHits    = 0;    // Compiles which got a blob from the library
+            uint64_t failures       = 0;
+            uint64_t fallbacks      = 0;    // getPipeline() calls answered by a fallback or null
+            uint32_t pending        = 0;    // Requested pipelines not compiled yet
+            uint32_t libraryEntries = 0;
+            uint64_t libraryBytes   = 0;
+            uint64_t evictions      = 0;    // Blobs dropped from the library to stay under the budget
+        };
+
+        PipelineCache(Device& device, const Config& config);
+        ~PipelineCache();
+
+        PipelineCache(const PipelineCache&)            = delete;
+        PipelineCache(PipelineCache&&)                 = delete;
+        PipelineCache& operator=(const PipelineCache&) = delete;
+        PipelineCache& operator=(PipelineCache&&)      = delete;
+
+        // Created at once on first request, root signatures are cheap to create
+        RootSignature& getRootSignature(const RootSignatureDesc& desc);
+
+        // Start compiling the pipeline unless it is known already, its root signature must come from getRootSignature()
+        // Fallback is used by getPipeline() until the pipeline is ready
+        PipelineId requestPipeline(const GraphicsPipelineDesc& desc, PipelineId fallback = InvalidPipeline);
+
+        // Ready pipeline, else the first ready one of its fallback chain, else null
+        PipelineState* getPipeline(PipelineId id) noexcept;
+        bool           isReady(PipelineId id) const noexcept;
+
+        // Block until every requested pipeline is compiled, e.g. behind a loading screen
+        void waitIdle();
+
+        // Return false when the file is missing or dropped, the library is left empty then
+        bool loadLibrary(const std::string& path);
+        // Write to a temporary file and rename it over path, a crash never leaves a broken library
+        bool saveLibrary(const std::string& path);
+
+        // In-memory form of the library file
+        void serializeLibrary(std::vector<uint8_t>& data);
+        bool deserializeLibrary(const uint8_t* data, size_t size);
+
+        Stats getStats() const;
+
+        // Hash of a description, a pipeline also hashes the description of its root signature
+        static uint64_t hashRootSignature(const RootSignatureDesc& desc) noexcept;
+        static uint64_t hashPipeline(const GraphicsPipelineDesc& desc, uint64_t rootSignatureHash) noexcept;
+
+    private:
+        enum class Status : uint8_t
+        {
+            Pending,
+            Ready,
+            Failed,
+        };
+
+        struct Entry
+        {
+            GraphicsPipelineDesc           desc;
+            uint64_t                       hash     = 0;
+            PipelineId                     fallback = InvalidPipeline;
+            std::unique_ptr<PipelineState> state;
+            std::atomic<Status>            status   = Status::Pending;
+        };
+
+        struct LibraryEntry
+        {
+            std::vector<uint8_t> blob;
+            uint64_t             lastUse = 0;
+        };
+
+        void compileThread();
+        void compile(Entry& entry);
+
+        // Drop least recently used blobs until the library fits the budget, called with the lock held
+        void evictLibrary();
+
+    private:
+        Device& m_device;
+        Config  m_config;
+
+        std::unordered_map<uint64_t, std::unique_ptr<RootSignature>> m_rootSignatures;
+        std::unordered_map<const RootSignature*, uint64_t>          m_rootSignatureHashes;
+
+        // Entries never move, compile threads keep pointers to them
+        std::deque<Entry>                        m_entries;
+        std::unordered_map<uint64_t, PipelineId> m_entryIndices;
+
+        mutable std::mutex      m_mutex;
+        std::condition_variable m_workCond;
+        std::condition_variable m_idleCond;
+        std::deque<Entry*>      m_queue;
+        uint32_t                m_pending = 0;
+        bool                    m_quit    = false;
+
+        std::unordered_map<uint64_t, LibraryEntry> m_library;
+        uint64_t                                   m_libraryBytes = 0;
+        uint64_t                                   m_useCounter   = 0;  // Grows with every use, saved with the library
+
+        Stats                 m_stats;
+        std::atomic<uint64_t> m_fallbacks = 0;
+
+        std::vector<std::thread> m_threads;
+    };
+}
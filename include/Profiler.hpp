@@ -0,0 +1,102 @@
+#pragma once
+
+#include "Timer.hpp"
+
+#include <atomic>
+#include <string>
+#include <cstdint>
+
+namespace GalgameEngine
+{
+    /*
+    * Hierarchical CPU profiler
+    * PROFILE_SCOPE(name) records a begin/end pair into a per-thread ring buffer,
+    * writing is lock-free and only costs two clock reads when enabled, one relaxed load when disabled.
+    * Buffers keep the latest events of every thread and are dumped as Chrome trace / Perfetto JSON on demand
+    *
+    * Timestamps come from Timer::now(), so they line up with the game timer
+    * Events measured elsewhere, like GPU timings, go to tracks which show up next to the threads
+    * Names must be string literals or otherwise outlive the profiler
+    */
+    class Profiler
+    {
+    public:
+        struct Event
+        {
+            const char* name  = nullptr;
+            int64_t     begin = 0;      // Timer ticks
+            int64_t     end   = 0;
+            uint32_t    depth = 0;      // Nesting depth of the scope on its thread
+        };
+
+        // Events per thread, older events are overwritten when a thread records more before dumping
+        static constexpr uint32_t ThreadCapacity = 1 << 16;
+
+        static void setEnabled(bool enabled) noexcept { s_enabled.store(enabled, std::memory_order_relaxed); }
+        static bool isEnabled() noexcept { return s_enabled.load(std::memory_order_relaxed); }
+
+        // Name shown for the calling thread in trace viewer
+        static void setThreadName(const char* name);
+
+        // Buffer which is not tied to a thread, events are added to it with addEvents()
+        static uint32_t createTrack(const char* name);
+        // Events may be added from any thread, they are published under the registry lock
+        static void     addEvents(uint32_t track, const Event* events, uint32_t count);
+
+        // Write events of all threads as Chrome trace JSON, open it in chrome://tracing or ui.perfetto.dev
+        static std::string getChromeTrace();
+        static bool        writeChromeTrace(const char* path);
+
+        // Drop all recorded events
+        static void clear();
+
+        // Used by ProfileScope
+        static uint32_t beginScope() noexcept;
+        static void     endScope(const char* name, int64_t begin, uint32_t depth) noexcept;
+
+    private:
+        inline static std::atomic<bool> s_enabled = false;
+    };
+
+    class ProfileScope
+    {
+    public:
+        explicit ProfileScope(const char* name) noexcept
+        {
+            if (Profiler::isEnabled())
+            {
+                m_name  = name;
+                m_depth = Profiler::beginScope();
+                m_begin = Timer::now();
+            }
+        }
+
+        ~ProfileScope() noexcept
+        {
+            if (m_name != nullptr)
+                Profiler::endScope(m_name, m_begin, m_depth);
+        }
+
+        ProfileScope(const ProfileScope&)            = delete;
+        ProfileScope(ProfileScope&&)                 = delete;
+        ProfileScope& operator=(const ProfileScope&) = delete;
+        ProfileScope& operator=(ProfileScope&&)      = delete;
+
+    private:
+        const char* m_name  = nullptr;  // Null when profiler was disabled at scope begin
+        int64_t     m_begin = 0;
+        uint32_t    m_depth = 0;
+    };
+}
+
+#define PROFILE_CONCAT_IMPL(a, b) a##b
+#define PROFILE_CONCAT(a, b)      PROFILE_CONCAT_IMPL(a, b)
+
+// Define GALGAME_DISABLE_PROFILER to compile all scopes out
+#ifdef GALGAME_DISABLE_PROFILER
+    #define PROFILE_SCOPE(name)
+#else
+    #define PROFILE_SCOPE(name) ::GalgameEngine::ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name)
+#endif
+
+#define PROFILE_FUNCTION() PROFILE_SCOPE(__func__)
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+namespace GalgameEngine
+{
+    class JobSystem;
+
+    // 64-bit key and the value it carries, e.g. a draw and its instance
+    struct SortItem
+    {
+        uint64_t key;
+        uint32_t value;
+    };
+
+    /*
+    * Stable least significant digit radix sort of SortItems by key, 8 bits per pass
+    * Passes over digits which are the same in every key are skipped, keys made of a few
+    * small fields sort in fewer passes. Every pass counts digits per block, turns the counts
+    * into offsets and scatters the blocks, with a job system the blocks of a pass run in parallel.
+    * Small inputs are insertion sorted
+    */
+    class RadixSorter
+    {
+    public:
+        static constexpr uint32_t DigitBits   = 8;
+        static constexpr uint32_t BucketCount = 1u << DigitBits;
+
+        struct Config
+        {
+            uint32_t blockSize      = 16384;    // Items a job counts and scatters
+            uint32_t insertionLimit = 64;       // Inputs up to this size are insertion sorted
+        };
+
+        struct Stats
+        {
+            uint32_t passes        = 0;
+            uint32_t skippedPasses = 0;
+            uint32_t blocks        = 0;
+        };
+
+        RadixSorter() : RadixSorter(Config()) {}
+        explicit RadixSorter(const Config& config) : m_config(config) {}
+
+        RadixSorter(const RadixSorter&)            = delete;
+        RadixSorter(RadixSorter&&)                 = delete;
+        RadixSorter& operator=(const RadixSorter&) = delete;
+        RadixSorter& operator=(RadixSorter&&)      = delete;
+
+        // Sorted in place, items with equal keys keep their order
+        // Blocks run on the job system when set, call it from a thread of the system then
+        void sort(SortItem* items, uint32_t count, JobSystem* jobSystem = nullptr);
+
+        const Stats& getStats() const noexcept { return m_stats; }
+
+    private:
+        Config m_config;
+
+        std::vector<SortItem> m_scratch;
+        std::vector<uint32_t> m_offsets;    // BucketCount per block, counts then scatter offsets
+        Stats                 m_stats;
+    };
+}
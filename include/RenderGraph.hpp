@@ -0,0 +1,196 @@
+#pragma once
+
+#include "Device.hpp"
+#include "ResourceStateTracker.hpp"
+
+#include <deque>
+#include <memory>
+#include <vector>
+#include <utility>
+#include <cstdint>
+#include <functional>
+
+namespace GalgameEngine
+{
+    // Texture of a render graph, only valid in the frame it was created in
+    struct RenderGraphTexture
+    {
+        static constexpr uint32_t InvalidIndex = UINT32_MAX;
+
+        uint32_t index = InvalidIndex;
+
+        bool isValid() const noexcept { return index != InvalidIndex; }
+    };
+
+    /*
+    * Frame graph, rebuilt every frame
+    * Passes declare which textures they create, read and write, compile() then
+    *   - culls passes whose results nothing reads, imported textures and side effect passes keep their writers
+    *   - computes the first and last pass of every transient texture
+    *   - places transient textures in one heap, textures whose lifetimes do not overlap share memory
+    * execute() records passes in declaration order, which is already a valid order since a pass
+    * can only use textures declared before it. Aliasing barriers and state transitions of all textures
+    * a pass uses are batched in front of the pass.
+    *
+    * Placed textures are cached across frames by description and offset, so a steady frame creates nothing.
+    * Textures and heaps which fall out of use are destroyed when GPU passes the fence of the frame dropping them
+    */
+    class RenderGraph
+    {
+    public:
+        class PassBuilder
+        {
+        public:
+            // Transient texture, its memory is only valid between the first and last pass using it
+            RenderGraphTexture create(const char* name, const TextureDesc& desc);
+
+            RenderGraphTexture read(RenderGraphTexture texture, ResourceState state = ResourceState::ShaderResource);
+            RenderGraphTexture write(RenderGraphTexture texture, ResourceState state = ResourceState::RenderTarget);
+
+            // Keep the pass even when nothing reads its results, e.g. readback or present
+            void setSideEffect() noexcept;
+
+        private:
+            friend class RenderGraph;
+
+            PassBuilder(RenderGraph& graph, uint32_t pass) : m_graph(graph), m_pass(pass) {}
+
+            RenderGraph& m_graph;
+            uint32_t     m_pass;
+        };
+
+        class PassContext
+        {
+        public:
+            CommandList& getCommandList() const noexcept { return m_commandList; }
+            Texture&     getTexture(RenderGraphTexture texture) const { return m_graph.getTexture(texture); }
+
+        private:
+            friend class RenderGraph;
+
+            PassContext(RenderGraph& graph, CommandList& commandList) : m_graph(graph), m_commandList(commandList) {}
+
+            RenderGraph& m_graph;
+            CommandList& m_commandList;
+        };
+
+        using SetupFunction   = std::function<void(PassBuilder&)>;
+        using ExecuteFunction = std::function<void(PassContext&)>;
+
+        struct Stats
+        {
+            uint32_t passes            = 0;     // Of the last compiled frame
+            uint32_t culledPasses      = 0;
+            uint32_t transientTextures = 0;
+            uint64_t transientBytes    = 0;     // Memory transient textures would need without aliasing
+            uint64_t heapUsedBytes     = 0;     // Memory they need with aliasing
+            uint64_t heapCapacity      = 0;
+            uint64_t createdTextures   = 0;     // Placed textures created since the graph was created
+            uint64_t createdHeaps      = 0;
+        };
+
+        explicit RenderGraph(Device& device);
+        ~RenderGraph();
+
+        RenderGraph(const RenderGraph&)            = delete;
+        RenderGraph(RenderGraph&&)                 = delete;
+        RenderGraph& operator=(const RenderGraph&) = delete;
+        RenderGraph& operator=(RenderGraph&&)      = delete;
+
+        // Texture owned outside of the graph, writing it counts as a side effect
+        RenderGraphTexture importTexture(const char* name, Texture& texture);
+
+        // setup runs right away and declares what the pass uses, execute runs in execute()
+        void addPass(const char* name, const SetupFunction& setup, ExecuteFunction execute);
+
+        void compile();
+        void execute(CommandList& commandList, ResourceStateTracker& tracker);
+
+        // Physical texture, valid from compile() until finishFrame()
+        Texture& getTexture(RenderGraphTexture texture) const;
+
+        // Drop this frame's passes, textures not used by it are destroyed after GPU reaches fenceValue
+        void finishFrame(uint64_t fenceValue);
+        void reclaim(uint64_t completedValue);
+
+        const Stats& getStats() const noexcept { return m_stats; }
+
+    private:
+        static constexpr uint32_t NoPass = UINT32_MAX;
+
+        struct Access
+        {
+            uint32_t      texture;
+            ResourceState state;
+            bool          write;
+        };
+
+        struct PassNode
+        {
+            const char*     name;
+            ExecuteFunction execute;
+            uint32_t        firstAccess;
+            uint32_t        accessCount = 0;
+            uint32_t        refCount    = 0;    // Textures written which something still reads
+            bool            sideEffect  = false;
+            bool            culled      = false;
+        };
+
+        struct TextureNode
+        {
+            const char* name;
+            TextureDesc desc;
+            Texture*    texture   = nullptr;    // Imported texture, or placed texture after compile
+            bool        imported  = false;
+            uint32_t    refCount  = 0;          // Passes reading the texture which are not culled
+            uint32_t    firstPass = NoPass;
+            uint32_t    lastPass  = 0;
+            uint64_t    offset    = 0;          // Heap offset of transient texture
+            uint64_t    size      = 0;
+            uint32_t    aliasPrevious = RenderGraphTexture::InvalidIndex;  // Last texture in its memory before it
+            bool        activated     = false;  // Aliasing barrier recorded
+        };
+
+        // Placed texture kept across frames
+        struct CachedTexture
+        {
+            TextureDesc              desc;
+            uint64_t                 offset;
+            std::unique_ptr<Texture> texture;
+            bool                     used = false;  // By the current frame
+        };
+
+        struct Retired
+        {
+            uint64_t                              fenceValue = 0;
+            std::unique_ptr<Heap>                 heap;
+            std::vector<std::unique_ptr<Texture>> textures;     // Destroyed before their heap
+        };
+
+        void cull();
+        void computeLifetimes();
+        void placeTransients();
+        void bindTransients();
+
+        Texture* acquireTexture(const TextureDesc& desc, uint64_t offset);
+
+    private:
+        Device& m_device;
+
+        std::vector<PassNode>              m_passes;
+        std::vector<Access>                m_accesses;
+        std::vector<TextureNode>           m_textures;
+        std::vector<std::vector<uint32_t>> m_writers;       // Passes writing each texture
+        std::vector<uint32_t>              m_stack;
+        std::vector<uint32_t>              m_transients;    // Placement order
+
+        std::vector<std::pair<uint64_t, uint64_t>> m_busyRanges;   // Memory taken by textures alive with the one being placed
+
+        std::unique_ptr<Heap>      m_heap;
+        std::vector<CachedTexture> m_cache;
+        Retired                    m_retiring;              // Dropped by the current frame
+        std::deque<Retired>        m_retired;
+
+        Stats m_stats;
+    };
+}
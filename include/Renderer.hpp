@@ -0,0 +1,193 @@
+#pragma once
+
+#include "Device.hpp"
+#include "DrawQueue.hpp"
+#include "FrameRing.hpp"
+#include "GpuProfiler.hpp"
+#include "AssetStreamer.hpp"
+#include "ResidencyManager.hpp"
+#include "UploadRing.hpp"
+#include "InstanceUploader.hpp"
+#include "RenderGraph.hpp"
+#include "TimelineSync.hpp"
+#include "PipelineCache.hpp"
+#include "ResizeManager.hpp"
+#include "ResourceStateTracker.hpp"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace GalgameEngine
+{
+    class JobSystem;
+
+    /*
+    * Backend-neutral frame loop
+    * Owns swap chain, depth buffer and frame resources and records every frame through the device layer,
+    * so it runs the same on D3D12 and on the null backend
+    */
+    class Renderer
+    {
+    public:
+        // Pass field of draw keys recorded into the scene pass
+        static constexpr uint32_t ScenePass = 0;
+
+        struct Config
+        {
+            void*    window     = nullptr;  // Native window handle passed to swap chain
+            uint32_t width      = 0;
+            uint32_t height     = 0;
+            uint32_t frameCount = 3;        // Frames in flight
+            uint64_t uploadSize = 4 << 20;  // Bytes of the per-frame dynamic upload ring
+
+            uint32_t syncInterval    = 0;   // Vertical blanks to wait in present, 0 presents at once
+            uint32_t maxFrameLatency = 0;   // Presents queued before the swap chain blocks, 0 lets the driver decide
+
+            ResizeManager::Config resize;   // Capacity buckets of back buffers and size targets
+
+            PipelineCache::Config pipelineCache;
+            std::string           pipelineLibraryPath;  // Compiled pipelines are loaded from and saved to it when set
+
+            AssetStreamer::Config    streaming;
+            ResidencyManager::Config residency;
+            GpuProfiler::Config      gpuProfiler;  // Frame count is the renderer's
+            DrawQueue::Config        drawQueue;    // One lane per job system thread
+
+            // Record the frame as one command list per job system thread when set, on the calling thread otherwise
+            JobSystem* jobSystem = nullptr;
+        };
+
+        /*
+        * Resources owned by one frame in flight
+        * Command allocator can only be reset after GPU finished the commands allocated from it,
+        * so every frame slot has its own allocator and only waits for the frame that used the slot before.
+        * An allocator can only back one recording list at a time, so every recording thread has its own
+        */
+        struct FrameResource
+        {
+            std::vector<std::unique_ptr<CommandAllocator>> commandAllocators;  // Indexed by recording thread
+        };
+
+        Renderer(Device& device, const Config& config);
+        ~Renderer();
+
+        Renderer(const Renderer&)            = delete;
+        Renderer(Renderer&&)                 = delete;
+        Renderer& operator=(const Renderer&) = delete;
+        Renderer& operator=(Renderer&&)      = delete;
+
+        void render();
+
+        // Only remembers the size, the next render() applies the newest one
+        // Within the current capacity only the viewport changes, GPU is waited only when buffers are reallocated
+        void resize(uint32_t width, uint32_t height);
+
+        // Wait GPU finish all submitted work
+        void flush();
+
+        uint32_t getWidth()  const noexcept { return m_resizeManager.getSize().width; }
+        uint32_t getHeight() const noexcept { return m_resizeManager.getSize().height; }
+
+        const ResizeManager& getResizeManager() const noexcept { return m_resizeManager; }
+
+        const FrameRing<FrameResource>& getFrames() const noexcept { return m_frames; }
+
+        // Frame pacers wait on it for the frame latency
+        SwapChain& getSwapChain() noexcept { return *m_swapChain; }
+
+        // Barrier counts of all chunks
+        ResourceStateTracker::Stats getBarrierStats() const noexcept;
+
+        // Per-frame constants and dynamic vertices of the frame being recorded
+        UploadRing& getUploadRing() noexcept { return *m_uploadRing; }
+
+        const RenderGraph& getRenderGraph() const noexcept { return *m_renderGraph; }
+
+        // Callbacks registered here run at the beginning of the first frame after their point is reached
+        TimelineSync& getTimelineSync() noexcept { return m_timelineSync; }
+
+        // Root signatures and pipelines of materials, compiled in the background
+        PipelineCache& getPipelineCache() noexcept { return *m_pipelineCache; }
+
+        // File data streamed on the copy queue, updated at the beginning of every frame
+        AssetStreamer& getAssetStreamer() noexcept { return *m_assetStreamer; }
+
+        // Resources a frame draws with are marked used before render(), which keeps them resident within budget
+        ResidencyManager& getResidencyManager() noexcept { return *m_residency; }
+
+        // GPU time of every chunk, frameCount frames late
+        const GpuProfiler& getGpuProfiler() const noexcept { return *m_gpuProfiler; }
+
+        // Scene whose changed LocalToWorld matrices are uploaded at the beginning of every frame, null for none
+        // The store may not change during render()
+        void setScene(EntityStore* scene) noexcept { m_scene = scene; }
+
+        // Instance matrices of the scene, indexed by entity index
+        const InstanceUploader& getInstanceUploader() const noexcept { return *m_instanceUploader; }
+
+        // Draws submitted before render() are sorted, batched and recorded by the chunks, lane is the job system thread index
+        // Scene draws read their instance index as an entity index into the instance matrices, so they need a scene
+        DrawQueue& getDrawQueue() noexcept { return *m_drawQueue; }
+        // Pipelines of scene draws are created with it
+        RootSignature& getSceneRootSignature() noexcept { return *m_sceneRootSignature; }
+        // Commands recorded for the draws of the last frame, all chunks
+        DrawQueue::RecordStats getDrawStats() const noexcept;
+
+    private:
+        void applyResize();
+        void updateViewport();
+
+        // Declare this frame's passes and compile them, transient textures are ready after it
+        void buildRenderGraph(Texture& backBuffer);
+
+        // Record command list of one chunk of the frame, chunks are submitted in order
+        void recordChunk(uint32_t chunk, FrameResource& frame, Texture& backBuffer);
+
+    private:
+        Device&       m_device;
+        CommandQueue& m_queue;
+        ResizeManager m_resizeManager;
+
+        Format m_backBufferFormat  = Format::R8G8B8A8_UNORM;
+        Format m_depthBufferFormat = Format::D24_UNORM_S8_UINT;
+
+        JobSystem* m_jobSystem;
+        uint32_t   m_syncInterval;
+
+        std::unique_ptr<SwapChain>                m_swapChain;
+        std::vector<std::unique_ptr<CommandList>> m_commandLists;   // One per chunk, submitted as one batch
+        std::vector<std::unique_ptr<CommandList>> m_fixupLists;     // Barriers resolved at submit, run before their chunk
+        std::unique_ptr<CommandList>              m_profilerList;   // Resolves GPU markers, runs last
+        std::vector<CommandList*>                 m_submitLists;
+        std::vector<ResourceBarrier>              m_fixupBarriers;
+
+        std::vector<std::unique_ptr<ResourceStateTracker>> m_stateTrackers;  // One per chunk
+
+        FrameRing<FrameResource> m_frames;
+        TimelineSync             m_timelineSync;
+        std::unique_ptr<UploadRing> m_uploadRing;
+
+        EntityStore*                      m_scene = nullptr;
+        std::unique_ptr<InstanceUploader> m_instanceUploader;
+
+        std::unique_ptr<DrawQueue>          m_drawQueue;
+        RootSignature*                      m_sceneRootSignature = nullptr;    // Owned by the pipeline cache
+        std::vector<DrawQueue::RecordStats> m_drawStats;                       // One per chunk
+
+        std::unique_ptr<PipelineCache> m_pipelineCache;
+        std::string                    m_pipelineLibraryPath;
+
+        std::unique_ptr<ResidencyManager> m_residency;
+        std::unique_ptr<AssetStreamer>    m_assetStreamer;     // Pins its destinations with the residency manager
+        std::unique_ptr<GpuProfiler>      m_gpuProfiler;
+
+        // Depth buffer and other targets only used within a frame are transient textures of the graph
+        std::unique_ptr<RenderGraph> m_renderGraph;
+        RenderGraphTexture           m_backBufferTexture;
+        RenderGraphTexture           m_depthTexture;
+
+        Viewport m_viewport    = {};
+        Rect     m_scissorRect = {};
+    };
+}
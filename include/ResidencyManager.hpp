@@ -0,0 +1,113 @@
+#pragma once
+
+#include "Device.hpp"
+#include "MemoryAllocator.hpp"
+
+#include <list>
+#include <mutex>
+#include <vector>
+#include <cstdint>
+#include <unordered_map>
+
+namespace GalgameEngine
+{
+    /*
+    * Keeps memory allocator heaps within the video memory budget, least recently used heaps are evicted first
+    *
+    * Frame logic marks what a frame uses with use() before update(), which runs right before the frame's
+    * command lists are executed:
+    *   restore   heaps used this frame which are evicted are made resident again, in one batch
+    *   evict     when usage would go above budget * targetFraction, the least recently used heaps GPU has
+    *             finished with are evicted in one batch until it fits
+    * finishFrame() stamps the used heaps with the fence of the frame, a heap is evictable once GPU passed it.
+    *
+    * When nothing more can be evicted the frame runs over budget and the OS pages memory out instead,
+    * slower but it does not fail. overBudgetFrames counts those.
+    *
+    * Only default heaps are managed, upload and readback heaps live in system memory. Heaps come and go with the
+    * memory allocator, which reports them to the manager. Resources placed by the caller are not managed.
+    * Pinned heaps are never evicted, e.g. destinations of copy queue uploads no frame uses yet.
+    *
+    * Every decision comes from fence values and the queried budget, so the policy is deterministic
+    * and runs on the null device with a simulated budget
+    *
+    * use(), pin(), update() and finishFrame() on one thread, heaps may be created and destroyed on any thread
+    */
+    class ResidencyManager : public MemoryAllocator::Observer
+    {
+    public:
+        struct Config
+        {
+            double targetFraction = 0.9;    // Of the budget, leaves room for heaps created until the next update
+        };
+
+        struct Stats
+        {
+            uint64_t budget           = 0;  // Queried by the last update
+            uint64_t usage            = 0;  // After the last update
+            uint32_t heaps            = 0;
+            uint32_t evictedHeaps     = 0;
+            uint64_t residentBytes    = 0;  // Of managed heaps
+            uint64_t evictedBytes     = 0;
+            uint64_t evictions        = 0;  // Heaps evicted since creation
+            uint64_t restores         = 0;  // Heaps made resident again since creation
+            uint64_t evictBatches     = 0;
+            uint64_t restoreBatches   = 0;
+            uint64_t overBudgetFrames = 0;  // Updates which left usage above budget
+        };
+
+        ResidencyManager(Device& device, const Config& config);
+        // Evicted heaps are made resident again, resources in them stay usable without the manager
+        ~ResidencyManager() override;
+
+        ResidencyManager(const ResidencyManager&)            = delete;
+        ResidencyManager(ResidencyManager&&)                 = delete;
+        ResidencyManager& operator=(const ResidencyManager&) = delete;
+        ResidencyManager& operator=(ResidencyManager&&)      = delete;
+
+        // The frame executed after the next update() uses the resource, resources of unmanaged heaps are ignored
+        void use(const Resource& resource);
+        // Keep the heap of the resource resident until unpinned, it is made resident at once when evicted
+        // Pins count, every pin needs an unpin
+        void pin(const Resource& resource);
+        void unpin(const Resource& resource);
+
+        // Before executing the frame's command lists
+        void update();
+        // After the frame is submitted, with the fence value which finishes it
+        void finishFrame(uint64_t fenceValue);
+
+        Stats getStats() const;
+
+        void onHeapCreated(Heap& heap) override;
+        void onHeapDestroyed(Heap& heap) override;
+
+    private:
+        struct Entry
+        {
+            Heap*    heap;
+            uint64_t size;
+            uint64_t lastUse   = 0;         // Fence value of the last frame using it
+            uint64_t usedFrame = UINT64_MAX;
+            uint32_t pins      = 0;
+            bool     resident  = true;
+        };
+
+        using Lru = std::list<Entry>;       // Most recently used first
+
+        Lru::iterator find(const Resource& resource);
+        void          restore(Entry& entry);
+
+    private:
+        Device& m_device;
+        Config  m_config;
+
+        mutable std::mutex                       m_mutex;
+        Lru                                      m_lru;
+        std::unordered_map<Heap*, Lru::iterator> m_entries;
+        uint64_t                                 m_frame = 0;
+        Stats                                    m_stats;
+
+        std::vector<Heap*> m_batch;
+    };
+}
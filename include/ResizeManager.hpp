@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstdint>
+
+namespace GalgameEngine
+{
+    /*
+    * Turn window size events into as few GPU reallocations as possible
+    * request() only remembers the newest size, so a burst of events between two frames costs one update().
+    * Size targets are allocated at a capacity rounded up to granularity with some headroom,
+    * a size which still fits the capacity only changes viewport, scissor and the presented region.
+    * Capacity grows at once, it shrinks only after the size stayed far below it for shrinkDelay frames,
+    * so maximize and restore do not reallocate back and forth
+    */
+    class ResizeManager
+    {
+    public:
+        struct Config
+        {
+            uint32_t granularity     = 256;     // Capacity is a multiple of it in both dimensions
+            uint32_t headroomPercent = 25;      // Extra capacity when growing
+            uint32_t shrinkDelay     = 300;     // Frames spent below half of the capacity area before shrinking
+            uint32_t maxExtent       = 16384;   // Largest texture dimension of D3D12
+        };
+
+        struct Extent
+        {
+            uint32_t width  = 0;
+            uint32_t height = 0;
+
+            bool operator==(const Extent&) const = default;
+        };
+
+        enum class Action : uint8_t
+        {
+            None,
+            Viewport,       // Size changed within the capacity
+            Reallocate,     // Capacity changed, size targets must be created again
+        };
+
+        struct Stats
+        {
+            uint64_t requests      = 0;
+            uint64_t updates       = 0;     // Requests which reached update(), the rest were coalesced
+            uint64_t reallocations = 0;
+            uint64_t shrinks       = 0;
+        };
+
+        ResizeManager(Extent size, const Config& config);
+
+        // Zero size (minimized window) is ignored, the last size is kept
+        void request(uint32_t width, uint32_t height) noexcept;
+
+        // Apply the newest request, call once per frame before recording
+        Action update() noexcept;
+
+        Extent getSize()     const noexcept { return m_size; }
+        Extent getCapacity() const noexcept { return m_capacity; }
+        bool   hasPending()  const noexcept { return m_hasPending; }
+
+        const Stats& getStats() const noexcept { return m_stats; }
+
+    private:
+        Extent getCapacityFor(Extent size) const noexcept;
+
+    private:
+        Config   m_config;
+        Extent   m_size;
+        Extent   m_capacity;
+        Extent   m_pending;
+        bool     m_hasPending  = false;
+        uint32_t m_smallFrames = 0;     // Frames in a row the size could use a much smaller capacity
+        Stats    m_stats;
+    };
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include "Device.hpp"
+
+#include <vector>
+#include <utility>
+#include <cstdint>
+#include <unordered_map>
+
+namespace GalgameEngine
+{
+    /*
+    * Fill in resource barriers instead of writing them by hand
+    * One tracker per recording command list. transition() states what the next commands need,
+    * barriers are batched until flush() writes them before those commands.
+    * Within a batch, A->B then B->C becomes A->C and A->B then B->A disappears.
+    *
+    * State before a resource's first use in a list is unknown while recording in parallel,
+    * so the first use is only remembered and resolve() turns it into a barrier at submit time,
+    * from the state all earlier submitted lists leave the resource in.
+    * A list known to run first can be reset with assumeSubmittedStates to emit those barriers inline instead.
+    *
+    * beginTransition() starts a split barrier, it ends at the next transition of the resource,
+    * so GPU can overlap the transition with the work recorded between them
+    */
+    class ResourceStateTracker
+    {
+    public:
+        struct Stats
+        {
+            uint64_t requested = 0;     // transition() and beginTransition() calls
+            uint64_t emitted   = 0;     // Barriers written to command lists, both halves of a split count
+            uint64_t redundant = 0;     // Requests for the state the resource is already in
+            uint64_t merged    = 0;     // Barriers folded into an earlier one of the same batch
+            uint64_t split     = 0;     // Split barriers begun
+            uint64_t fixups    = 0;     // Barriers resolved at submit
+        };
+
+        ResourceStateTracker() = default;
+
+        ResourceStateTracker(const ResourceStateTracker&)            = delete;
+        ResourceStateTracker(ResourceStateTracker&&)                 = delete;
+        ResourceStateTracker& operator=(const ResourceStateTracker&) = delete;
+        ResourceStateTracker& operator=(ResourceStateTracker&&)      = delete;
+
+        // Start tracking a new recording, call it with CommandList::reset
+        // assumeSubmittedStates is only valid when nothing else is submitted before the list
+        void reset(bool assumeSubmittedStates = false);
+
+        void transition(Resource& resource, ResourceState state);
+        void beginTransition(Resource& resource, ResourceState state);
+
+        // Start tracking from a known state, for resources no other list in the submission uses
+        // Their barriers are recorded inline instead of resolved at submit
+        void track(Resource& resource, ResourceState state);
+
+        // Write batched barriers, call before commands which use the transitioned resources
+        void flush(CommandList& commandList);
+
+        // End open split barriers and flush, call before closing the list
+        void finish(CommandList& commandList);
+
+        // Submit thread only, in submission order
+        // Append barriers which must run right before the list and commit the states the list leaves behind
+        void resolve(std::vector<ResourceBarrier>& barriers);
+
+        const Stats& getStats() const noexcept { return m_stats; }
+
+    private:
+        struct Entry
+        {
+            ResourceState first       = ResourceState::Common;  // State needed by the first use in the list
+            ResourceState current     = ResourceState::Common;  // State after the recorded barriers
+            ResourceState splitTarget = ResourceState::Common;
+            bool          splitting   = false;
+            uint64_t      batch       = 0;                      // batchIndex is only valid when equal to m_batchId
+            uint32_t      batchIndex  = 0;                      // Last barrier of the resource in the batch
+        };
+
+        // Entry of the resource and whether its state before the request is known
+        std::pair<Entry*, bool> use(Resource& resource, ResourceState state);
+
+        void addBarrier(Resource& resource, Entry& entry, ResourceState after, BarrierFlags flags);
+        void endSplit(Resource& resource, Entry& entry);
+
+    private:
+        bool     m_assumeSubmittedStates = false;
+        uint64_t m_batchId               = 1;
+
+        std::unordered_map<Resource*, Entry> m_entries;
+        std::vector<Resource*>               m_resources;   // First use order, keeps resolve() deterministic
+        std::vector<ResourceBarrier>         m_batch;
+        Stats                                m_stats;
+    };
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <deque>
+#include <cstdint>
+
+namespace GalgameEngine
+{
+    /*
+    * Fence-driven linear ring allocator over an address range, pure CPU bookkeeping
+    * Allocations of a frame are carved linearly from head, the frame is closed with the fence value
+    * which signals its end, and its memory comes back at once when GPU has passed that fence
+    *
+    * Allocation is O(1): align head, wrap to the start when the end of the range is too small.
+    * Bytes skipped by alignment and wrapping are counted as waste
+    */
+    class RingAllocator
+    {
+    public:
+        static constexpr uint64_t InvalidOffset = UINT64_MAX;
+
+        struct Stats
+        {
+            uint64_t allocations  = 0;
+            uint64_t failures     = 0;  // Allocations which did not fit
+            uint64_t allocated    = 0;  // Bytes handed out
+            uint64_t paddingWaste = 0;  // Bytes skipped for alignment
+            uint64_t wrapWaste    = 0;  // Bytes skipped at the end of range when wrapping
+            uint64_t peakUsed     = 0;
+        };
+
+        explicit RingAllocator(uint64_t capacity) noexcept : m_capacity(capacity) {}
+
+        // Return offset in range, or InvalidOffset when there is no room until GPU finishes older frames
+        // Alignment must be a power of two
+        uint64_t allocate(uint64_t size, uint64_t alignment) noexcept;
+
+        // Close allocations since last call, they are freed when fence reaches fenceValue
+        void finishFrame(uint64_t fenceValue);
+        // Free all frames whose fence value has been completed
+        void reclaim(uint64_t completedValue) noexcept;
+
+        uint64_t getCapacity() const noexcept { return m_capacity; }
+        uint64_t getUsed()     const noexcept { return m_allocatedTotal - m_freedTotal; }
+        uint32_t getFramesInFlight() const noexcept { return static_cast<uint32_t>(m_frames.size()); }
+
+        const Stats& getStats() const noexcept { return m_stats; }
+        void         resetStats() noexcept { m_stats = {}; }
+
+    private:
+        struct Frame
+        {
+            uint64_t fenceValue;
+            uint64_t head;              // Head when frame finished, the new tail after it is freed
+            uint64_t allocatedTotal;    // Allocated total when frame finished
+        };
+
+        uint64_t          m_capacity;
+        uint64_t          m_head           = 0;    // Next free offset
+        uint64_t          m_tail           = 0;    // Oldest offset still in use
+        uint64_t          m_allocatedTotal = 0;    // Monotonic counters, used = allocated - freed
+        uint64_t          m_freedTotal     = 0;
+        std::deque<Frame> m_frames;
+        Stats             m_stats;
+    };
+}
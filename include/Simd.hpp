@@ -0,0 +1,265 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+// Backend is chosen at compile time, define GALGAME_SIMD_SCALAR to force the scalar fallback
+#if defined(GALGAME_SIMD_SCALAR)
+    #define GALGAME_SIMD_BACKEND_SCALAR
+#elif defined(__AVX2__) && defined(__FMA__)
+    #define GALGAME_SIMD_BACKEND_AVX2
+    #define GALGAME_SIMD_BACKEND_SSE
+    #include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define GALGAME_SIMD_BACKEND_SSE
+    #include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+    #define GALGAME_SIMD_BACKEND_NEON
+    #include <arm_neon.h>
+#else
+    #define GALGAME_SIMD_BACKEND_SCALAR
+#endif
+
+namespace GalgameEngine::Simd
+{
+    /*
+    * Thin wrappers over SIMD registers, one set of types per build
+    *   Float4   4 lanes, for vectors and matrix rows. SSE, NEON or a scalar array
+    *   FloatN   widest register, for structure-of-arrays kernels. 8 lanes with AVX2, Float4 otherwise
+    * Loads and stores are unaligned. Comparisons return masks with all bits of a lane set,
+    * moveMask() packs the lane signs into the low bits of an integer
+    */
+
+#if defined(GALGAME_SIMD_BACKEND_AVX2)
+    inline constexpr const char* BackendName = "avx2";
+#elif defined(GALGAME_SIMD_BACKEND_SSE)
+    inline constexpr const char* BackendName = "sse2";
+#elif defined(GALGAME_SIMD_BACKEND_NEON)
+    inline constexpr const char* BackendName = "neon";
+#else
+    inline constexpr const char* BackendName = "scalar";
+#endif
+
+    // -------
+    //  Float4
+    // -------
+
+#if defined(GALGAME_SIMD_BACKEND_SSE)
+    struct Float4
+    {
+        __m128 v;
+
+        static constexpr uint32_t Width = 4;
+
+        static Float4 load(const float* p) noexcept             { return { _mm_loadu_ps(p) }; }
+        static Float4 splat(float x) noexcept                   { return { _mm_set1_ps(x) }; }
+        static Float4 set(float x, float y, float z, float w) noexcept { return { _mm_setr_ps(x, y, z, w) }; }
+        static Float4 zero() noexcept                           { return { _mm_setzero_ps() }; }
+    };
+
+    inline void   store(float* p, Float4 a) noexcept           { _mm_storeu_ps(p, a.v); }
+    inline Float4 operator+(Float4 a, Float4 b) noexcept       { return { _mm_add_ps(a.v, b.v) }; }
+    inline Float4 operator-(Float4 a, Float4 b) noexcept       { return { _mm_sub_ps(a.v, b.v) }; }
+    inline Float4 operator*(Float4 a, Float4 b) noexcept       { return { _mm_mul_ps(a.v, b.v) }; }
+    inline Float4 operator/(Float4 a, Float4 b) noexcept       { return { _mm_div_ps(a.v, b.v) }; }
+    inline Float4 operator&(Float4 a, Float4 b) noexcept       { return { _mm_and_ps(a.v, b.v) }; }
+    inline Float4 operator|(Float4 a, Float4 b) noexcept       { return { _mm_or_ps(a.v, b.v) }; }
+    inline Float4 min(Float4 a, Float4 b) noexcept             { return { _mm_min_ps(a.v, b.v) }; }
+    inline Float4 max(Float4 a, Float4 b) noexcept             { return { _mm_max_ps(a.v, b.v) }; }
+    inline Float4 sqrt(Float4 a) noexcept                      { return { _mm_sqrt_ps(a.v) }; }
+    inline Float4 abs(Float4 a) noexcept                       { return { _mm_andnot_ps(_mm_set1_ps(-0.f), a.v) }; }
+    inline Float4 lessThan(Float4 a, Float4 b) noexcept        { return { _mm_cmplt_ps(a.v, b.v) }; }
+    inline Float4 greaterThan(Float4 a, Float4 b) noexcept     { return { _mm_cmpgt_ps(a.v, b.v) }; }
+    inline Float4 lessEqual(Float4 a, Float4 b) noexcept       { return { _mm_cmple_ps(a.v, b.v) }; }
+    inline Float4 greaterEqual(Float4 a, Float4 b) noexcept    { return { _mm_cmpge_ps(a.v, b.v) }; }
+    inline Float4 equal(Float4 a, Float4 b) noexcept           { return { _mm_cmpeq_ps(a.v, b.v) }; }
+    inline int    moveMask(Float4 a) noexcept                  { return _mm_movemask_ps(a.v); }
+    inline float  getX(Float4 a) noexcept                      { return _mm_cvtss_f32(a.v); }
+
+    // a * b + c, fused when the CPU has FMA
+    inline Float4 madd(Float4 a, Float4 b, Float4 c) noexcept
+    {
+    #if defined(GALGAME_SIMD_BACKEND_AVX2)
+        return { _mm_fmadd_ps(a.v, b.v, c.v) };
+    #else
+        return { _mm_add_ps(_mm_mul_ps(a.v, b.v), c.v) };
+    #endif
+    }
+
+    template <int Lane>
+    inline Float4 splatLane(Float4 a) noexcept { return { _mm_shuffle_ps(a.v, a.v, _MM_SHUFFLE(Lane, Lane, Lane, Lane)) }; }
+
+    // Mask lanes take b, others a
+    inline Float4 select(Float4 a, Float4 b, Float4 mask) noexcept
+    {
+        return { _mm_or_ps(_mm_andnot_ps(mask.v, a.v), _mm_and_ps(mask.v, b.v)) };
+    }
+
+#elif defined(GALGAME_SIMD_BACKEND_NEON)
+    struct Float4
+    {
+        float32x4_t v;
+
+        static constexpr uint32_t Width = 4;
+
+        static Float4 load(const float* p) noexcept   { return { vld1q_f32(p) }; }
+        static Float4 splat(float x) noexcept         { return { vdupq_n_f32(x) }; }
+        static Float4 set(float x, float y, float z, float w) noexcept
+        {
+            const float values[4] = { x, y, z, w };
+            return { vld1q_f32(values) };
+        }
+        static Float4 zero() noexcept                 { return { vdupq_n_f32(0.f) }; }
+    };
+
+    inline void   store(float* p, Float4 a) noexcept           { vst1q_f32(p, a.v); }
+    inline Float4 operator+(Float4 a, Float4 b) noexcept       { return { vaddq_f32(a.v, b.v) }; }
+    inline Float4 operator-(Float4 a, Float4 b) noexcept       { return { vsubq_f32(a.v, b.v) }; }
+    inline Float4 operator*(Float4 a, Float4 b) noexcept       { return { vmulq_f32(a.v, b.v) }; }
+    inline Float4 operator/(Float4 a, Float4 b) noexcept       { return { vdivq_f32(a.v, b.v) }; }
+    inline Float4 operator&(Float4 a, Float4 b) noexcept       { return { vreinterpretq_f32_u32(vandq_u32(vreinterpretq_u32_f32(a.v), vreinterpretq_u32_f32(b.v))) }; }
+    inline Float4 operator|(Float4 a, Float4 b) noexcept       { return { vreinterpretq_f32_u32(vorrq_u32(vreinterpretq_u32_f32(a.v), vreinterpretq_u32_f32(b.v))) }; }
+    inline Float4 min(Float4 a, Float4 b) noexcept             { return { vminq_f32(a.v, b.v) }; }
+    inline Float4 max(Float4 a, Float4 b) noexcept             { return { vmaxq_f32(a.v, b.v) }; }
+    inline Float4 sqrt(Float4 a) noexcept                      { return { vsqrtq_f32(a.v) }; }
+    inline Float4 abs(Float4 a) noexcept                       { return { vabsq_f32(a.v) }; }
+    inline Float4 lessThan(Float4 a, Float4 b) noexcept        { return { vreinterpretq_f32_u32(vcltq_f32(a.v, b.v)) }; }
+    inline Float4 greaterThan(Float4 a, Float4 b) noexcept     { return { vreinterpretq_f32_u32(vcgtq_f32(a.v, b.v)) }; }
+    inline Float4 lessEqual(Float4 a, Float4 b) noexcept       { return { vreinterpretq_f32_u32(vcleq_f32(a.v, b.v)) }; }
+    inline Float4 greaterEqual(Float4 a, Float4 b) noexcept    { return { vreinterpretq_f32_u32(vcgeq_f32(a.v, b.v)) }; }
+    inline Float4 equal(Float4 a, Float4 b) noexcept           { return { vreinterpretq_f32_u32(vceqq_f32(a.v, b.v)) }; }
+    inline float  getX(Float4 a) noexcept                      { return vgetq_lane_f32(a.v, 0); }
+    inline Float4 madd(Float4 a, Float4 b, Float4 c) noexcept  { return { vfmaq_f32(c.v, a.v, b.v) }; }
+
+    inline int moveMask(Float4 a) noexcept
+    {
+        static const int32_t shifts[4] = { 0, 1, 2, 3 };
+        auto bits = vshrq_n_u32(vreinterpretq_u32_f32(a.v), 31);
+        return static_cast<int>(vaddvq_u32(vshlq_u32(bits, vld1q_s32(shifts))));
+    }
+
+    template <int Lane>
+    inline Float4 splatLane(Float4 a) noexcept { return { vdupq_laneq_f32(a.v, Lane) }; }
+
+    inline Float4 select(Float4 a, Float4 b, Float4 mask) noexcept
+    {
+        return { vbslq_f32(vreinterpretq_u32_f32(mask.v), b.v, a.v) };
+    }
+
+#else
+    struct Float4
+    {
+        float v[4];
+
+        static constexpr uint32_t Width = 4;
+
+        static Float4 load(const float* p) noexcept   { return { { p[0], p[1], p[2], p[3] } }; }
+        static Float4 splat(float x) noexcept         { return { { x, x, x, x } }; }
+        static Float4 set(float x, float y, float z, float w) noexcept { return { { x, y, z, w } }; }
+        static Float4 zero() noexcept                 { return { { 0.f, 0.f, 0.f, 0.f } }; }
+    };
+
+    namespace Detail
+    {
+        template <typename Op>
+        inline Float4 map(Float4 a, Float4 b, Op op) noexcept
+        {
+            return { { op(a.v[0], b.v[0]), op(a.v[1], b.v[1]), op(a.v[2], b.v[2]), op(a.v[3], b.v[3]) } };
+        }
+
+        inline float    fromBits(uint32_t bits) noexcept { float f; std::memcpy(&f, &bits, 4); return f; }
+        inline uint32_t toBits(float f) noexcept         { uint32_t bits; std::memcpy(&bits, &f, 4); return bits; }
+        inline float    mask(bool set) noexcept          { return fromBits(set ? 0xFFFFFFFFu : 0u); }
+    }
+
+    inline void   store(float* p, Float4 a) noexcept           { for (int i = 0; i < 4; ++i) p[i] = a.v[i]; }
+    inline Float4 operator+(Float4 a, Float4 b) noexcept       { return Detail::map(a, b, [](float x, float y) { return x + y; }); }
+    inline Float4 operator-(Float4 a, Float4 b) noexcept       { return Detail::map(a, b, [](float x, float y) { return x - y; }); }
+    inline Float4 operator*(Float4 a, Float4 b) noexcept       { return Detail::map(a, b, [](float x, float y) { return x * y; }); }
+    inline Float4 operator/(Float4 a, Float4 b) noexcept       { return Detail::map(a, b, [](float x, float y) { return x / y; }); }
+    inline Float4 operator&(Float4 a, Float4 b) noexcept       { return Detail::map(a, b, [](float x, float y) { return Detail::fromBits(Detail::toBits(x) & Detail::toBits(y)); }); }
+    inline Float4 operator|(Float4 a, Float4 b) noexcept       { return Detail::map(a, b, [](float x, float y) { return Detail::fromBits(Detail::toBits(x) | Detail::toBits(y)); }); }
+    inline Float4 min(Float4 a, Float4 b) noexcept             { return Detail::map(a, b, [](float x, float y) { return y < x ? y : x; }); }
+    inline Float4 max(Float4 a, Float4 b) noexcept             { return Detail::map(a, b, [](float x, float y) { return x < y ? y : x; }); }
+    inline Float4 sqrt(Float4 a) noexcept                      { return Detail::map(a, a, [](float x, float) { return std::sqrt(x); }); }
+    inline Float4 abs(Float4 a) noexcept                       { return Detail::map(a, a, [](float x, float) { return std::fabs(x); }); }
+    inline Float4 lessThan(Float4 a, Float4 b) noexcept        { return Detail::map(a, b, [](float x, float y) { return Detail::mask(x < y); }); }
+    inline Float4 greaterThan(Float4 a, Float4 b) noexcept     { return Detail::map(a, b, [](float x, float y) { return Detail::mask(x > y); }); }
+    inline Float4 lessEqual(Float4 a, Float4 b) noexcept       { return Detail::map(a, b, [](float x, float y) { return Detail::mask(x <= y); }); }
+    inline Float4 greaterEqual(Float4 a, Float4 b) noexcept    { return Detail::map(a, b, [](float x, float y) { return Detail::mask(x >= y); }); }
+    inline Float4 equal(Float4 a, Float4 b) noexcept           { return Detail::map(a, b, [](float x, float y) { return Detail::mask(x == y); }); }
+    inline float  getX(Float4 a) noexcept                      { return a.v[0]; }
+    inline Float4 madd(Float4 a, Float4 b, Float4 c) noexcept  { return a * b + c; }
+
+    inline int moveMask(Float4 a) noexcept
+    {
+        int mask = 0;
+        for (int i = 0; i < 4; ++i)
+            mask |= static_cast<int>(Detail::toBits(a.v[i]) >> 31) << i;
+        return mask;
+    }
+
+    template <int Lane>
+    inline Float4 splatLane(Float4 a) noexcept { return Float4::splat(a.v[Lane]); }
+
+    inline Float4 select(Float4 a, Float4 b, Float4 mask) noexcept
+    {
+        Float4 result;
+        for (int i = 0; i < 4; ++i)
+            result.v[i] = Detail::toBits(mask.v[i]) >> 31 ? b.v[i] : a.v[i];
+        return result;
+    }
+#endif
+
+    // Sum of products of all four lanes
+    inline float dot4(Float4 a, Float4 b) noexcept
+    {
+        alignas(16) float lanes[4];
+        store(lanes, a * b);
+        return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+    }
+
+    // -------
+    //  FloatN
+    // -------
+
+#if defined(GALGAME_SIMD_BACKEND_AVX2)
+    struct Float8
+    {
+        __m256 v;
+
+        static constexpr uint32_t Width = 8;
+
+        static Float8 load(const float* p) noexcept   { return { _mm256_loadu_ps(p) }; }
+        static Float8 splat(float x) noexcept         { return { _mm256_set1_ps(x) }; }
+        static Float8 zero() noexcept                 { return { _mm256_setzero_ps() }; }
+    };
+
+    inline void   store(float* p, Float8 a) noexcept           { _mm256_storeu_ps(p, a.v); }
+    inline Float8 operator+(Float8 a, Float8 b) noexcept       { return { _mm256_add_ps(a.v, b.v) }; }
+    inline Float8 operator-(Float8 a, Float8 b) noexcept       { return { _mm256_sub_ps(a.v, b.v) }; }
+    inline Float8 operator*(Float8 a, Float8 b) noexcept       { return { _mm256_mul_ps(a.v, b.v) }; }
+    inline Float8 operator/(Float8 a, Float8 b) noexcept       { return { _mm256_div_ps(a.v, b.v) }; }
+    inline Float8 operator&(Float8 a, Float8 b) noexcept       { return { _mm256_and_ps(a.v, b.v) }; }
+    inline Float8 operator|(Float8 a, Float8 b) noexcept       { return { _mm256_or_ps(a.v, b.v) }; }
+    inline Float8 min(Float8 a, Float8 b) noexcept             { return { _mm256_min_ps(a.v, b.v) }; }
+    inline Float8 max(Float8 a, Float8 b) noexcept             { return { _mm256_max_ps(a.v, b.v) }; }
+    inline Float8 sqrt(Float8 a) noexcept                      { return { _mm256_sqrt_ps(a.v) }; }
+    inline Float8 abs(Float8 a) noexcept                       { return { _mm256_andnot_ps(_mm256_set1_ps(-0.f), a.v) }; }
+    inline Float8 lessThan(Float8 a, Float8 b) noexcept        { return { _mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ) }; }
+    inline Float8 greaterThan(Float8 a, Float8 b) noexcept     { return { _mm256_cmp_ps(a.v, b.v, _CMP_GT_OQ) }; }
+    inline Float8 lessEqual(Float8 a, Float8 b) noexcept       { return { _mm256_cmp_ps(a.v, b.v, _CMP_LE_OQ) }; }
+    inline Float8 greaterEqual(Float8 a, Float8 b) noexcept    { return { _mm256_cmp_ps(a.v, b.v, _CMP_GE_OQ) }; }
+    inline Float8 equal(Float8 a, Float8 b) noexcept           { return { _mm256_cmp_ps(a.v, b.v, _CMP_EQ_OQ) }; }
+    inline int    moveMask(Float8 a) noexcept                  { return _mm256_movemask_ps(a.v); }
+    inline Float8 madd(Float8 a, Float8 b, Float8 c) noexcept  { return { _mm256_fmadd_ps(a.v, b.v, c.v) }; }
+    inline Float8 select(Float8 a, Float8 b, Float8 mask) noexcept { return { _mm256_blendv_ps(a.v, b.v, mask.v) }; }
+
+    using FloatN = Float8;
+#else
+    using FloatN = Float4;
+#endif
+
+    inline constexpr uint32_t Width = FloatN::Width;
+}
@@ -0,0 +1,168 @@
+#pragma once
+
+#include "Math.hpp"
+#include "Device.hpp"
+
+#include <vector>
+#include <cstdint>
+
+namespace GalgameEngine
+{
+    class JobSystem;
+
+    /*
+    * Tiled CPU rasterizer, renders images without GPU
+    * A draw runs its vertex stage and triangle setup in chunks of triangles, one job per chunk, and every chunk
+    * bins its triangles into the screen tiles they touch. A flush rasterizes the tiles in parallel, each tile
+    * walks the chunks in submission order, so the image does not depend on the thread count.
+    * Edge functions and the depth test take Simd::Width pixels per step.
+    *
+    * Fixed function: positions are transformed by the world matrix of their instance and the view projection,
+    * triangles are filled with the flat color of their draw. Color targets are RGBA8, depth targets are float
+    */
+    class SoftwareRasterizer
+    {
+    public:
+        struct Config
+        {
+            JobSystem* jobSystem      = nullptr;   // Runs the jobs when set, use the rasterizer from a thread of it then
+            uint32_t   tileSize       = 64;        // Pixels per tile side, a multiple of 16
+            uint32_t   chunkTriangles = 4096;      // Input triangles per vertex stage job
+            uint32_t   maxPending     = 1u << 18;  // Input triangles binned before draw() flushes
+        };
+
+        struct Stats
+        {
+            uint64_t draws     = 0;
+            uint64_t triangles = 0;     // Input triangles of all instances
+            uint64_t culled    = 0;     // Facing away, degenerate, outside the clip volume or with invalid indices
+            uint64_t clipped   = 0;     // Crossing the near or far plane, only the part inside is rasterized
+            uint64_t binned    = 0;     // Triangle entries over all tiles
+            uint64_t pixels    = 0;     // Covered pixels which passed the depth test
+            uint64_t flushes   = 0;
+        };
+
+        // Pixels of 4 bytes, rows pitch pixels apart. Pitch is a multiple of 16 so vector loads of a row stay in it
+        struct Surface
+        {
+            void*    pixels = nullptr;
+            uint32_t width  = 0;
+            uint32_t height = 0;
+            uint32_t pitch  = 0;
+        };
+
+        struct DrawDesc
+        {
+            // Float3 positions, indices past vertexCount are skipped with their triangle
+            const uint8_t* positions   = nullptr;
+            uint32_t       stride      = 0;
+            uint32_t       vertexCount = 0;
+            const uint8_t* indices     = nullptr;
+            bool           indices32   = false;
+            uint32_t       indexCount  = 0;
+            int32_t        baseVertex  = 0;
+
+            // World matrix of an instance is worlds[id], id is its uint32 in instanceIds or the instance index
+            uint32_t       instanceCount    = 1;
+            const uint8_t* instanceIds      = nullptr;
+            uint32_t       instanceIdStride = sizeof(uint32_t);
+            const uint8_t* worlds           = nullptr;  // Null is identity, unaligned Mat4 are fine
+            uint32_t       worldCount       = 0;
+            Mat4           viewProjection;
+
+            Viewport    viewport;
+            Rect        scissor;
+            CullMode    cullMode   = CullMode::Back;
+            bool        depthTest  = true;
+            bool        depthWrite = true;
+            CompareFunc depthFunc  = CompareFunc::Less;
+            uint32_t    color      = 0xFFFFFFFF;    // Packed by packColor()
+        };
+
+        explicit SoftwareRasterizer(const Config& config);
+
+        SoftwareRasterizer(const SoftwareRasterizer&)            = delete;
+        SoftwareRasterizer(SoftwareRasterizer&&)                 = delete;
+        SoftwareRasterizer& operator=(const SoftwareRasterizer&) = delete;
+        SoftwareRasterizer& operator=(SoftwareRasterizer&&)      = delete;
+
+        // Targets of the next draws, either may be empty. Flushes when they change
+        void setTargets(const Surface& color, const Surface& depth);
+        // Flush, then fill the surface
+        void clearColor(const Surface& target, uint32_t color);
+        void clearDepth(const Surface& target, float depth);
+
+        void draw(const DrawDesc& desc);
+        // Rasterize all binned triangles, the targets hold the image after it
+        void flush();
+
+        const Stats& getStats() const noexcept { return m_stats; }
+        void         resetStats() noexcept { m_stats = {}; }
+
+        // RGBA8 unorm as laid out in memory, red in the low byte
+        static uint32_t packColor(const float rgba[4]) noexcept;
+
+    private:
+        // Screen space, edge i is a * x + b * y + c, inside when >= 0 on top-left edges and > 0 on the others
+        struct Triangle
+        {
+            float    a[3];
+            float    b[3];
+            float    c[3];
+            float    z0, zx, zy;        // Depth plane z0 + zx * x + zy * y
+            int32_t  minX, minY, maxX, maxY;
+            uint32_t state;
+            uint32_t topLeft;           // Bit per edge
+        };
+
+        // What the triangles of one draw share
+        struct State
+        {
+            uint32_t    color;
+            CompareFunc depthFunc;
+            bool        depthTest;
+            bool        depthWrite;
+        };
+
+        // Output of vertex stage jobs, bins are sorted by tile before the tiles are rasterized
+        struct Chunk
+        {
+            std::vector<Triangle> triangles;
+            std::vector<uint32_t> entryTiles;   // Binned entry is a tile and a triangle of this chunk
+            std::vector<uint32_t> entryTriangles;
+            std::vector<uint32_t> binStart;     // Tile count + 1 offsets into binned
+            std::vector<uint32_t> binned;
+            uint32_t              inputs  = 0;
+            uint32_t              culled  = 0;
+            uint32_t              clipped = 0;
+        };
+
+        // Triangles [begin, end) of the draw over all instances, flattened instance by instance
+        void processTriangles(const DrawDesc& desc, uint32_t state, const Rect& clip, uint64_t begin, uint64_t end, Chunk& chunk);
+        // Clip to the near and far planes, then set up and bin what is left
+        void clipTriangle(const Vec4* vertices, const DrawDesc& desc, uint32_t state, const Rect& clip, Chunk& chunk);
+        void setupTriangle(const Vec4* vertices, const DrawDesc& desc, uint32_t state, const Rect& clip, Chunk& chunk);
+
+        void sortBins(Chunk& chunk);
+        void rasterizeTile(uint32_t tile);
+        void rasterizeTriangle(const Triangle& triangle, int32_t left, int32_t top, int32_t right, int32_t bottom, uint64_t& pixels);
+
+    private:
+        Config  m_config;
+        Surface m_color;
+        Surface m_depth;
+        int32_t m_width  = 0;   // Of the targets, the smaller one when both are set
+        int32_t m_height = 0;
+
+        uint32_t m_tilesX = 0;
+        uint32_t m_tilesY = 0;
+
+        std::vector<State>    m_states;
+        std::vector<Chunk>    m_chunks;         // Pool, the first m_chunkCount are in use
+        uint32_t              m_chunkCount = 0;
+        uint64_t              m_pending    = 0;
+        std::vector<uint64_t> m_tilePixels;
+
+        Stats m_stats;
+    };
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <unordered_map>
+
+namespace GalgameEngine
+{
+    /*
+    * Priority queue of pending stream requests, pure CPU bookkeeping
+    * Binary heap ordered by priority, requests of the same priority in the order they were pushed.
+    *
+    * Removing and re-prioritizing are lazy: the live state of every request is kept in a map,
+    * heap entries which no longer match it are dropped when they come to the top. Both are O(1) apart from
+    * the push of the new entry, and the heap is rebuilt when dead entries outnumber the live ones
+    */
+    class StreamQueue
+    {
+    public:
+        struct Item
+        {
+            uint64_t id;
+            float    priority;
+            uint64_t size;
+        };
+
+        struct Stats
+        {
+            uint64_t pushes       = 0;
+            uint64_t pops         = 0;
+            uint64_t removes      = 0;
+            uint64_t reprioritize = 0;
+            uint64_t staleDropped = 0;  // Dead heap entries dropped at the top
+            uint64_t rebuilds     = 0;
+        };
+
+        StreamQueue() = default;
+
+        StreamQueue(const StreamQueue&)            = delete;
+        StreamQueue(StreamQueue&&)                 = delete;
+        StreamQueue& operator=(const StreamQueue&) = delete;
+        StreamQueue& operator=(StreamQueue&&)      = delete;
+
+        // Id must not be queued already, higher priority comes out first
+        void push(uint64_t id, float priority, uint64_t size);
+        // Return false when the request is not queued
+        bool setPriority(uint64_t id, float priority);
+        bool remove(uint64_t id);
+
+        // Request which comes out next, false when the queue is empty
+        bool top(Item& item);
+        // Remove the request top() returned
+        void pop();
+
+        bool     contains(uint64_t id) const { return m_live.count(id) != 0; }
+        uint32_t getCount()       const noexcept { return static_cast<uint32_t>(m_live.size()); }
+        uint64_t getQueuedBytes() const noexcept { return m_queuedBytes; }
+        bool     isEmpty()        const noexcept { return m_live.empty(); }
+
+        const Stats& getStats() const noexcept { return m_stats; }
+
+    private:
+        struct Live
+        {
+            float    priority;
+            uint64_t stamp;     // New for every push and change, heap entries of another stamp are dead
+            uint64_t order;     // Push order, kept when the priority changes
+            uint64_t size;
+        };
+
+        struct Entry
+        {
+            float    priority;
+            uint64_t stamp;
+            uint64_t order;
+            uint64_t id;
+        };
+
+        // Heap order, true when a comes out after b
+        static bool isAfter(const Entry& a, const Entry& b) noexcept
+        {
+            return a.priority != b.priority ? a.priority < b.priority : a.order > b.order;
+        }
+
+        void pushEntry(uint64_t id, const Live& live);
+        // Drop dead entries at the top, return false when the heap is empty
+        bool settleTop();
+
+    private:
+        std::vector<Entry>                 m_heap;
+        std::unordered_map<uint64_t, Live> m_live;
+        uint64_t                           m_nextOrder   = 0;
+        uint64_t                           m_nextStamp   = 0;
+        uint64_t                           m_queuedBytes = 0;
+        Stats                              m_stats;
+    };
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <mutex>
+#include <chrono>
+#include <memory>
+#include <vector>
+#include <cstdint>
+
+namespace GalgameEngine
+{
+    /*
+    * Auto-reset OS event, what a fence signals when it reaches a value
+    * Win32 event on Windows, eventfd on Linux, so waits on many queues go through one kernel call
+    * and the same code runs without GPU. A successful wait consumes the signal
+    */
+    class SyncEvent
+    {
+    public:
+#ifdef _WIN32
+        using NativeHandle = void*;     // HANDLE
+#else
+        using NativeHandle = int;       // eventfd
+#endif
+        using Timeout = std::chrono::milliseconds;
+
+        static constexpr Timeout  Infinite     = Timeout::max();
+        static constexpr uint32_t TimedOut     = UINT32_MAX;
+        static constexpr uint32_t MaxWaitCount = 64;    // WaitForMultipleObjects limit, kept on Linux too
+
+        SyncEvent();
+        ~SyncEvent();
+
+        SyncEvent(const SyncEvent&)            = delete;
+        SyncEvent(SyncEvent&&)                 = delete;
+        SyncEvent& operator=(const SyncEvent&) = delete;
+        SyncEvent& operator=(SyncEvent&&)      = delete;
+
+        void set();
+        void reset();
+
+        // Return whether the event was signaled before the timeout
+        bool wait(Timeout timeout = Infinite);
+
+        // Index of the first signaled event, only that one is consumed, TimedOut on timeout
+        static uint32_t waitAny(SyncEvent* const* events, uint32_t count, Timeout timeout = Infinite);
+        // Whether all events were signaled before the timeout, signals are only consumed when all are there
+        // Events must not be waited by another thread meanwhile
+        static bool     waitAll(SyncEvent* const* events, uint32_t count, Timeout timeout = Infinite);
+
+        NativeHandle getNativeHandle() const noexcept { return m_handle; }
+
+    private:
+        NativeHandle m_handle;
+    };
+
+    /*
+    * Keeps wait events alive between waits, creating and closing a kernel object per wait costs
+    * more than the wait itself when GPU is already almost done
+    * Thread safe
+    */
+    class SyncEventPool
+    {
+    public:
+        struct Stats
+        {
+            uint64_t created  = 0;  // Events ever created, stays flat once the pool is warm
+            uint64_t acquired = 0;
+        };
+
+        SyncEventPool() = default;
+        ~SyncEventPool();
+
+        SyncEventPool(const SyncEventPool&)            = delete;
+        SyncEventPool(SyncEventPool&&)                 = delete;
+        SyncEventPool& operator=(const SyncEventPool&) = delete;
+        SyncEventPool& operator=(SyncEventPool&&)      = delete;
+
+        // Event is reset
+        SyncEvent* acquire();
+        // Nothing must signal the event anymore, e.g. the fence it was set on has passed its value
+        void       release(SyncEvent* event);
+
+        Stats getStats() const;
+
+    private:
+        mutable std::mutex                      m_mutex;
+        std::vector<std::unique_ptr<SyncEvent>> m_events;
+        std::vector<SyncEvent*>                 m_free;
+        Stats                                   m_stats;
+    };
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include "SyncEvent.hpp"
+#include "CommandQueue.hpp"
+
+#include <mutex>
+#include <vector>
+#include <cstdint>
+#include <functional>
+
+namespace GalgameEngine
+{
+    // A point on the timeline of a queue, reached when the fence of the queue gets to the value
+    struct FencePoint
+    {
+        CommandQueue* queue = nullptr;
+        uint64_t      value = 0;
+
+        bool isCompleted() const { return queue->isCompleted(value); }
+    };
+
+    /*
+    * CPU side synchronization with the timelines of several queues
+    * Points are polled without blocking, or waited for any or all of them with a timeout through one OS wait.
+    * Wait events come from a pool and are set on the queue fences, an event whose fence has not reached
+    * its value when the wait ends (timeout, or another point of waitAny came first) stays armed and is only
+    * given back to the pool after the fence signaled it, so a late signal never wakes a later wait.
+    *
+    * Callbacks registered with onCompleted() run from dispatch() once their point is reached,
+    * in registration order, on the thread calling dispatch().
+    *
+    * Thread safe. Queues must reach every waited value before the sync is destroyed
+    */
+    class TimelineSync
+    {
+    public:
+        using Timeout  = SyncEvent::Timeout;
+        using Callback = std::function<void()>;
+
+        static constexpr Timeout  Infinite = SyncEvent::Infinite;
+        static constexpr uint32_t TimedOut = SyncEvent::TimedOut;
+
+        struct Stats
+        {
+            uint64_t waits         = 0;     // Waits which really blocked
+            uint64_t timeouts      = 0;
+            uint64_t callbacks     = 0;     // Callbacks run by dispatch()
+            uint64_t createdEvents = 0;     // Wait events ever created, see SyncEventPool
+            uint32_t armedEvents   = 0;     // Events of finished waits whose signal has not arrived yet
+        };
+
+        TimelineSync() = default;
+        ~TimelineSync();
+
+        TimelineSync(const TimelineSync&)            = delete;
+        TimelineSync(TimelineSync&&)                 = delete;
+        TimelineSync& operator=(const TimelineSync&) = delete;
+        TimelineSync& operator=(TimelineSync&&)      = delete;
+
+        // Index of a reached point, TimedOut on timeout. Count is at most SyncEvent::MaxWaitCount
+        uint32_t waitAny(const FencePoint* points, uint32_t count, Timeout timeout = Infinite);
+        // Whether all points were reached before the timeout
+        bool     waitAll(const FencePoint* points, uint32_t count, Timeout timeout = Infinite);
+        bool     wait(const FencePoint& point, Timeout timeout = Infinite) { return waitAll(&point, 1, timeout); }
+
+        // Run the callback from dispatch() once the point is reached
+        void     onCompleted(const FencePoint& point, Callback callback);
+        // Run callbacks of reached points, return how many ran. Never blocks on GPU
+        uint32_t dispatch();
+
+        uint32_t getPendingCallbackCount() const;
+        Stats    getStats() const;
+
+    private:
+        struct PendingCallback
+        {
+            FencePoint point;
+            Callback   callback;
+        };
+
+        // Pool event set on the fence of every point
+        void arm(const FencePoint* points, uint32_t count, SyncEvent** events);
+        // Give back events whose signal was consumed or has arrived, keep the others armed
+        void disarm(SyncEvent** events, uint32_t count, bool consumed);
+        // Give back armed events of earlier waits whose signal has arrived
+        void recycle();
+
+    private:
+        SyncEventPool m_events;
+
+        mutable std::mutex           m_mutex;
+        std::vector<SyncEvent*>      m_armedEvents;      // Still set on a fence, waiting for a late signal
+        std::vector<PendingCallback> m_callbacks;
+        Stats                        m_stats;
+    };
+}
@@ -1,9 +1,16 @@
 #pragma once
 
+#include "FrameHistogram.hpp"
+
 #include <functional>
+#include <cstdint>
 
 namespace GalgameEngine
 {
+    /*
+    * Game timer based on the portable monotonic clock (invariant TSC when the CPU has one)
+    * Time is counted in clock ticks, every update() records the frame duration into a histogram
+    */
     class Timer
     {
     public:
@@ -15,6 +22,10 @@ namespace GalgameEngine
         Timer& operator=(const Timer&) = delete;
         Timer& operator=(Timer&&)      = delete;
 
+        // Current tick of the monotonic clock, use for timestamps which are compared with timer time
+        static int64_t now() noexcept;
+        static double  getSecondsPerCount() noexcept;
+
         void reset()  noexcept;
         void resume() noexcept;
         void pause()  noexcept;
@@ -24,23 +35,30 @@ namespace GalgameEngine
         void setFunc(const std::function<void()>& func) { m_func = func; }
         void calculateFrameState() noexcept;
 
-        float getTime() const noexcept;
-        float getFPS()  const noexcept { return m_fps; }
-        float getMSPF() const noexcept { return m_mspf; }
+        float getTime()      const noexcept;
+        float getDeltaTime() const noexcept { return static_cast<float>(m_deltaTime); }
+        float getFPS()       const noexcept { return m_fps; }
+        float getMSPF()      const noexcept { return m_mspf; }
+
+        // Frame durations of recent frames, safe to read from other threads
+        const FrameHistogram& getHistogram() const noexcept { return m_histogram; }
 
     private:
-        double m_secondsPerCount;
+        int64_t m_baseTime   = 0;
+        int64_t m_pausedTime = 0;
+        int64_t m_stopTime   = 0;
+        int64_t m_prevTime   = 0;
+        int64_t m_currTime   = 0;
 
-        __int64 m_baseTime   = 0;
-        __int64 m_pausedTime = 0;
-        __int64 m_stopTime   = 0;
-        __int64 m_prevTime   = 0;
-        __int64 m_currTime   = 0;
+        double    m_deltaTime   = 0.0;
+        int       m_frameCnt    = 0;
+        float     m_timeElapsed = 0.f;
+        float     m_fps         = 0;
+        float     m_mspf        = 0;
+        bool      m_paused      = false;
 
-        float     m_fps      = 0;
-        float     m_mspf     = 0;
-        bool      m_paused   = false;
+        FrameHistogram m_histogram;
 
         std::function<void()> m_func = []{};
     };
-}
\ No newline at end of file
+}
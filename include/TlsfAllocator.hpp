@@ -0,0 +1,113 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+namespace GalgameEngine
+{
+    /*
+    * Two-level segregated fit allocator over an address range, pure CPU bookkeeping
+    * Free blocks are kept in size classes, a size class is a 3-bit mantissa with an exponent,
+    * so a class never spans more than 12.5% of its sizes. Two levels of bitmasks find the
+    * smallest non-empty class that fits a request with a couple of bit scans.
+    *
+    * Allocate and free are O(1): one class lookup, then split or merge with the neighbours in
+    * address order. Sizes and offsets are kept in units of granularity, alignment is taken from
+    * the front of the found block and given back as a free block.
+    *
+    * Not thread safe, owners lock around it
+    */
+    class TlsfAllocator
+    {
+    public:
+        static constexpr uint32_t InvalidNode = UINT32_MAX;
+
+        struct Allocation
+        {
+            uint64_t offset = 0;
+            uint64_t size   = 0;               // Rounded up to granularity
+            uint32_t node   = InvalidNode;
+
+            bool isValid() const noexcept { return node != InvalidNode; }
+        };
+
+        struct Stats
+        {
+            uint64_t capacity         = 0;
+            uint64_t usedBytes        = 0;
+            uint64_t freeBytes        = 0;
+            uint64_t largestFreeBlock = 0;      // Lower bound, sizes of one class are not told apart
+            uint32_t allocations      = 0;
+            uint32_t freeBlocks       = 0;
+        };
+
+        // Granularity must be a power of two, capacity is rounded down to it
+        explicit TlsfAllocator(uint64_t capacity, uint64_t granularity = 256);
+
+        TlsfAllocator(const TlsfAllocator&)            = delete;
+        TlsfAllocator(TlsfAllocator&&)                 = delete;
+        TlsfAllocator& operator=(const TlsfAllocator&) = delete;
+        TlsfAllocator& operator=(TlsfAllocator&&)      = delete;
+
+        // Invalid allocation when no free block fits, alignment must be a power of two
+        Allocation allocate(uint64_t size, uint64_t alignment = 1);
+        void       free(const Allocation& allocation);
+
+        uint64_t getCapacity()  const noexcept { return static_cast<uint64_t>(m_capacity) * m_granularity; }
+        uint64_t getUsed()      const noexcept { return getCapacity() - static_cast<uint64_t>(m_freeUnits) * m_granularity; }
+        bool     isEmpty()      const noexcept { return m_allocationCount == 0; }
+        Stats    getStats()     const noexcept;
+
+        // 0 when free memory is one block, towards 1 when it is scattered in small blocks
+        double getFragmentation() const noexcept;
+
+        // Allocations in address order, for defragmentation and debugging
+        void getAllocations(std::vector<Allocation>& allocations) const;
+
+        // Check every invariant, return false on the first broken one. Slow, for fuzzing
+        bool validate() const;
+
+    private:
+        static constexpr uint32_t TopBinCount  = 32;
+        static constexpr uint32_t LeafBinCount = 8;     // Mantissa values per exponent
+        static constexpr uint32_t BinCount     = TopBinCount * LeafBinCount;
+
+        struct Node
+        {
+            uint32_t offset       = 0;      // In units
+            uint32_t size         = 0;
+            uint32_t binPrevious  = InvalidNode;
+            uint32_t binNext      = InvalidNode;
+            uint32_t addressPrevious = InvalidNode;
+            uint32_t addressNext     = InvalidNode;
+            bool     used         = false;
+            bool     alive        = false;  // Not on the node free list
+        };
+
+        uint32_t createNode(uint32_t offset, uint32_t size);
+        void     destroyNode(uint32_t node);
+
+        void insertFree(uint32_t node);
+        void removeFree(uint32_t node);
+
+        // Split the front of the node off as a new free node, the node keeps the rest
+        void splitFront(uint32_t node, uint32_t size);
+        // Split the back of the node off as a new free node, the node keeps size units
+        void splitBack(uint32_t node, uint32_t size);
+
+    private:
+        uint64_t m_granularity;
+        uint32_t m_granularityShift;
+        uint32_t m_capacity;                // In units
+        uint32_t m_freeUnits       = 0;
+        uint32_t m_allocationCount = 0;
+        uint32_t m_freeBlockCount  = 0;
+
+        uint32_t m_usedTopBins = 0;         // Bit per exponent with any non-empty class
+        uint8_t  m_usedLeafBins[TopBinCount] = {};
+        uint32_t m_binHeads[BinCount];
+
+        std::vector<Node>     m_nodes;
+        std::vector<uint32_t> m_freeNodes;
+    };
+}
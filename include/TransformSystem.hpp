@@ -0,0 +1,65 @@
+#pragma once
+
+#include "Math.hpp"
+#include "EntityStore.hpp"
+
+#include <cstdint>
+
+namespace GalgameEngine
+{
+    class JobSystem;
+
+    // Transform components of scene entities
+    struct Position
+    {
+        Vec3 value;
+    };
+
+    struct Rotation
+    {
+        Quat value;
+    };
+
+    // Entities without it have unit scale
+    struct Scale
+    {
+        Vec3 value = { 1.f, 1.f, 1.f };
+    };
+
+    // Row-major world matrix, what instance data uploads
+    struct LocalToWorld
+    {
+        Mat4 value;
+    };
+
+    /*
+    * Composes LocalToWorld from Position, Rotation and Scale
+    * Only chunks where one of them was written since the last update are recomputed,
+    * a static scene costs one version check per chunk
+    */
+    class TransformSystem
+    {
+    public:
+        struct Stats
+        {
+            uint64_t chunks   = 0;      // Recomputed in the last update
+            uint64_t entities = 0;
+        };
+
+        TransformSystem() = default;
+
+        TransformSystem(const TransformSystem&)            = delete;
+        TransformSystem(TransformSystem&&)                 = delete;
+        TransformSystem& operator=(const TransformSystem&) = delete;
+        TransformSystem& operator=(TransformSystem&&)      = delete;
+
+        // Chunks are spread over the job system when set, call it from a thread of the system then
+        void update(EntityStore& store, JobSystem* jobSystem = nullptr);
+
+        const Stats& getStats() const noexcept { return m_stats; }
+
+    private:
+        uint64_t m_lastVersion = 0;
+        Stats    m_stats;
+    };
+}
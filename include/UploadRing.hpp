@@ -0,0 +1,93 @@
+#pragma once
+
+#include "Device.hpp"
+#include "RingAllocator.hpp"
+
+#include <deque>
+#include <vector>
+#include <memory>
+#include <cstring>
+
+namespace GalgameEngine
+{
+    /*
+    * Persistently mapped upload heap ring for per-frame dynamic data (constants, vertices...)
+    * Sub-allocation is O(1) without map/unmap, memory is reclaimed when the frame fence passes.
+    * When a frame overflows the ring, it falls back to a dedicated upload buffer which is
+    * released through the frame fence as well, and counted so the ring size can be tuned
+    */
+    class UploadRing
+    {
+    public:
+        // Constant buffer views need 256 bytes alignment
+        static constexpr uint64_t ConstantAlignment = 256;
+
+        struct Allocation
+        {
+            uint8_t* cpuAddress = nullptr;
+            uint64_t gpuAddress = 0;
+            Buffer*  buffer     = nullptr;
+            uint64_t offset     = 0;        // Offset in buffer
+            uint64_t size       = 0;
+
+            explicit operator bool() const noexcept { return cpuAddress != nullptr; }
+        };
+
+        struct Stats
+        {
+            RingAllocator::Stats ring;
+            uint64_t             overflowCount = 0;  // Allocations served by fallback buffers
+            uint64_t             overflowBytes = 0;
+        };
+
+        UploadRing(Device& device, uint64_t capacity);
+        ~UploadRing() = default;
+
+        UploadRing(const UploadRing&)            = delete;
+        UploadRing(UploadRing&&)                 = delete;
+        UploadRing& operator=(const UploadRing&) = delete;
+        UploadRing& operator=(UploadRing&&)      = delete;
+
+        // Alignment must be a power of two
+        Allocation allocate(uint64_t size, uint64_t alignment = ConstantAlignment);
+
+        // Allocate and copy data, e.g. a constant block
+        template <typename T>
+        Allocation push(const T& data, uint64_t alignment = ConstantAlignment)
+        {
+            auto allocation = allocate(sizeof(T), alignment);
+            std::memcpy(allocation.cpuAddress, &data, sizeof(T));
+            return allocation;
+        }
+
+        // Close allocations of this frame, they are reused after GPU reaches fenceValue
+        void finishFrame(uint64_t fenceValue);
+
+        uint64_t getCapacity() const noexcept { return m_ring.getCapacity(); }
+        uint64_t getUsed()     const noexcept { return m_ring.getUsed(); }
+
+        Stats getStats() const noexcept;
+        void  resetStats() noexcept;
+
+    private:
+        Allocation allocateOverflow(uint64_t size, uint64_t alignment);
+        void       releaseRetired(uint64_t completedValue);
+
+    private:
+        struct RetiredBuffer
+        {
+            std::unique_ptr<Buffer> buffer;
+            uint64_t                fenceValue;
+        };
+
+        Device&                 m_device;
+        CommandQueue&           m_queue;
+        std::unique_ptr<Buffer> m_buffer;
+        RingAllocator           m_ring;
+
+        std::vector<std::unique_ptr<Buffer>> m_overflows;     // Fallback buffers of current frame
+        std::deque<RetiredBuffer>            m_retired;       // Fallback buffers waiting for GPU
+        uint64_t                             m_overflowCount = 0;
+        uint64_t                             m_overflowBytes = 0;
+    };
+}
@@ -2,6 +2,11 @@
 
 #include <Windows.h>
 
+#include <exception>
+
+#define ThrowIfFailed(x) if (FAILED(x)) throw std::exception();
+#define ThrowIfFalse(x)  if (!(x)) throw std::exception();
+
 namespace Util
 {
     // Use windows memory check
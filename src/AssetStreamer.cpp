@@ -0,0 +1,351 @@
+#include "AssetStreamer.hpp"
+#include "Profiler.hpp"
+
+#include <algorithm>
+
+using namespace GalgameEngine;
+
+namespace
+{
+    // Completions taken per poll call, more are taken by calling again
+    constexpr uint32_t CompletionBatch = 64;
+}
+
+AssetStreamer::AssetStreamer(Device& device, const Config& config, ResidencyManager* residency)
+    : m_device(device),
+      m_copyQueue(device.getCopyQueue()),
+      m_config(config),
+      m_residency(residency),
+      m_io(config.io),
+      m_completions(CompletionBatch),
+      m_stagingAllocator(config.stagingSize, TextureCopyPlacementAlignment)
+{
+    BufferDesc desc;
+    desc.size     = m_stagingAllocator.getCapacity();
+    desc.heapType = HeapType::Upload;
+    m_staging = m_device.createBuffer(desc, ResourceState::GenericRead);
+}
+
+AssetStreamer::~AssetStreamer()
+{
+    // Reads land in staging memory and copies read it, both must be done before it goes away
+    while (m_io.getInFlight() > 0)
+        m_io.poll(m_completions.data(), CompletionBatch, true);
+    if (!m_batches.empty())
+        m_copyQueue.waitForValue(m_batches.back().fenceValue);
+
+    for (auto& file : m_files)
+        m_io.closeFile(file.handle);
+}
+
+StreamFile AssetStreamer::openFile(const std::string& path)
+{
+    auto handle = m_io.openFile(path);
+    if (handle == IoQueue::InvalidFile)
+        return InvalidStreamFile;
+
+    StreamFile file;
+    if (!m_freeFiles.empty())
+    {
+        file = m_freeFiles.back();
+        m_freeFiles.pop_back();
+    }
+    else
+    {
+        file = static_cast<StreamFile>(m_files.size());
+        m_files.emplace_back();
+    }
+    m_files[file] = { handle, m_io.getFileSize(handle) };
+    return file;
+}
+
+void AssetStreamer::closeFile(StreamFile file)
+{
+    if (file >= m_files.size() || m_files[file].handle == IoQueue::InvalidFile)
+        return;
+    m_io.closeFile(m_files[file].handle);
+    m_files[file] = {};
+    m_freeFiles.push_back(file);
+}
+
+StreamId AssetStreamer::request(StreamRequest desc)
+{
+    if (desc.file >= m_files.size() || m_files[desc.file].handle == IoQueue::InvalidFile)
+        return InvalidStream;
+    auto fileSize = m_files[desc.file].size;
+    if (desc.size == 0 || desc.size > m_stagingAllocator.getCapacity() || desc.offset > fileSize || desc.size > fileSize - desc.offset)
+        return InvalidStream;
+    if ((desc.buffer != nullptr) == (desc.texture != nullptr))
+        return InvalidStream;
+    if (desc.buffer != nullptr && (desc.bufferOffset > desc.buffer->getDesc().size || desc.size > desc.buffer->getDesc().size - desc.bufferOffset))
+        return InvalidStream;
+    if (desc.texture != nullptr && (desc.rowPitch % TextureCopyPitchAlignment != 0 ||
+                                    desc.size != static_cast<uint64_t>(desc.rowPitch) * desc.texture->getDesc().height))
+        return InvalidStream;
+
+    // Copies run on the copy queue whenever the read lands, the destination may not be evicted until then
+    if (m_residency != nullptr)
+        m_residency->pin(getDestination(desc));
+
+    auto id       = m_nextId++;
+    auto priority = desc.priority;
+    auto size     = desc.size;
+    m_pending.emplace(id, Pending{ std::move(desc), StreamStatus::Queued, false, {} });
+    m_queue.push(id, priority, size);
+    ++m_stats.requests;
+    return id;
+}
+
+bool AssetStreamer::setPriority(StreamId id, float priority)
+{
+    auto it = m_pending.find(id);
+    if (it == m_pending.end() || !m_queue.setPriority(id, priority))
+        return false;
+    it->second.desc.priority = priority;
+    return true;
+}
+
+bool AssetStreamer::cancel(StreamId id)
+{
+    auto it = m_pending.find(id);
+    if (it == m_pending.end() || it->second.cancelled)
+        return false;
+
+    auto& pending = it->second;
+    if (pending.status != StreamStatus::Queued && pending.status != StreamStatus::Reading)
+        return false;
+    if (m_residency != nullptr)
+        m_residency->unpin(getDestination(pending.desc));
+
+    if (pending.status == StreamStatus::Queued)
+    {
+        m_queue.remove(id);
+        m_pending.erase(it);
+    }
+    else
+    {
+        // The read cannot be taken back, its staging memory comes back when it lands
+        pending.cancelled = true;
+        pending.desc.onComplete = nullptr;
+    }
+    ++m_stats.cancelled;
+    return true;
+}
+
+StreamStatus AssetStreamer::getStatus(StreamId id) const
+{
+    auto it = m_pending.find(id);
+    return it != m_pending.end() && !it->second.cancelled ? it->second.status : StreamStatus::None;
+}
+
+void AssetStreamer::update()
+{
+    PROFILE_SCOPE("AssetStreamer::update");
+
+    finishBatches();
+    pollReads(false);
+    recordCopies();
+    startReads();
+    m_io.submit();
+}
+
+void AssetStreamer::waitIdle()
+{
+    while (true)
+    {
+        update();
+        if (m_pending.empty())
+            break;
+
+        // Block on whatever comes first, reads or the oldest copy list
+        if (m_io.getInFlight() > 0)
+            pollReads(true);
+        else if (!m_batches.empty())
+            m_copyQueue.waitForValue(m_batches.front().fenceValue);
+    }
+}
+
+AssetStreamer::Stats AssetStreamer::getStats() const noexcept
+{
+    auto stats = m_stats;
+    stats.queued   = m_queue.getCount();
+    stats.inFlight = static_cast<uint32_t>(m_pending.size()) - stats.queued;
+    return stats;
+}
+
+void AssetStreamer::finishBatches()
+{
+    auto completedValue = m_copyQueue.getCompletedValue();
+    if (m_batches.empty() || m_batches.front().fenceValue > completedValue)
+        return;
+
+    // One wait covers every finished batch, the copy fence has passed already so it costs GPU nothing
+    uint64_t handedValue = 0;
+    for (auto& batch : m_batches)
+    {
+        if (batch.fenceValue > completedValue)
+            break;
+        handedValue = batch.fenceValue;
+    }
+    m_device.getQueue().wait(m_copyQueue, handedValue);
+
+    while (!m_batches.empty() && m_batches.front().fenceValue <= handedValue)
+    {
+        auto batch = std::move(m_batches.front());
+        m_batches.pop_front();
+        m_freeContexts.push_back(std::move(batch.context));
+
+        for (auto id : batch.requests)
+        {
+            m_stagingAllocator.free(m_pending.find(id)->second.staging);
+            finish(id, StreamStatus::Ready);
+        }
+    }
+}
+
+void AssetStreamer::pollReads(bool wait)
+{
+    while (true)
+    {
+        auto count = m_io.poll(m_completions.data(), CompletionBatch, wait);
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            auto  id      = m_completions[i].userData;
+            auto& pending = m_pending.find(id)->second;
+            if (pending.cancelled)
+            {
+                m_stagingAllocator.free(pending.staging);
+                m_pending.erase(id);
+            }
+            else if (m_completions[i].result != static_cast<int64_t>(pending.desc.size))
+            {
+                // Read error, or the file got shorter since it was opened
+                m_stagingAllocator.free(pending.staging);
+                finish(id, StreamStatus::Failed);
+            }
+            else
+            {
+                m_stats.bytesRead += pending.desc.size;
+                m_readsDone.push_back(id);
+            }
+        }
+        if (count < CompletionBatch)
+            break;
+        wait = false;
+    }
+}
+
+void AssetStreamer::recordCopies()
+{
+    if (m_readsDone.empty())
+        return;
+
+    PROFILE_SCOPE("AssetStreamer::recordCopies");
+    auto batchSize = std::max(m_config.copiesPerBatch, 1u);
+    for (size_t begin = 0; begin < m_readsDone.size(); begin += batchSize)
+    {
+        CopyContext context;
+        if (!m_freeContexts.empty())
+        {
+            context = std::move(m_freeContexts.back());
+            m_freeContexts.pop_back();
+        }
+        else
+        {
+            context.allocator = m_device.createCommandAllocator(QueueType::Copy);
+            context.list      = m_device.createCommandList(QueueType::Copy);
+        }
+
+        // Contexts come back only after GPU finished their batch
+        context.allocator->reset();
+        context.list->reset(*context.allocator);
+
+        Batch batch;
+        auto  end = std::min(begin + batchSize, m_readsDone.size());
+        for (size_t i = begin; i < end; ++i)
+        {
+            // Cancelled by a callback after its read landed
+            auto& pending = m_pending.find(m_readsDone[i])->second;
+            auto& desc    = pending.desc;
+            if (pending.cancelled)
+            {
+                m_stagingAllocator.free(pending.staging);
+                m_pending.erase(m_readsDone[i]);
+                continue;
+            }
+
+            if (desc.buffer != nullptr)
+                context.list->copyBufferRegion(*desc.buffer, desc.bufferOffset, *m_staging, pending.staging.offset, desc.size);
+            else
+                context.list->copyBufferToTexture(*desc.texture, *m_staging, pending.staging.offset, desc.rowPitch);
+            pending.status = StreamStatus::Copying;
+            batch.requests.push_back(m_readsDone[i]);
+        }
+        context.list->close();
+        if (batch.requests.empty())
+        {
+            m_freeContexts.push_back(std::move(context));
+            continue;
+        }
+
+        CommandList* list = context.list.get();
+        m_copyQueue.executeCommandLists(&list, 1);
+        batch.fenceValue = m_copyQueue.signal();
+        batch.context    = std::move(context);
+        m_batches.push_back(std::move(batch));
+        ++m_stats.copyBatches;
+    }
+    m_readsDone.clear();
+}
+
+void AssetStreamer::startReads()
+{
+    // Strict priority order: a request which does not fit now holds back the ones behind it,
+    // so large requests are not starved by a stream of small ones
+    uint64_t          started = 0;
+    StreamQueue::Item item;
+    while (m_queue.top(item))
+    {
+        // The first read of an update always starts, a request larger than the budget would never start otherwise
+        if (m_config.bytesPerFrame != 0 && started != 0 && started + item.size > m_config.bytesPerFrame)
+        {
+            ++m_stats.budgetStalls;
+            break;
+        }
+
+        auto staging = m_io.getInFlight() < m_io.getDepth() ? m_stagingAllocator.allocate(item.size, TextureCopyPlacementAlignment)
+                                                            : TlsfAllocator::Allocation();
+        if (!staging.isValid())
+        {
+            ++m_stats.stagingStalls;
+            break;
+        }
+
+        auto& pending = m_pending.find(item.id)->second;
+        auto& desc    = pending.desc;
+        m_io.read(m_files[desc.file].handle, desc.offset, desc.size, m_staging->getMappedData() + staging.offset, item.id);
+        pending.status  = StreamStatus::Reading;
+        pending.staging = staging;
+        m_queue.pop();
+
+        started += item.size;
+        m_stats.peakStaging = std::max(m_stats.peakStaging, m_stagingAllocator.getUsed());
+    }
+}
+
+void AssetStreamer::finish(StreamId id, StreamStatus status)
+{
+    // Erase first, the callback may request more
+    auto it       = m_pending.find(id);
+    auto callback = std::move(it->second.desc.onComplete);
+    if (m_residency != nullptr)
+        m_residency->unpin(getDestination(it->second.desc));
+    m_pending.erase(it);
+
+    if (status == StreamStatus::Ready)
+        ++m_stats.completed;
+    else
+        ++m_stats.failed;
+    if (callback)
+        callback(id, status);
+}
@@ -0,0 +1,164 @@
+#include "Bvh.hpp"
+#include "Profiler.hpp"
+
+#include <numeric>
+#include <algorithm>
+
+using namespace GalgameEngine;
+
+void Bvh::build(const BoundsStreams& bounds, uint32_t count)
+{
+    PROFILE_SCOPE("Bvh::build");
+
+    m_nodes.clear();
+    m_order.resize(count);
+    std::iota(m_order.begin(), m_order.end(), 0u);
+    for (int c = 0; c < 3; ++c)
+    {
+        m_center[c].assign(count + Width, 0.f);
+        m_extent[c].assign(count + Width, EmptyExtent);
+    }
+
+    if (count > 0)
+        createNode(bounds, { 0, count }, UINT32_MAX, 0);
+
+    m_slots.resize(count);
+    for (uint32_t slot = 0; slot < count; ++slot)
+        m_slots[m_order[slot]] = slot;
+    refit(bounds);
+}
+
+void Bvh::refit(const BoundsStreams& bounds)
+{
+    PROFILE_SCOPE("Bvh::refit");
+
+    auto count = static_cast<uint32_t>(m_order.size());
+    for (int c = 0; c < 3; ++c)
+    {
+        auto center = m_center[c].data();
+        auto extent = m_extent[c].data();
+        for (uint32_t slot = 0; slot < count; ++slot)
+        {
+            center[slot] = bounds.center[c][m_order[slot]];
+            extent[slot] = bounds.extent[c][m_order[slot]];
+        }
+    }
+
+    // Children are created after their parent, so going backwards every child is done before its parent
+    for (size_t n = m_nodes.size(); n-- > 0;)
+    {
+        auto& node = m_nodes[n];
+        Vec3  nodeMin = { INFINITY, INFINITY, INFINITY };
+        Vec3  nodeMax = { -INFINITY, -INFINITY, -INFINITY };
+        for (uint32_t i = 0; i < Width; ++i)
+        {
+            if (node.count[i] == 0)
+                continue;
+
+            if (node.child[i] == LeafChild)
+            {
+                Vec3 leafMin = { INFINITY, INFINITY, INFINITY };
+                Vec3 leafMax = { -INFINITY, -INFINITY, -INFINITY };
+                for (uint32_t slot = node.first[i]; slot < node.first[i] + node.count[i]; ++slot)
+                {
+                    Vec3 center = { m_center[0][slot], m_center[1][slot], m_center[2][slot] };
+                    Vec3 extent = { m_extent[0][slot], m_extent[1][slot], m_extent[2][slot] };
+                    leafMin = min(leafMin, center - extent);
+                    leafMax = max(leafMax, center + extent);
+                }
+                for (int c = 0; c < 3; ++c)
+                {
+                    node.center[c][i] = ((&leafMin.x)[c] + (&leafMax.x)[c]) * 0.5f;
+                    node.extent[c][i] = ((&leafMax.x)[c] - (&leafMin.x)[c]) * 0.5f;
+                }
+            }
+
+            Vec3 center = { node.center[0][i], node.center[1][i], node.center[2][i] };
+            Vec3 extent = { node.extent[0][i], node.extent[1][i], node.extent[2][i] };
+            nodeMin = min(nodeMin, center - extent);
+            nodeMax = max(nodeMax, center + extent);
+        }
+
+        if (node.parent == UINT32_MAX)
+            continue;
+        auto& parent = m_nodes[node.parent];
+        for (int c = 0; c < 3; ++c)
+        {
+            parent.center[c][node.parentSlot] = ((&nodeMin.x)[c] + (&nodeMax.x)[c]) * 0.5f;
+            parent.extent[c][node.parentSlot] = ((&nodeMax.x)[c] - (&nodeMin.x)[c]) * 0.5f;
+        }
+    }
+}
+
+uint32_t Bvh::createNode(const BoundsStreams& bounds, Range range, uint32_t parent, uint32_t parentSlot)
+{
+    // Split the biggest range until there are Width of them or all fit a leaf
+    Range    ranges[Width] = { range };
+    uint32_t rangeCount    = 1;
+    while (rangeCount < Width)
+    {
+        uint32_t biggest = 0;
+        for (uint32_t i = 1; i < rangeCount; ++i)
+        {
+            if (ranges[i].end - ranges[i].begin > ranges[biggest].end - ranges[biggest].begin)
+                biggest = i;
+        }
+        if (ranges[biggest].end - ranges[biggest].begin <= LeafSize)
+            break;
+        splitRange(bounds, ranges[biggest], ranges[biggest], ranges[rangeCount]);
+        ++rangeCount;
+    }
+
+    auto index = static_cast<uint32_t>(m_nodes.size());
+    m_nodes.emplace_back();
+    m_nodes[index].parent     = parent;
+    m_nodes[index].parentSlot = parentSlot;
+    for (uint32_t i = 0; i < Width; ++i)
+    {
+        bool used = i < rangeCount;
+        for (int c = 0; c < 3; ++c)
+        {
+            m_nodes[index].center[c][i] = 0.f;
+            m_nodes[index].extent[c][i] = EmptyExtent;
+        }
+        m_nodes[index].first[i] = used ? ranges[i].begin : 0;
+        m_nodes[index].count[i] = used ? ranges[i].end - ranges[i].begin : 0;
+        m_nodes[index].child[i] = LeafChild;
+    }
+
+    // m_nodes may grow in the recursion, the node is written through its index
+    for (uint32_t i = 0; i < rangeCount; ++i)
+    {
+        if (ranges[i].end - ranges[i].begin > LeafSize)
+        {
+            auto child = createNode(bounds, ranges[i], index, i);
+            m_nodes[index].child[i] = child;
+        }
+    }
+    return index;
+}
+
+void Bvh::splitRange(const BoundsStreams& bounds, Range range, Range& left, Range& right)
+{
+    Vec3 centroidMin = { INFINITY, INFINITY, INFINITY };
+    Vec3 centroidMax = { -INFINITY, -INFINITY, -INFINITY };
+    for (uint32_t i = range.begin; i < range.end; ++i)
+    {
+        auto object = m_order[i];
+        Vec3 center = { bounds.center[0][object], bounds.center[1][object], bounds.center[2][object] };
+        centroidMin = min(centroidMin, center);
+        centroidMax = max(centroidMax, center);
+    }
+
+    auto size = centroidMax - centroidMin;
+    int  axis = size.x > size.y ? (size.x > size.z ? 0 : 2) : (size.y > size.z ? 1 : 2);
+
+    // Median split, both halves are balanced even when objects clump
+    auto keys   = bounds.center[axis];
+    auto middle = range.begin + (range.end - range.begin) / 2;
+    std::nth_element(m_order.begin() + range.begin, m_order.begin() + middle, m_order.begin() + range.end,
+                     [keys](uint32_t a, uint32_t b) { return keys[a] < keys[b]; });
+
+    left  = { range.begin, middle };
+    right = { middle, range.end };
+}
@@ -0,0 +1,874 @@
+#include "CaptureDevice.hpp"
+#include "Timer.hpp"
+#include "Profiler.hpp"
+
+#include <cstring>
+#include <algorithm>
+#include <stdexcept>
+#include <type_traits>
+
+using namespace GalgameEngine;
+using namespace GalgameEngine::CaptureFormat;
+
+namespace
+{
+    template <typename T>
+    void write(std::vector<uint8_t>& stream, const T& value)
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        auto offset = stream.size();
+        stream.resize(offset + sizeof(value));
+        std::memcpy(stream.data() + offset, &value, sizeof(value));
+    }
+
+    void writeBytes(std::vector<uint8_t>& stream, const void* data, uint64_t size)
+    {
+        write(stream, size);
+        auto bytes = static_cast<const uint8_t*>(data);
+        stream.insert(stream.end(), bytes, bytes + size);
+    }
+
+    void writeString(std::vector<uint8_t>& stream, const std::string& string)
+    {
+        write(stream, static_cast<uint32_t>(string.size()));
+        stream.insert(stream.end(), string.begin(), string.end());
+    }
+
+    void writeBool(std::vector<uint8_t>& stream, bool value)
+    {
+        write(stream, static_cast<uint8_t>(value));
+    }
+
+    // Field by field, structs with padding would put indeterminate bytes into the file
+    void writeDesc(std::vector<uint8_t>& stream, const TextureDesc& desc)
+    {
+        write(stream, desc.width);
+        write(stream, desc.height);
+        write(stream, desc.format);
+        write(stream, desc.usage);
+        write(stream, desc.clearValue.color);
+        write(stream, desc.clearValue.depth);
+        write(stream, desc.clearValue.stencil);
+    }
+
+    void writeDesc(std::vector<uint8_t>& stream, const BufferDesc& desc)
+    {
+        write(stream, desc.size);
+        write(stream, desc.heapType);
+    }
+
+    void writeDesc(std::vector<uint8_t>& stream, const HeapDesc& desc)
+    {
+        write(stream, desc.size);
+        write(stream, desc.type);
+        write(stream, desc.usage);
+    }
+
+    void writeDesc(std::vector<uint8_t>& stream, const RootSignatureDesc& desc)
+    {
+        write(stream, static_cast<uint32_t>(desc.parameters.size()));
+        for (auto& parameter : desc.parameters)
+        {
+            write(stream, parameter.type);
+            write(stream, parameter.visibility);
+            write(stream, parameter.rangeType);
+            write(stream, parameter.shaderRegister);
+            write(stream, parameter.registerSpace);
+            write(stream, parameter.count);
+        }
+        writeBool(stream, desc.allowInputLayout);
+    }
+
+    void writeDesc(std::vector<uint8_t>& stream, const GraphicsPipelineDesc& desc, uint32_t rootSignature)
+    {
+        write(stream, rootSignature);
+        writeBytes(stream, desc.vertexShader.data(), desc.vertexShader.size());
+        writeBytes(stream, desc.pixelShader.data(), desc.pixelShader.size());
+        write(stream, static_cast<uint32_t>(desc.inputLayout.size()));
+        for (auto& element : desc.inputLayout)
+        {
+            writeString(stream, element.semantic);
+            write(stream, element.semanticIndex);
+            write(stream, element.format);
+            write(stream, element.slot);
+            write(stream, element.offset);
+            writeBool(stream, element.perInstance);
+        }
+        write(stream, desc.topology);
+        write(stream, desc.cullMode);
+        writeBool(stream, desc.wireframe);
+        write(stream, desc.blendMode);
+        writeBool(stream, desc.depthTest);
+        writeBool(stream, desc.depthWrite);
+        write(stream, desc.depthFunc);
+        write(stream, desc.renderTargetCount);
+        write(stream, desc.renderTargetFormats);
+        write(stream, desc.depthStencilFormat);
+    }
+
+    void writeDesc(std::vector<uint8_t>& stream, const SwapChainDesc& desc)
+    {
+        write(stream, desc.width);
+        write(stream, desc.height);
+        write(stream, desc.format);
+        write(stream, desc.bufferCount);
+        write(stream, desc.maxFrameLatency);
+    }
+
+    uint32_t getId(const Resource* resource) noexcept
+    {
+        auto object = dynamic_cast<const CaptureObject*>(resource);
+        return object != nullptr ? object->getCaptureId() : NoObject;
+    }
+
+    uint32_t getId(const Texture* texture) noexcept
+    {
+        return texture != nullptr ? static_cast<const CaptureTexture*>(texture)->getCaptureId() : NoObject;
+    }
+
+    uint32_t getId(const Buffer* buffer) noexcept
+    {
+        return buffer != nullptr ? static_cast<const CaptureBuffer*>(buffer)->getCaptureId() : NoObject;
+    }
+
+    Resource* unwrap(Resource* resource) noexcept
+    {
+        if (auto texture = dynamic_cast<CaptureTexture*>(resource))
+            return &texture->get();
+        if (auto buffer = dynamic_cast<CaptureBuffer*>(resource))
+            return &buffer->get();
+        return resource;
+    }
+
+    Texture* unwrap(Texture* texture) noexcept
+    {
+        return texture != nullptr ? &static_cast<CaptureTexture*>(texture)->get() : nullptr;
+    }
+
+    Buffer* unwrap(Buffer* buffer) noexcept
+    {
+        return buffer != nullptr ? &static_cast<CaptureBuffer*>(buffer)->get() : nullptr;
+    }
+}
+
+// Defined ahead of the objects, they all record through it
+template <typename Fields>
+void CaptureDevice::record(Op op, const Fields& fields)
+{
+    std::lock_guard lock(m_mutex);
+    if (m_finished)
+        return;
+
+    // Size of the fields after the op, readers can skip events they do not handle
+    write(m_stream, op);
+    auto sizeOffset = m_stream.size();
+    write(m_stream, uint32_t(0));
+    fields(m_stream);
+    auto size = static_cast<uint32_t>(m_stream.size() - sizeOffset - sizeof(uint32_t));
+    std::memcpy(m_stream.data() + sizeOffset, &size, sizeof(size));
+    ++m_eventCount;
+    if (m_stream.size() >= m_config.flushBytes)
+        flush(false);
+}
+
+// --------
+//  Objects
+// --------
+
+CaptureObject::~CaptureObject()
+{
+    m_captureDevice.record(Op::Destroy, [this](std::vector<uint8_t>& stream) { write(stream, m_captureId); });
+}
+
+CaptureTexture::CaptureTexture(CaptureDevice& device, uint32_t id, std::unique_ptr<Texture> texture, ResourceState initialState)
+    : Texture(initialState), CaptureObject(device, id), m_owned(std::move(texture)), m_texture(m_owned.get())
+{
+}
+
+CaptureTexture::CaptureTexture(CaptureDevice& device, uint32_t id, Texture& texture)
+    : Texture(texture.getSubmittedState()), CaptureObject(device, id), m_texture(&texture)
+{
+}
+
+CaptureBuffer::CaptureBuffer(CaptureDevice& device, uint32_t id, std::unique_ptr<Buffer> buffer, ResourceState initialState)
+    : Buffer(initialState), CaptureObject(device, id), m_buffer(std::move(buffer))
+{
+    m_captureDevice.addBuffer(*this);
+}
+
+CaptureBuffer::~CaptureBuffer()
+{
+    m_captureDevice.removeBuffer(*this);
+}
+
+void CaptureCommandAllocator::reset()
+{
+    m_allocator->reset();
+    m_captureDevice.record(Op::ResetAllocator, [this](std::vector<uint8_t>& stream) { write(stream, getCaptureId()); });
+}
+
+// -------------
+//  Command list
+// -------------
+
+void CaptureCommandList::reset(CommandAllocator& allocator)
+{
+    auto& captureAllocator = static_cast<CaptureCommandAllocator&>(allocator);
+    m_list->reset(captureAllocator.get());
+    m_commands.clear();
+    m_arguments.clear();
+    write(m_commands, Op::ResetList);
+    write(m_commands, captureAllocator.getCaptureId());
+}
+
+void CaptureCommandList::close()
+{
+    m_list->close();
+    write(m_commands, Op::CloseList);
+}
+
+void CaptureCommandList::setViewport(const Viewport& viewport)
+{
+    m_list->setViewport(viewport);
+    write(m_commands, Op::SetViewport);
+    write(m_commands, viewport);
+}
+
+void CaptureCommandList::setScissorRect(const Rect& rect)
+{
+    m_list->setScissorRect(rect);
+    write(m_commands, Op::SetScissorRect);
+    write(m_commands, rect);
+}
+
+void CaptureCommandList::resourceBarrier(const ResourceBarrier* barriers, uint32_t count)
+{
+    m_barriers.assign(barriers, barriers + count);
+    write(m_commands, Op::ResourceBarrier);
+    write(m_commands, count);
+    for (auto& barrier : m_barriers)
+    {
+        write(m_commands, getId(barrier.resource));
+        write(m_commands, barrier.before);
+        write(m_commands, barrier.after);
+        write(m_commands, barrier.flags);
+        barrier.resource = unwrap(barrier.resource);
+    }
+    m_list->resourceBarrier(m_barriers.data(), count);
+}
+
+void CaptureCommandList::aliasingBarrier(Resource* before, Resource* after)
+{
+    m_list->aliasingBarrier(unwrap(before), unwrap(after));
+    write(m_commands, Op::AliasingBarrier);
+    write(m_commands, getId(before));
+    write(m_commands, getId(after));
+}
+
+void CaptureCommandList::clearRenderTarget(Texture& target, const float color[4])
+{
+    m_list->clearRenderTarget(*unwrap(&target), color);
+    write(m_commands, Op::ClearRenderTarget);
+    write(m_commands, getId(&target));
+    for (uint32_t i = 0; i < 4; ++i)
+        write(m_commands, color[i]);
+}
+
+void CaptureCommandList::clearDepthStencil(Texture& target, float depth, uint8_t stencil)
+{
+    m_list->clearDepthStencil(*unwrap(&target), depth, stencil);
+    write(m_commands, Op::ClearDepthStencil);
+    write(m_commands, getId(&target));
+    write(m_commands, depth);
+    write(m_commands, stencil);
+}
+
+void CaptureCommandList::setRenderTargets(Texture* const* targets, uint32_t count, Texture* depthStencil)
+{
+    Texture* unwrapped[GraphicsPipelineDesc::MaxRenderTargets] = {};
+    count = std::min(count, GraphicsPipelineDesc::MaxRenderTargets);
+    write(m_commands, Op::SetRenderTargets);
+    write(m_commands, count);
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        write(m_commands, getId(targets[i]));
+        unwrapped[i] = unwrap(targets[i]);
+    }
+    write(m_commands, getId(depthStencil));
+    m_list->setRenderTargets(unwrapped, count, unwrap(depthStencil));
+}
+
+void CaptureCommandList::setGraphicsRootSignature(RootSignature& rootSignature)
+{
+    auto& captureRootSignature = static_cast<CaptureRootSignature&>(rootSignature);
+    m_list->setGraphicsRootSignature(captureRootSignature.get());
+    write(m_commands, Op::SetRootSignature);
+    write(m_commands, captureRootSignature.getCaptureId());
+}
+
+void CaptureCommandList::setPipelineState(PipelineState& pipeline)
+{
+    auto& capturePipeline = static_cast<CapturePipelineState&>(pipeline);
+    m_list->setPipelineState(capturePipeline.get());
+    write(m_commands, Op::SetPipelineState);
+    write(m_commands, capturePipeline.getCaptureId());
+}
+
+void CaptureCommandList::writeAddress(uint64_t gpuAddress)
+{
+    uint32_t buffer = NoObject;
+    uint64_t offset = 0;
+    m_captureDevice.resolveAddress(gpuAddress, buffer, offset);
+    write(m_commands, buffer);
+    write(m_commands, offset);
+}
+
+void CaptureCommandList::setGraphicsRootConstantBufferView(uint32_t parameter, uint64_t gpuAddress)
+{
+    m_list->setGraphicsRootConstantBufferView(parameter, gpuAddress);
+    write(m_commands, Op::SetRootConstantBuffer);
+    write(m_commands, parameter);
+    writeAddress(gpuAddress);
+}
+
+void CaptureCommandList::setGraphicsRootShaderResourceView(uint32_t parameter, uint64_t gpuAddress)
+{
+    m_list->setGraphicsRootShaderResourceView(parameter, gpuAddress);
+    write(m_commands, Op::SetRootShaderResource);
+    write(m_commands, parameter);
+    writeAddress(gpuAddress);
+}
+
+void CaptureCommandList::setVertexBuffers(uint32_t startSlot, const VertexBufferView* views, uint32_t count)
+{
+    m_views.assign(views, views + count);
+    write(m_commands, Op::SetVertexBuffers);
+    write(m_commands, startSlot);
+    write(m_commands, count);
+    for (auto& view : m_views)
+    {
+        write(m_commands, getId(view.buffer));
+        write(m_commands, view.offset);
+        write(m_commands, view.size);
+        write(m_commands, view.stride);
+        view.buffer = unwrap(view.buffer);
+    }
+    m_list->setVertexBuffers(startSlot, m_views.data(), count);
+}
+
+void CaptureCommandList::setIndexBuffer(const IndexBufferView& view)
+{
+    auto unwrapped = view;
+    unwrapped.buffer = unwrap(view.buffer);
+    m_list->setIndexBuffer(unwrapped);
+    write(m_commands, Op::SetIndexBuffer);
+    write(m_commands, getId(view.buffer));
+    write(m_commands, view.offset);
+    write(m_commands, view.size);
+    write(m_commands, view.format);
+}
+
+void CaptureCommandList::drawIndexedInstanced(uint32_t indexCount, uint32_t instanceCount, uint32_t startIndex, int32_t baseVertex, uint32_t startInstance)
+{
+    m_list->drawIndexedInstanced(indexCount, instanceCount, startIndex, baseVertex, startInstance);
+    write(m_commands, Op::DrawIndexedInstanced);
+    write(m_commands, indexCount);
+    write(m_commands, instanceCount);
+    write(m_commands, startIndex);
+    write(m_commands, baseVertex);
+    write(m_commands, startInstance);
+}
+
+void CaptureCommandList::executeIndirect(CommandSignature& signature, uint32_t maxCount, Buffer& arguments, uint64_t argumentOffset,
+                                         Buffer* countBuffer, uint64_t countOffset)
+{
+    auto& captureSignature = static_cast<CaptureCommandSignature&>(signature);
+    m_list->executeIndirect(captureSignature.get(), maxCount, *unwrap(&arguments), argumentOffset, unwrap(countBuffer), countOffset);
+    write(m_commands, Op::ExecuteIndirect);
+    write(m_commands, captureSignature.getCaptureId());
+    write(m_commands, maxCount);
+    write(m_commands, getId(&arguments));
+    write(m_commands, argumentOffset);
+    write(m_commands, getId(countBuffer));
+    write(m_commands, countOffset);
+
+    // Arguments decide how much a replay draws, ranges outside the buffer are left to the validation of the backend
+    auto addRange = [this](Buffer& buffer, uint64_t offset, uint64_t size)
+    {
+        auto bufferSize = buffer.getDesc().size;
+        if (buffer.getMappedData() != nullptr && offset < bufferSize)
+            m_arguments.push_back({ static_cast<CaptureBuffer*>(&buffer), offset, std::min(size, bufferSize - offset) });
+    };
+    addRange(arguments, argumentOffset, static_cast<uint64_t>(maxCount) * signature.getByteStride());
+    if (countBuffer != nullptr)
+        addRange(*countBuffer, countOffset, sizeof(uint32_t));
+}
+
+void CaptureCommandList::copyBufferRegion(Buffer& dest, uint64_t destOffset, Buffer& source, uint64_t sourceOffset, uint64_t size)
+{
+    m_list->copyBufferRegion(*unwrap(&dest), destOffset, *unwrap(&source), sourceOffset, size);
+    write(m_commands, Op::CopyBufferRegion);
+    write(m_commands, getId(&dest));
+    write(m_commands, destOffset);
+    write(m_commands, getId(&source));
+    write(m_commands, sourceOffset);
+    write(m_commands, size);
+}
+
+void CaptureCommandList::copyBufferToTexture(Texture& dest, Buffer& source, uint64_t sourceOffset, uint32_t rowPitch)
+{
+    m_list->copyBufferToTexture(*unwrap(&dest), *unwrap(&source), sourceOffset, rowPitch);
+    write(m_commands, Op::CopyBufferToTexture);
+    write(m_commands, getId(&dest));
+    write(m_commands, getId(&source));
+    write(m_commands, sourceOffset);
+    write(m_commands, rowPitch);
+}
+
+void CaptureCommandList::writeTimestamp(TimestampQueryHeap& heap, uint32_t index)
+{
+    auto& captureHeap = static_cast<CaptureTimestampQueryHeap&>(heap);
+    m_list->writeTimestamp(captureHeap.get(), index);
+    write(m_commands, Op::WriteTimestamp);
+    write(m_commands, captureHeap.getCaptureId());
+    write(m_commands, index);
+}
+
+void CaptureCommandList::resolveTimestamps(TimestampQueryHeap& heap, uint32_t first, uint32_t count, Buffer& dest, uint64_t destOffset)
+{
+    auto& captureHeap = static_cast<CaptureTimestampQueryHeap&>(heap);
+    m_list->resolveTimestamps(captureHeap.get(), first, count, *unwrap(&dest), destOffset);
+    write(m_commands, Op::ResolveTimestamps);
+    write(m_commands, captureHeap.getCaptureId());
+    write(m_commands, first);
+    write(m_commands, count);
+    write(m_commands, getId(&dest));
+    write(m_commands, destOffset);
+}
+
+// --------------
+//  Command queue
+// --------------
+
+void CaptureCommandQueue::executeCommandLists(CommandList* const* lists, uint32_t count)
+{
+    std::lock_guard lock(m_mutex);
+    m_device.record(Op::ExecuteLists, [this, lists, count](std::vector<uint8_t>& stream)
+    {
+        write(stream, m_type);
+        write(stream, count);
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            auto& list = *static_cast<CaptureCommandList*>(lists[i]);
+            write(stream, list.getCaptureId());
+            write(stream, static_cast<uint32_t>(list.m_arguments.size()));
+            for (auto& range : list.m_arguments)
+            {
+                write(stream, range.buffer->getCaptureId());
+                write(stream, range.offset);
+                writeBytes(stream, range.buffer->getMappedData() + range.offset, range.size);
+            }
+            writeBytes(stream, list.m_commands.data(), list.m_commands.size());
+        }
+    });
+
+    m_lists.resize(count);
+    for (uint32_t i = 0; i < count; ++i)
+        m_lists[i] = &static_cast<CaptureCommandList*>(lists[i])->get();
+    m_queue.executeCommandLists(m_lists.data(), count);
+}
+
+uint64_t CaptureCommandQueue::signal()
+{
+    std::lock_guard lock(m_mutex);
+    auto value = m_queue.signal();
+    m_device.record(Op::Signal, [this, value](std::vector<uint8_t>& stream)
+    {
+        write(stream, m_type);
+        write(stream, value);
+    });
+    return value;
+}
+
+void CaptureCommandQueue::waitForValue(uint64_t value)
+{
+    m_device.record(Op::WaitForValue, [this, value](std::vector<uint8_t>& stream)
+    {
+        write(stream, m_type);
+        write(stream, value);
+    });
+    m_queue.waitForValue(value);
+}
+
+void CaptureCommandQueue::wait(CommandQueue& other, uint64_t value)
+{
+    auto& captureOther = static_cast<CaptureCommandQueue&>(other);
+    std::lock_guard lock(m_mutex);
+    m_queue.wait(captureOther.get(), value);
+    m_device.record(Op::QueueWait, [this, &captureOther, value](std::vector<uint8_t>& stream)
+    {
+        write(stream, m_type);
+        write(stream, captureOther.m_type);
+        write(stream, value);
+    });
+}
+
+// -----------
+//  Swap chain
+// -----------
+
+CaptureSwapChain::CaptureSwapChain(CaptureDevice& device, uint32_t id, std::unique_ptr<SwapChain> swapChain)
+    : CaptureObject(device, id), m_swapChain(std::move(swapChain))
+{
+    wrapBuffers();
+}
+
+void CaptureSwapChain::wrapBuffers()
+{
+    m_buffers.clear();
+    for (uint32_t i = 0; i < m_swapChain->getBufferCount(); ++i)
+        m_buffers.push_back(std::make_unique<CaptureTexture>(m_captureDevice, m_captureDevice.allocateId(), m_swapChain->getBackBuffer(i)));
+}
+
+void CaptureSwapChain::present(uint32_t syncInterval)
+{
+    m_swapChain->present(syncInterval);
+    auto ticks = Timer::now();
+    m_captureDevice.record(Op::Present, [this, syncInterval, ticks](std::vector<uint8_t>& stream)
+    {
+        write(stream, getCaptureId());
+        write(stream, syncInterval);
+        write(stream, ticks);
+        ++m_captureDevice.m_frameCount;
+    });
+}
+
+void CaptureSwapChain::resize(uint32_t width, uint32_t height)
+{
+    m_swapChain->resize(width, height);
+    wrapBuffers();
+    m_captureDevice.record(Op::ResizeSwapChain, [this, width, height](std::vector<uint8_t>& stream)
+    {
+        write(stream, getCaptureId());
+        write(stream, width);
+        write(stream, height);
+        write(stream, static_cast<uint32_t>(m_buffers.size()));
+        for (auto& buffer : m_buffers)
+            write(stream, buffer->getCaptureId());
+    });
+}
+
+void CaptureSwapChain::setSourceSize(uint32_t width, uint32_t height)
+{
+    m_swapChain->setSourceSize(width, height);
+    m_captureDevice.record(Op::SetSourceSize, [this, width, height](std::vector<uint8_t>& stream)
+    {
+        write(stream, getCaptureId());
+        write(stream, width);
+        write(stream, height);
+    });
+}
+
+void CaptureSwapChain::waitForFrameLatency()
+{
+    m_captureDevice.record(Op::WaitForFrameLatency, [this](std::vector<uint8_t>& stream) { write(stream, getCaptureId()); });
+    m_swapChain->waitForFrameLatency();
+}
+
+// -------
+//  Device
+// -------
+
+CaptureDevice::CaptureDevice(Device& device, const std::string& path, const Config& config)
+    : m_device(device), m_config(config)
+{
+    m_file.open(path, std::ios::binary | std::ios::trunc);
+    if (!m_file)
+        throw std::runtime_error("Cannot create capture file " + path);
+
+    // Written again by finish() once sizes and checksum are known
+    Header header = {};
+    m_file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    m_queue     = std::make_unique<CaptureCommandQueue>(*this, device.getQueue(), QueueType::Direct);
+    m_copyQueue = std::make_unique<CaptureCommandQueue>(*this, device.getCopyQueue(), QueueType::Copy);
+}
+
+CaptureDevice::~CaptureDevice()
+{
+    finish();
+}
+
+void CaptureDevice::flush(bool all)
+{
+    PROFILE_SCOPE("CaptureDevice::flush");
+
+    // Hasher only depends on the bytes when every add() but the last is a multiple of 8 bytes,
+    // so a reader hashes the whole stream at once
+    auto size = all ? m_stream.size() : m_stream.size() / 8 * 8;
+    m_hasher.add(m_stream.data(), size);
+    if (!m_file.write(reinterpret_cast<const char*>(m_stream.data()), static_cast<std::streamsize>(size)))
+        m_failed = true;
+    m_written += size;
+    m_stream.erase(m_stream.begin(), m_stream.begin() + static_cast<std::ptrdiff_t>(size));
+}
+
+bool CaptureDevice::finish()
+{
+    std::lock_guard lock(m_mutex);
+    if (m_finished)
+        return !m_failed;
+    flush(true);
+    m_finished = true;
+
+    Header header         = {};
+    header.magic          = Magic;
+    header.version        = Version;
+    header.frameCount     = m_frameCount;
+    header.objectCount    = m_nextId.load(std::memory_order_relaxed) - 1;
+    header.eventCount     = m_eventCount;
+    header.streamSize     = m_written;
+    header.secondsPerTick = Timer::getSecondsPerCount();
+
+    auto hasher = m_hasher;
+    hasher.addValue(header);
+    header.checksum = hasher.finish();
+
+    m_file.seekp(0);
+    if (!m_file.write(reinterpret_cast<const char*>(&header), sizeof(header)))
+        m_failed = true;
+    m_file.close();
+    return !m_failed && !m_file.fail();
+}
+
+CaptureDevice::Stats CaptureDevice::getStats() const
+{
+    std::lock_guard lock(m_mutex);
+    Stats stats;
+    stats.frames  = m_frameCount;
+    stats.objects = m_nextId.load(std::memory_order_relaxed) - 1;
+    stats.events  = m_eventCount;
+    stats.bytes   = m_written + m_stream.size();
+    return stats;
+}
+
+void CaptureDevice::resolveAddress(uint64_t gpuAddress, uint32_t& buffer, uint64_t& offset) const
+{
+    std::shared_lock lock(m_addressMutex);
+    auto it = m_addresses.upper_bound(gpuAddress);
+    if (it != m_addresses.begin())
+    {
+        --it;
+        auto& captureBuffer = *it->second;
+        if (gpuAddress - it->first < captureBuffer.getDesc().size)
+        {
+            buffer = captureBuffer.getCaptureId();
+            offset = gpuAddress - it->first;
+            return;
+        }
+    }
+    buffer = NoObject;
+    offset = gpuAddress;
+}
+
+void CaptureDevice::addBuffer(CaptureBuffer& buffer)
+{
+    std::unique_lock lock(m_addressMutex);
+    m_addresses[buffer.getGpuAddress()] = &buffer;
+}
+
+void CaptureDevice::removeBuffer(CaptureBuffer& buffer)
+{
+    std::unique_lock lock(m_addressMutex);
+    auto it = m_addresses.find(buffer.getGpuAddress());
+    if (it != m_addresses.end() && it->second == &buffer)
+        m_addresses.erase(it);
+}
+
+std::unique_ptr<CommandAllocator> CaptureDevice::createCommandAllocator(QueueType type)
+{
+    auto id        = allocateId();
+    auto allocator = std::make_unique<CaptureCommandAllocator>(*this, id, m_device.createCommandAllocator(type));
+    record(Op::CreateCommandAllocator, [id, type](std::vector<uint8_t>& stream)
+    {
+        write(stream, id);
+        write(stream, type);
+    });
+    return allocator;
+}
+
+std::unique_ptr<CommandList> CaptureDevice::createCommandList(QueueType type)
+{
+    auto id   = allocateId();
+    auto list = std::make_unique<CaptureCommandList>(*this, id, m_device.createCommandList(type));
+    record(Op::CreateCommandList, [id, type](std::vector<uint8_t>& stream)
+    {
+        write(stream, id);
+        write(stream, type);
+    });
+    return list;
+}
+
+std::unique_ptr<SwapChain> CaptureDevice::createSwapChain(const SwapChainDesc& desc)
+{
+    auto id        = allocateId();
+    auto swapChain = std::make_unique<CaptureSwapChain>(*this, id, m_device.createSwapChain(desc));
+    record(Op::CreateSwapChain, [id, &desc, &swapChain](std::vector<uint8_t>& stream)
+    {
+        write(stream, id);
+        writeDesc(stream, desc);
+        write(stream, static_cast<uint32_t>(swapChain->m_buffers.size()));
+        for (auto& buffer : swapChain->m_buffers)
+            write(stream, buffer->getCaptureId());
+    });
+    return swapChain;
+}
+
+std::unique_ptr<Texture> CaptureDevice::createTexture(const TextureDesc& desc, ResourceState initialState)
+{
+    auto texture = m_device.createTexture(desc, initialState);
+    if (!texture)
+        return nullptr;
+
+    auto id = allocateId();
+    record(Op::CreateTexture, [id, &desc, initialState](std::vector<uint8_t>& stream)
+    {
+        write(stream, id);
+        writeDesc(stream, desc);
+        write(stream, initialState);
+    });
+    return std::make_unique<CaptureTexture>(*this, id, std::move(texture), initialState);
+}
+
+std::unique_ptr<Buffer> CaptureDevice::createBuffer(const BufferDesc& desc, ResourceState initialState)
+{
+    auto buffer = m_device.createBuffer(desc, initialState);
+    if (!buffer)
+        return nullptr;
+
+    auto id = allocateId();
+    record(Op::CreateBuffer, [id, &desc, initialState](std::vector<uint8_t>& stream)
+    {
+        write(stream, id);
+        writeDesc(stream, desc);
+        write(stream, initialState);
+    });
+    return std::make_unique<CaptureBuffer>(*this, id, std::move(buffer), initialState);
+}
+
+std::unique_ptr<Heap> CaptureDevice::createHeap(const HeapDesc& desc)
+{
+    auto heap = m_device.createHeap(desc);
+    if (!heap)
+        return nullptr;
+
+    auto id = allocateId();
+    record(Op::CreateHeap, [id, &desc](std::vector<uint8_t>& stream)
+    {
+        write(stream, id);
+        writeDesc(stream, desc);
+    });
+    return std::make_unique<CaptureHeap>(*this, id, std::move(heap));
+}
+
+std::unique_ptr<TimestampQueryHeap> CaptureDevice::createTimestampQueryHeap(uint32_t count)
+{
+    auto heap = m_device.createTimestampQueryHeap(count);
+    if (!heap)
+        return nullptr;
+
+    auto id = allocateId();
+    record(Op::CreateQueryHeap, [id, count](std::vector<uint8_t>& stream)
+    {
+        write(stream, id);
+        write(stream, count);
+    });
+    return std::make_unique<CaptureTimestampQueryHeap>(*this, id, std::move(heap));
+}
+
+std::unique_ptr<CommandSignature> CaptureDevice::createCommandSignature(uint32_t byteStride)
+{
+    auto signature = m_device.createCommandSignature(byteStride);
+    if (!signature)
+        return nullptr;
+
+    auto id = allocateId();
+    record(Op::CreateCommandSignature, [id, byteStride](std::vector<uint8_t>& stream)
+    {
+        write(stream, id);
+        write(stream, byteStride);
+    });
+    return std::make_unique<CaptureCommandSignature>(*this, id, std::move(signature));
+}
+
+std::unique_ptr<Texture> CaptureDevice::createPlacedTexture(Heap& heap, uint64_t offset, const TextureDesc& desc, ResourceState initialState)
+{
+    auto& captureHeap = static_cast<CaptureHeap&>(heap);
+    auto  texture     = m_device.createPlacedTexture(captureHeap.get(), offset, desc, initialState);
+    if (!texture)
+        return nullptr;
+
+    auto id = allocateId();
+    record(Op::CreatePlacedTexture, [id, &captureHeap, offset, &desc, initialState](std::vector<uint8_t>& stream)
+    {
+        write(stream, id);
+        write(stream, captureHeap.getCaptureId());
+        write(stream, offset);
+        writeDesc(stream, desc);
+        write(stream, initialState);
+    });
+    return std::make_unique<CaptureTexture>(*this, id, std::move(texture), initialState);
+}
+
+std::unique_ptr<Buffer> CaptureDevice::createPlacedBuffer(Heap& heap, uint64_t offset, const BufferDesc& desc, ResourceState initialState)
+{
+    auto& captureHeap = static_cast<CaptureHeap&>(heap);
+    auto  buffer      = m_device.createPlacedBuffer(captureHeap.get(), offset, desc, initialState);
+    if (!buffer)
+        return nullptr;
+
+    auto id = allocateId();
+    record(Op::CreatePlacedBuffer, [id, &captureHeap, offset, &desc, initialState](std::vector<uint8_t>& stream)
+    {
+        write(stream, id);
+        write(stream, captureHeap.getCaptureId());
+        write(stream, offset);
+        writeDesc(stream, desc);
+        write(stream, initialState);
+    });
+    return std::make_unique<CaptureBuffer>(*this, id, std::move(buffer), initialState);
+}
+
+std::unique_ptr<RootSignature> CaptureDevice::createRootSignature(const RootSignatureDesc& desc)
+{
+    auto rootSignature = m_device.createRootSignature(desc);
+    if (!rootSignature)
+        return nullptr;
+
+    auto id = allocateId();
+    record(Op::CreateRootSignature, [id, &desc](std::vector<uint8_t>& stream)
+    {
+        write(stream, id);
+        writeDesc(stream, desc);
+    });
+    return std::make_unique<CaptureRootSignature>(*this, id, std::move(rootSignature));
+}
+
+std::unique_ptr<PipelineState> CaptureDevice::createGraphicsPipeline(const GraphicsPipelineDesc& desc, const std::vector<uint8_t>* cachedBlob)
+{
+    // Cached blobs belong to the driver of this run and are not captured, a replay compiles in full
+    auto captureRootSignature = static_cast<CaptureRootSignature*>(desc.rootSignature);
+    auto innerDesc            = desc;
+    innerDesc.rootSignature   = captureRootSignature != nullptr ? &captureRootSignature->get() : nullptr;
+    auto pipeline = m_device.createGraphicsPipeline(innerDesc, cachedBlob);
+    if (!pipeline)
+        return nullptr;
+
+    auto id = allocateId();
+    record(Op::CreatePipeline, [id, &desc, captureRootSignature](std::vector<uint8_t>& stream)
+    {
+        write(stream, id);
+        writeDesc(stream, desc, captureRootSignature != nullptr ? captureRootSignature->getCaptureId() : NoObject);
+    });
+    return std::make_unique<CapturePipelineState>(*this, id, std::move(pipeline));
+}
@@ -0,0 +1,911 @@
+#include "CaptureReplayer.hpp"
+#include "Hash.hpp"
+#include "Timer.hpp"
+#include "Profiler.hpp"
+
+#include <cstring>
+#include <algorithm>
+
+using namespace GalgameEngine;
+using namespace GalgameEngine::CaptureFormat;
+
+namespace GalgameEngine
+{
+    // Bounds checked reads of a stream, a read past the end gives zero and fails the reader, callers check once per event
+    class CaptureReader
+    {
+    public:
+        CaptureReader(const uint8_t* data, uint64_t size) noexcept : m_data(data), m_size(size) {}
+
+        template <typename T>
+        T read() noexcept
+        {
+            T value = {};
+            if (m_size - m_offset < sizeof(value))
+            {
+                fail();
+                return value;
+            }
+            std::memcpy(&value, m_data + m_offset, sizeof(value));
+            m_offset += sizeof(value);
+            return value;
+        }
+
+        bool readBool() noexcept { return read<uint8_t>() != 0; }
+
+        // Bytes after their uint64 count, in place
+        const uint8_t* readBytes(uint64_t& size) noexcept
+        {
+            size = read<uint64_t>();
+            return skip(size);
+        }
+
+        std::string readString()
+        {
+            auto size = read<uint32_t>();
+            auto data = skip(size);
+            return data != nullptr ? std::string(reinterpret_cast<const char*>(data), size) : std::string();
+        }
+
+        // Reader of the next size bytes, which this one skips
+        CaptureReader readReader(uint64_t size) noexcept
+        {
+            auto data = skip(size);
+            return data != nullptr ? CaptureReader(data, size) : CaptureReader(nullptr, 0);
+        }
+
+        bool isEnd() const noexcept { return m_offset == m_size; }
+        bool isValid() const noexcept { return !m_failed; }
+
+    private:
+        const uint8_t* skip(uint64_t size) noexcept
+        {
+            if (m_size - m_offset < size)
+            {
+                fail();
+                return nullptr;
+            }
+            auto data = m_data + m_offset;
+            m_offset += size;
+            return data;
+        }
+
+        void fail() noexcept
+        {
+            m_failed = true;
+            m_offset = m_size;
+        }
+
+    private:
+        const uint8_t* m_data;
+        uint64_t       m_size;
+        uint64_t       m_offset = 0;
+        bool           m_failed = false;
+    };
+}
+
+namespace
+{
+    // Same fields as CaptureDevice writes them
+    TextureDesc readTextureDesc(CaptureReader& reader) noexcept
+    {
+        TextureDesc desc;
+        desc.width      = reader.read<uint32_t>();
+        desc.height     = reader.read<uint32_t>();
+        desc.format     = reader.read<Format>();
+        desc.usage      = reader.read<TextureUsage>();
+        for (auto& color : desc.clearValue.color)
+            color = reader.read<float>();
+        desc.clearValue.depth   = reader.read<float>();
+        desc.clearValue.stencil = reader.read<uint8_t>();
+        return desc;
+    }
+
+    BufferDesc readBufferDesc(CaptureReader& reader) noexcept
+    {
+        BufferDesc desc;
+        desc.size     = reader.read<uint64_t>();
+        desc.heapType = reader.read<HeapType>();
+        return desc;
+    }
+
+    HeapDesc readHeapDesc(CaptureReader& reader) noexcept
+    {
+        HeapDesc desc;
+        desc.size  = reader.read<uint64_t>();
+        desc.type  = reader.read<HeapType>();
+        desc.usage = reader.read<HeapUsage>();
+        return desc;
+    }
+
+    RootSignatureDesc readRootSignatureDesc(CaptureReader& reader)
+    {
+        RootSignatureDesc desc;
+        auto count = reader.read<uint32_t>();
+        for (uint32_t i = 0; i < count && reader.isValid(); ++i)
+        {
+            RootParameter parameter;
+            parameter.type           = reader.read<RootParameterType>();
+            parameter.visibility     = reader.read<ShaderVisibility>();
+            parameter.rangeType      = reader.read<DescriptorRangeType>();
+            parameter.shaderRegister = reader.read<uint32_t>();
+            parameter.registerSpace  = reader.read<uint32_t>();
+            parameter.count          = reader.read<uint32_t>();
+            desc.parameters.push_back(parameter);
+        }
+        desc.allowInputLayout = reader.readBool();
+        return desc;
+    }
+
+    // Root signature id first, the caller looks it up
+    GraphicsPipelineDesc readPipelineDesc(CaptureReader& reader)
+    {
+        GraphicsPipelineDesc desc;
+        uint64_t size = 0;
+        auto     data = reader.readBytes(size);
+        if (data != nullptr)
+            desc.vertexShader.assign(data, data + size);
+        data = reader.readBytes(size);
+        if (data != nullptr)
+            desc.pixelShader.assign(data, data + size);
+
+        auto count = reader.read<uint32_t>();
+        for (uint32_t i = 0; i < count && reader.isValid(); ++i)
+        {
+            InputElement element;
+            element.semantic      = reader.readString();
+            element.semanticIndex = reader.read<uint32_t>();
+            element.format        = reader.read<Format>();
+            element.slot          = reader.read<uint32_t>();
+            element.offset        = reader.read<uint32_t>();
+            element.perInstance   = reader.readBool();
+            desc.inputLayout.push_back(std::move(element));
+        }
+        desc.topology          = reader.read<PrimitiveTopology>();
+        desc.cullMode          = reader.read<CullMode>();
+        desc.wireframe         = reader.readBool();
+        desc.blendMode         = reader.read<BlendMode>();
+        desc.depthTest         = reader.readBool();
+        desc.depthWrite        = reader.readBool();
+        desc.depthFunc         = reader.read<CompareFunc>();
+        desc.renderTargetCount = reader.read<uint32_t>();
+        for (auto& format : desc.renderTargetFormats)
+            format = reader.read<Format>();
+        desc.depthStencilFormat = reader.read<Format>();
+        return desc;
+    }
+
+    SwapChainDesc readSwapChainDesc(CaptureReader& reader) noexcept
+    {
+        SwapChainDesc desc;
+        desc.width           = reader.read<uint32_t>();
+        desc.height          = reader.read<uint32_t>();
+        desc.format          = reader.read<Format>();
+        desc.bufferCount     = reader.read<uint32_t>();
+        desc.maxFrameLatency = reader.read<uint32_t>();
+        return desc;
+    }
+
+    // Queue types index the per queue state
+    bool readQueue(CaptureReader& reader, uint32_t& queue) noexcept
+    {
+        queue = static_cast<uint32_t>(reader.read<QueueType>());
+        return queue <= static_cast<uint32_t>(QueueType::Copy);
+    }
+}
+
+CaptureReplayer::CaptureReplayer(Device& device, const Config& config)
+    : m_device(device), m_config(config)
+{
+}
+
+CaptureReplayer::~CaptureReplayer()
+{
+    close();
+}
+
+bool CaptureReplayer::open(const std::string& path)
+{
+    PROFILE_SCOPE("CaptureReplayer::open");
+
+    close();
+    if (!m_file.open(path) || m_file.getSize() < sizeof(Header))
+    {
+        m_file.close();
+        return false;
+    }
+
+    auto data   = m_file.getData();
+    auto header = *reinterpret_cast<const Header*>(data);
+    if (header.magic != Magic || header.version != Version || header.streamSize != m_file.getSize() - sizeof(Header))
+    {
+        m_file.close();
+        return false;
+    }
+
+    auto checksum = header.checksum;
+    header.checksum = 0;
+    Hasher hasher;
+    hasher.add(data + sizeof(Header), header.streamSize);
+    hasher.addValue(header);
+    if (hasher.finish() != checksum)
+    {
+        m_file.close();
+        return false;
+    }
+
+    m_header = reinterpret_cast<const Header*>(data);
+    return true;
+}
+
+void CaptureReplayer::close() noexcept
+{
+    m_file.close();
+    m_header = nullptr;
+}
+
+bool CaptureReplayer::replay()
+{
+    PROFILE_SCOPE("CaptureReplayer::replay");
+
+    m_stats = {};
+    m_frameTimes.clear();
+    m_capturedFrameTimes.clear();
+    m_objects.assign(static_cast<size_t>(m_header->objectCount) + 1, {});
+    for (uint32_t queue = 0; queue < 2; ++queue)
+    {
+        m_signals[queue].clear();
+        m_pending[queue] = NoSignal;
+    }
+
+    bool valid = !m_config.createPipelinesFirst || createPipelines();
+
+    auto begin    = Timer::now();
+    m_lastPresent = begin;
+    CaptureReader reader(m_file.getData() + sizeof(Header), m_header->streamSize);
+    while (valid && !reader.isEnd())
+    {
+        auto op     = reader.read<Op>();
+        auto size   = reader.read<uint32_t>();
+        auto fields = reader.readReader(size);
+        valid = reader.isValid() && replayEvent(op, fields) && fields.isValid();
+        ++m_stats.events;
+    }
+    m_stats.seconds = (Timer::now() - begin) * Timer::getSecondsPerCount();
+
+    // Whatever the capture left alive, placed resources go before their heaps
+    getQueue(0).flush();
+    getQueue(1).flush();
+    releaseCompleted(true);
+    for (size_t id = m_objects.size(); id-- > 0;)
+        m_objects[id] = {};
+    m_objects.clear();
+    return valid;
+}
+
+bool CaptureReplayer::createPipelines()
+{
+    PROFILE_SCOPE("CaptureReplayer::createPipelines");
+
+    CaptureReader reader(m_file.getData() + sizeof(Header), m_header->streamSize);
+    while (!reader.isEnd())
+    {
+        auto op     = reader.read<Op>();
+        auto size   = reader.read<uint32_t>();
+        auto fields = reader.readReader(size);
+        if (!reader.isValid())
+            return false;
+        if ((op == Op::CreateRootSignature || op == Op::CreatePipeline) && (!replayEvent(op, fields) || !fields.isValid()))
+            return false;
+    }
+    return true;
+}
+
+// -------
+//  Events
+// -------
+
+bool CaptureReplayer::replayEvent(Op op, CaptureReader& reader)
+{
+    switch (op)
+    {
+    case Op::CreateTexture:
+    {
+        auto id    = reader.read<uint32_t>();
+        auto desc  = readTextureDesc(reader);
+        auto state = reader.read<ResourceState>();
+        return reader.isValid() && add(id, ObjectType::Texture, m_device.createTexture(desc, state));
+    }
+    case Op::CreateBuffer:
+    {
+        auto id    = reader.read<uint32_t>();
+        auto desc  = readBufferDesc(reader);
+        auto state = reader.read<ResourceState>();
+        return reader.isValid() && add(id, ObjectType::Buffer, m_device.createBuffer(desc, state));
+    }
+    case Op::CreateHeap:
+    {
+        auto id   = reader.read<uint32_t>();
+        auto desc = readHeapDesc(reader);
+        return reader.isValid() && add(id, ObjectType::Heap, m_device.createHeap(desc));
+    }
+    case Op::CreatePlacedTexture:
+    {
+        auto id     = reader.read<uint32_t>();
+        auto heap   = get<Heap>(reader.read<uint32_t>(), ObjectType::Heap);
+        auto offset = reader.read<uint64_t>();
+        auto desc   = readTextureDesc(reader);
+        auto state  = reader.read<ResourceState>();
+        return reader.isValid() && heap != nullptr && add(id, ObjectType::Texture, m_device.createPlacedTexture(*heap, offset, desc, state));
+    }
+    case Op::CreatePlacedBuffer:
+    {
+        auto id     = reader.read<uint32_t>();
+        auto heap   = get<Heap>(reader.read<uint32_t>(), ObjectType::Heap);
+        auto offset = reader.read<uint64_t>();
+        auto desc   = readBufferDesc(reader);
+        auto state  = reader.read<ResourceState>();
+        return reader.isValid() && heap != nullptr && add(id, ObjectType::Buffer, m_device.createPlacedBuffer(*heap, offset, desc, state));
+    }
+    case Op::CreateRootSignature:
+    {
+        // Created up front unless createPipelinesFirst is off
+        auto id = reader.read<uint32_t>();
+        if (id < m_objects.size() && m_objects[id].type != ObjectType::None)
+            return true;
+        auto desc = readRootSignatureDesc(reader);
+        return reader.isValid() && add(id, ObjectType::RootSignature, m_device.createRootSignature(desc));
+    }
+    case Op::CreatePipeline:
+    {
+        auto id = reader.read<uint32_t>();
+        if (id < m_objects.size() && m_objects[id].type != ObjectType::None)
+            return true;
+        auto rootSignature = get<RootSignature>(reader.read<uint32_t>(), ObjectType::RootSignature);
+        auto desc          = readPipelineDesc(reader);
+        desc.rootSignature = rootSignature;
+        return reader.isValid() && add(id, ObjectType::Pipeline, m_device.createGraphicsPipeline(desc, nullptr));
+    }
+    case Op::CreateCommandSignature:
+    {
+        auto id     = reader.read<uint32_t>();
+        auto stride = reader.read<uint32_t>();
+        return reader.isValid() && add(id, ObjectType::CommandSignature, m_device.createCommandSignature(stride));
+    }
+    case Op::CreateQueryHeap:
+    {
+        auto id    = reader.read<uint32_t>();
+        auto count = reader.read<uint32_t>();
+        return reader.isValid() && add(id, ObjectType::QueryHeap, m_device.createTimestampQueryHeap(count));
+    }
+    case Op::CreateCommandAllocator:
+    {
+        auto id   = reader.read<uint32_t>();
+        auto type = reader.read<QueueType>();
+        return reader.isValid() && add(id, ObjectType::CommandAllocator, m_device.createCommandAllocator(type));
+    }
+    case Op::CreateCommandList:
+    {
+        auto id   = reader.read<uint32_t>();
+        auto type = reader.read<QueueType>();
+        return reader.isValid() && add(id, ObjectType::CommandList, m_device.createCommandList(type));
+    }
+    case Op::CreateSwapChain:
+    {
+        auto id   = reader.read<uint32_t>();
+        auto desc = readSwapChainDesc(reader);
+        desc.window = m_config.window;
+        return reader.isValid() && add(id, ObjectType::SwapChain, m_device.createSwapChain(desc)) && addBackBuffers(id, reader);
+    }
+    case Op::Destroy:
+        release(reader.read<uint32_t>());
+        return true;
+    case Op::ResetAllocator:
+    {
+        // The capture reset it after its own fence wait, the replayed GPU may still be behind
+        auto id        = reader.read<uint32_t>();
+        auto allocator = get<CommandAllocator>(id, ObjectType::CommandAllocator);
+        if (allocator == nullptr)
+            return false;
+        waitForSignal(m_objects[id].queue, m_objects[id].signal);
+        allocator->reset();
+        return true;
+    }
+    case Op::ExecuteLists:
+        return replayLists(reader);
+    case Op::Signal:
+    {
+        uint32_t queue    = 0;
+        bool     valid    = readQueue(reader, queue);
+        auto     captured = reader.read<uint64_t>();
+        if (!valid || !reader.isValid())
+            return false;
+        m_signals[queue].push_back({ captured, getQueue(queue).signal() });
+        releaseCompleted(false);
+        return true;
+    }
+    case Op::WaitForValue:
+    {
+        uint32_t queue = 0;
+        bool     valid = readQueue(reader, queue);
+        auto     value = mapFence(queue, reader.read<uint64_t>());
+        if (!valid || !reader.isValid())
+            return false;
+        if (value > 0)
+            getQueue(queue).waitForValue(value);
+        return true;
+    }
+    case Op::QueueWait:
+    {
+        uint32_t queue = 0;
+        uint32_t other = 0;
+        bool     valid = readQueue(reader, queue) && readQueue(reader, other);
+        auto     value = valid ? mapFence(other, reader.read<uint64_t>()) : 0;
+        if (!valid || !reader.isValid())
+            return false;
+        if (value > 0)
+            getQueue(queue).wait(getQueue(other), value);
+        return true;
+    }
+    case Op::Present:
+    {
+        auto swapChain    = get<SwapChain>(reader.read<uint32_t>(), ObjectType::SwapChain);
+        auto syncInterval = reader.read<uint32_t>();
+        auto ticks        = reader.read<int64_t>();
+        if (swapChain == nullptr || !reader.isValid())
+            return false;
+        swapChain->present(syncInterval);
+
+        // Time to the first present is setup, frames are counted from there
+        auto now = Timer::now();
+        if (m_stats.frames > 0)
+        {
+            m_frameTimes.push_back((now - m_lastPresent) * Timer::getSecondsPerCount());
+            m_capturedFrameTimes.push_back((ticks - m_lastCapturedPresent) * m_header->secondsPerTick);
+        }
+        m_lastPresent         = now;
+        m_lastCapturedPresent = ticks;
+        ++m_stats.frames;
+        releaseCompleted(false);
+        return true;
+    }
+    case Op::ResizeSwapChain:
+    {
+        auto id        = reader.read<uint32_t>();
+        auto swapChain = get<SwapChain>(id, ObjectType::SwapChain);
+        auto width     = reader.read<uint32_t>();
+        auto height    = reader.read<uint32_t>();
+        if (swapChain == nullptr || !reader.isValid())
+            return false;
+        swapChain->resize(width, height);
+        return addBackBuffers(id, reader);
+    }
+    case Op::SetSourceSize:
+    {
+        auto swapChain = get<SwapChain>(reader.read<uint32_t>(), ObjectType::SwapChain);
+        auto width     = reader.read<uint32_t>();
+        auto height    = reader.read<uint32_t>();
+        if (swapChain == nullptr || !reader.isValid())
+            return false;
+        swapChain->setSourceSize(width, height);
+        return true;
+    }
+    case Op::WaitForFrameLatency:
+    {
+        auto swapChain = get<SwapChain>(reader.read<uint32_t>(), ObjectType::SwapChain);
+        if (swapChain == nullptr)
+            return false;
+        swapChain->waitForFrameLatency();
+        return true;
+    }
+    default:
+        // Events of a newer version, their size lets them be skipped
+        return true;
+    }
+}
+
+bool CaptureReplayer::replayLists(CaptureReader& reader)
+{
+    uint32_t queue = 0;
+    bool     valid = readQueue(reader, queue);
+    auto     count = reader.read<uint32_t>();
+    if (!valid || !reader.isValid())
+        return false;
+
+    m_lists.clear();
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        auto list = get<CommandList>(reader.read<uint32_t>(), ObjectType::CommandList);
+        if (list == nullptr)
+            return false;
+
+        // Indirect arguments as they were when the capture executed the list
+        auto argumentCount = reader.read<uint32_t>();
+        for (uint32_t argument = 0; argument < argumentCount; ++argument)
+        {
+            auto     buffer = get<Buffer>(reader.read<uint32_t>(), ObjectType::Buffer);
+            auto     offset = reader.read<uint64_t>();
+            uint64_t size   = 0;
+            auto     data   = reader.readBytes(size);
+            if (buffer == nullptr || data == nullptr)
+                return false;
+            if (buffer->getMappedData() != nullptr && offset <= buffer->getDesc().size && size <= buffer->getDesc().size - offset)
+                std::memcpy(buffer->getMappedData() + offset, data, size);
+        }
+
+        uint64_t size     = 0;
+        auto     commands = reader.readBytes(size);
+        if (commands == nullptr)
+            return false;
+        CaptureReader commandReader(commands, size);
+        while (!commandReader.isEnd())
+        {
+            auto op = commandReader.read<Op>();
+            if (!replayCommand(op, commandReader, *list, queue) || !commandReader.isValid())
+                return false;
+            ++m_stats.commands;
+        }
+        m_lists.push_back(list);
+    }
+
+    getQueue(queue).executeCommandLists(m_lists.data(), count);
+    m_pending[queue] = m_signals[queue].size();
+    m_stats.lists   += count;
+    return true;
+}
+
+bool CaptureReplayer::replayCommand(Op op, CaptureReader& reader, CommandList& list, uint32_t queue)
+{
+    switch (op)
+    {
+    case Op::ResetList:
+    {
+        auto id        = reader.read<uint32_t>();
+        auto allocator = get<CommandAllocator>(id, ObjectType::CommandAllocator);
+        if (allocator == nullptr)
+            return false;
+        // The next signal of the queue covers this execution
+        m_objects[id].queue  = queue;
+        m_objects[id].signal = m_signals[queue].size();
+        list.reset(*allocator);
+        return true;
+    }
+    case Op::CloseList:
+        list.close();
+        return true;
+    case Op::SetViewport:
+        list.setViewport(reader.read<Viewport>());
+        return true;
+    case Op::SetScissorRect:
+        list.setScissorRect(reader.read<Rect>());
+        return true;
+    case Op::ResourceBarrier:
+    {
+        auto count = reader.read<uint32_t>();
+        m_barriers.clear();
+        for (uint32_t i = 0; i < count && reader.isValid(); ++i)
+        {
+            ResourceBarrier barrier;
+            barrier.resource = getResource(reader.read<uint32_t>());
+            barrier.before   = reader.read<ResourceState>();
+            barrier.after    = reader.read<ResourceState>();
+            barrier.flags    = reader.read<BarrierFlags>();
+            if (barrier.resource == nullptr)
+                return false;
+            m_barriers.push_back(barrier);
+        }
+        if (!reader.isValid())
+            return false;
+        list.resourceBarrier(m_barriers.data(), count);
+        return true;
+    }
+    case Op::AliasingBarrier:
+    {
+        auto beforeId = reader.read<uint32_t>();
+        auto before   = getResource(beforeId);
+        auto after    = getResource(reader.read<uint32_t>());
+        if ((before == nullptr && beforeId != NoObject) || after == nullptr)
+            return false;
+        list.aliasingBarrier(before, after);
+        return true;
+    }
+    case Op::ClearRenderTarget:
+    {
+        auto  target   = get<Texture>(reader.read<uint32_t>(), ObjectType::Texture);
+        float color[4] = {};
+        for (auto& channel : color)
+            channel = reader.read<float>();
+        if (target == nullptr)
+            return false;
+        list.clearRenderTarget(*target, color);
+        return true;
+    }
+    case Op::ClearDepthStencil:
+    {
+        auto target  = get<Texture>(reader.read<uint32_t>(), ObjectType::Texture);
+        auto depth   = reader.read<float>();
+        auto stencil = reader.read<uint8_t>();
+        if (target == nullptr)
+            return false;
+        list.clearDepthStencil(*target, depth, stencil);
+        return true;
+    }
+    case Op::SetRenderTargets:
+    {
+        Texture* targets[GraphicsPipelineDesc::MaxRenderTargets] = {};
+        auto count = reader.read<uint32_t>();
+        if (count > GraphicsPipelineDesc::MaxRenderTargets)
+            return false;
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            targets[i] = get<Texture>(reader.read<uint32_t>(), ObjectType::Texture);
+            if (targets[i] == nullptr)
+                return false;
+        }
+        auto depthId      = reader.read<uint32_t>();
+        auto depthStencil = get<Texture>(depthId, ObjectType::Texture);
+        if (depthStencil == nullptr && depthId != NoObject)
+            return false;
+        list.setRenderTargets(targets, count, depthStencil);
+        return true;
+    }
+    case Op::SetRootSignature:
+    {
+        auto rootSignature = get<RootSignature>(reader.read<uint32_t>(), ObjectType::RootSignature);
+        if (rootSignature == nullptr)
+            return false;
+        list.setGraphicsRootSignature(*rootSignature);
+        return true;
+    }
+    case Op::SetPipelineState:
+    {
+        auto pipeline = get<PipelineState>(reader.read<uint32_t>(), ObjectType::Pipeline);
+        if (pipeline == nullptr)
+            return false;
+        list.setPipelineState(*pipeline);
+        return true;
+    }
+    case Op::SetRootConstantBuffer:
+    case Op::SetRootShaderResource:
+    {
+        auto parameter = reader.read<uint32_t>();
+        auto buffer    = reader.read<uint32_t>();
+        auto address   = getAddress(buffer, reader.read<uint64_t>());
+        if (op == Op::SetRootConstantBuffer)
+            list.setGraphicsRootConstantBufferView(parameter, address);
+        else
+            list.setGraphicsRootShaderResourceView(parameter, address);
+        return true;
+    }
+    case Op::SetVertexBuffers:
+    {
+        auto startSlot = reader.read<uint32_t>();
+        auto count     = reader.read<uint32_t>();
+        m_views.clear();
+        for (uint32_t i = 0; i < count && reader.isValid(); ++i)
+        {
+            VertexBufferView view;
+            auto bufferId = reader.read<uint32_t>();
+            view.buffer   = get<Buffer>(bufferId, ObjectType::Buffer);
+            view.offset   = reader.read<uint64_t>();
+            view.size     = reader.read<uint32_t>();
+            view.stride   = reader.read<uint32_t>();
+            if (view.buffer == nullptr && bufferId != NoObject)
+                return false;
+            m_views.push_back(view);
+        }
+        if (!reader.isValid())
+            return false;
+        list.setVertexBuffers(startSlot, m_views.data(), count);
+        return true;
+    }
+    case Op::SetIndexBuffer:
+    {
+        IndexBufferView view;
+        auto bufferId = reader.read<uint32_t>();
+        view.buffer   = get<Buffer>(bufferId, ObjectType::Buffer);
+        view.offset   = reader.read<uint64_t>();
+        view.size     = reader.read<uint32_t>();
+        view.format   = reader.read<Format>();
+        if (view.buffer == nullptr && bufferId != NoObject)
+            return false;
+        list.setIndexBuffer(view);
+        return true;
+    }
+    case Op::DrawIndexedInstanced:
+    {
+        auto indexCount    = reader.read<uint32_t>();
+        auto instanceCount = reader.read<uint32_t>();
+        auto startIndex    = reader.read<uint32_t>();
+        auto baseVertex    = reader.read<int32_t>();
+        auto startInstance = reader.read<uint32_t>();
+        list.drawIndexedInstanced(indexCount, instanceCount, startIndex, baseVertex, startInstance);
+        return true;
+    }
+    case Op::ExecuteIndirect:
+    {
+        auto signature      = get<CommandSignature>(reader.read<uint32_t>(), ObjectType::CommandSignature);
+        auto maxCount       = reader.read<uint32_t>();
+        auto arguments      = get<Buffer>(reader.read<uint32_t>(), ObjectType::Buffer);
+        auto argumentOffset = reader.read<uint64_t>();
+        auto countId        = reader.read<uint32_t>();
+        auto countBuffer    = get<Buffer>(countId, ObjectType::Buffer);
+        auto countOffset    = reader.read<uint64_t>();
+        if (signature == nullptr || arguments == nullptr || (countBuffer == nullptr && countId != NoObject))
+            return false;
+        list.executeIndirect(*signature, maxCount, *arguments, argumentOffset, countBuffer, countOffset);
+        return true;
+    }
+    case Op::CopyBufferRegion:
+    {
+        auto dest         = get<Buffer>(reader.read<uint32_t>(), ObjectType::Buffer);
+        auto destOffset   = reader.read<uint64_t>();
+        auto source       = get<Buffer>(reader.read<uint32_t>(), ObjectType::Buffer);
+        auto sourceOffset = reader.read<uint64_t>();
+        auto size         = reader.read<uint64_t>();
+        if (dest == nullptr || source == nullptr)
+            return false;
+        list.copyBufferRegion(*dest, destOffset, *source, sourceOffset, size);
+        return true;
+    }
+    case Op::CopyBufferToTexture:
+    {
+        auto dest         = get<Texture>(reader.read<uint32_t>(), ObjectType::Texture);
+        auto source       = get<Buffer>(reader.read<uint32_t>(), ObjectType::Buffer);
+        auto sourceOffset = reader.read<uint64_t>();
+        auto rowPitch     = reader.read<uint32_t>();
+        if (dest == nullptr || source == nullptr)
+            return false;
+        list.copyBufferToTexture(*dest, *source, sourceOffset, rowPitch);
+        return true;
+    }
+    case Op::WriteTimestamp:
+    {
+        auto heap  = get<TimestampQueryHeap>(reader.read<uint32_t>(), ObjectType::QueryHeap);
+        auto index = reader.read<uint32_t>();
+        if (heap == nullptr)
+            return false;
+        list.writeTimestamp(*heap, index);
+        return true;
+    }
+    case Op::ResolveTimestamps:
+    {
+        auto heap       = get<TimestampQueryHeap>(reader.read<uint32_t>(), ObjectType::QueryHeap);
+        auto first      = reader.read<uint32_t>();
+        auto count      = reader.read<uint32_t>();
+        auto dest       = get<Buffer>(reader.read<uint32_t>(), ObjectType::Buffer);
+        auto destOffset = reader.read<uint64_t>();
+        if (heap == nullptr || dest == nullptr)
+            return false;
+        list.resolveTimestamps(*heap, first, count, *dest, destOffset);
+        return true;
+    }
+    default:
+        // List commands carry no size, an unknown one ends the stream
+        return false;
+    }
+}
+
+// --------
+//  Objects
+// --------
+
+template <typename T>
+T* CaptureReplayer::get(uint32_t id, ObjectType type) const noexcept
+{
+    if (id >= m_objects.size() || m_objects[id].type != type)
+        return nullptr;
+    return static_cast<T*>(m_objects[id].pointer);
+}
+
+Resource* CaptureReplayer::getResource(uint32_t id) const noexcept
+{
+    if (auto texture = get<Texture>(id, ObjectType::Texture))
+        return texture;
+    return get<Buffer>(id, ObjectType::Buffer);
+}
+
+uint64_t CaptureReplayer::getAddress(uint32_t buffer, uint64_t offset) const noexcept
+{
+    auto replayed = get<Buffer>(buffer, ObjectType::Buffer);
+    return replayed != nullptr ? replayed->getGpuAddress() + offset : offset;
+}
+
+template <typename T>
+bool CaptureReplayer::add(uint32_t id, ObjectType type, std::unique_ptr<T> object)
+{
+    if (id == NoObject || id >= m_objects.size())
+        return false;
+    if (!object)
+        return true;
+
+    auto& entry   = m_objects[id];
+    entry.type    = type;
+    entry.pointer = object.get();
+    entry.owner   = std::shared_ptr<T>(std::move(object));
+    ++m_stats.objects;
+    return true;
+}
+
+bool CaptureReplayer::addBackBuffers(uint32_t swapChainId, CaptureReader& reader)
+{
+    auto swapChain = get<SwapChain>(swapChainId, ObjectType::SwapChain);
+    auto count     = reader.read<uint32_t>();
+    if (swapChain == nullptr || count != swapChain->getBufferCount())
+        return false;
+
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        auto id = reader.read<uint32_t>();
+        if (id == NoObject || id >= m_objects.size())
+            return false;
+        m_objects[id].type    = ObjectType::Texture;
+        m_objects[id].pointer = &swapChain->getBackBuffer(i);
+    }
+    return reader.isValid();
+}
+
+void CaptureReplayer::release(uint32_t id)
+{
+    if (id >= m_objects.size())
+        return;
+    auto& entry = m_objects[id];
+    if (entry.owner)
+        m_retired.push_back({ std::move(entry.owner), { m_pending[0], m_pending[1] } });
+    entry = {};
+}
+
+void CaptureReplayer::releaseCompleted(bool all)
+{
+    if (all)
+    {
+        m_retired.clear();
+        return;
+    }
+
+    // Retired in order of the executions they wait for
+    size_t count = 0;
+    for (; count < m_retired.size(); ++count)
+    {
+        auto& retired = m_retired[count];
+        if (!isSignalCompleted(0, retired.signals[0]) || !isSignalCompleted(1, retired.signals[1]))
+            break;
+    }
+    m_retired.erase(m_retired.begin(), m_retired.begin() + static_cast<std::ptrdiff_t>(count));
+}
+
+// -------
+//  Fences
+// -------
+
+CommandQueue& CaptureReplayer::getQueue(uint32_t queue) noexcept
+{
+    return queue == static_cast<uint32_t>(QueueType::Copy) ? m_device.getCopyQueue() : m_device.getQueue();
+}
+
+uint64_t CaptureReplayer::mapFence(uint32_t queue, uint64_t captured) const noexcept
+{
+    // Last signal at or before the captured value, waits in the capture always follow the signal they wait for
+    auto& signals = m_signals[queue];
+    auto  it      = std::upper_bound(signals.begin(), signals.end(), captured,
+                                     [](uint64_t value, const Signal& signal) { return value < signal.captured; });
+    return it == signals.begin() ? 0 : (it - 1)->replayed;
+}
+
+bool CaptureReplayer::isSignalCompleted(uint32_t queue, size_t signal) noexcept
+{
+    if (signal == NoSignal)
+        return true;
+    return signal < m_signals[queue].size() && getQueue(queue).isCompleted(m_signals[queue][signal].replayed);
+}
+
+void CaptureReplayer::waitForSignal(uint32_t queue, size_t signal)
+{
+    if (isSignalCompleted(queue, signal))
+        return;
+
+    // The capture has not signaled after the execution yet, a signal of our own covers it and stays out of the fence map
+    auto value = signal < m_signals[queue].size() ? m_signals[queue][signal].replayed : getQueue(queue).signal();
+    ++m_stats.safetyWaits;
+    getQueue(queue).waitForValue(value);
+}
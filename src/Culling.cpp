@@ -0,0 +1,489 @@
+#include "Culling.hpp"
+#include "Profiler.hpp"
+#include "JobSystem.hpp"
+
+#include <cmath>
+#include <algorithm>
+
+using namespace GalgameEngine;
+using Simd::FloatN;
+
+namespace
+{
+    constexpr uint32_t RowAlignment = 8;
+    constexpr float    NearW        = 1e-4f;   // Clip w below it counts as behind the near plane
+
+    // Box corners k = (x bit 0, y bit 1, z bit 2), two triangles per face
+    constexpr uint8_t BoxTriangles[12][3] = {
+        { 0, 2, 6 }, { 0, 6, 4 },   // -x
+        { 1, 5, 7 }, { 1, 7, 3 },   // +x
+        { 0, 4, 5 }, { 0, 5, 1 },   // -y
+        { 2, 3, 7 }, { 2, 7, 6 },   // +y
+        { 0, 1, 3 }, { 0, 3, 2 },   // -z
+        { 4, 6, 7 }, { 4, 7, 5 },   // +z
+    };
+
+    Vec4 column(const Mat4& m, int c) noexcept
+    {
+        auto e = [&m, c](int r) { return (&m.rows[r].x)[c]; };
+        return { e(0), e(1), e(2), e(3) };
+    }
+
+    Vec4 add(Vec4 a, Vec4 b) noexcept { return { a.x + b.x, a.y + b.y, a.z + b.z, a.w + b.w }; }
+    Vec4 sub(Vec4 a, Vec4 b) noexcept { return { a.x - b.x, a.y - b.y, a.z - b.z, a.w - b.w }; }
+
+    // Lane l is x + l
+    FloatN laneOffsets() noexcept
+    {
+        alignas(32) static constexpr float offsets[8] = { 0.f, 1.f, 2.f, 3.f, 4.f, 5.f, 6.f, 7.f };
+        return FloatN::load(offsets);
+    }
+}
+
+// --------
+//  Frustum
+// --------
+
+Frustum Frustum::fromViewProjection(const Mat4& viewProjection) noexcept
+{
+    // Clip space is v * M, inside is -w <= x <= w, -w <= y <= w, 0 <= z <= w
+    auto c0 = column(viewProjection, 0);
+    auto c1 = column(viewProjection, 1);
+    auto c2 = column(viewProjection, 2);
+    auto c3 = column(viewProjection, 3);
+
+    Frustum frustum;
+    frustum.planes[0] = add(c3, c0);
+    frustum.planes[1] = sub(c3, c0);
+    frustum.planes[2] = add(c3, c1);
+    frustum.planes[3] = sub(c3, c1);
+    frustum.planes[4] = c2;
+    frustum.planes[5] = sub(c3, c2);
+    return frustum;
+}
+
+// ----------------
+//  OcclusionBuffer
+// ----------------
+
+OcclusionBuffer::OcclusionBuffer(const Config& config)
+    : m_width((config.width + RowAlignment - 1) / RowAlignment * RowAlignment),
+      m_height(config.height),
+      m_depth(static_cast<size_t>(m_width) * m_height, 1.f)
+{
+}
+
+void OcclusionBuffer::begin(const Mat4& viewProjection)
+{
+    m_viewProjection = viewProjection;
+    m_triangles.clear();
+}
+
+bool OcclusionBuffer::project(Vec3 center, Vec3 extent, ScreenBox& box) const noexcept
+{
+    // Corners are the projected center plus or minus the projected half axes
+    auto&             m = m_viewProjection;
+    alignas(16) float p[4], ax[4], ay[4], az[4];
+    Simd::store(p, Simd::madd(Simd::Float4::splat(center.x), m.rows[0].load(),
+                   Simd::madd(Simd::Float4::splat(center.y), m.rows[1].load(),
+                   Simd::madd(Simd::Float4::splat(center.z), m.rows[2].load(), m.rows[3].load()))));
+    Simd::store(ax, Simd::Float4::splat(extent.x) * m.rows[0].load());
+    Simd::store(ay, Simd::Float4::splat(extent.y) * m.rows[1].load());
+    Simd::store(az, Simd::Float4::splat(extent.z) * m.rows[2].load());
+
+    // All eight corners as structure of arrays, one register with AVX2
+    alignas(32) static constexpr float SignX[8] = { -1.f, 1.f, -1.f, 1.f, -1.f, 1.f, -1.f, 1.f };
+    alignas(32) static constexpr float SignY[8] = { -1.f, -1.f, 1.f, 1.f, -1.f, -1.f, 1.f, 1.f };
+    alignas(32) static constexpr float SignZ[8] = { -1.f, -1.f, -1.f, -1.f, 1.f, 1.f, 1.f, 1.f };
+    for (uint32_t k = 0; k < 8; k += Simd::Width)
+    {
+        auto sx = FloatN::load(SignX + k);
+        auto sy = FloatN::load(SignY + k);
+        auto sz = FloatN::load(SignZ + k);
+        FloatN clip[4];
+        for (int c = 0; c < 4; ++c)
+            clip[c] = Simd::madd(sx, FloatN::splat(ax[c]), Simd::madd(sy, FloatN::splat(ay[c]), Simd::madd(sz, FloatN::splat(az[c]), FloatN::splat(p[c]))));
+        if (Simd::moveMask(Simd::lessThan(clip[3], FloatN::splat(NearW))))
+            return false;
+
+        auto invW = FloatN::splat(1.f) / clip[3];
+        auto half = FloatN::splat(0.5f);
+        Simd::store(box.x + k, Simd::madd(clip[0] * invW, half, half) * FloatN::splat(static_cast<float>(m_width)));
+        Simd::store(box.y + k, (half - clip[1] * invW * half) * FloatN::splat(static_cast<float>(m_height)));
+        Simd::store(box.z + k, clip[2] * invW);
+    }
+    return true;
+}
+
+bool OcclusionBuffer::addOccluder(Vec3 center, Vec3 extent)
+{
+    ScreenBox box;
+    if (!project(center, extent, box))
+        return false;
+
+    // Farthest corner, the box covers nothing behind it
+    float depth = *std::max_element(box.z, box.z + 8);
+    if (depth >= 1.f)
+        return false;
+
+    for (auto& indices : BoxTriangles)
+    {
+        float x[3], y[3];
+        for (int v = 0; v < 3; ++v)
+        {
+            x[v] = box.x[indices[v]];
+            y[v] = box.y[indices[v]];
+        }
+
+        Triangle triangle;
+        for (int e = 0; e < 3; ++e)
+        {
+            int next = (e + 1) % 3;
+            triangle.a[e] = y[e] - y[next];
+            triangle.b[e] = x[next] - x[e];
+            triangle.c[e] = x[e] * y[next] - x[next] * y[e];
+        }
+
+        // Both windings, faces are not culled
+        float area = triangle.a[0] * x[2] + triangle.b[0] * y[2] + triangle.c[0];
+        if (std::fabs(area) < 1e-6f)
+            continue;
+        if (area < 0.f)
+        {
+            for (int e = 0; e < 3; ++e)
+            {
+                triangle.a[e] = -triangle.a[e];
+                triangle.b[e] = -triangle.b[e];
+                triangle.c[e] = -triangle.c[e];
+            }
+        }
+
+        triangle.depth = depth;
+        triangle.minX  = std::max(0, static_cast<int32_t>(std::floor(std::min({ x[0], x[1], x[2] }))));
+        triangle.minY  = std::max(0, static_cast<int32_t>(std::floor(std::min({ y[0], y[1], y[2] }))));
+        triangle.maxX  = std::min(static_cast<int32_t>(m_width) - 1, static_cast<int32_t>(std::floor(std::max({ x[0], x[1], x[2] }))));
+        triangle.maxY  = std::min(static_cast<int32_t>(m_height) - 1, static_cast<int32_t>(std::floor(std::max({ y[0], y[1], y[2] }))));
+        if (triangle.minX <= triangle.maxX && triangle.minY <= triangle.maxY)
+            m_triangles.push_back(triangle);
+    }
+    return true;
+}
+
+void OcclusionBuffer::rasterize(uint32_t rowBegin, uint32_t rowEnd)
+{
+    std::fill(m_depth.begin() + static_cast<size_t>(rowBegin) * m_width, m_depth.begin() + static_cast<size_t>(rowEnd) * m_width, 1.f);
+
+    constexpr uint32_t Width   = Simd::Width;
+    auto               offsets = laneOffsets();
+    auto               zero    = FloatN::zero();
+    for (auto& triangle : m_triangles)
+    {
+        auto y0 = std::max<int32_t>(triangle.minY, static_cast<int32_t>(rowBegin));
+        auto y1 = std::min<int32_t>(triangle.maxY, static_cast<int32_t>(rowEnd) - 1);
+        auto x0 = triangle.minX & ~static_cast<int32_t>(Width - 1);
+        auto z  = FloatN::splat(triangle.depth);
+        FloatN a[3];
+        for (int e = 0; e < 3; ++e)
+            a[e] = FloatN::splat(triangle.a[e]);
+
+        for (int32_t y = y0; y <= y1; ++y)
+        {
+            // Edge functions at the pixel centers of the row start, stepped by Width pixels
+            float  py = static_cast<float>(y) + 0.5f;
+            auto   px = FloatN::splat(static_cast<float>(x0) + 0.5f) + offsets;
+            FloatN edge[3];
+            for (int e = 0; e < 3; ++e)
+                edge[e] = Simd::madd(a[e], px, FloatN::splat(triangle.b[e] * py + triangle.c[e]));
+
+            auto step = FloatN::splat(static_cast<float>(Width));
+            auto row  = m_depth.data() + static_cast<size_t>(y) * m_width;
+            for (int32_t x = x0; x <= triangle.maxX; x += Width)
+            {
+                auto outside = Simd::lessThan(edge[0], zero) | Simd::lessThan(edge[1], zero) | Simd::lessThan(edge[2], zero);
+                auto depth   = FloatN::load(row + x);
+                Simd::store(row + x, Simd::select(Simd::min(depth, z), depth, outside));
+                for (int e = 0; e < 3; ++e)
+                    edge[e] = Simd::madd(a[e], step, edge[e]);
+            }
+        }
+    }
+}
+
+bool OcclusionBuffer::isVisible(Vec3 center, Vec3 extent) const noexcept
+{
+    ScreenBox box;
+    if (!project(center, extent, box))
+        return true;
+
+    float minX = *std::min_element(box.x, box.x + 8);
+    float maxX = *std::max_element(box.x, box.x + 8);
+    float minY = *std::min_element(box.y, box.y + 8);
+    float maxY = *std::max_element(box.y, box.y + 8);
+    float minZ = *std::min_element(box.z, box.z + 8);
+
+    // Every pixel the rectangle touches
+    auto x0 = std::max(0, static_cast<int32_t>(std::floor(minX)));
+    auto y0 = std::max(0, static_cast<int32_t>(std::floor(minY)));
+    auto x1 = std::min(static_cast<int32_t>(m_width) - 1, static_cast<int32_t>(std::floor(maxX)));
+    auto y1 = std::min(static_cast<int32_t>(m_height) - 1, static_cast<int32_t>(std::floor(maxY)));
+    if (x0 > x1 || y0 > y1)
+        return false;
+
+    constexpr int32_t Width = Simd::Width;
+    auto z     = FloatN::splat(minZ);
+    auto start = x0 & ~(Width - 1);
+    for (int32_t y = y0; y <= y1; ++y)
+    {
+        auto row = m_depth.data() + static_cast<size_t>(y) * m_width;
+        for (int32_t x = start; x <= x1; x += Width)
+        {
+            // Lanes left of x0 and right of x1 are not part of the rectangle
+            int lanes = (1 << Width) - 1;
+            if (x < x0)
+                lanes &= ~((1 << (x0 - x)) - 1);
+            if (x + Width - 1 > x1)
+                lanes &= (1 << (x1 - x + 1)) - 1;
+            if (Simd::moveMask(Simd::greaterThan(FloatN::load(row + x), z)) & lanes)
+                return true;
+        }
+    }
+    return false;
+}
+
+// -------
+//  Culler
+// -------
+
+namespace
+{
+    // Bits of the boxes outside a plane, and of those not entirely inside all of them
+    struct TestResult
+    {
+        int outside;
+        int partial;
+    };
+
+    template <typename Planes>
+    TestResult testBoxes(const Planes& planes, FloatN cx, FloatN cy, FloatN cz, FloatN ex, FloatN ey, FloatN ez) noexcept
+    {
+        auto zero    = FloatN::zero();
+        auto outside = zero;
+        auto partial = zero;
+        for (int p = 0; p < 6; ++p)
+        {
+            auto distance = Simd::madd(planes.x[p], cx, Simd::madd(planes.y[p], cy, Simd::madd(planes.z[p], cz, planes.w[p])));
+            auto radius   = Simd::madd(planes.absX[p], ex, Simd::madd(planes.absY[p], ey, planes.absZ[p] * ez));
+            outside = outside | Simd::lessThan(distance + radius, zero);
+            partial = partial | Simd::lessThan(distance - radius, zero);
+        }
+        return { Simd::moveMask(outside), Simd::moveMask(partial) };
+    }
+}
+
+Culler::Culler(const Config& config)
+    : m_config(config),
+      m_occlusionBuffer(config.occlusionBuffer)
+{
+}
+
+void Culler::cull(const Bvh& bvh, const Mat4& viewProjection, const uint32_t* occluders, uint32_t occluderCount,
+                  JobSystem* jobSystem, std::vector<uint32_t>& visible)
+{
+    PROFILE_SCOPE("Culler::cull");
+
+    m_stats = {};
+    m_stats.objects = bvh.getObjectCount();
+    visible.clear();
+    if (bvh.getNodes().empty())
+        return;
+
+    auto frustum = Frustum::fromViewProjection(viewProjection);
+    for (int p = 0; p < 6; ++p)
+    {
+        auto& plane = frustum.planes[p];
+        m_planes.x[p]    = FloatN::splat(plane.x);
+        m_planes.y[p]    = FloatN::splat(plane.y);
+        m_planes.z[p]    = FloatN::splat(plane.z);
+        m_planes.w[p]    = FloatN::splat(plane.w);
+        m_planes.absX[p] = FloatN::splat(std::fabs(plane.x));
+        m_planes.absY[p] = FloatN::splat(std::fabs(plane.y));
+        m_planes.absZ[p] = FloatN::splat(std::fabs(plane.z));
+    }
+
+    // Top levels on this thread, the subtrees below them as jobs, a few per thread
+    uint32_t threadCount = jobSystem != nullptr ? jobSystem->getThreadCount() : 1;
+    uint32_t splitDepth  = UINT32_MAX;
+    if (threadCount > 1)
+    {
+        splitDepth = 1;
+        for (uint32_t subtrees = Bvh::Width; subtrees < threadCount * 8; subtrees *= Bvh::Width)
+            ++splitDepth;
+    }
+
+    {
+        PROFILE_SCOPE("Culler::frustum");
+        m_taskNodes.clear();
+        m_rootTask.slots.clear();
+        m_rootTask.splits.clear();
+        m_rootTask.nodesVisited = 0;
+        traverse(bvh, 0, 0, splitDepth, m_rootTask);
+
+        auto taskCount = static_cast<uint32_t>(m_taskNodes.size());
+        if (m_tasks.size() < taskCount)
+            m_tasks.resize(taskCount);
+        if (taskCount > 0)
+        {
+            auto       body = [this, &bvh](uint32_t begin, uint32_t end)
+            {
+                for (uint32_t i = begin; i < end; ++i)
+                {
+                    m_tasks[i].slots.clear();
+                    m_tasks[i].nodesVisited = 0;
+                    traverse(bvh, m_taskNodes[i], 0, UINT32_MAX, m_tasks[i]);
+                }
+            };
+            JobCounter counter;
+            jobSystem->parallelFor(counter, taskCount, 1, body);
+            jobSystem->wait(counter);
+        }
+
+        // Subtree slots go where the traversal queued them, the order is the same as without tasks
+        auto& rootSlots = m_rootTask.slots;
+        m_frustumSlots.clear();
+        m_stats.nodesVisited = m_rootTask.nodesVisited;
+        uint32_t rootBegin   = 0;
+        for (uint32_t i = 0; i < taskCount; ++i)
+        {
+            auto split = m_rootTask.splits[i];
+            m_frustumSlots.insert(m_frustumSlots.end(), rootSlots.begin() + rootBegin, rootSlots.begin() + split);
+            m_frustumSlots.insert(m_frustumSlots.end(), m_tasks[i].slots.begin(), m_tasks[i].slots.end());
+            m_stats.nodesVisited += m_tasks[i].nodesVisited;
+            rootBegin = split;
+        }
+        m_frustumSlots.insert(m_frustumSlots.end(), rootSlots.begin() + rootBegin, rootSlots.end());
+        m_stats.frustumVisible = static_cast<uint32_t>(m_frustumSlots.size());
+    }
+
+    // Occluders first, then every object inside the frustum against them
+    bool occlusion = m_config.occlusion && occluderCount > 0;
+    if (occlusion)
+    {
+        PROFILE_SCOPE("Culler::rasterizeOccluders");
+        m_occlusionBuffer.begin(viewProjection);
+        for (uint32_t i = 0; i < occluderCount; ++i)
+        {
+            auto slot   = bvh.getSlot(occluders[i]);
+            Vec3 center = { bvh.getCenters(0)[slot], bvh.getCenters(1)[slot], bvh.getCenters(2)[slot] };
+            Vec3 extent = { bvh.getExtents(0)[slot], bvh.getExtents(1)[slot], bvh.getExtents(2)[slot] };
+            m_stats.occluders += m_occlusionBuffer.addOccluder(center, extent);
+        }
+
+        auto height = m_occlusionBuffer.getHeight();
+        if (threadCount > 1)
+        {
+            auto       band = [this](uint32_t begin, uint32_t end) { m_occlusionBuffer.rasterize(begin, end); };
+            JobCounter counter;
+            jobSystem->parallelFor(counter, height, (height + threadCount * 2 - 1) / (threadCount * 2), band);
+            jobSystem->wait(counter);
+        }
+        else
+        {
+            m_occlusionBuffer.rasterize(0, height);
+        }
+        occlusion = m_occlusionBuffer.getTriangleCount() > 0;
+    }
+
+    if (!occlusion)
+    {
+        visible.resize(m_frustumSlots.size());
+        for (size_t i = 0; i < m_frustumSlots.size(); ++i)
+            visible[i] = bvh.getObject(m_frustumSlots[i]);
+        m_stats.visible = static_cast<uint32_t>(visible.size());
+        return;
+    }
+
+    PROFILE_SCOPE("Culler::occlusion");
+    auto count      = static_cast<uint32_t>(m_frustumSlots.size());
+    auto grain      = m_config.occlusionGrain;
+    auto rangeCount = (count + grain - 1) / grain;
+    if (m_occlusionOutputs.size() < rangeCount)
+        m_occlusionOutputs.resize(rangeCount);
+
+    auto test = [this, &bvh, grain](uint32_t begin, uint32_t end)
+    {
+        auto& output = m_occlusionOutputs[begin / grain];
+        output.clear();
+        for (uint32_t i = begin; i < end; ++i)
+        {
+            auto slot   = m_frustumSlots[i];
+            Vec3 center = { bvh.getCenters(0)[slot], bvh.getCenters(1)[slot], bvh.getCenters(2)[slot] };
+            Vec3 extent = { bvh.getExtents(0)[slot], bvh.getExtents(1)[slot], bvh.getExtents(2)[slot] };
+            if (m_occlusionBuffer.isVisible(center, extent))
+                output.push_back(bvh.getObject(slot));
+        }
+    };
+    if (threadCount > 1)
+    {
+        JobCounter counter;
+        jobSystem->parallelFor(counter, count, grain, test);
+        jobSystem->wait(counter);
+    }
+    else
+    {
+        for (uint32_t begin = 0; begin < count; begin += grain)
+            test(begin, std::min(begin + grain, count));
+    }
+
+    for (uint32_t i = 0; i < rangeCount; ++i)
+        visible.insert(visible.end(), m_occlusionOutputs[i].begin(), m_occlusionOutputs[i].end());
+    m_stats.visible  = static_cast<uint32_t>(visible.size());
+    m_stats.occluded = m_stats.frustumVisible - m_stats.visible;
+}
+
+void Culler::traverse(const Bvh& bvh, uint32_t nodeIndex, uint32_t depth, uint32_t splitDepth, Task& task)
+{
+    auto& node = bvh.getNodes()[nodeIndex];
+    ++task.nodesVisited;
+
+    auto result = testBoxes(m_planes,
+                            FloatN::load(node.center[0]), FloatN::load(node.center[1]), FloatN::load(node.center[2]),
+                            FloatN::load(node.extent[0]), FloatN::load(node.extent[1]), FloatN::load(node.extent[2]));
+
+    for (uint32_t i = 0; i < Bvh::Width; ++i)
+    {
+        if (node.count[i] == 0 || (result.outside >> i) & 1)
+            continue;
+
+        // Entirely inside, the whole subtree is visible
+        if (!((result.partial >> i) & 1))
+        {
+            for (uint32_t slot = node.first[i]; slot < node.first[i] + node.count[i]; ++slot)
+                task.slots.push_back(slot);
+            continue;
+        }
+
+        if (node.child[i] == Bvh::LeafChild)
+        {
+            // Objects of the leaf in one register, the padding past the last slot is never visible
+            auto first  = node.first[i];
+            auto leaf   = testBoxes(m_planes,
+                                    FloatN::load(bvh.getCenters(0) + first), FloatN::load(bvh.getCenters(1) + first), FloatN::load(bvh.getCenters(2) + first),
+                                    FloatN::load(bvh.getExtents(0) + first), FloatN::load(bvh.getExtents(1) + first), FloatN::load(bvh.getExtents(2) + first));
+            int  inside = ~leaf.outside & ((1 << node.count[i]) - 1);
+            for (uint32_t lane = 0; inside != 0; ++lane, inside >>= 1)
+            {
+                if (inside & 1)
+                    task.slots.push_back(first + lane);
+            }
+        }
+        else if (depth + 1 >= splitDepth)
+        {
+            m_taskNodes.push_back(node.child[i]);
+            task.splits.push_back(static_cast<uint32_t>(task.slots.size()));
+        }
+        else
+        {
+            traverse(bvh, node.child[i], depth + 1, splitDepth, task);
+        }
+    }
+}
@@ -0,0 +1,89 @@
+#include "D3D12CommandQueue.hpp"
+#include "D3D12Device.hpp"
+#include "Util.hpp"
+#include "Timer.hpp"
+
+#include <vector>
+
+using namespace GalgameEngine;
+
+D3D12CommandQueue::D3D12CommandQueue(ID3D12Device* device, D3D12_COMMAND_LIST_TYPE type)
+{
+    D3D12_COMMAND_QUEUE_DESC desc = {};
+    desc.Type = type;
+    ThrowIfFailed(device->CreateCommandQueue(&desc, IID_PPV_ARGS(m_queue.GetAddressOf())));
+
+    // CPU use signal to wait GPU has completed work so that CPU can right update resource
+    ThrowIfFailed(device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(m_fence.GetAddressOf())));
+}
+
+void D3D12CommandQueue::executeCommandLists(CommandList* const* lists, uint32_t count)
+{
+    std::vector<ID3D12CommandList*> d3d12Lists(count);
+    for (uint32_t i = 0; i < count; ++i)
+        d3d12Lists[i] = static_cast<D3D12CommandList*>(lists[i])->get();
+    m_queue->ExecuteCommandLists(count, d3d12Lists.data());
+}
+
+uint64_t D3D12CommandQueue::signal()
+{
+    ++m_fenceValue;
+    ThrowIfFailed(m_queue->Signal(m_fence.Get(), m_fenceValue));
+    return m_fenceValue;
+}
+
+uint64_t D3D12CommandQueue::getCompletedValue() const
+{
+    return m_fence->GetCompletedValue();
+}
+
+void D3D12CommandQueue::waitForValue(uint64_t value)
+{
+    // Wait until GPU has completed commands up to this fence point
+    if (m_fence->GetCompletedValue() < value)
+    {
+        // Pooled event, the wait consumes its signal so it can be reused at once
+        auto event = m_waitEvents.acquire();
+        setEventOnCompletion(value, *event);
+        event->wait();
+        m_waitEvents.release(event);
+    }
+}
+
+void D3D12CommandQueue::setEventOnCompletion(uint64_t value, SyncEvent& event)
+{
+    // Fire event when GPU hits the fence
+    ThrowIfFailed(m_fence->SetEventOnCompletion(value, static_cast<HANDLE>(event.getNativeHandle())));
+}
+
+void D3D12CommandQueue::wait(CommandQueue& other, uint64_t value)
+{
+    // GPU side wait on the other queue's fence, nothing blocks on CPU
+    ThrowIfFailed(m_queue->Wait(static_cast<D3D12CommandQueue&>(other).m_fence.Get(), value));
+}
+
+uint64_t D3D12CommandQueue::getTimestampFrequency() const
+{
+    UINT64 frequency = 0;
+    ThrowIfFailed(m_queue->GetTimestampFrequency(&frequency));
+    return frequency;
+}
+
+ClockCalibration D3D12CommandQueue::getClockCalibration() const
+{
+    // CPU side of the calibration is a QPC value, take it back to Timer ticks through a Timer sample right after it
+    UINT64 gpuTimestamp = 0;
+    UINT64 cpuTimestamp = 0;
+    ThrowIfFailed(m_queue->GetClockCalibration(&gpuTimestamp, &cpuTimestamp));
+    auto ticks = Timer::now();
+
+    LARGE_INTEGER counter, frequency;
+    QueryPerformanceCounter(&counter);
+    QueryPerformanceFrequency(&frequency);
+    auto elapsed = static_cast<double>(counter.QuadPart - static_cast<int64_t>(cpuTimestamp)) / frequency.QuadPart;
+
+    ClockCalibration calibration;
+    calibration.gpuTimestamp = gpuTimestamp;
+    calibration.cpuTicks     = ticks - static_cast<int64_t>(elapsed / Timer::getSecondsPerCount());
+    return calibration;
+}
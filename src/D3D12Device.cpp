@@ -0,0 +1,974 @@
+#include "D3D12Device.hpp"
+#include "Util.hpp"
+
+#include <climits>
+#include <algorithm>
+
+using namespace Microsoft::WRL;
+using namespace GalgameEngine;
+
+DXGI_FORMAT GalgameEngine::toDXGIFormat(Format format) noexcept
+{
+    switch (format)
+    {
+    case Format::R8G8B8A8_UNORM:     return DXGI_FORMAT_R8G8B8A8_UNORM;
+    case Format::R16G16B16A16_FLOAT: return DXGI_FORMAT_R16G16B16A16_FLOAT;
+    case Format::R32_FLOAT:          return DXGI_FORMAT_R32_FLOAT;
+    case Format::R32G32_FLOAT:       return DXGI_FORMAT_R32G32_FLOAT;
+    case Format::R32G32B32_FLOAT:    return DXGI_FORMAT_R32G32B32_FLOAT;
+    case Format::R32G32B32A32_FLOAT: return DXGI_FORMAT_R32G32B32A32_FLOAT;
+    case Format::D24_UNORM_S8_UINT:  return DXGI_FORMAT_D24_UNORM_S8_UINT;
+    case Format::D32_FLOAT:          return DXGI_FORMAT_D32_FLOAT;
+    case Format::R16_UINT:           return DXGI_FORMAT_R16_UINT;
+    case Format::R32_UINT:           return DXGI_FORMAT_R32_UINT;
+    default:                         return DXGI_FORMAT_UNKNOWN;
+    }
+}
+
+D3D12_RESOURCE_STATES GalgameEngine::toD3D12State(ResourceState state) noexcept
+{
+    switch (state)
+    {
+    case ResourceState::Present:         return D3D12_RESOURCE_STATE_PRESENT;
+    case ResourceState::RenderTarget:    return D3D12_RESOURCE_STATE_RENDER_TARGET;
+    case ResourceState::DepthWrite:      return D3D12_RESOURCE_STATE_DEPTH_WRITE;
+    case ResourceState::DepthRead:       return D3D12_RESOURCE_STATE_DEPTH_READ;
+    case ResourceState::ShaderResource:  return D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE | D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE;
+    case ResourceState::UnorderedAccess: return D3D12_RESOURCE_STATE_UNORDERED_ACCESS;
+    case ResourceState::CopySource:      return D3D12_RESOURCE_STATE_COPY_SOURCE;
+    case ResourceState::CopyDest:        return D3D12_RESOURCE_STATE_COPY_DEST;
+    case ResourceState::GenericRead:     return D3D12_RESOURCE_STATE_GENERIC_READ;
+    default:                             return D3D12_RESOURCE_STATE_COMMON;
+    }
+}
+
+D3D12_RESOURCE_BARRIER_FLAGS GalgameEngine::toD3D12BarrierFlags(BarrierFlags flags) noexcept
+{
+    switch (flags)
+    {
+    case BarrierFlags::BeginOnly: return D3D12_RESOURCE_BARRIER_FLAG_BEGIN_ONLY;
+    case BarrierFlags::EndOnly:   return D3D12_RESOURCE_BARRIER_FLAG_END_ONLY;
+    default:                      return D3D12_RESOURCE_BARRIER_FLAG_NONE;
+    }
+}
+
+namespace
+{
+    D3D12_RESOURCE_DESC toD3D12ResourceDesc(const TextureDesc& desc) noexcept
+    {
+        D3D12_RESOURCE_DESC resourceDesc = {};
+        resourceDesc.Dimension           = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
+        resourceDesc.Width               = desc.width;
+        resourceDesc.Height              = desc.height;
+        resourceDesc.DepthOrArraySize    = 1;
+        resourceDesc.MipLevels           = 1;
+        resourceDesc.Format              = toDXGIFormat(desc.format);
+        resourceDesc.SampleDesc.Count    = 1;
+        if (hasFlag(desc.usage, TextureUsage::RenderTarget))
+            resourceDesc.Flags |= D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET;
+        if (hasFlag(desc.usage, TextureUsage::DepthStencil))
+            resourceDesc.Flags |= D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL;
+        if (hasFlag(desc.usage, TextureUsage::UnorderedAccess))
+            resourceDesc.Flags |= D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS;
+        return resourceDesc;
+    }
+
+    D3D12_CLEAR_VALUE toD3D12ClearValue(const TextureDesc& desc) noexcept
+    {
+        D3D12_CLEAR_VALUE clearValue = {};
+        clearValue.Format = toDXGIFormat(desc.format);
+        if (hasFlag(desc.usage, TextureUsage::DepthStencil))
+        {
+            clearValue.DepthStencil.Depth   = desc.clearValue.depth;
+            clearValue.DepthStencil.Stencil = desc.clearValue.stencil;
+        }
+        else
+        {
+            std::copy(std::begin(desc.clearValue.color), std::end(desc.clearValue.color), clearValue.Color);
+        }
+        return clearValue;
+    }
+
+    D3D12_RESOURCE_DESC toD3D12ResourceDesc(const BufferDesc& desc) noexcept
+    {
+        D3D12_RESOURCE_DESC resourceDesc = {};
+        resourceDesc.Dimension           = D3D12_RESOURCE_DIMENSION_BUFFER;
+        resourceDesc.Width               = desc.size;
+        resourceDesc.Height              = 1;
+        resourceDesc.DepthOrArraySize    = 1;
+        resourceDesc.MipLevels           = 1;
+        resourceDesc.Format              = DXGI_FORMAT_UNKNOWN;
+        resourceDesc.SampleDesc.Count    = 1;
+        resourceDesc.Layout              = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+        return resourceDesc;
+    }
+
+    D3D12_COMMAND_LIST_TYPE toD3D12ListType(QueueType type) noexcept
+    {
+        return type == QueueType::Copy ? D3D12_COMMAND_LIST_TYPE_COPY : D3D12_COMMAND_LIST_TYPE_DIRECT;
+    }
+}
+
+namespace
+{
+    D3D12_SHADER_VISIBILITY toD3D12Visibility(ShaderVisibility visibility) noexcept
+    {
+        switch (visibility)
+        {
+        case ShaderVisibility::Vertex: return D3D12_SHADER_VISIBILITY_VERTEX;
+        case ShaderVisibility::Pixel:  return D3D12_SHADER_VISIBILITY_PIXEL;
+        default:                       return D3D12_SHADER_VISIBILITY_ALL;
+        }
+    }
+
+    D3D12_DESCRIPTOR_RANGE_TYPE toD3D12RangeType(DescriptorRangeType type) noexcept
+    {
+        switch (type)
+        {
+        case DescriptorRangeType::ConstantBuffer:  return D3D12_DESCRIPTOR_RANGE_TYPE_CBV;
+        case DescriptorRangeType::UnorderedAccess: return D3D12_DESCRIPTOR_RANGE_TYPE_UAV;
+        case DescriptorRangeType::Sampler:         return D3D12_DESCRIPTOR_RANGE_TYPE_SAMPLER;
+        default:                                   return D3D12_DESCRIPTOR_RANGE_TYPE_SRV;
+        }
+    }
+
+    D3D12_COMPARISON_FUNC toD3D12CompareFunc(CompareFunc func) noexcept
+    {
+        switch (func)
+        {
+        case CompareFunc::Never:        return D3D12_COMPARISON_FUNC_NEVER;
+        case CompareFunc::LessEqual:    return D3D12_COMPARISON_FUNC_LESS_EQUAL;
+        case CompareFunc::Equal:        return D3D12_COMPARISON_FUNC_EQUAL;
+        case CompareFunc::GreaterEqual: return D3D12_COMPARISON_FUNC_GREATER_EQUAL;
+        case CompareFunc::Greater:      return D3D12_COMPARISON_FUNC_GREATER;
+        case CompareFunc::Always:       return D3D12_COMPARISON_FUNC_ALWAYS;
+        default:                        return D3D12_COMPARISON_FUNC_LESS;
+        }
+    }
+
+    D3D12_RENDER_TARGET_BLEND_DESC toD3D12Blend(BlendMode mode) noexcept
+    {
+        D3D12_RENDER_TARGET_BLEND_DESC blend = {};
+        blend.BlendEnable           = mode != BlendMode::Opaque;
+        blend.SrcBlend              = mode == BlendMode::AlphaBlend ? D3D12_BLEND_SRC_ALPHA : D3D12_BLEND_ONE;
+        blend.DestBlend             = mode == BlendMode::AlphaBlend ? D3D12_BLEND_INV_SRC_ALPHA : D3D12_BLEND_ONE;
+        blend.BlendOp               = D3D12_BLEND_OP_ADD;
+        blend.SrcBlendAlpha         = D3D12_BLEND_ONE;
+        blend.DestBlendAlpha        = mode == BlendMode::AlphaBlend ? D3D12_BLEND_INV_SRC_ALPHA : D3D12_BLEND_ONE;
+        blend.BlendOpAlpha          = D3D12_BLEND_OP_ADD;
+        blend.LogicOp               = D3D12_LOGIC_OP_NOOP;
+        blend.RenderTargetWriteMask = D3D12_COLOR_WRITE_ENABLE_ALL;
+        return blend;
+    }
+}
+
+// ----------------
+//  Descriptor heap
+// ----------------
+
+D3D12DescriptorHeap::D3D12DescriptorHeap(ID3D12Device* device, D3D12_DESCRIPTOR_HEAP_TYPE type, DescriptorHeapCapacity capacity, bool shaderVisible)
+    : m_allocator(capacity.persistent, capacity.transient)
+{
+    // Notice, there is only create the descriptor heap, not create the descriptor
+    D3D12_DESCRIPTOR_HEAP_DESC heapDesc = {};
+    heapDesc.NumDescriptors = capacity.persistent + capacity.transient;
+    heapDesc.Type           = type;
+    heapDesc.Flags          = shaderVisible ? D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE : D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
+    ThrowIfFailed(device->CreateDescriptorHeap(&heapDesc, IID_PPV_ARGS(m_heap.GetAddressOf())));
+
+    m_descriptorSize = device->GetDescriptorHandleIncrementSize(type);
+    m_cpuStart       = m_heap->GetCPUDescriptorHandleForHeapStart();
+    if (shaderVisible)
+        m_gpuStart = m_heap->GetGPUDescriptorHandleForHeapStart();
+}
+
+D3D12Resource::~D3D12Resource()
+{
+    // Release the resource before its memory can be handed to another one
+    m_resource.Reset();
+    if (m_allocator != nullptr)
+        m_allocator->free(m_allocation);
+}
+
+ID3D12Resource* GalgameEngine::toD3D12Resource(Resource* resource) noexcept
+{
+    auto d3d12Resource = dynamic_cast<D3D12Resource*>(resource);
+    return d3d12Resource != nullptr ? d3d12Resource->get() : nullptr;
+}
+
+// --------
+//  Texture
+// --------
+
+D3D12Texture::D3D12Texture(D3D12Device& device, ComPtr<ID3D12Resource> resource, const TextureDesc& desc, ResourceState initialState)
+    : Texture(initialState), D3D12Resource(std::move(resource)), m_device(device), m_desc(desc)
+{
+    if (hasFlag(m_desc.usage, TextureUsage::RenderTarget))
+    {
+        auto& heap = m_device.getDescriptorHeap(DescriptorHeapType::Rtv);
+        m_rtvIndex = heap.getAllocator().allocate();
+        ThrowIfFalse(m_rtvIndex != DescriptorAllocator::InvalidIndex);
+        m_rtv = heap.getCpuHandle(m_rtvIndex);
+        m_device.get()->CreateRenderTargetView(m_resource.Get(), nullptr, m_rtv);
+    }
+    if (hasFlag(m_desc.usage, TextureUsage::DepthStencil))
+    {
+        D3D12_DEPTH_STENCIL_VIEW_DESC dsvDesc = {};
+        dsvDesc.ViewDimension = D3D12_DSV_DIMENSION_TEXTURE2D;
+        dsvDesc.Format        = toDXGIFormat(m_desc.format);
+
+        auto& heap = m_device.getDescriptorHeap(DescriptorHeapType::Dsv);
+        m_dsvIndex = heap.getAllocator().allocate();
+        ThrowIfFalse(m_dsvIndex != DescriptorAllocator::InvalidIndex);
+        m_dsv = heap.getCpuHandle(m_dsvIndex);
+        m_device.get()->CreateDepthStencilView(m_resource.Get(), &dsvDesc, m_dsv);
+    }
+}
+
+D3D12Texture::~D3D12Texture()
+{
+    // Render target and depth stencil views are consumed at record time, their slots can be reused at once
+    if (m_rtvIndex != DescriptorAllocator::InvalidIndex)
+        m_device.getDescriptorHeap(DescriptorHeapType::Rtv).getAllocator().freeImmediately(m_rtvIndex);
+    if (m_dsvIndex != DescriptorAllocator::InvalidIndex)
+        m_device.getDescriptorHeap(DescriptorHeapType::Dsv).getAllocator().freeImmediately(m_dsvIndex);
+}
+
+// -------
+//  Buffer
+// -------
+
+D3D12Buffer::D3D12Buffer(ComPtr<ID3D12Resource> resource, const BufferDesc& desc, ResourceState initialState)
+    : Buffer(initialState), D3D12Resource(std::move(resource)), m_desc(desc)
+{
+    // Keep upload and readback buffers mapped, mapping once is enough for their whole lifetime
+    if (m_desc.heapType != HeapType::Default)
+    {
+        D3D12_RANGE readRange = {};
+        void*       data      = nullptr;
+        ThrowIfFailed(m_resource->Map(0, m_desc.heapType == HeapType::Readback ? nullptr : &readRange, &data));
+        m_mappedData = static_cast<uint8_t*>(data);
+    }
+}
+
+D3D12Buffer::~D3D12Buffer()
+{
+    if (m_mappedData != nullptr)
+        m_resource->Unmap(0, nullptr);
+}
+
+// ------------------
+//  Command allocator
+// ------------------
+
+D3D12CommandAllocator::D3D12CommandAllocator(ID3D12Device* device, QueueType type)
+{
+    ThrowIfFailed(device->CreateCommandAllocator(toD3D12ListType(type), IID_PPV_ARGS(m_allocator.GetAddressOf())));
+}
+
+void D3D12CommandAllocator::reset()
+{
+    ThrowIfFailed(m_allocator->Reset());
+}
+
+// -------------
+//  Command list
+// -------------
+
+D3D12CommandList::D3D12CommandList(D3D12Device& device, QueueType type)
+    : m_device(device), m_type(type)
+{
+    // Create command list in closed state without allocator
+    // We always need reset the command list before rendering new frame
+    ComPtr<ID3D12Device4> device4;
+    ThrowIfFailed(m_device.get()->QueryInterface(IID_PPV_ARGS(device4.GetAddressOf())));
+    ThrowIfFailed(device4->CreateCommandList1(
+        0,
+        toD3D12ListType(m_type),
+        D3D12_COMMAND_LIST_FLAG_NONE,
+        IID_PPV_ARGS(m_list.GetAddressOf())
+    ));
+}
+
+void D3D12CommandList::reset(CommandAllocator& allocator)
+{
+    ThrowIfFailed(m_list->Reset(static_cast<D3D12CommandAllocator&>(allocator).get(), nullptr));
+    if (m_type == QueueType::Copy)
+        return;
+
+    // Shader visible heaps are bound once per list, descriptor tables are offsets into them
+    ID3D12DescriptorHeap* heaps[] = {
+        m_device.getDescriptorHeap(DescriptorHeapType::CbvSrvUav).get(),
+        m_device.getDescriptorHeap(DescriptorHeapType::Sampler).get(),
+    };
+    m_list->SetDescriptorHeaps(2, heaps);
+}
+
+void D3D12CommandList::close()
+{
+    ThrowIfFailed(m_list->Close());
+}
+
+void D3D12CommandList::setViewport(const Viewport& viewport)
+{
+    D3D12_VIEWPORT d3d12Viewport = { viewport.x, viewport.y, viewport.width, viewport.height, viewport.minDepth, viewport.maxDepth };
+    m_list->RSSetViewports(1, &d3d12Viewport);
+}
+
+void D3D12CommandList::setScissorRect(const Rect& rect)
+{
+    D3D12_RECT d3d12Rect = { rect.left, rect.top, rect.right, rect.bottom };
+    m_list->RSSetScissorRects(1, &d3d12Rect);
+}
+
+void D3D12CommandList::resourceBarrier(const ResourceBarrier* barriers, uint32_t count)
+{
+    // Convert barriers in small batches on stack
+    constexpr uint32_t BatchSize = 16;
+    D3D12_RESOURCE_BARRIER batch[BatchSize] = {};
+    for (uint32_t begin = 0; begin < count; begin += BatchSize)
+    {
+        uint32_t batchCount = std::min(BatchSize, count - begin);
+        for (uint32_t i = 0; i < batchCount; ++i)
+        {
+            auto& barrier = barriers[begin + i];
+            batch[i].Type                   = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
+            batch[i].Flags                  = toD3D12BarrierFlags(barrier.flags);
+            batch[i].Transition.pResource   = toD3D12Resource(barrier.resource);
+            batch[i].Transition.StateBefore = toD3D12State(barrier.before);
+            batch[i].Transition.StateAfter  = toD3D12State(barrier.after);
+            batch[i].Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
+        }
+        m_list->ResourceBarrier(batchCount, batch);
+    }
+}
+
+void D3D12CommandList::aliasingBarrier(Resource* before, Resource* after)
+{
+    D3D12_RESOURCE_BARRIER barrier = {};
+    barrier.Type                     = D3D12_RESOURCE_BARRIER_TYPE_ALIASING;
+    barrier.Aliasing.pResourceBefore = before != nullptr ? toD3D12Resource(before) : nullptr;
+    barrier.Aliasing.pResourceAfter  = toD3D12Resource(after);
+    m_list->ResourceBarrier(1, &barrier);
+}
+
+void D3D12CommandList::clearRenderTarget(Texture& target, const float color[4])
+{
+    m_list->ClearRenderTargetView(static_cast<D3D12Texture&>(target).getRtv(), color, 0, nullptr);
+}
+
+void D3D12CommandList::clearDepthStencil(Texture& target, float depth, uint8_t stencil)
+{
+    m_list->ClearDepthStencilView(
+        static_cast<D3D12Texture&>(target).getDsv(),
+        D3D12_CLEAR_FLAG_DEPTH | D3D12_CLEAR_FLAG_STENCIL,
+        depth, stencil,
+        0, nullptr
+    );
+}
+
+void D3D12CommandList::setRenderTargets(Texture* const* targets, uint32_t count, Texture* depthStencil)
+{
+    D3D12_CPU_DESCRIPTOR_HANDLE rtvs[D3D12_SIMULTANEOUS_RENDER_TARGET_COUNT] = {};
+    for (uint32_t i = 0; i < count; ++i)
+        rtvs[i] = static_cast<D3D12Texture*>(targets[i])->getRtv();
+
+    D3D12_CPU_DESCRIPTOR_HANDLE dsv = {};
+    if (depthStencil != nullptr)
+        dsv = static_cast<D3D12Texture*>(depthStencil)->getDsv();
+
+    m_list->OMSetRenderTargets(count, rtvs, false, depthStencil != nullptr ? &dsv : nullptr);
+}
+
+void D3D12CommandList::setGraphicsRootSignature(RootSignature& rootSignature)
+{
+    m_list->SetGraphicsRootSignature(static_cast<D3D12RootSignature&>(rootSignature).get());
+}
+
+void D3D12CommandList::setPipelineState(PipelineState& pipeline)
+{
+    auto& d3d12Pipeline = static_cast<D3D12PipelineState&>(pipeline);
+    m_list->SetPipelineState(d3d12Pipeline.get());
+    m_list->IASetPrimitiveTopology(d3d12Pipeline.getTopology());
+}
+
+void D3D12CommandList::setGraphicsRootConstantBufferView(uint32_t parameter, uint64_t gpuAddress)
+{
+    m_list->SetGraphicsRootConstantBufferView(parameter, gpuAddress);
+}
+
+void D3D12CommandList::setGraphicsRootShaderResourceView(uint32_t parameter, uint64_t gpuAddress)
+{
+    m_list->SetGraphicsRootShaderResourceView(parameter, gpuAddress);
+}
+
+void D3D12CommandList::setVertexBuffers(uint32_t startSlot, const VertexBufferView* views, uint32_t count)
+{
+    D3D12_VERTEX_BUFFER_VIEW d3d12Views[D3D12_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT] = {};
+    count = std::min<uint32_t>(count, D3D12_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT);
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        if (views[i].buffer == nullptr)
+            continue;
+        d3d12Views[i].BufferLocation = views[i].buffer->getGpuAddress() + views[i].offset;
+        d3d12Views[i].SizeInBytes    = views[i].size;
+        d3d12Views[i].StrideInBytes  = views[i].stride;
+    }
+    m_list->IASetVertexBuffers(startSlot, count, d3d12Views);
+}
+
+void D3D12CommandList::setIndexBuffer(const IndexBufferView& view)
+{
+    D3D12_INDEX_BUFFER_VIEW d3d12View = {};
+    d3d12View.BufferLocation = view.buffer->getGpuAddress() + view.offset;
+    d3d12View.SizeInBytes    = view.size;
+    d3d12View.Format         = toDXGIFormat(view.format);
+    m_list->IASetIndexBuffer(&d3d12View);
+}
+
+void D3D12CommandList::drawIndexedInstanced(uint32_t indexCount, uint32_t instanceCount, uint32_t startIndex, int32_t baseVertex, uint32_t startInstance)
+{
+    m_list->DrawIndexedInstanced(indexCount, instanceCount, startIndex, baseVertex, startInstance);
+}
+
+void D3D12CommandList::executeIndirect(CommandSignature& signature, uint32_t maxCount, Buffer& arguments, uint64_t argumentOffset,
+                                       Buffer* countBuffer, uint64_t countOffset)
+{
+    m_list->ExecuteIndirect(
+        static_cast<D3D12CommandSignature&>(signature).get(), maxCount,
+        toD3D12Resource(&arguments), argumentOffset,
+        countBuffer != nullptr ? toD3D12Resource(countBuffer) : nullptr, countOffset
+    );
+}
+
+void D3D12CommandList::copyBufferRegion(Buffer& dest, uint64_t destOffset, Buffer& source, uint64_t sourceOffset, uint64_t size)
+{
+    m_list->CopyBufferRegion(toD3D12Resource(&dest), destOffset, toD3D12Resource(&source), sourceOffset, size);
+}
+
+void D3D12CommandList::copyBufferToTexture(Texture& dest, Buffer& source, uint64_t sourceOffset, uint32_t rowPitch)
+{
+    auto& desc = dest.getDesc();
+
+    D3D12_TEXTURE_COPY_LOCATION destLocation = {};
+    destLocation.pResource        = toD3D12Resource(&dest);
+    destLocation.Type             = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
+    destLocation.SubresourceIndex = 0;
+
+    D3D12_TEXTURE_COPY_LOCATION sourceLocation = {};
+    sourceLocation.pResource                          = toD3D12Resource(&source);
+    sourceLocation.Type                               = D3D12_TEXTURE_COPY_TYPE_PLACED_FOOTPRINT;
+    sourceLocation.PlacedFootprint.Offset             = sourceOffset;
+    sourceLocation.PlacedFootprint.Footprint.Format   = toDXGIFormat(desc.format);
+    sourceLocation.PlacedFootprint.Footprint.Width    = desc.width;
+    sourceLocation.PlacedFootprint.Footprint.Height   = desc.height;
+    sourceLocation.PlacedFootprint.Footprint.Depth    = 1;
+    sourceLocation.PlacedFootprint.Footprint.RowPitch = rowPitch;
+    m_list->CopyTextureRegion(&destLocation, 0, 0, 0, &sourceLocation, nullptr);
+}
+
+void D3D12CommandList::writeTimestamp(TimestampQueryHeap& heap, uint32_t index)
+{
+    // Timestamp queries have no begin, EndQuery writes them
+    m_list->EndQuery(static_cast<D3D12TimestampQueryHeap&>(heap).get(), D3D12_QUERY_TYPE_TIMESTAMP, index);
+}
+
+void D3D12CommandList::resolveTimestamps(TimestampQueryHeap& heap, uint32_t first, uint32_t count, Buffer& dest, uint64_t destOffset)
+{
+    m_list->ResolveQueryData(static_cast<D3D12TimestampQueryHeap&>(heap).get(), D3D12_QUERY_TYPE_TIMESTAMP, first, count, toD3D12Resource(&dest), destOffset);
+}
+
+// ---------------
+//  Pipeline state
+// ---------------
+
+std::vector<uint8_t> D3D12PipelineState::getCachedBlob() const
+{
+    ComPtr<ID3DBlob> blob;
+    if (FAILED(m_pipeline->GetCachedBlob(blob.GetAddressOf())))
+        return {};
+    auto data = static_cast<const uint8_t*>(blob->GetBufferPointer());
+    return std::vector<uint8_t>(data, data + blob->GetBufferSize());
+}
+
+// -----------
+//  Swap chain
+// -----------
+
+D3D12SwapChain::D3D12SwapChain(D3D12Device& device, const SwapChainDesc& desc)
+    : m_device(device), m_desc(desc)
+{
+    auto hWnd = static_cast<HWND>(m_desc.window);
+
+    DXGI_SWAP_CHAIN_DESC swapChainDesc = {};
+    swapChainDesc.BufferDesc.Width  = m_desc.width;
+    swapChainDesc.BufferDesc.Height = m_desc.height;
+    swapChainDesc.BufferDesc.Format = toDXGIFormat(m_desc.format);
+    swapChainDesc.SampleDesc.Count  = 1;
+    swapChainDesc.BufferUsage       = DXGI_USAGE_RENDER_TARGET_OUTPUT;
+    swapChainDesc.BufferCount       = m_desc.bufferCount;
+    swapChainDesc.OutputWindow      = hWnd;
+    swapChainDesc.Windowed          = true;
+    swapChainDesc.SwapEffect        = DXGI_SWAP_EFFECT_FLIP_DISCARD;
+    swapChainDesc.Flags             = DXGI_SWAP_CHAIN_FLAG_ALLOW_MODE_SWITCH;
+    if (m_desc.maxFrameLatency != 0)
+        swapChainDesc.Flags |= DXGI_SWAP_CHAIN_FLAG_FRAME_LATENCY_WAITABLE_OBJECT;
+    m_flags = swapChainDesc.Flags;
+
+    ComPtr<IDXGISwapChain> swapChain;
+    ThrowIfFailed(m_device.getFactory()->CreateSwapChain(
+        m_device.getD3D12Queue().get(), 
+        &swapChainDesc, 
+        swapChain.GetAddressOf()
+    ));
+    // Flip model swap chain decides the back buffer order, IDXGISwapChain3 tells current one
+    ThrowIfFailed(swapChain.As(&m_swapChain));
+
+    // Disable Alt + Enter to fullscreen, it will lead ComPtr release error
+    ThrowIfFailed(m_device.getFactory()->MakeWindowAssociation(hWnd, DXGI_MWA_NO_ALT_ENTER));
+
+    // Signaled whenever the present queue has room for another frame
+    if (m_desc.maxFrameLatency != 0)
+    {
+        ThrowIfFailed(m_swapChain->SetMaximumFrameLatency(m_desc.maxFrameLatency));
+        m_frameLatencyWaitable = m_swapChain->GetFrameLatencyWaitableObject();
+    }
+
+    createBuffers();
+}
+
+D3D12SwapChain::~D3D12SwapChain()
+{
+    if (m_frameLatencyWaitable != nullptr)
+        CloseHandle(m_frameLatencyWaitable);
+}
+
+void D3D12SwapChain::present(uint32_t syncInterval)
+{
+    ThrowIfFailed(m_swapChain->Present(syncInterval, 0));
+}
+
+void D3D12SwapChain::resize(uint32_t width, uint32_t height)
+{
+    m_desc.width  = width;
+    m_desc.height = height;
+
+    // Release back buffers before resize swap chain
+    m_buffers.clear();
+    ThrowIfFailed(m_swapChain->ResizeBuffers(
+        m_desc.bufferCount, 
+        m_desc.width, m_desc.height, 
+        toDXGIFormat(m_desc.format), 
+        m_flags)
+    );
+    createBuffers();
+}
+
+void D3D12SwapChain::setSourceSize(uint32_t width, uint32_t height)
+{
+    // Flip model swap chain presents the region stretched to the window, which is 1:1 when it matches the client area
+    ThrowIfFailed(m_swapChain->SetSourceSize(width, height));
+}
+
+void D3D12SwapChain::waitForFrameLatency()
+{
+    // Time out instead of hanging when presents stop, e.g. while the window is occluded
+    if (m_frameLatencyWaitable != nullptr)
+        WaitForSingleObjectEx(m_frameLatencyWaitable, 1000, TRUE);
+}
+
+void D3D12SwapChain::createBuffers()
+{
+    TextureDesc desc = {};
+    desc.width  = m_desc.width;
+    desc.height = m_desc.height;
+    desc.format = m_desc.format;
+    desc.usage  = TextureUsage::RenderTarget;
+
+    for (UINT i = 0; i < m_desc.bufferCount; ++i)
+    {
+        ComPtr<ID3D12Resource> buffer;
+        ThrowIfFailed(m_swapChain->GetBuffer(i, IID_PPV_ARGS(buffer.GetAddressOf())));
+        m_buffers.push_back(std::make_unique<D3D12Texture>(m_device, std::move(buffer), desc, ResourceState::Present));
+    }
+}
+
+// -------
+//  Device
+// -------
+
+D3D12Device::D3D12Device()
+{
+    // --------------------------
+    //  Enable debug information
+    // --------------------------
+
+#ifdef _DEBUG
+    {
+        // Enable D3D12 debug layer
+        ComPtr<ID3D12Debug> debugController;
+        ThrowIfFailed(D3D12GetDebugInterface(IID_PPV_ARGS(debugController.GetAddressOf())));
+        debugController->EnableDebugLayer();
+    }
+
+    // ----------------------------------
+    //  Create factory, device and queue
+    // ----------------------------------
+
+    // Create factory
+    // Enable debug feature of factory
+    ThrowIfFailed(CreateDXGIFactory2(DXGI_CREATE_FACTORY_DEBUG, IID_PPV_ARGS(m_factory.GetAddressOf())));
+#else
+    ThrowIfFailed(CreateDXGIFactory(IID_PPV_ARGS(m_factory.GetAddressOf())));
+#endif
+
+    // Create device
+    if (FAILED(D3D12CreateDevice(nullptr, D3D_FEATURE_LEVEL_12_1, IID_PPV_ARGS(m_device.GetAddressOf()))))
+    {
+        // Fallback to WARP device
+        ComPtr<IDXGIAdapter> warpAdapter;
+        ThrowIfFailed(m_factory->EnumWarpAdapter(IID_PPV_ARGS(warpAdapter.GetAddressOf())));
+        ThrowIfFailed(D3D12CreateDevice(warpAdapter.Get(), D3D_FEATURE_LEVEL_12_1, IID_PPV_ARGS(m_device.GetAddressOf())));
+    }
+    ThrowIfFailed(m_factory->EnumAdapterByLuid(m_device->GetAdapterLuid(), IID_PPV_ARGS(m_adapter.GetAddressOf())));
+
+    // Create command queue and the fence tracks its timeline
+    m_commandQueue = std::make_unique<D3D12CommandQueue>(m_device.Get());
+    m_copyQueue    = std::make_unique<D3D12CommandQueue>(m_device.Get(), D3D12_COMMAND_LIST_TYPE_COPY);
+
+    // Get 4X MSAA quality level
+    // All Direct3D 11 capable devices support 4X MSAA fir all render target formats
+    // So we only need to check quality support
+    D3D12_FEATURE_DATA_MULTISAMPLE_QUALITY_LEVELS level = {};
+    level.Format      = DXGI_FORMAT_R8G8B8A8_UNORM;
+    level.SampleCount = 4;
+    ThrowIfFailed(m_device->CheckFeatureSupport(
+        D3D12_FEATURE_MULTISAMPLE_QUALITY_LEVELS, 
+        &level,
+        sizeof(level)
+    ));
+    m_4xMSAAQualityLevels = level.NumQualityLevels;
+
+    // Create one descriptor heap of every type with full capacity
+    // CPU will use them to access GPU resource, shader visible ones are also used by GPU
+    constexpr struct
+    {
+        DescriptorHeapType         type;
+        D3D12_DESCRIPTOR_HEAP_TYPE d3d12Type;
+        bool                       shaderVisible;
+    } heapTypes[] = {
+        { DescriptorHeapType::CbvSrvUav, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, true  },
+        { DescriptorHeapType::Sampler,   D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER,     true  },
+        { DescriptorHeapType::Rtv,       D3D12_DESCRIPTOR_HEAP_TYPE_RTV,         false },
+        { DescriptorHeapType::Dsv,       D3D12_DESCRIPTOR_HEAP_TYPE_DSV,         false },
+    };
+    for (auto& heapType : heapTypes)
+    {
+        m_descriptorHeaps[static_cast<uint32_t>(heapType.type)] = std::make_unique<D3D12DescriptorHeap>(
+            m_device.Get(), heapType.d3d12Type, getDescriptorHeapCapacity(heapType.type), heapType.shaderVisible);
+    }
+
+    // Resources are placed in large heaps, tier 2 hardware lets buffers and all textures share them
+    D3D12_FEATURE_DATA_D3D12_OPTIONS options = {};
+    ThrowIfFailed(m_device->CheckFeatureSupport(D3D12_FEATURE_D3D12_OPTIONS, &options, sizeof(options)));
+    MemoryAllocator::Config allocatorConfig;
+    allocatorConfig.mixedHeaps = options.ResourceHeapTier >= D3D12_RESOURCE_HEAP_TIER_2;
+    m_memoryAllocator = std::make_unique<MemoryAllocator>(*this, allocatorConfig);
+}
+
+D3D12Device::~D3D12Device()
+{
+    m_copyQueue->flush();
+    m_commandQueue->flush();
+
+    // Empty heaps kept for reuse are not leaks, release them before reporting live objects
+    m_memoryAllocator.reset();
+
+    ComPtr<ID3D12DebugDevice> debugDevice;
+    if (SUCCEEDED(m_device->QueryInterface(IID_PPV_ARGS(&debugDevice))))
+    {
+        debugDevice->ReportLiveDeviceObjects(D3D12_RLDO_DETAIL);
+    }
+}
+
+std::unique_ptr<CommandAllocator> D3D12Device::createCommandAllocator(QueueType type)
+{
+    return std::make_unique<D3D12CommandAllocator>(m_device.Get(), type);
+}
+
+std::unique_ptr<CommandList> D3D12Device::createCommandList(QueueType type)
+{
+    return std::make_unique<D3D12CommandList>(*this, type);
+}
+
+std::unique_ptr<SwapChain> D3D12Device::createSwapChain(const SwapChainDesc& desc)
+{
+    return std::make_unique<D3D12SwapChain>(*this, desc);
+}
+
+std::unique_ptr<Texture> D3D12Device::createTexture(const TextureDesc& desc, ResourceState initialState)
+{
+    // Render target and depth stencil textures have heaps of their own on tier 1 hardware
+    bool isTarget   = hasFlag(desc.usage, TextureUsage::RenderTarget) || hasFlag(desc.usage, TextureUsage::DepthStencil);
+    auto allocation = m_memoryAllocator->allocate(HeapType::Default, isTarget ? HeapUsage::RenderTargets : HeapUsage::Textures,
+                                                  getTextureAllocationInfo(desc));
+
+    auto texture = createPlacedTexture(*allocation.heap, allocation.offset, desc, initialState);
+    static_cast<D3D12Texture&>(*texture).setAllocation(*m_memoryAllocator, allocation);
+    return texture;
+}
+
+std::unique_ptr<Heap> D3D12Device::createHeap(const HeapDesc& desc)
+{
+    D3D12_HEAP_DESC heapDesc = {};
+    heapDesc.SizeInBytes     = desc.size;
+    heapDesc.Alignment       = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+    switch (desc.type)
+    {
+    case HeapType::Upload:   heapDesc.Properties.Type = D3D12_HEAP_TYPE_UPLOAD;   break;
+    case HeapType::Readback: heapDesc.Properties.Type = D3D12_HEAP_TYPE_READBACK; break;
+    default:                 heapDesc.Properties.Type = D3D12_HEAP_TYPE_DEFAULT;  break;
+    }
+
+    // Resource heap tier 1 only allows one kind of resource in a heap
+    switch (desc.usage)
+    {
+    case HeapUsage::Buffers:  heapDesc.Flags = D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS;             break;
+    case HeapUsage::Textures: heapDesc.Flags = D3D12_HEAP_FLAG_ALLOW_ONLY_NON_RT_DS_TEXTURES;  break;
+    case HeapUsage::All:      heapDesc.Flags = D3D12_HEAP_FLAG_ALLOW_ALL_BUFFERS_AND_TEXTURES; break;
+    default:                  heapDesc.Flags = D3D12_HEAP_FLAG_ALLOW_ONLY_RT_DS_TEXTURES;      break;
+    }
+
+    ComPtr<ID3D12Heap> heap;
+    ThrowIfFailed(m_device->CreateHeap(&heapDesc, IID_PPV_ARGS(heap.GetAddressOf())));
+    return std::make_unique<D3D12Heap>(std::move(heap), desc);
+}
+
+std::unique_ptr<TimestampQueryHeap> D3D12Device::createTimestampQueryHeap(uint32_t count)
+{
+    D3D12_QUERY_HEAP_DESC desc = {};
+    desc.Type  = D3D12_QUERY_HEAP_TYPE_TIMESTAMP;
+    desc.Count = count;
+
+    ComPtr<ID3D12QueryHeap> heap;
+    ThrowIfFailed(m_device->CreateQueryHeap(&desc, IID_PPV_ARGS(heap.GetAddressOf())));
+    return std::make_unique<D3D12TimestampQueryHeap>(std::move(heap), count);
+}
+
+std::unique_ptr<CommandSignature> D3D12Device::createCommandSignature(uint32_t byteStride)
+{
+    // Draw arguments only, a signature without root arguments takes no root signature
+    D3D12_INDIRECT_ARGUMENT_DESC argument = {};
+    argument.Type = D3D12_INDIRECT_ARGUMENT_TYPE_DRAW_INDEXED;
+
+    D3D12_COMMAND_SIGNATURE_DESC desc = {};
+    desc.ByteStride       = byteStride;
+    desc.NumArgumentDescs = 1;
+    desc.pArgumentDescs   = &argument;
+
+    ComPtr<ID3D12CommandSignature> signature;
+    ThrowIfFailed(m_device->CreateCommandSignature(&desc, nullptr, IID_PPV_ARGS(signature.GetAddressOf())));
+    return std::make_unique<D3D12CommandSignature>(std::move(signature), byteStride);
+}
+
+MemoryBudget D3D12Device::queryMemoryBudget()
+{
+    DXGI_QUERY_VIDEO_MEMORY_INFO info = {};
+    ThrowIfFailed(m_adapter->QueryVideoMemoryInfo(0, DXGI_MEMORY_SEGMENT_GROUP_LOCAL, &info));
+    return { info.Budget, info.CurrentUsage };
+}
+
+void D3D12Device::evict(Heap* const* heaps, uint32_t count)
+{
+    std::vector<ID3D12Pageable*> pageables(count);
+    for (uint32_t i = 0; i < count; ++i)
+        pageables[i] = static_cast<D3D12Heap*>(heaps[i])->get();
+    ThrowIfFailed(m_device->Evict(count, pageables.data()));
+}
+
+void D3D12Device::makeResident(Heap* const* heaps, uint32_t count)
+{
+    // Blocks until the memory is paged in, one call for the whole batch lets the OS do it in one go
+    std::vector<ID3D12Pageable*> pageables(count);
+    for (uint32_t i = 0; i < count; ++i)
+        pageables[i] = static_cast<D3D12Heap*>(heaps[i])->get();
+    ThrowIfFailed(m_device->MakeResident(count, pageables.data()));
+}
+
+std::unique_ptr<Texture> D3D12Device::createPlacedTexture(Heap& heap, uint64_t offset, const TextureDesc& desc, ResourceState initialState)
+{
+    auto resourceDesc = toD3D12ResourceDesc(desc);
+    auto clearValue   = toD3D12ClearValue(desc);
+
+    bool hasClearValue = hasFlag(desc.usage, TextureUsage::RenderTarget) || hasFlag(desc.usage, TextureUsage::DepthStencil);
+
+    ComPtr<ID3D12Resource> resource;
+    ThrowIfFailed(m_device->CreatePlacedResource(
+        static_cast<D3D12Heap&>(heap).get(),
+        offset,
+        &resourceDesc,
+        toD3D12State(initialState),
+        hasClearValue ? &clearValue : nullptr,
+        IID_PPV_ARGS(resource.GetAddressOf())
+    ));
+    return std::make_unique<D3D12Texture>(*this, std::move(resource), desc, initialState);
+}
+
+AllocationInfo D3D12Device::getTextureAllocationInfo(const TextureDesc& desc)
+{
+    auto resourceDesc = toD3D12ResourceDesc(desc);
+    auto info         = m_device->GetResourceAllocationInfo(0, 1, &resourceDesc);
+    return { info.SizeInBytes, info.Alignment };
+}
+
+std::unique_ptr<Buffer> D3D12Device::createBuffer(const BufferDesc& desc, ResourceState initialState)
+{
+    auto allocation = m_memoryAllocator->allocate(desc.heapType, HeapUsage::Buffers, getBufferAllocationInfo(desc));
+
+    auto buffer = createPlacedBuffer(*allocation.heap, allocation.offset, desc, initialState);
+    static_cast<D3D12Buffer&>(*buffer).setAllocation(*m_memoryAllocator, allocation);
+    return buffer;
+}
+
+std::unique_ptr<Buffer> D3D12Device::createPlacedBuffer(Heap& heap, uint64_t offset, const BufferDesc& desc, ResourceState initialState)
+{
+    auto resourceDesc = toD3D12ResourceDesc(desc);
+
+    ComPtr<ID3D12Resource> resource;
+    ThrowIfFailed(m_device->CreatePlacedResource(
+        static_cast<D3D12Heap&>(heap).get(),
+        offset,
+        &resourceDesc,
+        toD3D12State(initialState),
+        nullptr,
+        IID_PPV_ARGS(resource.GetAddressOf())
+    ));
+    return std::make_unique<D3D12Buffer>(std::move(resource), desc, initialState);
+}
+
+std::unique_ptr<RootSignature> D3D12Device::createRootSignature(const RootSignatureDesc& desc)
+{
+    // One range per table, ranges must outlive serialization
+    std::vector<D3D12_ROOT_PARAMETER>   parameters(desc.parameters.size());
+    std::vector<D3D12_DESCRIPTOR_RANGE> ranges(desc.parameters.size());
+    for (size_t i = 0; i < desc.parameters.size(); ++i)
+    {
+        auto& source    = desc.parameters[i];
+        auto& parameter = parameters[i];
+        parameter.ShaderVisibility = toD3D12Visibility(source.visibility);
+        switch (source.type)
+        {
+        case RootParameterType::Constants:
+            parameter.ParameterType            = D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS;
+            parameter.Constants.ShaderRegister = source.shaderRegister;
+            parameter.Constants.RegisterSpace  = source.registerSpace;
+            parameter.Constants.Num32BitValues = source.count;
+            break;
+
+        case RootParameterType::DescriptorTable:
+            ranges[i].RangeType                         = toD3D12RangeType(source.rangeType);
+            ranges[i].NumDescriptors                    = source.count;
+            ranges[i].BaseShaderRegister                = source.shaderRegister;
+            ranges[i].RegisterSpace                     = source.registerSpace;
+            ranges[i].OffsetInDescriptorsFromTableStart = D3D12_DESCRIPTOR_RANGE_OFFSET_APPEND;
+            parameter.ParameterType                       = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
+            parameter.DescriptorTable.NumDescriptorRanges = 1;
+            parameter.DescriptorTable.pDescriptorRanges   = &ranges[i];
+            break;
+
+        default:
+            parameter.ParameterType = source.type == RootParameterType::ShaderResource  ? D3D12_ROOT_PARAMETER_TYPE_SRV :
+                                      source.type == RootParameterType::UnorderedAccess ? D3D12_ROOT_PARAMETER_TYPE_UAV :
+                                                                                          D3D12_ROOT_PARAMETER_TYPE_CBV;
+            parameter.Descriptor.ShaderRegister = source.shaderRegister;
+            parameter.Descriptor.RegisterSpace  = source.registerSpace;
+            break;
+        }
+    }
+
+    D3D12_ROOT_SIGNATURE_DESC rootDesc = {};
+    rootDesc.NumParameters = static_cast<UINT>(parameters.size());
+    rootDesc.pParameters   = parameters.data();
+    rootDesc.Flags         = desc.allowInputLayout ? D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT : D3D12_ROOT_SIGNATURE_FLAG_NONE;
+
+    ComPtr<ID3DBlob> serialized;
+    ComPtr<ID3DBlob> error;
+    ThrowIfFailed(D3D12SerializeRootSignature(&rootDesc, D3D_ROOT_SIGNATURE_VERSION_1, serialized.GetAddressOf(), error.GetAddressOf()));
+
+    ComPtr<ID3D12RootSignature> rootSignature;
+    ThrowIfFailed(m_device->CreateRootSignature(
+        0,
+        serialized->GetBufferPointer(),
+        serialized->GetBufferSize(),
+        IID_PPV_ARGS(rootSignature.GetAddressOf())
+    ));
+    return std::make_unique<D3D12RootSignature>(std::move(rootSignature));
+}
+
+std::unique_ptr<PipelineState> D3D12Device::createGraphicsPipeline(const GraphicsPipelineDesc& desc, const std::vector<uint8_t>* cachedBlob)
+{
+    std::vector<D3D12_INPUT_ELEMENT_DESC> inputLayout;
+    for (auto& element : desc.inputLayout)
+    {
+        inputLayout.push_back({
+            element.semantic.c_str(), element.semanticIndex,
+            toDXGIFormat(element.format), element.slot, element.offset,
+            element.perInstance ? D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA : D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA,
+            element.perInstance ? 1u : 0u
+        });
+    }
+
+    D3D12_GRAPHICS_PIPELINE_STATE_DESC psoDesc = {};
+    psoDesc.pRootSignature = static_cast<D3D12RootSignature*>(desc.rootSignature)->get();
+    psoDesc.VS             = { desc.vertexShader.data(), desc.vertexShader.size() };
+    psoDesc.PS             = { desc.pixelShader.data(), desc.pixelShader.size() };
+    psoDesc.InputLayout    = { inputLayout.data(), static_cast<UINT>(inputLayout.size()) };
+    psoDesc.SampleMask     = UINT_MAX;
+    psoDesc.SampleDesc     = { 1, 0 };
+
+    D3D12_PRIMITIVE_TOPOLOGY topology;
+    switch (desc.topology)
+    {
+    case PrimitiveTopology::Line:
+        psoDesc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_LINE;
+        topology                      = D3D_PRIMITIVE_TOPOLOGY_LINELIST;
+        break;
+    case PrimitiveTopology::Point:
+        psoDesc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_POINT;
+        topology                      = D3D_PRIMITIVE_TOPOLOGY_POINTLIST;
+        break;
+    default:
+        psoDesc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
+        topology                      = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
+        break;
+    }
+
+    psoDesc.RasterizerState.FillMode        = desc.wireframe ? D3D12_FILL_MODE_WIREFRAME : D3D12_FILL_MODE_SOLID;
+    psoDesc.RasterizerState.CullMode        = desc.cullMode == CullMode::None  ? D3D12_CULL_MODE_NONE :
+                                              desc.cullMode == CullMode::Front ? D3D12_CULL_MODE_FRONT : D3D12_CULL_MODE_BACK;
+    psoDesc.RasterizerState.DepthClipEnable = true;
+
+    for (uint32_t i = 0; i < desc.renderTargetCount; ++i)
+    {
+        psoDesc.BlendState.RenderTarget[i] = toD3D12Blend(desc.blendMode);
+        psoDesc.RTVFormats[i]              = toDXGIFormat(desc.renderTargetFormats[i]);
+    }
+    psoDesc.NumRenderTargets = desc.renderTargetCount;
+    psoDesc.DSVFormat        = toDXGIFormat(desc.depthStencilFormat);
+
+    psoDesc.DepthStencilState.DepthEnable    = desc.depthTest;
+    psoDesc.DepthStencilState.DepthWriteMask = desc.depthWrite ? D3D12_DEPTH_WRITE_MASK_ALL : D3D12_DEPTH_WRITE_MASK_ZERO;
+    psoDesc.DepthStencilState.DepthFunc      = toD3D12CompareFunc(desc.depthFunc);
+
+    ComPtr<ID3D12PipelineState> pipeline;
+    if (cachedBlob != nullptr && !cachedBlob->empty())
+    {
+        // A blob of another driver or adapter fails with D3D12_ERROR_DRIVER_VERSION_MISMATCH, compile in full then
+        psoDesc.CachedPSO = { cachedBlob->data(), cachedBlob->size() };
+        if (SUCCEEDED(m_device->CreateGraphicsPipelineState(&psoDesc, IID_PPV_ARGS(pipeline.GetAddressOf()))))
+            return std::make_unique<D3D12PipelineState>(std::move(pipeline), topology);
+        psoDesc.CachedPSO = {};
+    }
+    ThrowIfFailed(m_device->CreateGraphicsPipelineState(&psoDesc, IID_PPV_ARGS(pipeline.GetAddressOf())));
+    return std::make_unique<D3D12PipelineState>(std::move(pipeline), topology);
+}
@@ -0,0 +1,118 @@
+#include "DescriptorAllocator.hpp"
+
+#include <algorithm>
+
+#include <assert.h>
+
+using namespace GalgameEngine;
+
+DescriptorAllocator::DescriptorAllocator(uint32_t persistentCapacity, uint32_t transientCapacity)
+    : m_persistentCapacity(persistentCapacity),
+      m_transientCapacity(transientCapacity),
+      m_allocatedBits((persistentCapacity + 63) / 64),
+      m_transient(transientCapacity)
+{
+}
+
+uint32_t DescriptorAllocator::allocate()
+{
+    std::lock_guard lock(m_mutex);
+
+    uint32_t index;
+    if (!m_freeList.empty())
+    {
+        index = m_freeList.back();
+        m_freeList.pop_back();
+    }
+    else if (m_nextUnused < m_persistentCapacity)
+    {
+        index = m_nextUnused++;
+    }
+    else
+    {
+        ++m_stats.failures;
+        return InvalidIndex;
+    }
+
+    m_allocatedBits[index / 64] |= 1ull << (index % 64);
+    ++m_stats.persistentUsed;
+    m_stats.persistentPeak = std::max(m_stats.persistentPeak, m_stats.persistentUsed);
+    return index;
+}
+
+void DescriptorAllocator::free(uint32_t index)
+{
+    std::lock_guard lock(m_mutex);
+    assert(index < m_persistentCapacity && (m_allocatedBits[index / 64] >> (index % 64) & 1) && "Double free of descriptor");
+    m_allocatedBits[index / 64] &= ~(1ull << (index % 64));
+    m_pendingFrees.push_back(index);
+    ++m_stats.pendingFrees;
+}
+
+void DescriptorAllocator::freeImmediately(uint32_t index)
+{
+    std::lock_guard lock(m_mutex);
+    assert(index < m_persistentCapacity && (m_allocatedBits[index / 64] >> (index % 64) & 1) && "Double free of descriptor");
+    m_allocatedBits[index / 64] &= ~(1ull << (index % 64));
+    release(index);
+}
+
+uint32_t DescriptorAllocator::allocateTransient(uint32_t count)
+{
+    std::lock_guard lock(m_mutex);
+    auto offset = m_transient.allocate(count, 1);
+    if (offset == RingAllocator::InvalidOffset)
+    {
+        ++m_stats.failures;
+        return InvalidIndex;
+    }
+    return m_persistentCapacity + static_cast<uint32_t>(offset);
+}
+
+void DescriptorAllocator::finishFrame(uint64_t fenceValue)
+{
+    std::lock_guard lock(m_mutex);
+    m_transient.finishFrame(fenceValue);
+    if (!m_pendingFrees.empty())
+    {
+        m_retiredFrees.push_back({ fenceValue, std::move(m_pendingFrees) });
+        m_pendingFrees.clear();
+    }
+}
+
+void DescriptorAllocator::reclaim(uint64_t completedValue)
+{
+    std::lock_guard lock(m_mutex);
+    m_transient.reclaim(completedValue);
+    while (!m_retiredFrees.empty() && m_retiredFrees.front().fenceValue <= completedValue)
+    {
+        for (auto index : m_retiredFrees.front().indices)
+        {
+            release(index);
+            --m_stats.pendingFrees;
+        }
+        m_retiredFrees.pop_front();
+    }
+}
+
+bool DescriptorAllocator::isAllocated(uint32_t index) const
+{
+    std::lock_guard lock(m_mutex);
+    if (index >= m_persistentCapacity)
+        return false;
+    return (m_allocatedBits[index / 64] >> (index % 64) & 1) != 0;
+}
+
+DescriptorAllocator::Stats DescriptorAllocator::getStats() const
+{
+    std::lock_guard lock(m_mutex);
+    auto stats = m_stats;
+    stats.transientUsed = static_cast<uint32_t>(m_transient.getUsed());
+    return stats;
+}
+
+void DescriptorAllocator::release(uint32_t index)
+{
+    m_freeList.push_back(index);
+    --m_stats.persistentUsed;
+}
@@ -1,17 +1,29 @@
 #include "DirectX12.hpp"
 #include "Util.hpp"
+#include "Profiler.hpp"
 
 #include <string>
-#include <exception>
 #include <format>
 
 #include <assert.h>
 
-using namespace Microsoft::WRL;
 using namespace Util;
+using namespace GalgameEngine;
 
-#define ThrowIfFailed(x) if (FAILED(x)) throw std::exception();
-#define ThrowIfFalse(x)  if (!x) throw std::exception();
+// First press starts profiling, second press writes trace.json and stops
+static void toggleProfileCapture()
+{
+    if (!Profiler::isEnabled())
+    {
+        Profiler::clear();
+        Profiler::setEnabled(true);
+    }
+    else
+    {
+        Profiler::setEnabled(false);
+        Profiler::writeChromeTrace("trace.json");
+    }
+}
 
 LRESULT CALLBACK wndProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam)
 {
@@ -24,6 +36,8 @@ LRESULT CALLBACK wndProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam)
     case WM_KEYUP:
         if (wParam == VK_ESCAPE)
             PostQuitMessage(0);
+        else if (wParam == VK_F9)
+            toggleProfileCapture();
         return 0;
     
     case WM_GETMINMAXINFO:
@@ -56,43 +70,15 @@ LRESULT DirectX12::wndProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam)
         return 0;
     
     case WM_SIZE:
-        m_width  = LOWORD(lParam);
-        m_height = HIWORD(lParam);
-        if (m_device)
-        {
-            if (wParam == SIZE_MINIMIZED)
-            {
-                m_minimized = true;
-                m_maximized = false;
-            }
-            else if (wParam == SIZE_MAXIMIZED)
-            {
-                m_minimized = false;
-                m_maximized = true;
-                onResize();
-            }
-            else if (wParam == SIZE_RESTORED)
-            {
-                if (m_minimized)
-                {
-                    m_minimized = false;
-                    onResize();
-                }
-                else if (m_maximized)
-                {
-                    m_maximized = false;
-                    onResize();
-                }
-                else if (m_resizing)
-                {
-
-                }
-                else
-                {
-                    onResize();
-                }
-            }
-        }
+        m_width     = LOWORD(lParam);
+        m_height    = HIWORD(lParam);
+        m_minimized = wParam == SIZE_MINIMIZED;
+        m_maximized = wParam == SIZE_MAXIMIZED;
+
+        // Every event while dragging is passed on, renderer keeps only the newest size for its next frame
+        // Minimized window has zero size, keep the buffers as they are
+        if (m_renderer && !m_minimized)
+            onResize();
         return 0;
 
     case WM_ENTERSIZEMOVE:
@@ -110,7 +96,7 @@ LRESULT DirectX12::wndProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam)
     return DefWindowProcW(hWnd, msg, wParam, lParam);
 }
 
-DirectX12::DirectX12(int width, int height)
+DirectX12::DirectX12(int width, int height, UINT frameCount, double targetFps)
     : m_width(width), m_height(height)
 {
    // Singleton
@@ -130,172 +116,27 @@ DirectX12::DirectX12(int width, int height)
     m_hWnd = createWindow(config);
     ThrowIfFalse(m_hWnd);
 
-    // --------------------------
-    //  Enable debug information
-    // --------------------------
-
-#ifdef _DEBUG
-    {
-        // Enable D3D12 debug layer
-        ComPtr<ID3D12Debug> debugController;
-        ThrowIfFailed(D3D12GetDebugInterface(IID_PPV_ARGS(debugController.GetAddressOf())));
-        debugController->EnableDebugLayer();
-    }
-
-    // ----------------------------------
-    //  Create factory, device and fence
-    // ----------------------------------
-
-    // Create factory
-    // Enable debug feature of factory
-    ThrowIfFailed(CreateDXGIFactory2(DXGI_CREATE_FACTORY_DEBUG, IID_PPV_ARGS(m_factory.GetAddressOf())));
-#else
-    ThrowIfFailed(CreateDXGIFactory(IID_PPV_ARGS(m_factory.GetAddressOf())));
-#endif
-
-    // Create device
-    if (FAILED(D3D12CreateDevice(nullptr, D3D_FEATURE_LEVEL_12_1, IID_PPV_ARGS(m_device.GetAddressOf()))))
-    {
-        // Fallback to WARP device
-        ComPtr<IDXGIAdapter> warpAdapter;
-        ThrowIfFailed(m_factory->EnumWarpAdapter(IID_PPV_ARGS(warpAdapter.GetAddressOf())));
-        ThrowIfFailed(D3D12CreateDevice(warpAdapter.Get(), D3D_FEATURE_LEVEL_12_1, IID_PPV_ARGS(m_device.GetAddressOf())));
-    }
-
-    // Create fence
-    // CPU use signal to wait GPU has completed word so that CPU can right update resource
-    ThrowIfFailed(m_device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(m_fence.GetAddressOf())));
-
-    // ------------------------------------------------------
-    //  Create command queue, allocator, list and swap chain
-    // ------------------------------------------------------
-
-    // Get 4X MSAA quality level
-    // All Direct3D 11 capable devices support 4X MSAA fir all render target formats
-    // So we only need to check quality support
-    D3D12_FEATURE_DATA_MULTISAMPLE_QUALITY_LEVELS level = {};
-    level.Format      = m_backBufferFormat;
-    level.SampleCount = 4;
-    ThrowIfFailed(m_device->CheckFeatureSupport(
-        D3D12_FEATURE_MULTISAMPLE_QUALITY_LEVELS, 
-        &level,
-        sizeof(level)
-    ));
-    m_4xMSAAQualityLevels = level.NumQualityLevels;
-
-    // Create command queue, allocator and list
-    auto commandQueueDesc = D3D12_COMMAND_QUEUE_DESC();
-    ThrowIfFailed(m_device->CreateCommandQueue(&commandQueueDesc, IID_PPV_ARGS(m_commandQueue.GetAddressOf())));
-    ThrowIfFailed(m_device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(m_commandAllocator.GetAddressOf())));
-    ThrowIfFailed(m_device->CreateCommandList(
-        0, 
-        D3D12_COMMAND_LIST_TYPE_DIRECT, 
-        m_commandAllocator.Get(),
-        nullptr,
-        IID_PPV_ARGS(m_commandList.GetAddressOf())
-    ));
-    // Close command list before reset
-    // We always need reset the command list before rendering new frame
-    m_commandList->Close();
-
-    // Create swap chain
-    // Creating swap chain also creates back buffer resource, so there's not need to create back buffer resource manually.
-    DXGI_SWAP_CHAIN_DESC swapChainDesc = {};
-    swapChainDesc.BufferDesc.Width  = m_width;
-    swapChainDesc.BufferDesc.Height = m_height;
-    swapChainDesc.BufferDesc.Format = m_backBufferFormat;
-    swapChainDesc.SampleDesc.Count  = 1;
-    swapChainDesc.BufferUsage       = DXGI_USAGE_RENDER_TARGET_OUTPUT;
-    swapChainDesc.BufferCount       = 2;
-    swapChainDesc.OutputWindow      = m_hWnd;
-    swapChainDesc.Windowed          = true;
-    swapChainDesc.SwapEffect        = DXGI_SWAP_EFFECT_FLIP_DISCARD;
-    swapChainDesc.Flags             = DXGI_SWAP_CHAIN_FLAG_ALLOW_MODE_SWITCH;
-    ThrowIfFailed(m_factory->CreateSwapChain(
-        m_commandQueue.Get(), 
-        &swapChainDesc, 
-        m_swapChain.GetAddressOf()
-    ));
-
-    // Disable Alt + Enter to fullscreen, it will lead ComPtr release error
-    ThrowIfFailed(m_factory->MakeWindowAssociation(m_hWnd, DXGI_MWA_NO_ALT_ENTER));
-
-    // ---------------------------------------
-    //  Get descriptor size
-    //  Create descriptor heap and descriptor
-    // ---------------------------------------
-
-    // Get rtv and dsv descriptor size
-    m_rtvDescriptorSize = m_device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_RTV);
-    m_dsvDescriptorSize = m_device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_DSV);
-    
-    // Create descriptor heaps for back buffer and depth buffer
-    // CPU will use them to access GPU resource
-    // Notice, there is only create the descriptor heap, not create the descriptor
-    D3D12_DESCRIPTOR_HEAP_DESC heapDesc = {};
-    heapDesc.NumDescriptors = 2;
-    heapDesc.Type           = D3D12_DESCRIPTOR_HEAP_TYPE_RTV;
-    ThrowIfFailed(m_device->CreateDescriptorHeap(&heapDesc, IID_PPV_ARGS(m_rtvHeap.GetAddressOf())));
-    heapDesc.NumDescriptors = 1;
-    heapDesc.Type           = D3D12_DESCRIPTOR_HEAP_TYPE_DSV;
-    ThrowIfFailed(m_device->CreateDescriptorHeap(&heapDesc, IID_PPV_ARGS(m_dsvHeap.GetAddressOf())));
-
-    // Create back buffer descriptor
-    // Get the first back buffer descriptor handle
-    D3D12_CPU_DESCRIPTOR_HANDLE rtvHandle = m_rtvHeap->GetCPUDescriptorHandleForHeapStart();
-    // Get the pointer of the first back buffer resource
-    ThrowIfFailed(m_swapChain->GetBuffer(0, IID_PPV_ARGS((m_backbuffers[0].GetAddressOf()))));
-    // Create the first buffer descriptor on the first buffer resource
-    m_device->CreateRenderTargetView(m_backbuffers[0].Get(), nullptr, rtvHandle);
-    // Move to second back buffer do the same operation as before
-    rtvHandle.ptr += m_rtvDescriptorSize;
-    ThrowIfFailed(m_swapChain->GetBuffer(1, IID_PPV_ARGS(m_backbuffers[1].GetAddressOf())));
-    m_device->CreateRenderTargetView(m_backbuffers[1].Get(), nullptr, rtvHandle);
-
-    // Create depth buffer resource and descriptor
-    // Create depth buffer resource
-    D3D12_RESOURCE_DESC resourceDesc = {};
-    resourceDesc.Dimension           = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
-    resourceDesc.Width               = m_width;
-    resourceDesc.Height              = m_height;
-    resourceDesc.DepthOrArraySize    = 1;
-    resourceDesc.MipLevels           = 1;
-    resourceDesc.Format              = m_depthBufferFormat;
-    resourceDesc.SampleDesc.Count    = 1;
-    resourceDesc.Flags               = D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL;
-
-    D3D12_CLEAR_VALUE clearValue  = {};
-    clearValue.Format             = m_depthBufferFormat;
-    clearValue.DepthStencil.Depth = 1.f;
-
-    D3D12_HEAP_PROPERTIES heapProperties = {};
-    heapProperties.Type = D3D12_HEAP_TYPE_DEFAULT;
-
-    ThrowIfFailed(m_device->CreateCommittedResource(
-        &heapProperties, 
-        D3D12_HEAP_FLAG_NONE, 
-        &resourceDesc, 
-        D3D12_RESOURCE_STATE_DEPTH_WRITE, 
-        &clearValue, 
-        IID_PPV_ARGS(m_depthBuffer.GetAddressOf())
-    ));
-    
-    // Create depth buffer descriptor
-    D3D12_DEPTH_STENCIL_VIEW_DESC dsvDesc = {};
-    dsvDesc.ViewDimension = D3D12_DSV_DIMENSION_TEXTURE2D;
-    dsvDesc.Format        = m_depthBufferFormat;
-    m_device->CreateDepthStencilView(m_depthBuffer.Get(), &dsvDesc, m_dsvHeap->GetCPUDescriptorHandleForHeapStart());
-
-    // ------------------------------------
-    //  Set viewport and scissor Rectangle
-    // ------------------------------------
-
-    m_viewport.Width     = static_cast<float>(m_width);
-    m_viewport.Height    = static_cast<float>(m_height);
-    m_viewport.MaxDepth  = 1.f;
-
-    m_scissorRect.right  = m_width;
-    m_scissorRect.bottom = m_height;
+    // -----------------------------
+    //  Create device and renderer
+    // -----------------------------
+    // One recording thread per hardware thread, this thread is one of them
+    m_jobSystem = std::make_unique<JobSystem>();
+    m_device    = std::make_unique<D3D12Device>();
+
+    Renderer::Config rendererConfig;
+    rendererConfig.window          = m_hWnd;
+    rendererConfig.width           = m_width;
+    rendererConfig.height          = m_height;
+    rendererConfig.frameCount      = frameCount;
+    rendererConfig.jobSystem       = m_jobSystem.get();
+    rendererConfig.maxFrameLatency = 1;
+    m_renderer = std::make_unique<Renderer>(*m_device, rendererConfig);
+
+    // Start a frame once the previous one has left the present queue, at most at the target rate
+    FramePacer::Config pacerConfig;
+    pacerConfig.mode      = FramePacer::Mode::LatencyTarget;
+    pacerConfig.targetFps = targetFps;
+    m_pacer = std::make_unique<FramePacer>(m_clock, pacerConfig);
 
     // Initialize DirectX12 resources finished, show window
     showWindow(m_hWnd);
@@ -303,175 +144,53 @@ DirectX12::DirectX12(int width, int height)
 
 void DirectX12::run()
 {
-    MSG msg = {};
-
     m_timer.setFunc([this] {
-        SetWindowTextA(this->m_hWnd, std::format("time:{} fps:{} mspf:{:.2f}", (int)m_timer.getTime(), (int)m_timer.getFPS(), m_timer.getMSPF()).c_str());
+        // Average hides hitches, also show tail frame times of recent frames
+        auto summary = m_timer.getHistogram().getSummary();
+        SetWindowTextA(this->m_hWnd, std::format("time:{} fps:{} mspf:{:.2f} p99:{:.2f} max:{:.2f}",
+            (int)m_timer.getTime(), (int)m_timer.getFPS(), m_timer.getMSPF(), summary.p99, summary.max).c_str());
     });
     m_timer.reset();
+    Profiler::setThreadName("Main");
 
-    while (msg.message != WM_QUIT)
+    while (true)
     {
-        if (PeekMessageW(&msg, nullptr, 0, 0, PM_REMOVE))
+        if (m_paused)
         {
-            TranslateMessage(&msg);
-            DispatchMessageW(&msg);
+            // Nothing to draw, sleep until the window gets a message instead of polling
+            // and start a new cadence when drawing resumes
+            WaitMessage();
+            m_pacer->reset();
         }
         else
         {
-            m_timer.update();
-            m_timer.calculateFrameState();
+            m_pacer->waitForNextFrame(&m_renderer->getSwapChain());
+        }
 
-            if (!m_paused)
-            {
-                render();
-            }
-            else
-            {
-                Sleep(100);
-            }
+        // Drain all queued messages right after the wait, so the frame sees the newest input
+        MSG msg = {};
+        while (PeekMessageW(&msg, nullptr, 0, 0, PM_REMOVE))
+        {
+            if (msg.message == WM_QUIT)
+                return;
+            TranslateMessage(&msg);
+            DispatchMessageW(&msg);
         }
+
+        PROFILE_SCOPE("Frame");
+        m_timer.update();
+        m_timer.calculateFrameState();
+        if (!m_paused)
+            render();
     }
 }
 
 void DirectX12::render()
 {
-    // Reset command list and allocator
-    ThrowIfFailed(m_commandAllocator->Reset());
-    ThrowIfFailed(m_commandList->Reset(m_commandAllocator.Get(), nullptr));
-
-    // Reset viewport and scissor rectangle
-    // These need to be reset when the command list is reset
-    m_commandList->RSSetViewports(1, &m_viewport);
-    m_commandList->RSSetScissorRects(1, &m_scissorRect);
-
-    // Convert back buffer state from present to render target
-    D3D12_RESOURCE_BARRIER barrier = {};
-    barrier.Transition.pResource   = m_backbuffers[m_currentBackbufferIndex].Get();
-    barrier.Transition.StateBefore = D3D12_RESOURCE_STATE_PRESENT;
-    barrier.Transition.StateAfter  = D3D12_RESOURCE_STATE_RENDER_TARGET;
-    barrier.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
-    m_commandList->ResourceBarrier(1, &barrier);
-
-    // Clear back buffers and depth buffer
-    auto backBufferDescriptorHandle = m_rtvHeap->GetCPUDescriptorHandleForHeapStart();
-    backBufferDescriptorHandle.ptr += m_currentBackbufferIndex * m_rtvDescriptorSize;
-    auto depthBufferDescriptorHandle = m_dsvHeap->GetCPUDescriptorHandleForHeapStart();
-    // Clear color
-    static constexpr float color[] = { 40.f / 255, 44.f / 255, 52.f / 255, 1.f };
-    m_commandList->ClearRenderTargetView(backBufferDescriptorHandle, color, 0, nullptr);
-    m_commandList->ClearDepthStencilView(depthBufferDescriptorHandle, D3D12_CLEAR_FLAG_DEPTH, 1.f, 0, 0, nullptr);
-
-    // Set render target
-    m_commandList->OMSetRenderTargets(1, &backBufferDescriptorHandle, true, &depthBufferDescriptorHandle);
-
-    // Revert back buffer state
-    barrier.Transition.StateBefore = D3D12_RESOURCE_STATE_RENDER_TARGET;
-    barrier.Transition.StateAfter  = D3D12_RESOURCE_STATE_PRESENT;
-    m_commandList->ResourceBarrier(1, &barrier);
-
-    // Close commit list
-    ThrowIfFailed(m_commandList->Close());
-    // Add command list to queue
-    m_commandQueue->ExecuteCommandLists(1, reinterpret_cast<ID3D12CommandList**>(m_commandList.GetAddressOf()));
-    // Swap buffer
-    ThrowIfFailed(m_swapChain->Present(0, 0));
-    m_currentBackbufferIndex = (m_currentBackbufferIndex + 1) % 2;
-
-    flushCommandQueue();
+    m_renderer->render();
 }
 
 void DirectX12::onResize()
 {
-    // Wait GPU finish commands
-    flushCommandQueue();
-
-    // Reset command list
-    ThrowIfFailed(m_commandList->Reset(m_commandAllocator.Get(), nullptr));
-
-    // Reset back buffers and swap chain
-    m_backbuffers[0].Reset();
-    m_backbuffers[1].Reset();
-
-    ThrowIfFailed(m_swapChain->ResizeBuffers(
-        2, 
-        m_width, m_height, 
-        m_backBufferFormat, 
-        DXGI_SWAP_CHAIN_FLAG_ALLOW_MODE_SWITCH)
-    );
-
-    m_currentBackbufferIndex = 0;
-
-    auto rtvHandle = m_rtvHeap->GetCPUDescriptorHandleForHeapStart();
-    for (int i = 0; i < 2; ++i)
-    {
-        ThrowIfFailed(m_swapChain->GetBuffer(i, IID_PPV_ARGS(m_backbuffers[i].GetAddressOf())));
-        m_device->CreateRenderTargetView(m_backbuffers[i].Get(), nullptr, rtvHandle);
-        rtvHandle.ptr += m_rtvDescriptorSize;
-    }
-
-    // Reset depth buffer and descriptor
-    D3D12_RESOURCE_DESC resourceDesc = {};
-    resourceDesc.Dimension           = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
-    resourceDesc.Width               = m_width;
-    resourceDesc.Height              = m_height;
-    resourceDesc.DepthOrArraySize    = 1;
-    resourceDesc.MipLevels           = 1;
-    resourceDesc.Format              = DXGI_FORMAT_R24G8_TYPELESS;
-    resourceDesc.SampleDesc.Count    = 1;
-    resourceDesc.Flags               = D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL;
-
-    D3D12_CLEAR_VALUE clearVal  = {};
-    clearVal.Format             = m_depthBufferFormat;
-    clearVal.DepthStencil.Depth = 1.f;
-
-    D3D12_HEAP_PROPERTIES heapProperties = {};
-    heapProperties.Type = D3D12_HEAP_TYPE_DEFAULT;
-
-    ThrowIfFailed(m_device->CreateCommittedResource(
-        &heapProperties, 
-        D3D12_HEAP_FLAG_NONE, 
-        &resourceDesc, 
-        D3D12_RESOURCE_STATE_DEPTH_WRITE,
-        &clearVal, 
-        IID_PPV_ARGS(m_depthBuffer.GetAddressOf())
-    ));
-
-    D3D12_DEPTH_STENCIL_VIEW_DESC desc = {};
-    desc.ViewDimension = D3D12_DSV_DIMENSION_TEXTURE2D;
-    desc.Format        = m_depthBufferFormat;
-    m_device->CreateDepthStencilView(m_depthBuffer.Get(), &desc, m_dsvHeap->GetCPUDescriptorHandleForHeapStart());
-
-    // Execute commands
-    ThrowIfFailed(m_commandList->Close());
-    m_commandQueue->ExecuteCommandLists(1, reinterpret_cast<ID3D12CommandList**>(m_commandList.GetAddressOf()));
-
-    flushCommandQueue();
-
-    // Reset viewport and scissor rectangle
-    m_viewport.Width  = static_cast<float>(m_width);
-    m_viewport.Height = static_cast<float>(m_height);
-    m_scissorRect = { 0, 0, m_width, m_height };
+    m_renderer->resize(m_width, m_height);
 }
-
-void DirectX12::flushCommandQueue()
-{
-    // Wait GPU execute complete
-    static UINT64 fence;
-    ++fence;
-    ThrowIfFailed(m_commandQueue->Signal(m_fence.Get(), fence));
-    // Wait until GPU has completed commands up to this fence point
-    if (m_fence->GetCompletedValue() < fence)
-    {
-        HANDLE eventHandle = CreateEventExW(nullptr, nullptr, false, EVENT_ALL_ACCESS);
-        // Fire event when GPU hits current fence
-        ThrowIfFailed(m_fence->SetEventOnCompletion(fence, eventHandle));
-        if (eventHandle == nullptr)
-        {
-            ThrowIfFailed(HRESULT_FROM_WIN32(GetLastError()));
-        }
-        // Wait until GPU hits current fence event is fired
-        WaitForSingleObject(eventHandle, INFINITE);
-        CloseHandle(eventHandle);
-    }
-}
\ No newline at end of file
@@ -0,0 +1,200 @@
+#include "DrawQueue.hpp"
+#include "Profiler.hpp"
+
+#include <cstring>
+#include <algorithm>
+
+using namespace GalgameEngine;
+
+namespace
+{
+    bool isSameView(const VertexBufferView& a, const VertexBufferView& b) noexcept
+    {
+        return a.buffer == b.buffer && a.offset == b.offset && a.size == b.size && a.stride == b.stride;
+    }
+
+    bool isSameView(const IndexBufferView& a, const IndexBufferView& b) noexcept
+    {
+        return a.buffer == b.buffer && a.offset == b.offset && a.size == b.size && a.format == b.format;
+    }
+
+    // Indirect arguments are read as uint32 values
+    constexpr uint64_t ArgumentAlignment = 4;
+}
+
+DrawQueue::DrawQueue(Device& device, UploadRing& uploadRing, PipelineCache& pipelineCache, const Config& config)
+    : m_uploadRing(uploadRing), m_pipelineCache(pipelineCache), m_config(config), m_sorter(config.sort)
+{
+    m_config.laneCount = std::max(m_config.laneCount, 1u);
+    m_lanes = std::make_unique<Lane[]>(m_config.laneCount);
+    if (m_config.indirect)
+        m_signature = device.createCommandSignature(sizeof(DrawIndexedArguments));
+}
+
+RootSignatureDesc DrawQueue::getRootSignatureDesc()
+{
+    RootSignatureDesc desc;
+    desc.parameters.resize(2);
+    desc.parameters[MaterialParameter] = { RootParameterType::ConstantBuffer, ShaderVisibility::All };
+    desc.parameters[InstanceParameter] = { RootParameterType::ShaderResource, ShaderVisibility::Vertex };
+    return desc;
+}
+
+InputElement DrawQueue::getInstanceElement()
+{
+    return { "INSTANCE", 0, Format::R32_UINT, InstanceSlot, 0, true };
+}
+
+uint32_t DrawQueue::addMesh(const DrawMesh& mesh)
+{
+    m_meshes.push_back(mesh);
+    return static_cast<uint32_t>(m_meshes.size() - 1);
+}
+
+uint32_t DrawQueue::addMaterial(uint64_t constants)
+{
+    m_materials.push_back(constants);
+    return static_cast<uint32_t>(m_materials.size() - 1);
+}
+
+void DrawQueue::prepare(JobSystem* jobSystem)
+{
+    PROFILE_SCOPE("DrawQueue::prepare");
+
+    size_t count = 0;
+    for (uint32_t lane = 0; lane < m_config.laneCount; ++lane)
+        count += m_lanes[lane].items.size();
+    m_items.resize(count);
+    count = 0;
+    for (uint32_t lane = 0; lane < m_config.laneCount; ++lane)
+    {
+        auto& items = m_lanes[lane].items;
+        if (!items.empty())
+            std::memcpy(m_items.data() + count, items.data(), items.size() * sizeof(SortItem));
+        count += items.size();
+        items.clear();
+    }
+
+    auto itemCount = static_cast<uint32_t>(count);
+    m_sorter.sort(m_items.data(), itemCount, jobSystem);
+
+    // Neighbours of one state become one batch
+    m_batches.clear();
+    for (uint32_t i = 0; i < itemCount; ++i)
+    {
+        auto state = DrawKey::getState(m_items[i].key);
+        if (m_batches.empty() || m_batches.back().state != state)
+            m_batches.push_back({ state, i, 0 });
+        ++m_batches.back().count;
+    }
+
+    m_stats.items      = itemCount;
+    m_stats.batches    = static_cast<uint32_t>(m_batches.size());
+    m_stats.sortPasses = m_sorter.getStats().passes;
+
+    m_instances = {};
+    m_arguments = {};
+    if (itemCount == 0)
+        return;
+
+    m_instances = m_uploadRing.allocate(static_cast<uint64_t>(itemCount) * sizeof(uint32_t), sizeof(uint32_t));
+    auto instances = reinterpret_cast<uint32_t*>(m_instances.cpuAddress);
+    for (uint32_t i = 0; i < itemCount; ++i)
+        instances[i] = m_items[i].value;
+
+    if (m_config.indirect)
+    {
+        m_arguments = m_uploadRing.allocate(m_batches.size() * sizeof(DrawIndexedArguments), ArgumentAlignment);
+        auto arguments = reinterpret_cast<DrawIndexedArguments*>(m_arguments.cpuAddress);
+        for (size_t i = 0; i < m_batches.size(); ++i)
+        {
+            auto& batch = m_batches[i];
+            auto& mesh  = m_meshes[DrawKey::getMesh(batch.state)];
+            arguments[i] = { mesh.indexCount, batch.count, mesh.startIndex, mesh.baseVertex, batch.first };
+        }
+    }
+}
+
+void DrawQueue::getPassBatches(uint32_t pass, uint32_t& begin, uint32_t& end) const noexcept
+{
+    auto first = std::partition_point(m_batches.begin(), m_batches.end(), [pass](const Batch& batch) { return DrawKey::getPass(batch.state) < pass; });
+    auto last  = std::partition_point(first, m_batches.end(), [pass](const Batch& batch) { return DrawKey::getPass(batch.state) == pass; });
+    begin = static_cast<uint32_t>(first - m_batches.begin());
+    end   = static_cast<uint32_t>(last - m_batches.begin());
+}
+
+DrawQueue::RecordStats DrawQueue::record(CommandList& commandList, RootSignature& rootSignature, uint64_t instanceData,
+                                         uint32_t begin, uint32_t end) const
+{
+    RecordStats stats;
+    if (begin >= end)
+        return stats;
+
+    PROFILE_SCOPE("DrawQueue::record");
+
+    commandList.setGraphicsRootSignature(rootSignature);
+    commandList.setGraphicsRootShaderResourceView(InstanceParameter, instanceData);
+    VertexBufferView instanceView = { m_instances.buffer, m_instances.offset, static_cast<uint32_t>(m_instances.size), sizeof(uint32_t) };
+    commandList.setVertexBuffers(InstanceSlot, &instanceView, 1);
+
+    // Nothing is bound yet in this list
+    PipelineState*  pipeline = nullptr;
+    uint32_t        material = UINT32_MAX;
+    const DrawMesh* mesh     = nullptr;
+    for (uint32_t i = begin; i < end;)
+    {
+        auto& batch = m_batches[i];
+        auto  state = m_pipelineCache.getPipeline(DrawKey::getPipeline(batch.state));
+        if (state == nullptr)
+        {
+            stats.skipped += batch.count;
+            ++i;
+            continue;
+        }
+
+        if (state != pipeline)
+        {
+            commandList.setPipelineState(*state);
+            pipeline = state;
+            ++stats.pipelineChanges;
+        }
+        auto batchMaterial = DrawKey::getMaterial(batch.state);
+        if (batchMaterial != material)
+        {
+            commandList.setGraphicsRootConstantBufferView(MaterialParameter, m_materials[batchMaterial]);
+            material = batchMaterial;
+            ++stats.materialChanges;
+        }
+        auto& batchMesh = m_meshes[DrawKey::getMesh(batch.state)];
+        if (mesh == nullptr || !isSameView(mesh->vertices, batchMesh.vertices) || !isSameView(mesh->indices, batchMesh.indices))
+        {
+            commandList.setVertexBuffers(0, &batchMesh.vertices, 1);
+            commandList.setIndexBuffer(batchMesh.indices);
+            ++stats.meshChanges;
+        }
+        mesh = &batchMesh;
+
+        if (!m_config.indirect)
+        {
+            commandList.drawIndexedInstanced(batchMesh.indexCount, batch.count, batchMesh.startIndex, batchMesh.baseVertex, batch.first);
+            ++stats.draws;
+            ++i;
+            continue;
+        }
+
+        // Following batches of the same pipeline, material and buffers only differ in their arguments
+        uint32_t last = i + 1;
+        for (; last < end; ++last)
+        {
+            auto& next     = m_batches[last];
+            auto& nextMesh = m_meshes[DrawKey::getMesh(next.state)];
+            if (m_pipelineCache.getPipeline(DrawKey::getPipeline(next.state)) != pipeline || DrawKey::getMaterial(next.state) != material ||
+                !isSameView(nextMesh.vertices, batchMesh.vertices) || !isSameView(nextMesh.indices, batchMesh.indices))
+                break;
+        }
+        commandList.executeIndirect(*m_signature, last - i, *m_arguments.buffer, m_arguments.offset + i * sizeof(DrawIndexedArguments), nullptr, 0);
+        ++stats.draws;
+        i = last;
+    }
+    return stats;
+}
@@ -0,0 +1,256 @@
+#include "EntityStore.hpp"
+
+#include <mutex>
+#include <cstring>
+#include <stdexcept>
+#include <algorithm>
+
+using namespace GalgameEngine;
+
+// ---------------
+//  ComponentTypes
+// ---------------
+
+namespace
+{
+    std::mutex           s_typeMutex;
+    ComponentTypes::Info s_types[ComponentTypes::MaxTypes];
+    uint32_t             s_typeCount = 0;
+
+    constexpr uint32_t ArrayAlignment = 16;
+
+    uint32_t alignUp(uint32_t value, uint32_t alignment) noexcept
+    {
+        return (value + alignment - 1) & ~(alignment - 1);
+    }
+}
+
+uint32_t ComponentTypes::registerType(const Info& info)
+{
+    std::lock_guard lock(s_typeMutex);
+
+    if (s_typeCount == MaxTypes)
+        throw std::runtime_error("Too many component types");
+    if (info.alignment > ArrayAlignment)
+        throw std::runtime_error("Component alignment above 16 bytes");
+    s_types[s_typeCount] = info;
+    return s_typeCount++;
+}
+
+ComponentTypes::Info ComponentTypes::getInfo(uint32_t id) noexcept
+{
+    std::lock_guard lock(s_typeMutex);
+    return s_types[id];
+}
+
+// ------------
+//  EntityStore
+// ------------
+
+Entity EntityStore::create(ComponentMask mask)
+{
+    auto& archetype = getArchetype(mask);
+    auto  entity    = allocateEntity();
+    addRow(archetype, entity, m_slots[entity.index]);
+    ++m_entityCount;
+    return entity;
+}
+
+void EntityStore::create(ComponentMask mask, uint32_t count, Entity* entities)
+{
+    auto& archetype = getArchetype(mask);
+    m_slots.reserve(m_slots.size() + (count > m_freeSlots.size() ? count - m_freeSlots.size() : 0));
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        entities[i] = allocateEntity();
+        addRow(archetype, entities[i], m_slots[entities[i].index]);
+    }
+    m_entityCount += count;
+}
+
+void EntityStore::destroy(Entity entity)
+{
+    if (!isAlive(entity))
+        return;
+
+    auto& slot = m_slots[entity.index];
+    removeRow(*slot.archetype, slot.chunk, slot.row);
+
+    slot.archetype = nullptr;
+    ++slot.generation;
+    m_freeSlots.push_back(entity.index);
+    --m_entityCount;
+}
+
+bool EntityStore::isAlive(Entity entity) const noexcept
+{
+    return entity.index < m_slots.size() && m_slots[entity.index].archetype &&
+           m_slots[entity.index].generation == entity.generation;
+}
+
+EntityStore::Stats EntityStore::getStats() const noexcept
+{
+    Stats stats;
+    stats.entities   = m_entityCount;
+    stats.archetypes = static_cast<uint32_t>(m_archetypeList.size());
+    stats.moves      = m_moves;
+    for (auto archetype : m_archetypeList)
+        stats.chunks += static_cast<uint32_t>(archetype->chunks.size());
+    return stats;
+}
+
+EntityStore::Archetype& EntityStore::getArchetype(ComponentMask mask)
+{
+    auto& archetype = m_archetypes[mask];
+    if (archetype)
+        return *archetype;
+
+    archetype       = std::make_unique<Archetype>();
+    archetype->mask = mask;
+    std::memset(archetype->slots, 0xFF, sizeof(archetype->slots));
+
+    uint32_t rowSize = sizeof(Entity);
+    for (uint32_t type = 0; type < ComponentTypes::MaxTypes; ++type)
+    {
+        if (!((mask >> type) & 1))
+            continue;
+        auto info = ComponentTypes::getInfo(type);
+        archetype->slots[type] = static_cast<uint8_t>(archetype->types.size());
+        archetype->types.push_back(type);
+        archetype->sizes.push_back(info.size);
+        rowSize += info.size;
+    }
+
+    // Entities first, then one array per component, every array starts on 16 bytes so that
+    // the padding is bounded by 16 bytes per array
+    uint32_t padding = ArrayAlignment * static_cast<uint32_t>(archetype->types.size() + 1);
+    archetype->capacity = (ChunkSize - padding) / rowSize;
+    if (archetype->capacity == 0)
+        throw std::runtime_error("Archetype row does not fit a chunk");
+
+    uint32_t offset = alignUp(sizeof(Entity) * archetype->capacity, ArrayAlignment);
+    for (auto size : archetype->sizes)
+    {
+        archetype->offsets.push_back(offset);
+        offset = alignUp(offset + size * archetype->capacity, ArrayAlignment);
+    }
+
+    m_archetypeList.push_back(archetype.get());
+    return *archetype;
+}
+
+Entity EntityStore::allocateEntity()
+{
+    if (!m_freeSlots.empty())
+    {
+        auto index = m_freeSlots.back();
+        m_freeSlots.pop_back();
+        return { index, m_slots[index].generation };
+    }
+    m_slots.emplace_back();
+    return { static_cast<uint32_t>(m_slots.size() - 1), 0 };
+}
+
+void EntityStore::addRow(Archetype& archetype, Entity entity, Slot& slot)
+{
+    if (archetype.chunks.empty() || archetype.chunks.back()->count == archetype.capacity)
+    {
+        auto chunk     = std::make_unique<Chunk>();
+        chunk->storage = std::make_unique<ChunkStorage>();
+        chunk->versions.resize(archetype.types.size());
+        archetype.chunks.push_back(std::move(chunk));
+    }
+
+    auto& chunk = *archetype.chunks.back();
+    auto  row   = chunk.count++;
+    auto  bytes = chunk.storage->bytes;
+    reinterpret_cast<Entity*>(bytes)[row] = entity;
+    for (size_t i = 0; i < archetype.types.size(); ++i)
+    {
+        std::memset(bytes + archetype.offsets[i] + archetype.sizes[i] * row, 0, archetype.sizes[i]);
+        chunk.versions[i] = m_version;
+    }
+
+    slot.archetype = &archetype;
+    slot.chunk     = static_cast<uint32_t>(archetype.chunks.size() - 1);
+    slot.row       = row;
+}
+
+void EntityStore::removeRow(Archetype& archetype, uint32_t chunkIndex, uint32_t row)
+{
+    auto& last    = *archetype.chunks.back();
+    auto  lastRow = last.count - 1;
+    auto& chunk   = *archetype.chunks[chunkIndex];
+
+    if (&chunk != &last || row != lastRow)
+    {
+        auto moved = reinterpret_cast<Entity*>(last.storage->bytes)[lastRow];
+        reinterpret_cast<Entity*>(chunk.storage->bytes)[row] = moved;
+        for (size_t i = 0; i < archetype.types.size(); ++i)
+        {
+            auto size = archetype.sizes[i];
+            std::memcpy(chunk.storage->bytes + archetype.offsets[i] + size * row,
+                        last.storage->bytes + archetype.offsets[i] + size * lastRow, size);
+            // Consumers of this chunk have not seen the moved row at this place
+            chunk.versions[i] = m_version;
+        }
+
+        auto& slot = m_slots[moved.index];
+        slot.chunk = chunkIndex;
+        slot.row   = row;
+        ++m_moves;
+    }
+
+    if (--last.count == 0)
+        archetype.chunks.pop_back();
+}
+
+void EntityStore::changeArchetype(Entity entity, uint32_t type, bool add)
+{
+    if (!isAlive(entity))
+        return;
+
+    auto& slot   = m_slots[entity.index];
+    auto& source = *slot.archetype;
+    auto  bit    = ComponentMask(1) << type;
+    auto  mask   = add ? source.mask | bit : source.mask & ~bit;
+    if (mask == source.mask)
+        return;
+
+    auto& target      = getArchetype(mask);
+    auto  sourceChunk = slot.chunk;
+    auto  sourceRow   = slot.row;
+    addRow(target, entity, slot);
+
+    // Components in both archetypes go along, the new one stays zeroed
+    auto src = source.chunks[sourceChunk]->storage->bytes;
+    auto dst = target.chunks[slot.chunk]->storage->bytes;
+    for (size_t i = 0; i < target.types.size(); ++i)
+    {
+        auto from = source.slots[target.types[i]];
+        if (from == 0xFF)
+            continue;
+        auto size = target.sizes[i];
+        std::memcpy(dst + target.offsets[i] + size * slot.row, src + source.offsets[from] + size * sourceRow, size);
+    }
+
+    removeRow(source, sourceChunk, sourceRow);
+    ++m_moves;
+}
+
+void* EntityStore::getComponent(Entity entity, uint32_t type, bool write) noexcept
+{
+    if (!isAlive(entity))
+        return nullptr;
+
+    auto& slot      = m_slots[entity.index];
+    auto& archetype = *slot.archetype;
+    auto  index     = archetype.slots[type];
+    if (index == 0xFF)
+        return nullptr;
+
+    auto& chunk = *archetype.chunks[slot.chunk];
+    if (write)
+        chunk.versions[index] = m_version;
+    return chunk.storage->bytes + archetype.offsets[index] + archetype.sizes[index] * slot.row;
+}
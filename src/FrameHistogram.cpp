@@ -0,0 +1,123 @@
+#include "FrameHistogram.hpp"
+
+#include <bit>
+#include <cmath>
+#include <algorithm>
+
+#include <assert.h>
+
+using namespace GalgameEngine;
+
+FrameHistogram::FrameHistogram(uint32_t windowSize)
+    : m_windowSize(windowSize),
+      m_samples(std::make_unique<std::atomic<uint32_t>[]>(windowSize)),
+      m_buckets(std::make_unique<std::atomic<uint32_t>[]>(BucketCount))
+{
+    assert(windowSize > 0);
+    clear();
+}
+
+void FrameHistogram::record(double seconds) noexcept
+{
+    double us      = std::clamp(seconds * 1e6, 0.0, static_cast<double>(UINT32_MAX));
+    auto   sample  = static_cast<uint32_t>(us);
+    auto   count   = m_count.load(std::memory_order_relaxed);
+
+    // Window is full, the oldest sample leaves its bucket
+    if (count == m_windowSize)
+    {
+        auto old = m_samples[m_next].load(std::memory_order_relaxed);
+        m_buckets[bucketIndex(old)].fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    m_samples[m_next].store(sample, std::memory_order_relaxed);
+    m_buckets[bucketIndex(sample)].fetch_add(1, std::memory_order_relaxed);
+    m_next = (m_next + 1) % m_windowSize;
+
+    if (count < m_windowSize)
+        m_count.store(count + 1, std::memory_order_release);
+    else
+        std::atomic_thread_fence(std::memory_order_release);
+}
+
+void FrameHistogram::clear() noexcept
+{
+    for (uint32_t i = 0; i < m_windowSize; ++i)
+        m_samples[i].store(0, std::memory_order_relaxed);
+    for (uint32_t i = 0; i < BucketCount; ++i)
+        m_buckets[i].store(0, std::memory_order_relaxed);
+    m_next = 0;
+    m_count.store(0, std::memory_order_release);
+}
+
+float FrameHistogram::getPercentile(float fraction) const noexcept
+{
+    auto total = getCount();
+    if (total == 0)
+        return 0.f;
+    return std::min(percentileOf(fraction, total) / 1000.f, getMax());
+}
+
+float FrameHistogram::getMax() const noexcept
+{
+    auto     count = getCount();
+    uint32_t max   = 0;
+    for (uint32_t i = 0; i < count; ++i)
+        max = std::max(max, m_samples[i].load(std::memory_order_relaxed));
+    return max / 1000.f;
+}
+
+FrameHistogram::Summary FrameHistogram::getSummary(float stutterFactor) const noexcept
+{
+    Summary summary;
+    summary.count = getCount();
+    if (summary.count == 0)
+        return summary;
+
+    summary.max = getMax();
+    summary.p50 = std::min(percentileOf(0.50f, summary.count) / 1000.f, summary.max);
+    summary.p95 = std::min(percentileOf(0.95f, summary.count) / 1000.f, summary.max);
+    summary.p99 = std::min(percentileOf(0.99f, summary.count) / 1000.f, summary.max);
+
+    auto threshold = static_cast<uint32_t>(summary.p50 * 1000.f * stutterFactor);
+    for (uint32_t i = 0; i < summary.count; ++i)
+    {
+        if (m_samples[i].load(std::memory_order_relaxed) > threshold)
+            ++summary.stutterCount;
+    }
+    return summary;
+}
+
+uint32_t FrameHistogram::bucketIndex(uint32_t us) noexcept
+{
+    // Values below SubBuckets are exact, then every power of two is split into SubBuckets buckets
+    if (us < SubBuckets)
+        return us;
+    uint32_t exponent = 31 - std::countl_zero(us);
+    uint32_t sub      = (us >> (exponent - SubBucketBits)) & (SubBuckets - 1);
+    return (exponent - SubBucketBits + 1) * SubBuckets + sub;
+}
+
+uint32_t FrameHistogram::bucketUpperBound(uint32_t index) noexcept
+{
+    if (index < SubBuckets)
+        return index;
+    uint32_t exponent = index / SubBuckets + SubBucketBits - 1;
+    uint32_t sub      = index % SubBuckets;
+    uint64_t lower    = static_cast<uint64_t>(SubBuckets + sub) << (exponent - SubBucketBits);
+    uint64_t width    = 1ull << (exponent - SubBucketBits);
+    return static_cast<uint32_t>(std::min<uint64_t>(lower + width - 1, UINT32_MAX));
+}
+
+uint32_t FrameHistogram::percentileOf(float fraction, uint32_t total) const noexcept
+{
+    auto     target     = std::max<uint32_t>(1, static_cast<uint32_t>(std::ceil(fraction * total)));
+    uint32_t cumulative = 0;
+    for (uint32_t i = 0; i < BucketCount; ++i)
+    {
+        cumulative += m_buckets[i].load(std::memory_order_relaxed);
+        if (cumulative >= target)
+            return bucketUpperBound(i);
+    }
+    return bucketUpperBound(BucketCount - 1);
+}
@@ -0,0 +1,201 @@
+#include "FramePacer.hpp"
+#include "Device.hpp"
+#include "Timer.hpp"
+#include "Profiler.hpp"
+
+#include <cmath>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+
+#ifdef _WIN32
+    #include <Windows.h>
+    #ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+        #define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+    #endif
+#endif
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+    #include <immintrin.h>
+#endif
+
+using namespace GalgameEngine;
+
+namespace
+{
+    // Requested duration of one sleep, the time left is covered by several of them
+    constexpr double SleepQuantum = 0.001;
+
+    // Weight of a new sample in the running sleep statistics, follows a changed timer resolution in ~100 sleeps
+    constexpr double SleepAlpha = 1.0 / 32.0;
+
+    // A frame starting later than this after its deadline counts as late
+    constexpr double LateThreshold = 0.001;
+}
+
+// -----------------
+//  SystemFrameClock
+// -----------------
+
+SystemFrameClock::SystemFrameClock()
+{
+#ifdef _WIN32
+    // Sleep() wakes on the 15.6ms system tick by default, the high resolution timer (Windows 10 1803+) does not
+    m_timer = CreateWaitableTimerExW(nullptr, nullptr, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+#endif
+}
+
+SystemFrameClock::~SystemFrameClock()
+{
+#ifdef _WIN32
+    if (m_timer != nullptr)
+        CloseHandle(m_timer);
+#endif
+}
+
+int64_t SystemFrameClock::now()
+{
+    return Timer::now();
+}
+
+double SystemFrameClock::getSecondsPerCount() const
+{
+    return Timer::getSecondsPerCount();
+}
+
+void SystemFrameClock::sleep(double seconds)
+{
+#ifdef _WIN32
+    if (m_timer != nullptr)
+    {
+        // Negative due time is relative, in 100ns units
+        LARGE_INTEGER dueTime;
+        dueTime.QuadPart = -static_cast<LONGLONG>(seconds * 1e7);
+        if (SetWaitableTimerEx(m_timer, &dueTime, 0, nullptr, nullptr, nullptr, 0))
+        {
+            WaitForSingleObject(m_timer, INFINITE);
+            return;
+        }
+    }
+#endif
+    std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+}
+
+void SystemFrameClock::spin()
+{
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+    _mm_pause();
+#else
+    std::this_thread::yield();
+#endif
+}
+
+// --------------------
+//  SimulatedFrameClock
+// --------------------
+
+void SimulatedFrameClock::sleep(double seconds)
+{
+    // Wake on the first timer tick after the requested time, then wait to be scheduled
+    auto period = static_cast<int64_t>(m_config.timerPeriod * 1e9);
+    auto target = m_now + static_cast<int64_t>(seconds * 1e9);
+    if (period > 0)
+        target = (target + period - 1) / period * period;
+
+    std::uniform_real_distribution<double> jitter(0.0, m_config.wakeJitter);
+    m_now = std::max(target, m_now) + static_cast<int64_t>(jitter(m_random) * 1e9);
+}
+
+// -----------
+//  FramePacer
+// -----------
+
+FramePacer::FramePacer(FrameClock& clock, const Config& config)
+    : m_clock(clock)
+{
+    m_stats.sleepEstimate = m_sleepMean;
+    setConfig(config);
+}
+
+void FramePacer::waitForNextFrame(SwapChain* swapChain)
+{
+    PROFILE_SCOPE("FramePacer::waitForNextFrame");
+
+    if (m_config.mode == Mode::LatencyTarget && swapChain != nullptr)
+        swapChain->waitForFrameLatency();
+
+    ++m_stats.frames;
+    if (m_period == 0)
+        return;
+
+    auto now = m_clock.now();
+    if (m_deadline == 0)
+        m_deadline = now;
+
+    // Too late to keep the cadence, start a new one instead of running the missed frames back to back
+    if (now - m_deadline > m_period)
+    {
+        ++m_stats.lateFrames;
+        m_deadline = now + m_period;
+        return;
+    }
+
+    waitUntil(m_deadline);
+
+    double error = std::abs(static_cast<double>(m_clock.now() - m_deadline)) * m_clock.getSecondsPerCount();
+    m_stats.totalError += error;
+    m_stats.maxError    = std::max(m_stats.maxError, error);
+    if (error > LateThreshold)
+        ++m_stats.lateFrames;
+
+    m_deadline += m_period;
+}
+
+void FramePacer::reset() noexcept
+{
+    m_deadline = 0;
+}
+
+void FramePacer::setConfig(const Config& config) noexcept
+{
+    m_config = config;
+    m_period = 0;
+    if (config.mode != Mode::Unlimited && config.targetFps > 0.0)
+        m_period = static_cast<int64_t>(1.0 / (config.targetFps * m_clock.getSecondsPerCount()));
+    reset();
+}
+
+void FramePacer::waitUntil(int64_t deadline)
+{
+    double secondsPerCount = m_clock.getSecondsPerCount();
+
+    // Sleep while even a late wake up would come before the deadline
+    while (true)
+    {
+        double remaining = (deadline - m_clock.now()) * secondsPerCount;
+        if (remaining <= m_stats.sleepEstimate)
+            break;
+
+        auto begin = m_clock.now();
+        m_clock.sleep(SleepQuantum);
+        double slept = (m_clock.now() - begin) * secondsPerCount;
+
+        ++m_stats.sleeps;
+        m_stats.sleepSeconds += slept;
+        recordSleep(slept);
+    }
+
+    auto spinBegin = m_clock.now();
+    while (m_clock.now() < deadline)
+        m_clock.spin();
+    m_stats.spinSeconds += (m_clock.now() - spinBegin) * secondsPerCount;
+}
+
+void FramePacer::recordSleep(double seconds) noexcept
+{
+    // Exponentially weighted mean and variance
+    double delta = seconds - m_sleepMean;
+    m_sleepMean     += SleepAlpha * delta;
+    m_sleepVariance  = (1.0 - SleepAlpha) * (m_sleepVariance + SleepAlpha * delta * delta);
+    m_stats.sleepEstimate = m_sleepMean + 2.0 * std::sqrt(m_sleepVariance);
+}
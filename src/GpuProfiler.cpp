@@ -0,0 +1,141 @@
+#include "GpuProfiler.hpp"
+#include "Timer.hpp"
+
+#include <algorithm>
+
+using namespace GalgameEngine;
+
+GpuProfiler::GpuProfiler(Device& device, CommandQueue& queue, const Config& config, const char* trackName)
+    : m_device(device),
+      m_queue(queue),
+      m_config(config),
+      m_track(Profiler::createTrack(trackName)),
+      m_slots(std::max(config.frameCount, 1u))
+{
+    // Two timestamps per marker, resolved to 8 bytes each
+    BufferDesc desc;
+    desc.size     = static_cast<uint64_t>(m_config.maxMarkers) * 2 * sizeof(uint64_t);
+    desc.heapType = HeapType::Readback;
+    for (auto& slot : m_slots)
+    {
+        slot.queryHeap = m_device.createTimestampQueryHeap(m_config.maxMarkers * 2);
+        slot.readback  = m_device.createBuffer(desc, ResourceState::CopyDest);
+        slot.names.resize(m_config.maxMarkers);
+        slot.ended.resize(m_config.maxMarkers);
+    }
+    calibrate();
+}
+
+void GpuProfiler::beginFrame()
+{
+    PROFILE_SCOPE("GpuProfiler::beginFrame");
+
+    m_slot = &m_slots[m_frame % m_slots.size()];
+    if (m_slot->pending)
+    {
+        // Never wait, a frame GPU has not finished yet is given up
+        if (m_queue.getCompletedValue() >= m_slot->fenceValue)
+            readBack(*m_slot);
+        else
+            ++m_stats.lostFrames;
+        m_slot->pending = false;
+    }
+
+    if (m_config.calibrationInterval != 0 && m_frame % m_config.calibrationInterval == 0 && m_frame != 0)
+        calibrate();
+
+    std::fill(m_slot->ended.begin(), m_slot->ended.end(), 0);
+    m_nextMarker.store(0, std::memory_order_relaxed);
+}
+
+uint32_t GpuProfiler::beginMarker(CommandList& list, const char* name)
+{
+    if (m_slot == nullptr)
+        return InvalidMarker;
+    auto marker = m_nextMarker.fetch_add(1, std::memory_order_relaxed);
+    if (marker >= m_config.maxMarkers)
+        return InvalidMarker;
+
+    m_slot->names[marker] = name;
+    list.writeTimestamp(*m_slot->queryHeap, marker * 2);
+    return marker;
+}
+
+void GpuProfiler::endMarker(CommandList& list, uint32_t marker)
+{
+    if (marker == InvalidMarker)
+        return;
+    list.writeTimestamp(*m_slot->queryHeap, marker * 2 + 1);
+    m_slot->ended[marker] = 1;
+}
+
+void GpuProfiler::endFrame(CommandList& list)
+{
+    if (m_slot == nullptr)
+        return;
+
+    auto count = m_nextMarker.load(std::memory_order_relaxed);
+    if (count > m_config.maxMarkers)
+    {
+        m_stats.droppedMarkers += count - m_config.maxMarkers;
+        count = m_config.maxMarkers;
+    }
+    m_slot->markerCount = count;
+    if (count > 0)
+        list.resolveTimestamps(*m_slot->queryHeap, 0, count * 2, *m_slot->readback, 0);
+}
+
+void GpuProfiler::finishFrame(uint64_t fenceValue)
+{
+    if (m_slot != nullptr)
+    {
+        m_slot->fenceValue = fenceValue;
+        m_slot->pending    = m_slot->markerCount > 0;
+        m_slot             = nullptr;
+    }
+    ++m_frame;
+}
+
+void GpuProfiler::calibrate()
+{
+    m_calibration       = m_queue.getClockCalibration();
+    m_ticksPerTimestamp = 1.0 / (static_cast<double>(m_queue.getTimestampFrequency()) * Timer::getSecondsPerCount());
+    ++m_stats.calibrations;
+}
+
+void GpuProfiler::readBack(Slot& slot)
+{
+    auto timestamps = reinterpret_cast<const uint64_t*>(slot.readback->getMappedData());
+
+    m_markers.clear();
+    int64_t first = INT64_MAX;
+    int64_t last  = INT64_MIN;
+    for (uint32_t i = 0; i < slot.markerCount; ++i)
+    {
+        if (!slot.ended[i])
+            continue;
+        Marker marker = { slot.names[i], toTicks(timestamps[i * 2]), toTicks(timestamps[i * 2 + 1]) };
+        first = std::min(first, marker.begin);
+        last  = std::max(last, marker.end);
+        m_markers.push_back(marker);
+    }
+    ++m_stats.resolvedFrames;
+    if (m_markers.empty())
+        return;
+    m_stats.frameGpuTime = static_cast<double>(last - first) * Timer::getSecondsPerCount();
+
+    if (Profiler::isEnabled())
+    {
+        m_events.clear();
+        for (auto& marker : m_markers)
+            m_events.push_back({ marker.name, marker.begin, marker.end, 0 });
+        Profiler::addEvents(m_track, m_events.data(), static_cast<uint32_t>(m_events.size()));
+    }
+}
+
+int64_t GpuProfiler::toTicks(uint64_t timestamp) const noexcept
+{
+    // Timestamps before the calibration come out negative
+    auto delta = static_cast<int64_t>(timestamp - m_calibration.gpuTimestamp);
+    return m_calibration.cpuTicks + static_cast<int64_t>(static_cast<double>(delta) * m_ticksPerTimestamp);
+}
@@ -0,0 +1,126 @@
+#include "InstanceUploader.hpp"
+#include "TransformSystem.hpp"
+#include "Profiler.hpp"
+
+#include <cstring>
+#include <algorithm>
+
+using namespace GalgameEngine;
+
+static_assert(sizeof(LocalToWorld) == InstanceUploader::InstanceSize);
+
+InstanceUploader::InstanceUploader(Device& device, UploadRing& uploadRing)
+    : m_device(device), m_uploadRing(uploadRing)
+{
+}
+
+void InstanceUploader::reserve(const EntityStore& store)
+{
+    if (store.getIndexCount() > m_capacity)
+        grow(store.getIndexCount());
+}
+
+void InstanceUploader::record(EntityStore& store, CommandList& commandList, ResourceStateTracker& tracker)
+{
+    PROFILE_SCOPE("InstanceUploader::record");
+
+    m_stats.instances = 0;
+    m_stats.bytes     = 0;
+    m_stats.copies    = 0;
+
+    // A new buffer starts empty, everything is uploaded again
+    reserve(store);
+
+    EntityStore::Query query;
+    query.all          = makeComponentMask<LocalToWorld>();
+    query.changed      = query.all;
+    query.changedAfter = m_lastVersion;
+
+    uint64_t instances = 0;
+    m_chunks.clear();
+    store.forEachChunk(query,
+        [this, &instances](EntityStore::ChunkView& chunk)
+        {
+            m_chunks.push_back(chunk);
+            instances += chunk.getCount();
+        });
+    m_lastVersion = store.nextVersion();
+    if (instances == 0)
+        return;
+
+    // One staging block for the frame, copies are cut where entity indices are not consecutive
+    auto staging = m_uploadRing.allocate(instances * InstanceSize, 16);
+    tracker.transition(*m_buffer, ResourceState::CopyDest);
+    tracker.flush(commandList);
+
+    uint64_t stagingRow = 0;
+    uint64_t runSource  = 0;
+    uint64_t runDest    = 0;
+    uint64_t runCount   = 0;
+    auto flushRun = [&]()
+    {
+        if (runCount == 0)
+            return;
+        commandList.copyBufferRegion(*m_buffer, runDest * InstanceSize, *staging.buffer,
+                                     staging.offset + runSource * InstanceSize, runCount * InstanceSize);
+        ++m_stats.copies;
+        runCount = 0;
+    };
+
+    for (auto& chunk : m_chunks)
+    {
+        auto count    = chunk.getCount();
+        auto entities = chunk.getEntities();
+        std::memcpy(staging.cpuAddress + stagingRow * InstanceSize, chunk.read<LocalToWorld>(), count * InstanceSize);
+        for (uint32_t i = 0; i < count; ++i, ++stagingRow)
+        {
+            if (runCount > 0 && entities[i].index == runDest + runCount)
+            {
+                ++runCount;
+                continue;
+            }
+            flushRun();
+            runSource = stagingRow;
+            runDest   = entities[i].index;
+            runCount  = 1;
+        }
+    }
+    flushRun();
+
+    tracker.transition(*m_buffer, ResourceState::ShaderResource);
+    tracker.flush(commandList);
+
+    m_stats.instances = instances;
+    m_stats.bytes     = instances * InstanceSize;
+}
+
+void InstanceUploader::finishFrame(uint64_t fenceValue)
+{
+    for (auto& buffer : m_replaced)
+        m_retired.push_back({ std::move(buffer), fenceValue });
+    m_replaced.clear();
+
+    auto completedValue = m_device.getQueue().getCompletedValue();
+    while (!m_retired.empty() && m_retired.front().fenceValue <= completedValue)
+        m_retired.pop_front();
+}
+
+void InstanceUploader::grow(uint32_t indexCount)
+{
+    PROFILE_SCOPE("InstanceUploader::grow");
+
+    // Half again as many, so a growing scene does not upload everything every frame
+    auto capacity = std::max<uint64_t>(indexCount, m_capacity + m_capacity / 2);
+
+    BufferDesc desc = {};
+    desc.size     = capacity * InstanceSize;
+    desc.heapType = HeapType::Default;
+    if (m_buffer)
+        m_replaced.push_back(std::move(m_buffer));
+    m_buffer   = m_device.createBuffer(desc, ResourceState::Common);
+    m_capacity = capacity;
+
+    m_lastVersion    = 0;
+    m_stats.capacity = capacity;
+    ++m_stats.grows;
+}
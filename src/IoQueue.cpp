@@ -0,0 +1,531 @@
+#include "IoQueue.hpp"
+
+#include <mutex>
+#include <deque>
+#include <atomic>
+#include <thread>
+#include <cstring>
+#include <system_error>
+#include <condition_variable>
+
+#ifdef _WIN32
+    #include "Util.hpp"
+#else
+    #include <cerrno>
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <sys/uio.h>
+    #include <sys/stat.h>
+#endif
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+    #include <sys/mman.h>
+    #include <sys/syscall.h>
+    #include <linux/io_uring.h>
+    #define IO_QUEUE_URING 1
+#endif
+
+using namespace GalgameEngine;
+
+#ifdef _WIN32
+const IoQueue::FileHandle IoQueue::InvalidFile = INVALID_HANDLE_VALUE;
+#else
+const IoQueue::FileHandle IoQueue::InvalidFile = -1;
+#endif
+
+struct IoQueue::Request
+{
+#ifdef _WIN32
+    OVERLAPPED overlapped;      // First member, a completion gives its address back
+#else
+    iovec      vector;          // Piece handed to io_uring
+#endif
+    FileHandle file     = InvalidFile;
+    uint64_t   offset   = 0;
+    uint8_t*   dest     = nullptr;
+    uint64_t   size     = 0;
+    uint64_t   done     = 0;    // Bytes read so far
+    uint64_t   userData = 0;
+    int64_t    error    = 0;    // Negative OS error code
+    uint32_t   pieces   = 0;    // Reads handed to the OS
+};
+
+#ifdef IO_QUEUE_URING
+// Rings shared with the kernel, set up with raw system calls so there is no liburing dependency
+struct IoQueue::Uring
+{
+    int           fd         = -1;
+    void*         sqRing     = MAP_FAILED;
+    size_t        sqRingSize = 0;
+    void*         cqRing     = MAP_FAILED;
+    size_t        cqRingSize = 0;
+    io_uring_sqe* sqes       = static_cast<io_uring_sqe*>(MAP_FAILED);
+    size_t        sqesSize   = 0;
+
+    uint32_t*     sqTail  = nullptr;
+    uint32_t*     sqMask  = nullptr;
+    uint32_t*     sqArray = nullptr;
+    uint32_t*     cqHead  = nullptr;
+    uint32_t*     cqTail  = nullptr;
+    uint32_t*     cqMask  = nullptr;
+    io_uring_cqe* cqes    = nullptr;
+    uint32_t      pending = 0;      // Queued entries the kernel has not taken yet
+
+    ~Uring()
+    {
+        if (sqes != MAP_FAILED)
+            munmap(sqes, sqesSize);
+        if (cqRing != MAP_FAILED && cqRing != sqRing)
+            munmap(cqRing, cqRingSize);
+        if (sqRing != MAP_FAILED)
+            munmap(sqRing, sqRingSize);
+        if (fd >= 0)
+            close(fd);
+    }
+
+    // False when the kernel has no io_uring or does not let us use it
+    bool init(uint32_t entries)
+    {
+        io_uring_params params = {};
+        fd = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+        if (fd < 0)
+            return false;
+
+        sqRingSize = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+        cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        bool single = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if (single)
+            sqRingSize = cqRingSize = sqRingSize > cqRingSize ? sqRingSize : cqRingSize;
+
+        sqRing = mmap(nullptr, sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+        if (sqRing == MAP_FAILED)
+            return false;
+        cqRing = single ? sqRing : mmap(nullptr, cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+        if (cqRing == MAP_FAILED)
+            return false;
+        sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+        sqes     = static_cast<io_uring_sqe*>(mmap(nullptr, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES));
+        if (sqes == MAP_FAILED)
+            return false;
+
+        auto sq = static_cast<uint8_t*>(sqRing);
+        auto cq = static_cast<uint8_t*>(cqRing);
+        sqTail  = reinterpret_cast<uint32_t*>(sq + params.sq_off.tail);
+        sqMask  = reinterpret_cast<uint32_t*>(sq + params.sq_off.ring_mask);
+        sqArray = reinterpret_cast<uint32_t*>(sq + params.sq_off.array);
+        cqHead  = reinterpret_cast<uint32_t*>(cq + params.cq_off.head);
+        cqTail  = reinterpret_cast<uint32_t*>(cq + params.cq_off.tail);
+        cqMask  = reinterpret_cast<uint32_t*>(cq + params.cq_off.ring_mask);
+        cqes    = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+        return true;
+    }
+
+    // Return the number of entries taken by the kernel, or -errno
+    int enter(uint32_t submit, uint32_t minComplete) noexcept
+    {
+        uint32_t flags  = minComplete > 0 ? IORING_ENTER_GETEVENTS : 0;
+        auto     result = syscall(__NR_io_uring_enter, fd, submit, minComplete, flags, nullptr, 0);
+        return result < 0 ? -errno : static_cast<int>(result);
+    }
+};
+#else
+struct IoQueue::Uring
+{
+};
+#endif
+
+#ifndef _WIN32
+// Fallback backend, every request is read to its end by one thread
+struct IoQueue::Workers
+{
+    std::mutex               mutex;
+    std::condition_variable  workCond;
+    std::condition_variable  doneCond;
+    std::deque<uint32_t>     queue;
+    std::vector<uint32_t>    done;
+    std::vector<std::thread> threads;
+    bool                     quit = false;
+};
+#else
+struct IoQueue::Workers
+{
+};
+#endif
+
+IoQueue::IoQueue(const Config& config)
+    : m_depth(config.depth > 0 ? config.depth : 1)
+{
+    m_requests = std::make_unique<Request[]>(m_depth);
+    for (uint32_t i = m_depth; i > 0; --i)
+        m_freeRequests.push_back(i - 1);
+
+#ifdef _WIN32
+    m_backend = Backend::Overlapped;
+    m_port    = CreateIoCompletionPort(INVALID_HANDLE_VALUE, nullptr, 0, 1);
+    ThrowIfFalse(m_port != nullptr);
+#else
+    #ifdef IO_QUEUE_URING
+    if (!config.forceThreads)
+    {
+        auto uring = std::make_unique<Uring>();
+        if (uring->init(m_depth))
+        {
+            m_uring   = std::move(uring);
+            m_backend = Backend::Uring;
+        }
+    }
+    #endif
+    if (m_uring == nullptr)
+    {
+        m_backend = Backend::Threads;
+        m_workers = std::make_unique<Workers>();
+        for (uint32_t i = 0; i < (config.threadCount > 0 ? config.threadCount : 1); ++i)
+            m_workers->threads.emplace_back(&IoQueue::workerThread, this);
+    }
+#endif
+}
+
+IoQueue::~IoQueue()
+{
+    // Destinations belong to the caller, nothing may land in them after the queue is gone
+    Completion completions[16];
+    while (m_inFlight > 0)
+        poll(completions, 16, true);
+
+#ifdef _WIN32
+    CloseHandle(m_port);
+#else
+    if (m_workers != nullptr)
+    {
+        {
+            std::lock_guard lock(m_workers->mutex);
+            m_workers->quit = true;
+        }
+        m_workers->workCond.notify_all();
+        for (auto& thread : m_workers->threads)
+            thread.join();
+    }
+#endif
+}
+
+IoQueue::FileHandle IoQueue::openFile(const std::string& path)
+{
+#ifdef _WIN32
+    auto file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_OVERLAPPED, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        return InvalidFile;
+    if (CreateIoCompletionPort(file, m_port, 0, 0) == nullptr)
+    {
+        CloseHandle(file);
+        return InvalidFile;
+    }
+    return file;
+#else
+    return ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+#endif
+}
+
+void IoQueue::closeFile(FileHandle file)
+{
+    if (file == InvalidFile)
+        return;
+#ifdef _WIN32
+    CloseHandle(file);
+#else
+    ::close(file);
+#endif
+}
+
+uint64_t IoQueue::getFileSize(FileHandle file) const
+{
+#ifdef _WIN32
+    LARGE_INTEGER size;
+    return GetFileSizeEx(file, &size) ? static_cast<uint64_t>(size.QuadPart) : 0;
+#else
+    struct stat status;
+    return fstat(file, &status) == 0 ? static_cast<uint64_t>(status.st_size) : 0;
+#endif
+}
+
+bool IoQueue::read(FileHandle file, uint64_t offset, uint64_t size, void* dest, uint64_t userData)
+{
+    if (m_freeRequests.empty())
+        return false;
+
+    auto  index   = m_freeRequests.back();
+    auto& request = m_requests[index];
+    m_freeRequests.pop_back();
+    request.file     = file;
+    request.offset   = offset;
+    request.dest     = static_cast<uint8_t*>(dest);
+    request.size     = size;
+    request.done     = 0;
+    request.userData = userData;
+    request.error    = 0;
+    request.pieces   = 0;
+    ++m_inFlight;
+
+    if (size == 0 || !startRequest(index))
+        m_finished.push_back(index);
+    return true;
+}
+
+void IoQueue::submit()
+{
+#ifdef IO_QUEUE_URING
+    // Kernel takes entries in order, interrupted or busy calls leave the rest for the next one
+    if (m_uring != nullptr && m_uring->pending > 0)
+    {
+        auto taken = m_uring->enter(m_uring->pending, 0);
+        if (taken > 0)
+            m_uring->pending -= static_cast<uint32_t>(taken);
+        ++m_stats.submitCalls;
+    }
+#endif
+}
+
+uint32_t IoQueue::poll(Completion* completions, uint32_t maxCount, bool wait)
+{
+    submit();
+
+    uint32_t count = 0;
+    while (!m_finished.empty() && count < maxCount)
+    {
+        complete(m_finished.back(), completions, count);
+        m_finished.pop_back();
+    }
+    if (count == maxCount)
+        return count;
+
+    switch (m_backend)
+    {
+    case Backend::Uring:      count += pollUring(completions + count, maxCount - count, wait && count == 0);      break;
+    case Backend::Threads:    count += pollWorkers(completions + count, maxCount - count, wait && count == 0);    break;
+    case Backend::Overlapped: count += pollOverlapped(completions + count, maxCount - count, wait && count == 0); break;
+    }
+    return count;
+}
+
+bool IoQueue::startRequest(uint32_t index)
+{
+    auto& request   = m_requests[index];
+    auto  remaining = request.size - request.done;
+    auto  pieceSize = remaining < MaxReadSize ? remaining : MaxReadSize;
+
+#ifdef _WIN32
+    ++request.pieces;
+    auto offset = request.offset + request.done;
+    std::memset(&request.overlapped, 0, sizeof(request.overlapped));
+    request.overlapped.Offset     = static_cast<DWORD>(offset);
+    request.overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+
+    // A read done at once still posts its completion to the port
+    if (!ReadFile(request.file, request.dest + request.done, static_cast<DWORD>(pieceSize), nullptr, &request.overlapped))
+    {
+        auto error = GetLastError();
+        if (error != ERROR_IO_PENDING)
+        {
+            request.error = error == ERROR_HANDLE_EOF ? 0 : -static_cast<int64_t>(error);
+            return false;
+        }
+    }
+    return true;
+#else
+    if (m_uring == nullptr)
+    {
+        {
+            std::lock_guard lock(m_workers->mutex);
+            m_workers->queue.push_back(index);
+        }
+        m_workers->workCond.notify_one();
+        return true;
+    }
+
+    #ifdef IO_QUEUE_URING
+    // Every request has at most one entry queued and depth is at most the ring size, the ring never overflows
+    auto& ring = *m_uring;
+    request.vector.iov_base = request.dest + request.done;
+    request.vector.iov_len  = static_cast<size_t>(pieceSize);
+
+    uint32_t tail = *ring.sqTail;
+    uint32_t slot = tail & *ring.sqMask;
+    auto&    sqe  = ring.sqes[slot];
+    std::memset(&sqe, 0, sizeof(sqe));
+    sqe.opcode    = IORING_OP_READV;
+    sqe.fd        = request.file;
+    sqe.off       = request.offset + request.done;
+    sqe.addr      = reinterpret_cast<uint64_t>(&request.vector);
+    sqe.len       = 1;
+    sqe.user_data = index;
+    ring.sqArray[slot] = slot;
+    std::atomic_ref<uint32_t>(*ring.sqTail).store(tail + 1, std::memory_order_release);
+    ++ring.pending;
+    ++request.pieces;
+    #endif
+    return true;
+#endif
+}
+
+bool IoQueue::finishPiece(uint32_t index, int64_t result)
+{
+    auto& request = m_requests[index];
+    if (result < 0)
+    {
+        request.error = result;
+        return true;
+    }
+    request.done += static_cast<uint64_t>(result);
+    return result == 0 || request.done >= request.size;
+}
+
+void IoQueue::complete(uint32_t index, Completion* completions, uint32_t& count)
+{
+    auto& request = m_requests[index];
+    completions[count++] = { request.userData, request.error < 0 ? request.error : static_cast<int64_t>(request.done) };
+
+    ++m_stats.reads;
+    m_stats.bytesRead  += request.done;
+    m_stats.osRequests += request.pieces;
+    if (request.error < 0)
+        ++m_stats.errors;
+
+    m_freeRequests.push_back(index);
+    --m_inFlight;
+}
+
+uint32_t IoQueue::pollUring(Completion* completions, uint32_t maxCount, bool wait)
+{
+    uint32_t count = 0;
+#ifdef IO_QUEUE_URING
+    auto& ring = *m_uring;
+    while (count < maxCount)
+    {
+        uint32_t head = *ring.cqHead;
+        uint32_t tail = std::atomic_ref<uint32_t>(*ring.cqTail).load(std::memory_order_acquire);
+        if (head == tail)
+        {
+            if (!wait || count > 0 || m_inFlight == 0)
+                break;
+            // Pieces queued by continued reads go in with the wait
+            auto taken = ring.enter(ring.pending, 1);
+            if (taken > 0)
+                ring.pending -= static_cast<uint32_t>(taken);
+            continue;
+        }
+
+        for (; head != tail && count < maxCount; ++head)
+        {
+            auto& cqe   = ring.cqes[head & *ring.cqMask];
+            auto  index = static_cast<uint32_t>(cqe.user_data);
+            if (cqe.res == -EAGAIN || cqe.res == -EINTR)
+                startRequest(index);
+            else if (finishPiece(index, cqe.res))
+                complete(index, completions, count);
+            else
+                startRequest(index);
+        }
+        std::atomic_ref<uint32_t>(*ring.cqHead).store(head, std::memory_order_release);
+    }
+    submit();
+#else
+    (void)completions, (void)maxCount, (void)wait;
+#endif
+    return count;
+}
+
+uint32_t IoQueue::pollWorkers(Completion* completions, uint32_t maxCount, bool wait)
+{
+    uint32_t count = 0;
+#ifndef _WIN32
+    auto&            workers = *m_workers;
+    std::unique_lock lock(workers.mutex);
+    if (wait && m_inFlight > 0)
+        workers.doneCond.wait(lock, [&workers] { return !workers.done.empty(); });
+
+    while (!workers.done.empty() && count < maxCount)
+    {
+        complete(workers.done.back(), completions, count);
+        workers.done.pop_back();
+    }
+#else
+    (void)completions, (void)maxCount, (void)wait;
+#endif
+    return count;
+}
+
+uint32_t IoQueue::pollOverlapped(Completion* completions, uint32_t maxCount, bool wait)
+{
+    uint32_t count = 0;
+#ifdef _WIN32
+    constexpr ULONG BatchSize = 32;
+    OVERLAPPED_ENTRY entries[BatchSize];
+    while (count < maxCount && m_inFlight > 0)
+    {
+        // A short read which continues does not count, wait again for a finished one
+        ULONG removed   = 0;
+        ULONG batchSize = maxCount - count < BatchSize ? maxCount - count : BatchSize;
+        if (!GetQueuedCompletionStatusEx(m_port, entries, batchSize, &removed, wait && count == 0 ? INFINITE : 0, FALSE))
+            break;
+
+        for (ULONG i = 0; i < removed; ++i)
+        {
+            auto request = reinterpret_cast<Request*>(entries[i].lpOverlapped);
+            auto index   = static_cast<uint32_t>(request - m_requests.get());
+
+            DWORD   bytes  = 0;
+            int64_t result = 0;
+            if (GetOverlappedResult(request->file, &request->overlapped, &bytes, FALSE))
+                result = bytes;
+            else if (GetLastError() != ERROR_HANDLE_EOF)
+                result = -static_cast<int64_t>(GetLastError());
+
+            if (finishPiece(index, result) || !startRequest(index))
+                complete(index, completions, count);
+        }
+        if (!wait || count > 0)
+            break;
+    }
+#else
+    (void)completions, (void)maxCount, (void)wait;
+#endif
+    return count;
+}
+
+void IoQueue::workerThread()
+{
+#ifndef _WIN32
+    auto&            workers = *m_workers;
+    std::unique_lock lock(workers.mutex);
+    while (true)
+    {
+        workers.workCond.wait(lock, [&workers] { return workers.quit || !workers.queue.empty(); });
+        if (workers.quit)
+            break;
+
+        auto index = workers.queue.front();
+        workers.queue.pop_front();
+
+        // The request belongs to this thread until it is put on the done list
+        lock.unlock();
+        auto& request = m_requests[index];
+        while (request.done < request.size)
+        {
+            auto remaining = request.size - request.done;
+            auto result    = pread(request.file, request.dest + request.done, static_cast<size_t>(remaining < MaxReadSize ? remaining : MaxReadSize),
+                                   static_cast<off_t>(request.offset + request.done));
+            if (result < 0 && errno == EINTR)
+                continue;
+            ++request.pieces;
+            if (result < 0)
+                request.error = -errno;
+            if (result <= 0)
+                break;
+            request.done += static_cast<uint64_t>(result);
+        }
+        lock.lock();
+
+        workers.done.push_back(index);
+        workers.doneCond.notify_one();
+    }
+#endif
+}
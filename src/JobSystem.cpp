@@ -0,0 +1,224 @@
+#include "JobSystem.hpp"
+#include "Profiler.hpp"
+
+#include <cassert>
+#include <cstdio>
+#include <algorithm>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+    #include <immintrin.h>
+#endif
+
+using namespace GalgameEngine;
+
+namespace
+{
+    // System the calling thread belongs to and its index in it
+    thread_local const JobSystem* t_system      = nullptr;
+    thread_local uint32_t         t_threadIndex = 0;
+
+    // Failed steal rounds before a worker goes to sleep
+    constexpr uint32_t SpinRounds = 64;
+
+    void cpuRelax() noexcept
+    {
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+        _mm_pause();
+#else
+        std::this_thread::yield();
+#endif
+    }
+
+    uint32_t xorshift(uint32_t& state) noexcept
+    {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state;
+    }
+}
+
+JobSystem::JobSystem(uint32_t threadCount)
+{
+    if (threadCount == 0)
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+    m_threads.reserve(threadCount);
+    for (uint32_t i = 0; i < threadCount; ++i)
+    {
+        m_threads.push_back(std::make_unique<ThreadContext>());
+        m_threads.back()->random = 0x9E3779B9u * (i + 1);
+    }
+
+    // Creating thread is thread 0 and runs jobs while waiting
+    assert(t_system == nullptr && "Thread already belongs to a job system");
+    t_system      = this;
+    t_threadIndex = 0;
+
+    m_workers.reserve(threadCount - 1);
+    for (uint32_t i = 1; i < threadCount; ++i)
+        m_workers.emplace_back(&JobSystem::workerMain, this, i);
+}
+
+JobSystem::~JobSystem()
+{
+    {
+        std::lock_guard lock(m_mutex);
+        m_stop.store(true, std::memory_order_relaxed);
+    }
+    m_wakeup.notify_all();
+    for (auto& worker : m_workers)
+        worker.join();
+
+    if (t_system == this)
+        t_system = nullptr;
+}
+
+void JobSystem::wait(JobCounter& counter)
+{
+    PROFILE_SCOPE("JobSystem::wait");
+
+    auto& context = getContext();
+    while (!counter.isDone())
+    {
+        if (!tryRunJob(context))
+            cpuRelax();
+    }
+}
+
+uint32_t JobSystem::getThreadIndex() const noexcept
+{
+    assert(t_system == this && "Calling thread does not belong to the job system");
+    return t_threadIndex;
+}
+
+JobSystem::Stats JobSystem::getStats() const noexcept
+{
+    Stats stats;
+    for (auto& context : m_threads)
+    {
+        stats.executed += context->executed.load(std::memory_order_relaxed);
+        stats.stolen   += context->stolen.load(std::memory_order_relaxed);
+        stats.sleeps   += context->sleeps.load(std::memory_order_relaxed);
+    }
+    return stats;
+}
+
+JobSystem::ThreadContext& JobSystem::getContext() noexcept
+{
+    return *m_threads[getThreadIndex()];
+}
+
+JobSystem::Job* JobSystem::allocateJob()
+{
+    // Slots are reused in order, a slot still queued or running means too many jobs in flight,
+    // help running them until it is free
+    auto& context = getContext();
+    auto  job     = &context.jobs[context.nextJob++ & (JobPoolCapacity - 1)];
+    while (job->busy.load(std::memory_order_acquire))
+    {
+        if (!tryRunJob(context))
+            cpuRelax();
+    }
+    job->busy.store(true, std::memory_order_relaxed);
+    return job;
+}
+
+void JobSystem::submit(Job* job)
+{
+    // Count before pushing, a thief may take the job before push() returns
+    // Sleeping workers re-check m_queued under the mutex, so either they see the job or get notified
+    auto& context = getContext();
+    m_queued.fetch_add(1, std::memory_order_seq_cst);
+    if (!context.queue.push(job))
+    {
+        // Deque is full, running the job here keeps the system making progress
+        m_queued.fetch_sub(1, std::memory_order_relaxed);
+        runJob(context, job);
+        return;
+    }
+
+    if (m_sleeping.load(std::memory_order_seq_cst) > 0)
+    {
+        std::lock_guard lock(m_mutex);
+        m_wakeup.notify_one();
+    }
+}
+
+bool JobSystem::tryRunJob(ThreadContext& context)
+{
+    Job* job = nullptr;
+    if (context.queue.pop(job))
+    {
+        m_queued.fetch_sub(1, std::memory_order_relaxed);
+        runJob(context, job);
+        return true;
+    }
+
+    // Own deque is empty, steal from others starting at a random victim
+    auto threadCount = getThreadCount();
+    auto first       = xorshift(context.random) % threadCount;
+    for (uint32_t i = 0; i < threadCount; ++i)
+    {
+        auto& victim = *m_threads[(first + i) % threadCount];
+        if (&victim == &context || !victim.queue.steal(job))
+            continue;
+
+        m_queued.fetch_sub(1, std::memory_order_relaxed);
+        context.stolen.fetch_add(1, std::memory_order_relaxed);
+        runJob(context, job);
+        return true;
+    }
+    return false;
+}
+
+void JobSystem::runJob(ThreadContext& context, Job* job)
+{
+    auto counter = job->counter;
+    job->invoke(job->storage);
+    job->busy.store(false, std::memory_order_release);
+    context.executed.fetch_add(1, std::memory_order_relaxed);
+
+    // Last access to the job, waiter may destroy the counter right after
+    counter->m_value.fetch_sub(1, std::memory_order_release);
+}
+
+void JobSystem::workerMain(uint32_t index)
+{
+    t_system      = this;
+    t_threadIndex = index;
+
+    char name[32];
+    std::snprintf(name, sizeof(name), "Worker %u", index);
+    Profiler::setThreadName(name);
+
+    auto& context = *m_threads[index];
+    while (true)
+    {
+        // Spin a little before sleeping, jobs of a frame usually come in bursts
+        bool ran = false;
+        for (uint32_t round = 0; round < SpinRounds && !ran; ++round)
+        {
+            ran = tryRunJob(context);
+            if (!ran)
+                cpuRelax();
+        }
+        if (ran)
+            continue;
+
+        m_sleeping.fetch_add(1, std::memory_order_seq_cst);
+        {
+            std::unique_lock lock(m_mutex);
+            if (m_queued.load(std::memory_order_seq_cst) == 0 && !m_stop.load(std::memory_order_relaxed))
+                context.sleeps.fetch_add(1, std::memory_order_relaxed);
+            m_wakeup.wait(lock, [this]()
+            {
+                return m_queued.load(std::memory_order_seq_cst) > 0 || m_stop.load(std::memory_order_relaxed);
+            });
+        }
+        m_sleeping.fetch_sub(1, std::memory_order_relaxed);
+
+        if (m_stop.load(std::memory_order_relaxed))
+            return;
+    }
+}
@@ -0,0 +1,300 @@
+#include "MemoryAllocator.hpp"
+
+#include <algorithm>
+
+#include <assert.h>
+
+using namespace GalgameEngine;
+
+namespace
+{
+    constexpr uint32_t HeapTypeCount  = 3;
+    constexpr uint32_t HeapUsageCount = 4;
+
+    // Offsets in blocks are kept in units of the default placement alignment
+    constexpr uint64_t Granularity = 64 * 1024;
+
+    constexpr uint64_t alignUp(uint64_t value, uint64_t alignment) noexcept
+    {
+        return (value + alignment - 1) & ~(alignment - 1);
+    }
+}
+
+MemoryAllocator::MemoryAllocator(Device& device, const Config& config)
+    : m_device(device),
+      m_config(config)
+{
+    assert(config.blockSize % Granularity == 0);
+
+    m_pools.resize(HeapTypeCount * HeapUsageCount);
+    for (uint32_t type = 0; type < HeapTypeCount; ++type)
+    {
+        for (uint32_t usage = 0; usage < HeapUsageCount; ++usage)
+        {
+            auto& pool = m_pools[type * HeapUsageCount + usage];
+            pool.type  = static_cast<HeapType>(type);
+            pool.usage = static_cast<HeapUsage>(usage);
+        }
+    }
+}
+
+MemoryAllocator::~MemoryAllocator()
+{
+    // Resources must be destroyed before their heaps
+    for (auto& pool : m_pools)
+    {
+        for ([[maybe_unused]] auto& block : pool.blocks)
+            assert((block.heap == nullptr || (block.allocator != nullptr && block.allocator->isEmpty())) && "Resource outlives memory allocator");
+    }
+}
+
+MemoryAllocation MemoryAllocator::allocate(HeapType type, HeapUsage usage, const AllocationInfo& info)
+{
+    assert(info.alignment != 0 && (info.alignment & (info.alignment - 1)) == 0);
+
+    std::lock_guard lock(m_mutex);
+
+    uint32_t poolIndex = getPoolIndex(type, usage);
+    auto&    pool      = m_pools[poolIndex];
+
+    // Large resource gets a heap of its own, sub-allocating it would mostly waste the rest of a block
+    if (info.size > m_config.blockSize / 2)
+    {
+        uint32_t block = createBlock(pool, alignUp(info.size, Granularity), true);
+
+        MemoryAllocation allocation;
+        allocation.heap   = pool.blocks[block].heap.get();
+        allocation.size   = pool.blocks[block].heap->getDesc().size;
+        allocation.pool   = poolIndex;
+        allocation.block  = block;
+        return allocation;
+    }
+
+    auto allocation = allocateInBlocks(poolIndex, info, UINT32_MAX);
+    if (allocation.isValid())
+        return allocation;
+
+    // No block has room, a new one always fits
+    createBlock(pool, m_config.blockSize, false);
+    allocation = allocateInBlocks(poolIndex, info, UINT32_MAX);
+    assert(allocation.isValid());
+    return allocation;
+}
+
+void MemoryAllocator::free(const MemoryAllocation& allocation)
+{
+    if (!allocation.isValid())
+        return;
+
+    std::lock_guard lock(m_mutex);
+
+    auto& pool  = m_pools[allocation.pool];
+    auto& block = pool.blocks[allocation.block];
+    assert(block.heap.get() == allocation.heap && "Allocation is not from this allocator");
+
+    if (block.allocator == nullptr)
+    {
+        destroyBlock(block);
+        return;
+    }
+
+    TlsfAllocator::Allocation suballocation;
+    suballocation.offset = allocation.offset;
+    suballocation.size   = allocation.size;
+    suballocation.node   = allocation.node;
+    block.allocator->free(suballocation);
+    if (!block.allocator->isEmpty())
+        return;
+
+    // Keep one empty block per pool, so a pool going up and down around a block boundary does not churn heaps
+    for (uint32_t i = 0; i < pool.blocks.size(); ++i)
+    {
+        auto& other = pool.blocks[i];
+        if (i != allocation.block && other.allocator != nullptr && other.allocator->isEmpty())
+        {
+            destroyBlock(block);
+            return;
+        }
+    }
+}
+
+void MemoryAllocator::planDefragmentation(std::vector<Move>& moves, uint64_t maxBytes)
+{
+    std::lock_guard lock(m_mutex);
+
+    uint64_t movedBytes = 0;
+    for (uint32_t poolIndex = 0; poolIndex < m_pools.size() && movedBytes < maxBytes; ++poolIndex)
+    {
+        // Sparsest block which is not empty, moving out of it frees the most heaps for the least copying
+        auto&    pool        = m_pools[poolIndex];
+        uint32_t source      = UINT32_MAX;
+        uint64_t sourceUsed  = UINT64_MAX;
+        uint32_t blockCount  = 0;
+        for (uint32_t i = 0; i < pool.blocks.size(); ++i)
+        {
+            auto& block = pool.blocks[i];
+            if (block.allocator == nullptr)
+                continue;
+            ++blockCount;
+            auto used = block.allocator->getUsed();
+            if (used != 0 && used < sourceUsed)
+            {
+                source     = i;
+                sourceUsed = used;
+            }
+        }
+        if (blockCount < 2 || source == UINT32_MAX)
+            continue;
+
+        m_scratch.clear();
+        pool.blocks[source].allocator->getAllocations(m_scratch);
+        for (auto& suballocation : m_scratch)
+        {
+            if (movedBytes + suballocation.size > maxBytes)
+                break;
+
+            AllocationInfo info;
+            info.size      = suballocation.size;
+            info.alignment = pool.blocks[source].alignments[suballocation.node];
+            auto destination = allocateInBlocks(poolIndex, info, source);
+            if (!destination.isValid())
+                break;
+
+            Move move;
+            move.source.heap   = pool.blocks[source].heap.get();
+            move.source.offset = suballocation.offset;
+            move.source.size   = suballocation.size;
+            move.source.pool   = poolIndex;
+            move.source.block  = source;
+            move.source.node   = suballocation.node;
+            move.destination   = destination;
+            moves.push_back(move);
+            movedBytes += suballocation.size;
+        }
+    }
+}
+
+void MemoryAllocator::setObserver(Observer* observer)
+{
+    std::lock_guard lock(m_mutex);
+
+    m_observer = observer;
+    if (m_observer == nullptr)
+        return;
+    for (auto& pool : m_pools)
+    {
+        for (auto& block : pool.blocks)
+        {
+            if (block.heap != nullptr)
+                m_observer->onHeapCreated(*block.heap);
+        }
+    }
+}
+
+MemoryAllocator::Stats MemoryAllocator::getStats() const
+{
+    std::lock_guard lock(m_mutex);
+
+    Stats stats;
+    for (auto& pool : m_pools)
+    {
+        for (auto& block : pool.blocks)
+        {
+            if (block.heap == nullptr)
+                continue;
+
+            stats.heapBytes += block.heap->getDesc().size;
+            if (block.allocator == nullptr)
+            {
+                ++stats.dedicatedHeaps;
+                ++stats.allocations;
+                stats.usedBytes += block.heap->getDesc().size;
+                continue;
+            }
+
+            auto blockStats = block.allocator->getStats();
+            ++stats.blocks;
+            stats.allocations  += blockStats.allocations;
+            stats.usedBytes    += blockStats.usedBytes;
+            stats.freeBlocks   += blockStats.freeBlocks;
+            stats.fragmentation = std::max(stats.fragmentation, block.allocator->getFragmentation());
+        }
+    }
+    stats.createdHeaps = m_createdHeaps;
+    return stats;
+}
+
+uint32_t MemoryAllocator::getPoolIndex(HeapType type, HeapUsage usage) const noexcept
+{
+    // Tier 2 hardware puts any resource in any heap, one pool per heap type packs best
+    if (m_config.mixedHeaps)
+        usage = HeapUsage::All;
+    return static_cast<uint32_t>(type) * HeapUsageCount + static_cast<uint32_t>(usage);
+}
+
+uint32_t MemoryAllocator::createBlock(Pool& pool, uint64_t size, bool dedicated)
+{
+    HeapDesc desc;
+    desc.size  = size;
+    desc.type  = pool.type;
+    desc.usage = pool.usage;
+
+    Block block;
+    block.heap = m_device.createHeap(desc);
+    if (!dedicated)
+        block.allocator = std::make_unique<TlsfAllocator>(size, Granularity);
+    ++m_createdHeaps;
+    if (m_observer != nullptr)
+        m_observer->onHeapCreated(*block.heap);
+
+    // Reuse the slot of a destroyed block, indices of live blocks must not change
+    for (uint32_t i = 0; i < pool.blocks.size(); ++i)
+    {
+        if (pool.blocks[i].heap == nullptr)
+        {
+            pool.blocks[i] = std::move(block);
+            return i;
+        }
+    }
+    pool.blocks.push_back(std::move(block));
+    return static_cast<uint32_t>(pool.blocks.size() - 1);
+}
+
+void MemoryAllocator::destroyBlock(Block& block)
+{
+    if (m_observer != nullptr)
+        m_observer->onHeapDestroyed(*block.heap);
+    block.heap.reset();
+    block.allocator.reset();
+    block.alignments.clear();
+}
+
+MemoryAllocation MemoryAllocator::allocateInBlocks(uint32_t poolIndex, const AllocationInfo& info, uint32_t skipBlock)
+{
+    // First blocks first, allocations pack into few blocks and the last ones are left to drain
+    auto& pool = m_pools[poolIndex];
+    for (uint32_t i = 0; i < pool.blocks.size(); ++i)
+    {
+        auto& block = pool.blocks[i];
+        if (i == skipBlock || block.allocator == nullptr)
+            continue;
+
+        auto suballocation = block.allocator->allocate(info.size, std::max(info.alignment, Granularity));
+        if (!suballocation.isValid())
+            continue;
+
+        if (block.alignments.size() <= suballocation.node)
+            block.alignments.resize(suballocation.node + 1);
+        block.alignments[suballocation.node] = info.alignment;
+
+        MemoryAllocation allocation;
+        allocation.heap   = block.heap.get();
+        allocation.offset = suballocation.offset;
+        allocation.size   = suballocation.size;
+        allocation.pool   = poolIndex;
+        allocation.block  = i;
+        allocation.node   = suballocation.node;
+        return allocation;
+    }
+    return {};
+}
@@ -0,0 +1,182 @@
+#include "MeshFile.hpp"
+#include "Hash.hpp"
+#include "Profiler.hpp"
+
+#include <cstring>
+
+using namespace GalgameEngine;
+using namespace GalgameEngine::MeshFormat;
+
+namespace
+{
+    // Overflow safe, sizes come from an untrusted file
+    bool isInRange(uint64_t offset, uint64_t size, uint64_t limit) noexcept
+    {
+        return offset <= limit && size <= limit - offset;
+    }
+
+    const char* getSemanticName(Semantic semantic) noexcept
+    {
+        switch (semantic)
+        {
+        case Semantic::Position: return "POSITION";
+        case Semantic::Normal:   return "NORMAL";
+        case Semantic::Tangent:  return "TANGENT";
+        case Semantic::Texcoord: return "TEXCOORD";
+        case Semantic::Color:    return "COLOR";
+        }
+        return "UNKNOWN";
+    }
+}
+
+uint64_t MeshFormat::computeChecksum(const uint8_t* file, const Header& header) noexcept
+{
+    auto copy = header;
+    copy.checksum = 0;
+
+    Hasher hasher;
+    hasher.addValue(copy);
+    hasher.add(file + header.meshTableOffset,    static_cast<uint64_t>(header.meshCount)    * sizeof(MeshRecord));
+    hasher.add(file + header.submeshTableOffset, static_cast<uint64_t>(header.submeshCount) * sizeof(SubmeshRecord));
+    hasher.add(file + header.nodeTableOffset,    static_cast<uint64_t>(header.nodeCount)    * sizeof(NodeRecord));
+    return hasher.finish();
+}
+
+bool MeshFile::open(const std::string& path)
+{
+    PROFILE_SCOPE("MeshFile::open");
+
+    close();
+    if (!m_file.open(path) || m_file.getSize() < sizeof(Header))
+    {
+        m_file.close();
+        return false;
+    }
+
+    // Mapping starts on a page, tables are 8 byte aligned in the file, records are used in place
+    auto data   = m_file.getData();
+    m_header    = reinterpret_cast<const Header*>(data);
+    m_meshes    = reinterpret_cast<const MeshRecord*>(data + m_header->meshTableOffset);
+    m_submeshes = reinterpret_cast<const SubmeshRecord*>(data + m_header->submeshTableOffset);
+    m_nodes     = reinterpret_cast<const NodeRecord*>(data + m_header->nodeTableOffset);
+    if (!validate())
+    {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void MeshFile::close() noexcept
+{
+    m_file.close();
+    m_header    = nullptr;
+    m_meshes    = nullptr;
+    m_submeshes = nullptr;
+    m_nodes     = nullptr;
+}
+
+bool MeshFile::validate() const noexcept
+{
+    auto& header   = *m_header;
+    auto  fileSize = m_file.getSize();
+    if (header.magic != Magic || header.version != Version || header.fileSize != fileSize)
+        return false;
+
+    // Tables and blobs first, the checksum reads the tables
+    bool aligned = header.meshTableOffset % 8 == 0 && header.submeshTableOffset % 8 == 0 && header.nodeTableOffset % 8 == 0 &&
+                   header.vertexBlobOffset % BlobAlignment == 0 && header.indexBlobOffset % BlobAlignment == 0;
+    if (!aligned ||
+        !isInRange(header.meshTableOffset,    static_cast<uint64_t>(header.meshCount)    * sizeof(MeshRecord),    fileSize) ||
+        !isInRange(header.submeshTableOffset, static_cast<uint64_t>(header.submeshCount) * sizeof(SubmeshRecord), fileSize) ||
+        !isInRange(header.nodeTableOffset,    static_cast<uint64_t>(header.nodeCount)    * sizeof(NodeRecord),    fileSize) ||
+        !isInRange(header.vertexBlobOffset,   header.vertexBlobSize,                                               fileSize) ||
+        !isInRange(header.indexBlobOffset,    header.indexBlobSize,                                                fileSize))
+        return false;
+
+    if (computeChecksum(m_file.getData(), header) != header.checksum)
+        return false;
+
+    // Index values are not checked, that would read the whole blob, out of range vertex fetches read zero on GPU
+    for (uint32_t i = 0; i < header.meshCount; ++i)
+    {
+        auto& mesh = m_meshes[i];
+        if (mesh.vertexStride == 0 || (mesh.indexSize != 2 && mesh.indexSize != 4) || mesh.attributeCount > MaxAttributes ||
+            !isInRange(mesh.vertexOffset, static_cast<uint64_t>(mesh.vertexCount) * mesh.vertexStride, header.vertexBlobSize) ||
+            !isInRange(mesh.indexOffset,  static_cast<uint64_t>(mesh.indexCount)  * mesh.indexSize,    header.indexBlobSize) ||
+            !isInRange(mesh.firstSubmesh, mesh.submeshCount, header.submeshCount))
+            return false;
+
+        for (uint32_t a = 0; a < mesh.attributeCount; ++a)
+        {
+            auto size = getFormatSize(mesh.attributes[a].format);
+            if (size == 0 || !isInRange(mesh.attributes[a].offset, size, mesh.vertexStride))
+                return false;
+        }
+        for (uint32_t s = 0; s < mesh.submeshCount; ++s)
+        {
+            auto& submesh = m_submeshes[mesh.firstSubmesh + s];
+            if (!isInRange(submesh.firstIndex, submesh.indexCount, mesh.indexCount))
+                return false;
+        }
+    }
+
+    for (uint32_t i = 0; i < header.nodeCount; ++i)
+    {
+        auto& node = m_nodes[i];
+        if ((node.mesh != InvalidIndex && node.mesh >= header.meshCount) || (node.parent != InvalidIndex && node.parent >= i))
+            return false;
+    }
+    return true;
+}
+
+uint32_t MeshFile::findMesh(uint64_t nameHash) const noexcept
+{
+    for (uint32_t i = 0; i < m_header->meshCount; ++i)
+    {
+        if (m_meshes[i].nameHash == nameHash)
+            return i;
+    }
+    return InvalidIndex;
+}
+
+MeshGeometry MeshFile::upload(Device& device) const
+{
+    PROFILE_SCOPE("MeshFile::upload");
+
+    MeshGeometry geometry;
+    geometry.indexBase = (m_header->vertexBlobSize + UploadAlignment - 1) / UploadAlignment * UploadAlignment;
+
+    BufferDesc desc;
+    desc.size     = geometry.indexBase + m_header->indexBlobSize;
+    desc.heapType = HeapType::Upload;
+    if (desc.size == 0)
+        return geometry;
+
+    // Read ahead of the copy, it then runs over resident pages instead of faulting one page at a time
+    m_file.prefetch(m_header->vertexBlobOffset, m_header->vertexBlobSize);
+    m_file.prefetch(m_header->indexBlobOffset, m_header->indexBlobSize);
+
+    geometry.buffer = device.createBuffer(desc, ResourceState::GenericRead);
+    auto mapped     = geometry.buffer->getMappedData();
+    std::memcpy(mapped + geometry.vertexBase, getVertexBlob(), m_header->vertexBlobSize);
+    std::memcpy(mapped + geometry.indexBase,  getIndexBlob(),  m_header->indexBlobSize);
+    return geometry;
+}
+
+std::vector<InputElement> MeshFile::getInputLayout(uint32_t mesh) const
+{
+    auto& record = m_meshes[mesh];
+
+    std::vector<InputElement> layout;
+    for (uint32_t i = 0; i < record.attributeCount; ++i)
+    {
+        // Repeated semantics get increasing indices, e.g. TEXCOORD0 and TEXCOORD1
+        auto&    attribute = record.attributes[i];
+        uint32_t index     = 0;
+        for (uint32_t j = 0; j < i; ++j)
+            index += record.attributes[j].semantic == attribute.semantic;
+        layout.push_back({ getSemanticName(attribute.semantic), index, attribute.format, 0, attribute.offset });
+    }
+    return layout;
+}
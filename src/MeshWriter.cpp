@@ -0,0 +1,161 @@
+#include "MeshWriter.hpp"
+#include "Hash.hpp"
+
+#include <cfloat>
+#include <cstring>
+#include <fstream>
+#include <algorithm>
+
+#include <assert.h>
+
+using namespace GalgameEngine;
+using namespace GalgameEngine::MeshFormat;
+
+namespace
+{
+    uint64_t alignUp(uint64_t value, uint64_t alignment) noexcept
+    {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    struct Layout
+    {
+        uint64_t meshTable;
+        uint64_t submeshTable;
+        uint64_t nodeTable;
+        uint64_t vertexBlob;
+        uint64_t indexBlob;
+        uint64_t fileSize;
+    };
+}
+
+uint32_t MeshWriter::addMesh(const Mesh& mesh)
+{
+    assert(mesh.attributes.size() <= MaxAttributes);
+    assert(mesh.indexSize == 2 || mesh.indexSize == 4);
+
+    MeshRecord record = {};
+    Hasher     nameHasher;
+    nameHasher.addString(mesh.name);
+    record.nameHash       = nameHasher.finish();
+    record.vertexCount    = mesh.vertexCount;
+    record.vertexStride   = mesh.vertexStride;
+    record.indexCount     = mesh.indexCount;
+    record.indexSize      = mesh.indexSize;
+    record.firstSubmesh   = static_cast<uint32_t>(m_submeshes.size());
+    record.attributeCount = static_cast<uint32_t>(mesh.attributes.size());
+    std::copy(mesh.attributes.begin(), mesh.attributes.end(), record.attributes);
+
+    // Each mesh starts on the upload alignment so its offset in the blob is a valid view offset
+    uint64_t vertexSize = static_cast<uint64_t>(mesh.vertexCount) * mesh.vertexStride;
+    uint64_t indexSize  = static_cast<uint64_t>(mesh.indexCount) * mesh.indexSize;
+    record.vertexOffset = alignUp(m_vertexBlobSize, UploadAlignment);
+    record.indexOffset  = alignUp(m_indexBlobSize, UploadAlignment);
+    m_vertexBlobs.push_back({ mesh.vertices, record.vertexOffset, vertexSize });
+    m_indexBlobs.push_back({ mesh.indices, record.indexOffset, indexSize });
+    m_vertexBlobSize = record.vertexOffset + vertexSize;
+    m_indexBlobSize  = record.indexOffset + indexSize;
+
+    if (mesh.submeshes.empty())
+        m_submeshes.push_back({ 0, mesh.indexCount, 0, 0 });
+    for (auto& submesh : mesh.submeshes)
+        m_submeshes.push_back({ submesh.firstIndex, submesh.indexCount, submesh.material, 0 });
+    record.submeshCount = static_cast<uint32_t>(m_submeshes.size()) - record.firstSubmesh;
+
+    // Bounds of float3 positions, empty bounds stay inverted
+    for (int i = 0; i < 3; ++i)
+    {
+        record.boundsMin[i] = FLT_MAX;
+        record.boundsMax[i] = -FLT_MAX;
+    }
+    auto position = std::find_if(mesh.attributes.begin(), mesh.attributes.end(),
+                                 [](const Attribute& attribute) { return attribute.semantic == Semantic::Position; });
+    if (position != mesh.attributes.end() && position->format == Format::R32G32B32_FLOAT)
+    {
+        auto vertices = static_cast<const uint8_t*>(mesh.vertices);
+        for (uint32_t v = 0; v < mesh.vertexCount; ++v)
+        {
+            float point[3];
+            std::memcpy(point, vertices + static_cast<uint64_t>(v) * mesh.vertexStride + position->offset, sizeof(point));
+            for (int i = 0; i < 3; ++i)
+            {
+                record.boundsMin[i] = std::min(record.boundsMin[i], point[i]);
+                record.boundsMax[i] = std::max(record.boundsMax[i], point[i]);
+            }
+        }
+    }
+
+    m_meshes.push_back(record);
+    return static_cast<uint32_t>(m_meshes.size() - 1);
+}
+
+uint32_t MeshWriter::addNode(const Node& node)
+{
+    assert(node.parent == InvalidIndex || node.parent < m_nodes.size());
+
+    NodeRecord record = {};
+    std::memcpy(record.transform, node.transform, sizeof(record.transform));
+    record.mesh   = node.mesh;
+    record.parent = node.parent;
+    m_nodes.push_back(record);
+    return static_cast<uint32_t>(m_nodes.size() - 1);
+}
+
+uint64_t MeshWriter::getFileSize() const noexcept
+{
+    uint64_t tables = sizeof(Header) + m_meshes.size() * sizeof(MeshRecord) + m_submeshes.size() * sizeof(SubmeshRecord) +
+                      m_nodes.size() * sizeof(NodeRecord);
+    return alignUp(alignUp(tables, BlobAlignment) + m_vertexBlobSize, BlobAlignment) + m_indexBlobSize;
+}
+
+bool MeshWriter::write(const std::string& path) const
+{
+    Header header = {};
+    header.magic              = Magic;
+    header.version            = Version;
+    header.meshCount          = static_cast<uint32_t>(m_meshes.size());
+    header.submeshCount       = static_cast<uint32_t>(m_submeshes.size());
+    header.nodeCount          = static_cast<uint32_t>(m_nodes.size());
+    header.meshTableOffset    = sizeof(Header);
+    header.submeshTableOffset = header.meshTableOffset + m_meshes.size() * sizeof(MeshRecord);
+    header.nodeTableOffset    = header.submeshTableOffset + m_submeshes.size() * sizeof(SubmeshRecord);
+    header.vertexBlobOffset   = alignUp(header.nodeTableOffset + m_nodes.size() * sizeof(NodeRecord), BlobAlignment);
+    header.vertexBlobSize     = m_vertexBlobSize;
+    header.indexBlobOffset    = alignUp(header.vertexBlobOffset + m_vertexBlobSize, BlobAlignment);
+    header.indexBlobSize      = m_indexBlobSize;
+    header.fileSize           = header.indexBlobOffset + m_indexBlobSize;
+
+    // Tables are contiguous after the header, hash them from one buffer like the loader sees them
+    std::vector<uint8_t> tables(header.vertexBlobOffset);
+    std::memcpy(tables.data() + header.meshTableOffset,    m_meshes.data(),    m_meshes.size()    * sizeof(MeshRecord));
+    std::memcpy(tables.data() + header.submeshTableOffset, m_submeshes.data(), m_submeshes.size() * sizeof(SubmeshRecord));
+    std::memcpy(tables.data() + header.nodeTableOffset,    m_nodes.data(),     m_nodes.size()     * sizeof(NodeRecord));
+    header.checksum = computeChecksum(tables.data(), header);
+    std::memcpy(tables.data(), &header, sizeof(header));
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(tables.data()), tables.size());
+
+    // Blobs are written piece by piece from the caller's data, gaps are zero padding
+    uint64_t position = header.vertexBlobOffset;
+    auto padTo = [&file, &position](uint64_t offset)
+    {
+        static const char zeros[BlobAlignment] = {};
+        for (; position < offset; position += std::min<uint64_t>(offset - position, BlobAlignment))
+            file.write(zeros, std::min<uint64_t>(offset - position, BlobAlignment));
+    };
+    for (auto& blob : m_vertexBlobs)
+    {
+        padTo(header.vertexBlobOffset + blob.offset);
+        file.write(static_cast<const char*>(blob.data), blob.size);
+        position += blob.size;
+    }
+    for (auto& blob : m_indexBlobs)
+    {
+        padTo(header.indexBlobOffset + blob.offset);
+        file.write(static_cast<const char*>(blob.data), blob.size);
+        position += blob.size;
+    }
+    padTo(header.fileSize);
+    return static_cast<bool>(file.flush());
+}
@@ -0,0 +1,270 @@
+#include "NullCommandQueue.hpp"
+#include "NullDevice.hpp"
+#include "SyncEvent.hpp"
+#include "JobSystem.hpp"
+#include "Timer.hpp"
+
+#include <cstring>
+
+using namespace GalgameEngine;
+
+namespace
+{
+    // GPU clock does not start with CPU clocks, calibration has to bridge them
+    constexpr uint64_t GpuClockOffset = 1ull << 40;
+}
+
+NullCommandQueue::NullCommandQueue(NullDevice& device, QueueType type)
+    : m_device(device), m_type(type)
+{
+    m_thread = std::thread(&NullCommandQueue::gpuThread, this);
+}
+
+NullCommandQueue::~NullCommandQueue()
+{
+    stop();
+}
+
+void NullCommandQueue::stop()
+{
+    if (!m_thread.joinable())
+        return;
+    {
+        std::lock_guard lock(m_mutex);
+        m_quit = true;
+    }
+    m_workCond.notify_one();
+    m_waitEvent.set();
+    m_thread.join();
+}
+
+void NullCommandQueue::executeCommandLists(CommandList* const* lists, uint32_t count)
+{
+    // Validate and apply state changes in submission order, like GPU would execute them
+    Work work;
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        auto& list = *static_cast<NullCommandList*>(lists[i]);
+        work.cost += m_device.execute(list, m_type, getNextValue(), work.cost, work.timestamps);
+
+        // Copied, the list may be reset and recorded again before GPU thread gets to the work
+        auto& raster = list.getRasterCommands();
+        work.raster.insert(work.raster.end(), raster.begin(), raster.end());
+    }
+
+    {
+        std::lock_guard lock(m_mutex);
+        m_executedValue = m_fenceValue + 1;
+        m_works.push_back(std::move(work));
+        ++m_stats.submitCount;
+    }
+    m_workCond.notify_one();
+}
+
+void NullCommandQueue::submit(Duration gpuCost)
+{
+    {
+        std::lock_guard lock(m_mutex);
+        Work work;
+        work.cost = gpuCost;
+        m_works.push_back(std::move(work));
+        ++m_stats.submitCount;
+    }
+    m_workCond.notify_one();
+}
+
+uint64_t NullCommandQueue::signal()
+{
+    uint64_t value;
+    {
+        std::lock_guard lock(m_mutex);
+        value = ++m_fenceValue;
+        Work work;
+        work.fenceValue = value;
+        m_works.push_back(std::move(work));
+    }
+    m_workCond.notify_one();
+    return value;
+}
+
+uint64_t NullCommandQueue::getCompletedValue() const
+{
+    std::lock_guard lock(m_mutex);
+    return m_completedValue;
+}
+
+void NullCommandQueue::waitForValue(uint64_t value)
+{
+    std::unique_lock lock(m_mutex);
+    if (m_completedValue >= value)
+        return;
+
+    auto begin = std::chrono::steady_clock::now();
+    m_fenceCond.wait(lock, [&] { return m_completedValue >= value; });
+    m_stats.cpuWaitTime += std::chrono::steady_clock::now() - begin;
+    ++m_stats.waitCount;
+}
+
+void NullCommandQueue::setEventOnCompletion(uint64_t value, SyncEvent& event)
+{
+    std::lock_guard lock(m_mutex);
+    if (m_completedValue >= value)
+        event.set();
+    else
+        m_completionEvents.push_back({ value, &event });
+}
+
+void NullCommandQueue::wait(CommandQueue& other, uint64_t value)
+{
+    auto nullOther = dynamic_cast<NullCommandQueue*>(&other);
+    if (nullOther == nullptr || nullOther == this)
+    {
+        m_device.reportError("CommandQueue::wait: queue is this queue or not created by null device");
+        return;
+    }
+    {
+        std::lock_guard lock(m_mutex);
+        Work work;
+        work.fenceValue = value;
+        work.waitQueue  = nullOther;
+        m_works.push_back(std::move(work));
+    }
+    m_workCond.notify_one();
+}
+
+ClockCalibration NullCommandQueue::getClockCalibration() const
+{
+    ClockCalibration calibration;
+    calibration.gpuTimestamp = getGpuTimestamp(std::chrono::steady_clock::now());
+    calibration.cpuTicks     = Timer::now();
+    return calibration;
+}
+
+uint64_t NullCommandQueue::getNextValue() const
+{
+    std::lock_guard lock(m_mutex);
+    return m_fenceValue + 1;
+}
+
+bool NullCommandQueue::isIdle() const
+{
+    std::lock_guard lock(m_mutex);
+    return m_completedValue >= m_executedValue;
+}
+
+NullCommandQueue::Stats NullCommandQueue::getStats() const
+{
+    std::lock_guard lock(m_mutex);
+    return m_stats;
+}
+
+void NullCommandQueue::resetStats()
+{
+    std::lock_guard lock(m_mutex);
+    m_stats = {};
+}
+
+void NullCommandQueue::gpuThread()
+{
+    // Jobs are scheduled only from the thread which created their system, so both live on this thread
+    std::unique_ptr<JobSystem>          jobSystem;
+    std::unique_ptr<SoftwareRasterizer> rasterizer;
+    if (m_type == QueueType::Direct && m_device.m_config.rasterize)
+    {
+        jobSystem = std::make_unique<JobSystem>(m_device.m_config.rasterThreads);
+        auto config = m_device.m_config.rasterizer;
+        config.jobSystem = jobSystem.get();
+        rasterizer = std::make_unique<SoftwareRasterizer>(config);
+    }
+
+    std::unique_lock lock(m_mutex);
+    while (true)
+    {
+        m_workCond.wait(lock, [this] { return m_quit || !m_works.empty(); });
+        if (m_quit)
+            break;
+
+        auto work = std::move(m_works.front());
+        m_works.pop_front();
+
+        if (work.waitQueue != nullptr)
+        {
+            // Work behind the wait stays queued, CPU keeps submitting meanwhile
+            lock.unlock();
+            auto begin = std::chrono::steady_clock::now();
+            work.waitQueue->setEventOnCompletion(work.fenceValue, m_waitEvent);
+            m_waitEvent.wait();
+            auto waited = std::chrono::steady_clock::now() - begin;
+            lock.lock();
+
+            m_stats.gpuWaitTime += waited;
+            continue;
+        }
+
+        if (work.fenceValue != 0)
+        {
+            m_completedValue = work.fenceValue;
+            m_fenceCond.notify_all();
+            signalEvents();
+            continue;
+        }
+
+        if (work.cost == Duration::zero() && work.timestamps.empty() && work.raster.empty())
+            continue;
+
+        // Execute work without holding the lock, CPU keeps submitting meanwhile
+        lock.unlock();
+        auto begin = std::chrono::steady_clock::now();
+        if (!work.raster.empty())
+            m_device.rasterize(rasterizer.get(), work.raster);
+        if (work.cost != Duration::zero())
+            std::this_thread::sleep_for(work.cost);
+        auto busy = std::chrono::steady_clock::now() - begin;
+        applyTimestamps(work, begin);
+        lock.lock();
+
+        m_stats.gpuBusyTime += busy;
+    }
+
+    // Release anyone still waiting, the queue is going away
+    m_completedValue = m_fenceValue;
+    m_fenceCond.notify_all();
+    for (auto& completion : m_completionEvents)
+        completion.event->set();
+    m_completionEvents.clear();
+}
+
+void NullCommandQueue::signalEvents()
+{
+    for (size_t i = 0; i < m_completionEvents.size();)
+    {
+        if (m_completionEvents[i].value <= m_completedValue)
+        {
+            m_completionEvents[i].event->set();
+            m_completionEvents[i] = m_completionEvents.back();
+            m_completionEvents.pop_back();
+        }
+        else
+        {
+            ++i;
+        }
+    }
+}
+
+void NullCommandQueue::applyTimestamps(const Work& work, std::chrono::steady_clock::time_point begin)
+{
+    // In command order, a resolve sees the writes before it
+    for (auto& op : work.timestamps)
+    {
+        if (op.count == 0)
+            op.heap->m_values[op.index] = getGpuTimestamp(begin + op.offset);
+        else
+            std::memcpy(op.dest, op.heap->m_values.data() + op.index, op.count * sizeof(uint64_t));
+    }
+}
+
+uint64_t NullCommandQueue::getGpuTimestamp(std::chrono::steady_clock::time_point time)
+{
+    auto nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count();
+    return static_cast<uint64_t>(nanoseconds) + GpuClockOffset;
+}
@@ -0,0 +1,1482 @@
+#include "NullDevice.hpp"
+#include "Hash.hpp"
+
+#include <chrono>
+#include <string>
+#include <thread>
+#include <cstring>
+#include <algorithm>
+#include <stdexcept>
+
+using namespace GalgameEngine;
+
+namespace
+{
+    // Keep only first errors, a broken frame loop would report the same error every frame
+    constexpr size_t MaxStoredErrors = 64;
+
+    const char* toString(ResourceState state) noexcept
+    {
+        switch (state)
+        {
+        case ResourceState::Common:          return "Common";
+        case ResourceState::Present:         return "Present";
+        case ResourceState::RenderTarget:    return "RenderTarget";
+        case ResourceState::DepthWrite:      return "DepthWrite";
+        case ResourceState::DepthRead:       return "DepthRead";
+        case ResourceState::ShaderResource:  return "ShaderResource";
+        case ResourceState::UnorderedAccess: return "UnorderedAccess";
+        case ResourceState::CopySource:      return "CopySource";
+        case ResourceState::CopyDest:        return "CopyDest";
+        case ResourceState::GenericRead:     return "GenericRead";
+        }
+        return "Unknown";
+    }
+
+    // Placed resources of 64KB pages like D3D12 default alignment
+    constexpr uint64_t PlacementAlignment = 64 * 1024;
+
+    // Present and common are the same state in D3D12
+    bool isSameState(ResourceState a, ResourceState b) noexcept
+    {
+        auto normalize = [](ResourceState s) { return s == ResourceState::Present ? ResourceState::Common : s; };
+        return normalize(a) == normalize(b);
+    }
+
+    // States a copy queue can use, it knows nothing about render targets or shaders
+    bool isCopyState(ResourceState state) noexcept
+    {
+        return isSameState(state, ResourceState::Common) || state == ResourceState::CopyDest || state == ResourceState::CopySource;
+    }
+
+    // Cached pipeline blob: magic, driver version, hash of the description
+    constexpr uint32_t PipelineBlobMagic = 0x4F53504E;  // "NPSO"
+    constexpr size_t   PipelineBlobSize  = 16;
+
+    // Shaders and output formats, what a driver would compile differently
+    uint64_t hashPipelineDesc(const GraphicsPipelineDesc& desc) noexcept
+    {
+        Hasher hasher;
+        hasher.addValue(static_cast<uint64_t>(desc.vertexShader.size()));
+        hasher.add(desc.vertexShader.data(), desc.vertexShader.size());
+        hasher.addValue(static_cast<uint64_t>(desc.pixelShader.size()));
+        hasher.add(desc.pixelShader.data(), desc.pixelShader.size());
+        hasher.addValue(desc.renderTargetCount);
+        for (uint32_t i = 0; i < desc.renderTargetCount && i < GraphicsPipelineDesc::MaxRenderTargets; ++i)
+            hasher.addValue(desc.renderTargetFormats[i]);
+        hasher.addValue(desc.depthStencilFormat);
+        return hasher.finish();
+    }
+
+    // Row pitch of rasterized targets in pixels, SoftwareRasterizer::Surface needs a multiple of 16
+    constexpr uint32_t RasterPitchAlignment = 16;
+
+    SoftwareRasterizer::Surface getSurface(NullTexture* texture) noexcept
+    {
+        if (texture == nullptr || texture->getPixels() == nullptr)
+            return {};
+        return { texture->getPixels(), texture->getDesc().width, texture->getDesc().height, texture->getRowPitch() };
+    }
+
+    // Bytes of a buffer from offset on, null when the buffer has no data or the range is outside it
+    uint8_t* getBufferData(Buffer* buffer, uint64_t offset, uint64_t size) noexcept
+    {
+        auto nullBuffer = dynamic_cast<NullBuffer*>(buffer);
+        if (nullBuffer == nullptr || nullBuffer->getData() == nullptr || offset > nullBuffer->getDesc().size ||
+            size > nullBuffer->getDesc().size - offset)
+            return nullptr;
+        return nullBuffer->getData() + offset;
+    }
+
+    // Fixed function draw of the bindings of a raster command, false when it has nothing the rasterizer reads
+    bool makeDrawDesc(const NullRasterCommand& command, const DrawIndexedArguments& arguments, const Mat4& viewProjection,
+                      SoftwareRasterizer::DrawDesc& desc)
+    {
+        if (command.pipeline == nullptr)
+            return false;
+        auto& raster   = command.pipeline->getRasterState();
+        auto& position = raster.position;
+        if ((position.format != Format::R32G32B32_FLOAT && position.format != Format::R32G32B32A32_FLOAT) ||
+            position.slot >= NullRasterCommand::MaxVertexBuffers)
+            return false;
+
+        auto& vertices = command.vertexBuffers[position.slot];
+        desc.positions = getBufferData(vertices.buffer, vertices.offset, vertices.size);
+        if (desc.positions == nullptr || vertices.stride == 0 || vertices.size < position.offset + 3 * sizeof(float))
+            return false;
+        desc.positions  += position.offset;
+        desc.stride      = vertices.stride;
+        desc.vertexCount = (vertices.size - position.offset - 3 * sizeof(float)) / vertices.stride + 1;
+
+        auto& indices   = command.indexBuffer;
+        auto  indexSize = indices.format == Format::R16_UINT ? 2u : 4u;
+        auto  data      = getBufferData(indices.buffer, indices.offset, indices.size);
+        if (data == nullptr || arguments.startIndex >= indices.size / indexSize)
+            return false;
+        desc.indices    = data + static_cast<uint64_t>(arguments.startIndex) * indexSize;
+        desc.indices32  = indexSize == 4;
+        desc.indexCount = std::min(arguments.indexCount, indices.size / indexSize - arguments.startIndex);
+        desc.baseVertex = arguments.baseVertex;
+
+        // Instance ids advance from the start instance, without them it offsets the world matrices
+        desc.instanceCount    = arguments.instanceCount;
+        uint64_t worldsOffset = command.worldsOffset;
+        auto&    instance     = raster.instance;
+        if (instance.format == Format::R32_UINT && instance.slot < NullRasterCommand::MaxVertexBuffers)
+        {
+            auto& ids   = command.vertexBuffers[instance.slot];
+            auto  first = static_cast<uint64_t>(arguments.startInstance) * ids.stride + instance.offset;
+            data = getBufferData(ids.buffer, ids.offset, ids.size);
+            if (data == nullptr || ids.stride == 0 || first + sizeof(uint32_t) > ids.size)
+                return false;
+            desc.instanceIds      = data + first;
+            desc.instanceIdStride = ids.stride;
+            desc.instanceCount    = static_cast<uint32_t>(std::min<uint64_t>(desc.instanceCount, (ids.size - first - sizeof(uint32_t)) / ids.stride + 1));
+        }
+        else
+        {
+            worldsOffset += static_cast<uint64_t>(arguments.startInstance) * sizeof(Mat4);
+        }
+        if (command.worlds != nullptr)
+        {
+            auto size = command.worlds->getDesc().size;
+            desc.worlds     = worldsOffset < size ? getBufferData(command.worlds, worldsOffset, 0) : nullptr;
+            desc.worldCount = desc.worlds != nullptr ? static_cast<uint32_t>((size - worldsOffset) / sizeof(Mat4)) : 0;
+            if (desc.worlds == nullptr)
+                return false;
+        }
+        desc.viewProjection = viewProjection;
+
+        desc.viewport   = command.viewport;
+        desc.scissor    = command.scissor;
+        desc.cullMode   = raster.cullMode;
+        desc.depthTest  = raster.depthTest;
+        desc.depthWrite = raster.depthWrite;
+        desc.depthFunc  = raster.depthFunc;
+
+        // Flat color from the first float4 of the constants, white without them
+        float color[4] = { 1.f, 1.f, 1.f, 1.f };
+        if (auto constants = getBufferData(command.constants, command.constantsOffset, sizeof(color)))
+            std::memcpy(color, constants, sizeof(color));
+        desc.color = SoftwareRasterizer::packColor(color);
+        return true;
+    }
+}
+
+// ---------
+//  Resource
+// ---------
+
+NullResource::~NullResource()
+{
+    // Leave the heap first, freeing the allocation may destroy the heap
+    if (m_heap != nullptr)
+        std::erase(m_heap->m_placed, this);
+    if (m_allocator != nullptr)
+        m_allocator->free(m_allocation);
+}
+
+// -----
+//  Heap
+// -----
+
+NullHeap::NullHeap(NullDevice& device, const HeapDesc& desc)
+    : m_device(device), m_desc(desc)
+{
+    if (m_desc.type == HeapType::Default)
+        m_device.m_residentBytes += m_desc.size;
+}
+
+NullHeap::~NullHeap()
+{
+    if (!m_placed.empty())
+        m_device.reportError("Heap: destroyed while placed resources still live in it");
+    if (m_desc.type == HeapType::Default && m_resident)
+        m_device.m_residentBytes -= m_desc.size;
+
+    // Keep remaining resources from touching the destroyed heap
+    for (auto resource : m_placed)
+        resource->m_heap = nullptr;
+}
+
+// --------
+//  Texture
+// --------
+
+NullTexture::NullTexture(NullDevice& device, const TextureDesc& desc, ResourceState state)
+    : Texture(state), NullResource(state), m_device(device), m_desc(desc)
+{
+    if (hasFlag(m_desc.usage, TextureUsage::RenderTarget))
+    {
+        m_rtv = m_device.getDescriptorAllocator(DescriptorHeapType::Rtv).allocate();
+        if (m_rtv == DescriptorAllocator::InvalidIndex)
+            m_device.reportError("Device::createTexture: render target view heap is full");
+    }
+    if (hasFlag(m_desc.usage, TextureUsage::DepthStencil))
+    {
+        m_dsv = m_device.getDescriptorAllocator(DescriptorHeapType::Dsv).allocate();
+        if (m_dsv == DescriptorAllocator::InvalidIndex)
+            m_device.reportError("Device::createTexture: depth stencil view heap is full");
+    }
+
+    // Rows padded for the vector loads of the rasterizer
+    bool rasterTarget = (hasFlag(m_desc.usage, TextureUsage::RenderTarget) && m_desc.format == Format::R8G8B8A8_UNORM) ||
+                        hasFlag(m_desc.usage, TextureUsage::DepthStencil);
+    if (m_device.isRasterizing() && rasterTarget)
+    {
+        m_rowPitch = (m_desc.width + RasterPitchAlignment - 1) / RasterPitchAlignment * RasterPitchAlignment;
+        m_pixels   = std::make_unique<uint8_t[]>(static_cast<size_t>(m_rowPitch) * m_desc.height * sizeof(uint32_t));
+    }
+}
+
+NullTexture::~NullTexture()
+{
+    if (m_rtv != DescriptorAllocator::InvalidIndex)
+        m_device.getDescriptorAllocator(DescriptorHeapType::Rtv).freeImmediately(m_rtv);
+    if (m_dsv != DescriptorAllocator::InvalidIndex)
+        m_device.getDescriptorAllocator(DescriptorHeapType::Dsv).freeImmediately(m_dsv);
+}
+
+// -------
+//  Buffer
+// -------
+
+NullBuffer::NullBuffer(NullDevice& device, const BufferDesc& desc, ResourceState state, uint64_t gpuAddress)
+    : Buffer(state), NullResource(state), m_device(device), m_desc(desc), m_gpuAddress(gpuAddress)
+{
+    // The rasterizer reads vertices and instances from default buffers too
+    if (m_desc.heapType != HeapType::Default || m_device.isRasterizing())
+        m_data = std::make_unique<uint8_t[]>(m_desc.size);
+
+    if (m_device.isRasterizing())
+    {
+        std::lock_guard lock(m_device.m_bufferMutex);
+        m_device.m_buffers[m_gpuAddress] = this;
+    }
+}
+
+NullBuffer::~NullBuffer()
+{
+    if (m_device.isRasterizing())
+    {
+        std::lock_guard lock(m_device.m_bufferMutex);
+        m_device.m_buffers.erase(m_gpuAddress);
+    }
+}
+
+// ------------------
+//  Command allocator
+// ------------------
+
+void NullCommandAllocator::reset()
+{
+    if (m_recordingList != nullptr)
+        m_device.reportError("CommandAllocator::reset: a command list is still recording with the allocator");
+    if (m_device.getNullQueue(m_type).getCompletedValue() < m_pendingValue)
+        m_device.reportError("CommandAllocator::reset: GPU has not finished commands allocated from the allocator");
+}
+
+// -------------
+//  Command list
+// -------------
+
+void NullCommandList::reset(CommandAllocator& allocator)
+{
+    auto& nullAllocator = static_cast<NullCommandAllocator&>(allocator);
+    if (isRecording())
+    {
+        m_device.reportError("CommandList::reset: command list is not closed");
+        m_allocator->m_recordingList = nullptr;
+    }
+    if (nullAllocator.m_recordingList != nullptr)
+        m_device.reportError("CommandList::reset: allocator is used by another recording command list");
+    if (nullAllocator.m_type != m_type)
+        m_device.reportError("CommandList::reset: allocator is created for another queue type");
+
+    nullAllocator.m_recordingList = this;
+    m_allocator     = &nullAllocator;
+    m_lastAllocator = &nullAllocator;
+    m_commands.clear();
+
+    m_rootSignature = nullptr;
+    m_hasPipeline   = false;
+    m_indexCount    = 0;
+    m_hasIndices    = false;
+    m_raster        = {};
+    m_rasterCommands.clear();
+}
+
+void NullCommandList::close()
+{
+    if (!checkRecording("close", true))
+        return;
+    m_allocator->m_recordingList = nullptr;
+    m_allocator = nullptr;
+}
+
+void NullCommandList::setViewport(const Viewport& viewport)
+{
+    if (!checkRecording("setViewport"))
+        return;
+    if (viewport.width <= 0.f || viewport.height <= 0.f || viewport.minDepth > viewport.maxDepth)
+        m_device.reportError("CommandList::setViewport: invalid viewport");
+    m_raster.viewport = viewport;
+    m_commands.push_back({ NullCommandType::SetViewport });
+}
+
+void NullCommandList::setScissorRect(const Rect& rect)
+{
+    if (!checkRecording("setScissorRect"))
+        return;
+    if (rect.right < rect.left || rect.bottom < rect.top)
+        m_device.reportError("CommandList::setScissorRect: invalid rectangle");
+    m_raster.scissor = rect;
+    m_commands.push_back({ NullCommandType::SetScissorRect });
+}
+
+void NullCommandList::resourceBarrier(const ResourceBarrier* barriers, uint32_t count)
+{
+    if (!checkRecording("resourceBarrier", true))
+        return;
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        if (barriers[i].resource == nullptr)
+        {
+            m_device.reportError("CommandList::resourceBarrier: null resource");
+            continue;
+        }
+        if (barriers[i].flags == BarrierFlags::None && isSameState(barriers[i].before, barriers[i].after))
+            m_device.reportError("CommandList::resourceBarrier: before and after states are the same");
+        if (m_type == QueueType::Copy && !(isCopyState(barriers[i].before) && isCopyState(barriers[i].after)))
+            m_device.reportError("CommandList::resourceBarrier: copy lists only transition between common and copy states");
+
+        NullCommand command = { NullCommandType::ResourceBarrier };
+        command.barrier = barriers[i];
+        m_commands.push_back(command);
+    }
+}
+
+void NullCommandList::aliasingBarrier(Resource* before, Resource* after)
+{
+    if (!checkRecording("aliasingBarrier"))
+        return;
+    if (after == nullptr)
+    {
+        m_device.reportError("CommandList::aliasingBarrier: null resource after");
+        return;
+    }
+
+    NullCommand command = { NullCommandType::AliasingBarrier };
+    command.barrier.resource = after;
+    command.aliasBefore      = before;
+    m_commands.push_back(command);
+}
+
+void NullCommandList::clearRenderTarget(Texture& target, const float color[4])
+{
+    if (!checkRecording("clearRenderTarget"))
+        return;
+    if (!hasFlag(target.getDesc().usage, TextureUsage::RenderTarget))
+        m_device.reportError("CommandList::clearRenderTarget: texture is not created as render target");
+
+    NullCommand command = { NullCommandType::ClearRenderTarget };
+    command.targets[0]  = &target;
+    command.targetCount = 1;
+    m_commands.push_back(command);
+
+    if (m_device.isRasterizing())
+    {
+        NullRasterCommand clear;
+        clear.type        = NullRasterCommandType::ClearRenderTarget;
+        clear.colorTarget = dynamic_cast<NullTexture*>(&target);
+        std::copy(color, color + 4, clear.clearValue);
+        m_rasterCommands.push_back(clear);
+    }
+}
+
+void NullCommandList::clearDepthStencil(Texture& target, float depth, uint8_t /*stencil*/)
+{
+    if (!checkRecording("clearDepthStencil"))
+        return;
+    if (!hasFlag(target.getDesc().usage, TextureUsage::DepthStencil))
+        m_device.reportError("CommandList::clearDepthStencil: texture is not created as depth stencil");
+    if (depth < 0.f || depth > 1.f)
+        m_device.reportError("CommandList::clearDepthStencil: depth is out of [0, 1]");
+
+    NullCommand command  = { NullCommandType::ClearDepthStencil };
+    command.depthStencil = &target;
+    m_commands.push_back(command);
+
+    if (m_device.isRasterizing())
+    {
+        NullRasterCommand clear;
+        clear.type          = NullRasterCommandType::ClearDepthStencil;
+        clear.depthTarget   = dynamic_cast<NullTexture*>(&target);
+        clear.clearValue[0] = depth;
+        m_rasterCommands.push_back(clear);
+    }
+}
+
+void NullCommandList::setRenderTargets(Texture* const* targets, uint32_t count, Texture* depthStencil)
+{
+    if (!checkRecording("setRenderTargets"))
+        return;
+    if (count > NullCommand::MaxRenderTargets)
+    {
+        m_device.reportError("CommandList::setRenderTargets: too many render targets");
+        count = NullCommand::MaxRenderTargets;
+    }
+
+    NullCommand command = { NullCommandType::SetRenderTargets };
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        if (!hasFlag(targets[i]->getDesc().usage, TextureUsage::RenderTarget))
+            m_device.reportError("CommandList::setRenderTargets: texture is not created as render target");
+        command.targets[i] = targets[i];
+    }
+    if (depthStencil != nullptr && !hasFlag(depthStencil->getDesc().usage, TextureUsage::DepthStencil))
+        m_device.reportError("CommandList::setRenderTargets: texture is not created as depth stencil");
+    command.targetCount  = count;
+    command.depthStencil = depthStencil;
+    m_commands.push_back(command);
+
+    // Only the first render target is rasterized
+    m_raster.colorTarget = count > 0 ? dynamic_cast<NullTexture*>(targets[0]) : nullptr;
+    m_raster.depthTarget = dynamic_cast<NullTexture*>(depthStencil);
+}
+
+void NullCommandList::setGraphicsRootSignature(RootSignature& rootSignature)
+{
+    if (!checkRecording("setGraphicsRootSignature"))
+        return;
+    m_rootSignature = dynamic_cast<NullRootSignature*>(&rootSignature);
+    if (m_rootSignature == nullptr)
+        m_device.reportError("CommandList::setGraphicsRootSignature: root signature is not created by null device");
+    m_commands.push_back({ NullCommandType::SetRootSignature });
+}
+
+void NullCommandList::setPipelineState(PipelineState& pipeline)
+{
+    if (!checkRecording("setPipelineState"))
+        return;
+    m_raster.pipeline = dynamic_cast<NullPipelineState*>(&pipeline);
+    if (m_raster.pipeline == nullptr)
+        m_device.reportError("CommandList::setPipelineState: pipeline is not created by null device");
+    m_hasPipeline = true;
+    m_commands.push_back({ NullCommandType::SetPipelineState });
+}
+
+void NullCommandList::setGraphicsRootConstantBufferView(uint32_t parameter, uint64_t gpuAddress)
+{
+    if (!checkRecording("setGraphicsRootConstantBufferView"))
+        return;
+    checkRootParameter("setGraphicsRootConstantBufferView", parameter, RootParameterType::ConstantBuffer);
+    if (gpuAddress % 256 != 0)
+        m_device.reportError("CommandList::setGraphicsRootConstantBufferView: address is not 256 bytes aligned");
+    if (m_device.isRasterizing() && isFirstRootParameter(parameter, RootParameterType::ConstantBuffer))
+        m_raster.constants = m_device.findBuffer(gpuAddress, m_raster.constantsOffset);
+    m_commands.push_back({ NullCommandType::SetRootView });
+}
+
+void NullCommandList::setGraphicsRootShaderResourceView(uint32_t parameter, uint64_t gpuAddress)
+{
+    if (!checkRecording("setGraphicsRootShaderResourceView"))
+        return;
+    checkRootParameter("setGraphicsRootShaderResourceView", parameter, RootParameterType::ShaderResource);
+    if (gpuAddress % 4 != 0)
+        m_device.reportError("CommandList::setGraphicsRootShaderResourceView: address is not 4 bytes aligned");
+    if (m_device.isRasterizing() && isFirstRootParameter(parameter, RootParameterType::ShaderResource))
+        m_raster.worlds = m_device.findBuffer(gpuAddress, m_raster.worldsOffset);
+    m_commands.push_back({ NullCommandType::SetRootView });
+}
+
+void NullCommandList::setVertexBuffers(uint32_t startSlot, const VertexBufferView* views, uint32_t count)
+{
+    if (!checkRecording("setVertexBuffers"))
+        return;
+    if (startSlot + count > 32)
+        m_device.reportError("CommandList::setVertexBuffers: slots are out of the 32 input slots");
+
+    // One command per MaxReads views, a command only holds that many buffers
+    for (uint32_t begin = 0; begin < count; begin += NullCommand::MaxReads)
+    {
+        NullCommand command = { NullCommandType::SetVertexBuffers };
+        for (uint32_t i = begin; i < count && i < begin + NullCommand::MaxReads; ++i)
+        {
+            auto& view = views[i];
+            if (view.buffer == nullptr)
+                continue;
+            if (view.offset > view.buffer->getDesc().size || view.size > view.buffer->getDesc().size - view.offset)
+                m_device.reportError("CommandList::setVertexBuffers: view is out of the buffer");
+            if (view.stride == 0 && view.size != 0)
+                m_device.reportError("CommandList::setVertexBuffers: view has zero stride");
+            command.reads[command.readCount++] = view.buffer;
+        }
+        m_commands.push_back(command);
+    }
+    for (uint32_t i = 0; i < count && startSlot + i < NullRasterCommand::MaxVertexBuffers; ++i)
+        m_raster.vertexBuffers[startSlot + i] = views[i];
+}
+
+void NullCommandList::setIndexBuffer(const IndexBufferView& view)
+{
+    if (!checkRecording("setIndexBuffer"))
+        return;
+    auto indexSize = getFormatSize(view.format);
+    if (view.format != Format::R16_UINT && view.format != Format::R32_UINT)
+    {
+        m_device.reportError("CommandList::setIndexBuffer: format is not R16_UINT or R32_UINT");
+        return;
+    }
+    if (view.buffer == nullptr || view.offset > view.buffer->getDesc().size || view.size > view.buffer->getDesc().size - view.offset)
+    {
+        m_device.reportError("CommandList::setIndexBuffer: view is null or out of the buffer");
+        return;
+    }
+    if (view.offset % indexSize != 0)
+        m_device.reportError("CommandList::setIndexBuffer: offset is not aligned to the index size");
+
+    m_indexCount         = view.size / indexSize;
+    m_hasIndices         = true;
+    m_raster.indexBuffer = view;
+
+    NullCommand command = { NullCommandType::SetIndexBuffer };
+    command.reads[0]  = view.buffer;
+    command.readCount = 1;
+    m_commands.push_back(command);
+}
+
+void NullCommandList::drawIndexedInstanced(uint32_t indexCount, uint32_t instanceCount, uint32_t startIndex, int32_t baseVertex, uint32_t startInstance)
+{
+    if (!checkRecording("drawIndexedInstanced") || !checkDrawState("drawIndexedInstanced"))
+        return;
+    if (static_cast<uint64_t>(startIndex) + indexCount > m_indexCount)
+        m_device.reportError("CommandList::drawIndexedInstanced: indices are out of the index buffer view");
+
+    NullCommand command = { NullCommandType::DrawIndexedInstanced };
+    command.drawCount = 1;
+    command.instances = instanceCount;
+    m_commands.push_back(command);
+
+    if (m_device.isRasterizing())
+    {
+        auto draw = m_raster;
+        draw.type      = NullRasterCommandType::Draw;
+        draw.arguments = { indexCount, instanceCount, startIndex, baseVertex, startInstance };
+        m_rasterCommands.push_back(draw);
+    }
+}
+
+void NullCommandList::executeIndirect(CommandSignature& signature, uint32_t maxCount, Buffer& arguments, uint64_t argumentOffset,
+                                      Buffer* countBuffer, uint64_t countOffset)
+{
+    if (!checkRecording("executeIndirect") || !checkDrawState("executeIndirect"))
+        return;
+    auto nullSignature = dynamic_cast<NullCommandSignature*>(&signature);
+    if (nullSignature == nullptr)
+    {
+        m_device.reportError("CommandList::executeIndirect: command signature is not created by null device");
+        return;
+    }
+    auto stride = nullSignature->getByteStride();
+    auto size   = maxCount == 0 ? 0 : static_cast<uint64_t>(maxCount - 1) * stride + sizeof(DrawIndexedArguments);
+    if (argumentOffset % 4 != 0 || argumentOffset > arguments.getDesc().size || size > arguments.getDesc().size - argumentOffset)
+    {
+        m_device.reportError("CommandList::executeIndirect: arguments are not aligned or out of the buffer");
+        return;
+    }
+    if (countBuffer != nullptr && (countOffset % 4 != 0 || countOffset + sizeof(uint32_t) > countBuffer->getDesc().size))
+    {
+        m_device.reportError("CommandList::executeIndirect: count is not aligned or out of the buffer");
+        return;
+    }
+
+    NullCommand command = { NullCommandType::ExecuteIndirect };
+    command.reads[command.readCount++] = &arguments;
+    if (countBuffer != nullptr)
+        command.reads[command.readCount++] = countBuffer;
+    command.readOffsets[0] = argumentOffset;
+    command.readOffsets[1] = countOffset;
+    command.drawCount      = maxCount;
+    command.stride         = stride;
+    m_commands.push_back(command);
+
+    if (m_device.isRasterizing())
+    {
+        auto draw = m_raster;
+        draw.type       = NullRasterCommandType::DrawIndirect;
+        draw.buffers[0] = dynamic_cast<NullBuffer*>(&arguments);
+        draw.buffers[1] = dynamic_cast<NullBuffer*>(countBuffer);
+        draw.offsets[0] = argumentOffset;
+        draw.offsets[1] = countOffset;
+        draw.maxCount   = maxCount;
+        draw.stride     = stride;
+        m_rasterCommands.push_back(draw);
+    }
+}
+
+void NullCommandList::copyBufferRegion(Buffer& dest, uint64_t destOffset, Buffer& source, uint64_t sourceOffset, uint64_t size)
+{
+    if (!checkRecording("copyBufferRegion", true))
+        return;
+    if (size == 0 || destOffset > dest.getDesc().size || size > dest.getDesc().size - destOffset ||
+        sourceOffset > source.getDesc().size || size > source.getDesc().size - sourceOffset)
+        m_device.reportError("CommandList::copyBufferRegion: region is empty or out of the buffers");
+    if (dest.getDesc().heapType == HeapType::Upload)
+        m_device.reportError("CommandList::copyBufferRegion: destination is an upload buffer");
+    if (&dest == &source)
+        m_device.reportError("CommandList::copyBufferRegion: destination and source are the same buffer");
+
+    NullCommand command = { NullCommandType::CopyBufferRegion };
+    command.copyDest   = &dest;
+    command.copySource = &source;
+    command.copySize   = size;
+    m_commands.push_back(command);
+
+    // Draws read the default buffers copies fill
+    if (m_device.isRasterizing())
+    {
+        NullRasterCommand copy;
+        copy.type       = NullRasterCommandType::CopyBuffer;
+        copy.buffers[0] = dynamic_cast<NullBuffer*>(&dest);
+        copy.buffers[1] = dynamic_cast<NullBuffer*>(&source);
+        copy.offsets[0] = destOffset;
+        copy.offsets[1] = sourceOffset;
+        copy.size       = size;
+        m_rasterCommands.push_back(copy);
+    }
+}
+
+void NullCommandList::copyBufferToTexture(Texture& dest, Buffer& source, uint64_t sourceOffset, uint32_t rowPitch)
+{
+    if (!checkRecording("copyBufferToTexture", true))
+        return;
+    auto& desc = dest.getDesc();
+    auto  size = static_cast<uint64_t>(rowPitch) * desc.height;
+    if (sourceOffset % TextureCopyPlacementAlignment != 0 || rowPitch % TextureCopyPitchAlignment != 0)
+        m_device.reportError("CommandList::copyBufferToTexture: source offset or row pitch is not aligned");
+    if (rowPitch < static_cast<uint64_t>(desc.width) * getFormatSize(desc.format))
+        m_device.reportError("CommandList::copyBufferToTexture: row pitch is smaller than a texture row");
+    if (sourceOffset > source.getDesc().size || size > source.getDesc().size - sourceOffset)
+        m_device.reportError("CommandList::copyBufferToTexture: texture data is out of the source buffer");
+
+    NullCommand command = { NullCommandType::CopyBufferToTexture };
+    command.copyDest   = &dest;
+    command.copySource = &source;
+    command.copySize   = size;
+    m_commands.push_back(command);
+}
+
+void NullCommandList::writeTimestamp(TimestampQueryHeap& heap, uint32_t index)
+{
+    if (!checkRecording("writeTimestamp"))
+        return;
+    if (index >= heap.getCount())
+    {
+        m_device.reportError("CommandList::writeTimestamp: index is out of the query heap");
+        return;
+    }
+
+    NullCommand command = { NullCommandType::WriteTimestamp };
+    command.queryHeap  = &heap;
+    command.queryIndex = index;
+    m_commands.push_back(command);
+}
+
+void NullCommandList::resolveTimestamps(TimestampQueryHeap& heap, uint32_t first, uint32_t count, Buffer& dest, uint64_t destOffset)
+{
+    if (!checkRecording("resolveTimestamps"))
+        return;
+    auto size = static_cast<uint64_t>(count) * sizeof(uint64_t);
+    if (count == 0 || first > heap.getCount() || count > heap.getCount() - first)
+    {
+        m_device.reportError("CommandList::resolveTimestamps: queries are out of the query heap");
+        return;
+    }
+    if (dest.getDesc().heapType != HeapType::Readback)
+    {
+        m_device.reportError("CommandList::resolveTimestamps: destination is not a readback buffer");
+        return;
+    }
+    if (destOffset % sizeof(uint64_t) != 0 || destOffset > dest.getDesc().size || size > dest.getDesc().size - destOffset)
+    {
+        m_device.reportError("CommandList::resolveTimestamps: destination offset is not aligned or out of the buffer");
+        return;
+    }
+
+    NullCommand command = { NullCommandType::ResolveTimestamps };
+    command.copyDest   = &dest;
+    command.copyOffset = destOffset;
+    command.queryHeap  = &heap;
+    command.queryIndex = first;
+    command.queryCount = count;
+    m_commands.push_back(command);
+}
+
+bool NullCommandList::checkDrawState(const char* command)
+{
+    if (m_rootSignature == nullptr || !m_hasPipeline || !m_hasIndices)
+    {
+        m_device.reportError(std::string("CommandList::") + command + ": root signature, pipeline or index buffer is not set");
+        return false;
+    }
+    return true;
+}
+
+void NullCommandList::checkRootParameter(const char* command, uint32_t parameter, RootParameterType type)
+{
+    if (m_rootSignature == nullptr)
+    {
+        m_device.reportError(std::string("CommandList::") + command + ": root signature is not set");
+        return;
+    }
+    auto& parameters = m_rootSignature->getDesc().parameters;
+    if (parameter >= parameters.size() || parameters[parameter].type != type)
+        m_device.reportError(std::string("CommandList::") + command + ": root parameter is out of the root signature or of another type");
+}
+
+bool NullCommandList::isFirstRootParameter(uint32_t parameter, RootParameterType type) const noexcept
+{
+    if (m_rootSignature == nullptr)
+        return false;
+    auto& parameters = m_rootSignature->getDesc().parameters;
+    for (uint32_t i = 0; i < parameters.size(); ++i)
+    {
+        if (parameters[i].type == type)
+            return i == parameter;
+    }
+    return false;
+}
+
+bool NullCommandList::checkRecording(const char* command, bool allowedOnCopy)
+{
+    if (!isRecording())
+    {
+        m_device.reportError(std::string("CommandList::") + command + ": command list is closed");
+        return false;
+    }
+    if (m_type == QueueType::Copy && !allowedOnCopy)
+    {
+        m_device.reportError(std::string("CommandList::") + command + ": command is not allowed on a copy list");
+        return false;
+    }
+    return true;
+}
+
+// -----------
+//  Swap chain
+// -----------
+
+NullSwapChain::NullSwapChain(NullDevice& device, const SwapChainDesc& desc)
+    : m_device(device), m_desc(desc)
+{
+    createBuffers();
+}
+
+void NullSwapChain::present(uint32_t /*syncInterval*/)
+{
+    auto& backBuffer = *m_buffers[m_index];
+    if (!isSameState(backBuffer.getState(), ResourceState::Present))
+        m_device.reportError(std::string("SwapChain::present: back buffer is in ") + toString(backBuffer.getState()) + " state");
+
+    {
+        std::lock_guard lock(m_device.m_mutex);
+        ++m_device.m_stats.presents;
+    }
+    m_index = (m_index + 1) % getBufferCount();
+
+    // The frame signals right after presenting, the present leaves the queue when GPU passes that signal
+    if (m_desc.maxFrameLatency != 0)
+        m_queuedFrames.push_back(m_device.getNullQueue().getNextValue());
+}
+
+void NullSwapChain::resize(uint32_t width, uint32_t height)
+{
+    if (!m_device.getNullQueue().isIdle())
+        m_device.reportError("SwapChain::resize: back buffers may still be used by GPU");
+
+    m_desc.width  = width;
+    m_desc.height = height;
+    createBuffers();
+
+    std::lock_guard lock(m_device.m_mutex);
+    ++m_device.m_stats.swapChainResizes;
+}
+
+void NullSwapChain::setSourceSize(uint32_t width, uint32_t height)
+{
+    if (width == 0 || height == 0 || width > m_desc.width || height > m_desc.height)
+        m_device.reportError("SwapChain::setSourceSize: source region must be non empty and fit the back buffers");
+
+    m_sourceWidth  = width;
+    m_sourceHeight = height;
+}
+
+void NullSwapChain::waitForFrameLatency()
+{
+    auto& queue = m_device.getNullQueue();
+    while (!m_queuedFrames.empty() && (m_queuedFrames.size() >= m_desc.maxFrameLatency || queue.isCompleted(m_queuedFrames.front())))
+    {
+        queue.waitForValue(m_queuedFrames.front());
+        m_queuedFrames.pop_front();
+    }
+}
+
+void NullSwapChain::createBuffers()
+{
+    TextureDesc desc = {};
+    desc.width  = m_desc.width;
+    desc.height = m_desc.height;
+    desc.format = m_desc.format;
+    desc.usage  = TextureUsage::RenderTarget;
+
+    m_buffers.clear();
+    for (uint32_t i = 0; i < m_desc.bufferCount; ++i)
+        m_buffers.push_back(std::make_unique<NullTexture>(m_device, desc, ResourceState::Present));
+    m_index        = 0;
+    m_sourceWidth  = m_desc.width;
+    m_sourceHeight = m_desc.height;
+}
+
+// -------
+//  Device
+// -------
+
+NullDevice::NullDevice(const Config& config)
+    : m_config(config),
+      m_memoryBudget(config.memoryBudget)
+{
+    for (uint32_t i = 0; i < static_cast<uint32_t>(DescriptorHeapType::Count); ++i)
+    {
+        auto capacity = getDescriptorHeapCapacity(static_cast<DescriptorHeapType>(i));
+        m_descriptorAllocators[i] = std::make_unique<DescriptorAllocator>(capacity.persistent, capacity.transient);
+    }
+    m_queue     = std::make_unique<NullCommandQueue>(*this, QueueType::Direct);
+    m_copyQueue = std::make_unique<NullCommandQueue>(*this, QueueType::Copy);
+
+    MemoryAllocator::Config allocatorConfig;
+    allocatorConfig.blockSize  = m_config.heapBlockSize;
+    allocatorConfig.mixedHeaps = m_config.mixedHeaps;
+    m_memoryAllocator = std::make_unique<MemoryAllocator>(*this, allocatorConfig);
+}
+
+NullDevice::~NullDevice()
+{
+    // Stop GPU threads before anything they may touch is destroyed, each may wait on the other
+    m_queue->stop();
+    m_copyQueue->stop();
+    m_queue.reset();
+    m_copyQueue.reset();
+}
+
+std::unique_ptr<CommandAllocator> NullDevice::createCommandAllocator(QueueType type)
+{
+    return std::make_unique<NullCommandAllocator>(*this, type);
+}
+
+std::unique_ptr<CommandList> NullDevice::createCommandList(QueueType type)
+{
+    return std::make_unique<NullCommandList>(*this, type);
+}
+
+std::unique_ptr<SwapChain> NullDevice::createSwapChain(const SwapChainDesc& desc)
+{
+    if (desc.width == 0 || desc.height == 0 || desc.bufferCount < 2)
+        reportError("Device::createSwapChain: invalid swap chain description");
+    return std::make_unique<NullSwapChain>(*this, desc);
+}
+
+std::unique_ptr<Texture> NullDevice::createTexture(const TextureDesc& desc, ResourceState initialState)
+{
+    bool isTarget   = hasFlag(desc.usage, TextureUsage::RenderTarget) || hasFlag(desc.usage, TextureUsage::DepthStencil);
+    auto allocation = m_memoryAllocator->allocate(HeapType::Default, isTarget ? HeapUsage::RenderTargets : HeapUsage::Textures,
+                                                  getTextureAllocationInfo(desc));
+
+    // Nothing else lives in the allocation, the texture is usable without an aliasing barrier
+    auto  texture = createPlacedTexture(*allocation.heap, allocation.offset, desc, initialState);
+    auto& placed  = static_cast<NullTexture&>(*texture);
+    placed.m_aliasActive = true;
+    placed.m_allocator   = m_memoryAllocator.get();
+    placed.m_allocation  = allocation;
+    return texture;
+}
+
+std::unique_ptr<Heap> NullDevice::createHeap(const HeapDesc& desc)
+{
+    if (desc.size == 0 || desc.size % PlacementAlignment != 0)
+        reportError("Device::createHeap: heap size must be a non zero multiple of 64KB");
+    if (desc.usage == HeapUsage::All && !m_config.mixedHeaps)
+        reportError("Device::createHeap: heaps for all resources need resource heap tier 2");
+    return std::make_unique<NullHeap>(*this, desc);
+}
+
+std::unique_ptr<TimestampQueryHeap> NullDevice::createTimestampQueryHeap(uint32_t count)
+{
+    if (count == 0)
+        reportError("Device::createTimestampQueryHeap: query count is zero");
+    return std::make_unique<NullTimestampQueryHeap>(count);
+}
+
+std::unique_ptr<CommandSignature> NullDevice::createCommandSignature(uint32_t byteStride)
+{
+    if (byteStride < sizeof(DrawIndexedArguments) || byteStride % 4 != 0)
+        reportError("Device::createCommandSignature: byte stride is smaller than the arguments or not a multiple of 4");
+    return std::make_unique<NullCommandSignature>(byteStride);
+}
+
+std::unique_ptr<Texture> NullDevice::createPlacedTexture(Heap& heap, uint64_t offset, const TextureDesc& desc, ResourceState initialState)
+{
+    if (desc.width == 0 || desc.height == 0)
+        reportError("Device::createTexture: texture size is zero");
+    if (hasFlag(desc.usage, TextureUsage::DepthStencil) != isDepthFormat(desc.format))
+        reportError("Device::createTexture: depth stencil usage does not match format");
+
+    auto& nullHeap = static_cast<NullHeap&>(heap);
+    auto  info     = getTextureAllocationInfo(desc);
+    bool  isTarget = hasFlag(desc.usage, TextureUsage::RenderTarget) || hasFlag(desc.usage, TextureUsage::DepthStencil);
+    if (offset % info.alignment != 0)
+        reportError("Device::createPlacedTexture: offset does not meet the texture alignment");
+    if (nullHeap.m_desc.type != HeapType::Default)
+        reportError("Device::createPlacedTexture: textures can only be placed in default heap");
+    if (nullHeap.m_desc.usage != HeapUsage::All && nullHeap.m_desc.usage != (isTarget ? HeapUsage::RenderTargets : HeapUsage::Textures))
+        reportError("Device::createPlacedTexture: heap usage does not allow the texture");
+
+    auto texture = std::make_unique<NullTexture>(*this, desc, initialState);
+    place(*texture, nullHeap, offset, info.size);
+    return texture;
+}
+
+AllocationInfo NullDevice::getTextureAllocationInfo(const TextureDesc& desc)
+{
+    uint64_t size = static_cast<uint64_t>(desc.width) * desc.height * getFormatSize(desc.format);
+    return { (size + PlacementAlignment - 1) / PlacementAlignment * PlacementAlignment, PlacementAlignment };
+}
+
+std::unique_ptr<Buffer> NullDevice::createBuffer(const BufferDesc& desc, ResourceState initialState)
+{
+    auto allocation = m_memoryAllocator->allocate(desc.heapType, HeapUsage::Buffers, getBufferAllocationInfo(desc));
+
+    auto  buffer = createPlacedBuffer(*allocation.heap, allocation.offset, desc, initialState);
+    auto& placed = static_cast<NullBuffer&>(*buffer);
+    placed.m_aliasActive = true;
+    placed.m_allocator   = m_memoryAllocator.get();
+    placed.m_allocation  = allocation;
+    return buffer;
+}
+
+std::unique_ptr<Buffer> NullDevice::createPlacedBuffer(Heap& heap, uint64_t offset, const BufferDesc& desc, ResourceState initialState)
+{
+    auto& nullHeap = static_cast<NullHeap&>(heap);
+    auto  info     = getBufferAllocationInfo(desc);
+    if (offset % info.alignment != 0)
+        reportError("Device::createPlacedBuffer: offset does not meet the buffer alignment");
+    if (nullHeap.m_desc.type != desc.heapType)
+        reportError("Device::createPlacedBuffer: heap type does not match the buffer");
+    if (nullHeap.m_desc.usage != HeapUsage::All && nullHeap.m_desc.usage != HeapUsage::Buffers)
+        reportError("Device::createPlacedBuffer: heap usage does not allow buffers");
+
+    if (desc.size == 0)
+        reportError("Device::createBuffer: buffer size is zero");
+    if (desc.heapType == HeapType::Upload && initialState != ResourceState::GenericRead)
+        reportError("Device::createBuffer: upload buffer must be created in generic read state");
+    if (desc.heapType == HeapType::Readback && initialState != ResourceState::CopyDest)
+        reportError("Device::createBuffer: readback buffer must be created in copy dest state");
+
+    // Hand out 64KB aligned addresses like a real allocation would get
+    constexpr uint64_t Alignment = 64 * 1024;
+    auto gpuAddress = m_nextGpuAddress.fetch_add((desc.size + Alignment - 1) / Alignment * Alignment + Alignment);
+    auto buffer     = std::make_unique<NullBuffer>(*this, desc, initialState, gpuAddress);
+    place(*buffer, nullHeap, offset, info.size);
+    return buffer;
+}
+
+std::unique_ptr<RootSignature> NullDevice::createRootSignature(const RootSignatureDesc& desc)
+{
+    for (auto& parameter : desc.parameters)
+    {
+        if (parameter.count == 0)
+            reportError("Device::createRootSignature: root parameter with zero count");
+        if (parameter.rangeType == DescriptorRangeType::Sampler && parameter.type != RootParameterType::DescriptorTable)
+            reportError("Device::createRootSignature: samplers can only be bound through descriptor tables");
+    }
+    return std::make_unique<NullRootSignature>(desc);
+}
+
+std::unique_ptr<PipelineState> NullDevice::createGraphicsPipeline(const GraphicsPipelineDesc& desc, const std::vector<uint8_t>* cachedBlob)
+{
+    if (dynamic_cast<NullRootSignature*>(desc.rootSignature) == nullptr)
+        reportError("Device::createGraphicsPipeline: root signature is null or not created by null device");
+    if (desc.vertexShader.empty())
+        reportError("Device::createGraphicsPipeline: vertex shader is empty");
+    if (desc.renderTargetCount > GraphicsPipelineDesc::MaxRenderTargets)
+        reportError("Device::createGraphicsPipeline: too many render targets");
+    for (uint32_t i = 0; i < desc.renderTargetCount && i < GraphicsPipelineDesc::MaxRenderTargets; ++i)
+    {
+        if (isDepthFormat(desc.renderTargetFormats[i]))
+            reportError("Device::createGraphicsPipeline: render target format is a depth format");
+    }
+    if (desc.depthStencilFormat != Format::Unknown && !isDepthFormat(desc.depthStencilFormat))
+        reportError("Device::createGraphicsPipeline: depth stencil format is not a depth format");
+
+    std::vector<uint8_t> blob(PipelineBlobSize);
+    auto hash = hashPipelineDesc(desc);
+    std::memcpy(blob.data(),     &PipelineBlobMagic,      4);
+    std::memcpy(blob.data() + 4, &m_config.driverVersion, 4);
+    std::memcpy(blob.data() + 8, &hash,                   8);
+
+    // Like a driver, a blob from another driver or description is silently ignored
+    bool cacheHit = cachedBlob != nullptr && *cachedBlob == blob;
+    std::this_thread::sleep_for(cacheHit ? m_config.pipelineCompileCost / 10 : m_config.pipelineCompileCost);
+
+    NullPipelineState::RasterState raster;
+    for (auto& element : desc.inputLayout)
+    {
+        if (element.semantic == "POSITION" && element.semanticIndex == 0)
+            raster.position = element;
+        if (element.semantic == "INSTANCE" && element.perInstance && element.format == Format::R32_UINT)
+            raster.instance = element;
+    }
+    raster.cullMode   = desc.cullMode;
+    raster.depthTest  = desc.depthTest;
+    raster.depthWrite = desc.depthWrite;
+    raster.depthFunc  = desc.depthFunc;
+    raster.hasColor   = desc.renderTargetCount > 0 && desc.renderTargetFormats[0] == Format::R8G8B8A8_UNORM;
+    raster.hasDepth   = isDepthFormat(desc.depthStencilFormat);
+
+    {
+        std::lock_guard lock(m_mutex);
+        ++m_stats.pipelinesCreated;
+        if (cacheHit)
+            ++m_stats.pipelineCacheHits;
+    }
+    return std::make_unique<NullPipelineState>(std::move(blob), std::move(raster));
+}
+
+void NullDevice::place(NullResource& resource, NullHeap& heap, uint64_t offset, uint64_t size)
+{
+    if (offset + size > heap.m_desc.size)
+        reportError("Device::createPlaced: resource does not fit the heap at the offset");
+
+    resource.m_heap        = &heap;
+    resource.m_heapOffset  = offset;
+    resource.m_heapSize    = size;
+    resource.m_aliasActive = false;
+    heap.m_placed.push_back(&resource);
+}
+
+void NullDevice::reportError(std::string message)
+{
+    {
+        std::lock_guard lock(m_mutex);
+        ++m_errorCount;
+        if (m_errors.size() < MaxStoredErrors)
+            m_errors.push_back(message);
+    }
+    if (m_config.throwOnError)
+        throw std::logic_error(message);
+}
+
+std::vector<std::string> NullDevice::getErrors() const
+{
+    std::lock_guard lock(m_mutex);
+    return m_errors;
+}
+
+uint64_t NullDevice::getErrorCount() const
+{
+    std::lock_guard lock(m_mutex);
+    return m_errorCount;
+}
+
+MemoryBudget NullDevice::queryMemoryBudget()
+{
+    uint64_t budget = m_memoryBudget;
+    return { budget != 0 ? budget : UINT64_MAX, m_residentBytes };
+}
+
+void NullDevice::evict(Heap* const* heaps, uint32_t count)
+{
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        auto& heap = static_cast<NullHeap&>(*heaps[i]);
+        if (!heap.m_resident)
+        {
+            reportError("Device::evict: heap is evicted already");
+            continue;
+        }
+        if (heap.m_lastUse[0] > m_queue->getCompletedValue() || heap.m_lastUse[1] > m_copyQueue->getCompletedValue())
+            reportError("Device::evict: GPU may still use the heap");
+
+        heap.m_resident = false;
+        if (heap.m_desc.type == HeapType::Default)
+            m_residentBytes -= heap.m_desc.size;
+    }
+
+    std::lock_guard lock(m_mutex);
+    m_stats.evictedHeaps += count;
+}
+
+void NullDevice::makeResident(Heap* const* heaps, uint32_t count)
+{
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        // D3D12 counts residency references, a heap made resident twice would need two evictions
+        auto& heap = static_cast<NullHeap&>(*heaps[i]);
+        if (heap.m_resident)
+        {
+            reportError("Device::makeResident: heap is resident already");
+            continue;
+        }
+
+        heap.m_resident = true;
+        if (heap.m_desc.type == HeapType::Default)
+            m_residentBytes += heap.m_desc.size;
+    }
+
+    std::lock_guard lock(m_mutex);
+    m_stats.residentHeaps += count;
+}
+
+NullDevice::Stats NullDevice::getStats() const
+{
+    std::lock_guard lock(m_mutex);
+    return m_stats;
+}
+
+void NullDevice::resetStats()
+{
+    std::lock_guard lock(m_mutex);
+    m_stats = {};
+}
+
+NullBuffer* NullDevice::findBuffer(uint64_t gpuAddress, uint64_t& offset) const
+{
+    std::lock_guard lock(m_bufferMutex);
+    auto it = m_buffers.upper_bound(gpuAddress);
+    if (it == m_buffers.begin())
+        return nullptr;
+    --it;
+    if (gpuAddress - it->first >= it->second->getDesc().size)
+        return nullptr;
+    offset = gpuAddress - it->first;
+    return it->second;
+}
+
+void NullDevice::rasterize(SoftwareRasterizer* rasterizer, const std::vector<NullRasterCommand>& commands)
+{
+    for (auto& command : commands)
+    {
+        if (command.type == NullRasterCommandType::CopyBuffer)
+        {
+            auto dest   = getBufferData(command.buffers[0], command.offsets[0], command.size);
+            auto source = getBufferData(command.buffers[1], command.offsets[1], command.size);
+            if (dest != nullptr && source != nullptr)
+                std::memmove(dest, source, command.size);
+            continue;
+        }
+        if (rasterizer == nullptr)
+            continue;
+
+        switch (command.type)
+        {
+        case NullRasterCommandType::ClearRenderTarget:
+            if (auto target = getSurface(command.colorTarget); target.pixels != nullptr)
+                rasterizer->clearColor(target, SoftwareRasterizer::packColor(command.clearValue));
+            break;
+        case NullRasterCommandType::ClearDepthStencil:
+            if (auto target = getSurface(command.depthTarget); target.pixels != nullptr)
+                rasterizer->clearDepth(target, command.clearValue[0]);
+            break;
+        case NullRasterCommandType::Draw:
+        case NullRasterCommandType::DrawIndirect:
+        {
+            if (command.pipeline == nullptr)
+                break;
+            auto& raster = command.pipeline->getRasterState();
+            rasterizer->setTargets(raster.hasColor ? getSurface(command.colorTarget) : SoftwareRasterizer::Surface{},
+                                   raster.hasDepth ? getSurface(command.depthTarget) : SoftwareRasterizer::Surface{});
+
+            if (command.type == NullRasterCommandType::Draw)
+            {
+                SoftwareRasterizer::DrawDesc desc;
+                if (makeDrawDesc(command, command.arguments, m_config.viewProjection, desc))
+                    rasterizer->draw(desc);
+                break;
+            }
+
+            // Arguments and count are read now, GPU would read them when it executes the draws
+            uint32_t count = command.maxCount;
+            if (auto countData = getBufferData(command.buffers[1], command.offsets[1], sizeof(uint32_t)))
+            {
+                uint32_t value;
+                std::memcpy(&value, countData, sizeof(value));
+                count = std::min(count, value);
+            }
+            for (uint32_t i = 0; i < count; ++i)
+            {
+                auto data = getBufferData(command.buffers[0], command.offsets[0] + static_cast<uint64_t>(i) * command.stride,
+                                          sizeof(DrawIndexedArguments));
+                if (data == nullptr)
+                    break;
+                DrawIndexedArguments arguments;
+                std::memcpy(&arguments, data, sizeof(arguments));
+                SoftwareRasterizer::DrawDesc desc;
+                if (makeDrawDesc(command, arguments, m_config.viewProjection, desc))
+                    rasterizer->draw(desc);
+            }
+            break;
+        }
+        case NullRasterCommandType::CopyBuffer:
+            break;
+        }
+    }
+    if (rasterizer == nullptr)
+        return;
+
+    // Targets hold the image once the work of the submission completes
+    rasterizer->flush();
+    auto& rasterStats = rasterizer->getStats();
+    {
+        std::lock_guard lock(m_mutex);
+        m_stats.rasterTriangles += rasterStats.triangles;
+        m_stats.rasterPixels    += rasterStats.pixels;
+    }
+    rasterizer->resetStats();
+}
+
+NullCommandQueue::Duration NullDevice::execute(NullCommandList& list, QueueType queueType, uint64_t fenceValue,
+                                               NullCommandQueue::Duration start, std::vector<NullCommandQueue::TimestampOp>& timestamps)
+{
+    if (list.isRecording())
+    {
+        reportError("CommandQueue::executeCommandLists: command list is not closed");
+        return {};
+    }
+    if (list.m_type != queueType)
+    {
+        reportError("CommandQueue::executeCommandLists: command list is created for another queue type");
+        return {};
+    }
+    if (list.m_lastAllocator != nullptr)
+        list.m_lastAllocator->m_pendingValue = fenceValue;
+
+    Stats stats = {};
+    stats.executedLists = 1;
+    for (auto& command : list.m_commands)
+    {
+        ++stats.commands;
+        checkResident(command, queueType, fenceValue);
+        switch (command.type)
+        {
+        case NullCommandType::ResourceBarrier:
+        {
+            ++stats.barriers;
+            auto& barrier  = command.barrier;
+            auto  resource = dynamic_cast<NullResource*>(barrier.resource);
+            if (barrier.flags == BarrierFlags::EndOnly)
+            {
+                // Resource stays in transition until the end half with the same states
+                if (resource != nullptr && (!resource->m_splitting || !isSameState(resource->m_splitTarget, barrier.after)))
+                    reportError("CommandList::resourceBarrier: end of split barrier without matching begin");
+                if (resource != nullptr)
+                {
+                    resource->m_state     = barrier.after;
+                    resource->m_splitting = false;
+                }
+                break;
+            }
+
+            checkState(barrier.resource, barrier.before, "resourceBarrier");
+            if (resource == nullptr)
+                break;
+            if (barrier.flags == BarrierFlags::BeginOnly)
+            {
+                ++stats.splitBarriers;
+                resource->m_splitting   = true;
+                resource->m_splitTarget = barrier.after;
+            }
+            else
+            {
+                resource->m_state = barrier.after;
+            }
+            break;
+        }
+        case NullCommandType::AliasingBarrier:
+        {
+            // After takes the memory range over, every other resource overlapping it becomes invalid
+            ++stats.aliasBarriers;
+            auto after = dynamic_cast<NullResource*>(command.barrier.resource);
+            if (after == nullptr || after->m_heap == nullptr)
+            {
+                reportError("CommandList::aliasingBarrier: resource after is not a placed resource");
+                break;
+            }
+            for (auto resource : after->m_heap->m_placed)
+            {
+                bool overlaps = resource->m_heapOffset < after->m_heapOffset + after->m_heapSize &&
+                                after->m_heapOffset < resource->m_heapOffset + resource->m_heapSize;
+                if (overlaps)
+                    resource->m_aliasActive = false;
+            }
+            after->m_aliasActive = true;
+            break;
+        }
+        case NullCommandType::ClearRenderTarget:
+            ++stats.clears;
+            checkState(command.targets[0], ResourceState::RenderTarget, "clearRenderTarget");
+            break;
+
+        case NullCommandType::ClearDepthStencil:
+            ++stats.clears;
+            checkState(command.depthStencil, ResourceState::DepthWrite, "clearDepthStencil");
+            break;
+
+        case NullCommandType::SetRenderTargets:
+            for (uint32_t i = 0; i < command.targetCount; ++i)
+                checkState(command.targets[i], ResourceState::RenderTarget, "setRenderTargets");
+            if (command.depthStencil != nullptr)
+                checkState(command.depthStencil, ResourceState::DepthWrite, "setRenderTargets");
+            break;
+
+        case NullCommandType::CopyBufferRegion:
+        case NullCommandType::CopyBufferToTexture:
+        {
+            // Common is promoted to copy dest by the copy and decays back after it, the state stays as it is
+            ++stats.copies;
+            stats.copiedBytes += command.copySize;
+            auto name   = command.type == NullCommandType::CopyBufferRegion ? "copyBufferRegion" : "copyBufferToTexture";
+            auto dest   = dynamic_cast<NullResource*>(command.copyDest);
+            auto source = dynamic_cast<NullResource*>(command.copySource);
+            bool common = dest != nullptr && isSameState(dest->m_state, ResourceState::Common);
+            checkState(command.copyDest, common ? ResourceState::Common : ResourceState::CopyDest, name);
+            if (source != nullptr && source->m_state != ResourceState::GenericRead && !isCopyState(source->m_state))
+                reportError(std::string("CommandList::") + name + ": source is in " + toString(source->m_state) + " state, expected a copy source state");
+            break;
+        }
+
+        case NullCommandType::SetVertexBuffers:
+        case NullCommandType::SetIndexBuffer:
+            for (uint32_t i = 0; i < command.readCount; ++i)
+                checkState(command.reads[i], ResourceState::GenericRead, command.type == NullCommandType::SetIndexBuffer ? "setIndexBuffer" : "setVertexBuffers");
+            break;
+
+        case NullCommandType::DrawIndexedInstanced:
+            ++stats.draws;
+            stats.instances += command.instances;
+            break;
+
+        case NullCommandType::ExecuteIndirect:
+        {
+            // Arguments are read when GPU runs the command, only upload and readback buffers have host memory to read
+            ++stats.draws;
+            for (uint32_t i = 0; i < command.readCount; ++i)
+                checkState(command.reads[i], ResourceState::GenericRead, "executeIndirect");
+            auto arguments = static_cast<Buffer*>(command.reads[0])->getMappedData();
+            auto drawCount = command.drawCount;
+            if (command.readCount > 1 && static_cast<Buffer*>(command.reads[1])->getMappedData() != nullptr)
+            {
+                uint32_t count = 0;
+                std::memcpy(&count, static_cast<Buffer*>(command.reads[1])->getMappedData() + command.readOffsets[1], sizeof(count));
+                drawCount = std::min(drawCount, count);
+            }
+            stats.indirectDraws += drawCount;
+            for (uint32_t i = 0; arguments != nullptr && i < drawCount; ++i)
+            {
+                DrawIndexedArguments draw;
+                std::memcpy(&draw, arguments + command.readOffsets[0] + static_cast<uint64_t>(i) * command.stride, sizeof(draw));
+                stats.instances += draw.instanceCount;
+            }
+            break;
+        }
+
+        case NullCommandType::WriteTimestamp:
+        {
+            // Written once the commands before it have run
+            auto offset = start + m_config.commandCost * (stats.commands - 1);
+            timestamps.push_back({ static_cast<NullTimestampQueryHeap*>(command.queryHeap), command.queryIndex, 0, offset, nullptr });
+            break;
+        }
+
+        case NullCommandType::ResolveTimestamps:
+        {
+            // Resolve is a copy into the readback buffer
+            checkState(command.copyDest, ResourceState::CopyDest, "resolveTimestamps");
+            auto dest = static_cast<Buffer*>(command.copyDest)->getMappedData() + command.copyOffset;
+            timestamps.push_back({ static_cast<NullTimestampQueryHeap*>(command.queryHeap), command.queryIndex, command.queryCount, {}, dest });
+            break;
+        }
+
+        default:
+            break;
+        }
+    }
+
+    {
+        std::lock_guard lock(m_mutex);
+        m_stats.executedLists += stats.executedLists;
+        m_stats.commands      += stats.commands;
+        m_stats.barriers      += stats.barriers;
+        m_stats.splitBarriers += stats.splitBarriers;
+        m_stats.aliasBarriers += stats.aliasBarriers;
+        m_stats.clears        += stats.clears;
+        m_stats.copies        += stats.copies;
+        m_stats.copiedBytes   += stats.copiedBytes;
+        m_stats.draws         += stats.draws;
+        m_stats.indirectDraws += stats.indirectDraws;
+        m_stats.instances     += stats.instances;
+    }
+
+    auto cost = m_config.commandCost * stats.commands;
+    if (m_config.copyBandwidth != 0)
+        cost += std::chrono::duration_cast<NullCommandQueue::Duration>(std::chrono::duration<double>(static_cast<double>(stats.copiedBytes) / m_config.copyBandwidth));
+    return cost;
+}
+
+void NullDevice::checkResident(const NullCommand& command, QueueType queueType, uint64_t fenceValue)
+{
+    auto check = [&](Resource* resource)
+    {
+        auto nullResource = dynamic_cast<NullResource*>(resource);
+        if (nullResource == nullptr || nullResource->m_heap == nullptr)
+            return;
+        auto heap = nullResource->m_heap;
+        if (!heap->m_resident)
+            reportError("CommandQueue::executeCommandLists: command list uses a resource in an evicted heap");
+        heap->m_lastUse[static_cast<uint32_t>(queueType)] = fenceValue;
+    };
+
+    check(command.barrier.resource);
+    check(command.aliasBefore);
+    for (uint32_t i = 0; i < command.targetCount; ++i)
+        check(command.targets[i]);
+    check(command.depthStencil);
+    check(command.copyDest);
+    check(command.copySource);
+    for (uint32_t i = 0; i < command.readCount; ++i)
+        check(command.reads[i]);
+}
+
+void NullDevice::checkState(Resource* resource, ResourceState expected, const char* command)
+{
+    auto nullResource = dynamic_cast<NullResource*>(resource);
+    if (nullResource == nullptr)
+    {
+        reportError(std::string("CommandList::") + command + ": resource is not created by null device");
+        return;
+    }
+    if (!nullResource->m_aliasActive)
+    {
+        reportError(std::string("CommandList::") + command + ": placed resource is used without an aliasing barrier activating it");
+        return;
+    }
+    if (nullResource->m_splitting)
+    {
+        reportError(std::string("CommandList::") + command + ": resource is used between begin and end of a split barrier");
+        return;
+    }
+    if (!isSameState(nullResource->m_state, expected))
+    {
+        reportError(std::string("CommandList::") + command + ": resource is in " + toString(nullResource->m_state) +
+                    " state, expected " + toString(expected));
+    }
+}
@@ -0,0 +1,458 @@
+#include "PipelineCache.hpp"
+#include "Hash.hpp"
+#include "Profiler.hpp"
+
+#include <cstring>
+#include <fstream>
+#include <algorithm>
+#include <filesystem>
+
+#include <assert.h>
+
+using namespace GalgameEngine;
+
+namespace
+{
+    // Eviction goes below the budget by this fraction, so the library is not sorted again on every new blob
+    constexpr double EvictionSlack = 0.1;
+
+    // Magic, version, library id, entry count
+    constexpr size_t HeaderSize = 4 + 4 + 8 + 4;
+
+    template <typename T>
+    void write(std::vector<uint8_t>& data, const T& value)
+    {
+        auto offset = data.size();
+        data.resize(offset + sizeof(value));
+        std::memcpy(data.data() + offset, &value, sizeof(value));
+    }
+
+    // Bounds checked reads, a truncated or corrupt file must never read past the end
+    class Reader
+    {
+    public:
+        Reader(const uint8_t* data, size_t size) : m_data(data), m_size(size) {}
+
+        template <typename T>
+        bool read(T& value) noexcept
+        {
+            if (m_size - m_offset < sizeof(value))
+                return false;
+            std::memcpy(&value, m_data + m_offset, sizeof(value));
+            m_offset += sizeof(value);
+            return true;
+        }
+
+        bool read(std::vector<uint8_t>& bytes, size_t size)
+        {
+            if (m_size - m_offset < size)
+                return false;
+            bytes.assign(m_data + m_offset, m_data + m_offset + size);
+            m_offset += size;
+            return true;
+        }
+
+        bool isEnd() const noexcept { return m_offset == m_size; }
+
+    private:
+        const uint8_t* m_data;
+        size_t         m_size;
+        size_t         m_offset = 0;
+    };
+
+    void addBytes(Hasher& hasher, const std::vector<uint8_t>& bytes) noexcept
+    {
+        hasher.addValue(static_cast<uint64_t>(bytes.size()));
+        hasher.add(bytes.data(), bytes.size());
+    }
+}
+
+PipelineCache::PipelineCache(Device& device, const Config& config)
+    : m_device(device), m_config(config)
+{
+    m_threads.reserve(config.compileThreads);
+    for (uint32_t i = 0; i < config.compileThreads; ++i)
+        m_threads.emplace_back(&PipelineCache::compileThread, this);
+}
+
+PipelineCache::~PipelineCache()
+{
+    // Queued compiles are dropped, a compile already running finishes before its thread is joined
+    {
+        std::lock_guard lock(m_mutex);
+        m_quit = true;
+    }
+    m_workCond.notify_all();
+    for (auto& thread : m_threads)
+        thread.join();
+}
+
+// ---------
+//  Requests
+// ---------
+
+RootSignature& PipelineCache::getRootSignature(const RootSignatureDesc& desc)
+{
+    auto hash = hashRootSignature(desc);
+    auto it   = m_rootSignatures.find(hash);
+    if (it != m_rootSignatures.end())
+        return *it->second;
+
+    auto rootSignature = m_device.createRootSignature(desc);
+    auto& result       = *rootSignature;
+    m_rootSignatureHashes.emplace(&result, hash);
+    m_rootSignatures.emplace(hash, std::move(rootSignature));
+    return result;
+}
+
+PipelineId PipelineCache::requestPipeline(const GraphicsPipelineDesc& desc, PipelineId fallback)
+{
+    // Fallbacks point to earlier pipelines only, so a fallback chain always ends
+    assert(fallback == InvalidPipeline || fallback < m_entries.size());
+
+    auto rootSignature = m_rootSignatureHashes.find(desc.rootSignature);
+    assert(rootSignature != m_rootSignatureHashes.end() && "Root signature is not created by the pipeline cache");
+    auto hash = hashPipeline(desc, rootSignature->second);
+
+    std::unique_lock lock(m_mutex);
+    ++m_stats.requests;
+    auto it = m_entryIndices.find(hash);
+    if (it != m_entryIndices.end())
+    {
+        ++m_stats.hits;
+        return it->second;
+    }
+
+    auto  id    = static_cast<PipelineId>(m_entries.size());
+    auto& entry = m_entries.emplace_back();
+    entry.desc     = desc;
+    entry.hash     = hash;
+    entry.fallback = fallback;
+    m_entryIndices.emplace(hash, id);
+    ++m_pending;
+
+    if (m_threads.empty())
+    {
+        lock.unlock();
+        compile(entry);
+        return id;
+    }
+
+    m_queue.push_back(&entry);
+    lock.unlock();
+    m_workCond.notify_one();
+    return id;
+}
+
+PipelineState* PipelineCache::getPipeline(PipelineId id) noexcept
+{
+    bool fallback = false;
+    while (id != InvalidPipeline)
+    {
+        auto& entry = m_entries[id];
+        if (entry.status.load(std::memory_order_acquire) == Status::Ready)
+            break;
+        fallback = true;
+        id       = entry.fallback;
+    }
+
+    if (fallback)
+        m_fallbacks.fetch_add(1, std::memory_order_relaxed);
+    return id != InvalidPipeline ? m_entries[id].state.get() : nullptr;
+}
+
+bool PipelineCache::isReady(PipelineId id) const noexcept
+{
+    return id < m_entries.size() && m_entries[id].status.load(std::memory_order_acquire) == Status::Ready;
+}
+
+void PipelineCache::waitIdle()
+{
+    PROFILE_SCOPE("PipelineCache::waitIdle");
+
+    std::unique_lock lock(m_mutex);
+    m_idleCond.wait(lock, [this] { return m_pending == 0; });
+}
+
+// --------
+//  Compile
+// --------
+
+void PipelineCache::compileThread()
+{
+    while (true)
+    {
+        std::unique_lock lock(m_mutex);
+        m_workCond.wait(lock, [this] { return m_quit || !m_queue.empty(); });
+        if (m_quit)
+            return;
+
+        auto entry = m_queue.front();
+        m_queue.pop_front();
+        lock.unlock();
+
+        compile(*entry);
+    }
+}
+
+void PipelineCache::compile(Entry& entry)
+{
+    PROFILE_SCOPE("PipelineCache::compile");
+
+    // Copied, the blob may be evicted while compiling
+    std::vector<uint8_t> cachedBlob;
+    {
+        std::lock_guard lock(m_mutex);
+        auto it = m_library.find(entry.hash);
+        if (it != m_library.end())
+        {
+            cachedBlob         = it->second.blob;
+            it->second.lastUse = ++m_useCounter;
+        }
+    }
+
+    std::unique_ptr<PipelineState> state;
+    std::vector<uint8_t>           blob;
+    try
+    {
+        state = m_device.createGraphicsPipeline(entry.desc, cachedBlob.empty() ? nullptr : &cachedBlob);
+        blob  = state->getCachedBlob();
+    }
+    catch (...)
+    {
+        state.reset();
+    }
+
+    {
+        std::lock_guard lock(m_mutex);
+        ++m_stats.compiles;
+        if (!cachedBlob.empty())
+            ++m_stats.libraryHits;
+
+        if (state == nullptr)
+        {
+            ++m_stats.failures;
+            entry.status.store(Status::Failed, std::memory_order_release);
+        }
+        else
+        {
+            // Replace the blob, the driver may have recompiled a stale one
+            if (!blob.empty() && blob != cachedBlob)
+            {
+                auto& libraryEntry = m_library[entry.hash];
+                m_libraryBytes       = m_libraryBytes - libraryEntry.blob.size() + blob.size();
+                libraryEntry.blob    = std::move(blob);
+                libraryEntry.lastUse = ++m_useCounter;
+                evictLibrary();
+            }
+            entry.state = std::move(state);
+            entry.status.store(Status::Ready, std::memory_order_release);
+        }
+
+        --m_pending;
+    }
+    m_idleCond.notify_all();
+}
+
+// --------
+//  Library
+// --------
+
+bool PipelineCache::loadLibrary(const std::string& path)
+{
+    PROFILE_SCOPE("PipelineCache::loadLibrary");
+
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+        return false;
+    std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    return deserializeLibrary(data.data(), data.size());
+}
+
+bool PipelineCache::saveLibrary(const std::string& path)
+{
+    PROFILE_SCOPE("PipelineCache::saveLibrary");
+
+    std::vector<uint8_t> data;
+    serializeLibrary(data);
+
+    auto temporaryPath = path + ".tmp";
+    {
+        std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+        if (!file.write(reinterpret_cast<const char*>(data.data()), data.size()))
+            return false;
+    }
+
+    std::error_code error;
+    std::filesystem::rename(temporaryPath, path, error);
+    if (error)
+        std::filesystem::remove(temporaryPath, error);
+    return !error;
+}
+
+void PipelineCache::serializeLibrary(std::vector<uint8_t>& data)
+{
+    std::lock_guard lock(m_mutex);
+
+    data.clear();
+    data.reserve(HeaderSize + m_library.size() * 20 + m_libraryBytes + 8);
+    write(data, LibraryMagic);
+    write(data, LibraryVersion);
+    write(data, m_config.libraryId);
+    write(data, static_cast<uint32_t>(m_library.size()));
+    for (auto& [hash, entry] : m_library)
+    {
+        write(data, hash);
+        write(data, entry.lastUse);
+        write(data, static_cast<uint32_t>(entry.blob.size()));
+        data.insert(data.end(), entry.blob.begin(), entry.blob.end());
+    }
+
+    Hasher hasher;
+    hasher.add(data.data(), data.size());
+    write(data, hasher.finish());
+}
+
+bool PipelineCache::deserializeLibrary(const uint8_t* data, size_t size)
+{
+    {
+        std::lock_guard lock(m_mutex);
+        m_library.clear();
+        m_libraryBytes = 0;
+    }
+    if (size < HeaderSize + 8)
+        return false;
+
+    // Checksum first, nothing of a damaged file is trusted
+    uint64_t checksum;
+    std::memcpy(&checksum, data + size - 8, 8);
+    Hasher hasher;
+    hasher.add(data, size - 8);
+    if (hasher.finish() != checksum)
+        return false;
+
+    Reader   reader(data, size - 8);
+    uint32_t magic   = 0;
+    uint32_t version = 0;
+    uint64_t id      = 0;
+    uint32_t count   = 0;
+    if (!reader.read(magic) || !reader.read(version) || !reader.read(id) || !reader.read(count))
+        return false;
+    if (magic != LibraryMagic || version != LibraryVersion || id != m_config.libraryId)
+        return false;
+
+    std::unordered_map<uint64_t, LibraryEntry> library;
+    uint64_t bytes      = 0;
+    uint64_t useCounter = 0;
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        uint64_t     hash     = 0;
+        uint32_t     blobSize = 0;
+        LibraryEntry entry;
+        if (!reader.read(hash) || !reader.read(entry.lastUse) || !reader.read(blobSize) || !reader.read(entry.blob, blobSize))
+            return false;
+        bytes      += blobSize;
+        useCounter  = std::max(useCounter, entry.lastUse);
+        library[hash] = std::move(entry);
+    }
+    if (!reader.isEnd())
+        return false;
+
+    std::lock_guard lock(m_mutex);
+    m_library      = std::move(library);
+    m_libraryBytes = bytes;
+    m_useCounter   = std::max(m_useCounter, useCounter);
+    evictLibrary();
+    return true;
+}
+
+void PipelineCache::evictLibrary()
+{
+    if (m_libraryBytes <= m_config.maxLibraryBytes)
+        return;
+
+    std::vector<std::pair<uint64_t, uint64_t>> uses;  // Last use, hash
+    uses.reserve(m_library.size());
+    for (auto& [hash, entry] : m_library)
+        uses.emplace_back(entry.lastUse, hash);
+    std::sort(uses.begin(), uses.end());
+
+    auto target = static_cast<uint64_t>(m_config.maxLibraryBytes * (1.0 - EvictionSlack));
+    for (auto& [lastUse, hash] : uses)
+    {
+        if (m_libraryBytes <= target)
+            break;
+        auto it = m_library.find(hash);
+        m_libraryBytes -= it->second.blob.size();
+        m_library.erase(it);
+        ++m_stats.evictions;
+    }
+}
+
+PipelineCache::Stats PipelineCache::getStats() const
+{
+    std::lock_guard lock(m_mutex);
+    auto stats = m_stats;
+    stats.fallbacks      = m_fallbacks.load(std::memory_order_relaxed);
+    stats.pending        = m_pending;
+    stats.libraryEntries = static_cast<uint32_t>(m_library.size());
+    stats.libraryBytes   = m_libraryBytes;
+    return stats;
+}
+
+// -----
+//  Hash
+// -----
+
+uint64_t PipelineCache::hashRootSignature(const RootSignatureDesc& desc) noexcept
+{
+    // Field by field, the structures have padding
+    Hasher hasher;
+    hasher.addValue(static_cast<uint64_t>(desc.parameters.size()));
+    for (auto& parameter : desc.parameters)
+    {
+        hasher.addValue(parameter.type);
+        hasher.addValue(parameter.visibility);
+        hasher.addValue(parameter.rangeType);
+        hasher.addValue(parameter.shaderRegister);
+        hasher.addValue(parameter.registerSpace);
+        hasher.addValue(parameter.count);
+    }
+    hasher.addValue(desc.allowInputLayout);
+    return hasher.finish();
+}
+
+uint64_t PipelineCache::hashPipeline(const GraphicsPipelineDesc& desc, uint64_t rootSignatureHash) noexcept
+{
+    Hasher hasher;
+    hasher.addValue(rootSignatureHash);
+    addBytes(hasher, desc.vertexShader);
+    addBytes(hasher, desc.pixelShader);
+
+    hasher.addValue(static_cast<uint64_t>(desc.inputLayout.size()));
+    for (auto& element : desc.inputLayout)
+    {
+        hasher.addString(element.semantic);
+        hasher.addValue(element.semanticIndex);
+        hasher.addValue(element.format);
+        hasher.addValue(element.slot);
+        hasher.addValue(element.offset);
+        hasher.addValue(element.perInstance);
+    }
+
+    hasher.addValue(desc.topology);
+    hasher.addValue(desc.cullMode);
+    hasher.addValue(desc.wireframe);
+    hasher.addValue(desc.blendMode);
+    hasher.addValue(desc.depthTest);
+    hasher.addValue(desc.depthWrite);
+    hasher.addValue(desc.depthFunc);
+
+    // Formats past the count are unused, they must not tell equal pipelines apart
+    auto targetCount = std::min(desc.renderTargetCount, GraphicsPipelineDesc::MaxRenderTargets);
+    hasher.addValue(targetCount);
+    for (uint32_t i = 0; i < targetCount; ++i)
+        hasher.addValue(desc.renderTargetFormats[i]);
+    hasher.addValue(desc.depthStencilFormat);
+    return hasher.finish();
+}
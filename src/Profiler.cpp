@@ -0,0 +1,206 @@
+#include "Profiler.hpp"
+
+#include <mutex>
+#include <vector>
+#include <memory>
+#include <cstdio>
+#include <algorithm>
+
+using namespace GalgameEngine;
+
+namespace
+{
+    /*
+    * Single producer ring buffer owned by one thread
+    * Owner writes the event then publishes it by advancing head, dumping thread reads published events
+    * and drops the ones overwritten while it was copying
+    * Tracks are buffers without an owner thread, written under the registry mutex instead
+    */
+    struct ThreadBuffer
+    {
+        std::unique_ptr<Profiler::Event[]> events = std::make_unique<Profiler::Event[]>(Profiler::ThreadCapacity);
+        std::atomic<uint64_t>              head   = 0;   // Number of events ever written
+        std::atomic<uint64_t>              tail   = 0;   // Events before it are cleared
+        uint32_t                           depth  = 0;   // Only touched by owner thread
+        uint32_t                           id     = 0;
+        std::string                        name;         // Guarded by registry mutex
+    };
+
+    struct Registry
+    {
+        std::mutex                                 mutex;
+        std::vector<std::unique_ptr<ThreadBuffer>> buffers;  // Never freed, thread may exit before dump
+    };
+
+    Registry& registry()
+    {
+        static Registry s_registry;
+        return s_registry;
+    }
+
+    thread_local ThreadBuffer* t_buffer = nullptr;
+
+    // Called with the registry mutex held
+    ThreadBuffer& createBuffer(Registry& reg)
+    {
+        auto buffer = std::make_unique<ThreadBuffer>();
+        buffer->id = static_cast<uint32_t>(reg.buffers.size());
+        reg.buffers.push_back(std::move(buffer));
+        return *reg.buffers.back();
+    }
+
+    ThreadBuffer& threadBuffer()
+    {
+        if (t_buffer == nullptr)
+        {
+            auto& reg = registry();
+            std::lock_guard lock(reg.mutex);
+            t_buffer       = &createBuffer(reg);
+            t_buffer->name = "Thread " + std::to_string(t_buffer->id);
+        }
+        return *t_buffer;
+    }
+
+    void appendEscaped(std::string& out, const char* str)
+    {
+        for (; *str != '\0'; ++str)
+        {
+            if (*str == '"' || *str == '\\')
+                out += '\\';
+            if (static_cast<unsigned char>(*str) >= 0x20)
+                out += *str;
+        }
+    }
+}
+
+void Profiler::setThreadName(const char* name)
+{
+    auto& buffer = threadBuffer();
+    std::lock_guard lock(registry().mutex);
+    buffer.name = name;
+}
+
+uint32_t Profiler::createTrack(const char* name)
+{
+    auto& reg = registry();
+    std::lock_guard lock(reg.mutex);
+    auto& buffer = createBuffer(reg);
+    buffer.name = name;
+    return buffer.id;
+}
+
+void Profiler::addEvents(uint32_t track, const Event* events, uint32_t count)
+{
+    auto& reg = registry();
+    std::lock_guard lock(reg.mutex);
+    if (track >= reg.buffers.size())
+        return;
+
+    auto& buffer = *reg.buffers[track];
+    auto  head   = buffer.head.load(std::memory_order_relaxed);
+    for (uint32_t i = 0; i < count; ++i)
+        buffer.events[(head + i) % ThreadCapacity] = events[i];
+    buffer.head.store(head + count, std::memory_order_release);
+}
+
+uint32_t Profiler::beginScope() noexcept
+{
+    return threadBuffer().depth++;
+}
+
+void Profiler::endScope(const char* name, int64_t begin, uint32_t depth) noexcept
+{
+    int64_t end    = Timer::now();
+    auto&   buffer = *t_buffer;    // beginScope() has created it
+    auto    head   = buffer.head.load(std::memory_order_relaxed);
+
+    buffer.events[head % ThreadCapacity] = { name, begin, end, depth };
+    buffer.head.store(head + 1, std::memory_order_release);
+    buffer.depth = depth;
+}
+
+void Profiler::clear()
+{
+    auto& reg = registry();
+    std::lock_guard lock(reg.mutex);
+    for (auto& buffer : reg.buffers)
+        buffer->tail.store(buffer->head.load(std::memory_order_acquire), std::memory_order_relaxed);
+}
+
+std::string Profiler::getChromeTrace()
+{
+    struct ThreadEvents
+    {
+        uint32_t           id;
+        std::string        name;
+        std::vector<Event> events;
+    };
+    std::vector<ThreadEvents> threads;
+
+    {
+        auto& reg = registry();
+        std::lock_guard lock(reg.mutex);
+        for (auto& buffer : reg.buffers)
+        {
+            auto head  = buffer->head.load(std::memory_order_acquire);
+            auto first = std::max(buffer->tail.load(std::memory_order_relaxed),
+                                  head > ThreadCapacity ? head - ThreadCapacity : 0);
+
+            ThreadEvents thread = { buffer->id, buffer->name, {} };
+            for (auto i = first; i < head; ++i)
+                thread.events.push_back(buffer->events[i % ThreadCapacity]);
+
+            // Owner thread may have wrapped around while copying, drop overwritten events
+            auto newHead = buffer->head.load(std::memory_order_acquire);
+            if (newHead > first + ThreadCapacity)
+            {
+                auto overwritten = std::min<uint64_t>(newHead - ThreadCapacity - first, thread.events.size());
+                thread.events.erase(thread.events.begin(), thread.events.begin() + overwritten);
+            }
+            threads.push_back(std::move(thread));
+        }
+    }
+
+    // Timestamps start from the earliest event
+    int64_t base = INT64_MAX;
+    for (auto& thread : threads)
+        for (auto& event : thread.events)
+            base = std::min(base, event.begin);
+
+    const double usPerCount = Timer::getSecondsPerCount() * 1e6;
+
+    std::string json = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool first = true;
+    char number[64];
+    for (auto& thread : threads)
+    {
+        if (!first)
+            json += ',';
+        first = false;
+        json += "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" + std::to_string(thread.id) + ",\"args\":{\"name\":\"";
+        appendEscaped(json, thread.name.c_str());
+        json += "\"}}";
+
+        for (auto& event : thread.events)
+        {
+            json += ",{\"name\":\"";
+            appendEscaped(json, event.name);
+            std::snprintf(number, sizeof(number), "\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f",
+                          (event.begin - base) * usPerCount, (event.end - event.begin) * usPerCount);
+            json += number;
+            json += ",\"pid\":0,\"tid\":" + std::to_string(thread.id) + "}";
+        }
+    }
+    json += "]}";
+    return json;
+}
+
+bool Profiler::writeChromeTrace(const char* path)
+{
+    auto  json = getChromeTrace();
+    FILE* file = std::fopen(path, "wb");
+    if (file == nullptr)
+        return false;
+    bool ok = std::fwrite(json.data(), 1, json.size(), file) == json.size();
+    return std::fclose(file) == 0 && ok;
+}
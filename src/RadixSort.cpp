@@ -0,0 +1,110 @@
+#include "RadixSort.hpp"
+#include "JobSystem.hpp"
+#include "Profiler.hpp"
+
+#include <cstring>
+#include <utility>
+#include <algorithm>
+
+using namespace GalgameEngine;
+
+void RadixSorter::sort(SortItem* items, uint32_t count, JobSystem* jobSystem)
+{
+    PROFILE_SCOPE("RadixSorter::sort");
+
+    m_stats = {};
+    if (count <= m_config.insertionLimit)
+    {
+        for (uint32_t i = 1; i < count; ++i)
+        {
+            auto     item = items[i];
+            uint32_t j    = i;
+            for (; j > 0 && items[j - 1].key > item.key; --j)
+                items[j] = items[j - 1];
+            items[j] = item;
+        }
+        return;
+    }
+
+    // Bits which differ between any two keys, digits without one are the same everywhere
+    uint64_t varying = 0;
+    for (uint32_t i = 1; i < count; ++i)
+        varying |= items[i].key ^ items[0].key;
+
+    auto blockSize  = m_config.blockSize;
+    auto blockCount = (count + blockSize - 1) / blockSize;
+    if (m_scratch.size() < count)
+        m_scratch.resize(count);
+    m_offsets.resize(static_cast<size_t>(blockCount) * BucketCount);
+    m_stats.blocks = blockCount;
+
+    bool parallel  = jobSystem != nullptr && jobSystem->getThreadCount() > 1 && blockCount > 1;
+    auto forBlocks = [&](auto& function)
+    {
+        if (parallel)
+        {
+            JobCounter counter;
+            jobSystem->parallelFor(counter, blockCount, 1, function);
+            jobSystem->wait(counter);
+        }
+        else
+        {
+            function(0u, blockCount);
+        }
+    };
+
+    auto source = items;
+    auto dest   = m_scratch.data();
+    for (uint32_t shift = 0; shift < 64; shift += DigitBits)
+    {
+        if (((varying >> shift) & (BucketCount - 1)) == 0)
+        {
+            ++m_stats.skippedPasses;
+            continue;
+        }
+        ++m_stats.passes;
+
+        auto countBlocks = [&](uint32_t begin, uint32_t end)
+        {
+            for (uint32_t block = begin; block < end; ++block)
+            {
+                auto counts = m_offsets.data() + static_cast<size_t>(block) * BucketCount;
+                std::memset(counts, 0, BucketCount * sizeof(uint32_t));
+                auto last = std::min(count, (block + 1) * blockSize);
+                for (uint32_t i = block * blockSize; i < last; ++i)
+                    ++counts[(source[i].key >> shift) & (BucketCount - 1)];
+            }
+        };
+        forBlocks(countBlocks);
+
+        // Digits in order, blocks of a digit in order, so equal digits keep their order
+        uint32_t offset = 0;
+        for (uint32_t digit = 0; digit < BucketCount; ++digit)
+        {
+            for (uint32_t block = 0; block < blockCount; ++block)
+            {
+                auto& slot  = m_offsets[static_cast<size_t>(block) * BucketCount + digit];
+                auto  total = slot;
+                slot    = offset;
+                offset += total;
+            }
+        }
+
+        auto scatterBlocks = [&](uint32_t begin, uint32_t end)
+        {
+            for (uint32_t block = begin; block < end; ++block)
+            {
+                auto offsets = m_offsets.data() + static_cast<size_t>(block) * BucketCount;
+                auto last    = std::min(count, (block + 1) * blockSize);
+                for (uint32_t i = block * blockSize; i < last; ++i)
+                    dest[offsets[(source[i].key >> shift) & (BucketCount - 1)]++] = source[i];
+            }
+        };
+        forBlocks(scatterBlocks);
+
+        std::swap(source, dest);
+    }
+
+    if (source != items)
+        std::memcpy(items, source, static_cast<size_t>(count) * sizeof(SortItem));
+}
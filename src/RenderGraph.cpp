@@ -0,0 +1,397 @@
+#include "RenderGraph.hpp"
+#include "Profiler.hpp"
+
+#include <cassert>
+#include <algorithm>
+
+using namespace GalgameEngine;
+
+namespace
+{
+    // Default placement alignment, heap sizes are multiples of it
+    constexpr uint64_t HeapAlignment = 64 * 1024;
+
+    uint64_t alignUp(uint64_t value, uint64_t alignment) noexcept
+    {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    bool isSameDesc(const TextureDesc& a, const TextureDesc& b) noexcept
+    {
+        return a.width == b.width && a.height == b.height && a.format == b.format && a.usage == b.usage &&
+               std::equal(std::begin(a.clearValue.color), std::end(a.clearValue.color), std::begin(b.clearValue.color)) &&
+               a.clearValue.depth == b.clearValue.depth && a.clearValue.stencil == b.clearValue.stencil;
+    }
+
+    // State a new placed texture starts in, the tracker takes it from there
+    ResourceState getInitialState(const TextureDesc& desc) noexcept
+    {
+        if (hasFlag(desc.usage, TextureUsage::DepthStencil))
+            return ResourceState::DepthWrite;
+        if (hasFlag(desc.usage, TextureUsage::RenderTarget))
+            return ResourceState::RenderTarget;
+        return ResourceState::Common;
+    }
+}
+
+// -------------
+//  Pass builder
+// -------------
+
+RenderGraphTexture RenderGraph::PassBuilder::create(const char* name, const TextureDesc& desc)
+{
+    // Transient textures live in a render target heap
+    assert(hasFlag(desc.usage, TextureUsage::RenderTarget) || hasFlag(desc.usage, TextureUsage::DepthStencil));
+
+    auto index = static_cast<uint32_t>(m_graph.m_textures.size());
+    m_graph.m_textures.push_back({ name, desc });
+    if (m_graph.m_writers.size() <= index)
+        m_graph.m_writers.emplace_back();
+    return { index };
+}
+
+RenderGraphTexture RenderGraph::PassBuilder::read(RenderGraphTexture texture, ResourceState state)
+{
+    assert(texture.isValid() && texture.index < m_graph.m_textures.size());
+    m_graph.m_accesses.push_back({ texture.index, state, false });
+    ++m_graph.m_passes[m_pass].accessCount;
+    return texture;
+}
+
+RenderGraphTexture RenderGraph::PassBuilder::write(RenderGraphTexture texture, ResourceState state)
+{
+    assert(texture.isValid() && texture.index < m_graph.m_textures.size());
+    m_graph.m_accesses.push_back({ texture.index, state, true });
+    m_graph.m_writers[texture.index].push_back(m_pass);
+    ++m_graph.m_passes[m_pass].accessCount;
+    return texture;
+}
+
+void RenderGraph::PassBuilder::setSideEffect() noexcept
+{
+    m_graph.m_passes[m_pass].sideEffect = true;
+}
+
+// ------
+//  Graph
+// ------
+
+RenderGraph::RenderGraph(Device& device)
+    : m_device(device)
+{
+}
+
+RenderGraph::~RenderGraph() = default;
+
+RenderGraphTexture RenderGraph::importTexture(const char* name, Texture& texture)
+{
+    auto index = static_cast<uint32_t>(m_textures.size());
+    TextureNode node = { name, texture.getDesc() };
+    node.texture  = &texture;
+    node.imported = true;
+    m_textures.push_back(node);
+    if (m_writers.size() <= index)
+        m_writers.emplace_back();
+    return { index };
+}
+
+void RenderGraph::addPass(const char* name, const SetupFunction& setup, ExecuteFunction execute)
+{
+    auto index = static_cast<uint32_t>(m_passes.size());
+    m_passes.push_back({ name, std::move(execute), static_cast<uint32_t>(m_accesses.size()) });
+
+    PassBuilder builder(*this, index);
+    setup(builder);
+}
+
+void RenderGraph::compile()
+{
+    PROFILE_SCOPE("RenderGraph::compile");
+
+    cull();
+    computeLifetimes();
+    placeTransients();
+    bindTransients();
+}
+
+void RenderGraph::execute(CommandList& commandList, ResourceStateTracker& tracker)
+{
+    PROFILE_SCOPE("RenderGraph::execute");
+
+    PassContext context(*this, commandList);
+    for (uint32_t pass = 0; pass < m_passes.size(); ++pass)
+    {
+        auto& node = m_passes[pass];
+        if (node.culled)
+            continue;
+
+        auto begin = m_accesses.begin() + node.firstAccess;
+        auto end   = begin + node.accessCount;
+
+        // Transient textures take their memory over at their first pass,
+        // the state they were left in by the last frame is known since only the graph uses them
+        for (auto access = begin; access != end; ++access)
+        {
+            auto& texture = m_textures[access->texture];
+            if (texture.imported || texture.activated)
+                continue;
+
+            auto previous = texture.aliasPrevious != RenderGraphTexture::InvalidIndex ? m_textures[texture.aliasPrevious].texture : nullptr;
+            commandList.aliasingBarrier(previous, texture.texture);
+            texture.activated = true;
+            tracker.track(*texture.texture, texture.texture->getSubmittedState());
+        }
+
+        // All transitions of the pass go out as one batch
+        for (auto access = begin; access != end; ++access)
+            tracker.transition(*m_textures[access->texture].texture, access->state);
+        tracker.flush(commandList);
+
+        node.execute(context);
+    }
+}
+
+Texture& RenderGraph::getTexture(RenderGraphTexture texture) const
+{
+    assert(texture.isValid() && m_textures[texture.index].texture != nullptr);
+    return *m_textures[texture.index].texture;
+}
+
+void RenderGraph::finishFrame(uint64_t fenceValue)
+{
+    // Cached textures this frame did not use are probably gone for good, e.g. after resizing
+    for (auto it = m_cache.begin(); it != m_cache.end();)
+    {
+        if (it->used)
+        {
+            it->used = false;
+            ++it;
+            continue;
+        }
+        m_retiring.textures.push_back(std::move(it->texture));
+        it = m_cache.erase(it);
+    }
+
+    if (m_retiring.heap != nullptr || !m_retiring.textures.empty())
+    {
+        m_retiring.fenceValue = fenceValue;
+        m_retired.push_back(std::move(m_retiring));
+        m_retiring = {};
+    }
+
+    m_passes.clear();
+    m_accesses.clear();
+    for (uint32_t i = 0; i < m_textures.size(); ++i)
+        m_writers[i].clear();
+    m_textures.clear();
+
+    reclaim(m_device.getQueue().getCompletedValue());
+}
+
+void RenderGraph::reclaim(uint64_t completedValue)
+{
+    while (!m_retired.empty() && m_retired.front().fenceValue <= completedValue)
+        m_retired.pop_front();
+}
+
+void RenderGraph::cull()
+{
+    // Passes count textures they write, textures count passes reading them
+    // Imported textures are read outside of the graph
+    for (auto& texture : m_textures)
+        texture.refCount = texture.imported ? 1 : 0;
+    for (auto& pass : m_passes)
+    {
+        pass.refCount = 0;
+        pass.culled   = false;
+        for (uint32_t i = 0; i < pass.accessCount; ++i)
+        {
+            auto& access = m_accesses[pass.firstAccess + i];
+            if (access.write)
+                ++pass.refCount;
+            else
+                ++m_textures[access.texture].refCount;
+        }
+    }
+
+    // Passes writing nothing are culled right away
+    for (auto& pass : m_passes)
+    {
+        if (pass.refCount > 0 || pass.sideEffect)
+            continue;
+
+        pass.culled = true;
+        for (uint32_t i = 0; i < pass.accessCount; ++i)
+            --m_textures[m_accesses[pass.firstAccess + i].texture].refCount;
+    }
+
+    // Walk back from textures nobody reads, a pass whose writes are all unread is culled
+    // and releases the textures it reads
+    m_stack.clear();
+    for (uint32_t i = 0; i < m_textures.size(); ++i)
+    {
+        if (m_textures[i].refCount == 0)
+            m_stack.push_back(i);
+    }
+    while (!m_stack.empty())
+    {
+        auto texture = m_stack.back();
+        m_stack.pop_back();
+        for (auto writer : m_writers[texture])
+        {
+            auto& pass = m_passes[writer];
+            if (pass.culled || --pass.refCount > 0 || pass.sideEffect)
+                continue;
+
+            pass.culled = true;
+            for (uint32_t i = 0; i < pass.accessCount; ++i)
+            {
+                auto& access = m_accesses[pass.firstAccess + i];
+                if (!access.write && --m_textures[access.texture].refCount == 0)
+                    m_stack.push_back(access.texture);
+            }
+        }
+    }
+}
+
+void RenderGraph::computeLifetimes()
+{
+    m_stats.passes       = static_cast<uint32_t>(m_passes.size());
+    m_stats.culledPasses = 0;
+    for (uint32_t pass = 0; pass < m_passes.size(); ++pass)
+    {
+        auto& node = m_passes[pass];
+        if (node.culled)
+        {
+            ++m_stats.culledPasses;
+            continue;
+        }
+        for (uint32_t i = 0; i < node.accessCount; ++i)
+        {
+            auto& texture = m_textures[m_accesses[node.firstAccess + i].texture];
+            texture.firstPass = std::min(texture.firstPass, pass);
+            texture.lastPass  = pass;
+        }
+    }
+}
+
+void RenderGraph::placeTransients()
+{
+    m_transients.clear();
+    m_stats.transientBytes = 0;
+    uint64_t alignment = HeapAlignment;
+    for (uint32_t i = 0; i < m_textures.size(); ++i)
+    {
+        auto& texture = m_textures[i];
+        if (texture.imported || texture.firstPass == NoPass)
+            continue;
+
+        auto info = m_device.getTextureAllocationInfo(texture.desc);
+        texture.size = info.size;
+        alignment    = std::max(alignment, info.alignment);
+        m_transients.push_back(i);
+        m_stats.transientBytes += info.size;
+    }
+    m_stats.transientTextures = static_cast<uint32_t>(m_transients.size());
+
+    // Largest first, each goes to the lowest offset not used by a placed texture alive at the same time
+    std::sort(m_transients.begin(), m_transients.end(), [this](uint32_t a, uint32_t b)
+    {
+        auto& textureA = m_textures[a];
+        auto& textureB = m_textures[b];
+        return textureA.size != textureB.size ? textureA.size > textureB.size : textureA.firstPass < textureB.firstPass;
+    });
+
+    auto&    busy     = m_busyRanges;
+    uint64_t heapUsed = 0;
+    for (uint32_t i = 0; i < m_transients.size(); ++i)
+    {
+        auto& texture = m_textures[m_transients[i]];
+
+        busy.clear();
+        for (uint32_t j = 0; j < i; ++j)
+        {
+            auto& placed = m_textures[m_transients[j]];
+            if (placed.firstPass <= texture.lastPass && texture.firstPass <= placed.lastPass)
+                busy.push_back({ placed.offset, placed.offset + placed.size });
+        }
+        std::sort(busy.begin(), busy.end());
+
+        uint64_t offset = 0;
+        for (auto [busyBegin, busyEnd] : busy)
+        {
+            if (offset + texture.size <= busyBegin)
+                break;
+            offset = std::max(offset, alignUp(busyEnd, alignment));
+        }
+        texture.offset = offset;
+        heapUsed = std::max(heapUsed, offset + texture.size);
+    }
+    m_stats.heapUsedBytes = heapUsed;
+
+    // Aliasing barrier names the texture which used the memory last
+    for (auto index : m_transients)
+    {
+        auto& texture = m_textures[index];
+        texture.aliasPrevious = RenderGraphTexture::InvalidIndex;
+        uint32_t previousLast = 0;
+        for (auto other : m_transients)
+        {
+            auto& placed = m_textures[other];
+            bool  before = placed.lastPass < texture.firstPass;
+            bool  shares = placed.offset < texture.offset + texture.size && texture.offset < placed.offset + placed.size;
+            if (before && shares && (texture.aliasPrevious == RenderGraphTexture::InvalidIndex || placed.lastPass >= previousLast))
+            {
+                texture.aliasPrevious = other;
+                previousLast          = placed.lastPass;
+            }
+        }
+    }
+
+    // Grow the heap with headroom, so resizing the window does not create a heap every frame
+    // Textures in the old heap go away with it once GPU is done with them
+    if (heapUsed > (m_heap != nullptr ? m_heap->getDesc().size : 0))
+    {
+        if (m_heap != nullptr)
+        {
+            m_retiring.heap = std::move(m_heap);
+            for (auto& cached : m_cache)
+                m_retiring.textures.push_back(std::move(cached.texture));
+            m_cache.clear();
+        }
+
+        HeapDesc desc = {};
+        desc.size  = alignUp(heapUsed + heapUsed / 4, HeapAlignment);
+        desc.type  = HeapType::Default;
+        desc.usage = HeapUsage::RenderTargets;
+        m_heap = m_device.createHeap(desc);
+        ++m_stats.createdHeaps;
+    }
+    m_stats.heapCapacity = m_heap != nullptr ? m_heap->getDesc().size : 0;
+}
+
+void RenderGraph::bindTransients()
+{
+    for (auto index : m_transients)
+    {
+        auto& texture = m_textures[index];
+        texture.texture = acquireTexture(texture.desc, texture.offset);
+    }
+}
+
+Texture* RenderGraph::acquireTexture(const TextureDesc& desc, uint64_t offset)
+{
+    for (auto& cached : m_cache)
+    {
+        if (!cached.used && cached.offset == offset && isSameDesc(cached.desc, desc))
+        {
+            cached.used = true;
+            return cached.texture.get();
+        }
+    }
+
+    auto texture = m_device.createPlacedTexture(*m_heap, offset, desc, getInitialState(desc));
+    ++m_stats.createdTextures;
+    m_cache.push_back({ desc, offset, std::move(texture), true });
+    return m_cache.back().texture.get();
+}
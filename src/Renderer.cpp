@@ -0,0 +1,327 @@
+#include "Renderer.hpp"
+#include "Profiler.hpp"
+#include "JobSystem.hpp"
+
+using namespace GalgameEngine;
+
+Renderer::Renderer(Device& device, const Config& config)
+    : m_device(device),
+      m_queue(device.getQueue()),
+      m_resizeManager({ config.width, config.height }, config.resize),
+      m_jobSystem(config.jobSystem),
+      m_syncInterval(config.syncInterval),
+      m_frames(device.getQueue(), config.frameCount),
+      m_pipelineLibraryPath(config.pipelineLibraryPath)
+{
+    // Every recording thread gets a command allocator for each frame in flight
+    // Command lists are shared by frames, one per chunk of the frame
+    uint32_t threadCount = m_jobSystem != nullptr ? m_jobSystem->getThreadCount() : 1;
+    for (uint32_t i = 0; i < m_frames.getFrameCount(); ++i)
+    {
+        for (uint32_t thread = 0; thread < threadCount; ++thread)
+            m_frames[i].commandAllocators.push_back(m_device.createCommandAllocator());
+    }
+    for (uint32_t chunk = 0; chunk < threadCount; ++chunk)
+    {
+        m_commandLists.push_back(m_device.createCommandList());
+        m_fixupLists.push_back(m_device.createCommandList());
+        m_stateTrackers.push_back(std::make_unique<ResourceStateTracker>());
+    }
+    m_profilerList = m_device.createCommandList();
+
+    // Dynamic upload memory, shared by frames in flight and reclaimed through the frame fence
+    m_uploadRing       = std::make_unique<UploadRing>(m_device, config.uploadSize);
+    m_instanceUploader = std::make_unique<InstanceUploader>(m_device, *m_uploadRing);
+
+    // Pipelines compiled in earlier runs start from their driver blobs
+    m_pipelineCache = std::make_unique<PipelineCache>(m_device, config.pipelineCache);
+    if (!m_pipelineLibraryPath.empty())
+        m_pipelineCache->loadLibrary(m_pipelineLibraryPath);
+
+    // Every recording thread submits draws into a lane of its own
+    auto drawQueueConfig = config.drawQueue;
+    drawQueueConfig.laneCount = threadCount;
+    m_drawQueue          = std::make_unique<DrawQueue>(m_device, *m_uploadRing, *m_pipelineCache, drawQueueConfig);
+    m_sceneRootSignature = &m_pipelineCache->getRootSignature(DrawQueue::getRootSignatureDesc());
+    m_drawStats.resize(threadCount);
+
+    m_residency     = std::make_unique<ResidencyManager>(m_device, config.residency);
+    m_assetStreamer = std::make_unique<AssetStreamer>(m_device, config.streaming, m_residency.get());
+
+    // Results are read back when the frame slot comes around again, its fence has passed by then
+    auto gpuProfilerConfig = config.gpuProfiler;
+    gpuProfilerConfig.frameCount = m_frames.getFrameCount();
+    m_gpuProfiler = std::make_unique<GpuProfiler>(m_device, m_queue, gpuProfilerConfig);
+
+    // Create swap chain
+    // Creating swap chain also creates back buffer resource, so there's not need to create back buffer resource manually.
+    // Back buffers have the bucketed capacity, only the window sized region is presented
+    auto size     = m_resizeManager.getSize();
+    auto capacity = m_resizeManager.getCapacity();
+    SwapChainDesc swapChainDesc = {};
+    swapChainDesc.window          = config.window;
+    swapChainDesc.width           = capacity.width;
+    swapChainDesc.height          = capacity.height;
+    swapChainDesc.format          = m_backBufferFormat;
+    swapChainDesc.bufferCount     = 2;
+    swapChainDesc.maxFrameLatency = config.maxFrameLatency;
+    m_swapChain = m_device.createSwapChain(swapChainDesc);
+    m_swapChain->setSourceSize(size.width, size.height);
+
+    m_renderGraph = std::make_unique<RenderGraph>(m_device);
+    updateViewport();
+}
+
+Renderer::~Renderer()
+{
+    // GPU may still use resources of frames in flight
+    m_frames.waitIdle();
+
+    if (!m_pipelineLibraryPath.empty())
+        m_pipelineCache->saveLibrary(m_pipelineLibraryPath);
+}
+
+void Renderer::render()
+{
+    PROFILE_SCOPE("Renderer::render");
+
+    applyResize();
+
+    // Wait the frame which used this slot before, then reset command list and allocator
+    // Other frames in flight keep running on GPU
+    FrameResource* frame;
+    {
+        PROFILE_SCOPE("Renderer::waitFrame");
+        frame = &m_frames.beginFrame();
+    }
+    m_timelineSync.dispatch();
+    m_gpuProfiler->beginFrame();
+
+    // Streamed resources finished on the copy queue are handed to the direct queue before this frame's lists
+    m_assetStreamer->update();
+    for (auto& allocator : frame->commandAllocators)
+        allocator->reset();
+
+    auto& backBuffer = m_swapChain->getBackBuffer(m_swapChain->getCurrentBackBufferIndex());
+    buildRenderGraph(backBuffer);
+
+    // Draws are sorted before the chunks split them, and the instance buffer they read may not change while they record
+    m_drawQueue->prepare(m_jobSystem);
+    if (m_scene != nullptr)
+        m_instanceUploader->reserve(*m_scene);
+
+    // Record chunks in parallel, every list is closed when its job finishes
+    auto  chunkCount = static_cast<uint32_t>(m_commandLists.size());
+    if (m_jobSystem != nullptr && chunkCount > 1)
+    {
+        JobCounter counter;
+        for (uint32_t chunk = 0; chunk < chunkCount; ++chunk)
+            m_jobSystem->schedule(counter, [this, chunk, frame, &backBuffer]() { recordChunk(chunk, *frame, backBuffer); });
+        m_jobSystem->wait(counter);
+    }
+    else
+    {
+        for (uint32_t chunk = 0; chunk < chunkCount; ++chunk)
+            recordChunk(chunk, *frame, backBuffer);
+    }
+
+    // Submit all lists as one ordered batch
+    // State before the first use in a chunk is known now, barriers for it go to a small list right before the chunk
+    PROFILE_SCOPE("Renderer::submit");
+    m_submitLists.clear();
+    for (uint32_t chunk = 0; chunk < chunkCount; ++chunk)
+    {
+        m_fixupBarriers.clear();
+        m_stateTrackers[chunk]->resolve(m_fixupBarriers);
+        if (!m_fixupBarriers.empty())
+        {
+            auto& fixupList = *m_fixupLists[chunk];
+            fixupList.reset(*frame->commandAllocators[0]);
+            fixupList.resourceBarrier(m_fixupBarriers.data(), static_cast<uint32_t>(m_fixupBarriers.size()));
+            fixupList.close();
+            m_submitLists.push_back(&fixupList);
+        }
+        m_submitLists.push_back(m_commandLists[chunk].get());
+    }
+    m_profilerList->reset(*frame->commandAllocators[0]);
+    m_gpuProfiler->endFrame(*m_profilerList);
+    m_profilerList->close();
+    m_submitLists.push_back(m_profilerList.get());
+
+    // Heaps the frame uses are made resident and the least recently used ones evicted when over budget
+    if (auto instances = m_instanceUploader->getBuffer())
+        m_residency->use(*instances);
+    m_residency->update();
+    m_queue.executeCommandLists(m_submitLists.data(), static_cast<uint32_t>(m_submitLists.size()));
+
+    // Swap buffer
+    m_swapChain->present(m_syncInterval);
+
+    // Fence the frame slot, no waiting here
+    // Upload memory and descriptors freed in the frame come back when GPU passes the same fence
+    auto fenceValue = m_frames.endFrame();
+    m_uploadRing->finishFrame(fenceValue);
+    m_instanceUploader->finishFrame(fenceValue);
+    m_renderGraph->finishFrame(fenceValue);
+    m_device.finishFrame(fenceValue);
+    m_residency->finishFrame(fenceValue);
+    m_gpuProfiler->finishFrame(fenceValue);
+}
+
+void Renderer::buildRenderGraph(Texture& backBuffer)
+{
+    PROFILE_SCOPE("Renderer::buildRenderGraph");
+
+    m_backBufferTexture = m_renderGraph->importTexture("BackBuffer", backBuffer);
+
+    // Depth buffer has the capacity of the back buffers, resizing within it reuses the cached texture
+    auto capacity = m_resizeManager.getCapacity();
+    TextureDesc depthDesc = {};
+    depthDesc.width            = capacity.width;
+    depthDesc.height           = capacity.height;
+    depthDesc.format           = m_depthBufferFormat;
+    depthDesc.usage            = TextureUsage::DepthStencil;
+    depthDesc.clearValue.depth = 1.f;
+
+    // Scene pass only clears the targets, draws are recorded by the chunks after the graph
+    m_renderGraph->addPass("Scene",
+        [this, &depthDesc](RenderGraph::PassBuilder& builder)
+        {
+            m_depthTexture = builder.create("Depth", depthDesc);
+            builder.write(m_backBufferTexture, ResourceState::RenderTarget);
+            builder.write(m_depthTexture, ResourceState::DepthWrite);
+        },
+        [this](RenderGraph::PassContext& context)
+        {
+            static constexpr float color[] = { 40.f / 255, 44.f / 255, 52.f / 255, 1.f };
+            context.getCommandList().clearRenderTarget(context.getTexture(m_backBufferTexture), color);
+            context.getCommandList().clearDepthStencil(context.getTexture(m_depthTexture), 1.f, 0);
+        });
+
+    m_renderGraph->compile();
+}
+
+void Renderer::recordChunk(uint32_t chunk, FrameResource& frame, Texture& backBuffer)
+{
+    PROFILE_SCOPE("Renderer::recordChunk");
+
+    // Allocator of the recording thread, no other thread records with it at the same time
+    uint32_t thread      = m_jobSystem != nullptr ? m_jobSystem->getThreadIndex() : 0;
+    auto&    commandList = *m_commandLists[chunk];
+    auto&    tracker     = *m_stateTrackers[chunk];
+    commandList.reset(*frame.commandAllocators[thread]);
+    auto marker = m_gpuProfiler->beginMarker(commandList, "Renderer::chunk");
+
+    // First chunk runs first in the frame, it can take states left by the previous frame directly
+    // It also uploads changed instances and records the graph passes, which activate the transient textures later chunks draw to
+    tracker.reset(chunk == 0);
+    if (chunk == 0)
+    {
+        if (m_scene != nullptr)
+            m_instanceUploader->record(*m_scene, commandList, tracker);
+
+        auto graphMarker = m_gpuProfiler->beginMarker(commandList, "RenderGraph::execute");
+        m_renderGraph->execute(commandList, tracker);
+        m_gpuProfiler->endMarker(commandList, graphMarker);
+    }
+
+    auto& depthBuffer = m_renderGraph->getTexture(m_depthTexture);
+    tracker.transition(backBuffer, ResourceState::RenderTarget);
+    tracker.transition(depthBuffer, ResourceState::DepthWrite);
+    tracker.flush(commandList);
+
+    // Every list starts with empty state
+    // Viewport, scissor rectangle and render targets need to be set again for each list
+    commandList.setViewport(m_viewport);
+    commandList.setScissorRect(m_scissorRect);
+    Texture* renderTarget = &backBuffer;
+    commandList.setRenderTargets(&renderTarget, 1, &depthBuffer);
+
+    // Every chunk records an even share of the scene batches, instance matrices are uploaded by chunk 0 which runs first
+    m_drawStats[chunk] = {};
+    if (auto instances = m_instanceUploader->getBuffer(); instances != nullptr && m_scene != nullptr)
+    {
+        uint32_t begin = 0;
+        uint32_t end   = 0;
+        m_drawQueue->getPassBatches(ScenePass, begin, end);
+        auto chunkCount = static_cast<uint32_t>(m_commandLists.size());
+        auto batchCount = static_cast<uint64_t>(end - begin);
+        auto chunkBegin = begin + static_cast<uint32_t>(batchCount * chunk / chunkCount);
+        auto chunkEnd   = begin + static_cast<uint32_t>(batchCount * (chunk + 1) / chunkCount);
+        m_drawStats[chunk] = m_drawQueue->record(commandList, *m_sceneRootSignature, instances->getGpuAddress(), chunkBegin, chunkEnd);
+    }
+
+    // Last chunk returns back buffer for presenting
+    if (chunk + 1 == m_commandLists.size())
+        tracker.transition(backBuffer, ResourceState::Present);
+
+    tracker.finish(commandList);
+    m_gpuProfiler->endMarker(commandList, marker);
+    commandList.close();
+}
+
+DrawQueue::RecordStats Renderer::getDrawStats() const noexcept
+{
+    DrawQueue::RecordStats stats;
+    for (auto& chunkStats : m_drawStats)
+        stats += chunkStats;
+    return stats;
+}
+
+ResourceStateTracker::Stats Renderer::getBarrierStats() const noexcept
+{
+    ResourceStateTracker::Stats stats;
+    for (auto& tracker : m_stateTrackers)
+    {
+        auto& chunkStats = tracker->getStats();
+        stats.requested += chunkStats.requested;
+        stats.emitted   += chunkStats.emitted;
+        stats.redundant += chunkStats.redundant;
+        stats.merged    += chunkStats.merged;
+        stats.split     += chunkStats.split;
+        stats.fixups    += chunkStats.fixups;
+    }
+    return stats;
+}
+
+void Renderer::resize(uint32_t width, uint32_t height)
+{
+    m_resizeManager.request(width, height);
+}
+
+void Renderer::applyResize()
+{
+    auto action = m_resizeManager.update();
+    if (action == ResizeManager::Action::None)
+        return;
+
+    PROFILE_SCOPE("Renderer::applyResize");
+
+    auto size = m_resizeManager.getSize();
+    if (action == ResizeManager::Action::Reallocate)
+    {
+        // Swap chain can only resize when GPU no longer uses any back buffer
+        // Depth and other size targets are not waited for, the render graph retires them through the frame fence
+        PROFILE_SCOPE("Renderer::reallocateBackBuffers");
+        auto capacity = m_resizeManager.getCapacity();
+        m_frames.waitIdle();
+        m_swapChain->resize(capacity.width, capacity.height);
+    }
+    m_swapChain->setSourceSize(size.width, size.height);
+    updateViewport();
+}
+
+void Renderer::flush()
+{
+    PROFILE_SCOPE("Renderer::flush");
+    m_queue.flush();
+}
+
+void Renderer::updateViewport()
+{
+    // Draw only to the presented region of the back buffers
+    auto size = m_resizeManager.getSize();
+    m_viewport.width  = static_cast<float>(size.width);
+    m_viewport.height = static_cast<float>(size.height);
+    m_scissorRect = { 0, 0, static_cast<int32_t>(size.width), static_cast<int32_t>(size.height) };
+}
@@ -0,0 +1,216 @@
+#include "ResidencyManager.hpp"
+#include "Profiler.hpp"
+
+using namespace GalgameEngine;
+
+ResidencyManager::ResidencyManager(Device& device, const Config& config)
+    : m_device(device),
+      m_config(config)
+{
+    m_device.getMemoryAllocator().setObserver(this);
+}
+
+ResidencyManager::~ResidencyManager()
+{
+    // No heap comes or goes after this, the rest can be done without the allocator lock
+    m_device.getMemoryAllocator().setObserver(nullptr);
+
+    std::vector<Heap*> evicted;
+    for (auto& entry : m_lru)
+    {
+        if (!entry.resident)
+            evicted.push_back(entry.heap);
+    }
+    if (!evicted.empty())
+        m_device.makeResident(evicted.data(), static_cast<uint32_t>(evicted.size()));
+}
+
+void ResidencyManager::use(const Resource& resource)
+{
+    std::lock_guard lock(m_mutex);
+
+    auto it = find(resource);
+    if (it == m_lru.end() || it->usedFrame == m_frame)
+        return;
+    it->usedFrame = m_frame;
+    m_lru.splice(m_lru.begin(), m_lru, it);
+}
+
+void ResidencyManager::pin(const Resource& resource)
+{
+    std::lock_guard lock(m_mutex);
+
+    auto it = find(resource);
+    if (it == m_lru.end())
+        return;
+    ++it->pins;
+    if (!it->resident)
+        restore(*it);
+}
+
+void ResidencyManager::unpin(const Resource& resource)
+{
+    std::lock_guard lock(m_mutex);
+
+    auto it = find(resource);
+    if (it != m_lru.end() && it->pins > 0)
+        --it->pins;
+}
+
+void ResidencyManager::update()
+{
+    PROFILE_SCOPE("ResidencyManager::update");
+    std::lock_guard lock(m_mutex);
+
+    // Heaps used this frame are at the front
+    m_batch.clear();
+    uint64_t restoreBytes = 0;
+    for (auto& entry : m_lru)
+    {
+        if (entry.usedFrame != m_frame)
+            break;
+        if (!entry.resident)
+        {
+            m_batch.push_back(entry.heap);
+            restoreBytes += entry.size;
+        }
+    }
+    auto restoreCount = m_batch.size();
+
+    auto budget = m_device.queryMemoryBudget();
+    auto target = static_cast<uint64_t>(static_cast<double>(budget.budget) * m_config.targetFraction);
+    auto usage  = budget.usage;
+    if (usage + restoreBytes > target)
+    {
+        // Oldest first, heaps GPU may still use and pinned ones are skipped
+        auto completedValue = m_device.getQueue().getCompletedValue();
+        for (auto it = m_lru.rbegin(); it != m_lru.rend() && usage + restoreBytes > target; ++it)
+        {
+            auto& entry = *it;
+            if (entry.usedFrame == m_frame)
+                break;
+            if (!entry.resident || entry.pins > 0 || entry.lastUse > completedValue)
+                continue;
+
+            entry.resident = false;
+            usage -= entry.size < usage ? entry.size : usage;
+            m_batch.push_back(entry.heap);
+            m_stats.residentBytes -= entry.size;
+            m_stats.evictedBytes  += entry.size;
+            ++m_stats.evictedHeaps;
+        }
+
+        // Evict before restoring, so the restored heaps have room
+        auto evictCount = static_cast<uint32_t>(m_batch.size() - restoreCount);
+        if (evictCount > 0)
+        {
+            m_device.evict(m_batch.data() + restoreCount, evictCount);
+            m_stats.evictions += evictCount;
+            ++m_stats.evictBatches;
+        }
+    }
+
+    if (restoreCount > 0)
+    {
+        for (auto& entry : m_lru)
+        {
+            if (entry.usedFrame != m_frame)
+                break;
+            if (!entry.resident)
+            {
+                entry.resident = true;
+                m_stats.residentBytes += entry.size;
+                m_stats.evictedBytes  -= entry.size;
+                --m_stats.evictedHeaps;
+            }
+        }
+        m_device.makeResident(m_batch.data(), static_cast<uint32_t>(restoreCount));
+        m_stats.restores += restoreCount;
+        ++m_stats.restoreBatches;
+        usage += restoreBytes;
+    }
+
+    if (usage > budget.budget)
+        ++m_stats.overBudgetFrames;
+    m_stats.budget = budget.budget;
+    m_stats.usage  = usage;
+}
+
+void ResidencyManager::finishFrame(uint64_t fenceValue)
+{
+    std::lock_guard lock(m_mutex);
+
+    for (auto& entry : m_lru)
+    {
+        if (entry.usedFrame != m_frame)
+            break;
+        entry.lastUse = fenceValue;
+    }
+    ++m_frame;
+}
+
+ResidencyManager::Stats ResidencyManager::getStats() const
+{
+    std::lock_guard lock(m_mutex);
+    return m_stats;
+}
+
+void ResidencyManager::onHeapCreated(Heap& heap)
+{
+    if (heap.getDesc().type != HeapType::Default)
+        return;
+
+    // Count a new heap as used by the current frame, its first resources are most likely used right away
+    std::lock_guard lock(m_mutex);
+    Entry entry;
+    entry.heap      = &heap;
+    entry.size      = heap.getDesc().size;
+    entry.usedFrame = m_frame;
+    m_lru.push_front(entry);
+    m_entries.emplace(&heap, m_lru.begin());
+    ++m_stats.heaps;
+    m_stats.residentBytes += entry.size;
+}
+
+void ResidencyManager::onHeapDestroyed(Heap& heap)
+{
+    std::lock_guard lock(m_mutex);
+
+    auto it = m_entries.find(&heap);
+    if (it == m_entries.end())
+        return;
+
+    auto& entry = *it->second;
+    --m_stats.heaps;
+    if (entry.resident)
+    {
+        m_stats.residentBytes -= entry.size;
+    }
+    else
+    {
+        m_stats.evictedBytes -= entry.size;
+        --m_stats.evictedHeaps;
+    }
+    m_lru.erase(it->second);
+    m_entries.erase(it);
+}
+
+ResidencyManager::Lru::iterator ResidencyManager::find(const Resource& resource)
+{
+    auto heap = resource.getHeap();
+    if (heap == nullptr)
+        return m_lru.end();
+    auto it = m_entries.find(heap);
+    return it != m_entries.end() ? it->second : m_lru.end();
+}
+
+void ResidencyManager::restore(Entry& entry)
+{
+    m_device.makeResident(&entry.heap, 1);
+    entry.resident = true;
+    m_stats.residentBytes += entry.size;
+    m_stats.evictedBytes  -= entry.size;
+    --m_stats.evictedHeaps;
+    ++m_stats.restores;
+    ++m_stats.restoreBatches;
+}
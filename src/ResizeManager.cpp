@@ -0,0 +1,81 @@
+#include "ResizeManager.hpp"
+
+#include <algorithm>
+
+#include <assert.h>
+
+using namespace GalgameEngine;
+
+ResizeManager::ResizeManager(Extent size, const Config& config)
+    : m_config(config),
+      m_size(size),
+      m_capacity(getCapacityFor(size))
+{
+    assert(config.granularity != 0 && config.maxExtent >= config.granularity);
+}
+
+void ResizeManager::request(uint32_t width, uint32_t height) noexcept
+{
+    ++m_stats.requests;
+    if (width == 0 || height == 0)
+        return;
+
+    m_pending    = { width, height };
+    m_hasPending = true;
+}
+
+ResizeManager::Action ResizeManager::update() noexcept
+{
+    auto action = Action::None;
+    if (m_hasPending)
+    {
+        m_hasPending = false;
+        ++m_stats.updates;
+        if (m_pending != m_size)
+        {
+            m_size = m_pending;
+            action = Action::Viewport;
+
+            // Grow each dimension which no longer fits, keep the other one
+            if (m_size.width > m_capacity.width || m_size.height > m_capacity.height)
+            {
+                auto grown = getCapacityFor(m_size);
+                m_capacity.width  = std::max(m_capacity.width, grown.width);
+                m_capacity.height = std::max(m_capacity.height, grown.height);
+                m_smallFrames     = 0;
+                ++m_stats.reallocations;
+                return Action::Reallocate;
+            }
+        }
+    }
+
+    // Give memory back once the window has stayed small for a while
+    auto fitted = getCapacityFor(m_size);
+    if (static_cast<uint64_t>(fitted.width) * fitted.height * 2 <= static_cast<uint64_t>(m_capacity.width) * m_capacity.height)
+    {
+        if (++m_smallFrames >= m_config.shrinkDelay)
+        {
+            m_capacity    = fitted;
+            m_smallFrames = 0;
+            ++m_stats.reallocations;
+            ++m_stats.shrinks;
+            return Action::Reallocate;
+        }
+    }
+    else
+    {
+        m_smallFrames = 0;
+    }
+    return action;
+}
+
+ResizeManager::Extent ResizeManager::getCapacityFor(Extent size) const noexcept
+{
+    auto fit = [this](uint32_t extent)
+    {
+        uint64_t withHeadroom = extent + static_cast<uint64_t>(extent) * m_config.headroomPercent / 100;
+        uint64_t aligned      = (withHeadroom + m_config.granularity - 1) / m_config.granularity * m_config.granularity;
+        return static_cast<uint32_t>(std::max<uint64_t>(std::min<uint64_t>(aligned, m_config.maxExtent), extent));
+    };
+    return { fit(size.width), fit(size.height) };
+}
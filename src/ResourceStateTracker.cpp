@@ -0,0 +1,195 @@
+#include "ResourceStateTracker.hpp"
+
+#include <cassert>
+#include <algorithm>
+
+using namespace GalgameEngine;
+
+namespace
+{
+    // Present and common are the same state
+    bool isSameState(ResourceState a, ResourceState b) noexcept
+    {
+        auto normalize = [](ResourceState s) { return s == ResourceState::Present ? ResourceState::Common : s; };
+        return normalize(a) == normalize(b);
+    }
+}
+
+void ResourceStateTracker::reset(bool assumeSubmittedStates)
+{
+    m_assumeSubmittedStates = assumeSubmittedStates;
+    m_entries.clear();
+    m_resources.clear();
+    m_batch.clear();
+    ++m_batchId;
+}
+
+void ResourceStateTracker::transition(Resource& resource, ResourceState state)
+{
+    ++m_stats.requested;
+
+    auto [entry, known] = use(resource, state);
+    if (!known)
+        return;
+
+    // Transition ends an open split barrier, which may already reach the requested state
+    if (entry->splitting)
+    {
+        endSplit(resource, *entry);
+        if (isSameState(entry->current, state))
+            return;
+    }
+    if (isSameState(entry->current, state))
+    {
+        ++m_stats.redundant;
+        return;
+    }
+    addBarrier(resource, *entry, state, BarrierFlags::None);
+}
+
+void ResourceStateTracker::beginTransition(Resource& resource, ResourceState state)
+{
+    ++m_stats.requested;
+
+    // Split barrier needs the state before, unknown first use is resolved at submit like a transition
+    auto [entry, known] = use(resource, state);
+    if (!known)
+        return;
+
+    if (entry->splitting)
+        endSplit(resource, *entry);
+    if (isSameState(entry->current, state))
+    {
+        ++m_stats.redundant;
+        return;
+    }
+
+    addBarrier(resource, *entry, state, BarrierFlags::BeginOnly);
+    entry->splitting   = true;
+    entry->splitTarget = state;
+    ++m_stats.split;
+}
+
+void ResourceStateTracker::track(Resource& resource, ResourceState state)
+{
+    auto [it, inserted] = m_entries.try_emplace(&resource);
+    if (!inserted)
+        return;
+
+    m_resources.push_back(&resource);
+    it->second.first   = state;
+    it->second.current = state;
+}
+
+void ResourceStateTracker::flush(CommandList& commandList)
+{
+    // Barriers cancelled by merging are left as holes
+    m_batch.erase(std::remove_if(m_batch.begin(), m_batch.end(), [](const ResourceBarrier& barrier) { return barrier.resource == nullptr; }),
+                  m_batch.end());
+    if (!m_batch.empty())
+    {
+        commandList.resourceBarrier(m_batch.data(), static_cast<uint32_t>(m_batch.size()));
+        m_stats.emitted += m_batch.size();
+    }
+
+    // Commands recorded after this point separate later barriers from the flushed ones
+    m_batch.clear();
+    ++m_batchId;
+}
+
+void ResourceStateTracker::finish(CommandList& commandList)
+{
+    // Both halves of a split barrier must be in the same list
+    for (auto resource : m_resources)
+    {
+        auto& entry = m_entries[resource];
+        if (entry.splitting)
+            endSplit(*resource, entry);
+    }
+    flush(commandList);
+}
+
+void ResourceStateTracker::resolve(std::vector<ResourceBarrier>& barriers)
+{
+    assert(m_batch.empty() && "Call finish() before closing the list");
+
+    for (auto resource : m_resources)
+    {
+        auto& entry = m_entries[resource];
+        assert(!entry.splitting);
+        if (!isSameState(resource->m_submittedState, entry.first))
+        {
+            barriers.push_back({ resource, resource->m_submittedState, entry.first });
+            ++m_stats.fixups;
+            ++m_stats.emitted;
+        }
+        resource->m_submittedState = entry.current;
+    }
+}
+
+std::pair<ResourceStateTracker::Entry*, bool> ResourceStateTracker::use(Resource& resource, ResourceState state)
+{
+    auto [it, inserted] = m_entries.try_emplace(&resource);
+    auto& entry = it->second;
+    if (!inserted)
+        return { &entry, true };
+
+    m_resources.push_back(&resource);
+    if (m_assumeSubmittedStates)
+    {
+        entry.first   = resource.m_submittedState;
+        entry.current = resource.m_submittedState;
+        return { &entry, true };
+    }
+
+    // First use only tells the state the list needs, resolve() brings the resource there
+    entry.first   = state;
+    entry.current = state;
+    return { &entry, false };
+}
+
+void ResourceStateTracker::addBarrier(Resource& resource, Entry& entry, ResourceState after, BarrierFlags flags)
+{
+    // Fold into the barrier of the same resource in this batch, nothing between them needs the middle state
+    if (flags == BarrierFlags::None && entry.batch == m_batchId)
+    {
+        auto& barrier = m_batch[entry.batchIndex];
+        if (barrier.flags == BarrierFlags::None)
+        {
+            ++m_stats.merged;
+            entry.current = after;
+            if (isSameState(barrier.before, after))
+            {
+                // Round trip, drop both
+                barrier.resource = nullptr;
+                entry.batch      = 0;
+            }
+            else
+            {
+                barrier.after = after;
+            }
+            return;
+        }
+    }
+
+    entry.batch      = m_batchId;
+    entry.batchIndex = static_cast<uint32_t>(m_batch.size());
+    m_batch.push_back({ &resource, entry.current, after, flags });
+    if (flags != BarrierFlags::BeginOnly)
+        entry.current = after;
+}
+
+void ResourceStateTracker::endSplit(Resource& resource, Entry& entry)
+{
+    entry.splitting = false;
+
+    // Nothing was recorded since the begin half, a plain barrier does the same with one call
+    if (entry.batch == m_batchId && m_batch[entry.batchIndex].flags == BarrierFlags::BeginOnly)
+    {
+        m_batch[entry.batchIndex].flags = BarrierFlags::None;
+        entry.current = entry.splitTarget;
+        --m_stats.split;
+        return;
+    }
+    addBarrier(resource, entry, entry.splitTarget, BarrierFlags::EndOnly);
+}
@@ -0,0 +1,79 @@
+#include "RingAllocator.hpp"
+
+#include <algorithm>
+
+#include <assert.h>
+
+using namespace GalgameEngine;
+
+namespace
+{
+    constexpr uint64_t alignUp(uint64_t value, uint64_t alignment) noexcept
+    {
+        return (value + alignment - 1) & ~(alignment - 1);
+    }
+}
+
+uint64_t RingAllocator::allocate(uint64_t size, uint64_t alignment) noexcept
+{
+    assert(alignment != 0 && (alignment & (alignment - 1)) == 0);
+
+    // Everything is free, start from the beginning for the best packing
+    if (getUsed() == 0)
+        m_head = m_tail = 0;
+
+    uint64_t offset  = alignUp(m_head, alignment);
+    uint64_t padding = offset - m_head;
+    uint64_t wrap    = 0;
+
+    if (getUsed() != 0 && m_head <= m_tail)
+    {
+        // Free space is [head, tail)
+        if (offset + size > m_tail)
+            offset = InvalidOffset;
+    }
+    else if (offset + size > m_capacity)
+    {
+        // Free space is [head, capacity) and [0, tail), the end is too small so wrap around
+        wrap    = m_capacity - m_head;
+        padding = 0;
+        offset  = 0;
+        if (size > m_tail)
+            offset = InvalidOffset;
+    }
+
+    if (offset == InvalidOffset)
+    {
+        ++m_stats.failures;
+        return InvalidOffset;
+    }
+
+    m_head            = offset + size;
+    m_allocatedTotal += wrap + padding + size;
+
+    ++m_stats.allocations;
+    m_stats.allocated    += size;
+    m_stats.paddingWaste += padding;
+    m_stats.wrapWaste    += wrap;
+    m_stats.peakUsed      = std::max(m_stats.peakUsed, getUsed());
+    return offset;
+}
+
+void RingAllocator::finishFrame(uint64_t fenceValue)
+{
+    // Frame without allocations needs no tracking
+    uint64_t finishedTotal = m_frames.empty() ? m_freedTotal : m_frames.back().allocatedTotal;
+    if (m_allocatedTotal == finishedTotal)
+        return;
+    m_frames.push_back({ fenceValue, m_head, m_allocatedTotal });
+}
+
+void RingAllocator::reclaim(uint64_t completedValue) noexcept
+{
+    while (!m_frames.empty() && m_frames.front().fenceValue <= completedValue)
+    {
+        m_tail       = m_frames.front().head;
+        m_freedTotal = m_frames.front().allocatedTotal;
+        m_frames.pop_front();
+    }
+}
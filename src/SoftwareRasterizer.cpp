@@ -0,0 +1,565 @@
+#include "SoftwareRasterizer.hpp"
+#include "Profiler.hpp"
+#include "JobSystem.hpp"
+
+#include <bit>
+#include <cmath>
+#include <cassert>
+#include <cstring>
+#include <algorithm>
+
+using namespace GalgameEngine;
+using Simd::FloatN;
+
+namespace
+{
+    // Surface pitches and tile sizes are multiples of it, a vector of any backend never crosses into another tile
+    constexpr uint32_t PixelAlignment = 16;
+
+    // Lane l is x + l
+    FloatN laneOffsets() noexcept
+    {
+        alignas(32) static constexpr float offsets[8] = { 0.f, 1.f, 2.f, 3.f, 4.f, 5.f, 6.f, 7.f };
+        return FloatN::load(offsets);
+    }
+
+    // All bits of every lane when set
+    FloatN laneMask(bool set) noexcept
+    {
+        auto zero = FloatN::zero();
+        return set ? Simd::equal(zero, zero) : zero;
+    }
+
+    FloatN compareDepth(CompareFunc func, FloatN z, FloatN depth) noexcept
+    {
+        switch (func)
+        {
+        case CompareFunc::Never:        return FloatN::zero();
+        case CompareFunc::Less:         return Simd::lessThan(z, depth);
+        case CompareFunc::LessEqual:    return Simd::lessEqual(z, depth);
+        case CompareFunc::Equal:        return Simd::equal(z, depth);
+        case CompareFunc::GreaterEqual: return Simd::greaterEqual(z, depth);
+        case CompareFunc::Greater:      return Simd::greaterThan(z, depth);
+        case CompareFunc::Always:       break;
+        }
+        return laneMask(true);
+    }
+
+    // Ranges of grain items as jobs, inline without a job system or with a single range
+    template <typename Function>
+    void forRanges(JobSystem* jobSystem, uint32_t count, uint32_t grain, Function&& function)
+    {
+        if (jobSystem == nullptr || jobSystem->getThreadCount() < 2 || count <= grain)
+        {
+            if (count > 0)
+                function(0u, count);
+            return;
+        }
+        JobCounter counter;
+        jobSystem->parallelFor(counter, count, grain, function);
+        jobSystem->wait(counter);
+    }
+
+    uint32_t readIndex(const uint8_t* indices, bool indices32, uint32_t i) noexcept
+    {
+        if (indices32)
+        {
+            uint32_t index;
+            std::memcpy(&index, indices + static_cast<size_t>(i) * sizeof(uint32_t), sizeof(index));
+            return index;
+        }
+        uint16_t index;
+        std::memcpy(&index, indices + static_cast<size_t>(i) * sizeof(uint16_t), sizeof(index));
+        return index;
+    }
+
+    void fillSurface(JobSystem* jobSystem, const SoftwareRasterizer::Surface& surface, uint32_t value)
+    {
+        auto rows = [&surface, value](uint32_t begin, uint32_t end)
+        {
+            for (uint32_t y = begin; y < end; ++y)
+            {
+                auto row = static_cast<uint32_t*>(surface.pixels) + static_cast<size_t>(y) * surface.pitch;
+                std::fill(row, row + surface.width, value);
+            }
+        };
+        forRanges(jobSystem, surface.height, 64, rows);
+    }
+
+    bool isSameSurface(const SoftwareRasterizer::Surface& a, const SoftwareRasterizer::Surface& b) noexcept
+    {
+        return a.pixels == b.pixels && a.width == b.width && a.height == b.height && a.pitch == b.pitch;
+    }
+}
+
+// -------------------
+//  SoftwareRasterizer
+// -------------------
+
+SoftwareRasterizer::SoftwareRasterizer(const Config& config)
+    : m_config(config)
+{
+    m_config.tileSize       = std::max(PixelAlignment, (m_config.tileSize + PixelAlignment - 1) / PixelAlignment * PixelAlignment);
+    m_config.chunkTriangles = std::max(1u, m_config.chunkTriangles);
+    m_config.maxPending     = std::max(m_config.chunkTriangles, m_config.maxPending);
+}
+
+void SoftwareRasterizer::setTargets(const Surface& color, const Surface& depth)
+{
+    if (isSameSurface(color, m_color) && isSameSurface(depth, m_depth))
+        return;
+    flush();
+
+    assert((color.pixels == nullptr || color.pitch % PixelAlignment == 0) && (depth.pixels == nullptr || depth.pitch % PixelAlignment == 0));
+    m_color  = color;
+    m_depth  = depth;
+    m_width  = 0;
+    m_height = 0;
+    if (color.pixels != nullptr || depth.pixels != nullptr)
+    {
+        m_width  = static_cast<int32_t>(std::min(color.pixels != nullptr ? color.width : depth.width, depth.pixels != nullptr ? depth.width : color.width));
+        m_height = static_cast<int32_t>(std::min(color.pixels != nullptr ? color.height : depth.height, depth.pixels != nullptr ? depth.height : color.height));
+    }
+    m_tilesX = (m_width + m_config.tileSize - 1) / m_config.tileSize;
+    m_tilesY = (m_height + m_config.tileSize - 1) / m_config.tileSize;
+    m_tilePixels.assign(static_cast<size_t>(m_tilesX) * m_tilesY, 0);
+}
+
+void SoftwareRasterizer::clearColor(const Surface& target, uint32_t color)
+{
+    flush();
+    if (target.pixels != nullptr)
+        fillSurface(m_config.jobSystem, target, color);
+}
+
+void SoftwareRasterizer::clearDepth(const Surface& target, float depth)
+{
+    flush();
+    if (target.pixels != nullptr)
+        fillSurface(m_config.jobSystem, target, std::bit_cast<uint32_t>(depth));
+}
+
+void SoftwareRasterizer::draw(const DrawDesc& desc)
+{
+    PROFILE_SCOPE("SoftwareRasterizer::draw");
+    ++m_stats.draws;
+    if (m_width == 0 || desc.positions == nullptr || desc.indices == nullptr || desc.indexCount < 3 || desc.instanceCount == 0)
+        return;
+
+    // Pixels the draw may touch, viewport and scissor inside the targets
+    auto& viewport = desc.viewport;
+    Rect  clip;
+    clip.left   = std::max({ 0, static_cast<int32_t>(std::floor(viewport.x)), desc.scissor.left });
+    clip.top    = std::max({ 0, static_cast<int32_t>(std::floor(viewport.y)), desc.scissor.top });
+    clip.right  = std::min({ m_width, static_cast<int32_t>(std::ceil(viewport.x + viewport.width)), desc.scissor.right });
+    clip.bottom = std::min({ m_height, static_cast<int32_t>(std::ceil(viewport.y + viewport.height)), desc.scissor.bottom });
+    if (clip.left >= clip.right || clip.top >= clip.bottom)
+        return;
+
+    State state = { desc.color, desc.depthFunc, desc.depthTest && m_depth.pixels != nullptr, desc.depthWrite };
+    m_states.push_back(state);
+    auto stateIndex = static_cast<uint32_t>(m_states.size() - 1);
+
+    uint64_t total = static_cast<uint64_t>(desc.indexCount / 3) * desc.instanceCount;
+    uint64_t begin = 0;
+    m_stats.triangles += total;
+
+    // Small draws share the last chunk, a job each would cost more than their triangles
+    if (m_chunkCount > 0 && m_chunks[m_chunkCount - 1].inputs + total <= m_config.chunkTriangles)
+    {
+        processTriangles(desc, stateIndex, clip, 0, total, m_chunks[m_chunkCount - 1]);
+        m_pending += total;
+        begin      = total;
+    }
+
+    // Large draws flush every maxPending triangles instead of binning all of them first
+    uint64_t grain = m_config.chunkTriangles;
+    while (begin < total)
+    {
+        auto end        = std::min(total, begin + m_config.maxPending);
+        auto chunkCount = static_cast<uint32_t>((end - begin + grain - 1) / grain);
+        auto first      = m_chunkCount;
+        m_chunkCount += chunkCount;
+        if (m_chunks.size() < m_chunkCount)
+            m_chunks.resize(m_chunkCount);
+
+        auto chunks = [this, &desc, &clip, stateIndex, first, begin, end, grain](uint32_t chunkBegin, uint32_t chunkEnd)
+        {
+            for (uint32_t c = chunkBegin; c < chunkEnd; ++c)
+            {
+                auto from = begin + c * grain;
+                processTriangles(desc, stateIndex, clip, from, std::min(end, from + grain), m_chunks[first + c]);
+            }
+        };
+        forRanges(m_config.jobSystem, chunkCount, 1, chunks);
+
+        m_pending += end - begin;
+        begin      = end;
+        if (m_pending >= m_config.maxPending && begin < total)
+        {
+            // Flushing drops the states, the rest of the draw needs its own again
+            flush();
+            m_states.push_back(state);
+            stateIndex = 0;
+        }
+    }
+    if (m_pending >= m_config.maxPending)
+        flush();
+}
+
+void SoftwareRasterizer::flush()
+{
+    if (m_chunkCount == 0)
+        return;
+    PROFILE_SCOPE("SoftwareRasterizer::flush");
+
+    auto sort = [this](uint32_t begin, uint32_t end)
+    {
+        for (uint32_t c = begin; c < end; ++c)
+            sortBins(m_chunks[c]);
+    };
+    forRanges(m_config.jobSystem, m_chunkCount, 1, sort);
+
+    auto tiles = [this](uint32_t begin, uint32_t end)
+    {
+        for (uint32_t tile = begin; tile < end; ++tile)
+            rasterizeTile(tile);
+    };
+    forRanges(m_config.jobSystem, m_tilesX * m_tilesY, 1, tiles);
+
+    for (uint32_t c = 0; c < m_chunkCount; ++c)
+    {
+        auto& chunk = m_chunks[c];
+        m_stats.binned  += chunk.binned.size();
+        m_stats.culled  += chunk.culled;
+        m_stats.clipped += chunk.clipped;
+        chunk.triangles.clear();
+        chunk.entryTiles.clear();
+        chunk.entryTriangles.clear();
+        chunk.inputs  = 0;
+        chunk.culled  = 0;
+        chunk.clipped = 0;
+    }
+    for (auto& pixels : m_tilePixels)
+    {
+        m_stats.pixels += pixels;
+        pixels = 0;
+    }
+    m_states.clear();
+    m_chunkCount = 0;
+    m_pending    = 0;
+    ++m_stats.flushes;
+}
+
+uint32_t SoftwareRasterizer::packColor(const float rgba[4]) noexcept
+{
+    uint32_t color = 0;
+    for (uint32_t i = 0; i < 4; ++i)
+        color |= static_cast<uint32_t>(std::clamp(rgba[i], 0.f, 1.f) * 255.f + 0.5f) << (i * 8);
+    return color;
+}
+
+void SoftwareRasterizer::processTriangles(const DrawDesc& desc, uint32_t state, const Rect& clip, uint64_t begin, uint64_t end, Chunk& chunk)
+{
+    uint32_t perInstance = desc.indexCount / 3;
+    uint32_t instance    = UINT32_MAX;
+    bool     valid       = false;
+    Mat4     matrix;
+    chunk.inputs += static_cast<uint32_t>(end - begin);
+    for (uint64_t t = begin; t < end; ++t)
+    {
+        auto current  = static_cast<uint32_t>(t / perInstance);
+        auto triangle = static_cast<uint32_t>(t % perInstance);
+        if (current != instance)
+        {
+            instance = current;
+            auto id  = instance;
+            if (desc.instanceIds != nullptr)
+                std::memcpy(&id, desc.instanceIds + static_cast<size_t>(instance) * desc.instanceIdStride, sizeof(id));
+
+            valid  = desc.worlds == nullptr || id < desc.worldCount;
+            matrix = desc.viewProjection;
+            if (desc.worlds != nullptr && valid)
+            {
+                Mat4 world;
+                std::memcpy(&world, desc.worlds + static_cast<size_t>(id) * sizeof(Mat4), sizeof(Mat4));
+                matrix = world * desc.viewProjection;
+            }
+        }
+        if (!valid)
+        {
+            ++chunk.culled;
+            continue;
+        }
+
+        Vec4 vertices[3];
+        bool inside = true;
+        for (uint32_t k = 0; k < 3 && inside; ++k)
+        {
+            auto index = static_cast<int64_t>(readIndex(desc.indices, desc.indices32, triangle * 3 + k)) + desc.baseVertex;
+            inside = index >= 0 && index < desc.vertexCount;
+            if (!inside)
+                break;
+            float position[3];
+            std::memcpy(position, desc.positions + static_cast<size_t>(index) * desc.stride, sizeof(position));
+            vertices[k] = transform({ position[0], position[1], position[2], 1.f }, matrix);
+        }
+        if (!inside)
+        {
+            ++chunk.culled;
+            continue;
+        }
+        clipTriangle(vertices, desc, state, clip, chunk);
+    }
+}
+
+void SoftwareRasterizer::clipTriangle(const Vec4* vertices, const DrawDesc& desc, uint32_t state, const Rect& clip, Chunk& chunk)
+{
+    // All three outside one plane of the clip volume, nothing of the triangle is visible
+    auto allOutside = [vertices](auto&& outside) { return outside(vertices[0]) && outside(vertices[1]) && outside(vertices[2]); };
+    if (allOutside([](const Vec4& v) { return v.x < -v.w; }) || allOutside([](const Vec4& v) { return v.x > v.w; }) ||
+        allOutside([](const Vec4& v) { return v.y < -v.w; }) || allOutside([](const Vec4& v) { return v.y > v.w; }) ||
+        allOutside([](const Vec4& v) { return v.z < 0.f; })  || allOutside([](const Vec4& v) { return v.z > v.w; }))
+    {
+        ++chunk.culled;
+        return;
+    }
+
+    bool crossing = false;
+    for (uint32_t k = 0; k < 3; ++k)
+        crossing = crossing || vertices[k].z < 0.f || vertices[k].z > vertices[k].w;
+    if (!crossing)
+    {
+        setupTriangle(vertices, desc, state, clip, chunk);
+        return;
+    }
+    ++chunk.clipped;
+
+    // Sutherland-Hodgman against z >= 0 and z <= w, x and y are left to the clip rectangle.
+    // Each plane adds at most one vertex
+    Vec4     polygons[2][5];
+    uint32_t count = 3;
+    std::copy(vertices, vertices + 3, polygons[0]);
+    for (uint32_t plane = 0; plane < 2; ++plane)
+    {
+        auto  input    = polygons[plane];
+        auto  output   = polygons[plane ^ 1];
+        auto  distance = [plane](const Vec4& v) { return plane == 0 ? v.z : v.w - v.z; };
+        uint32_t outputCount = 0;
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            auto& current = input[i];
+            auto& next    = input[(i + 1) % count];
+            float dc      = distance(current);
+            float dn      = distance(next);
+            if (dc >= 0.f)
+                output[outputCount++] = current;
+            if ((dc >= 0.f) != (dn >= 0.f))
+            {
+                float t = dc / (dc - dn);
+                output[outputCount++] = { current.x + (next.x - current.x) * t, current.y + (next.y - current.y) * t,
+                                          current.z + (next.z - current.z) * t, current.w + (next.w - current.w) * t };
+            }
+        }
+        count = outputCount;
+    }
+
+    // Back in polygons[0] after both planes, as a fan
+    for (uint32_t i = 1; i + 1 < count; ++i)
+    {
+        Vec4 triangle[3] = { polygons[0][0], polygons[0][i], polygons[0][i + 1] };
+        setupTriangle(triangle, desc, state, clip, chunk);
+    }
+}
+
+void SoftwareRasterizer::setupTriangle(const Vec4* vertices, const DrawDesc& desc, uint32_t state, const Rect& clip, Chunk& chunk)
+{
+    // Screen space, y down, pixel centers at + 0.5
+    auto& viewport = desc.viewport;
+    float x[3], y[3], z[3];
+    for (uint32_t k = 0; k < 3; ++k)
+    {
+        if (!(vertices[k].w > 0.f))
+        {
+            ++chunk.culled;
+            return;
+        }
+        float invW = 1.f / vertices[k].w;
+        x[k] = viewport.x + (vertices[k].x * invW + 1.f) * 0.5f * viewport.width;
+        y[k] = viewport.y + (1.f - vertices[k].y * invW) * 0.5f * viewport.height;
+        z[k] = viewport.minDepth + vertices[k].z * invW * (viewport.maxDepth - viewport.minDepth);
+    }
+
+    // Clockwise on screen is front facing, which is a positive area with y down
+    float area = (x[1] - x[0]) * (y[2] - y[0]) - (y[1] - y[0]) * (x[2] - x[0]);
+    if (!std::isfinite(area) || area == 0.f || (desc.cullMode == CullMode::Back && area < 0.f) || (desc.cullMode == CullMode::Front && area > 0.f))
+    {
+        ++chunk.culled;
+        return;
+    }
+    if (area < 0.f)
+    {
+        std::swap(x[1], x[2]);
+        std::swap(y[1], y[2]);
+        std::swap(z[1], z[2]);
+        area = -area;
+    }
+
+    // Edge i runs from vertex i to the next one, divided by the area it is the barycentric of the vertex opposite
+    Triangle triangle = {};
+    for (uint32_t e = 0; e < 3; ++e)
+    {
+        uint32_t next     = (e + 1) % 3;
+        uint32_t opposite = (e + 2) % 3;
+        triangle.a[e] = y[e] - y[next];
+        triangle.b[e] = x[next] - x[e];
+        triangle.c[e] = x[e] * y[next] - x[next] * y[e];
+        triangle.zx  += triangle.a[e] * z[opposite];
+        triangle.zy  += triangle.b[e] * z[opposite];
+        triangle.z0  += triangle.c[e] * z[opposite];
+
+        // Left edges have the inside on their right, top edges are horizontal with the inside below
+        bool topLeft = triangle.a[e] > 0.f || (triangle.a[e] == 0.f && triangle.b[e] > 0.f);
+        triangle.topLeft |= static_cast<uint32_t>(topLeft) << e;
+    }
+    float invArea = 1.f / area;
+    triangle.zx *= invArea;
+    triangle.zy *= invArea;
+    triangle.z0 *= invArea;
+
+    // Pixels whose centers the bounds contain, clamped as floats since vertices may be far off screen
+    float minX = std::max(std::ceil(std::min({ x[0], x[1], x[2] }) - 0.5f), static_cast<float>(clip.left));
+    float minY = std::max(std::ceil(std::min({ y[0], y[1], y[2] }) - 0.5f), static_cast<float>(clip.top));
+    float maxX = std::min(std::floor(std::max({ x[0], x[1], x[2] }) - 0.5f), static_cast<float>(clip.right - 1));
+    float maxY = std::min(std::floor(std::max({ y[0], y[1], y[2] }) - 0.5f), static_cast<float>(clip.bottom - 1));
+    if (minX > maxX || minY > maxY)
+    {
+        ++chunk.culled;
+        return;
+    }
+    triangle.minX  = static_cast<int32_t>(minX);
+    triangle.minY  = static_cast<int32_t>(minY);
+    triangle.maxX  = static_cast<int32_t>(maxX);
+    triangle.maxY  = static_cast<int32_t>(maxY);
+    triangle.state = state;
+
+    auto index    = static_cast<uint32_t>(chunk.triangles.size());
+    auto tileSize = static_cast<int32_t>(m_config.tileSize);
+    chunk.triangles.push_back(triangle);
+    for (int32_t ty = triangle.minY / tileSize; ty <= triangle.maxY / tileSize; ++ty)
+    {
+        for (int32_t tx = triangle.minX / tileSize; tx <= triangle.maxX / tileSize; ++tx)
+        {
+            chunk.entryTiles.push_back(static_cast<uint32_t>(ty) * m_tilesX + static_cast<uint32_t>(tx));
+            chunk.entryTriangles.push_back(index);
+        }
+    }
+}
+
+void SoftwareRasterizer::sortBins(Chunk& chunk)
+{
+    // Counting sort, stable so a tile sees the triangles of the chunk in draw order
+    auto tiles = static_cast<size_t>(m_tilesX) * m_tilesY;
+    chunk.binStart.assign(tiles + 1, 0);
+    for (auto tile : chunk.entryTiles)
+        ++chunk.binStart[tile + 1];
+    for (size_t tile = 0; tile < tiles; ++tile)
+        chunk.binStart[tile + 1] += chunk.binStart[tile];
+
+    chunk.binned.resize(chunk.entryTiles.size());
+    for (size_t i = 0; i < chunk.entryTiles.size(); ++i)
+        chunk.binned[chunk.binStart[chunk.entryTiles[i]]++] = chunk.entryTriangles[i];
+
+    // Filling advanced every start to the next one
+    for (size_t tile = tiles; tile > 0; --tile)
+        chunk.binStart[tile] = chunk.binStart[tile - 1];
+    chunk.binStart[0] = 0;
+}
+
+void SoftwareRasterizer::rasterizeTile(uint32_t tile)
+{
+    auto    tileSize = static_cast<int32_t>(m_config.tileSize);
+    int32_t left     = static_cast<int32_t>(tile % m_tilesX) * tileSize;
+    int32_t top      = static_cast<int32_t>(tile / m_tilesX) * tileSize;
+    int32_t right    = std::min(left + tileSize, m_width);
+    int32_t bottom   = std::min(top + tileSize, m_height);
+
+    uint64_t pixels = 0;
+    for (uint32_t c = 0; c < m_chunkCount; ++c)
+    {
+        auto& chunk = m_chunks[c];
+        for (uint32_t i = chunk.binStart[tile]; i < chunk.binStart[tile + 1]; ++i)
+            rasterizeTriangle(chunk.triangles[chunk.binned[i]], left, top, right, bottom, pixels);
+    }
+    m_tilePixels[tile] += pixels;
+}
+
+void SoftwareRasterizer::rasterizeTriangle(const Triangle& triangle, int32_t left, int32_t top, int32_t right, int32_t bottom, uint64_t& pixels)
+{
+    constexpr int32_t Width = Simd::Width;
+
+    int32_t x0 = std::max(triangle.minX, left);
+    int32_t y0 = std::max(triangle.minY, top);
+    int32_t x1 = std::min(triangle.maxX, right - 1);
+    int32_t y1 = std::min(triangle.maxY, bottom - 1);
+    if (x0 > x1 || y0 > y1)
+        return;
+
+    auto&  state   = m_states[triangle.state];
+    auto   offsets = laneOffsets();
+    auto   zero    = FloatN::zero();
+    auto   half    = FloatN::splat(0.5f);
+    auto   first   = FloatN::splat(static_cast<float>(x0));
+    auto   last    = FloatN::splat(static_cast<float>(x1));
+    auto   zx      = FloatN::splat(triangle.zx);
+    FloatN a[3], topLeft[3];
+    for (int e = 0; e < 3; ++e)
+    {
+        a[e]       = FloatN::splat(triangle.a[e]);
+        topLeft[e] = laneMask((triangle.topLeft >> e) & 1);
+    }
+
+    // Vectors start aligned, tiles are PixelAlignment wide so one never reaches into the next tile
+    int32_t xStart = x0 & ~(Width - 1);
+    for (int32_t y = y0; y <= y1; ++y)
+    {
+        float  py = static_cast<float>(y) + 0.5f;
+        FloatN rowEdge[3];
+        for (int e = 0; e < 3; ++e)
+            rowEdge[e] = FloatN::splat(triangle.b[e] * py + triangle.c[e]);
+        auto rowZ     = FloatN::splat(triangle.zy * py + triangle.z0);
+        auto colorRow = m_color.pixels != nullptr ? static_cast<uint32_t*>(m_color.pixels) + static_cast<size_t>(y) * m_color.pitch : nullptr;
+        auto depthRow = m_depth.pixels != nullptr ? static_cast<float*>(m_depth.pixels) + static_cast<size_t>(y) * m_depth.pitch : nullptr;
+
+        for (int32_t x = xStart; x <= x1; x += Width)
+        {
+            // Edge functions at the pixel centers, on the edge counts only for top-left edges
+            auto index  = FloatN::splat(static_cast<float>(x)) + offsets;
+            auto px     = index + half;
+            auto inside = Simd::greaterEqual(index, first) & Simd::lessEqual(index, last);
+            for (int e = 0; e < 3; ++e)
+            {
+                auto edge = Simd::madd(a[e], px, rowEdge[e]);
+                inside = inside & Simd::select(Simd::greaterThan(edge, zero), Simd::greaterEqual(edge, zero), topLeft[e]);
+            }
+            if (Simd::moveMask(inside) == 0)
+                continue;
+
+            if (state.depthTest)
+            {
+                auto z     = Simd::madd(zx, px, rowZ);
+                auto depth = FloatN::load(depthRow + x);
+                inside = inside & compareDepth(state.depthFunc, z, depth);
+                if (state.depthWrite)
+                    Simd::store(depthRow + x, Simd::select(depth, z, inside));
+            }
+
+            auto mask = static_cast<uint32_t>(Simd::moveMask(inside));
+            pixels += std::popcount(mask);
+            if (colorRow == nullptr)
+                continue;
+            for (; mask != 0; mask &= mask - 1)
+                colorRow[x + std::countr_zero(mask)] = state.color;
+        }
+    }
+}
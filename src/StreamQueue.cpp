@@ -0,0 +1,102 @@
+#include "StreamQueue.hpp"
+
+#include <algorithm>
+
+#include <assert.h>
+
+using namespace GalgameEngine;
+
+void StreamQueue::push(uint64_t id, float priority, uint64_t size)
+{
+    assert(!contains(id));
+    auto& live = m_live[id];
+    live = { priority, m_nextStamp++, m_nextOrder++, size };
+    pushEntry(id, live);
+    m_queuedBytes += size;
+    ++m_stats.pushes;
+}
+
+bool StreamQueue::setPriority(uint64_t id, float priority)
+{
+    auto it = m_live.find(id);
+    if (it == m_live.end())
+        return false;
+    if (it->second.priority == priority)
+        return true;
+
+    it->second.priority = priority;
+    it->second.stamp    = m_nextStamp++;
+    pushEntry(id, it->second);
+    ++m_stats.reprioritize;
+    return true;
+}
+
+bool StreamQueue::remove(uint64_t id)
+{
+    auto it = m_live.find(id);
+    if (it == m_live.end())
+        return false;
+
+    m_queuedBytes -= it->second.size;
+    m_live.erase(it);
+    ++m_stats.removes;
+    return true;
+}
+
+bool StreamQueue::top(Item& item)
+{
+    if (!settleTop())
+        return false;
+
+    auto& entry = m_heap.front();
+    item = { entry.id, entry.priority, m_live.find(entry.id)->second.size };
+    return true;
+}
+
+void StreamQueue::pop()
+{
+    if (!settleTop())
+        return;
+
+    auto it = m_live.find(m_heap.front().id);
+    m_queuedBytes -= it->second.size;
+    m_live.erase(it);
+    std::pop_heap(m_heap.begin(), m_heap.end(), isAfter);
+    m_heap.pop_back();
+    ++m_stats.pops;
+}
+
+void StreamQueue::pushEntry(uint64_t id, const Live& live)
+{
+    // Mostly dead entries, rebuilding from the live map is cheaper than dropping them one by one
+    if (m_heap.size() >= 64 && m_heap.size() > m_live.size() * 2)
+    {
+        m_heap.clear();
+        for (auto& [liveId, other] : m_live)
+        {
+            if (liveId != id)
+                m_heap.push_back({ other.priority, other.stamp, other.order, liveId });
+        }
+        std::make_heap(m_heap.begin(), m_heap.end(), isAfter);
+        ++m_stats.rebuilds;
+    }
+
+    m_heap.push_back({ live.priority, live.stamp, live.order, id });
+    std::push_heap(m_heap.begin(), m_heap.end(), isAfter);
+}
+
+bool StreamQueue::settleTop()
+{
+    while (!m_heap.empty())
+    {
+        auto& entry = m_heap.front();
+        auto  it    = m_live.find(entry.id);
+        if (it != m_live.end() && it->second.stamp == entry.stamp)
+            return true;
+
+        std::pop_heap(m_heap.begin(), m_heap.end(), isAfter);
+        m_heap.pop_back();
+        ++m_stats.staleDropped;
+    }
+    return false;
+}
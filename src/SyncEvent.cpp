@@ -0,0 +1,245 @@
+#include "SyncEvent.hpp"
+
+#include <cerrno>
+#include <algorithm>
+#include <system_error>
+
+#include <assert.h>
+
+#ifdef _WIN32
+    #include "Util.hpp"
+#else
+    #include <poll.h>
+    #include <unistd.h>
+    #include <sys/eventfd.h>
+#endif
+
+using namespace GalgameEngine;
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    // Time left until the deadline in the unit the OS wait takes, -1 waits forever
+    int64_t remainingMilliseconds(SyncEvent::Timeout timeout, Clock::time_point deadline) noexcept
+    {
+        if (timeout == SyncEvent::Infinite)
+            return -1;
+        auto left = std::chrono::ceil<std::chrono::milliseconds>(deadline - Clock::now()).count();
+        return std::max<int64_t>(left, 0);
+    }
+
+    Clock::time_point getDeadline(SyncEvent::Timeout timeout) noexcept
+    {
+        if (timeout == SyncEvent::Infinite)
+            return Clock::time_point::max();
+        return Clock::now() + timeout;
+    }
+
+#ifndef _WIN32
+    [[noreturn]] void throwErrno(const char* what)
+    {
+        throw std::system_error(errno, std::generic_category(), what);
+    }
+
+    // Consume the signal, false when another waiter took it first
+    bool consume(int fd)
+    {
+        uint64_t value;
+        if (read(fd, &value, sizeof(value)) == sizeof(value))
+            return true;
+        if (errno != EAGAIN && errno != EINTR)
+            throwErrno("SyncEvent: read eventfd");
+        return false;
+    }
+
+    // Wait until one of the events is readable, return false on timeout
+    bool pollEvents(pollfd* fds, uint32_t count, SyncEvent::Timeout timeout, Clock::time_point deadline)
+    {
+        while (true)
+        {
+            auto milliseconds = remainingMilliseconds(timeout, deadline);
+            int  result       = poll(fds, count, static_cast<int>(std::min<int64_t>(milliseconds, INT32_MAX)));
+            if (result > 0)
+                return true;
+            if (result == 0)
+                return false;
+            if (errno != EINTR)
+                throwErrno("SyncEvent: poll");
+        }
+    }
+#endif
+}
+
+// ----------
+//  SyncEvent
+// ----------
+
+SyncEvent::SyncEvent()
+{
+#ifdef _WIN32
+    // Auto-reset, a satisfied wait resets it like read() of an eventfd does
+    m_handle = CreateEventExW(nullptr, nullptr, 0, EVENT_ALL_ACCESS);
+    if (m_handle == nullptr)
+    {
+        ThrowIfFailed(HRESULT_FROM_WIN32(GetLastError()));
+    }
+#else
+    m_handle = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (m_handle < 0)
+        throwErrno("SyncEvent: eventfd");
+#endif
+}
+
+SyncEvent::~SyncEvent()
+{
+#ifdef _WIN32
+    CloseHandle(m_handle);
+#else
+    close(m_handle);
+#endif
+}
+
+void SyncEvent::set()
+{
+#ifdef _WIN32
+    ThrowIfFalse(SetEvent(m_handle));
+#else
+    uint64_t one = 1;
+    if (write(m_handle, &one, sizeof(one)) != sizeof(one) && errno != EAGAIN)
+        throwErrno("SyncEvent: write eventfd");
+#endif
+}
+
+void SyncEvent::reset()
+{
+#ifdef _WIN32
+    ThrowIfFalse(ResetEvent(m_handle));
+#else
+    consume(m_handle);
+#endif
+}
+
+bool SyncEvent::wait(Timeout timeout)
+{
+    SyncEvent* self = this;
+    return waitAny(&self, 1, timeout) == 0;
+}
+
+uint32_t SyncEvent::waitAny(SyncEvent* const* events, uint32_t count, Timeout timeout)
+{
+    assert(count > 0 && count <= MaxWaitCount);
+
+    auto deadline = getDeadline(timeout);
+#ifdef _WIN32
+    HANDLE handles[MaxWaitCount];
+    for (uint32_t i = 0; i < count; ++i)
+        handles[i] = events[i]->m_handle;
+
+    auto  milliseconds = remainingMilliseconds(timeout, deadline);
+    DWORD result       = WaitForMultipleObjects(count, handles, FALSE, milliseconds < 0 ? INFINITE : static_cast<DWORD>(std::min<int64_t>(milliseconds, INFINITE - 1)));
+    if (result == WAIT_TIMEOUT)
+        return TimedOut;
+    ThrowIfFalse(result < WAIT_OBJECT_0 + count);
+    return result - WAIT_OBJECT_0;
+#else
+    pollfd fds[MaxWaitCount];
+    for (uint32_t i = 0; i < count; ++i)
+        fds[i] = { events[i]->m_handle, POLLIN, 0 };
+
+    // Another waiter may consume a readable event first, poll again until one is ours or time is up
+    while (pollEvents(fds, count, timeout, deadline))
+    {
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            if ((fds[i].revents & POLLIN) != 0 && consume(fds[i].fd))
+                return i;
+        }
+    }
+    return TimedOut;
+#endif
+}
+
+bool SyncEvent::waitAll(SyncEvent* const* events, uint32_t count, Timeout timeout)
+{
+    assert(count > 0 && count <= MaxWaitCount);
+
+    auto deadline = getDeadline(timeout);
+#ifdef _WIN32
+    HANDLE handles[MaxWaitCount];
+    for (uint32_t i = 0; i < count; ++i)
+        handles[i] = events[i]->m_handle;
+
+    auto  milliseconds = remainingMilliseconds(timeout, deadline);
+    DWORD result       = WaitForMultipleObjects(count, handles, TRUE, milliseconds < 0 ? INFINITE : static_cast<DWORD>(std::min<int64_t>(milliseconds, INFINITE - 1)));
+    if (result == WAIT_TIMEOUT)
+        return false;
+    ThrowIfFalse(result < WAIT_OBJECT_0 + count);
+    return true;
+#else
+    // Drop every readable event from the poll set, consume them all once it is empty
+    // so a timeout leaves every signal in place like WaitForMultipleObjects does
+    pollfd   fds[MaxWaitCount];
+    uint32_t pending = count;
+    for (uint32_t i = 0; i < count; ++i)
+        fds[i] = { events[i]->m_handle, POLLIN, 0 };
+
+    while (pollEvents(fds, pending, timeout, deadline))
+    {
+        for (uint32_t i = 0; i < pending;)
+        {
+            if ((fds[i].revents & POLLIN) != 0)
+                fds[i] = fds[--pending];
+            else
+                ++i;
+        }
+        if (pending == 0)
+        {
+            for (uint32_t i = 0; i < count; ++i)
+                consume(events[i]->m_handle);
+            return true;
+        }
+    }
+    return false;
+#endif
+}
+
+// --------------
+//  SyncEventPool
+// --------------
+
+SyncEventPool::~SyncEventPool()
+{
+    assert(m_free.size() == m_events.size() && "Event is still acquired");
+}
+
+SyncEvent* SyncEventPool::acquire()
+{
+    std::lock_guard lock(m_mutex);
+    ++m_stats.acquired;
+    if (!m_free.empty())
+    {
+        auto event = m_free.back();
+        m_free.pop_back();
+        return event;
+    }
+
+    m_events.push_back(std::make_unique<SyncEvent>());
+    ++m_stats.created;
+    return m_events.back().get();
+}
+
+void SyncEventPool::release(SyncEvent* event)
+{
+    // A signal nobody waited for must not wake the next user
+    event->reset();
+
+    std::lock_guard lock(m_mutex);
+    m_free.push_back(event);
+}
+
+SyncEventPool::Stats SyncEventPool::getStats() const
+{
+    std::lock_guard lock(m_mutex);
+    return m_stats;
+}
@@ -0,0 +1,181 @@
+#include "TimelineSync.hpp"
+
+#include <algorithm>
+
+#include <assert.h>
+
+using namespace GalgameEngine;
+
+TimelineSync::~TimelineSync()
+{
+    // Events still set on a fence would be signaled after the pool is gone
+    for (auto event : m_armedEvents)
+    {
+        event->wait();
+        m_events.release(event);
+    }
+}
+
+uint32_t TimelineSync::waitAny(const FencePoint* points, uint32_t count, Timeout timeout)
+{
+    assert(count > 0 && count <= SyncEvent::MaxWaitCount);
+
+    // Polling is enough most of the time, GPU is usually ahead of the point CPU asks for
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        if (points[i].isCompleted())
+            return i;
+    }
+    if (timeout == Timeout::zero())
+        return TimedOut;
+
+    recycle();
+
+    SyncEvent* events[SyncEvent::MaxWaitCount];
+    arm(points, count, events);
+    auto index = SyncEvent::waitAny(events, count, timeout);
+    if (index != TimedOut)
+    {
+        m_events.release(events[index]);
+        events[index] = nullptr;
+    }
+    disarm(events, count, false);
+
+    std::lock_guard lock(m_mutex);
+    ++m_stats.waits;
+    if (index == TimedOut)
+        ++m_stats.timeouts;
+    return index;
+}
+
+bool TimelineSync::waitAll(const FencePoint* points, uint32_t count, Timeout timeout)
+{
+    assert(count > 0 && count <= SyncEvent::MaxWaitCount);
+
+    bool completed = true;
+    for (uint32_t i = 0; i < count && completed; ++i)
+        completed = points[i].isCompleted();
+    if (completed)
+        return true;
+    if (timeout == Timeout::zero())
+        return false;
+
+    recycle();
+
+    SyncEvent* events[SyncEvent::MaxWaitCount];
+    arm(points, count, events);
+    completed = SyncEvent::waitAll(events, count, timeout);
+    disarm(events, count, completed);
+
+    std::lock_guard lock(m_mutex);
+    ++m_stats.waits;
+    if (!completed)
+        ++m_stats.timeouts;
+    return completed;
+}
+
+void TimelineSync::onCompleted(const FencePoint& point, Callback callback)
+{
+    std::lock_guard lock(m_mutex);
+    m_callbacks.push_back({ point, std::move(callback) });
+}
+
+uint32_t TimelineSync::dispatch()
+{
+    recycle();
+
+    // Move reached callbacks out and keep the order of the others, then run them without the lock
+    // so a callback can register new ones
+    std::vector<PendingCallback> ready;
+    {
+        std::lock_guard lock(m_mutex);
+
+        // Read the completed value of every queue once
+        struct Completed
+        {
+            CommandQueue* queue;
+            uint64_t      value;
+        };
+        std::vector<Completed> completed;
+
+        size_t kept = 0;
+        for (auto& pending : m_callbacks)
+        {
+            auto it = std::find_if(completed.begin(), completed.end(), [&](const Completed& c) { return c.queue == pending.point.queue; });
+            if (it == completed.end())
+                it = completed.insert(completed.end(), { pending.point.queue, pending.point.queue->getCompletedValue() });
+
+            if (it->value >= pending.point.value)
+                ready.push_back(std::move(pending));
+            else
+                m_callbacks[kept++] = std::move(pending);
+        }
+        m_callbacks.resize(kept);
+    }
+
+    for (auto& pending : ready)
+        pending.callback();
+
+    std::lock_guard lock(m_mutex);
+    m_stats.callbacks += ready.size();
+    return static_cast<uint32_t>(ready.size());
+}
+
+uint32_t TimelineSync::getPendingCallbackCount() const
+{
+    std::lock_guard lock(m_mutex);
+    return static_cast<uint32_t>(m_callbacks.size());
+}
+
+TimelineSync::Stats TimelineSync::getStats() const
+{
+    std::lock_guard lock(m_mutex);
+    auto stats = m_stats;
+    stats.createdEvents = m_events.getStats().created;
+    stats.armedEvents   = static_cast<uint32_t>(m_armedEvents.size());
+    return stats;
+}
+
+void TimelineSync::arm(const FencePoint* points, uint32_t count, SyncEvent** events)
+{
+    // A point reached meanwhile signals its event at once
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        events[i] = m_events.acquire();
+        points[i].queue->setEventOnCompletion(points[i].value, *events[i]);
+    }
+}
+
+void TimelineSync::disarm(SyncEvent** events, uint32_t count, bool consumed)
+{
+    std::lock_guard lock(m_mutex);
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        if (events[i] == nullptr)
+            continue;
+
+        // The signal may still be on its way even when the fence has already passed the value
+        if (consumed || events[i]->wait(Timeout::zero()))
+            m_events.release(events[i]);
+        else
+            m_armedEvents.push_back(events[i]);
+    }
+}
+
+void TimelineSync::recycle()
+{
+    std::lock_guard lock(m_mutex);
+    for (size_t i = 0; i < m_armedEvents.size();)
+    {
+        if (m_armedEvents[i]->wait(Timeout::zero()))
+        {
+            m_events.release(m_armedEvents[i]);
+            m_armedEvents[i] = m_armedEvents.back();
+            m_armedEvents.pop_back();
+        }
+        else
+        {
+            ++i;
+        }
+    }
+}
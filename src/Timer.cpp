@@ -1,27 +1,122 @@
 #include "Timer.hpp"
-#include <Windows.h>
+
+#include <chrono>
+
+#if defined(_M_X64) || defined(__x86_64__)
+    #define TIMER_HAS_TSC 1
+    #ifdef _MSC_VER
+        #include <intrin.h>
+    #else
+        #include <cpuid.h>
+        #include <x86intrin.h>
+    #endif
+#endif
 
 using namespace GalgameEngine;
 
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+    static_assert(Clock::is_steady);
+
+    /*
+    * Clock read is on the hot path of profiling scopes, reading TSC is several times cheaper than
+    * going through the OS clock. Only use it when it is invariant (constant rate, keeps running in sleep states),
+    * its rate is calibrated once against the OS monotonic clock
+    */
+    struct TickSource
+    {
+        bool   useTsc          = false;
+        double secondsPerCount = static_cast<double>(Clock::period::num) / Clock::period::den;
+    };
+
+#ifdef TIMER_HAS_TSC
+    bool hasInvariantTsc() noexcept
+    {
+        unsigned int regs[4] = {};
+    #ifdef _MSC_VER
+        __cpuid(reinterpret_cast<int*>(regs), 0x80000000);
+        if (regs[0] < 0x80000007)
+            return false;
+        __cpuid(reinterpret_cast<int*>(regs), 0x80000007);
+    #else
+        if (__get_cpuid_max(0x80000000, nullptr) < 0x80000007)
+            return false;
+        __get_cpuid(0x80000007, &regs[0], &regs[1], &regs[2], &regs[3]);
+    #endif
+        // EDX bit 8 is invariant TSC
+        return (regs[3] & (1u << 8)) != 0;
+    }
+#endif
+
+    TickSource calibrate() noexcept
+    {
+        TickSource source;
+#ifdef TIMER_HAS_TSC
+        if (!hasInvariantTsc())
+            return source;
+
+        // Spin a few milliseconds, error of the measured rate is around 1e-5
+        constexpr auto CalibrationTime = std::chrono::milliseconds(5);
+        auto     clockBegin = Clock::now();
+        uint64_t tscBegin   = __rdtsc();
+        auto     clockEnd   = clockBegin;
+        while (clockEnd - clockBegin < CalibrationTime)
+            clockEnd = Clock::now();
+        uint64_t tscEnd = __rdtsc();
+
+        if (tscEnd > tscBegin)
+        {
+            source.useTsc          = true;
+            source.secondsPerCount = std::chrono::duration<double>(clockEnd - clockBegin).count() / (tscEnd - tscBegin);
+        }
+#endif
+        return source;
+    }
+
+    const TickSource& tickSource() noexcept
+    {
+        static const TickSource s_source = calibrate();
+        return s_source;
+    }
+}
+
 Timer::Timer() noexcept
 {
-    __int64 countsPerSecond;
-    QueryPerformanceFrequency((LARGE_INTEGER*)&countsPerSecond);
-    m_secondsPerCount = 1.0 / (double)countsPerSecond;
+    reset();
+}
+
+int64_t Timer::now() noexcept
+{
+#ifdef TIMER_HAS_TSC
+    if (tickSource().useTsc)
+        return static_cast<int64_t>(__rdtsc());
+#endif
+    return Clock::now().time_since_epoch().count();
+}
+
+double Timer::getSecondsPerCount() noexcept
+{
+    return tickSource().secondsPerCount;
 }
 
 void Timer::reset() noexcept
 {
-    QueryPerformanceCounter((LARGE_INTEGER*)&m_baseTime);
-    m_prevTime = m_baseTime;
-    m_stopTime = 0;
-    m_paused = false;
+    m_baseTime    = now();
+    m_prevTime    = m_baseTime;
+    m_currTime    = m_baseTime;
+    m_pausedTime  = 0;
+    m_stopTime    = 0;
+    m_paused      = false;
+    m_deltaTime   = 0.0;
+    m_frameCnt    = 0;
+    m_timeElapsed = 0.f;
+    m_histogram.clear();
 }
 
 void Timer::resume() noexcept
 {
-    __int64 currTime;
-    QueryPerformanceCounter((LARGE_INTEGER*)&currTime);
+    int64_t currTime = now();
 
     if (m_paused)
     {
@@ -37,7 +132,7 @@ void Timer::pause() noexcept
     if (!m_paused)
     {
         m_paused = true;
-        QueryPerformanceCounter((LARGE_INTEGER*)&m_stopTime);
+        m_stopTime = now();
     }
 }
 
@@ -45,49 +140,47 @@ float Timer::getTime() const noexcept
 {
     if (!m_paused)
     {
-        return (float)(m_currTime - m_pausedTime - m_baseTime) * m_secondsPerCount;
+        return (float)((m_currTime - m_pausedTime - m_baseTime) * getSecondsPerCount());
     }
     else
     {
-        return (float)(m_stopTime - m_pausedTime - m_baseTime) * m_secondsPerCount;
+        return (float)((m_stopTime - m_pausedTime - m_baseTime) * getSecondsPerCount());
     }
 }
 
 void Timer::update() noexcept
 {
-    static double deltaTime = 0.0;
     if (m_paused)
     {
-        deltaTime = 0;
+        m_deltaTime = 0;
         return;
     }
 
-    QueryPerformanceCounter((LARGE_INTEGER*)&m_currTime);
+    m_currTime = now();
     
-    deltaTime = (m_currTime - m_prevTime) * m_secondsPerCount;
+    m_deltaTime = (m_currTime - m_prevTime) * getSecondsPerCount();
     m_prevTime = m_currTime;
 
-    if (deltaTime < 0.0)
+    if (m_deltaTime < 0.0)
     {
-        deltaTime = 0.0;
+        m_deltaTime = 0.0;
     }
+
+    m_histogram.record(m_deltaTime);
 }
 
 void Timer::calculateFrameState() noexcept
 {
-    static int   frameCnt    = 0;
-    static float timeElapsed = 0.f;
-
-    ++frameCnt;
+    ++m_frameCnt;
 
-    if (getTime() - timeElapsed >= 1.f)
+    if (getTime() - m_timeElapsed >= 1.f)
     {
-        m_fps  = (float)frameCnt;
+        m_fps  = (float)m_frameCnt;
         m_mspf = 1000.f / m_fps;
 
-        frameCnt = 0;
-        timeElapsed += 1.f;
+        m_frameCnt = 0;
+        m_timeElapsed += 1.f;
 
         m_func(); 
     }
-}
\ No newline at end of file
+}
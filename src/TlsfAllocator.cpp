@@ -0,0 +1,393 @@
+#include "TlsfAllocator.hpp"
+
+#include <bit>
+#include <algorithm>
+
+#include <assert.h>
+
+using namespace GalgameEngine;
+
+namespace
+{
+    constexpr uint32_t MantissaBits  = 3;
+    constexpr uint32_t MantissaValue = 1u << MantissaBits;
+    constexpr uint32_t MantissaMask  = MantissaValue - 1;
+
+    uint32_t highestBit(uint32_t value) noexcept
+    {
+        return 31 - static_cast<uint32_t>(std::countl_zero(value));
+    }
+
+    uint32_t lowestBit(uint32_t value) noexcept
+    {
+        return static_cast<uint32_t>(std::countr_zero(value));
+    }
+
+    // Lowest set bit at or after start, or 32 when there is none
+    uint32_t lowestBitFrom(uint32_t mask, uint32_t start) noexcept
+    {
+        mask = start < 32 ? mask & (~0u << start) : 0;
+        return mask != 0 ? lowestBit(mask) : 32;
+    }
+
+    // Size class of a size, rounding down gives the class a free block goes into,
+    // rounding up gives the first class whose blocks all fit the size
+    uint32_t toBinRoundDown(uint32_t size) noexcept
+    {
+        if (size < MantissaValue)
+            return size;
+        uint32_t shift = highestBit(size) - MantissaBits;
+        return ((shift + 1) << MantissaBits) + ((size >> shift) & MantissaMask);
+    }
+
+    uint32_t toBinRoundUp(uint32_t size) noexcept
+    {
+        if (size < MantissaValue)
+            return size;
+        uint32_t shift = highestBit(size) - MantissaBits;
+        uint32_t bin   = ((shift + 1) << MantissaBits) + ((size >> shift) & MantissaMask);
+        // Mantissa overflow carries into the exponent, which is the next class as well
+        if ((size & ((1u << shift) - 1)) != 0)
+            ++bin;
+        return bin;
+    }
+
+    // Smallest size in a class
+    uint64_t binSize(uint32_t bin) noexcept
+    {
+        uint32_t exponent = bin >> MantissaBits;
+        uint32_t mantissa = bin & MantissaMask;
+        if (exponent == 0)
+            return mantissa;
+        return static_cast<uint64_t>(mantissa | MantissaValue) << (exponent - 1);
+    }
+}
+
+TlsfAllocator::TlsfAllocator(uint64_t capacity, uint64_t granularity)
+    : m_granularity(granularity),
+      m_granularityShift(static_cast<uint32_t>(std::countr_zero(granularity))),
+      m_capacity(static_cast<uint32_t>(std::min<uint64_t>(capacity >> m_granularityShift, UINT32_MAX)))
+{
+    assert(granularity != 0 && (granularity & (granularity - 1)) == 0);
+    std::fill(std::begin(m_binHeads), std::end(m_binHeads), InvalidNode);
+
+    // The whole range starts as one free block
+    m_freeUnits = m_capacity;
+    if (m_capacity != 0)
+        insertFree(createNode(0, m_capacity));
+}
+
+TlsfAllocator::Allocation TlsfAllocator::allocate(uint64_t size, uint64_t alignment)
+{
+    assert(alignment != 0 && (alignment & (alignment - 1)) == 0);
+
+    // Alignment below granularity is always met, above it the block needs room to slide the start
+    uint64_t units      = std::max<uint64_t>((size + m_granularity - 1) >> m_granularityShift, 1);
+    uint64_t alignUnits = std::max<uint64_t>(alignment >> m_granularityShift, 1);
+    uint64_t needed     = units + alignUnits - 1;
+    if (needed > m_freeUnits)
+        return {};
+
+    // First class that fits at or after the rounded up class of the request
+    uint32_t minBin  = toBinRoundUp(static_cast<uint32_t>(needed));
+    uint32_t topBin  = minBin >> MantissaBits;
+    uint32_t leafBin = LeafBinCount;
+    if (topBin < TopBinCount && (m_usedTopBins >> topBin & 1))
+        leafBin = lowestBitFrom(m_usedLeafBins[topBin], minBin & MantissaMask);
+    if (leafBin >= LeafBinCount)
+    {
+        topBin = lowestBitFrom(m_usedTopBins, topBin + 1);
+        if (topBin >= TopBinCount)
+            return {};
+        leafBin = lowestBit(m_usedLeafBins[topBin]);
+    }
+
+    uint32_t node = m_binHeads[(topBin << MantissaBits) | leafBin];
+    removeFree(node);
+
+    // Give the alignment padding in front and the unused tail back
+    uint32_t padding = static_cast<uint32_t>((alignUnits - m_nodes[node].offset % alignUnits) % alignUnits);
+    if (padding != 0)
+        splitFront(node, padding);
+    if (m_nodes[node].size > units)
+        splitBack(node, static_cast<uint32_t>(units));
+
+    auto& allocated = m_nodes[node];
+    allocated.used = true;
+    m_freeUnits -= allocated.size;
+    ++m_allocationCount;
+
+    Allocation allocation;
+    allocation.offset = static_cast<uint64_t>(allocated.offset) << m_granularityShift;
+    allocation.size   = static_cast<uint64_t>(allocated.size) << m_granularityShift;
+    allocation.node   = node;
+    return allocation;
+}
+
+void TlsfAllocator::free(const Allocation& allocation)
+{
+    assert(allocation.node < m_nodes.size() && m_nodes[allocation.node].used && "Double free of allocation");
+
+    uint32_t node = allocation.node;
+    m_nodes[node].used = false;
+    m_freeUnits += m_nodes[node].size;
+    --m_allocationCount;
+
+    // Merge with free neighbours in address order, the node takes their range
+    uint32_t previous = m_nodes[node].addressPrevious;
+    if (previous != InvalidNode && !m_nodes[previous].used)
+    {
+        removeFree(previous);
+        m_nodes[node].offset  = m_nodes[previous].offset;
+        m_nodes[node].size   += m_nodes[previous].size;
+        m_nodes[node].addressPrevious = m_nodes[previous].addressPrevious;
+        if (m_nodes[node].addressPrevious != InvalidNode)
+            m_nodes[m_nodes[node].addressPrevious].addressNext = node;
+        destroyNode(previous);
+    }
+
+    uint32_t next = m_nodes[node].addressNext;
+    if (next != InvalidNode && !m_nodes[next].used)
+    {
+        removeFree(next);
+        m_nodes[node].size += m_nodes[next].size;
+        m_nodes[node].addressNext = m_nodes[next].addressNext;
+        if (m_nodes[node].addressNext != InvalidNode)
+            m_nodes[m_nodes[node].addressNext].addressPrevious = node;
+        destroyNode(next);
+    }
+
+    insertFree(node);
+}
+
+TlsfAllocator::Stats TlsfAllocator::getStats() const noexcept
+{
+    Stats stats;
+    stats.capacity    = getCapacity();
+    stats.usedBytes   = getUsed();
+    stats.freeBytes   = static_cast<uint64_t>(m_freeUnits) << m_granularityShift;
+    stats.allocations = m_allocationCount;
+    stats.freeBlocks  = m_freeBlockCount;
+    if (m_usedTopBins != 0)
+    {
+        uint32_t topBin = highestBit(m_usedTopBins);
+        uint32_t bin    = (topBin << MantissaBits) | highestBit(m_usedLeafBins[topBin]);
+        stats.largestFreeBlock = binSize(bin) << m_granularityShift;
+    }
+    return stats;
+}
+
+double TlsfAllocator::getFragmentation() const noexcept
+{
+    auto stats = getStats();
+    if (stats.freeBytes == 0)
+        return 0.0;
+    return 1.0 - static_cast<double>(stats.largestFreeBlock) / static_cast<double>(stats.freeBytes);
+}
+
+void TlsfAllocator::getAllocations(std::vector<Allocation>& allocations) const
+{
+    // Node at offset 0 starts the address chain
+    uint32_t node = InvalidNode;
+    for (uint32_t i = 0; i < m_nodes.size() && node == InvalidNode; ++i)
+    {
+        if (m_nodes[i].alive && m_nodes[i].addressPrevious == InvalidNode)
+            node = i;
+    }
+
+    for (; node != InvalidNode; node = m_nodes[node].addressNext)
+    {
+        if (!m_nodes[node].used)
+            continue;
+        Allocation allocation;
+        allocation.offset = static_cast<uint64_t>(m_nodes[node].offset) << m_granularityShift;
+        allocation.size   = static_cast<uint64_t>(m_nodes[node].size) << m_granularityShift;
+        allocation.node   = node;
+        allocations.push_back(allocation);
+    }
+}
+
+bool TlsfAllocator::validate() const
+{
+    // Address chain covers the range without gaps and never has two free blocks in a row
+    uint32_t aliveCount = 0;
+    uint32_t first      = InvalidNode;
+    for (uint32_t i = 0; i < m_nodes.size(); ++i)
+    {
+        if (!m_nodes[i].alive)
+            continue;
+        ++aliveCount;
+        if (m_nodes[i].addressPrevious == InvalidNode)
+        {
+            if (first != InvalidNode)
+                return false;
+            first = i;
+        }
+    }
+    if (m_capacity == 0)
+        return aliveCount == 0;
+    if (first == InvalidNode || m_nodes[first].offset != 0)
+        return false;
+
+    uint32_t offset = 0, freeUnits = 0, freeBlocks = 0, allocations = 0, chainCount = 0;
+    bool     previousFree = false;
+    for (uint32_t node = first; node != InvalidNode; node = m_nodes[node].addressNext)
+    {
+        auto& current = m_nodes[node];
+        if (current.offset != offset || current.size == 0)
+            return false;
+        if (current.addressNext != InvalidNode && m_nodes[current.addressNext].addressPrevious != node)
+            return false;
+        if (!current.used && previousFree)
+            return false;
+
+        if (current.used)
+        {
+            ++allocations;
+        }
+        else
+        {
+            freeUnits += current.size;
+            ++freeBlocks;
+        }
+        previousFree = !current.used;
+        offset      += current.size;
+        ++chainCount;
+    }
+    if (offset != m_capacity || chainCount != aliveCount)
+        return false;
+    if (freeUnits != m_freeUnits || freeBlocks != m_freeBlockCount || allocations != m_allocationCount)
+        return false;
+
+    // Every free block is in the list of its class and the bitmasks match non-empty lists
+    uint32_t listed = 0;
+    for (uint32_t bin = 0; bin < BinCount; ++bin)
+    {
+        uint32_t topBin  = bin >> MantissaBits;
+        bool     leafSet = m_usedLeafBins[topBin] >> (bin & MantissaMask) & 1;
+        if (leafSet != (m_binHeads[bin] != InvalidNode))
+            return false;
+
+        uint32_t previous = InvalidNode;
+        for (uint32_t node = m_binHeads[bin]; node != InvalidNode; node = m_nodes[node].binNext)
+        {
+            auto& current = m_nodes[node];
+            if (current.used || current.binPrevious != previous || toBinRoundDown(current.size) != bin)
+                return false;
+            previous = node;
+            ++listed;
+        }
+    }
+    for (uint32_t topBin = 0; topBin < TopBinCount; ++topBin)
+    {
+        if ((m_usedTopBins >> topBin & 1) != (m_usedLeafBins[topBin] != 0))
+            return false;
+    }
+    return listed == m_freeBlockCount;
+}
+
+uint32_t TlsfAllocator::createNode(uint32_t offset, uint32_t size)
+{
+    uint32_t node;
+    if (!m_freeNodes.empty())
+    {
+        node = m_freeNodes.back();
+        m_freeNodes.pop_back();
+    }
+    else
+    {
+        node = static_cast<uint32_t>(m_nodes.size());
+        m_nodes.emplace_back();
+    }
+
+    auto& created = m_nodes[node];
+    created        = Node();
+    created.offset = offset;
+    created.size   = size;
+    created.alive  = true;
+    return node;
+}
+
+void TlsfAllocator::destroyNode(uint32_t node)
+{
+    m_nodes[node].alive = false;
+    m_freeNodes.push_back(node);
+}
+
+void TlsfAllocator::insertFree(uint32_t node)
+{
+    uint32_t bin     = toBinRoundDown(m_nodes[node].size);
+    uint32_t topBin  = bin >> MantissaBits;
+    uint32_t leafBin = bin & MantissaMask;
+
+    // Push in front of the class list
+    auto& inserted = m_nodes[node];
+    inserted.binPrevious = InvalidNode;
+    inserted.binNext     = m_binHeads[bin];
+    if (inserted.binNext != InvalidNode)
+        m_nodes[inserted.binNext].binPrevious = node;
+    m_binHeads[bin] = node;
+
+    m_usedTopBins          |= 1u << topBin;
+    m_usedLeafBins[topBin] |= static_cast<uint8_t>(1u << leafBin);
+    ++m_freeBlockCount;
+}
+
+void TlsfAllocator::removeFree(uint32_t node)
+{
+    auto& removed = m_nodes[node];
+    if (removed.binPrevious != InvalidNode)
+    {
+        m_nodes[removed.binPrevious].binNext = removed.binNext;
+    }
+    else
+    {
+        // Head of its class, the class may become empty
+        uint32_t bin     = toBinRoundDown(removed.size);
+        uint32_t topBin  = bin >> MantissaBits;
+        uint32_t leafBin = bin & MantissaMask;
+        m_binHeads[bin] = removed.binNext;
+        if (removed.binNext == InvalidNode)
+        {
+            m_usedLeafBins[topBin] &= static_cast<uint8_t>(~(1u << leafBin));
+            if (m_usedLeafBins[topBin] == 0)
+                m_usedTopBins &= ~(1u << topBin);
+        }
+    }
+    if (removed.binNext != InvalidNode)
+        m_nodes[removed.binNext].binPrevious = removed.binPrevious;
+
+    removed.binPrevious = InvalidNode;
+    removed.binNext     = InvalidNode;
+    --m_freeBlockCount;
+}
+
+void TlsfAllocator::splitFront(uint32_t node, uint32_t size)
+{
+    uint32_t front = createNode(m_nodes[node].offset, size);
+    auto&    split = m_nodes[node];
+    split.offset += size;
+    split.size   -= size;
+
+    // Front node goes between the node and its previous neighbour
+    m_nodes[front].addressPrevious = split.addressPrevious;
+    m_nodes[front].addressNext     = node;
+    if (split.addressPrevious != InvalidNode)
+        m_nodes[split.addressPrevious].addressNext = front;
+    split.addressPrevious = front;
+    insertFree(front);
+}
+
+void TlsfAllocator::splitBack(uint32_t node, uint32_t size)
+{
+    uint32_t back  = createNode(m_nodes[node].offset + size, m_nodes[node].size - size);
+    auto&    split = m_nodes[node];
+    split.size = size;
+
+    m_nodes[back].addressPrevious = node;
+    m_nodes[back].addressNext     = split.addressNext;
+    if (split.addressNext != InvalidNode)
+        m_nodes[split.addressNext].addressPrevious = back;
+    split.addressNext = back;
+    insertFree(back);
+}
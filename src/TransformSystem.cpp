@@ -0,0 +1,44 @@
+#include "TransformSystem.hpp"
+#include "Profiler.hpp"
+
+#include <atomic>
+
+using namespace GalgameEngine;
+
+void TransformSystem::update(EntityStore& store, JobSystem* jobSystem)
+{
+    PROFILE_SCOPE("TransformSystem::update");
+
+    EntityStore::Query query;
+    query.all          = makeComponentMask<Position, Rotation, LocalToWorld>();
+    query.changed      = makeComponentMask<Position, Rotation, Scale>();
+    query.changedAfter = m_lastVersion;
+
+    std::atomic<uint64_t> chunks   = 0;
+    std::atomic<uint64_t> entities = 0;
+    auto compose = [&chunks, &entities](EntityStore::ChunkView& chunk)
+    {
+        auto count    = chunk.getCount();
+        auto position = chunk.read<Position>();
+        auto rotation = chunk.read<Rotation>();
+        auto scale    = chunk.read<Scale>();
+        auto world    = chunk.write<LocalToWorld>();
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            auto s = scale != nullptr ? scale[i].value : Vec3{ 1.f, 1.f, 1.f };
+            world[i].value = Mat4::fromTransform(position[i].value, rotation[i].value, s);
+        }
+        chunks.fetch_add(1, std::memory_order_relaxed);
+        entities.fetch_add(count, std::memory_order_relaxed);
+    };
+
+    if (jobSystem != nullptr)
+        store.parallelForEachChunk(*jobSystem, query, compose);
+    else
+        store.forEachChunk(query, compose);
+
+    // Writes from here on are newer than the version this update has seen
+    m_lastVersion    = store.nextVersion();
+    m_stats.chunks   = chunks.load(std::memory_order_relaxed);
+    m_stats.entities = entities.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,90 @@
+#include "UploadRing.hpp"
+
+using namespace GalgameEngine;
+
+UploadRing::UploadRing(Device& device, uint64_t capacity)
+    : m_device(device), m_queue(device.getQueue()), m_ring(capacity)
+{
+    BufferDesc desc = {};
+    desc.size     = capacity;
+    desc.heapType = HeapType::Upload;
+    m_buffer = m_device.createBuffer(desc, ResourceState::GenericRead);
+}
+
+UploadRing::Allocation UploadRing::allocate(uint64_t size, uint64_t alignment)
+{
+    auto offset = m_ring.allocate(size, alignment);
+    if (offset == RingAllocator::InvalidOffset)
+    {
+        // GPU may have finished more frames since the last reclaim
+        m_ring.reclaim(m_queue.getCompletedValue());
+        offset = m_ring.allocate(size, alignment);
+    }
+    if (offset == RingAllocator::InvalidOffset)
+        return allocateOverflow(size, alignment);
+
+    Allocation allocation;
+    allocation.cpuAddress = m_buffer->getMappedData() + offset;
+    allocation.gpuAddress = m_buffer->getGpuAddress() + offset;
+    allocation.buffer     = m_buffer.get();
+    allocation.offset     = offset;
+    allocation.size       = size;
+    return allocation;
+}
+
+void UploadRing::finishFrame(uint64_t fenceValue)
+{
+    m_ring.finishFrame(fenceValue);
+    for (auto& buffer : m_overflows)
+        m_retired.push_back({ std::move(buffer), fenceValue });
+    m_overflows.clear();
+
+    auto completedValue = m_queue.getCompletedValue();
+    m_ring.reclaim(completedValue);
+    releaseRetired(completedValue);
+}
+
+UploadRing::Stats UploadRing::getStats() const noexcept
+{
+    Stats stats;
+    stats.ring          = m_ring.getStats();
+    stats.overflowCount = m_overflowCount;
+    stats.overflowBytes = m_overflowBytes;
+    return stats;
+}
+
+void UploadRing::resetStats() noexcept
+{
+    m_ring.resetStats();
+    m_overflowCount = 0;
+    m_overflowBytes = 0;
+}
+
+UploadRing::Allocation UploadRing::allocateOverflow(uint64_t size, uint64_t alignment)
+{
+    // Buffers are at least 64KB aligned, pad the size so bigger alignment can still be met
+    BufferDesc desc = {};
+    desc.size     = size + (alignment > 65536 ? alignment : 0);
+    desc.heapType = HeapType::Upload;
+    auto buffer = m_device.createBuffer(desc, ResourceState::GenericRead);
+
+    auto offset = ((buffer->getGpuAddress() + alignment - 1) & ~(alignment - 1)) - buffer->getGpuAddress();
+
+    Allocation allocation;
+    allocation.cpuAddress = buffer->getMappedData() + offset;
+    allocation.gpuAddress = buffer->getGpuAddress() + offset;
+    allocation.buffer     = buffer.get();
+    allocation.offset     = offset;
+    allocation.size       = size;
+
+    ++m_overflowCount;
+    m_overflowBytes += size;
+    m_overflows.push_back(std::move(buffer));
+    return allocation;
+}
+
+void UploadRing::releaseRetired(uint64_t completedValue)
+{
+    while (!m_retired.empty() && m_retired.front().fenceValue <= completedValue)
+        m_retired.pop_front();
+}
@@ -0,0 +1,675 @@
+#include "Timer.hpp"
+#include "Profiler.hpp"
+#include "Renderer.hpp"
+#include "JobSystem.hpp"
+#include "FramePacer.hpp"
+#include "NullDevice.hpp"
+#include "CaptureDevice.hpp"
+#include "TransformSystem.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <vector>
+#include <algorithm>
+#include <filesystem>
+
+using namespace GalgameEngine;
+
+namespace
+{
+    // Binary PPM of the RGB channels of the top left width x height pixels, every image viewer reads it
+    bool writeImage(const char* path, NullTexture& texture, uint32_t width, uint32_t height)
+    {
+        auto pixels = static_cast<const uint8_t*>(texture.getPixels());
+        if (pixels == nullptr)
+            return false;
+
+        width  = std::min(width, texture.getDesc().width);
+        height = std::min(height, texture.getDesc().height);
+        std::vector<uint8_t> rgb(static_cast<size_t>(width) * height * 3);
+        for (uint32_t y = 0; y < height; ++y)
+        {
+            auto row = pixels + static_cast<size_t>(y) * texture.getRowPitch() * 4;
+            for (uint32_t x = 0; x < width; ++x)
+                std::memcpy(&rgb[(static_cast<size_t>(y) * width + x) * 3], row + x * 4, 3);
+        }
+
+        std::ofstream file(path, std::ios::binary);
+        file << "P6\n" << width << " " << height << "\n255\n";
+        file.write(reinterpret_cast<const char*>(rgb.data()), static_cast<std::streamsize>(rgb.size()));
+        return static_cast<bool>(file);
+    }
+}
+
+/*
+* Drive the frame loop on the null backend without window and GPU
+* Use for tracking CPU side frame cost on CI
+*
+* Usage: DX12Headless [--frames N] [--frame-count N] [--width N] [--height N] [--command-cost-us N]
+*                     [--threads N] [--drag N] [--fps N] [--latency N] [--trace trace.json]
+*                     [--pipelines N] [--pipeline-cost-us N] [--pipeline-cache library.bin]
+*                     [--stream N] [--copy-mbps N] [--residency N] [--budget-mb N]
+*                     [--entities N] [--moving N] [--meshes N] [--materials N] [--indirect 0|1]
+*                     [--capture capture.gcap] [--raster 0|1] [--image image.ppm]
+*
+* --threads records the frame with a job system of N threads, 0 records on the main thread
+* --drag sends N resize events before every frame, like dragging a window border
+* --fps paces frames to N per second on a simulated clock which advances by the measured CPU time of each frame,
+*       so pacing jitter shows without a display. --latency N also waits until fewer than N presents are queued
+* --pipelines requests N pipeline variants before the first frame, each costs --pipeline-cost-us to compile
+*             and falls back to the first one until ready. With --pipeline-cache the second run starts warm
+* --stream streams N buffers of 256 KB from a temporary file through the asset streamer while frames run,
+*          their priorities change every frame. --copy-mbps limits the simulated copy queue bandwidth
+* --residency creates N buffers of 48 MB, each frame uses a window of 8 of them which slides through all,
+*             --budget-mb is the simulated video memory budget the residency manager keeps them in
+* --entities creates a scene of N entities with transforms, --moving N percent of them move every frame.
+*            Their matrices are recomposed and uploaded as instance data, the others cost nothing per frame
+* --meshes draws every entity of the scene with one of N meshes sharing a buffer and one of --materials materials,
+*          half of the materials use a second pipeline. --indirect records the batches as indirect draws
+* --capture records every device call of the run into a file DX12Replay plays back
+* --raster draws the scene on the software rasterizer of the null device, with boxes of real geometry and a camera
+*          looking over the grid. --image writes the last presented frame of it, without --capture
+*/
+int main(int argc, char** argv)
+{
+    uint32_t    frames         = 1000;
+    uint32_t    frameCount     = 3;
+    uint32_t    width          = 800;
+    uint32_t    height         = 600;
+    uint32_t    commandCostUs  = 0;
+    uint32_t    threads        = 0;
+    uint32_t    drag           = 0;
+    uint32_t    fps            = 0;
+    uint32_t    latency        = 0;
+    uint32_t    pipelines      = 0;
+    uint32_t    pipelineCostUs = 0;
+    uint32_t    streams        = 0;
+    uint32_t    copyMbps       = 0;
+    uint32_t    residency      = 0;
+    uint32_t    budgetMb       = 0;
+    uint32_t    entities       = 0;
+    uint32_t    moving         = 10;
+    uint32_t    meshes         = 0;
+    uint32_t    materials      = 8;
+    uint32_t    indirect       = 0;
+    uint32_t    raster         = 0;
+    const char* tracePath      = nullptr;
+    const char* pipelinePath   = nullptr;
+    const char* capturePath    = nullptr;
+    const char* imagePath      = nullptr;
+
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        if (std::strcmp(argv[i], "--trace") == 0)
+        {
+            tracePath = argv[i + 1];
+            continue;
+        }
+        if (std::strcmp(argv[i], "--pipeline-cache") == 0)
+        {
+            pipelinePath = argv[i + 1];
+            continue;
+        }
+        if (std::strcmp(argv[i], "--capture") == 0)
+        {
+            capturePath = argv[i + 1];
+            continue;
+        }
+        if (std::strcmp(argv[i], "--image") == 0)
+        {
+            imagePath = argv[i + 1];
+            continue;
+        }
+
+        auto value = static_cast<uint32_t>(std::strtoul(argv[i + 1], nullptr, 10));
+        if      (std::strcmp(argv[i], "--frames") == 0)           frames         = value;
+        else if (std::strcmp(argv[i], "--frame-count") == 0)      frameCount     = value;
+        else if (std::strcmp(argv[i], "--width") == 0)            width          = value;
+        else if (std::strcmp(argv[i], "--height") == 0)           height         = value;
+        else if (std::strcmp(argv[i], "--command-cost-us") == 0)  commandCostUs  = value;
+        else if (std::strcmp(argv[i], "--threads") == 0)          threads        = value;
+        else if (std::strcmp(argv[i], "--drag") == 0)             drag           = value;
+        else if (std::strcmp(argv[i], "--fps") == 0)              fps            = value;
+        else if (std::strcmp(argv[i], "--latency") == 0)          latency        = value;
+        else if (std::strcmp(argv[i], "--pipelines") == 0)        pipelines      = value;
+        else if (std::strcmp(argv[i], "--pipeline-cost-us") == 0) pipelineCostUs = value;
+        else if (std::strcmp(argv[i], "--stream") == 0)           streams        = value;
+        else if (std::strcmp(argv[i], "--copy-mbps") == 0)        copyMbps       = value;
+        else if (std::strcmp(argv[i], "--residency") == 0)        residency      = value;
+        else if (std::strcmp(argv[i], "--budget-mb") == 0)        budgetMb       = value;
+        else if (std::strcmp(argv[i], "--entities") == 0)         entities       = value;
+        else if (std::strcmp(argv[i], "--moving") == 0)           moving         = value;
+        else if (std::strcmp(argv[i], "--meshes") == 0)           meshes         = value;
+        else if (std::strcmp(argv[i], "--materials") == 0)        materials      = value;
+        else if (std::strcmp(argv[i], "--indirect") == 0)         indirect       = value;
+        else if (std::strcmp(argv[i], "--raster") == 0)           raster         = value;
+        else
+        {
+            std::fprintf(stderr, "unknown option %s\n", argv[i]);
+            return 2;
+        }
+    }
+
+    if (tracePath != nullptr)
+    {
+        Profiler::setThreadName("Main");
+        Profiler::setEnabled(true);
+    }
+
+    NullDevice::Config deviceConfig;
+    deviceConfig.commandCost         = std::chrono::microseconds(commandCostUs);
+    deviceConfig.pipelineCompileCost = std::chrono::microseconds(pipelineCostUs);
+    deviceConfig.copyBandwidth       = static_cast<uint64_t>(copyMbps) << 20;
+    deviceConfig.memoryBudget        = static_cast<uint64_t>(budgetMb) << 20;
+    deviceConfig.rasterize           = raster != 0;
+    {
+        // Grid rows are 1000 entities wide, the camera looks along the first ones from above their corner
+        float depth  = static_cast<float>(std::min((entities + 999) / 1000, 40u));
+        auto  view   = Mat4::lookAt({ -10.f, 25.f, -15.f }, { 40.f, 0.f, depth / 2.f }, { 0.f, 1.f, 0.f });
+        auto  aspect = static_cast<float>(width) / static_cast<float>(std::max(height, 1u));
+        deviceConfig.viewProjection = view * Mat4::perspectiveFov(1.f, aspect, 1.f, 5000.f);
+    }
+    NullDevice device(deviceConfig);
+
+    // Frames render through the capture, stats and validation are still read from the null device below it
+    std::unique_ptr<CaptureDevice> capture;
+    if (capturePath != nullptr)
+        capture = std::make_unique<CaptureDevice>(device, capturePath);
+    Device& renderDevice = capture ? static_cast<Device&>(*capture) : device;
+
+    std::unique_ptr<JobSystem> jobSystem;
+    if (threads > 0)
+        jobSystem = std::make_unique<JobSystem>(threads);
+
+    using Clock = std::chrono::steady_clock;
+    double cpuSeconds = 0.0;
+    auto   begin      = Clock::now();
+
+    // Window covers all frames, so percentiles are over the whole run
+    FrameHistogram cpuHistogram(frames);
+    ResourceStateTracker::Stats barrierStats;
+    RenderGraph::Stats          graphStats;
+    MemoryAllocator::Stats      memoryStats;
+    ResizeManager::Stats        resizeStats;
+    TimelineSync::Stats         syncStats;
+    PipelineCache::Stats        pipelineStats;
+    AssetStreamer::Stats        streamStats;
+    ResidencyManager::Stats     residencyStats;
+    GpuProfiler::Stats          gpuProfilerStats;
+    size_t                      gpuMarkers = 0;
+    EntityStore::Stats          sceneStats;
+    uint64_t                    sceneTransforms = 0;
+    uint64_t                    sceneInstances  = 0;
+    uint64_t                    sceneCopies     = 0;
+    DrawQueue::Stats            drawQueueStats;
+    DrawQueue::RecordStats      drawStats;
+    uint64_t                    drawBatches     = 0;
+    IoQueue::Backend            streamBackend = IoQueue::Backend::Threads;
+    uint32_t                    streamsReadyFrame = 0;
+    auto                        streamPath = std::filesystem::temp_directory_path() / "dx12_headless_stream.bin";
+    uint64_t                    retiredFrames = 0;
+    uint32_t                    pipelinesReadyFrame = 0;
+
+    SimulatedFrameClock clock({});
+    FramePacer::Config  pacerConfig;
+    pacerConfig.mode      = latency > 0 ? FramePacer::Mode::LatencyTarget : fps > 0 ? FramePacer::Mode::TargetFps : FramePacer::Mode::Unlimited;
+    pacerConfig.targetFps = fps;
+    FramePacer pacer(clock, pacerConfig);
+    {
+        Renderer::Config rendererConfig;
+        rendererConfig.width           = width;
+        rendererConfig.height          = height;
+        rendererConfig.frameCount      = frameCount;
+        rendererConfig.jobSystem       = jobSystem.get();
+        rendererConfig.maxFrameLatency = latency;
+        rendererConfig.drawQueue.indirect = indirect != 0;
+        if (pipelinePath != nullptr)
+            rendererConfig.pipelineLibraryPath = pipelinePath;
+        Renderer renderer(renderDevice, rendererConfig);
+
+        // Material variants differ in shader bytes, all share one root signature
+        auto& pipelineCache = renderer.getPipelineCache();
+        std::vector<PipelineId> pipelineIds;
+        if (pipelines > 0)
+        {
+            RootSignatureDesc rootDesc;
+            rootDesc.parameters.push_back({ RootParameterType::ConstantBuffer });
+            rootDesc.parameters.push_back({ RootParameterType::DescriptorTable, ShaderVisibility::Pixel, DescriptorRangeType::ShaderResource, 0, 0, 4 });
+
+            GraphicsPipelineDesc pipelineDesc;
+            pipelineDesc.rootSignature = &pipelineCache.getRootSignature(rootDesc);
+            pipelineDesc.inputLayout   = { { "POSITION", 0, Format::R32G32B32_FLOAT, 0, 0 }, { "TEXCOORD", 0, Format::R32G32_FLOAT, 0, 12 } };
+            for (uint32_t variant = 0; variant < pipelines; ++variant)
+            {
+                pipelineDesc.vertexShader.assign(256, static_cast<uint8_t>(variant));
+                pipelineDesc.pixelShader.assign(512, static_cast<uint8_t>(variant >> 8));
+                pipelineIds.push_back(pipelineCache.requestPipeline(pipelineDesc, variant > 0 ? pipelineIds[0] : InvalidPipeline));
+            }
+        }
+
+        // Blocks of one file stream into buffers of their own, like the meshes of a scene being loaded
+        constexpr uint64_t StreamBlockSize  = 256 << 10;
+        constexpr uint32_t StreamBlockCount = 64;
+        auto&              streamer         = renderer.getAssetStreamer();
+        std::vector<std::unique_ptr<Buffer>> streamBuffers;
+        std::vector<StreamId>                streamIds;
+        if (streams > 0)
+        {
+            {
+                std::vector<char> block(StreamBlockSize);
+                std::ofstream     file(streamPath, std::ios::binary | std::ios::trunc);
+                for (uint32_t i = 0; i < StreamBlockCount; ++i)
+                {
+                    std::memset(block.data(), static_cast<int>(i), block.size());
+                    file.write(block.data(), static_cast<std::streamsize>(block.size()));
+                }
+            }
+
+            auto streamFile = streamer.openFile(streamPath.string());
+            BufferDesc bufferDesc;
+            bufferDesc.size = StreamBlockSize;
+            for (uint32_t i = 0; i < streams; ++i)
+            {
+                streamBuffers.push_back(renderDevice.createBuffer(bufferDesc, ResourceState::Common));
+
+                StreamRequest request;
+                request.file     = streamFile;
+                request.offset   = (i % StreamBlockCount) * StreamBlockSize;
+                request.size     = StreamBlockSize;
+                request.buffer   = streamBuffers.back().get();
+                request.priority = static_cast<float>(i % 7);
+                streamIds.push_back(streamer.request(std::move(request)));
+            }
+        }
+
+        // Larger than half a heap block, so every buffer is a heap of its own
+        constexpr uint32_t ResidencyWindow = 8;
+        std::vector<std::unique_ptr<Buffer>> residencyBuffers;
+        BufferDesc                           residencyDesc;
+        residencyDesc.size = 48ull << 20;
+        for (uint32_t i = 0; i < residency; ++i)
+            residencyBuffers.push_back(renderDevice.createBuffer(residencyDesc, ResourceState::Common));
+
+        // Entities spread over a grid, the first ones are the moving ones
+        EntityStore     scene;
+        TransformSystem transforms;
+        if (entities > 0)
+        {
+            std::vector<Entity> created(entities);
+            scene.create(makeComponentMask<Position, Rotation, Scale, LocalToWorld>(), entities, created.data());
+            EntityStore::Query query;
+            query.all = makeComponentMask<Position, Rotation, Scale>();
+            scene.forEachChunk(query,
+                [](EntityStore::ChunkView& chunk)
+                {
+                    auto ids      = chunk.getEntities();
+                    auto position = chunk.write<Position>();
+                    auto rotation = chunk.write<Rotation>();
+                    auto scale    = chunk.write<Scale>();
+                    for (uint32_t e = 0; e < chunk.getCount(); ++e)
+                    {
+                        auto index = ids[e].index;
+                        position[e].value = { static_cast<float>(index % 1000), 0.f, static_cast<float>(index / 1000) };
+                        rotation[e].value = Quat::fromAxisAngle({ 0.f, 1.f, 0.f }, static_cast<float>(index));
+                        scale[e].value    = { 1.f, 1.f, 1.f };
+                    }
+                });
+            renderer.setScene(&scene);
+        }
+        auto movingCount = static_cast<uint32_t>(static_cast<uint64_t>(entities) * moving / 100);
+
+        // Boxes of 24 vertices and 36 indices one after another in one buffer, material constants in another
+        constexpr uint32_t BoxVertices  = 24;
+        constexpr uint32_t BoxIndices   = 36;
+        constexpr uint32_t VertexStride = 20;
+        auto&                   drawQueue = renderer.getDrawQueue();
+        std::unique_ptr<Buffer> geometryBuffer;
+        std::unique_ptr<Buffer> materialBuffer;
+        PipelineId              drawPipelines[2] = { InvalidPipeline, InvalidPipeline };
+        materials = std::max(materials, 1u);
+        if (entities > 0 && meshes > 0)
+        {
+            BufferDesc geometryDesc;
+            uint32_t   vertexBytes = meshes * BoxVertices * VertexStride;
+            uint32_t   indexBytes  = meshes * BoxIndices * sizeof(uint16_t);
+            geometryDesc.size     = vertexBytes + indexBytes;
+            geometryDesc.heapType = HeapType::Upload;
+            geometryBuffer = renderDevice.createBuffer(geometryDesc, ResourceState::GenericRead);
+
+            // Position and texture coordinate, each mesh is a little larger than the one before
+            auto vertexData = geometryBuffer->getMappedData();
+            auto indexData  = reinterpret_cast<uint16_t*>(vertexData + vertexBytes);
+            for (uint32_t mesh = 0; mesh < meshes; ++mesh)
+            {
+                float halfSize = 0.3f + 0.02f * static_cast<float>(mesh);
+                for (uint32_t face = 0; face < 6; ++face)
+                {
+                    // Corners clockwise seen from outside, the front face winding of the pipelines
+                    float sign    = face % 2 == 0 ? 1.f : -1.f;
+                    Vec3  normal  = face / 2 == 0 ? Vec3{ sign, 0.f, 0.f } : face / 2 == 1 ? Vec3{ 0.f, sign, 0.f } : Vec3{ 0.f, 0.f, sign };
+                    Vec3  tangent = face / 2 == 0 ? Vec3{ 0.f, 0.f, 1.f } : Vec3{ 1.f, 0.f, 0.f };
+                    Vec3  bitangent = cross(-normal, tangent);
+                    Vec3  corners[4] = { normal - tangent - bitangent, normal - tangent + bitangent,
+                                         normal + tangent + bitangent, normal + tangent - bitangent };
+                    for (uint32_t corner = 0; corner < 4; ++corner)
+                    {
+                        float vertex[5] = { corners[corner].x * halfSize, corners[corner].y * halfSize, corners[corner].z * halfSize,
+                                            static_cast<float>(corner / 2), static_cast<float>((corner + 1) / 2 % 2) };
+                        std::memcpy(vertexData + ((mesh * 6 + face) * 4 + corner) * VertexStride, vertex, VertexStride);
+                    }
+                    uint16_t first     = static_cast<uint16_t>(face * 4);
+                    uint16_t indices[] = { first, static_cast<uint16_t>(first + 1), static_cast<uint16_t>(first + 2),
+                                           first, static_cast<uint16_t>(first + 2), static_cast<uint16_t>(first + 3) };
+                    std::memcpy(indexData + (mesh * 6 + face) * 6, indices, sizeof(indices));
+                }
+            }
+            for (uint32_t mesh = 0; mesh < meshes; ++mesh)
+            {
+                DrawMesh drawMesh;
+                drawMesh.vertices   = { geometryBuffer.get(), 0, vertexBytes, VertexStride };
+                drawMesh.indices    = { geometryBuffer.get(), vertexBytes, indexBytes, Format::R16_UINT };
+                drawMesh.indexCount = BoxIndices;
+                drawMesh.startIndex = mesh * BoxIndices;
+                drawMesh.baseVertex = static_cast<int32_t>(mesh * BoxVertices);
+                drawQueue.addMesh(drawMesh);
+            }
+
+            BufferDesc materialDesc;
+            materialDesc.size     = materials * UploadRing::ConstantAlignment;
+            materialDesc.heapType = HeapType::Upload;
+            materialBuffer = renderDevice.createBuffer(materialDesc, ResourceState::GenericRead);
+            for (uint32_t material = 0; material < materials; ++material)
+            {
+                // Color in the first float4 of the constants
+                float color[4] = { 0.35f + 0.6f * static_cast<float>(material * 5 % 8) / 7.f,
+                                   0.35f + 0.6f * static_cast<float>((material * 3 + 2) % 8) / 7.f,
+                                   0.35f + 0.6f * static_cast<float>((material * 7 + 5) % 8) / 7.f, 1.f };
+                std::memcpy(materialBuffer->getMappedData() + material * UploadRing::ConstantAlignment, color, sizeof(color));
+                drawQueue.addMaterial(materialBuffer->getGpuAddress() + material * UploadRing::ConstantAlignment);
+            }
+
+            GraphicsPipelineDesc pipelineDesc;
+            pipelineDesc.rootSignature = &renderer.getSceneRootSignature();
+            pipelineDesc.inputLayout   = { { "POSITION", 0, Format::R32G32B32_FLOAT, 0, 0 }, { "TEXCOORD", 0, Format::R32G32_FLOAT, 0, 12 },
+                                           DrawQueue::getInstanceElement() };
+            for (uint32_t variant = 0; variant < 2; ++variant)
+            {
+                pipelineDesc.vertexShader.assign(256, static_cast<uint8_t>(0xD0 + variant));
+                pipelineDesc.pixelShader.assign(512, static_cast<uint8_t>(0xD0 + variant));
+                drawPipelines[variant] = pipelineCache.requestPipeline(pipelineDesc);
+            }
+        }
+
+        for (uint32_t i = 0; i < frames; ++i)
+        {
+            pacer.waitForNextFrame(&renderer.getSwapChain());
+            auto frameBegin = Timer::now();
+
+            // Border goes out and back in a few pixels per event, sometimes past a capacity bucket
+            for (uint32_t event = 0; event < drag; ++event)
+            {
+                uint32_t step = (i * drag + event) % 400;
+                uint32_t grow = step < 200 ? step : 400 - step;
+                renderer.resize(width + grow * 3, height + grow * 2);
+            }
+            // Scene data near the camera, the window moves on by one buffer every 4 frames
+            for (uint32_t buffer = 0; buffer < ResidencyWindow && buffer < residency; ++buffer)
+                renderer.getResidencyManager().use(*residencyBuffers[(i / 4 + buffer) % residency]);
+
+            // Camera moved, what is close now matters more
+            for (uint32_t request = i % 8; request < streams; request += 8)
+                streamer.setPriority(streamIds[request], static_cast<float>((request + i) % 11));
+
+            if (entities > 0)
+            {
+                EntityStore::Query query;
+                query.all = makeComponentMask<Position>();
+                float offset = static_cast<float>(i % 2 == 0 ? 1 : -1);
+                auto  move   = [movingCount, offset](EntityStore::ChunkView& chunk)
+                {
+                    auto ids = chunk.getEntities();
+                    if (ids[0].index >= movingCount)
+                        return;
+                    auto position = chunk.write<Position>();
+                    for (uint32_t e = 0; e < chunk.getCount(); ++e)
+                        position[e].value.y += ids[e].index < movingCount ? offset : 0.f;
+                };
+                if (jobSystem)
+                    scene.parallelForEachChunk(*jobSystem, query, move);
+                else
+                    scene.forEachChunk(query, move);
+                transforms.update(scene, jobSystem.get());
+                sceneTransforms += transforms.getStats().entities;
+            }
+            if (geometryBuffer)
+            {
+                // Every entity every frame, from the thread of its chunk
+                EntityStore::Query query;
+                query.all = makeComponentMask<Position>();
+                auto submit = [&drawQueue, &drawPipelines, &jobSystem, meshes, materials](EntityStore::ChunkView& chunk)
+                {
+                    auto lane     = jobSystem ? jobSystem->getThreadIndex() : 0;
+                    auto ids      = chunk.getEntities();
+                    auto position = chunk.read<Position>();
+                    for (uint32_t e = 0; e < chunk.getCount(); ++e)
+                    {
+                        auto index    = ids[e].index;
+                        auto material = index % materials;
+                        auto key      = DrawKey::make(Renderer::ScenePass, drawPipelines[material % 2], material, index % meshes,
+                                                      DrawKey::quantizeDepth(position[e].value.z / 1000.f));
+                        drawQueue.submit(lane, key, index);
+                    }
+                };
+                if (jobSystem)
+                    scene.parallelForEachChunk(*jobSystem, query, submit);
+                else
+                    scene.forEachChunk(query, submit);
+            }
+            renderer.render();
+            drawBatches += drawQueue.getStats().batches;
+            drawStats   += renderer.getDrawStats();
+            sceneInstances += renderer.getInstanceUploader().getStats().instances;
+            sceneCopies    += renderer.getInstanceUploader().getStats().copies;
+
+            if (streams > 0 && streamsReadyFrame == 0 && streamer.getStats().completed == streams)
+                streamsReadyFrame = i + 1;
+
+            // Draws would look their pipeline up every frame, the first frame with all of them ready ends the warm up
+            uint32_t readyPipelines = 0;
+            for (auto id : pipelineIds)
+                readyPipelines += pipelineCache.getPipeline(id) != nullptr && pipelineCache.isReady(id);
+            if (pipelines > 0 && readyPipelines == pipelines && pipelinesReadyFrame == 0)
+                pipelinesReadyFrame = i + 1;
+
+            // Count frames GPU has finished through the timeline instead of polling the fence
+            FencePoint frameEnd = { &renderDevice.getQueue(), device.getNullQueue().getNextValue() - 1 };
+            renderer.getTimelineSync().onCompleted(frameEnd, [&retiredFrames]() { ++retiredFrames; });
+
+            double seconds = (Timer::now() - frameBegin) * Timer::getSecondsPerCount();
+            cpuHistogram.record(seconds);
+            cpuSeconds += seconds;
+            clock.advance(seconds);
+        }
+        renderer.flush();
+        if (imagePath != nullptr)
+        {
+            // Present moved on to the next back buffer, the frame is its source region
+            auto swapChain = dynamic_cast<NullSwapChain*>(&renderer.getSwapChain());
+            auto count     = swapChain != nullptr ? swapChain->getBufferCount() : 0;
+            auto image     = count > 0 ? dynamic_cast<NullTexture*>(&swapChain->getBackBuffer((swapChain->getCurrentBackBufferIndex() + count - 1) % count)) : nullptr;
+            if (image == nullptr || !writeImage(imagePath, *image, swapChain->getSourceWidth(), swapChain->getSourceHeight()))
+                std::fprintf(stderr, "failed to write image %s, it needs --raster 1 and no --capture\n", imagePath);
+        }
+        barrierStats = renderer.getBarrierStats();
+        graphStats   = renderer.getRenderGraph().getStats();
+        memoryStats  = device.getMemoryAllocator().getStats();
+        resizeStats  = renderer.getResizeManager().getStats();
+        renderer.getTimelineSync().dispatch();
+        syncStats    = renderer.getTimelineSync().getStats();
+        pipelineCache.waitIdle();
+        pipelineStats = pipelineCache.getStats();
+        streamer.waitIdle();
+        streamStats   = streamer.getStats();
+        streamBackend = streamer.getIoBackend();
+        residencyStats = renderer.getResidencyManager().getStats();
+        gpuProfilerStats = renderer.getGpuProfiler().getStats();
+        gpuMarkers       = renderer.getGpuProfiler().getMarkers().size();
+        sceneStats       = scene.getStats();
+        drawQueueStats   = drawQueue.getStats();
+    }
+
+    // Header and checksum go in once the renderer has destroyed everything it created
+    CaptureDevice::Stats captureStats;
+    bool                 captureWritten = true;
+    if (capture)
+    {
+        captureWritten = capture->finish();
+        captureStats   = capture->getStats();
+    }
+    if (streams > 0)
+    {
+        std::error_code error;
+        std::filesystem::remove(streamPath, error);
+    }
+    double totalSeconds = std::chrono::duration<double>(Clock::now() - begin).count();
+
+    auto stats      = device.getStats();
+    auto queueStats = device.getNullQueue().getStats();
+    std::printf("frames:          %u (%u in flight, %u recording threads)\n", frames, frameCount, threads > 0 ? threads : 1);
+    std::printf("total:           %.3f ms\n", totalSeconds * 1000.0);
+    std::printf("cpu per frame:   %.3f us\n", cpuSeconds * 1e6 / frames);
+    auto summary = cpuHistogram.getSummary();
+    std::printf("cpu p50/p95/p99: %.3f / %.3f / %.3f ms, max %.3f ms, %u stutters\n",
+                summary.p50, summary.p95, summary.p99, summary.max, summary.stutterCount);
+    std::printf("gpu busy:        %.3f ms\n", std::chrono::duration<double, std::milli>(queueStats.gpuBusyTime).count());
+    std::printf("gpu markers:     %.3f ms last frame over %zu markers, %llu frames resolved (%llu lost), %llu calibrations\n",
+                gpuProfilerStats.frameGpuTime * 1000.0, gpuMarkers,
+                static_cast<unsigned long long>(gpuProfilerStats.resolvedFrames),
+                static_cast<unsigned long long>(gpuProfilerStats.lostFrames),
+                static_cast<unsigned long long>(gpuProfilerStats.calibrations));
+    std::printf("cpu wait:        %.3f ms (%llu waits)\n",
+                std::chrono::duration<double, std::milli>(queueStats.cpuWaitTime).count(),
+                static_cast<unsigned long long>(queueStats.waitCount));
+    std::printf("commands:        %llu (%llu barriers, %llu aliasing, %llu clears)\n",
+                static_cast<unsigned long long>(stats.commands),
+                static_cast<unsigned long long>(stats.barriers),
+                static_cast<unsigned long long>(stats.aliasBarriers),
+                static_cast<unsigned long long>(stats.clears));
+    std::printf("state tracker:   %llu requested, %llu emitted (%llu at submit), %llu redundant, %llu merged\n",
+                static_cast<unsigned long long>(barrierStats.requested),
+                static_cast<unsigned long long>(barrierStats.emitted),
+                static_cast<unsigned long long>(barrierStats.fixups),
+                static_cast<unsigned long long>(barrierStats.redundant),
+                static_cast<unsigned long long>(barrierStats.merged));
+    std::printf("render graph:    %u passes (%u culled), %u transients, %.1f / %.1f MB heap used / capacity, %.1f MB unaliased\n",
+                graphStats.passes, graphStats.culledPasses, graphStats.transientTextures,
+                graphStats.heapUsedBytes / 1048576.0, graphStats.heapCapacity / 1048576.0, graphStats.transientBytes / 1048576.0);
+    std::printf("graph creates:   %llu textures, %llu heaps\n",
+                static_cast<unsigned long long>(graphStats.createdTextures),
+                static_cast<unsigned long long>(graphStats.createdHeaps));
+    std::printf("resize:          %llu requests, %llu applied, %llu reallocations (%llu shrinks), %llu swap chain resizes\n",
+                static_cast<unsigned long long>(resizeStats.requests),
+                static_cast<unsigned long long>(resizeStats.updates),
+                static_cast<unsigned long long>(resizeStats.reallocations),
+                static_cast<unsigned long long>(resizeStats.shrinks),
+                static_cast<unsigned long long>(stats.swapChainResizes));
+    std::printf("gpu memory:      %u blocks + %u dedicated heaps, %.1f / %.1f MB used / heaps, %.0f%% fragmented\n",
+                memoryStats.blocks, memoryStats.dedicatedHeaps,
+                memoryStats.usedBytes / 1048576.0, memoryStats.heapBytes / 1048576.0, memoryStats.fragmentation * 100.0);
+    std::printf("timeline:        %llu frames retired by callbacks, %llu blocking waits, %llu wait events created\n",
+                static_cast<unsigned long long>(retiredFrames),
+                static_cast<unsigned long long>(syncStats.waits),
+                static_cast<unsigned long long>(syncStats.createdEvents));
+    if (fps > 0)
+    {
+        auto& pacing = pacer.getStats();
+        std::printf("pacing:          %u fps target, start error mean %.1f us max %.1f us, %llu late, %.1f ms slept, %.1f ms spun\n",
+                    fps, pacing.totalError * 1e6 / pacing.frames, pacing.maxError * 1e6,
+                    static_cast<unsigned long long>(pacing.lateFrames), pacing.sleepSeconds * 1000.0, pacing.spinSeconds * 1000.0);
+    }
+
+    if (pipelines > 0)
+    {
+        char ready[32] = "not all ready";
+        if (pipelinesReadyFrame > 0)
+            std::snprintf(ready, sizeof(ready), "all ready at frame %u", pipelinesReadyFrame);
+        std::printf("pipelines:       %u requested, %s, %llu compiled (%llu from library), %llu fallbacks, %u library entries\n",
+                    pipelines, ready,
+                    static_cast<unsigned long long>(pipelineStats.compiles),
+                    static_cast<unsigned long long>(pipelineStats.libraryHits),
+                    static_cast<unsigned long long>(pipelineStats.fallbacks),
+                    pipelineStats.libraryEntries);
+    }
+
+    if (streams > 0)
+    {
+        char ready[32] = "not all ready";
+        if (streamsReadyFrame > 0)
+            std::snprintf(ready, sizeof(ready), "all ready at frame %u", streamsReadyFrame);
+        const char* backends[] = { "io_uring", "overlapped", "threads" };
+        std::printf("streaming:       %u requests, %s, %.1f MB read (%s), %llu copy batches, %llu budget / %llu staging stalls, %.1f MB peak staging\n",
+                    streams, ready, streamStats.bytesRead / 1048576.0, backends[static_cast<int>(streamBackend)],
+                    static_cast<unsigned long long>(streamStats.copyBatches),
+                    static_cast<unsigned long long>(streamStats.budgetStalls),
+                    static_cast<unsigned long long>(streamStats.stagingStalls),
+                    streamStats.peakStaging / 1048576.0);
+    }
+
+    if (residency > 0)
+    {
+        char budget[32] = "no";
+        if (budgetMb > 0)
+            std::snprintf(budget, sizeof(budget), "%u MB", budgetMb);
+        std::printf("residency:       %u heaps (%u evicted), %.0f MB used of %s budget, %llu evictions in %llu batches, %llu restores in %llu batches, %llu frames over budget\n",
+                    residencyStats.heaps, residencyStats.evictedHeaps, residencyStats.usage / 1048576.0, budget,
+                    static_cast<unsigned long long>(residencyStats.evictions),
+                    static_cast<unsigned long long>(residencyStats.evictBatches),
+                    static_cast<unsigned long long>(residencyStats.restores),
+                    static_cast<unsigned long long>(residencyStats.restoreBatches),
+                    static_cast<unsigned long long>(residencyStats.overBudgetFrames));
+    }
+
+    if (tracePath != nullptr && !Profiler::writeChromeTrace(tracePath))
+        std::fprintf(stderr, "failed to write trace %s\n", tracePath);
+
+    auto errorCount = device.getErrorCount();
+    if (entities > 0)
+    {
+        std::printf("scene:           %u entities in %u chunks, %.0f transforms / %.0f instances (%.2f MB) uploaded per frame in %.1f copies\n",
+                    sceneStats.entities, sceneStats.chunks,
+                    static_cast<double>(sceneTransforms) / frames, static_cast<double>(sceneInstances) / frames,
+                    static_cast<double>(sceneInstances) * InstanceUploader::InstanceSize / frames / 1048576.0,
+                    static_cast<double>(sceneCopies) / frames);
+    }
+    if (entities > 0 && meshes > 0)
+    {
+        std::printf("draws:           %u per frame in %.1f batches (%u sort passes), %.1f %s calls, %.1f pipeline / %.1f material / %.1f mesh binds per frame\n",
+                    drawQueueStats.items, static_cast<double>(drawBatches) / frames, drawQueueStats.sortPasses,
+                    static_cast<double>(drawStats.draws) / frames, indirect != 0 ? "indirect" : "draw",
+                    static_cast<double>(drawStats.pipelineChanges) / frames, static_cast<double>(drawStats.materialChanges) / frames,
+                    static_cast<double>(drawStats.meshChanges) / frames);
+        std::printf("gpu draws:       %llu draw commands, %llu indirect draws, %llu instances, %u skipped before pipelines were ready\n",
+                    static_cast<unsigned long long>(stats.draws), static_cast<unsigned long long>(stats.indirectDraws),
+                    static_cast<unsigned long long>(stats.instances), drawStats.skipped);
+    }
+    if (capture)
+    {
+        std::printf("capture:         %u frames, %llu events, %llu objects, %.1f MB written to %s%s\n",
+                    captureStats.frames, static_cast<unsigned long long>(captureStats.events),
+                    static_cast<unsigned long long>(captureStats.objects), captureStats.bytes / 1048576.0,
+                    capturePath, captureWritten ? "" : " (write failed)");
+    }
+    if (raster != 0)
+    {
+        std::printf("raster:          %.0f triangles, %.0f pixels per frame\n",
+                    static_cast<double>(stats.rasterTriangles) / frames, static_cast<double>(stats.rasterPixels) / frames);
+    }
+    std::printf("validation:      %llu errors\n", static_cast<unsigned long long>(errorCount));
+    for (auto& error : device.getErrors())
+        std::fprintf(stderr, "  %s\n", error.c_str());
+
+    return errorCount == 0 && captureWritten ? 0 : 1;
+}
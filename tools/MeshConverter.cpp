@@ -0,0 +1,273 @@
+#include "MeshWriter.hpp"
+
+#include <map>
+#include <array>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+using namespace GalgameEngine;
+
+/*
+* Convert Wavefront OBJ to .gmesh offline, all text parsing happens here and never at load
+*
+* Usage: DX12MeshConverter input.obj output.gmesh
+*        DX12MeshConverter --grid N output.gmesh
+*
+* Every o/g starts a mesh, every usemtl starts a submesh with the material's index in order of appearance.
+* Polygons are triangulated as fans, vertices are deduplicated per mesh, meshes of up to 65535 vertices get 16-bit indices
+* --grid writes one flat mesh of N x N quads, synthetic geometry of a known size for load benchmarks.
+*        N is 1 to 65535, so the (N + 1)^2 vertices fit a 32-bit index
+*/
+namespace
+{
+    struct Vertex
+    {
+        float position[3];
+        float normal[3];
+        float texcoord[2];
+    };
+
+    const std::vector<MeshFormat::Attribute> VertexAttributes = {
+        { MeshFormat::Semantic::Position, Format::R32G32B32_FLOAT, offsetof(Vertex, position) },
+        { MeshFormat::Semantic::Normal,   Format::R32G32B32_FLOAT, offsetof(Vertex, normal)   },
+        { MeshFormat::Semantic::Texcoord, Format::R32G32_FLOAT,    offsetof(Vertex, texcoord) },
+    };
+
+    // Geometry kept alive until the writer is done
+    struct MeshData
+    {
+        std::string                      name;
+        std::vector<Vertex>              vertices;
+        std::vector<uint32_t>            indices;
+        std::vector<uint16_t>            shortIndices;
+        std::vector<MeshWriter::Submesh> submeshes;
+    };
+
+    void addMesh(MeshWriter& writer, MeshData& data)
+    {
+        MeshWriter::Mesh mesh;
+        mesh.name         = data.name;
+        mesh.attributes   = VertexAttributes;
+        mesh.vertexStride = sizeof(Vertex);
+        mesh.vertexCount  = static_cast<uint32_t>(data.vertices.size());
+        mesh.vertices     = data.vertices.data();
+        mesh.indexCount   = static_cast<uint32_t>(data.indices.size());
+        mesh.submeshes    = data.submeshes;
+        if (data.vertices.size() <= UINT16_MAX)
+        {
+            data.shortIndices.assign(data.indices.begin(), data.indices.end());
+            mesh.indexSize = 2;
+            mesh.indices   = data.shortIndices.data();
+        }
+        else
+        {
+            mesh.indexSize = 4;
+            mesh.indices   = data.indices.data();
+        }
+
+        MeshWriter::Node node;
+        node.mesh = writer.addMesh(mesh);
+        writer.addNode(node);
+    }
+
+    // OBJ indices are 1-based, negative ones count back from the last element
+    int resolveIndex(const char* text, size_t count) noexcept
+    {
+        int index = std::atoi(text);
+        return index < 0 ? static_cast<int>(count) + index : index - 1;
+    }
+
+    bool convertObj(const char* inputPath, std::vector<MeshData>& meshes)
+    {
+        std::ifstream input(inputPath);
+        if (!input)
+            return false;
+
+        std::vector<std::array<float, 3>> positions;
+        std::vector<std::array<float, 3>> normals;
+        std::vector<std::array<float, 2>> texcoords;
+        std::map<std::string, uint32_t>   materials;
+
+        // Position, texcoord, normal index triple to the mesh vertex
+        std::map<std::array<int, 3>, uint32_t> vertexMap;
+        uint32_t                               material = 0;
+
+        meshes.emplace_back();
+        auto beginSubmesh = [&meshes](uint32_t materialIndex)
+        {
+            auto& mesh = meshes.back();
+            if (!mesh.submeshes.empty() && mesh.submeshes.back().indexCount == 0)
+                mesh.submeshes.pop_back();
+            mesh.submeshes.push_back({ static_cast<uint32_t>(mesh.indices.size()), 0, materialIndex });
+        };
+
+        std::string line;
+        while (std::getline(input, line))
+        {
+            std::istringstream stream(line);
+            std::string        keyword;
+            stream >> keyword;
+
+            if (keyword == "v")
+            {
+                auto& p = positions.emplace_back();
+                stream >> p[0] >> p[1] >> p[2];
+            }
+            else if (keyword == "vn")
+            {
+                auto& n = normals.emplace_back();
+                stream >> n[0] >> n[1] >> n[2];
+            }
+            else if (keyword == "vt")
+            {
+                auto& t = texcoords.emplace_back();
+                stream >> t[0] >> t[1];
+            }
+            else if (keyword == "o" || keyword == "g")
+            {
+                if (!meshes.back().indices.empty())
+                {
+                    meshes.emplace_back();
+                    vertexMap.clear();
+                }
+                stream >> meshes.back().name;
+            }
+            else if (keyword == "usemtl")
+            {
+                std::string name;
+                stream >> name;
+                material = materials.emplace(name, static_cast<uint32_t>(materials.size())).first->second;
+                beginSubmesh(material);
+            }
+            else if (keyword == "f")
+            {
+                auto& mesh = meshes.back();
+                if (mesh.submeshes.empty())
+                    beginSubmesh(material);
+
+                std::vector<uint32_t> polygon;
+                std::string           corner;
+                while (stream >> corner)
+                {
+                    // v, v/vt, v//vn or v/vt/vn
+                    std::array<int, 3> key = { -1, -1, -1 };
+                    auto first  = corner.find('/');
+                    auto second = first != std::string::npos ? corner.find('/', first + 1) : std::string::npos;
+                    key[0] = resolveIndex(corner.c_str(), positions.size());
+                    if (first != std::string::npos && first + 1 != second)
+                        key[1] = resolveIndex(corner.c_str() + first + 1, texcoords.size());
+                    if (second != std::string::npos)
+                        key[2] = resolveIndex(corner.c_str() + second + 1, normals.size());
+                    if (key[0] < 0 || key[0] >= static_cast<int>(positions.size()) ||
+                        key[1] >= static_cast<int>(texcoords.size()) || key[2] >= static_cast<int>(normals.size()))
+                    {
+                        std::fprintf(stderr, "index out of range: %s\n", line.c_str());
+                        return false;
+                    }
+
+                    auto [it, inserted] = vertexMap.emplace(key, static_cast<uint32_t>(mesh.vertices.size()));
+                    if (inserted)
+                    {
+                        Vertex vertex = {};
+                        std::memcpy(vertex.position, positions[key[0]].data(), sizeof(vertex.position));
+                        if (key[1] >= 0)
+                            std::memcpy(vertex.texcoord, texcoords[key[1]].data(), sizeof(vertex.texcoord));
+                        if (key[2] >= 0)
+                            std::memcpy(vertex.normal, normals[key[2]].data(), sizeof(vertex.normal));
+                        mesh.vertices.push_back(vertex);
+                    }
+                    polygon.push_back(it->second);
+                }
+
+                for (size_t i = 2; i < polygon.size(); ++i)
+                {
+                    mesh.indices.insert(mesh.indices.end(), { polygon[0], polygon[i - 1], polygon[i] });
+                    mesh.submeshes.back().indexCount += 3;
+                }
+            }
+        }
+
+        std::erase_if(meshes, [](const MeshData& mesh) { return mesh.indices.empty(); });
+        for (auto& mesh : meshes)
+            std::erase_if(mesh.submeshes, [](const MeshWriter::Submesh& submesh) { return submesh.indexCount == 0; });
+        return true;
+    }
+
+    // Largest N whose (N + 1)^2 vertices a 32-bit index reaches
+    constexpr unsigned long MaxGridSize = 65535;
+
+    void generateGrid(uint32_t size, MeshData& mesh)
+    {
+        mesh.name = "grid";
+        for (uint32_t y = 0; y <= size; ++y)
+        {
+            for (uint32_t x = 0; x <= size; ++x)
+            {
+                float u = static_cast<float>(x) / size;
+                float v = static_cast<float>(y) / size;
+                mesh.vertices.push_back({ { u - 0.5f, 0.0f, v - 0.5f }, { 0.0f, 1.0f, 0.0f }, { u, v } });
+            }
+        }
+        for (uint32_t y = 0; y < size; ++y)
+        {
+            for (uint32_t x = 0; x < size; ++x)
+            {
+                uint32_t corner = y * (size + 1) + x;
+                mesh.indices.insert(mesh.indices.end(), { corner, corner + size + 1, corner + 1, corner + 1, corner + size + 1, corner + size + 2 });
+            }
+        }
+    }
+}
+
+int main(int argc, char** argv)
+{
+    std::vector<MeshData> meshes;
+    const char*           outputPath;
+    unsigned long         gridSize = 0;
+    if (argc == 4 && std::strcmp(argv[1], "--grid") == 0 && (gridSize = std::strtoul(argv[2], nullptr, 10)) > 0 &&
+        gridSize <= MaxGridSize)
+    {
+        generateGrid(static_cast<uint32_t>(gridSize), meshes.emplace_back());
+        outputPath = argv[3];
+    }
+    else if (argc == 3)
+    {
+        if (!convertObj(argv[1], meshes))
+        {
+            std::fprintf(stderr, "failed to read %s\n", argv[1]);
+            return 1;
+        }
+        outputPath = argv[2];
+    }
+    else
+    {
+        std::fprintf(stderr, "usage: %s input.obj output.gmesh | --grid N output.gmesh, N from 1 to %lu\n", argv[0], MaxGridSize);
+        return 2;
+    }
+
+    MeshWriter writer;
+    uint64_t   vertexCount = 0;
+    uint64_t   indexCount  = 0;
+    for (auto& mesh : meshes)
+    {
+        addMesh(writer, mesh);
+        vertexCount += mesh.vertices.size();
+        indexCount  += mesh.indices.size();
+    }
+    if (!writer.write(outputPath))
+    {
+        std::fprintf(stderr, "failed to write %s\n", outputPath);
+        return 1;
+    }
+
+    std::printf("%zu meshes, %llu vertices, %llu indices, %.2f MB\n", meshes.size(),
+                static_cast<unsigned long long>(vertexCount), static_cast<unsigned long long>(indexCount),
+                writer.getFileSize() / 1048576.0);
+    return 0;
+}
@@ -0,0 +1,100 @@
+#include "NullDevice.hpp"
+#include "FrameHistogram.hpp"
+#include "CaptureReplayer.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+using namespace GalgameEngine;
+
+/*
+* Play a capture written by DX12Headless --capture back on the null backend
+* The same command stream every run, so CPU cost of the backend and GPU timings compare without the frame logic
+*
+* Usage: DX12Replay capture.gcap [--loops N] [--command-cost-us N] [--copy-mbps N]
+*
+* --loops replays the capture N times, frame times are over all of them
+* --command-cost-us and --copy-mbps configure the simulated GPU like DX12Headless does
+*/
+int main(int argc, char** argv)
+{
+    if (argc < 2)
+    {
+        std::fprintf(stderr, "usage: DX12Replay capture.gcap [--loops N] [--command-cost-us N] [--copy-mbps N]\n");
+        return 2;
+    }
+
+    uint32_t loops         = 1;
+    uint32_t commandCostUs = 0;
+    uint32_t copyMbps      = 0;
+    for (int i = 2; i + 1 < argc; i += 2)
+    {
+        auto value = static_cast<uint32_t>(std::strtoul(argv[i + 1], nullptr, 10));
+        if      (std::strcmp(argv[i], "--loops") == 0)           loops         = value;
+        else if (std::strcmp(argv[i], "--command-cost-us") == 0) commandCostUs = value;
+        else if (std::strcmp(argv[i], "--copy-mbps") == 0)       copyMbps      = value;
+        else
+        {
+            std::fprintf(stderr, "unknown option %s\n", argv[i]);
+            return 2;
+        }
+    }
+
+    NullDevice::Config deviceConfig;
+    deviceConfig.commandCost   = std::chrono::microseconds(commandCostUs);
+    deviceConfig.copyBandwidth = static_cast<uint64_t>(copyMbps) << 20;
+    NullDevice device(deviceConfig);
+
+    CaptureReplayer replayer(device);
+    if (!replayer.open(argv[1]))
+    {
+        std::fprintf(stderr, "cannot open capture %s, missing or corrupted\n", argv[1]);
+        return 1;
+    }
+
+    auto& header = replayer.getHeader();
+    auto  frames = header.frameCount > 1 ? header.frameCount - 1 : 1;
+    FrameHistogram replayHistogram(frames * (loops > 0 ? loops : 1));
+    FrameHistogram captureHistogram(frames);
+
+    bool   valid   = true;
+    double seconds = 0.0;
+    for (uint32_t loop = 0; loop < loops && valid; ++loop)
+    {
+        valid    = replayer.replay();
+        seconds += replayer.getStats().seconds;
+        for (auto frameTime : replayer.getFrameTimes())
+            replayHistogram.record(frameTime);
+    }
+    for (auto frameTime : replayer.getCapturedFrameTimes())
+        captureHistogram.record(frameTime);
+
+    auto& stats      = replayer.getStats();
+    auto  queueStats = device.getNullQueue().getStats();
+    std::printf("capture:         %u frames, %llu objects, %llu events, %.1f MB\n",
+                header.frameCount, static_cast<unsigned long long>(header.objectCount),
+                static_cast<unsigned long long>(header.eventCount), header.streamSize / 1048576.0);
+    std::printf("replay:          %u frames x %u loops, %.3f ms, %llu events, %llu lists, %llu commands, %llu objects\n",
+                stats.frames, loops, seconds * 1000.0,
+                static_cast<unsigned long long>(stats.events),
+                static_cast<unsigned long long>(stats.lists),
+                static_cast<unsigned long long>(stats.commands),
+                static_cast<unsigned long long>(stats.objects));
+    auto captured = captureHistogram.getSummary();
+    auto replayed = replayHistogram.getSummary();
+    std::printf("captured frames: p50 %.3f / p95 %.3f / max %.3f ms\n", captured.p50, captured.p95, captured.max);
+    std::printf("replayed frames: p50 %.3f / p95 %.3f / max %.3f ms\n", replayed.p50, replayed.p95, replayed.max);
+    std::printf("safety waits:    %llu\n", static_cast<unsigned long long>(stats.safetyWaits));
+    std::printf("gpu busy:        %.3f ms\n", std::chrono::duration<double, std::milli>(queueStats.gpuBusyTime).count());
+
+    auto errorCount = device.getErrorCount();
+    std::printf("validation:      %llu errors\n", static_cast<unsigned long long>(errorCount));
+    for (auto& error : device.getErrors())
+        std::fprintf(stderr, "  %s\n", error.c_str());
+    if (!valid)
+        std::fprintf(stderr, "malformed event after %llu events, replay stopped\n", static_cast<unsigned long long>(stats.events));
+
+    return valid && errorCount == 0 ? 0 : 1;
+}